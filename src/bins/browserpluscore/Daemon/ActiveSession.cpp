@@ -78,7 +78,8 @@ ActiveSession::ActiveSession(bp::ipc::Channel * session,
                              shared_ptr<ServiceRegistry> registry,
                              const std::string & primaryDistroServer,
                              const std::list<std::string> secondaryDistroServers)
-    : ServiceExecutionContext(), m_sessionMessage(NULL),
+    : ServiceExecutionContext(), m_messageLockRequested(false),
+      m_permGeneration(0), m_sessionMessage(NULL),
       m_createSessionCalled(false), m_listener(NULL),
       m_primaryDistroServer(primaryDistroServer),
       m_secondaryDistroServers(secondaryDistroServers)
@@ -339,7 +340,7 @@ bool
 ActiveSession::doInvoke(MessageContext* ctx)
 {
     bp::ipc::Response & r = ctx->m_response;
-    bp::ipc::Query & q = ctx->m_query;
+    const bp::ipc::Query & q = ctx->m_query;
 
     // validate the incoming request
     if (q.payload() == NULL ||
@@ -378,8 +379,9 @@ ActiveSession::doInvoke(MessageContext* ctx)
         return true;
     }
 
-    bp::service::Function funcDesc;
-    if (!desc.getFunction(function.c_str(), funcDesc))
+    const bp::service::Function * funcDesc =
+        desc.function(function.c_str());
+    if (funcDesc == NULL)
     {
         populateErrorResponse(r, "BP.noSuchFunction");
         return true;
@@ -388,7 +390,7 @@ ActiveSession::doInvoke(MessageContext* ctx)
     // now we've got the arguments and description, we're in a
     // position where we can validate the args.
     std::string verboseError =
-        bp::service::validateArguments(funcDesc, m.get());
+        bp::service::validateArguments(*funcDesc, m.get());
     
     if (!verboseError.empty())
     {
@@ -567,7 +569,7 @@ bool
 ActiveSession::doRequire(MessageContext* ctx)
 {
     bp::ipc::Response & r = ctx->m_response;
-    bp::ipc::Query & q = ctx->m_query;
+    const bp::ipc::Query & q = ctx->m_query;
     
     // payload is Map containing "services" (a list of services)
     // and optional "progressCallback"
@@ -635,7 +637,7 @@ bool
 ActiveSession::doDescribe(MessageContext* ctx)
 {
     bp::ipc::Response & r = ctx->m_response;
-    bp::ipc::Query & q = ctx->m_query;
+    const bp::ipc::Query & q = ctx->m_query;
 
     const bp::Object * pload = q.payload();
     if (pload == NULL || !pload->has("name", BPTString))
@@ -669,6 +671,58 @@ ActiveSession::doDescribe(MessageContext* ctx)
     return true;
 }
 
+// Describe several services in one round trip.  The payload is
+// { "services": [ { "name", "version", "minversion" }, ... ] } and the
+// response is a list with one description per entry, or null for
+// entries which could not be satisfied.
+bool
+ActiveSession::doDescribeServices(MessageContext* ctx)
+{
+    bp::ipc::Response & r = ctx->m_response;
+    const bp::ipc::Query & q = ctx->m_query;
+
+    const bp::Object * pload = q.payload();
+    if (pload == NULL || !pload->has("services", BPTList))
+    {
+        populateErrorResponse(r, "BP.invalidParameters");    
+        return true;    
+    }
+
+    const bp::List * l = (const bp::List *) pload->get("services");
+    std::vector<ServiceSpec> specs;
+    for (unsigned int i = 0; i < l->size(); i++) {
+        const bp::Object * o = l->value(i);
+        if (o == NULL || !o->has("name", BPTString)) {
+            populateErrorResponse(r, "BP.invalidParameters");    
+            return true;    
+        }
+        ServiceSpec spec;
+        spec.m_name = std::string(*(o->get("name")));
+        if (o->has("version", BPTString)) {
+            spec.m_version = std::string(*(o->get("version")));
+        }
+        if (o->has("minversion", BPTString)) {
+            spec.m_minversion = std::string(*(o->get("minversion")));
+        }
+        specs.push_back(spec);
+    }
+
+    std::vector<bool> found;
+    std::vector<bp::service::Summary> summaries;
+    std::vector<bp::service::Description> descs;
+    m_registry->resolve(specs, found, summaries, descs);
+
+    bp::List results;
+    for (size_t i = 0; i < specs.size(); i++) {
+        bp::Object * obj = found[i] ? descs[i].toBPObject() : NULL;
+        if (obj == NULL) obj = new bp::Null;
+        results.append(obj);
+    }
+    populateSuccessResponse(r, &results);
+
+    return true;
+}
+
 bool
 ActiveSession::doHave(MessageContext*)
 {
@@ -793,6 +847,12 @@ ActiveSession::onQuery(bp::ipc::Channel *,
             rv = dispatchMessage(&ActiveSession::doDescribe, perms,
                                  m_session, query, response);
         }
+        else if (!query.command().compare("DescribeServices"))
+        {
+            perms.push_back(PermissionsManager::kAllowDomain);
+            rv = dispatchMessage(&ActiveSession::doDescribeServices, perms,
+                                 m_session, query, response);
+        }
         else if (!query.command().compare("CreateSession"))
         {
             // CreateSession should be called exactly once at startup
@@ -824,6 +884,8 @@ ActiveSession::onQuery(bp::ipc::Channel *,
                           it->second->type() == BPTString)
                     {
                         m_URI = normalizeClientURI(*(it->second));
+                        // decisions are per domain
+                        m_permDecisions.clear();
                     }
                     else if (!it->first.compare("locale") &&
                              it->second->type() == BPTString)
@@ -907,7 +969,7 @@ bool
 ActiveSession::doGetState(MessageContext* ctx)
 {
     bp::ipc::Response & r = ctx->m_response;
-    bp::ipc::Query & q = ctx->m_query;
+    const bp::ipc::Query & q = ctx->m_query;
 
     const bp::Object * pload = q.payload();
     if (pload == NULL || pload->type() != BPTString)
@@ -934,7 +996,7 @@ ActiveSession::doSetState(MessageContext* ctx)
     ctx->m_isMessage = true;
     
     bp::ipc::Response & r = ctx->m_response;
-    bp::ipc::Query & q = ctx->m_query;
+    const bp::ipc::Query & q = ctx->m_query;
 
     const bp::Object * pload = q.payload();
     if (pload == NULL || pload->type() != BPTMap ||
@@ -969,6 +1031,7 @@ ActiveSession::onUserResponse(unsigned int cookie, const bp::Object & resp)
     // should be message on front of queue
     if (m_messages.empty()) {
         BPLOG_WARN_STRM("got unexpected UserConfirm/DenyEvent event with empty");  
+        m_messageLockRequested = false;
         RequireLock::releaseLock(shared_from_this());
         return;
     }
@@ -977,7 +1040,6 @@ ActiveSession::onUserResponse(unsigned int cookie, const bp::Object & resp)
     if (ctx->m_cookie != cookie) {
         BPLOG_WARN_STRM("got UserConfirm/DenyEvent event with unknown cookie: "
                         << cookie);  
-        RequireLock::releaseLock(shared_from_this());
         return;
     }
     m_messages.pop_front();
@@ -991,8 +1053,9 @@ ActiveSession::onUserResponse(unsigned int cookie, const bp::Object & resp)
     bool allow = (response.find("Allow") != std::string::npos);
     bool always = (response.find("Always") != std::string::npos);
         
-    // if user said "always", update domain permissions, else
-    // update session's transient permissions
+    // if user said "always", update domain permissions.  either way
+    // update session's transient permissions, so that the answer holds
+    // for this session even if the saved one doesn't read back.
     if (always) {
         std::string d = domain();
         PermissionsManager* pmgr = PermissionsManager::get();
@@ -1013,28 +1076,16 @@ ActiveSession::onUserResponse(unsigned int cookie, const bp::Object & resp)
                 }
             }
         }
-    } else {
-        std::vector<std::string>::const_iterator si;
-        for (si = ctx->m_perms.begin(); si != ctx->m_perms.end(); ++si) {
-            setTransientPermission(*si, allow);
-        }
     }
-
-    // no responses for message
-    if (!ctx->m_isMessage) {
-        if (allow) {
-            if ((this->*(ctx->m_func))(ctx)) {
-                ctx->sendResponse();
-            }
-        } else {
-            populateErrorResponse(ctx->m_response, "BP.permissionsError");
-            ctx->sendResponse();
-        }
+    std::vector<std::string>::const_iterator si;
+    for (si = ctx->m_perms.begin(); si != ctx->m_perms.end(); ++si) {
+        setTransientPermission(*si, allow);
     }
-        
-    RequireLock::releaseLock(shared_from_this());
 
-    delete ctx;
+    // the message we prompted for gets the answer as given, then
+    // everything waiting on the same permissions is re-evaluated
+    completeMessage(ctx, allow);
+    doNextDispatch();
 }
 
 void
@@ -1295,6 +1346,7 @@ void
 ActiveSession::setTransientPermission(const std::string& perm, bool val)
 {
     m_transientPermissions[perm] = val;
+    m_permDecisions.erase(perm);
 }
 
 std::string
@@ -1342,22 +1394,53 @@ ActiveSession::checkPermissions()
 PermissionsManager::Permission 
 ActiveSession::checkDomainPermission(const std::string& permission)
 {
+    // resolving the domain and walking the permission patterns is
+    // costly, remember the answer until permissions change
+    PermissionsManager* pmgr = PermissionsManager::get();
+    if (pmgr->generation() != m_permGeneration) {
+        m_permDecisions.clear();
+        m_permGeneration = pmgr->generation();
+    }
+    std::map<std::string, PermissionsManager::Permission>::const_iterator it;
+    it = m_permDecisions.find(permission);
+    if (it != m_permDecisions.end()) {
+        return it->second;
+    }
+
     // does permission need approval for our domain?
+    PermissionsManager::Permission rval = PermissionsManager::eNotAllowed;
     std::string d = domain();
-    if (d.compare("unknown") == 0) {
-        return PermissionsManager::eNotAllowed;
+    if (d.compare("unknown") != 0) {
+        std::string resolvedDomain = pmgr->normalizeDomain(d);
+        rval = pmgr->queryDomainPermission(resolvedDomain, permission);
+        if (rval == PermissionsManager::eUnknown) {
+            rval = transientPermission(permission);
+        }
     }
-    PermissionsManager* pmgr = PermissionsManager::get();
-    std::string resolvedDomain = pmgr->normalizeDomain(d);
 
-    PermissionsManager::Permission rval =
-        pmgr->queryDomainPermission(resolvedDomain, permission);
+    m_permDecisions[permission] = rval;
+    return rval;
+}
 
-    if (rval == PermissionsManager::eUnknown) {
-        rval = transientPermission(permission);
+PermissionsManager::Permission
+ActiveSession::evaluatePermissions(const std::vector<std::string>& perms,
+                                   std::vector<std::string>& needed)
+{
+    needed.clear();
+    for (unsigned int i = 0; i < perms.size(); i++) {
+        switch (checkDomainPermission(perms[i])) {
+            case PermissionsManager::eAllowed:
+                break;
+            case PermissionsManager::eNotAllowed:
+                needed.clear();
+                return PermissionsManager::eNotAllowed;
+            case PermissionsManager::eUnknown:
+                needed.push_back(perms[i]);
+                break;
+        }
     }
-
-    return rval;
+    return needed.empty() ? PermissionsManager::eAllowed
+                          : PermissionsManager::eUnknown;
 }
 
 bool
@@ -1368,92 +1451,95 @@ ActiveSession::dispatchMessage(tHandler func,
                                bp::ipc::Response & response)
 {
     // find out which permissions we need to prompt for
-    MessageContext* ctx = NULL;
     std::vector<std::string> neededPerms;
-    for (unsigned int i = 0; i < perms.size(); i++) {
-        switch (checkDomainPermission(perms[i])) {
-            case PermissionsManager::eAllowed:
-                break;
-            case PermissionsManager::eNotAllowed:
-                populateErrorResponse(response, "BP.permissionsError");    
-                return true; 
-            case PermissionsManager::eUnknown:
-                neededPerms.push_back(perms[i]);
-                break;
+    switch (evaluatePermissions(perms, neededPerms)) {
+        case PermissionsManager::eNotAllowed:
+            populateErrorResponse(response, "BP.permissionsError");    
+            return true; 
+        case PermissionsManager::eAllowed: {
+            // nothing needed, process message in place.  the context
+            // borrows the query and writes straight into the response
+            MessageContext ctx(func, session, query, response);
+            return (this->*func)(&ctx);
         }
+        case PermissionsManager::eUnknown:
+            break;
     }
-    
-    bool rval = false;
-    if (neededPerms.empty()) {
-        // nothing needed, process message
-        ctx = new MessageContext(func, session, query, response);
-        rval = (this->*func)(ctx);
-        // in this case we must alter the response message.  because
-        // we've copied into messagecontext, we must copy back out
-        // to our in/out parameter
-        response = ctx->m_response;
-        delete ctx;
-    } else {
-        // gotta get user permission.  push onto queue and attain
-        // same lock used by RequireRequest.  Will get 
-        // RequireLock::LockAttainedEvent when it's our turn.
-        // This prevents us from double-prompting for permissions.
-        ctx = new MessageContext(func, session, query, response);
-        ctx->m_perms = neededPerms;
-        m_messages.push_back(ctx);
-        BPLOG_DEBUG_STRM("ActiveSession::dispatchMessage asks for lock");
 
+    // gotta get user permission.  the channel frees the query once
+    // we return, so the queued context keeps its own.
+    MessageContext* ctx =
+        new MessageContext(func, session, new bp::ipc::Query(query),
+                           new bp::ipc::Response(response));
+    ctx->m_perms = neededPerms;
+    m_messages.push_back(ctx);
+
+    // attain same lock used by RequireRequest.  Will get 
+    // RequireLock::LockAttainedEvent when it's our turn.
+    // This prevents us from double-prompting for permissions
+    // in this domain.  One request covers the whole queue, messages
+    // which arrive while it's outstanding are released alongside.
+    if (!m_messageLockRequested) {
+        BPLOG_DEBUG_STRM("ActiveSession::dispatchMessage asks for lock");
+        m_messageLockRequested = true;
         m_thisWeak = shared_from_this();
-        RequireLock::attainLock(m_thisWeak);
-        rval = false;
+        RequireLock::Keys keys;
+        keys.insert(RequireLock::domainKey(domain()));
+        RequireLock::attainLock(m_thisWeak, keys);
     }
     
-    return rval;
+    return false;
 }
 
-void 
-ActiveSession::doNextDispatch()
+void
+ActiveSession::releaseQueuedMessages()
 {
-    if (m_messages.empty()) {
-        RequireLock::releaseLock(shared_from_this());
-        return;
+    // pull out everything which is decided before running any of it,
+    // handlers may well dispatch more.  second is whether it's allowed.
+    std::list<std::pair<MessageContext*, bool> > ready;
+    std::list<MessageContext*>::iterator it = m_messages.begin();
+    while (it != m_messages.end()) {
+        MessageContext* ctx = *it;
+        std::vector<std::string> needed;
+        PermissionsManager::Permission p =
+            evaluatePermissions(ctx->m_perms, needed);
+        if (p == PermissionsManager::eUnknown) {
+            ctx->m_perms.swap(needed);
+            ++it;
+            continue;
+        }
+        ready.push_back(std::make_pair(ctx,
+                                       p == PermissionsManager::eAllowed));
+        it = m_messages.erase(it);
     }
-    MessageContext* ctx = m_messages.front();
 
-    // do we still need to prompt?
-    std::vector<std::string>::iterator it = ctx->m_perms.begin();
-    while (it != ctx->m_perms.end()) {
-        std::string p = *it;
-        switch (checkDomainPermission(p)) {
-            case PermissionsManager::eAllowed:
-                it = ctx->m_perms.erase(it);
-                break;
-            case PermissionsManager::eNotAllowed: {
-                m_messages.pop_front();
-                populateErrorResponse(ctx->m_response, "BP.permissionsError"); 
-                if (!ctx->m_isMessage) ctx->sendResponse();
-                RequireLock::releaseLock(shared_from_this());
-                delete ctx;
-                return; 
-            }
-            case PermissionsManager::eUnknown:
-                ++it;
-                break;
-        }
+    if (!ready.empty()) {
+        BPLOG_DEBUG_STRM("[" << m_session << "] releasing "
+                         << ready.size() << " queued messages");
     }
-    
-    // yay, all of our perms have been approved by another prompt
-    if (ctx->m_perms.empty()) {
-        if ((this->*(ctx->m_func))(ctx) && !ctx->m_isMessage) {
-            ctx->sendResponse();
-        }
-        RequireLock::releaseLock(shared_from_this());
-        m_messages.pop_front();
-        delete ctx;
-        return; 
+
+    std::list<std::pair<MessageContext*, bool> >::iterator rit;
+    for (rit = ready.begin(); rit != ready.end(); ++rit) {
+        completeMessage(rit->first, rit->second);
     }
-    
-    // still gotta prompt
+}
+
+void
+ActiveSession::completeMessage(MessageContext* ctx, bool allowed)
+{
+    if (!allowed) {
+        populateErrorResponse(ctx->m_response, "BP.permissionsError"); 
+        if (!ctx->m_isMessage) ctx->sendResponse();
+    } else if ((this->*(ctx->m_func))(ctx) && !ctx->m_isMessage) {
+        ctx->sendResponse();
+    }
+    delete ctx;
+}
+
+void
+ActiveSession::promptForNextMessage()
+{
+    MessageContext* ctx = m_messages.front();
     ServiceSynopsisList emptyList;
     ctx->m_cookie = bp::random::generate();
     PermissionsManager* pmgr = PermissionsManager::get();
@@ -1471,6 +1557,24 @@ ActiveSession::doNextDispatch()
                          emptyList);
 }
 
+void 
+ActiveSession::doNextDispatch()
+{
+    // release everything another prompt (or the user's answer to
+    // ours) has decided, then prompt for whatever remains
+    releaseQueuedMessages();
+
+    if (m_messages.empty()) {
+        m_messageLockRequested = false;
+        RequireLock::releaseLock(shared_from_this());
+        return;
+    }
+
+    // still gotta prompt, we keep holding the lock until the user
+    // answers
+    promptForNextMessage();
+}
+
 
 unsigned int
 ActiveSession::sendPromptUserMessage(
@@ -159,18 +159,33 @@ class ActiveSession : public virtual RequireLock::ILockListener,
     
     class MessageContext {
       public:
+        // a context which borrows the caller's query and response, for
+        // messages dispatched before the caller returns
         MessageContext(tHandler h, bp::ipc::Channel * session,
                        const bp::ipc::Query & query,
-                       const bp::ipc::Response& response) 
+                       bp::ipc::Response & response) 
             : m_func(h), m_session(session),
+              m_ownedQuery(NULL), m_ownedResponse(NULL),
               m_query(query), m_response(response), m_perms(), 
               m_cookie(0), m_isMessage(false)
         {
         }
 
-        // copying/assignment supported via compiler generated fuctions.
-        
+        // a context which takes ownership of its query and response,
+        // for messages queued while we await permission
+        MessageContext(tHandler h, bp::ipc::Channel * session,
+                       bp::ipc::Query * query,
+                       bp::ipc::Response * response) 
+            : m_func(h), m_session(session),
+              m_ownedQuery(query), m_ownedResponse(response),
+              m_query(*query), m_response(*response), m_perms(), 
+              m_cookie(0), m_isMessage(false)
+        {
+        }
+
         ~MessageContext() {
+            delete m_ownedQuery;
+            delete m_ownedResponse;
         }
         void sendResponse() {
             if (!m_session->sendResponse(m_response))
@@ -185,11 +200,19 @@ class ActiveSession : public virtual RequireLock::ILockListener,
         // For messages, no errors are returned.
         tHandler m_func;
         bp::ipc::Channel * m_session;
-        bp::ipc::Query m_query;
-        bp::ipc::Response m_response;
+        // non-NULL when the context owns what m_query/m_response refer to
+        bp::ipc::Query * m_ownedQuery;
+        bp::ipc::Response * m_ownedResponse;
+        const bp::ipc::Query & m_query;
+        bp::ipc::Response & m_response;
         std::vector<std::string> m_perms;
         unsigned int m_cookie;
         bool m_isMessage;
+
+      private:
+        // contexts hold references, no copying/assignment
+        MessageContext(const MessageContext &);
+        MessageContext & operator=(const MessageContext &);
     };
     
     // Get an smm message, check needed perms, and process
@@ -199,6 +222,13 @@ class ActiveSession : public virtual RequireLock::ILockListener,
                          const bp::ipc::Query & query,
                          bp::ipc::Response & response);
 
+    // evaluate a set of permissions against cached decisions.
+    // eNotAllowed if any is denied, otherwise eUnknown with those
+    // which still need a prompt left in needed, or eAllowed.
+    PermissionsManager::Permission
+        evaluatePermissions(const std::vector<std::string>& perms,
+                            std::vector<std::string>& needed);
+
     // implementation of IChannelListener::onQuery(), first places where
     // incoming IPC queries arrive.  Performs type specific setup work,
     // then passes to dispatchMessage.
@@ -207,18 +237,34 @@ class ActiveSession : public virtual RequireLock::ILockListener,
                          bp::ipc::Response & response);
     
     void doNextDispatch();
+
+    // run every queued message whose permissions are now granted and
+    // fail those which are now denied, all in one pass.  Leaves those
+    // which still need a prompt on the queue.
+    void releaseQueuedMessages();
+
+    // run (or deny) a message taken off the queue, and free it
+    void completeMessage(MessageContext* ctx, bool allowed);
+
+    // prompt for the permissions needed by the message at the head
+    // of the queue
+    void promptForNextMessage();
     
     bool doInvoke(MessageContext* ctx);
     bool doRequire(MessageContext* ctx);
     bool doDescribe(MessageContext* ctx);
+    bool doDescribeServices(MessageContext* ctx);
     bool doHave(MessageContext* ctx);
     bool doActiveServices(MessageContext* ctx);
     bool doGetState(MessageContext* ctx);
 	bool doSetState(MessageContext* ctx);
 
     // Messages which seem to require user prompting are queued and use the
-    // RequireLock.  This ensures that only one user prompt is displayed at once
+    // RequireLock.  This ensures that only one user prompt is displayed at
+    // once for a domain.  The lock is asked for once on behalf of the
+    // whole queue, and held until the queue drains.
     std::list<MessageContext*> m_messages;
+    bool m_messageLockRequested;
     
     // invoked when a response to a installation prompt is received
     // implemented from IServiceExecutionContextListener to handle
@@ -334,6 +380,12 @@ class ActiveSession : public virtual RequireLock::ILockListener,
     long m_clientPid;
     
     std::map<std::string, bool> m_transientPermissions;
+
+    // decisions of checkDomainPermission() keyed by permission, valid
+    // while the PermissionsManager generation matches and the session's
+    // domain doesn't change
+    std::map<std::string, PermissionsManager::Permission> m_permDecisions;
+    unsigned int m_permGeneration;
     
     // The "createSession" message may require that we check with
     // the distribution server.  Save the original message so that
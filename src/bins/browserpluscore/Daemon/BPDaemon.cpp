@@ -352,6 +352,31 @@ BPDaemon::setupServiceRegistry()
         shared_ptr<InactiveServicesServiceFactory>(
             new InactiveServicesServiceFactory()));
 
+    // trusted services may run inside the daemon unless configured off
+    bool inProcess = true;
+    if (m_configReader.getBooleanValue("InProcessServices", inProcess)) {
+        m_registry->setInProcessServices(inProcess);
+    }
+
+    // shareable services may run together in one host process, save
+    // those configured to be isolated
+    bool sharedHost = false;
+    if (m_configReader.getBooleanValue("SharedServiceHost", sharedHost)) {
+        m_registry->setSharedServiceHost(sharedHost);
+    }
+    std::list<std::string> isolated;
+    if (m_configReader.getArrayOfStrings("IsolatedServices", isolated)) {
+        m_registry->setIsolatedServices(isolated);
+    }
+
+    // idle services held or prewarmed on the strength of past use
+    long long idleBudget = 0;
+    if (m_configReader.getIntegerValue("IdleServiceBudget", idleBudget)
+        && idleBudget >= 0)
+    {
+        m_registry->setIdleServiceBudget((unsigned int) idleBudget);
+    }
+
     // now set the service directorys
     if (m_argParser.argumentPresent("cd")) {
         std::vector<std::string> serviceDirs = m_argParser.argumentValues("cd");
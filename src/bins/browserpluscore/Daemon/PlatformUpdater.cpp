@@ -265,9 +265,11 @@ PlatformUpdaterSingleton::installToCache(
     const LatestPlatformPkgAndVersion & platformInfo)
 {
     m_busy = true;
-    PlatformUnpacker unpacker(platformInfo.m_pkg, 
+    PlatformUnpacker unpacker(platformInfo.m_pkg.m_path, 
                               bp::paths::getPlatformCacheDirectory(),
                               platformInfo.m_version);
+    unpacker.setExpected(platformInfo.m_pkg.m_size,
+                         platformInfo.m_pkg.m_sha256);
     string errMsg;
     bool rval = (unpacker.unpack(errMsg) && unpacker.install(errMsg));
     m_busy = false;
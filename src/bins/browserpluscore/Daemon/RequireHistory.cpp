@@ -0,0 +1,158 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireHistory, the service require statements seen by this
+ * installation.
+ */
+
+#include "RequireHistory.h"
+#include <map>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bptypeutil.h"
+#include "platform_utils/bpkvlog.h"
+#include "platform_utils/bpphash.h"
+#include "platform_utils/ProductPaths.h"
+
+using namespace std;
+
+
+// statements are keyed name/version/minversion
+#define SEPARATOR "/"
+
+// the bp::phash key under which earlier versions kept the whole
+// history as one JSON map of name to a list of "version/minversion"
+static const char * s_legacyKey = "RequireRequest::kRequireStatementsKey";
+
+static bp::KVLog s_log;
+static boost::filesystem::path s_path;
+static bool s_opened = false;
+static bp::sync::Mutex s_openLock;
+
+
+static string
+keyFor(const string & name, const string & version,
+       const string & minversion)
+{
+    return name + SEPARATOR + version + SEPARATOR + minversion;
+}
+
+
+static void
+importLegacy()
+{
+    string mapStr;
+    if (!bp::phash::get(s_legacyKey, mapStr)) return;
+
+    bp::Object * o = bp::Object::fromPlainJsonString(mapStr);
+    if (o != NULL && o->type() == BPTMap) {
+        const bp::Map * m = (const bp::Map *) o;
+        bp::Map::Iterator it(*m);
+        const char * name = NULL;
+        while ((name = it.nextKey()) != NULL) {
+            const bp::Object * l = m->value(name);
+            if (l == NULL || l->type() != BPTList) continue;
+            const bp::List * versions = (const bp::List *) l;
+            for (unsigned int i = 0; i < versions->size(); i++) {
+                const bp::Object * v = versions->value(i);
+                if (v == NULL || v->type() != BPTString) continue;
+                (void) s_log.set(string(name) + SEPARATOR + string(*v),
+                                 string());
+            }
+        }
+    }
+    delete o;
+    bp::phash::remove(s_legacyKey);
+    BPLOG_INFO_STRM("imported require history from " << s_legacyKey);
+}
+
+
+static bool
+openLog()
+{
+    bp::sync::Lock lck(s_openLock);
+    // follow the product directory should it move (as it does between
+    // tests)
+    boost::filesystem::path path = bp::paths::getRequireHistoryPath();
+    if (path.empty()) return false;
+    if (!s_opened || path != s_path) {
+        s_path = path;
+        s_opened = s_log.open(path);
+        if (s_opened) importLegacy();
+    }
+    return s_opened;
+}
+
+
+void
+RequireHistory::add(const list<ServiceRequireStatement> & requires)
+{
+    if (!openLog()) return;
+
+    list<ServiceRequireStatement>::const_iterator it;
+    for (it = requires.begin(); it != requires.end(); ++it) {
+        string key = keyFor(it->m_name, it->m_version, it->m_minversion);
+        string val;
+        if (s_log.get(key, val)) continue;
+        if (s_log.set(key, string())) {
+            BPLOG_INFO_STRM("added to update require history: "
+                            << it->m_name << "(" << it->m_version
+                            << "/" << it->m_minversion << ")");
+        }
+    }
+}
+
+
+list<ServiceRequireStatement>
+RequireHistory::statements()
+{
+    list<ServiceRequireStatement> rval;
+    if (!openLog()) return rval;
+
+    map<string, string> entries = s_log.entries();
+    map<string, string>::const_iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) {
+        vector<string> tokens = bp::strutil::split(it->first, SEPARATOR);
+        if (tokens.size() != 3) continue;
+        ServiceRequireStatement req;
+        req.m_name = tokens[0];
+        req.m_version = tokens[1];
+        req.m_minversion = tokens[2];
+        rval.push_back(req);
+    }
+    return rval;
+}
+
+
+void
+RequireHistory::clear()
+{
+    if (!openLog()) return;
+
+    map<string, string> entries = s_log.entries();
+    map<string, string>::const_iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) {
+        (void) s_log.remove(it->first);
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireHistory, the service require statements seen by this
+ * installation, which the service updater checks for updates.
+ *
+ * Each distinct statement is a key of its own in a bp::KVLog, so
+ * recording a require appends at most one record per statement not
+ * seen before, rather than rewriting the whole history.
+ */
+
+#ifndef __REQUIREHISTORY_H__
+#define __REQUIREHISTORY_H__
+
+#include <list>
+#include "DistributionClient/DistributionClient.h"
+
+
+namespace RequireHistory
+{
+    /**
+     * add those of requires which aren't in the history yet
+     */
+    void add(const std::list<ServiceRequireStatement> & requires);
+
+    /**
+     * all statements in the history
+     */
+    std::list<ServiceRequireStatement> statements();
+
+    /**
+     * forget all statements
+     */
+    void clear();
+};
+
+#endif
@@ -39,7 +39,17 @@ using namespace std::tr1;
 
 
 static bool s_initialized = false;
-std::list<weak_ptr<RequireLock::ILockListener> > s_lockQueue;
+
+// a request for the lock, either holding it or waiting its turn
+struct LockEntry
+{
+    weak_ptr<RequireLock::ILockListener> m_listener;
+    RequireLock::Keys m_keys;
+    bool m_held;
+};
+
+// in the order the lock was asked for
+static std::list<LockEntry> s_lockQueue;
 
 void
 RequireLock::initialize()
@@ -98,29 +108,102 @@ postLockReadyEvent(weak_ptr<RequireLock::ILockListener> listener)
     hopper.invokeOnThread(invokeCallbackFunction, (void *) copy);
 }
 
+static bool
+conflicts(const RequireLock::Keys & a, const RequireLock::Keys & b)
+{
+    if (a.empty() || b.empty()) return true;
+    RequireLock::Keys::const_iterator it;
+    for (it = a.begin(); it != a.end(); ++it) {
+        if (b.find(*it) != b.end()) return true;
+    }
+    return false;
+}
+
+// grant the lock to each waiter that overlaps nobody ahead of it
+static void
+grantWaiters()
+{
+    std::list<LockEntry>::iterator it = s_lockQueue.begin();
+    while (it != s_lockQueue.end()) {
+        if (it->m_held) {
+            ++it;
+            continue;
+        }
+        // a waiter who's gone away would only hold others up
+        if (it->m_listener.expired()) {
+            it = s_lockQueue.erase(it);
+            continue;
+        }
+        bool blocked = false;
+        std::list<LockEntry>::iterator prior;
+        for (prior = s_lockQueue.begin(); prior != it; ++prior) {
+            if (conflicts(prior->m_keys, it->m_keys)) {
+                blocked = true;
+                break;
+            }
+        }
+        if (!blocked) {
+            it->m_held = true;
+            postLockReadyEvent(it->m_listener);
+        }
+        ++it;
+    }
+}
+
+std::string
+RequireLock::domainKey(const std::string & domain)
+{
+    return "domain:" + domain;
+}
+
+std::string
+RequireLock::serviceKey(const std::string & name)
+{
+    return "service:" + name;
+}
+
+std::string
+RequireLock::platformKey()
+{
+    return "platform";
+}
+
 void
 RequireLock::attainLock(weak_ptr<ILockListener> listener)
 {
-    s_lockQueue.push_back(listener);
+    attainLock(listener, Keys());
+}
+
+void
+RequireLock::attainLock(weak_ptr<ILockListener> listener,
+                        const Keys & keys)
+{
+    LockEntry entry;
+    entry.m_listener = listener;
+    entry.m_keys = keys;
+    entry.m_held = false;
+    s_lockQueue.push_back(entry);
 
-    if (s_lockQueue.size() == 1) {
-        postLockReadyEvent(s_lockQueue.front());
-    }
+    grantWaiters();
 }
 
 void
 RequireLock::releaseLock(weak_ptr<ILockListener> listener)
 {
+    shared_ptr<ILockListener> l = listener.lock();
+    std::list<LockEntry>::iterator it;
+    for (it = s_lockQueue.begin(); it != s_lockQueue.end(); ++it) {
+        if (it->m_held && it->m_listener.lock() == l) break;
+    }
+
     // if the caller of release lock doesn't own the lock, then
     // ignore this call
-    if (s_lockQueue.empty() || (listener.lock() != s_lockQueue.front().lock())) {
+    if (it == s_lockQueue.end()) {
         return;
     }
     BPLOG_DEBUG("Require lock released");
-    s_lockQueue.pop_front();
+    s_lockQueue.erase(it);
 
-    if (s_lockQueue.size() > 0) {
-        postLockReadyEvent(s_lockQueue.front());
-    }
+    grantWaiters();
 }
 
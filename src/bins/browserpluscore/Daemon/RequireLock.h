@@ -25,6 +25,11 @@
  * one session at a time is allowed to require services.
  * (YIB-1770124)
  *
+ * Locks may be keyed by the domain prompted for and the services
+ * installed, in which case only holders whose keys overlap exclude
+ * one another.  Among overlapping requests the lock is granted in
+ * the order it was asked for.
+ *
  * Created by Lloyd Hilaiel on Mon Feb 25th 2008.
  * Copyright (c) 2008 Yahoo!, Inc. All rights reserved.
  */
@@ -32,6 +37,8 @@
 #ifndef __REQUIRELOCK_H__
 #define __REQUIRELOCK_H__
 
+#include <set>
+#include <string>
 #include "BPUtils/bptr1.h"
 
 
@@ -61,11 +68,39 @@ namespace RequireLock
         virtual void gotRequireLock() = 0;
     };
 
+    /**
+     * the things a lock holder may touch.  An empty set conflicts
+     * with every other holder.
+     */
+    typedef std::set<std::string> Keys;
+
+    /**
+     * the key for prompting the user on behalf of a domain
+     */
+    std::string domainKey(const std::string & domain);
+
+    /**
+     * the key for installing or updating a service
+     */
+    std::string serviceKey(const std::string & name);
+
+    /**
+     * the key for prompting for or installing a platform update
+     */
+    std::string platformKey();
+
     /**
      * Attempt to attain the exclusive require lock.  
      */
     void attainLock(std::tr1::weak_ptr<ILockListener> listener);
 
+    /**
+     * Attempt to attain the require lock for the given keys.  The
+     * lock is granted once no earlier holder or waiter shares a key.
+     */
+    void attainLock(std::tr1::weak_ptr<ILockListener> listener,
+                    const Keys & keys);
+
     /**
      * Release the exclusive require lock.  This must be called once
      * per recieved LockAttainedEvent, lest all requires are infinitily
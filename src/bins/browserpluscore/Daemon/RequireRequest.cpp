@@ -32,9 +32,9 @@
 #include "BPUtils/OS.h"
 #include "Permissions/Permissions.h"
 #include "platform_utils/bplocalization.h"
-#include "platform_utils/bpphash.h"
 #include "platform_utils/ProductPaths.h"
 #include "PlatformUpdater.h"
+#include "RequireHistory.h"
 #include "ServiceInstaller.h"
 
 using namespace std;
@@ -44,10 +44,20 @@ using namespace std::tr1;
 const char* RequireRequest::kPlatformDescriptionKey = 
     "RequireRequest::kPlatformDescriptionKey";
 
-const char* RequireRequest::kRequireStatementsKey = 
-    "RequireRequest::kRequireStatementsKey";
 
-const char* RequireRequest::kVersionSeparator = "/";
+// convert require statements to registry specs, so that the whole
+// list may be resolved with a single pass over installed services
+static vector<ServiceSpec>
+toSpecs(const list<ServiceRequireStatement>& requires)
+{
+    vector<ServiceSpec> specs;
+    list<ServiceRequireStatement>::const_iterator it;
+    for (it = requires.begin(); it != requires.end(); ++it) {
+        specs.push_back(ServiceSpec(it->m_name, it->m_version,
+                                    it->m_minversion));
+    }
+    return specs;
+}
 
 RequireRequest::RequireRequest(
     const list<ServiceRequireStatement>& requires,
@@ -94,47 +104,193 @@ RequireRequest::~RequireRequest()
 void
 RequireRequest::run()
 {
+    m_thisWeak = shared_from_this();
+
+    // nothing to prompt for or install, no need to wait behind
+    // requires that do
+    if (satisfiedWithoutLock()) {
+        BPLOG_DEBUG_STRM(this << " require, smm_tid = "
+                         << m_smmTid << " satisfied without lock");
+        postSatisfiedWithoutLock();
+        return;
+    }
+
     // will get RequireLock::LockAttainedEvent when it's our turn
     BPLOG_DEBUG_STRM(this << " require, smm_tid = " 
                      << m_smmTid << " asks for lock");
-    m_thisWeak = shared_from_this();
-    RequireLock::attainLock(m_thisWeak);
+    m_lockKeys = lockKeys();
+    RequireLock::attainLock(m_thisWeak, m_lockKeys);
+}
+
+
+void
+RequireRequest::postSatisfiedWithoutLock()
+{
+    // we need a thread hopper here to guarantee that completion is
+    // delivered after run() returns.  The session may release us
+    // before then, so only a weak pointer rides along.
+    static bool initialized = false;
+    static bp::thread::Hopper hopper;
+
+    if (!initialized) {
+        hopper.initializeOnCurrentThread();
+        initialized = true;
+    }
+    weak_ptr<RequireRequest> * copy = new weak_ptr<RequireRequest>(m_thisWeak);
+    hopper.invokeOnThread(completeWithoutLock, (void *) copy);
+}
+
+
+void
+RequireRequest::completeWithoutLock(void * context)
+{
+    weak_ptr<RequireRequest> * rWeak = (weak_ptr<RequireRequest> *) context;
+    BPASSERT(rWeak != NULL);
+    shared_ptr<RequireRequest> r = rWeak->lock();
+    delete rWeak;
+
+    // the session went away first, nobody left to tell
+    if (r == NULL) return;
+
+    if (!PermissionsManager::get()->isOSPlatformDeprecated()) {
+        RequireHistory::add(r->m_requires);
+    }
+    r->postSuccess();
 }
 
 
 bool
-RequireRequest::checkDomainPermission(const std::string& permission)
+RequireRequest::satisfiedWithoutLock()
+{
+    if (m_registry == NULL) return false;
+    if (domainPermission(PermissionsManager::kAllowDomain)
+        != PermissionsManager::eAllowed)
+    {
+        return false;
+    }
+
+    // everything installed and permitted, including providers
+    vector<bool> found;
+    vector<bp::service::Summary> summaries;
+    vector<bp::service::Description> descs;
+    m_registry->resolve(toSpecs(m_requires), found, summaries, descs);
+    list<bp::service::Summary> installed(summaries.begin(), summaries.end());
+
+    list<ServiceRequireStatement> providers;
+    for (size_t n = 0; n < found.size(); ++n) {
+        if (!found[n]) return false;
+        std::set<std::string> perms = summaries[n].permissions();
+        std::set<std::string>::const_iterator it;
+        for (it = perms.begin(); it != perms.end(); ++it) {
+            if (domainPermission(*it) != PermissionsManager::eAllowed) {
+                return false;
+            }
+        }
+        if (!summaries[n].usesService().empty()) {
+            ServiceRequireStatement rs = {
+                summaries[n].usesService(),
+                summaries[n].usesVersion().asString(),
+                summaries[n].usesMinversion().asString()
+            };
+            providers.push_back(rs);
+        }
+    }
+    if (!providers.empty()) {
+        vector<bool> providerFound;
+        vector<bp::service::Summary> providerSummaries;
+        m_registry->resolve(toSpecs(providers), providerFound,
+                            providerSummaries, descs);
+        for (size_t n = 0; n < providerFound.size(); ++n) {
+            if (!providerFound[n]) return false;
+        }
+        installed.insert(installed.end(), providerSummaries.begin(),
+                         providerSummaries.end());
+    }
+
+    // deprecated platforms are never offered updates
+    if (PermissionsManager::get()->isOSPlatformDeprecated()) return true;
+
+    // nor anything to update.  What we resolved is all that updates
+    // are weighed against.
+    checkPlatformUpdates();
+    if (!m_platformUpdates.empty()) return false;
+    return m_distQuery->haveUpdates(m_requires, installed).empty();
+}
+
+
+RequireLock::Keys
+RequireRequest::lockKeys()
+{
+    RequireLock::Keys keys;
+    shared_ptr<ActiveSession> asp = m_activeSession.lock();
+    if (asp == NULL) return keys;
+
+    keys.insert(RequireLock::domainKey(asp->domain()));
+    list<ServiceRequireStatement>::const_iterator it;
+    for (it = m_requires.begin(); it != m_requires.end(); ++it) {
+        keys.insert(RequireLock::serviceKey(it->m_name));
+    }
+
+    // providers of installed services may be installed along with them
+    if (m_registry != NULL) {
+        vector<bool> found;
+        vector<bp::service::Summary> summaries;
+        vector<bp::service::Description> descs;
+        m_registry->resolve(toSpecs(m_requires), found, summaries, descs);
+        for (size_t n = 0; n < found.size(); ++n) {
+            if (found[n] && !summaries[n].usesService().empty()) {
+                keys.insert(RequireLock::serviceKey(
+                                summaries[n].usesService()));
+            }
+        }
+    }
+
+    // as may the platform
+    checkPlatformUpdates();
+    if (!m_platformUpdates.empty()) {
+        keys.insert(RequireLock::platformKey());
+    }
+    return keys;
+}
+
+
+PermissionsManager::Permission
+RequireRequest::domainPermission(const std::string& permission)
 {
     shared_ptr<ActiveSession> asp = m_activeSession.lock();
 
     if (asp == NULL) {
-        return false;
+        return PermissionsManager::eNotAllowed;
     }
     
     // does domain/permission need approval?
     std::string domain = asp->domain();
     if (domain.compare("unknown") == 0) {
-        return false;
+        return PermissionsManager::eNotAllowed;
     }
     PermissionsManager* pmgr = PermissionsManager::get();
-    switch (pmgr->queryDomainPermission(domain, permission)) {
+    PermissionsManager::Permission perm =
+        pmgr->queryDomainPermission(domain, permission);
+    if (perm == PermissionsManager::eUnknown) {
+        perm = asp->transientPermission(permission);
+    }
+    return perm;
+}
+
+
+bool
+RequireRequest::checkDomainPermission(const std::string& permission)
+{
+    switch (domainPermission(permission)) {
         case PermissionsManager::eAllowed:
             // empty
             break;
         case PermissionsManager::eNotAllowed:
             return false;
-        case PermissionsManager::eUnknown:
-            switch (asp->transientPermission(permission)) {
-                case PermissionsManager::eAllowed:
-                    // empty
-                    break;
-                case PermissionsManager::eNotAllowed:
-                    return false;
-                case PermissionsManager::eUnknown:    
-                    // permission will be localized by promptUser()
-                    m_permissions.insert(permission);
-                    break;
-            }
+        case PermissionsManager::eUnknown:    
+            // permission will be localized by promptUser()
+            m_permissions.insert(permission);
+            break;
     }
     return true;
 }
@@ -206,6 +362,19 @@ RequireRequest::doRun()
     
     // platform updates
     checkPlatformUpdates();
+
+    // an update arrived after we asked for the lock, wait our turn
+    // behind anyone else who may prompt for or install it
+    if (!m_platformUpdates.empty()
+        && m_lockKeys.find(RequireLock::platformKey()) == m_lockKeys.end())
+    {
+        BPLOG_DEBUG_STRM(this << " require, smm_tid = " << m_smmTid
+                         << " asks again for lock, platform update pending");
+        RequireLock::releaseLock(m_thisWeak);
+        m_lockKeys = lockKeys();
+        RequireLock::attainLock(m_thisWeak, m_lockKeys);
+        return;
+    }
     vector<bp::SemanticVersion>::iterator ui = m_platformUpdates.begin();
     while (ui != m_platformUpdates.end()) {
         string version = ui->asString();
@@ -240,43 +409,60 @@ RequireRequest::doRun()
     list<ServiceRequireStatement>::const_iterator it;
 
     // First check installed services for missing needed provider services.
-    // If any providers are missing, add them to the request.
+    // If any providers are missing, add them to the request.  Each
+    // list is resolved against the registry in a single pass.
+    vector<bool> found;
+    vector<bp::service::Summary> summaries;
+    vector<bp::service::Description> descs;
+    m_registry->resolve(toSpecs(m_requires), found, summaries, descs);
+
+    list<ServiceRequireStatement> users;
+    list<ServiceRequireStatement> providers;
+    size_t n = 0;
+    for (it = m_requires.begin(); it != m_requires.end(); ++it, ++n) {
+        if (found[n] && !summaries[n].usesService().empty()) {
+            ServiceRequireStatement rs = {
+                summaries[n].usesService(),
+                summaries[n].usesVersion().asString(),
+                summaries[n].usesMinversion().asString()
+            };
+            users.push_back(*it);
+            providers.push_back(rs);
+        }
+    }
+
     list<ServiceRequireStatement> toAdd;
-    for (it = m_requires.begin(); it != m_requires.end(); ++it) {
-        bp::service::Summary summary;
-        if (m_registry->summary(it->m_name, it->m_version,
-                                it->m_minversion, summary)) {
-            string providerName = summary.usesService();
-            if (!providerName.empty()) {
-                string providerVersion = summary.usesVersion().asString();
-                string providerMinversion = summary.usesMinversion().asString();
-                ServiceRequireStatement rs = {providerName, providerVersion,
-                                              providerMinversion};
-                bp::service::Summary providerSummary;
-                if (!m_registry->summary(providerName, providerVersion,
-                                         providerMinversion, providerSummary)) {
-                    BPLOG_INFO_STRM(m_smmTid << (it->m_name) << " - "
-                                    << (it->m_version) << " - "
-                                    << (it->m_minversion)
-                                    << " is missing provider "
-                                    << providerName << " - "
-                                    << providerVersion << " - "
-                                    << providerMinversion
-                                    << ", adding to requirements");
-                    toAdd.push_back(rs);
-                }
-            }
+    if (!providers.empty()) {
+        vector<bool> providerFound;
+        vector<bp::service::Summary> providerSummaries;
+        m_registry->resolve(toSpecs(providers), providerFound,
+                            providerSummaries, descs);
+        list<ServiceRequireStatement>::const_iterator ui = users.begin();
+        n = 0;
+        for (it = providers.begin(); it != providers.end(); ++it, ++ui, ++n) {
+            if (providerFound[n]) continue;
+            BPLOG_INFO_STRM(m_smmTid << (ui->m_name) << " - "
+                            << (ui->m_version) << " - "
+                            << (ui->m_minversion)
+                            << " is missing provider "
+                            << it->m_name << " - "
+                            << it->m_version << " - "
+                            << it->m_minversion
+                            << ", adding to requirements");
+            toAdd.push_back(*it);
+        }
+        if (!toAdd.empty()) {
+            m_requires.splice(m_requires.end(), toAdd);
+            m_registry->resolve(toSpecs(m_requires), found, summaries, descs);
         }
     }
-    m_requires.splice(m_requires.end(), toAdd);
-        
+
     // now see if we can satisfy the request
-    for (it = m_requires.begin(); it != m_requires.end(); ++it) {
-        bp::service::Summary summary;
-        if (m_registry->summary(it->m_name, it->m_version,
-                                it->m_minversion, summary)) {
+    n = 0;
+    for (it = m_requires.begin(); it != m_requires.end(); ++it, ++n) {
+        if (found[n]) {
             // do we need permissions?
-            std::set<std::string> perms = summary.permissions();
+            std::set<std::string> perms = summaries[n].permissions();
             std::set<std::string>::const_iterator it;
             for (it = perms.begin(); it != perms.end(); ++it) {
                 if (!checkDomainPermission(*it)) {
@@ -332,7 +518,7 @@ RequireRequest::doRun()
         
         if (m_toInstall.empty()) {
             // no service updates, may have platform updates
-            updateRequireHistory(m_requires);
+            RequireHistory::add(m_requires);
             if (m_permissions.empty() && m_platformUpdates.empty()) {
                 // we're golden
                 postSuccess();
@@ -465,8 +651,8 @@ RequireRequest::checkPlatformUpdates()
 {
     // No updates for deprecated platforms.  Shouldn't be any since
     // daemon didn't start platformupdater singleton, but let's be paranoid.
+    m_platformUpdates.clear();
     if (PermissionsManager::get()->isOSPlatformDeprecated()) {
-        m_platformUpdates.clear();
         return;
     }
     
@@ -623,7 +809,7 @@ RequireRequest::installNextService()
         }
     } else {
         // whee!  we're done
-        updateRequireHistory(m_requires);
+        RequireHistory::add(m_requires);
         postSuccess();
     }
 }
@@ -850,48 +1036,6 @@ RequireRequest::gotServiceSynopsis(unsigned int tid,
 }
 
 
-void 
-RequireRequest::updateRequireHistory(
-    const std::list<ServiceRequireStatement> & requires)
-{
-    std::list<ServiceRequireStatement>::const_iterator it;
-    for (it = requires.begin(); it != requires.end(); ++it) {
-        string name(it->m_name);
-        string version(it->m_version);
-        string minversion(it->m_minversion);
-        
-        string mapStr;
-        bp::Map* m = NULL;
-        if (bp::phash::get(kRequireStatementsKey, mapStr)) {
-            m = dynamic_cast<bp::Map*>(bp::Object::fromPlainJsonString(mapStr));
-        }
-        if (!m) m = new bp::Map;
-        if (!m->has(name.c_str(), BPTList)) {
-            m->add(name, new bp::List);
-        }
-        const bp::List* l = dynamic_cast<const bp::List*>(m->get(name.c_str()));
-        string ourVersion = version + kVersionSeparator + minversion;
-        bool found = false;
-        for (unsigned int i = 0; i < l->size(); ++i) {
-            const bp::String* s = dynamic_cast<const bp::String*>(l->value(i));
-            if (!s) continue;
-            if (ourVersion.compare(s->value()) == 0) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            const_cast<bp::List*>(l)->append(new bp::String(ourVersion));
-            BPLOG_INFO_STRM("added to update require history: "
-                            << name << "(" << version 
-                            << "/" << minversion << ")");
-            bp::phash::set(kRequireStatementsKey, m->toPlainJsonString());
-        }
-        delete m;
-    }
-}
-
-
 void
 RequireRequest::promptUser()
 {
@@ -989,11 +1133,15 @@ void
 RequireRequest::postSuccess()
 {
     bp::List rlist;
+    vector<bool> found;
+    vector<bp::service::Summary> summaries;
+    vector<bp::service::Description> descs;
+    m_registry->resolve(toSpecs(m_requires), found, summaries, descs);
+
     list<ServiceRequireStatement>::const_iterator li;
-    for (li = m_requires.begin(); li != m_requires.end(); ++li) {
-        bp::service::Description desc;
-        if (!m_registry->describe(li->m_name, li->m_version,
-                                  li->m_minversion, desc))
+    size_t n = 0;
+    for (li = m_requires.begin(); li != m_requires.end(); ++li, ++n) {
+        if (!found[n])
         {
             // this should not happen
             BPLOG_ERROR_STRM(
@@ -1003,7 +1151,7 @@ RequireRequest::postSuccess()
             postFailure("core.serverError", "could not attain service");
             return;
         }
-        bp::Object* obj = desc.toBPObject();
+        bp::Object* obj = descs[n].toBPObject();
         rlist.append(obj);
     }
 
@@ -30,7 +30,9 @@
 #define __REQUIREREQUEST_H__
 
 #include "ServiceManager/ServiceManager.h"
+#include "BPUtils/bpthreadhopper.h"
 #include "DistributionClient/DistributionClient.h"
+#include "Permissions/Permissions.h"
 #include "RequireLock.h"
 #include "ServiceInstaller.h"
 
@@ -48,11 +50,6 @@ class RequireRequest : virtual public IDistQueryListener,
 public:
     // key into localized strings for platform description
     static const char* kPlatformDescriptionKey;
-    
-	// a key into the bp::phash for the require's that have been done
-	static const char* kRequireStatementsKey;
-    
-    static const char* kVersionSeparator;
 	
     RequireRequest(const std::list<ServiceRequireStatement>& requires,
                    BPCallBack progressCallback,
@@ -115,11 +112,23 @@ private:
     void doRun();
     void onUserResponse(unsigned int cookie, const bp::Object & resp);
 
+    // true if every required service is installed and permitted and
+    // there's nothing to update, in which case the require completes
+    // without taking the require lock
+    bool satisfiedWithoutLock();
+
+    // the domain, services and platform this require may prompt for
+    // or install
+    RequireLock::Keys lockKeys();
+
+    // completes a require satisfied without the lock, once run() has
+    // returned and only if we're still around
+    void postSatisfiedWithoutLock();
+    static void completeWithoutLock(void * context);
+
     void doNextRequire();    
     void installNextService();
     void checkPlatformUpdates();
-    void updateRequireHistory(
-        const std::list<ServiceRequireStatement> & requires);
     void promptUser();
     void postProgress(const std::string & name,
                       const std::string & version,
@@ -131,6 +140,8 @@ private:
     ServiceSynopsis getDescription(const std::string & name,
                                    const std::string & version);
     bool checkDomainPermission(const std::string& permission);
+    PermissionsManager::Permission
+        domainPermission(const std::string& permission);
     
     // Try to do a silent platform/service update.  Returns
     // true if silent update attempted.
@@ -151,6 +162,9 @@ private:
     ServiceSynopsisList m_descriptions;
     ServiceSynopsis m_currentInstall;
     
+    // what we asked the require lock for
+    RequireLock::Keys m_lockKeys;
+
     // any needed permissions
     std::set<std::string> m_permissions;
     
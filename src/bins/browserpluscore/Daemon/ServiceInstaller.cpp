@@ -24,6 +24,8 @@
 #include "BPUtils/bpfile.h"
 #include "BPUtils/BPLog.h"
 #include "BPUtils/OS.h"
+#include "platform_utils/bpconfig.h"
+#include "platform_utils/ProductPaths.h"
 #include "ServiceManager/ServiceManager.h"
 #include "DistributionClient/DistributionClient.h"
 #include "Permissions/Permissions.h"
@@ -46,11 +48,11 @@ public:
         unsigned int iid,
         weak_ptr<ServiceInstaller::IListener> listener);
     
-    // constructor for installing from bpkg buffer
+    // constructor for installing from a bpkg file
     SingleServiceInstaller(
         const std::string & name,
         const std::string & version,
-        const std::vector<unsigned char> & buffer,
+        const boost::filesystem::path & pkgFile,
         unsigned int iid,
         weak_ptr<ServiceInstaller::IListener> listener);
 
@@ -72,16 +74,25 @@ private:
                                      const std::string& msg);
     virtual void onDownloadProgress(unsigned int tid, unsigned int pct);
     virtual void onDownloadComplete(unsigned int tid,
-                                    const std::vector<unsigned char> & buf);
+                                    const DownloadedPackage & pkg);
+    virtual void onDeltaDownloadComplete(
+        unsigned int tid,
+        const DownloadedPackage & pkg);
 
     void progressUpdateToAllListeners(unsigned int progressPct);
     void postToAllListeners(bool success);
-    bool installService(const std::vector<unsigned char> buf);
+    // pkg is verified against its size and digest, if it has one
+    bool installService(const DownloadedPackage & pkg,
+                        const boost::filesystem::path & deltaBase =
+                            boost::filesystem::path());
+    void finishInstall(bool ok);
     void removeSelfFromQueue();
     std::list<weak_ptr<ServiceInstaller::IListener> > m_listeners;
     DistQuery * m_distQuery;
     unsigned int m_iid;
-    std::vector<unsigned char> m_pkgBuffer;
+    boost::filesystem::path m_pkgFile;
+    // installed version we requested a delta against, if any
+    boost::filesystem::path m_deltaBase;
 };
 
 typedef struct {
@@ -203,7 +214,7 @@ unsigned int
 ServiceInstaller::installService(
     const std::string & name,
     const std::string & version,
-    const std::vector<unsigned char> & buffer,
+    const boost::filesystem::path & pkgFile,
     weak_ptr<ServiceInstaller::IListener> listener)
 {
     if (!preflight(name, version)) {
@@ -214,7 +225,7 @@ ServiceInstaller::installService(
     unsigned int iid = s_context->m_currentTransaction++;
     shared_ptr<SingleServiceInstaller> installer(
         new SingleServiceInstaller(name, version,
-                                   buffer, iid, listener));
+                                   pkgFile, iid, listener));
     s_context->m_installQueue.push_back(installer);
         
     BPLOG_INFO_STRM("enqueued prefetched " << name
@@ -251,7 +262,7 @@ SingleServiceInstaller::SingleServiceInstaller(
     unsigned int iid,
     weak_ptr<ServiceInstaller::IListener> listener)
     : m_name(name), m_version(version), m_distQuery(NULL),
-      m_iid(0), m_pkgBuffer()
+      m_iid(0), m_pkgFile()
 {
     m_distQuery = new DistQuery(distroServers, PermissionsManager::get());
     m_distQuery->setListener(this);
@@ -263,11 +274,11 @@ SingleServiceInstaller::SingleServiceInstaller(
 SingleServiceInstaller::SingleServiceInstaller(
     const std::string & name,
     const std::string & version,
-    const std::vector<unsigned char> & buffer,
+    const boost::filesystem::path & pkgFile,
     unsigned int iid,
     weak_ptr<ServiceInstaller::IListener> listener)
     :  m_name(name), m_version(version), m_listeners(),
-       m_distQuery(NULL), m_iid(iid), m_pkgBuffer(buffer)
+       m_distQuery(NULL), m_iid(iid), m_pkgFile(pkgFile)
 {
     m_listeners.push_back(listener);
 }
@@ -311,7 +322,9 @@ SingleServiceInstaller::progressUpdateToAllListeners(unsigned int progressPct)
 }
 
 bool
-SingleServiceInstaller::installService(const std::vector<unsigned char> buf)
+SingleServiceInstaller::installService(
+    const DownloadedPackage & pkg,
+    const boost::filesystem::path & deltaBase)
 {
     // log timing output here
     bp::time::Stopwatch sw;
@@ -320,7 +333,19 @@ SingleServiceInstaller::installService(const std::vector<unsigned char> buf)
     BPLOG_INFO_STRM("("<< sw.elapsedSec() <<"s) Installing service");
 
     // unpack and install
-    ServiceUnpacker unpacker(buf);
+    ServiceUnpacker unpacker(pkg.m_path);
+    unpacker.setExpected(pkg.m_size, pkg.m_sha256);
+    if (!deltaBase.empty()) unpacker.setDeltaBase(deltaBase);
+
+    // sharing file contents between services is opt-in, it leaves
+    // the installed files read-only
+    bp::config::ConfigReader configReader;
+    bool dedup = false;
+    if (configReader.load(bp::paths::getConfigFilePath())
+        && configReader.getBooleanValue("DeduplicateServices", dedup))
+    {
+        unpacker.setDeduplicate(dedup);
+    }
     string errMsg;
     bool rval = unpacker.unpack(errMsg);
 
@@ -357,15 +382,46 @@ SingleServiceInstaller::onDownloadProgress(unsigned int, unsigned int pct)
 
 void
 SingleServiceInstaller::onDownloadComplete(unsigned int,
-                   const std::vector<unsigned char> & buf)
+                   const DownloadedPackage & pkg)
 {
     BPLOG_INFO_STRM("downloaded " << m_name
                     << " ver " << m_version
-                    << ", " << buf.size() << " bytes");
+                    << ", " << pkg.m_size << " bytes");
 
-    // now we've got a buffer with the zipfile, the service name and
+    // now we've got the package on disk, the service name and
     // and version, so we're ready to try to install!
-    bool ok = installService(buf);
+    finishInstall(installService(pkg));
+}
+
+void
+SingleServiceInstaller::onDeltaDownloadComplete(
+    unsigned int,
+    const DownloadedPackage & pkg)
+{
+    BPLOG_INFO_STRM("downloaded delta for " << m_name
+                    << " ver " << m_version << " from "
+                    << m_deltaBase << ", " << pkg.m_size << " bytes");
+
+    if (installService(pkg, m_deltaBase)) {
+        finishInstall(true);
+        return;
+    }
+
+    // the delta didn't apply (perhaps the installed base was
+    // modified), fetch the full package instead
+    BPLOG_WARN_STRM("delta install of " << m_name << " ver "
+                    << m_version << " failed, downloading full package");
+    m_deltaBase.clear();
+    if (!m_distQuery->downloadService(m_name, m_version,
+                                      bp::os::PlatformAsString()))
+    {
+        finishInstall(false);
+    }
+}
+
+void
+SingleServiceInstaller::finishInstall(bool ok)
+{
     // regardless of wether the service installed correctly, we'll force
     // a disk rescan
     if (s_context != NULL) {
@@ -394,27 +450,30 @@ SingleServiceInstaller::removeSelfFromQueue()
 void
 SingleServiceInstaller::start()
 {
-    if (!m_pkgBuffer.empty()) {
+    if (!m_pkgFile.empty()) {
         // serviceupdate has already downloaded, now "install"
-        bool ok = installService(m_pkgBuffer);
-        // regardless of wether the service installed correctly, we'll force
-        // a disk rescan
-        if (s_context != NULL) {
-            s_context->m_registry->forceRescan();
-        }
-        postToAllListeners(ok);
-        removeSelfFromQueue();
+        DownloadedPackage pkg;
+        pkg.m_path = m_pkgFile;
+        finishInstall(installService(pkg));
     } else {
         std::string platform = bp::os::PlatformAsString();
 
         BPLOG_INFO_STRM("now I should download and install "
                         << m_name << " - "
                         << m_version);
-        
+
+        // if an older version is installed, ask for a delta against it
+        m_deltaBase = ServiceUnpacker::deltaBase(m_name, m_version);
+        std::string deltaBaseVersion;
+        if (!m_deltaBase.empty()) {
+            deltaBaseVersion = m_deltaBase.filename().string();
+        }
+
         if (!m_distQuery->downloadService(
                 m_name,
                 m_version,
-                platform))
+                platform,
+                deltaBaseVersion))
         {
             postToAllListeners(false);
             removeSelfFromQueue();
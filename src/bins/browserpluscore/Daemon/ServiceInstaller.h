@@ -97,12 +97,13 @@ namespace ServiceInstaller
                                 std::tr1::weak_ptr<IListener> listener);
     
     /**
-     * Install a service from an bpkg buffer.  
+     * Install a service from a bpkg file.  
      * Service is installed into service cache.
      *
      * \param name - the name of the service
      * \param version - string representation of full service version
-     * \param buffer - bpkg buffer
+     * \param pkgFile - bpkg file, which must exist until the
+     *                  installation completes
      * \param listener - who to tell when the work is done
      *
      * \returns zero on failure, otherwise a transaction id that will be
@@ -112,7 +113,7 @@ namespace ServiceInstaller
      */
     unsigned int installService(const std::string & name,
                                 const std::string & version,
-                                const std::vector<unsigned char> & buffer,
+                                const boost::filesystem::path & pkgFile,
                                 std::tr1::weak_ptr<IListener> listener);
 
     /**
@@ -35,7 +35,7 @@
 #include "DistributionClient/DistributionClient.h"
 #include "Permissions/Permissions.h"
 #include "platform_utils/bpphash.h"
-#include "RequireRequest.h"
+#include "RequireHistory.h"
 
 using namespace std;
 using namespace std::tr1;
@@ -186,30 +186,7 @@ UpdaterSingleton::start()
             m_registry->availableServiceSummaries();
         
         // now get our previous require statements
-        list<ServiceRequireStatement> reqStmts;
-        using namespace bp;
-        string requireMapStr;
-        (void)bp::phash::get(RequireRequest::kRequireStatementsKey, requireMapStr);
-        Map* m = dynamic_cast<Map*>(Object::fromPlainJsonString(requireMapStr));
-        if (m == NULL) m = new Map;
-        Map::Iterator miter(*m);
-        const char* key = NULL;
-        while ((key = miter.nextKey()) != NULL) {
-            const List* l = dynamic_cast<const List*>(m->get(key));
-            if (!l) continue;
-            for (unsigned int i = 0; i < l->size(); ++i) {
-                const String* s = dynamic_cast<const String*>(l->value(i));
-                if (!s) continue;
-                vector<string> tokens = bp::strutil::split(
-                    s->value(), RequireRequest::kVersionSeparator);
-                if (tokens.size() != 2) continue;
-                ServiceRequireStatement req;
-                req.m_name = key;
-                req.m_version = tokens[0];
-                req.m_minversion = tokens[1];
-                reqStmts.push_back(req);
-            }
-        }
+        list<ServiceRequireStatement> reqStmts = RequireHistory::statements();
         
         // pass off to DistQuery to update
         m_tid = m_distQuery->updateCache(m_platform, reqStmts, installed);
@@ -250,7 +227,7 @@ UpdaterSingleton::onTransactionFailed(unsigned int,
                                       const std::string& msg)
 {
     BPLOG_WARN_STRM("update failed: " << msg << ", purging require history.");
-    bp::phash::set(RequireRequest::kRequireStatementsKey, std::string());
+    RequireHistory::clear();
     m_tid = 0;
 }
 
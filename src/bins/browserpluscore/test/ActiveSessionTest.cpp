@@ -0,0 +1,214 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ActiveSessionTest.cpp
+ * A client connects to a session over IPC and fires off several
+ * invokes from a domain it has no permission for.  The first is
+ * queued behind a prompt and the rest behind it, and the one answer
+ * releases them all.
+ */
+
+#include "ActiveSessionTest.h"
+#include "DaemonTestUtils.h"
+#include "RequireLock.h"
+#include "bpipc/IPCChannelServer.h"
+#include "BPUtils/bpuuid.h"
+#include "platform_utils/ProductPaths.h"
+
+namespace bfs = boost::filesystem;
+using namespace std::tr1;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ActiveSessionTest);
+
+static const char * kQueuedURI = "http://queued.example.com/";
+
+// hands each channel to a session of its own, as SessionManager does
+class SessionServer : public bp::ipc::IChannelServerListener
+{
+  public:
+    SessionServer(TestRunLoop * rl, const std::string & uri)
+        : m_rl(rl), m_uri(uri)
+    {
+        if (!bp::uuid::generate(m_location)) {
+            BP_THROW_FATAL("couldn't generate UUID");
+        }
+        m_server.setListener(this);
+        std::string err;
+        if (!m_server.start(m_location, &err)) {
+            BP_THROW_FATAL("couldn't start server: " + err);
+        }
+    }
+
+    ~SessionServer()
+    {
+        session.reset();
+        m_server.stop();
+    }
+
+    std::string location() { return m_location; }
+
+    shared_ptr<ActiveSession> session;
+
+  private:
+    void gotChannel(bp::ipc::Channel * c)
+    {
+        session.reset(new TestSession(builtInRegistry(), m_uri, c));
+        c->setListener(session.get());
+        m_rl->stop();
+    }
+
+    TestRunLoop * m_rl;
+    std::string m_uri;
+    bp::ipc::ChannelServer m_server;
+    std::string m_location;
+};
+
+// answers every prompt the same way, and records the responses to its
+// queries in the order they arrive
+class PromptAnswerer : public bp::ipc::IChannelListener
+{
+  public:
+    PromptAnswerer(TestRunLoop * rl, const std::string & answer,
+                   unsigned int expected)
+        : prompts(0), m_rl(rl), m_answer(answer), m_expected(expected) { }
+
+    unsigned int prompts;
+
+    // id and error of each response
+    std::vector<std::pair<unsigned int, std::string> > responses;
+
+  private:
+    void channelEnded(bp::ipc::Channel *,
+                      bp::ipc::IConnectionListener::TerminationReason,
+                      const char *)
+    {
+        m_rl->stop();
+    }
+
+    void onMessage(bp::ipc::Channel *, const bp::ipc::Message &) { }
+
+    bool onQuery(bp::ipc::Channel *, const bp::ipc::Query & query,
+                 bp::ipc::Response & response)
+    {
+        if (query.command().compare("PromptUser")) return false;
+        prompts++;
+        response.setPayload(bp::String(m_answer));
+        return true;
+    }
+
+    void onResponse(bp::ipc::Channel *, const bp::ipc::Response & r)
+    {
+        std::string error;
+        if (r.payload() && r.payload()->has("error", BPTString)) {
+            error = (std::string) *(r.payload()->get("error"));
+        }
+        responses.push_back(std::make_pair(r.responseTo(), error));
+        if (responses.size() >= m_expected) m_rl->stop();
+    }
+
+    TestRunLoop * m_rl;
+    std::string m_answer;
+    unsigned int m_expected;
+};
+
+void
+ActiveSessionTest::invokeBehindPrompt(const std::string & uri,
+                                      unsigned int n,
+                                      const std::string & answer,
+                                      const std::string & error)
+{
+    TestRunLoop rl;
+    SessionServer server(&rl, uri);
+    PromptAnswerer client(&rl, answer, n);
+    {
+        bp::ipc::Channel c;
+        c.setListener(&client);
+        CPPUNIT_ASSERT(c.connect(server.location()));
+
+        // the session must be listening before we talk to it
+        rl.runFor(5000);
+        CPPUNIT_ASSERT(server.session != NULL);
+
+        // all are sent before the client can see, let alone answer,
+        // the prompt, so all are queued behind it
+        std::vector<unsigned int> ids;
+        for (unsigned int i = 0; i < n; i++) {
+            bp::ipc::Query q;
+            q.setCommand("Invoke");
+            bp::Map m;
+            m.add("service", new bp::String(builtInServiceName()));
+            m.add("version", new bp::String(builtInServiceVersion()));
+            m.add("function", new bp::String("NoSuchFunction"));
+            q.setPayload(m);
+            CPPUNIT_ASSERT(c.sendQuery(q));
+            ids.push_back(q.id());
+        }
+
+        rl.runFor(5000);
+
+        CPPUNIT_ASSERT_EQUAL(1u, client.prompts);
+        CPPUNIT_ASSERT_EQUAL((size_t) n, client.responses.size());
+        for (unsigned int i = 0; i < n; i++) {
+            CPPUNIT_ASSERT_EQUAL(ids[i], client.responses[i].first);
+            CPPUNIT_ASSERT_EQUAL(error, client.responses[i].second);
+        }
+    }
+}
+
+void
+ActiveSessionTest::queuedReleasedOnAllow()
+{
+    // once allowed, each invoke runs, and fails on its own merits
+    invokeBehindPrompt(kQueuedURI, 5, "Allow", "BP.noSuchFunction");
+}
+
+void
+ActiveSessionTest::queuedReleasedOnDeny()
+{
+    invokeBehindPrompt(kQueuedURI, 5, "Deny", "BP.permissionsError");
+}
+
+void
+ActiveSessionTest::answerNotSaved()
+{
+    // permissions are never read back for pages under the product
+    // directory, so "always" saves an answer which doesn't stick.  the
+    // session must still apply it, once, to everything queued.
+    std::string uri = "file://"
+        + (bp::paths::getProductTopDirectory() / "page.html").generic_string();
+    invokeBehindPrompt(uri, 5, "AlwaysAllow", "BP.noSuchFunction");
+}
+
+void 
+ActiveSessionTest::setUp()
+{
+    m_path = useTemporaryProductDirectory();
+    RequireLock::initialize();
+}
+
+void 
+ActiveSessionTest::tearDown()
+{
+    RequireLock::shutdown();
+    CPPUNIT_ASSERT(bp::file::safeRemove(m_path));
+}
@@ -0,0 +1,60 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ActiveSessionTest.h
+ * Messages queued behind a permission prompt.
+ */
+
+#ifndef __ACTIVESESSIONTEST_H__
+#define __ACTIVESESSIONTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+#include "BPUtils/bpfile.h"
+
+class ActiveSessionTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(ActiveSessionTest);
+    CPPUNIT_TEST(queuedReleasedOnAllow);
+    CPPUNIT_TEST(queuedReleasedOnDeny);
+    CPPUNIT_TEST(answerNotSaved);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+  protected:
+    void queuedReleasedOnAllow();
+    void queuedReleasedOnDeny();
+    void answerNotSaved();
+
+    // invoke n times from a client at uri which answers the one prompt
+    // it expects with answer, checking every invoke is answered in
+    // order with error
+    void invokeBehindPrompt(const std::string & uri, unsigned int n,
+                            const std::string & answer,
+                            const std::string & error);
+    boost::filesystem::path m_path;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DaemonTestUtils.cpp
+ */
+
+#include "DaemonTestUtils.h"
+#include <stdlib.h>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstrutil.h"
+#include "InactiveServicesService.h"
+#include "InactiveServicesServiceFactory.h"
+#include "platform_utils/ProductPaths.h"
+
+namespace bfs = boost::filesystem;
+using namespace std::tr1;
+
+
+TestRunLoop::TestRunLoop()
+{
+    m_rl.init();
+}
+
+TestRunLoop::~TestRunLoop()
+{
+    m_rl.shutdown();
+}
+
+void
+TestRunLoop::runFor(unsigned int msec)
+{
+    bp::time::Timer t;
+    t.setListener(this);
+    t.setMsec(msec);
+    m_rl.run();
+    t.cancel();
+}
+
+void
+TestRunLoop::stop()
+{
+    m_rl.stop();
+}
+
+void
+TestRunLoop::timesUp(bp::time::Timer *)
+{
+    m_rl.stop();
+}
+
+
+bfs::path
+useTemporaryProductDirectory()
+{
+    bfs::path home = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                           "BrowserPlusCoreTest");
+    bfs::create_directories(home);
+
+    // the tests get a product directory of their own which never
+    // talks to the distribution server
+#ifdef WIN32
+    _putenv_s(bp::paths::kProductDirectoryEnvVar, home.string().c_str());
+#else
+    setenv(bp::paths::kProductDirectoryEnvVar, home.string().c_str(), 1);
+#endif
+    bp::paths::createDirectories();
+    (void) bp::strutil::storeToFile(
+        bp::paths::getConfigFilePath(),
+        "{ \"DistServer\": \"http://127.0.0.1:1\" }");
+    return home;
+}
+
+
+shared_ptr<ServiceRegistry>
+builtInRegistry()
+{
+    shared_ptr<ServiceRegistry> registry(
+        new ServiceRegistry("info", bfs::path()));
+    registry->registerService(
+        *InactiveServicesService::getDescription(),
+        shared_ptr<InactiveServicesServiceFactory>(
+            new InactiveServicesServiceFactory()));
+    return registry;
+}
+
+std::string
+builtInServiceName()
+{
+    return InactiveServicesService::getDescription()->name();
+}
+
+std::string
+builtInServiceVersion()
+{
+    return InactiveServicesService::getDescription()->versionString();
+}
+
+
+TestSession::TestSession(shared_ptr<ServiceRegistry> registry,
+                         const std::string & uri,
+                         bp::ipc::Channel * channel)
+    : ActiveSession(channel, registry, "http://127.0.0.1:1",
+                    std::list<std::string>()),
+      m_uri(uri)
+{
+}
@@ -0,0 +1,85 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DaemonTestUtils.h
+ * What the daemon's tests share: a runloop to deliver hops and
+ * timers on, a product directory of their own, and a session which
+ * needn't be created by a client.
+ */
+
+#ifndef __DAEMONTESTUTILS_H__
+#define __DAEMONTESTUTILS_H__
+
+#include <string>
+#include "ActiveSession.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bptimer.h"
+
+
+// the main thread's runloop, run for a while at a time
+class TestRunLoop : public bp::time::ITimerListener
+{
+  public:
+    TestRunLoop();
+    ~TestRunLoop();
+
+    // run for at most msec, or until stop()
+    void runFor(unsigned int msec);
+    void stop();
+
+  private:
+    void timesUp(bp::time::Timer *);
+    bp::runloop::RunLoop m_rl;
+};
+
+
+// point the product directory (through kProductDirectoryEnvVar) at a fresh
+// temporary one, configured against a distribution server that's
+// never reached.  Returns a directory for the caller to remove.
+boost::filesystem::path useTemporaryProductDirectory();
+
+
+// a registry holding only the built in InactiveServices service
+std::tr1::shared_ptr<ServiceRegistry> builtInRegistry();
+
+// the name and version of the service builtInRegistry() holds
+std::string builtInServiceName();
+std::string builtInServiceVersion();
+
+
+// an ActiveSession on behalf of uri which needn't be created by its
+// client.  Without a channel, there's no client behind it at all.
+class TestSession : public ActiveSession
+{
+  public:
+    TestSession(std::tr1::shared_ptr<ServiceRegistry> registry,
+                const std::string & uri,
+                bp::ipc::Channel * channel = NULL);
+
+    std::string URI() { return m_uri; }
+
+  private:
+    std::string m_uri;
+};
+
+#endif
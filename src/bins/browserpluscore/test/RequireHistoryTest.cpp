@@ -0,0 +1,112 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireHistoryTest.cpp
+ */
+
+#include "RequireHistoryTest.h"
+#include "DaemonTestUtils.h"
+#include "RequireHistory.h"
+#include "platform_utils/bpphash.h"
+#include "platform_utils/ProductPaths.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RequireHistoryTest);
+
+static ServiceRequireStatement
+statement(const char * name, const char * version, const char * minversion)
+{
+    ServiceRequireStatement rs = { name, version, minversion };
+    return rs;
+}
+
+static bool
+hasStatement(const list<ServiceRequireStatement> & l,
+             const ServiceRequireStatement & rs)
+{
+    list<ServiceRequireStatement>::const_iterator it;
+    for (it = l.begin(); it != l.end(); ++it) {
+        if (it->m_name == rs.m_name && it->m_version == rs.m_version
+            && it->m_minversion == rs.m_minversion) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+RequireHistoryTest::addAndClear()
+{
+    list<ServiceRequireStatement> requires;
+    requires.push_back(statement("TextToSpeech", "1", ""));
+    requires.push_back(statement("TextToSpeech", "", "1.2.0"));
+    requires.push_back(statement("FileAccess", "2.0.1", ""));
+    RequireHistory::add(requires);
+
+    // a statement already recorded writes nothing
+    boost::uintmax_t size =
+        bp::file::size(bp::paths::getRequireHistoryPath());
+    RequireHistory::add(requires);
+    CPPUNIT_ASSERT_EQUAL(size, bp::file::size(
+                             bp::paths::getRequireHistoryPath()));
+
+    list<ServiceRequireStatement> seen = RequireHistory::statements();
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, seen.size());
+    list<ServiceRequireStatement>::const_iterator it;
+    for (it = requires.begin(); it != requires.end(); ++it) {
+        CPPUNIT_ASSERT(hasStatement(seen, *it));
+    }
+
+    RequireHistory::clear();
+    CPPUNIT_ASSERT(RequireHistory::statements().empty());
+}
+
+void
+RequireHistoryTest::importsLegacy()
+{
+    // as earlier versions kept it, a single JSON map in bp::phash
+    std::string key("RequireRequest::kRequireStatementsKey");
+    CPPUNIT_ASSERT(bp::phash::set(
+                       key, "{\"FileAccess\": [\"2/\", \"/2.0.1\"]}"));
+
+    list<ServiceRequireStatement> seen = RequireHistory::statements();
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, seen.size());
+    CPPUNIT_ASSERT(hasStatement(seen, statement("FileAccess", "2", "")));
+    CPPUNIT_ASSERT(hasStatement(seen, statement("FileAccess", "", "2.0.1")));
+
+    std::string val;
+    CPPUNIT_ASSERT(!bp::phash::get(key, val));
+}
+
+void 
+RequireHistoryTest::setUp()
+{
+    m_path = useTemporaryProductDirectory();
+}
+
+void 
+RequireHistoryTest::tearDown()
+{
+    CPPUNIT_ASSERT(bp::file::safeRemove(m_path));
+}
@@ -0,0 +1,205 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireLockTest.cpp
+ */
+
+#include "RequireLockTest.h"
+#include <vector>
+#include "DaemonTestUtils.h"
+#include "RequireLock.h"
+
+using namespace std::tr1;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RequireLockTest);
+
+// records the order in which listeners get the lock
+class OrderListener : public RequireLock::ILockListener
+{
+  public:
+    OrderListener(int id, std::vector<int> * granted)
+        : m_id(id), m_granted(granted) { }
+
+    void gotRequireLock() { m_granted->push_back(m_id); }
+
+  private:
+    int m_id;
+    std::vector<int> * m_granted;
+};
+
+static RequireLock::Keys
+keys(const std::string & a, const std::string & b = std::string())
+{
+    RequireLock::Keys k;
+    if (!a.empty()) k.insert(a);
+    if (!b.empty()) k.insert(b);
+    return k;
+}
+
+void
+RequireLockTest::disjointKeysShareLock()
+{
+    TestRunLoop rl;
+    std::vector<int> granted;
+    shared_ptr<OrderListener> a(new OrderListener(1, &granted));
+    shared_ptr<OrderListener> b(new OrderListener(2, &granted));
+
+    RequireLock::attainLock(a, keys(RequireLock::domainKey("a.com"),
+                                    RequireLock::serviceKey("A")));
+    RequireLock::attainLock(b, keys(RequireLock::domainKey("b.com"),
+                                    RequireLock::serviceKey("B")));
+
+    // granted only after attainLock returns
+    CPPUNIT_ASSERT(granted.empty());
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, granted.size());
+    CPPUNIT_ASSERT_EQUAL(1, granted[0]);
+    CPPUNIT_ASSERT_EQUAL(2, granted[1]);
+
+    RequireLock::releaseLock(a);
+    RequireLock::releaseLock(b);
+}
+
+void
+RequireLockTest::sharedKeyWaitsInOrder()
+{
+    TestRunLoop rl;
+    std::vector<int> granted;
+    shared_ptr<OrderListener> a(new OrderListener(1, &granted));
+    shared_ptr<OrderListener> b(new OrderListener(2, &granted));
+    shared_ptr<OrderListener> c(new OrderListener(3, &granted));
+
+    RequireLock::attainLock(a, keys(RequireLock::serviceKey("A")));
+    RequireLock::attainLock(b, keys(RequireLock::domainKey("b.com"),
+                                    RequireLock::serviceKey("A")));
+    RequireLock::attainLock(c, keys(RequireLock::domainKey("c.com"),
+                                    RequireLock::serviceKey("A")));
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, granted.size());
+
+    RequireLock::releaseLock(a);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, granted.size());
+
+    RequireLock::releaseLock(b);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, granted.size());
+    CPPUNIT_ASSERT_EQUAL(1, granted[0]);
+    CPPUNIT_ASSERT_EQUAL(2, granted[1]);
+    CPPUNIT_ASSERT_EQUAL(3, granted[2]);
+
+    RequireLock::releaseLock(c);
+}
+
+void
+RequireLockTest::platformKeyExcludes()
+{
+    TestRunLoop rl;
+    std::vector<int> granted;
+    shared_ptr<OrderListener> a(new OrderListener(1, &granted));
+    shared_ptr<OrderListener> b(new OrderListener(2, &granted));
+
+    // different domains and services, but both would offer the
+    // same platform update
+    RequireLock::attainLock(a, keys(RequireLock::domainKey("a.com"),
+                                    RequireLock::platformKey()));
+    RequireLock::attainLock(b, keys(RequireLock::domainKey("b.com"),
+                                    RequireLock::platformKey()));
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, granted.size());
+    CPPUNIT_ASSERT_EQUAL(1, granted[0]);
+
+    RequireLock::releaseLock(a);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, granted.size());
+    CPPUNIT_ASSERT_EQUAL(2, granted[1]);
+
+    RequireLock::releaseLock(b);
+}
+
+void
+RequireLockTest::emptyKeysExcludeAll()
+{
+    TestRunLoop rl;
+    std::vector<int> granted;
+    shared_ptr<OrderListener> a(new OrderListener(1, &granted));
+    shared_ptr<OrderListener> b(new OrderListener(2, &granted));
+    shared_ptr<OrderListener> c(new OrderListener(3, &granted));
+
+    RequireLock::attainLock(a, keys(RequireLock::domainKey("a.com")));
+    RequireLock::attainLock(b);
+    RequireLock::attainLock(c, keys(RequireLock::domainKey("c.com")));
+    rl.runFor(100);
+
+    // c shares nothing with a, but may not pass b
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, granted.size());
+
+    RequireLock::releaseLock(a);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, granted.size());
+    CPPUNIT_ASSERT_EQUAL(2, granted[1]);
+
+    RequireLock::releaseLock(b);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, granted.size());
+    CPPUNIT_ASSERT_EQUAL(3, granted[2]);
+
+    RequireLock::releaseLock(c);
+}
+
+void
+RequireLockTest::goneWaiterSkipped()
+{
+    TestRunLoop rl;
+    std::vector<int> granted;
+    shared_ptr<OrderListener> a(new OrderListener(1, &granted));
+    shared_ptr<OrderListener> b(new OrderListener(2, &granted));
+    shared_ptr<OrderListener> c(new OrderListener(3, &granted));
+
+    RequireLock::attainLock(a, keys(RequireLock::serviceKey("A")));
+    RequireLock::attainLock(b, keys(RequireLock::serviceKey("A")));
+    RequireLock::attainLock(c, keys(RequireLock::serviceKey("A")));
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, granted.size());
+
+    // b goes away while waiting, c mustn't wait on it
+    b.reset();
+    RequireLock::releaseLock(a);
+    rl.runFor(100);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, granted.size());
+    CPPUNIT_ASSERT_EQUAL(3, granted[1]);
+
+    RequireLock::releaseLock(c);
+}
+
+void 
+RequireLockTest::setUp()
+{
+    RequireLock::initialize();
+}
+
+void 
+RequireLockTest::tearDown()
+{
+    RequireLock::shutdown();
+}
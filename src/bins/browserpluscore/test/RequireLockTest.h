@@ -0,0 +1,56 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireLockTest.h
+ * Which keyed requests for the require lock exclude one another, and
+ * in what order the lock is granted.
+ */
+
+#ifndef __REQUIRELOCKTEST_H__
+#define __REQUIRELOCKTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+
+class RequireLockTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(RequireLockTest);
+    CPPUNIT_TEST(disjointKeysShareLock);
+    CPPUNIT_TEST(sharedKeyWaitsInOrder);
+    CPPUNIT_TEST(platformKeyExcludes);
+    CPPUNIT_TEST(emptyKeysExcludeAll);
+    CPPUNIT_TEST(goneWaiterSkipped);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+  protected:
+    void disjointKeysShareLock();
+    void sharedKeyWaitsInOrder();
+    void platformKeyExcludes();
+    void emptyKeysExcludeAll();
+    void goneWaiterSkipped();
+};
+
+#endif
@@ -0,0 +1,166 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RequireRequestTest.cpp
+ * A built in service, installed and needing no permissions, is
+ * required by a session whose domain is allowed.  Such a require
+ * never prompts nor installs, so it completes without the lock.
+ */
+
+#include "RequireRequestTest.h"
+#include "DaemonTestUtils.h"
+#include "RequireLock.h"
+#include "RequireRequest.h"
+
+namespace bfs = boost::filesystem;
+using namespace std::tr1;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RequireRequestTest);
+
+// counts how requires end, stopping the runloop when one does
+class EndListener : public RequireRequest::IRequireListener
+{
+  public:
+    EndListener(TestRunLoop * rl)
+        : completed(0), failed(0), m_rl(rl) { }
+
+    int completed;
+    int failed;
+
+  private:
+    void onComplete(unsigned int, const bp::List &) {
+        completed++;
+        m_rl->stop();
+    }
+    void onFailure(unsigned int, const std::string &, const std::string &) {
+        failed++;
+        m_rl->stop();
+    }
+
+    TestRunLoop * m_rl;
+};
+
+// holds the lock exclusively once granted it
+class HoldingListener : public RequireLock::ILockListener
+{
+  public:
+    HoldingListener() : granted(false) { }
+    void gotRequireLock() { granted = true; }
+    bool granted;
+};
+
+static shared_ptr<ActiveSession>
+allowedSession()
+{
+    shared_ptr<ActiveSession> s(
+        new TestSession(builtInRegistry(), "http://example.com/"));
+    s->setTransientPermission(PermissionsManager::kAllowDomain, true);
+    return s;
+}
+
+static shared_ptr<RequireRequest>
+requireBuiltIn(shared_ptr<ActiveSession> session)
+{
+    ServiceRequireStatement rs = {
+        builtInServiceName(), builtInServiceVersion(), std::string()
+    };
+    std::list<ServiceRequireStatement> requires;
+    requires.push_back(rs);
+    return shared_ptr<RequireRequest>(
+        new RequireRequest(requires, 0, session, 1, "http://127.0.0.1:1",
+                           std::list<std::string>()));
+}
+
+void
+RequireRequestTest::satisfiedAfterRun()
+{
+    TestRunLoop rl;
+    shared_ptr<EndListener> l(new EndListener(&rl));
+    shared_ptr<ActiveSession> session = allowedSession();
+    shared_ptr<RequireRequest> rr = requireBuiltIn(session);
+    rr->setListener(l);
+
+    rr->run();
+
+    // completion is delivered after run() returns
+    CPPUNIT_ASSERT_EQUAL(0, l->completed);
+    rl.runFor(5000);
+    CPPUNIT_ASSERT_EQUAL(1, l->completed);
+    CPPUNIT_ASSERT_EQUAL(0, l->failed);
+}
+
+void
+RequireRequestTest::satisfiedLeavesLockFree()
+{
+    TestRunLoop rl;
+    shared_ptr<EndListener> l(new EndListener(&rl));
+    shared_ptr<ActiveSession> session = allowedSession();
+
+    // someone holds the whole lock, which a require that takes it
+    // would wait behind
+    shared_ptr<HoldingListener> holder(new HoldingListener);
+    RequireLock::attainLock(holder);
+    rl.runFor(100);
+    CPPUNIT_ASSERT(holder->granted);
+
+    shared_ptr<RequireRequest> rr = requireBuiltIn(session);
+    rr->setListener(l);
+    rr->run();
+    rl.runFor(5000);
+    CPPUNIT_ASSERT_EQUAL(1, l->completed);
+
+    RequireLock::releaseLock(holder);
+}
+
+void
+RequireRequestTest::releasedBeforeSatisfied()
+{
+    TestRunLoop rl;
+    shared_ptr<EndListener> l(new EndListener(&rl));
+    shared_ptr<ActiveSession> session = allowedSession();
+    shared_ptr<RequireRequest> rr = requireBuiltIn(session);
+    rr->setListener(l);
+
+    // the session lets go of the require, as when it ends, before
+    // completion is delivered
+    rr->run();
+    rr.reset();
+
+    rl.runFor(200);
+    CPPUNIT_ASSERT_EQUAL(0, l->completed);
+    CPPUNIT_ASSERT_EQUAL(0, l->failed);
+}
+
+void 
+RequireRequestTest::setUp()
+{
+    m_path = useTemporaryProductDirectory();
+    RequireLock::initialize();
+}
+
+void 
+RequireRequestTest::tearDown()
+{
+    RequireLock::shutdown();
+    CPPUNIT_ASSERT(bp::file::safeRemove(m_path));
+}
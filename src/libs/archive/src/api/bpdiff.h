@@ -0,0 +1,54 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpdiff.h - a simple binary differencing scheme used to build
+ *            delta packages.  A patch is a sequence of copy (from the
+ *            old data) and insert (literal) operations.  Patches are
+ *            not compressed, as they're always carried inside an LZMA
+ *            compressed bpkg.
+ */
+
+#ifndef __BPDIFF_H__
+#define __BPDIFF_H__
+
+#include <string>
+
+namespace bp { namespace diff {
+
+// Compute a patch which transforms oldData into newData.
+// returns false on failure.
+bool makePatch(const std::string& oldData,
+               const std::string& newData,
+               std::string& patch);
+
+// Apply a patch generated by makePatch() to oldData.  The patch
+// records the size of the data it was generated against, and
+// application fails if oldData doesn't match it or if the patch
+// is malformed.
+bool applyPatch(const std::string& oldData,
+                const std::string& patch,
+                std::string& newData);
+
+}; };
+
+#endif
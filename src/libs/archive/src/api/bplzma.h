@@ -24,6 +24,12 @@
  * bplzma.h - an abstraction around public domain licensed LZMA
  *            compression and decompression using the easylzma library.
  *
+ * In addition to plain LZIP and LZMA streams, a BLOCKS container is
+ * supported which splits input into independently compressed LZIP
+ * blocks.  Blocks are compressed and decompressed on several threads.
+ * Decompress::run(LZIP) recognizes a BLOCKS container and handles it
+ * transparently.
+ *
  * TODO:
  *   * progress callback during compression (maybe decompression too)
  */
@@ -39,9 +45,17 @@
 namespace bp { namespace lzma {
 
 typedef enum {
-    LZMA, LZIP
+    LZMA, LZIP, BLOCKS
 } Format;
 
+/** default uncompressed size of a block in the BLOCKS format */
+const unsigned int kDefaultBlockSize = 2 * 1024 * 1024;
+
+/** largest block size either side of the BLOCKS format accepts.  the
+ *  block size read from a container decides how much is allocated
+ *  per block, so it is never trusted beyond this */
+const unsigned int kMaxBlockSize = 64 * 1024 * 1024;
+
 /**
  * a common base class that encapsulates reading and writing to std streams
  */
@@ -54,9 +68,20 @@ class IO
     void setInputStream(std::istream & inputStream);
     void setOutputStream(std::ostream & outputStream);
 
+    /** number of threads used for the BLOCKS format, 0 (the default)
+     *  means one per processor */
+    void setThreads(unsigned int threads);
+
   protected:
     std::istream * m_inputStream;
     std::ostream * m_outputStream;
+    unsigned int m_threads;
+
+    // number of worker threads to actually use
+    unsigned int threadCount() const;
+
+    // leading bytes of a BLOCKS container
+    static const char * blocksMagic();
 
     // callbacks required by easylzma
     static size_t outputCallback(void *ctx, const void *buf, size_t size);
@@ -70,6 +95,9 @@ class Decompress : public IO
     ~Decompress();    
     
     bool run(Format format = LZIP);
+
+  private:
+    bool runBlocks();
 };
 
 class Compress : public IO
@@ -79,6 +107,14 @@ class Compress : public IO
     ~Compress();    
     
     bool run(Format format = LZIP);    
+
+    /** uncompressed size of each block in the BLOCKS format */
+    void setBlockSize(unsigned int blockSize);
+
+  private:
+    unsigned int m_blockSize;
+
+    bool runBlocks();
 };
 
 }; };
@@ -45,8 +45,19 @@ namespace bp { namespace pkg {
         // get the single file content name
         boost::filesystem::path contentsDataPath();
         
+        // get the delta content tarball name
+        boost::filesystem::path deltaContentsPath();
+
         // get the signature file name
         boost::filesystem::path signaturePath();
+
+        // Packages larger than one compression block may be written
+        // as a bp::lzma BLOCKS container, which packs and unpacks on
+        // all processors but can't be read by clients that predate
+        // it.  Off by default, turn it on only once the clients a
+        // package is meant for can read it.
+        void setBlockCompression(bool enabled);
+        bool blockCompression();
         
         // Given a directory as input (inDir) and a path to write a file
         // to, create a browserplus package.
@@ -114,6 +125,43 @@ namespace bp { namespace pkg {
                             std::string& oError,
                             const boost::filesystem::path& certPath = boost::filesystem::path());
 
+        // Given a directory holding a base version of a service
+        // (baseDir) and a directory holding a newer version (inDir),
+        // create a signed delta package which transforms the former
+        // into the latter.  Unchanged files are referenced from the
+        // base, modified files are carried as binary patches, and
+        // new files are carried whole.  baseVersion is recorded in
+        // the package so clients can tell what it applies against.
+        bool packDelta(const boost::filesystem::path& keyFile,
+                       const boost::filesystem::path& certFile,
+                       const std::string& password,
+                       const boost::filesystem::path& baseDir,
+                       const std::string& baseVersion,
+                       const boost::filesystem::path& inDir,
+                       const boost::filesystem::path& outFile);
+
+        // Given an istream to delta .bpkg data (deltaStrm), validate
+        // it and apply it against baseDir, writing the resulting tree
+        // into destDir (which is replaced).  baseDir is never modified.
+        // The resulting tree is hashed and compared to the hash recorded
+        // in the package before success is returned, on failure destDir
+        // is removed.
+        // empty certPath uses installed certificate store
+        bool applyDelta(std::istream & deltaStrm,
+                        const boost::filesystem::path& baseDir,
+                        const boost::filesystem::path& destDir,
+                        BPTime& timestamp,
+                        std::string & oError,
+                        const boost::filesystem::path& certPath = boost::filesystem::path());
+
+        // Given a path to a delta .bpkg file, as above
+        bool applyDelta(const boost::filesystem::path& deltaPath,
+                        const boost::filesystem::path& baseDir,
+                        const boost::filesystem::path& destDir,
+                        BPTime& timestamp,
+                        std::string & oError,
+                        const boost::filesystem::path& certPath = boost::filesystem::path());
+
 }; };
 
 #endif
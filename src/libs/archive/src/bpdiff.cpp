@@ -0,0 +1,294 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpdiff.cpp - a simple binary differencing scheme used to build
+ *              delta packages.
+ *
+ * The differ is in the spirit of rsync: the old data is indexed by a
+ * weak rolling checksum over fixed size blocks, then the new data is
+ * scanned a byte at a time looking for block matches.  Matches are
+ * verified bytewise and then grown in both directions.  The encoded
+ * patch is:
+ *
+ *   "BPDF" <version byte> <varint oldSize> <varint newSize> <ops>*
+ *
+ * where each op is either 'C' <varint offset> <varint length> (copy
+ * from old data) or 'I' <varint length> <bytes> (insert literal).
+ */
+
+#include "api/bpdiff.h"
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+static const char * s_magic = "BPDF";
+static const unsigned char s_version = 1;
+
+// size of the blocks of old data that we index
+static const size_t s_blockSize = 32;
+
+// sentinel for an empty slot in the block index
+static const size_t s_emptySlot = (size_t) -1;
+
+static void
+putVarint(string& out, unsigned long long v)
+{
+    while (v >= 0x80) {
+        out.push_back((char) ((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char) v);
+}
+
+static bool
+getVarint(const string& in, size_t& pos, unsigned long long& v)
+{
+    v = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        unsigned char c = (unsigned char) in[pos++];
+        v |= ((unsigned long long) (c & 0x7f)) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// rolling checksum over a window of s_blockSize bytes, as in rsync
+class RollingSum
+{
+  public:
+    RollingSum() : m_a(0), m_b(0) { }
+
+    void init(const unsigned char * p) {
+        m_a = m_b = 0;
+        for (size_t i = 0; i < s_blockSize; i++) {
+            m_a += p[i];
+            m_b += (unsigned int) (s_blockSize - i) * p[i];
+        }
+    }
+
+    void roll(unsigned char out, unsigned char in) {
+        m_a = m_a - out + in;
+        m_b = m_b - (unsigned int) s_blockSize * out + m_a;
+    }
+
+    unsigned int value() const {
+        return (m_a & 0xffff) | (m_b << 16);
+    }
+
+  private:
+    unsigned int m_a;
+    unsigned int m_b;
+};
+
+// open addressed index from block checksum to the offset of the
+// first block of old data with that checksum
+class BlockIndex
+{
+  public:
+    BlockIndex(const string& data) : m_data(data) {
+        size_t blocks = data.size() / s_blockSize;
+        size_t slots = 16;
+        while (slots < blocks * 2) slots <<= 1;
+        m_mask = slots - 1;
+        m_sums.resize(slots, 0);
+        m_offsets.resize(slots, s_emptySlot);
+
+        const unsigned char * p = (const unsigned char *) data.data();
+        for (size_t i = 0; i < blocks; i++) {
+            RollingSum rs;
+            rs.init(p + i * s_blockSize);
+            insert(rs.value(), i * s_blockSize);
+        }
+    }
+
+    // find an offset in the old data whose block matches the
+    // s_blockSize bytes at p, or s_emptySlot
+    size_t find(unsigned int sum, const unsigned char * p) const {
+        size_t slot = sum & m_mask;
+        while (m_offsets[slot] != s_emptySlot) {
+            if (m_sums[slot] == sum &&
+                !memcmp(m_data.data() + m_offsets[slot], p, s_blockSize))
+            {
+                return m_offsets[slot];
+            }
+            slot = (slot + 1) & m_mask;
+        }
+        return s_emptySlot;
+    }
+
+  private:
+    void insert(unsigned int sum, size_t offset) {
+        size_t slot = sum & m_mask;
+        while (m_offsets[slot] != s_emptySlot) {
+            // keep the first occurrence of identical blocks
+            if (m_sums[slot] == sum &&
+                !memcmp(m_data.data() + m_offsets[slot],
+                        m_data.data() + offset, s_blockSize))
+            {
+                return;
+            }
+            slot = (slot + 1) & m_mask;
+        }
+        m_sums[slot] = sum;
+        m_offsets[slot] = offset;
+    }
+
+    const string& m_data;
+    size_t m_mask;
+    vector<unsigned int> m_sums;
+    vector<size_t> m_offsets;
+};
+
+static void
+emitInsert(string& patch, const string& newData, size_t from, size_t to)
+{
+    if (to <= from) return;
+    patch.push_back('I');
+    putVarint(patch, to - from);
+    patch.append(newData, from, to - from);
+}
+
+static void
+emitCopy(string& patch, size_t offset, size_t len)
+{
+    patch.push_back('C');
+    putVarint(patch, offset);
+    putVarint(patch, len);
+}
+
+bool
+bp::diff::makePatch(const string& oldData,
+                    const string& newData,
+                    string& patch)
+{
+    patch.clear();
+    patch.append(s_magic);
+    patch.push_back((char) s_version);
+    putVarint(patch, oldData.size());
+    putVarint(patch, newData.size());
+
+    if (oldData.size() < s_blockSize || newData.size() < s_blockSize) {
+        emitInsert(patch, newData, 0, newData.size());
+        return true;
+    }
+
+    BlockIndex index(oldData);
+    const unsigned char * o = (const unsigned char *) oldData.data();
+    const unsigned char * n = (const unsigned char *) newData.data();
+    size_t oldLen = oldData.size();
+    size_t newLen = newData.size();
+
+    // start of the pending literal run
+    size_t literal = 0;
+    size_t pos = 0;
+    RollingSum rs;
+    rs.init(n);
+
+    while (pos + s_blockSize <= newLen) {
+        size_t match = index.find(rs.value(), n + pos);
+        if (match == s_emptySlot) {
+            if (pos + s_blockSize < newLen) {
+                rs.roll(n[pos], n[pos + s_blockSize]);
+            }
+            pos++;
+            continue;
+        }
+
+        // grow the match backwards into the pending literal run...
+        size_t start = pos;
+        size_t oldStart = match;
+        while (start > literal && oldStart > 0 &&
+               n[start - 1] == o[oldStart - 1])
+        {
+            start--;
+            oldStart--;
+        }
+        // ...and forwards as far as it goes
+        size_t end = pos + s_blockSize;
+        size_t oldEnd = match + s_blockSize;
+        while (end < newLen && oldEnd < oldLen && n[end] == o[oldEnd]) {
+            end++;
+            oldEnd++;
+        }
+
+        emitInsert(patch, newData, literal, start);
+        emitCopy(patch, oldStart, end - start);
+
+        literal = pos = end;
+        if (pos + s_blockSize <= newLen) rs.init(n + pos);
+    }
+
+    emitInsert(patch, newData, literal, newLen);
+    return true;
+}
+
+bool
+bp::diff::applyPatch(const string& oldData,
+                     const string& patch,
+                     string& newData)
+{
+    newData.clear();
+
+    size_t magicLen = strlen(s_magic);
+    if (patch.size() < magicLen + 1 || patch.compare(0, magicLen, s_magic)) {
+        return false;
+    }
+    if ((unsigned char) patch[magicLen] != s_version) return false;
+    size_t pos = magicLen + 1;
+
+    unsigned long long oldSize, newSize;
+    if (!getVarint(patch, pos, oldSize) || !getVarint(patch, pos, newSize)) {
+        return false;
+    }
+    if (oldSize != oldData.size()) return false;
+    newData.reserve((size_t) newSize);
+
+    while (pos < patch.size()) {
+        char op = patch[pos++];
+        if (op == 'C') {
+            unsigned long long offset, len;
+            if (!getVarint(patch, pos, offset) ||
+                !getVarint(patch, pos, len) ||
+                offset > oldData.size() ||
+                len > oldData.size() - offset)
+            {
+                return false;
+            }
+            newData.append(oldData, (size_t) offset, (size_t) len);
+        } else if (op == 'I') {
+            unsigned long long len;
+            if (!getVarint(patch, pos, len) || len > patch.size() - pos) {
+                return false;
+            }
+            newData.append(patch, pos, (size_t) len);
+            pos += (size_t) len;
+        } else {
+            return false;
+        }
+        if (newData.size() > newSize) return false;
+    }
+
+    return newData.size() == newSize;
+}
@@ -21,8 +21,10 @@
  */
 
 #include "api/bplzma.h"
+#include "BPUtils/OS.h"
 
-bp::lzma::IO::IO() : m_inputStream(NULL), m_outputStream(NULL)
+bp::lzma::IO::IO()
+    : m_inputStream(NULL), m_outputStream(NULL), m_threads(0)
 {
 }
 
@@ -42,6 +44,18 @@ bp::lzma::IO::setOutputStream(std::ostream & outputStream)
     m_outputStream = &outputStream;
 }
 
+void
+bp::lzma::IO::setThreads(unsigned int threads)
+{
+    m_threads = threads;
+}
+
+unsigned int
+bp::lzma::IO::threadCount() const
+{
+    return (m_threads > 0) ? m_threads : bp::os::NumProcessors();
+}
+
 size_t
 bp::lzma::IO::outputCallback(void *ctx, const void *buf, size_t size)
 {
@@ -0,0 +1,345 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bplzmaBlocks.cpp - the BLOCKS container format.
+ *
+ * The input is split into blocks of a fixed uncompressed size, each
+ * of which is compressed independently into an LZIP stream.  Blocks
+ * are processed a window at a time by a small pool of threads, so
+ * neither side holds more than a window of data in memory.
+ *
+ * Layout (integers are 32 bit big endian):
+ *   "BPLB" <version byte> <block size>
+ *   for each block: <raw size> <packed size> <packed bytes>
+ *   terminator: <0> <0>
+ */
+
+#include "api/bplzma.h"
+
+#include <string.h>
+#include <vector>
+
+#include "easylzma/compress.h"
+#include "easylzma/decompress.h"
+
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bpthread.h"
+
+#define BLOCKS_MAGIC "BPLB"
+#define BLOCKS_MAGIC_LEN 4
+#define BLOCKS_VERSION 1
+
+// blocks handled per thread in each window
+#define BLOCKS_PER_THREAD 2
+
+namespace {
+
+struct Block {
+    std::string in;
+    std::string out;
+    unsigned int rawSize;
+    bool ok;
+};
+
+struct MemReader {
+    const std::string * data;
+    size_t pos;
+};
+
+static int
+memRead(void *ctx, void *buf, size_t * size)
+{
+    MemReader * r = (MemReader *) ctx;
+    size_t left = r->data->size() - r->pos;
+    if (*size > left) *size = left;
+    if (*size > 0) {
+        memcpy(buf, r->data->data() + r->pos, *size);
+        r->pos += *size;
+    }
+    return 0;
+}
+
+struct MemWriter {
+    std::string * data;
+    // output beyond this is refused, a short write fails the run
+    size_t limit;
+};
+
+static size_t
+memWrite(void *ctx, const void *buf, size_t size)
+{
+    MemWriter * w = (MemWriter *) ctx;
+    size_t room = w->limit - w->data->size();
+    if (size > room) size = room;
+    w->data->append((const char *) buf, size);
+    return size;
+}
+
+static bool
+compressBlock(Block & b)
+{
+    elzma_compress_handle hand = elzma_compress_alloc();
+    if (hand == NULL) return false;
+
+    unsigned long long len = b.in.size();
+    int rc = elzma_compress_config(hand, ELZMA_LC_DEFAULT,
+                                   ELZMA_LP_DEFAULT, ELZMA_PB_DEFAULT,
+                                   5, elzma_get_dict_size(len),
+                                   ELZMA_lzip, len);
+    if (rc == ELZMA_E_OK) {
+        MemReader r = { &b.in, 0 };
+        MemWriter w = { &b.out, (size_t) -1 };
+        rc = elzma_compress_run(hand, memRead, (void *) &r,
+                                memWrite, (void *) &w,
+                                NULL, NULL);
+    }
+    elzma_compress_free(&hand);
+    return (rc == ELZMA_E_OK);
+}
+
+static bool
+decompressBlock(Block & b)
+{
+    elzma_decompress_handle hand = elzma_decompress_alloc();
+    if (hand == NULL) return false;
+
+    // a block may not decode to more than its header claims, and
+    // rawSize was checked against the block size before we got here
+    b.out.reserve(b.rawSize);
+    MemReader r = { &b.in, 0 };
+    MemWriter w = { &b.out, b.rawSize };
+    int rc = elzma_decompress_run(hand, memRead, (void *) &r,
+                                  memWrite, (void *) &w, ELZMA_lzip);
+    elzma_decompress_free(&hand);
+    return (rc == ELZMA_E_OK && b.out.size() == b.rawSize);
+}
+
+struct Pool {
+    std::vector<Block> * blocks;
+    bool compress;
+    unsigned int next;
+    bp::sync::Mutex mutex;
+};
+
+static void *
+poolWorker(void * cookie)
+{
+    Pool * p = (Pool *) cookie;
+    for (;;) {
+        unsigned int i;
+        {
+            bp::sync::Lock lck(p->mutex);
+            i = p->next++;
+        }
+        if (i >= p->blocks->size()) break;
+        Block & b = (*p->blocks)[i];
+        b.ok = p->compress ? compressBlock(b) : decompressBlock(b);
+        // release input as soon as we're done with it
+        std::string().swap(b.in);
+    }
+    return NULL;
+}
+
+// process all blocks using up to nThreads threads, the calling
+// thread included
+static bool
+runPool(std::vector<Block> & blocks, bool compress, unsigned int nThreads)
+{
+    Pool p;
+    p.blocks = &blocks;
+    p.compress = compress;
+    p.next = 0;
+
+    if (nThreads > blocks.size()) nThreads = blocks.size();
+    unsigned int nSpawn = (nThreads > 1) ? nThreads - 1 : 0;
+    std::vector<bool> running(nSpawn, false);
+    bp::thread::Thread * threads = NULL;
+    if (nSpawn > 0) {
+        threads = new bp::thread::Thread[nSpawn];
+        for (unsigned int i = 0; i < nSpawn; i++) {
+            running[i] = threads[i].run(poolWorker, (void *) &p);
+        }
+    }
+    (void) poolWorker((void *) &p);
+    for (unsigned int i = 0; i < nSpawn; i++) {
+        if (running[i]) threads[i].join();
+    }
+    delete [] threads;
+
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        if (!blocks[i].ok) return false;
+    }
+    return true;
+}
+
+static void
+writeU32(std::ostream & os, unsigned int v)
+{
+    unsigned char b[4];
+    b[0] = (unsigned char) (v >> 24);
+    b[1] = (unsigned char) (v >> 16);
+    b[2] = (unsigned char) (v >> 8);
+    b[3] = (unsigned char) v;
+    os.write((const char *) b, sizeof(b));
+}
+
+static bool
+readU32(std::istream & is, unsigned int & v)
+{
+    unsigned char b[4];
+    is.read((char *) b, sizeof(b));
+    if (is.gcount() != sizeof(b)) return false;
+    v = ((unsigned int) b[0] << 24) | ((unsigned int) b[1] << 16)
+        | ((unsigned int) b[2] << 8) | (unsigned int) b[3];
+    return true;
+}
+
+}
+
+
+const char *
+bp::lzma::IO::blocksMagic()
+{
+    return BLOCKS_MAGIC;
+}
+
+
+bool
+bp::lzma::Compress::runBlocks()
+{
+    if (m_blockSize == 0 || m_blockSize > kMaxBlockSize) return false;
+
+    std::ostream & os = *m_outputStream;
+    os.write(BLOCKS_MAGIC, BLOCKS_MAGIC_LEN);
+    os.put((char) BLOCKS_VERSION);
+    writeU32(os, m_blockSize);
+
+    unsigned int nThreads = threadCount();
+    size_t window = nThreads * BLOCKS_PER_THREAD;
+    std::vector<char> buf(m_blockSize);
+    bool eof = false;
+
+    while (!eof) {
+        std::vector<Block> blocks;
+        while (blocks.size() < window) {
+            m_inputStream->read(&buf[0], m_blockSize);
+            size_t n = (size_t) m_inputStream->gcount();
+            if (n < m_blockSize) eof = true;
+            if (n > 0) {
+                blocks.push_back(Block());
+                Block & b = blocks.back();
+                b.in.assign(&buf[0], n);
+                b.rawSize = (unsigned int) n;
+                b.ok = false;
+            }
+            if (eof) break;
+        }
+        if (blocks.empty()) break;
+
+        if (!runPool(blocks, true, nThreads)) return false;
+
+        for (unsigned int i = 0; i < blocks.size(); i++) {
+            writeU32(os, blocks[i].rawSize);
+            writeU32(os, (unsigned int) blocks[i].out.size());
+            os.write(blocks[i].out.data(), blocks[i].out.size());
+        }
+        if (!os.good()) return false;
+    }
+
+    writeU32(os, 0);
+    writeU32(os, 0);
+    return os.good();
+}
+
+
+bool
+bp::lzma::Decompress::runBlocks()
+{
+    if (m_inputStream == NULL || m_outputStream == NULL) {
+        return false;
+    }
+
+    std::istream & is = *m_inputStream;
+    char magic[BLOCKS_MAGIC_LEN + 1];
+    is.read(magic, sizeof(magic));
+    if (is.gcount() != sizeof(magic)
+        || memcmp(magic, BLOCKS_MAGIC, BLOCKS_MAGIC_LEN)
+        || magic[BLOCKS_MAGIC_LEN] != BLOCKS_VERSION)
+    {
+        return false;
+    }
+
+    unsigned int blockSize = 0;
+    if (!readU32(is, blockSize) || blockSize == 0
+        || blockSize > kMaxBlockSize)
+    {
+        return false;
+    }
+
+    // bound what we'll allocate for a block, so corrupt input can't
+    // make us allocate without limit.  LZMA expansion of
+    // incompressible data is well under this, and with blockSize
+    // capped the sum can't overflow.
+    unsigned int maxPacked = blockSize + (blockSize >> 3) + 1024;
+
+    unsigned int nThreads = threadCount();
+    size_t window = nThreads * BLOCKS_PER_THREAD;
+    bool done = false;
+
+    while (!done) {
+        std::vector<Block> blocks;
+        while (blocks.size() < window) {
+            unsigned int rawSize, packedSize;
+            if (!readU32(is, rawSize) || !readU32(is, packedSize)) {
+                return false;
+            }
+            if (rawSize == 0 && packedSize == 0) {
+                done = true;
+                break;
+            }
+            if (rawSize == 0 || rawSize > blockSize
+                || packedSize == 0 || packedSize > maxPacked)
+            {
+                return false;
+            }
+            blocks.push_back(Block());
+            Block & b = blocks.back();
+            b.in.resize(packedSize);
+            is.read(&b.in[0], packedSize);
+            if ((unsigned int) is.gcount() != packedSize) return false;
+            b.rawSize = rawSize;
+            b.ok = false;
+        }
+        if (blocks.empty()) break;
+
+        if (!runPool(blocks, false, nThreads)) return false;
+
+        for (unsigned int i = 0; i < blocks.size(); i++) {
+            m_outputStream->write(blocks[i].out.data(),
+                                  blocks[i].out.size());
+        }
+        if (!m_outputStream->good()) return false;
+    }
+
+    return true;
+}
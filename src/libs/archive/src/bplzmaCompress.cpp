@@ -31,7 +31,7 @@
 
 #include "BPUtils/bperrorutil.h"
 
-bp::lzma::Compress::Compress() : IO()
+bp::lzma::Compress::Compress() : IO(), m_blockSize(kDefaultBlockSize)
 {
 }
 
@@ -39,6 +39,12 @@ bp::lzma::Compress::~Compress()
 {
 }
 
+void
+bp::lzma::Compress::setBlockSize(unsigned int blockSize)
+{
+    m_blockSize = blockSize;
+}
+
 bool
 bp::lzma::Compress::run(Format format)
 {
@@ -46,6 +52,8 @@ bp::lzma::Compress::run(Format format)
         return false;
     }
 
+    if (format == BLOCKS) return runBlocks();
+
     int rc;
     elzma_compress_handle hand;
 
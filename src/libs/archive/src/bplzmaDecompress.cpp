@@ -35,6 +35,15 @@ bp::lzma::Decompress::~Decompress()
 bool
 bp::lzma::Decompress::run(Format format)
 {
+    // a BLOCKS container is distinguishable from an LZIP stream
+    // by its first byte
+    if (format == BLOCKS) return runBlocks();
+    if (format == LZIP && m_inputStream != NULL
+        && m_inputStream->peek() == blocksMagic()[0])
+    {
+        return runBlocks();
+    }
+
     int rc;
     elzma_decompress_handle hand;
     
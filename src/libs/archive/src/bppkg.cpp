@@ -30,12 +30,17 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <map>
+#include <set>
+#include "api/bpdiff.h"
 #include "api/bptar.h"
 #include "api/bplzma.h"
 #include "BPUtils/bpfile.h"
 #include "BPUtils/BPLog.h"
+#include "BPUtils/bpsha256.h"
 #include "BPUtils/bpstopwatch.h"
 #include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
 #include "platform_utils/bpsign.h"
 
 #ifdef WIN32
@@ -46,6 +51,15 @@ using namespace std;
 namespace bpf = bp::file;
 namespace bfs = boost::filesystem;
 
+// name of the manifest inside a delta contents tarball, and the
+// version of the manifest format.  Version 2 adds symlinks, which
+// appliers of version 1 would drop.
+#define DELTA_MANIFEST "delta.json"
+#define DELTA_FORMAT_VERSION 2
+
+
+// see bp::pkg::setBlockCompression()
+static bool s_blockCompression = false;
 
 static void
 doPack(const bfs::path& keyFile, 
@@ -53,7 +67,7 @@ doPack(const bfs::path& keyFile,
        const string& password,
        const bfs::path& contentsFile,
        const bfs::path& outFile,
-       bool isTar)
+       const bfs::path& contentsName)
 {
     bfs::path sigFile;
     bfs::path pkgtar;
@@ -83,9 +97,7 @@ doPack(const bfs::path& keyFile,
         if (!tar.open(pkgtar)) {
             throw string("unable to open " + pkgtar.string());
         }
-        bfs::path fname = isTar ? bp::pkg::contentsPath() 
-                                : bp::pkg::contentsDataPath();
-        if (!tar.addFile(contentsFile, fname)) {
+        if (!tar.addFile(contentsFile, contentsName)) {
             throw string("unable to add " + contentsFile.string());
         }
         if (!tar.addFile(sigFile, bp::pkg::signaturePath())) {
@@ -108,7 +120,15 @@ doPack(const bfs::path& keyFile,
         }
         compress.setInputStream(ifs);
         compress.setOutputStream(ofs);
-        if (!compress.run()) {
+        // large packages may be compressed as independent blocks so
+        // that packing and unpacking can use all processors
+        bp::lzma::Format format = bp::lzma::LZIP;
+        if (s_blockCompression
+            && bpf::size(pkgtar) > bp::lzma::kDefaultBlockSize)
+        {
+            format = bp::lzma::BLOCKS;
+        }
+        if (!compress.run(format)) {
             throw string("unable to compress " + pkgtar.string()
                          + " to " + outFile.string());
         }
@@ -128,7 +148,7 @@ static void
 doUnpack(istream & is,
          ostream & os,
          const bfs::path& certPath,
-         bool isTar,
+         const bfs::path& contentsName,
          BPTime& timestamp)
 {
     // uncompress bpkg
@@ -155,8 +175,7 @@ doUnpack(istream & is,
         ss.clear();
 
         // extract contents and signature
-        bfs::path contentsPath(isTar ? bp::pkg::contentsPath() 
-                                     : bp::pkg::contentsDataPath());
+        bfs::path contentsPath(contentsName);
         bfs::path sigFilePath(bp::pkg::signaturePath());
 
         if (!untar.extractSingle(sigFilePath, signature)) {
@@ -186,6 +205,302 @@ doUnpack(istream & is,
     os << contents.str();
 }
 
+// A snapshot of a directory tree: the relative (generic form) paths
+// of its directories, files and symlinks, and where the links point.
+// File hashes are computed on demand.
+class Tree
+{
+  public:
+    Tree(const bfs::path& dir) : m_dir(dir) {
+        class TreeVisitor : virtual public bpf::IVisitor
+        {
+          public:
+            TreeVisitor(Tree& tree, const bfs::path& top)
+                : m_tree(tree), m_top(top) {
+            }
+            virtual ~TreeVisitor() {
+            }
+            virtual bpf::IVisitor::tResult visitNode(const bfs::path& p,
+                                                     const bfs::path& relPath) {
+                // links are entries of their own, neither followed
+                // nor copied as what they point at
+                if (bpf::isSymlink(p)) {
+                    boost::system::error_code ec;
+                    bfs::path target = bfs::read_symlink(p, ec);
+                    if (ec) {
+                        throw string("unable to read link " + p.string());
+                    }
+                    bfs::path rel = bpf::relativeTo(p, m_tree.m_dir);
+                    m_tree.m_links[rel.generic_string()] =
+                        target.generic_string();
+                    return bpf::IVisitor::eOk;
+                }
+                bfs::path rel = bpf::relativeTo(relPath, m_top);
+                if (rel.empty()) {
+                    return bpf::IVisitor::eOk;
+                }
+                if (bpf::isDirectory(p)) {
+                    m_tree.m_dirs.insert(rel.generic_string());
+                } else {
+                    m_tree.m_files[rel.generic_string()] = p;
+                }
+                return bpf::IVisitor::eOk;
+            }
+          protected:
+            Tree& m_tree;
+            bfs::path m_top;
+        };
+
+        if (!bpf::isDirectory(dir)) {
+            throw string(dir.string() + " is not a directory");
+        }
+        try {
+            TreeVisitor visitor(*this, dir.filename());
+            recursiveVisit(dir, visitor, false);
+        } catch (const bfs::filesystem_error& e) {
+            throw string("unable to scan " + dir.string()
+                         + ": " + e.what());
+        }
+    }
+
+    bool hasFile(const string& rel) const {
+        return m_files.find(rel) != m_files.end();
+    }
+
+    bfs::path filePath(const string& rel) const {
+        map<string, bfs::path>::const_iterator it = m_files.find(rel);
+        return it == m_files.end() ? bfs::path() : it->second;
+    }
+
+    string fileHash(const string& rel) {
+        map<string, string>::const_iterator it = m_hashes.find(rel);
+        if (it != m_hashes.end()) return it->second;
+        string h = bp::sha256::hashFile(filePath(rel));
+        if (h.empty()) {
+            throw string("unable to hash " + filePath(rel).string());
+        }
+        m_hashes[rel] = h;
+        return h;
+    }
+
+    // a digest over the structure and contents of the whole tree
+    string hash() {
+        string s;
+        set<string>::const_iterator dit;
+        for (dit = m_dirs.begin(); dit != m_dirs.end(); ++dit) {
+            s += "d " + *dit + "\n";
+        }
+        map<string, bfs::path>::const_iterator fit;
+        for (fit = m_files.begin(); fit != m_files.end(); ++fit) {
+            s += "f " + fit->first + " " + fileHash(fit->first) + "\n";
+        }
+        map<string, string>::const_iterator lit;
+        for (lit = m_links.begin(); lit != m_links.end(); ++lit) {
+            s += "l " + lit->first + " " + lit->second + "\n";
+        }
+        return bp::sha256::hash(s);
+    }
+
+    bfs::path m_dir;
+    set<string> m_dirs;
+    map<string, bfs::path> m_files;
+    map<string, string> m_links;
+
+  private:
+    map<string, string> m_hashes;
+};
+
+
+// reject manifest paths which would escape the destination directory
+static bfs::path
+safeRelativePath(const string& rel)
+{
+    bfs::path p(rel);
+    if (rel.empty() || p.has_root_path()) {
+        throw string("bad path in delta manifest: " + rel);
+    }
+    for (bfs::path::iterator it = p.begin(); it != p.end(); ++it) {
+        if (it->string() == "..") {
+            throw string("bad path in delta manifest: " + rel);
+        }
+    }
+    return p;
+}
+
+
+static void
+doApplyDelta(istream& is,
+             const bfs::path& baseDir,
+             const bfs::path& destDir,
+             const bfs::path& workDir,
+             const bfs::path& certPath,
+             BPTime& timestamp)
+{
+    bp::time::Stopwatch sw;
+    sw.start();
+
+    // validate and extract the delta tarball
+    {
+        stringstream contents;
+        doUnpack(is, contents, certPath, bp::pkg::deltaContentsPath(),
+                 timestamp);
+        bp::tar::Extract untar;
+        if (!untar.load(contents.str())) {
+            throw string("unable to open delta tar data");
+        }
+        if (!untar.extract(workDir)) {
+            throw string("unable to extract delta to " + workDir.string());
+        }
+        if (!untar.close()) {
+            throw string("unable to close delta tar session");
+        }
+    }
+    BPLOG_INFO_STRM("(" << sw.elapsedSec() << ") delta extracted");
+
+    string json;
+    if (!bp::strutil::loadFromFile(workDir / DELTA_MANIFEST, json)) {
+        throw string(DELTA_MANIFEST " missing from delta");
+    }
+    bp::Object * o = bp::Object::fromPlainJsonString(json);
+    if (o == NULL || o->type() != BPTMap) {
+        delete o;
+        throw string("unable to parse " DELTA_MANIFEST);
+    }
+    bp::Map manifest(*((bp::Map *) o));
+    delete o;
+
+    int format = 0;
+    string resultHash;
+    const bp::List * dirs = NULL;
+    const bp::List * files = NULL;
+    const bp::List * links = NULL;
+    if (!manifest.getInteger("format", format)
+        || format < 1 || format > DELTA_FORMAT_VERSION
+        || !manifest.getString("hash", resultHash)
+        || !manifest.getList("directories", dirs)
+        || !manifest.getList("files", files))
+    {
+        throw string("malformed " DELTA_MANIFEST);
+    }
+
+    Tree base(baseDir);
+
+    if (!bpf::safeRemove(destDir)) {
+        throw string("unable to remove " + destDir.string());
+    }
+    try {
+        bfs::create_directories(destDir);
+        for (unsigned int i = 0; i < dirs->size(); i++) {
+            const bp::Object * d = dirs->value(i);
+            if (d->type() != BPTString) {
+                throw string("malformed directory entry in " DELTA_MANIFEST);
+            }
+            bfs::create_directories(destDir / safeRelativePath(*d));
+        }
+    } catch (const bfs::filesystem_error& e) {
+        throw string("unable to create directories in "
+                     + destDir.string() + ": " + e.what());
+    }
+
+    for (unsigned int i = 0; i < files->size(); i++) {
+        const bp::Object * f = files->value(i);
+        if (f->type() != BPTMap) {
+            throw string("malformed file entry in " DELTA_MANIFEST);
+        }
+        const bp::Map * entry = (const bp::Map *) f;
+        string rel, action, hash, data;
+        if (!entry->getString("path", rel)
+            || !entry->getString("action", action)
+            || !entry->getString("hash", hash))
+        {
+            throw string("malformed file entry in " DELTA_MANIFEST);
+        }
+        bfs::path dest = destDir / safeRelativePath(rel);
+
+        if (!action.compare("keep")) {
+            if (!base.hasFile(rel) || base.fileHash(rel) != hash) {
+                throw string("base file mismatch: " + rel);
+            }
+            try {
+                bfs::copy_file(base.filePath(rel), dest);
+            } catch (const bfs::filesystem_error& e) {
+                throw string("unable to copy " + rel + ": " + e.what());
+            }
+        } else if (!action.compare("patch")) {
+            string baseHash;
+            if (!entry->getString("baseHash", baseHash)
+                || !entry->getString("data", data))
+            {
+                throw string("malformed patch entry for " + rel);
+            }
+            if (!base.hasFile(rel) || base.fileHash(rel) != baseHash) {
+                throw string("base file mismatch: " + rel);
+            }
+            string oldData, patch, newData;
+            if (!bp::strutil::loadFromFile(base.filePath(rel), oldData)
+                || !bp::strutil::loadFromFile(
+                       workDir / safeRelativePath(data), patch))
+            {
+                throw string("unable to read patch inputs for " + rel);
+            }
+            if (!bp::diff::applyPatch(oldData, patch, newData)) {
+                throw string("unable to apply patch to " + rel);
+            }
+            if (!bp::strutil::storeToFile(dest, newData)) {
+                throw string("unable to write " + dest.string());
+            }
+        } else if (!action.compare("add")) {
+            if (!entry->getString("data", data)) {
+                throw string("malformed add entry for " + rel);
+            }
+            if (!bpf::safeMove(workDir / safeRelativePath(data), dest)) {
+                throw string("unable to move " + data + " to "
+                             + dest.string());
+            }
+        } else {
+            throw string("unknown delta action '" + action + "' for " + rel);
+        }
+
+        int mode = 0;
+        if (entry->getInteger("mode", mode)) {
+            bpf::FileInfo fi;
+            if (bpf::statFile(dest, fi)) {
+                fi.mode = (unsigned int) mode;
+                (void) bpf::setFileProperties(dest, fi);
+            }
+        }
+    }
+    // links go in last, so that nothing above is written through one
+    if (manifest.getList("links", links)) {
+        for (unsigned int i = 0; i < links->size(); i++) {
+            const bp::Object * l = links->value(i);
+            string rel, target;
+            if (l->type() != BPTMap
+                || !((const bp::Map *) l)->getString("path", rel)
+                || !((const bp::Map *) l)->getString("target", target))
+            {
+                throw string("malformed link entry in " DELTA_MANIFEST);
+            }
+            bfs::path dest = destDir / safeRelativePath(rel);
+            if (!bpf::createLink(dest, target)) {
+                throw string("unable to link " + dest.string()
+                             + " to " + target);
+            }
+        }
+    }
+    BPLOG_INFO_STRM("(" << sw.elapsedSec() << ") delta applied, "
+                    << files->size() << " files, "
+                    << (links ? links->size() : 0) << " links");
+
+    // now verify the whole tree we produced before anyone may use it
+    Tree result(destDir);
+    if (result.hash() != resultHash) {
+        throw string("delta result hash mismatch in " + destDir.string());
+    }
+    BPLOG_INFO_STRM("(" << sw.elapsedSec() << ") delta result verified");
+}
+
+
 string
 bp::pkg::extension()
 {
@@ -207,6 +522,13 @@ bp::pkg::contentsDataPath()
 }
         
 
+bfs::path 
+bp::pkg::deltaContentsPath()
+{
+    return bfs::path("contents.delta");
+}
+
+
 bfs::path 
 bp::pkg::signaturePath()
 {
@@ -214,6 +536,18 @@ bp::pkg::signaturePath()
 }
 
 
+void
+bp::pkg::setBlockCompression(bool enabled)
+{
+    s_blockCompression = enabled;
+}
+
+bool
+bp::pkg::blockCompression()
+{
+    return s_blockCompression;
+}
+
 bool
 bp::pkg::packDirectory(const bfs::path& keyFile, 
                        const bfs::path& certFile,
@@ -277,7 +611,8 @@ bp::pkg::packDirectory(const bfs::path& keyFile,
         }
 
         // sign, tar, and compress
-        doPack(keyFile, certFile, password, tarFile, outFile, true);
+        doPack(keyFile, certFile, password, tarFile, outFile,
+               bp::pkg::contentsPath());
         rval = true;
         
     } catch (const string& msg) {
@@ -314,7 +649,8 @@ bp::pkg::unpackToDirectory(istream & bpkgStrm,
 
         BPLOG_INFO_STRM("(" << sw.elapsedSec() << ") decompressing "
                         << len << " bytes");
-        doUnpack(bpkgStrm, contents, certPath, true, timestamp);
+        doUnpack(bpkgStrm, contents, certPath, bp::pkg::contentsPath(),
+                 timestamp);
 
         // untar contents to final destination
         if (!bpf::safeRemove(destDir)) {
@@ -379,7 +715,8 @@ bp::pkg::packFile(const bfs::path& keyFile,
     bool rval = true;
     try {
         // sign, tar, and compress
-        doPack(keyFile, certFile, password, inFile, outFile, false);
+        doPack(keyFile, certFile, password, inFile, outFile,
+               bp::pkg::contentsDataPath());
         rval = true;
     } catch (const string& msg) {
         BPLOG_ERROR(msg);
@@ -420,7 +757,7 @@ bp::pkg::unpackToFile(const bfs::path& bpkgPath,
             throw string("unable to open stream for " + bpkgPath.string());
         }
 
-        doUnpack(ifs, ofs, certPath, false, timestamp);
+        doUnpack(ifs, ofs, certPath, bp::pkg::contentsDataPath(), timestamp);
         rval = true;
     } catch (const string& msg) {
         BPLOG_ERROR(msg);
@@ -451,7 +788,8 @@ bp::pkg::packString(const bfs::path& keyFile,
             throw string("unable to save string to " + inFile.string());
         }
         // sign, tar, and compress
-        doPack(keyFile, certFile, password, inFile, outFile, false);
+        doPack(keyFile, certFile, password, inFile, outFile,
+               bp::pkg::contentsDataPath());
         rval = true;
     } catch (const string& msg) {
         BPLOG_ERROR(msg);
@@ -490,7 +828,8 @@ bp::pkg::unpackToString(const bfs::path& bpkgPath,
             throw string("unable to open stream for " + bpkgPath.string());
         }
         stringstream ostream;
-        doUnpack(ifs, ostream, certPath, false, timestamp);
+        doUnpack(ifs, ostream, certPath, bp::pkg::contentsDataPath(),
+                 timestamp);
         resultStr = ostream.str();
         rval = true;
     } catch (const string& msg) {
@@ -502,3 +841,195 @@ bp::pkg::unpackToString(const bfs::path& bpkgPath,
     return rval;
 }
 
+
+
+bool
+bp::pkg::packDelta(const bfs::path& keyFile,
+                   const bfs::path& certFile,
+                   const string& password,
+                   const bfs::path& baseDir,
+                   const string& baseVersion,
+                   const bfs::path& inDir,
+                   const bfs::path& outFile)
+{
+    bool rval = true;
+    bfs::path tarFile, dataDir;
+    try {
+        Tree base(baseDir);
+        Tree target(inDir);
+
+        try {
+            tarFile = bpf::getTempPath(bpf::getTempDirectory(), "bpkg_deltaTar");
+            dataDir = bpf::getTempPath(bpf::getTempDirectory(), "bpkg_deltaData");
+            bfs::create_directories(dataDir);
+        } catch (const bfs::filesystem_error& e) {
+            throw string("unable to create temp files: " + string(e.what()));
+        }
+
+        bp::tar::Create tar;
+        if (!tar.open(tarFile)) {
+            throw string("unable to open " + tarFile.string());
+        }
+
+        bp::Map manifest;
+        manifest.add("format", new bp::Integer(DELTA_FORMAT_VERSION));
+        manifest.add("baseVersion", new bp::String(baseVersion));
+        manifest.add("baseHash", new bp::String(base.hash()));
+        manifest.add("hash", new bp::String(target.hash()));
+
+        bp::List * dirs = new bp::List;
+        set<string>::const_iterator dit;
+        for (dit = target.m_dirs.begin(); dit != target.m_dirs.end(); ++dit) {
+            dirs->append(new bp::String(*dit));
+        }
+        manifest.add("directories", dirs);
+
+        bp::List * links = new bp::List;
+        map<string, string>::const_iterator lit;
+        for (lit = target.m_links.begin(); lit != target.m_links.end();
+             ++lit) {
+            bp::Map * entry = new bp::Map;
+            entry->add("path", new bp::String(lit->first));
+            entry->add("target", new bp::String(lit->second));
+            links->append(entry);
+        }
+        manifest.add("links", links);
+
+        bp::List * files = new bp::List;
+        manifest.add("files", files);
+        unsigned int kept = 0, patched = 0, added = 0;
+        map<string, bfs::path>::const_iterator fit;
+        for (fit = target.m_files.begin(); fit != target.m_files.end(); ++fit) {
+            const string& rel = fit->first;
+            string hash = target.fileHash(rel);
+
+            bp::Map * entry = new bp::Map;
+            files->append(entry);
+            entry->add("path", new bp::String(rel));
+            entry->add("hash", new bp::String(hash));
+            bpf::FileInfo fi;
+            if (bpf::statFile(fit->second, fi)) {
+                entry->add("mode", new bp::Integer(fi.mode & 07777));
+            }
+
+            if (base.hasFile(rel) && base.fileHash(rel) == hash) {
+                entry->add("action", new bp::String("keep"));
+                kept++;
+                continue;
+            }
+
+            stringstream ss;
+            ss << files->size();
+            string data = "data/" + ss.str();
+            entry->add("data", new bp::String(data));
+
+            if (base.hasFile(rel)) {
+                string oldData, newData, patch;
+                if (!bp::strutil::loadFromFile(base.filePath(rel), oldData)
+                    || !bp::strutil::loadFromFile(fit->second, newData))
+                {
+                    throw string("unable to read " + rel);
+                }
+                if (bp::diff::makePatch(oldData, newData, patch)
+                    && patch.size() < newData.size())
+                {
+                    bfs::path patchFile = dataDir / ss.str();
+                    if (!bp::strutil::storeToFile(patchFile, patch)) {
+                        throw string("unable to write " + patchFile.string());
+                    }
+                    if (!tar.addFile(patchFile, data)) {
+                        throw string("unable to add patch for " + rel);
+                    }
+                    entry->add("action", new bp::String("patch"));
+                    entry->add("baseHash",
+                               new bp::String(base.fileHash(rel)));
+                    patched++;
+                    continue;
+                }
+            }
+
+            if (!tar.addFile(fit->second, data)) {
+                throw string("unable to add " + fit->second.string());
+            }
+            entry->add("action", new bp::String("add"));
+            added++;
+        }
+
+        bfs::path manifestFile = dataDir / DELTA_MANIFEST;
+        if (!bp::strutil::storeToFile(manifestFile,
+                                      manifest.toPlainJsonString())) {
+            throw string("unable to write " + manifestFile.string());
+        }
+        if (!tar.addFile(manifestFile, DELTA_MANIFEST)) {
+            throw string("unable to add " DELTA_MANIFEST);
+        }
+        if (!tar.close()) {
+            throw string("unable to close tar file: " + tarFile.string());
+        }
+
+        BPLOG_INFO_STRM("delta against " << baseVersion << ": "
+                        << kept << " kept, " << patched << " patched, "
+                        << added << " added");
+
+        // sign, tar, and compress
+        doPack(keyFile, certFile, password, tarFile, outFile,
+               bp::pkg::deltaContentsPath());
+        rval = true;
+    } catch (const string& msg) {
+        BPLOG_ERROR(msg);
+        bpf::safeRemove(outFile);
+        rval = false;
+    }
+
+    bpf::safeRemove(tarFile);
+    bpf::safeRemove(dataDir);
+    return rval;
+}
+
+
+bool
+bp::pkg::applyDelta(istream & deltaStrm,
+                    const bfs::path& baseDir,
+                    const bfs::path& destDir,
+                    BPTime& timestamp,
+                    string& oError,
+                    const bfs::path& certPath)
+{
+    bool rval = true;
+    bfs::path workDir;
+    try {
+        try {
+            workDir = bpf::getTempPath(bpf::getTempDirectory(), "bpkg_delta");
+            bfs::create_directories(workDir);
+        } catch (const bfs::filesystem_error& e) {
+            throw string("unable to create temp dir: " + string(e.what()));
+        }
+        doApplyDelta(deltaStrm, baseDir, destDir, workDir, certPath,
+                     timestamp);
+        rval = true;
+    } catch (const string& msg) {
+        BPLOG_ERROR(msg);
+        oError = msg;
+        (void) bpf::safeRemove(destDir);
+        rval = false;
+    }
+    bpf::safeRemove(workDir);
+    return rval;
+}
+
+
+bool
+bp::pkg::applyDelta(const bfs::path& deltaPath,
+                    const bfs::path& baseDir,
+                    const bfs::path& destDir,
+                    BPTime& timestamp,
+                    string& oError,
+                    const bfs::path& certPath)
+{
+    ifstream ifs;
+    if (!bpf::openReadableStream(ifs, deltaPath, ifstream::binary)) {
+        oError = "unable to open stream for " + deltaPath.string();
+        return false;
+    }
+    return applyDelta(ifs, baseDir, destDir, timestamp, oError, certPath);
+}
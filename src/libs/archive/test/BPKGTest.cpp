@@ -311,6 +311,117 @@ void BPKGTest::testStringRoundTrip()
 }
 
 
+// derive a new version of the directory test data: one file modified,
+// one added, one removed
+static
+bool createDeltaTestData(const bfs::path & baseDirPath,
+                         const bfs::path & newDirPath)
+{
+    if (!bpf::safeCopy(baseDirPath, newDirPath)) {
+        return false;
+    }
+    std::string contents;
+    for (unsigned int i = 0; i < 200; i++) {
+        contents.append(s_singleFileContents);
+    }
+    if (!bp::strutil::storeToFile(baseDirPath / "bigfile", contents)) {
+        return false;
+    }
+    contents.insert(contents.size() / 2, "a change in the middle");
+    if (!bp::strutil::storeToFile(newDirPath / "bigfile", contents)) {
+        return false;
+    }
+    if (!bp::strutil::storeToFile(newDirPath / "newfile",
+                                  std::string("new in this version"))) {
+        return false;
+    }
+    return bpf::safeRemove(newDirPath / "singlefile");
+}
+
+
+void BPKGTest::testDeltaRoundTrip()
+{
+    bfs::path newDirPath = m_baseDirPath / "newTestDir";
+    CPPUNIT_ASSERT(createDeltaTestData(m_testDirPath, newDirPath));
+
+    CPPUNIT_ASSERT(bp::pkg::packDelta(m_keyFile, m_certFile, s_testPassword,
+                                      m_testDirPath, "1.0.0",
+                                      newDirPath, m_bpkgPath));
+
+    std::string err;
+    BPTime ts;
+    CPPUNIT_ASSERT(bp::pkg::applyDelta(m_bpkgPath, m_testDirPath,
+                                       m_unpackPath, ts, err, m_certFile));
+
+    // the base must be untouched, and the result must match the new tree
+    CPPUNIT_ASSERT(verifyDirectoryTestData(m_testDirPath));
+    std::string expected, got;
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(newDirPath / "bigfile",
+                                             expected));
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(m_unpackPath / "bigfile", got));
+    CPPUNIT_ASSERT(expected == got);
+    CPPUNIT_ASSERT(bpf::pathExists(m_unpackPath / "newfile"));
+    CPPUNIT_ASSERT(!bpf::pathExists(m_unpackPath / "singlefile"));
+    CPPUNIT_ASSERT(bpf::pathExists(
+        m_unpackPath/"levelone"/"leveltwo"/"levelthree"/"thefile.txt"));
+
+    // a delta is not a full package
+    CPPUNIT_ASSERT(!bp::pkg::unpackToDirectory(m_bpkgPath, m_unpackPath,
+                                               ts, err, m_certFile));
+}
+
+
+void BPKGTest::testDeltaBaseMismatch()
+{
+    bfs::path newDirPath = m_baseDirPath / "newTestDir";
+    CPPUNIT_ASSERT(createDeltaTestData(m_testDirPath, newDirPath));
+
+    CPPUNIT_ASSERT(bp::pkg::packDelta(m_keyFile, m_certFile, s_testPassword,
+                                      m_testDirPath, "1.0.0",
+                                      newDirPath, m_bpkgPath));
+
+    // corrupt the base, application must fail and leave nothing behind
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(m_testDirPath / "bigfile",
+                                            std::string("not the base")));
+    std::string err;
+    BPTime ts;
+    CPPUNIT_ASSERT(!bp::pkg::applyDelta(m_bpkgPath, m_testDirPath,
+                                        m_unpackPath, ts, err, m_certFile));
+    CPPUNIT_ASSERT(!err.empty());
+    CPPUNIT_ASSERT(!bpf::pathExists(m_unpackPath));
+}
+
+
+#ifndef WIN32
+void BPKGTest::testDeltaSymlinks()
+{
+    bfs::path newDirPath = m_baseDirPath / "newTestDir";
+    CPPUNIT_ASSERT(createDeltaTestData(m_testDirPath, newDirPath));
+
+    // a link to a file and a link back up the tree, which would
+    // never finish scanning if links were followed
+    bfs::create_symlink("bigfile", newDirPath / "fileLink");
+    bfs::create_symlink("..", newDirPath / "levelone" / "loop");
+
+    CPPUNIT_ASSERT(bp::pkg::packDelta(m_keyFile, m_certFile, s_testPassword,
+                                      m_testDirPath, "1.0.0",
+                                      newDirPath, m_bpkgPath));
+    std::string err;
+    BPTime ts;
+    CPPUNIT_ASSERT(bp::pkg::applyDelta(m_bpkgPath, m_testDirPath,
+                                       m_unpackPath, ts, err, m_certFile));
+    CPPUNIT_ASSERT(err.empty());
+
+    bfs::path fileLink = m_unpackPath / "fileLink";
+    CPPUNIT_ASSERT(bpf::isSymlink(fileLink));
+    CPPUNIT_ASSERT(bfs::read_symlink(fileLink) == bfs::path("bigfile"));
+    bfs::path loop = m_unpackPath / "levelone" / "loop";
+    CPPUNIT_ASSERT(bpf::isSymlink(loop));
+    CPPUNIT_ASSERT(bfs::read_symlink(loop) == bfs::path(".."));
+}
+#endif
+
+
 void
 BPKGTest::setUp()
 {
@@ -348,3 +459,37 @@ BPKGTest::tearDown()
     (void) bpf::safeRemove(m_baseDirPath.parent_path());
 }
 
+
+
+void BPKGTest::testBlockCompressionOptIn()
+{
+    // bigger than one compression block
+    std::string big;
+    for (unsigned int i = 0; big.size() < 3 * 1024 * 1024; i++) {
+        std::stringstream ss;
+        ss << i << " ";
+        big.append(ss.str());
+    }
+    std::string magic;
+
+    // by default large packages stay readable by every client
+    CPPUNIT_ASSERT(!bp::pkg::blockCompression());
+    CPPUNIT_ASSERT(bp::pkg::packString(m_keyFile, m_certFile, s_testPassword,
+                                       big, m_bpkgPath));
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(m_bpkgPath, magic));
+    CPPUNIT_ASSERT(magic.compare(0, 4, "BPLB") != 0);
+
+    bp::pkg::setBlockCompression(true);
+    bool packed = bp::pkg::packString(m_keyFile, m_certFile, s_testPassword,
+                                      big, m_bpkgPath);
+    bp::pkg::setBlockCompression(false);
+    CPPUNIT_ASSERT(packed);
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(m_bpkgPath, magic));
+    CPPUNIT_ASSERT(magic.compare(0, 4, "BPLB") == 0);
+
+    std::string err, out;
+    BPTime ts;
+    CPPUNIT_ASSERT(bp::pkg::unpackToString(m_bpkgPath, out, ts, err,
+                                           m_certFile));
+    CPPUNIT_ASSERT(out == big);
+}
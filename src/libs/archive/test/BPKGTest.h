@@ -42,6 +42,12 @@ class BPKGTest : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST(testDirectoryRoundTrip);
     CPPUNIT_TEST(testFileRoundTrip);
     CPPUNIT_TEST(testStringRoundTrip);
+    CPPUNIT_TEST(testDeltaRoundTrip);
+    CPPUNIT_TEST(testDeltaBaseMismatch);
+#ifndef WIN32
+    CPPUNIT_TEST(testDeltaSymlinks);
+#endif
+    CPPUNIT_TEST(testBlockCompressionOptIn);
     CPPUNIT_TEST_SUITE_END();
     
   public:
@@ -52,6 +58,12 @@ class BPKGTest : public CPPUNIT_NS::TestCase
     void testDirectoryRoundTrip();
     void testFileRoundTrip();
     void testStringRoundTrip();
+    void testDeltaRoundTrip();
+    void testDeltaBaseMismatch();
+#ifndef WIN32
+    void testDeltaSymlinks();
+#endif
+    void testBlockCompressionOptIn();
     
   private:
     boost::filesystem::path m_baseDirPath;
@@ -64,3 +64,140 @@ void LZMATest::testRoundTrip()
         decompressed = out.str();
     }
 }
+
+// a few hundred KB of mildly compressible data
+static std::string
+blocksTestData()
+{
+    std::string s;
+    for (unsigned int i = 0; s.size() < 300 * 1024; i++) {
+        std::stringstream ss;
+        ss << "line " << i << " " << (i * 2654435761u) << "\n";
+        s.append(ss.str());
+    }
+    return s;
+}
+
+static std::string
+blocksCompress(const std::string& orig, unsigned int threads)
+{
+    bp::lzma::Compress c;
+    std::istringstream in(orig);
+    std::ostringstream out(std::ios_base::binary | std::ios_base::out);
+    c.setInputStream(in);
+    c.setOutputStream(out);
+    c.setBlockSize(64 * 1024);
+    c.setThreads(threads);
+    CPPUNIT_ASSERT(c.run(bp::lzma::BLOCKS));
+    return out.str();
+}
+
+void LZMATest::testBlocksRoundTrip()
+{
+    std::string orig = blocksTestData();
+
+    // output doesn't depend on the number of threads
+    std::string compressed = blocksCompress(orig, 1);
+    CPPUNIT_ASSERT(compressed == blocksCompress(orig, 4));
+    CPPUNIT_ASSERT(compressed.size() < orig.size());
+
+    // a plain LZIP decompress recognizes the container
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+        bp::lzma::Decompress d;
+        std::istringstream in(compressed);
+        std::stringstream out;
+        d.setInputStream(in);
+        d.setOutputStream(out);
+        d.setThreads(threads);
+        CPPUNIT_ASSERT(d.run());
+        CPPUNIT_ASSERT(out.str() == orig);
+    }
+}
+
+void LZMATest::testBlocksTruncated()
+{
+    std::string compressed = blocksCompress(blocksTestData(), 2);
+
+    // missing terminator
+    {
+        bp::lzma::Decompress d;
+        std::istringstream in(compressed.substr(0, compressed.size() - 8));
+        std::stringstream out;
+        d.setInputStream(in);
+        d.setOutputStream(out);
+        CPPUNIT_ASSERT(!d.run(bp::lzma::BLOCKS));
+    }
+
+    // short block
+    {
+        bp::lzma::Decompress d;
+        std::istringstream in(compressed.substr(0, compressed.size() / 2));
+        std::stringstream out;
+        d.setInputStream(in);
+        d.setOutputStream(out);
+        CPPUNIT_ASSERT(!d.run(bp::lzma::BLOCKS));
+    }
+}
+
+static bool
+blocksDecompress(const std::string& compressed, std::string& out)
+{
+    bp::lzma::Decompress d;
+    std::istringstream in(compressed);
+    std::stringstream os;
+    d.setInputStream(in);
+    d.setOutputStream(os);
+    bool rv = d.run(bp::lzma::BLOCKS);
+    out = os.str();
+    return rv;
+}
+
+static void
+putU32(std::string& s, size_t offset, unsigned int v)
+{
+    s[offset] = (char) (v >> 24);
+    s[offset + 1] = (char) (v >> 16);
+    s[offset + 2] = (char) (v >> 8);
+    s[offset + 3] = (char) v;
+}
+
+void LZMATest::testBlocksCorruptSizes()
+{
+    std::string compressed = blocksCompress(blocksTestData(), 2);
+    std::string out;
+
+    // header: magic, version, block size, then the first block's
+    // raw and packed sizes
+    const size_t blockSizeAt = 5, rawSizeAt = 9, packedSizeAt = 13;
+
+    // a block size beyond the cap is refused before anything is
+    // allocated for it
+    std::string s = compressed;
+    putU32(s, blockSizeAt, 0xffffffff);
+    CPPUNIT_ASSERT(!blocksDecompress(s, out));
+    CPPUNIT_ASSERT(out.empty());
+    s = compressed;
+    putU32(s, blockSizeAt, bp::lzma::kMaxBlockSize + 1);
+    CPPUNIT_ASSERT(!blocksDecompress(s, out));
+
+    // a packed size beyond what the block size allows
+    s = compressed;
+    putU32(s, packedSizeAt, 0x7fffffff);
+    CPPUNIT_ASSERT(!blocksDecompress(s, out));
+
+    // a block that decodes to more than its header claims is cut
+    // off rather than written out
+    s = compressed;
+    putU32(s, rawSizeAt, 16);
+    CPPUNIT_ASSERT(!blocksDecompress(s, out));
+    CPPUNIT_ASSERT(out.empty());
+
+    // compressing with an oversize block size fails too
+    bp::lzma::Compress c;
+    std::istringstream in("data");
+    std::ostringstream os;
+    c.setInputStream(in);
+    c.setOutputStream(os);
+    c.setBlockSize(bp::lzma::kMaxBlockSize + 1);
+    CPPUNIT_ASSERT(!c.run(bp::lzma::BLOCKS));
+}
@@ -39,10 +39,16 @@ class LZMATest : public CPPUNIT_NS::TestCase
 {
     CPPUNIT_TEST_SUITE(LZMATest);
     CPPUNIT_TEST(testRoundTrip);
+    CPPUNIT_TEST(testBlocksRoundTrip);
+    CPPUNIT_TEST(testBlocksTruncated);
+    CPPUNIT_TEST(testBlocksCorruptSizes);
     CPPUNIT_TEST_SUITE_END();
     
 protected:
     void testRoundTrip();
+    void testBlocksRoundTrip();
+    void testBlocksTruncated();
+    void testBlocksCorruptSizes();
 };
 
 #endif
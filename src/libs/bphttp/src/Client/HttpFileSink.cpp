@@ -0,0 +1,149 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  HttpFileSink.cpp
+ *
+ *  Implements FileSink.
+ *
+ *  Copyright 2010 Yahoo! Inc. All rights reserved.
+ *
+ */
+#include "HttpFileSink.h"
+#include "BPUtils/BPLog.h"
+
+
+namespace bp {
+namespace http {
+namespace client {
+
+
+FileSink::FileSink() :
+    m_path(),
+    m_stream(),
+    m_hasher(),
+    m_size( 0 ),
+    m_failed( false )
+{
+}
+
+
+FileSink::~FileSink()
+{
+    discard();
+}
+
+
+bool
+FileSink::open( const boost::filesystem::path& path )
+{
+    discard();
+
+    try {
+        boost::filesystem::create_directories( path.parent_path() );
+    } catch (const boost::filesystem::filesystem_error& e) {
+        BPLOG_WARN_STRM( "unable to create " << path.parent_path()
+                         << ": " << e.what() );
+        return false;
+    }
+
+    m_path = path;
+    return restart();
+}
+
+
+bool
+FileSink::restart()
+{
+    if (m_path.empty()) return false;
+
+    if (m_stream.is_open()) m_stream.close();
+    m_stream.clear();
+    m_hasher.reset();
+    m_size = 0;
+    m_failed = false;
+
+    if (!bp::file::openWritableStream( m_stream, m_path,
+                                       std::ios::out | std::ios::binary
+                                       | std::ios::trunc ))
+    {
+        BPLOG_WARN_STRM( "unable to open " << m_path << " for writing" );
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+
+bool
+FileSink::write( const unsigned char* pBytes, unsigned int size )
+{
+    if (m_failed || !m_stream.is_open()) return false;
+
+    m_stream.write( (const char*) pBytes, size );
+    if (!m_stream.good()) {
+        BPLOG_WARN_STRM( "write to " << m_path << " failed after "
+                         << m_size << " bytes" );
+        m_failed = true;
+        return false;
+    }
+    m_hasher.update( pBytes, size );
+    m_size += size;
+    return true;
+}
+
+
+bool
+FileSink::close()
+{
+    if (m_stream.is_open()) {
+        m_stream.close();
+        if (m_stream.fail()) m_failed = true;
+    }
+    return !m_failed && !m_path.empty();
+}
+
+
+void
+FileSink::discard()
+{
+    if (m_stream.is_open()) m_stream.close();
+    if (!m_path.empty()) {
+        (void) bp::file::safeRemove( m_path );
+        m_path = boost::filesystem::path();
+    }
+    m_hasher.reset();
+    m_size = 0;
+    m_failed = false;
+}
+
+
+bool
+FileSink::isOpen() const
+{
+    return m_stream.is_open();
+}
+
+
+} // namespace client
+} // namespace http
+} // namespace bp
@@ -0,0 +1,105 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  HttpFileSink.h
+ *
+ *  Declares FileSink, which streams a response body to disk.
+ *
+ *  Copyright 2010 Yahoo! Inc. All rights reserved.
+ *
+ */
+#ifndef _HTTPFILESINK_H_
+#define _HTTPFILESINK_H_
+
+#include <fstream>
+#include <string>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsha256.h"
+
+
+namespace bp {
+namespace http {
+namespace client {
+
+// Writes a response body to a file as it arrives rather than holding it
+// in memory, so that a listener's memory use doesn't grow with the size
+// of what it downloads.  The size and SHA-256 digest of the body are
+// computed along the way.  A listener feeds the sink from
+// onResponseBodyBytes() in place of appending to its response body.
+//
+// The sink owns its file, which is removed by discard() or on
+// destruction.
+class FileSink
+{
+public:
+    FileSink();
+    ~FileSink();
+
+    // Begin writing to path, truncating it and creating its parent
+    // directory if needed.  Any file previously open is discarded.
+    // Returns false if the file can't be opened.
+    bool open( const boost::filesystem::path& path );
+
+    // Truncate the open file and start over, for when a listener is
+    // told to discard body bytes it has already received.
+    bool restart();
+
+    // Append bytes.  Returns false once any write has failed.
+    bool write( const unsigned char* pBytes, unsigned int size );
+
+    // Flush and close the file, which stays on disk until discard().
+    // Returns false if any write failed.
+    bool close();
+
+    // Close and remove the file.
+    void discard();
+
+    bool isOpen() const;
+
+    const boost::filesystem::path& path() const { return m_path; }
+
+    // bytes written since open() or restart()
+    unsigned long long size() const { return m_size; }
+
+    // lowercase hex SHA-256 of the bytes written so far
+    std::string digest() const { return m_hasher.digest(); }
+
+private:
+    boost::filesystem::path m_path;
+    std::ofstream m_stream;
+    bp::sha256::Hasher m_hasher;
+    unsigned long long m_size;
+    bool m_failed;
+
+    // no copy/assign semantics, declared but not defined
+    FileSink( const FileSink& );
+    FileSink& operator=( const FileSink& );
+};
+
+
+} // namespace client
+} // namespace http
+} // namespace bp
+
+
+#endif // _HTTPFILESINK_H_
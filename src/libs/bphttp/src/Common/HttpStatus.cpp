@@ -71,6 +71,7 @@ std::string Status::codeToString( Code code )
         case 409:   return "Conflict";
         case 410:   return "Gone";
         case 411:   return "Length required";
+        case 416:   return "Requested range not satisfiable";
         case 500:   return "Internal error";
         case 501:   return "Not implemented";
         case 502:   return "Bad gateway";
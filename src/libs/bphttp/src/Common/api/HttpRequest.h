@@ -32,6 +32,8 @@
 #ifndef _HTTPREQUEST_H_
 #define _HTTPREQUEST_H_
 
+#include <map>
+#include <string>
 #include "BPUtils/bptr1.h"
 #include "BPUtils/bpurl.h"
 #include "HttpBody.h"
@@ -64,6 +66,10 @@ struct Request
     Version         version;
     Headers         headers;
     Body            body;
+
+    // path segments captured by the server's route for this request,
+    // keyed by name (see bp::http::server::Router)
+    std::map<std::string, std::string> params;
 }; // Request
 
 typedef std::tr1::shared_ptr<Request> RequestPtr;
@@ -78,6 +78,7 @@ public:
         CONFLICT                = 409,
         GONE                    = 410,
         LENGTH_REQUIRED         = 411,
+        RANGE_NOT_SATISFIABLE   = 416,
 
         // server error
         INTERNAL_ERROR          = 500,
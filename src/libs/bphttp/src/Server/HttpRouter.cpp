@@ -0,0 +1,289 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * HttpRouter.cpp  - Maps request paths to the handlers mounted on them.
+ */
+
+#include "HttpRouter.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace bp {
+namespace http {
+namespace server {
+
+
+struct Router::Node
+{
+    typedef string::const_iterator Iter;
+    typedef vector<pair<string, Node*> > Literals;
+
+    Node() : handler( NULL ), param( NULL ), wild( NULL ),
+             tailHandler( NULL ) {}
+
+    ~Node()
+    {
+        Literals::iterator it;
+        for (it = literals.begin(); it != literals.end(); ++it) {
+            delete it->second;
+        }
+        delete param;
+        delete wild;
+    }
+
+    // orders literals against a segment of the path being matched,
+    // so lookup needn't copy the segment out
+    struct SegmentLess
+    {
+        typedef pair<Iter, Iter> Segment;
+        bool operator()( const Literals::value_type& l,
+                         const Segment& s ) const
+        {
+            return lexicographical_compare( l.first.begin(), l.first.end(),
+                                            s.first, s.second );
+        }
+        bool operator()( const Segment& s,
+                         const Literals::value_type& l ) const
+        {
+            return lexicographical_compare( s.first, s.second,
+                                            l.first.begin(), l.first.end() );
+        }
+    };
+
+    // the literal child for the segment [b, e), if any
+    const Node* literal( Iter b, Iter e ) const
+    {
+        SegmentLess::Segment s( b, e );
+        Literals::const_iterator it = lower_bound( literals.begin(),
+                                                   literals.end(), s,
+                                                   SegmentLess() );
+        if (it == literals.end() || SegmentLess()( s, *it )) {
+            return NULL;
+        }
+        return it->second;
+    }
+
+    // the literal child for seg, created if need be
+    Node* addLiteral( const string& seg )
+    {
+        SegmentLess::Segment s( seg.begin(), seg.end() );
+        Literals::iterator it = lower_bound( literals.begin(),
+                                             literals.end(), s,
+                                             SegmentLess() );
+        if (it == literals.end() || it->first.compare( seg )) {
+            it = literals.insert( it, make_pair( seg, new Node ) );
+        }
+        return it->second;
+    }
+
+    // handler for a path ending at this node
+    IHandler* handler;
+
+    // children, in order of preference.  literals are kept sorted.
+    Literals literals;
+    Node* param;
+    string paramName;
+    Node* wild;
+
+    // handler for any path continuing past this node ("/x/*")
+    IHandler* tailHandler;
+};
+
+
+// Split a path into its non-empty segments.
+static vector<string>
+segments( const string& path )
+{
+    vector<string> segs;
+    size_t pos = 0;
+    while (pos < path.length()) {
+        size_t end = path.find( '/', pos );
+        if (end == string::npos) {
+            end = path.length();
+        }
+        if (end > pos) {
+            segs.push_back( path.substr( pos, end - pos ) );
+        }
+        pos = end + 1;
+    }
+    return segs;
+}
+
+
+Router::Router() :
+    m_root( new Node ),
+    m_size( 0 )
+{
+}
+
+
+Router::~Router()
+{
+    delete m_root;
+}
+
+
+bool
+Router::add( const string& pattern, IHandler* h )
+{
+    if (h == NULL) {
+        return false;
+    }
+
+    vector<string> segs = segments( pattern );
+    Node* node = m_root;
+    for (size_t i = 0; i < segs.size(); ++i) {
+        const string& seg = segs[i];
+        bool last = (i + 1 == segs.size());
+
+        if (!seg.compare( "*" ) && last) {
+            if (node->tailHandler == NULL) {
+                m_size++;
+            }
+            node->tailHandler = h;
+            return true;
+        }
+
+        if (!seg.compare( "*" )) {
+            if (node->wild == NULL) {
+                node->wild = new Node;
+            }
+            node = node->wild;
+        } else if (seg[0] == ':') {
+            string name = seg.substr( 1 );
+            if (name.empty()) {
+                return false;
+            }
+            if (node->param == NULL) {
+                node->param = new Node;
+                node->paramName = name;
+            } else if (node->paramName.compare( name )) {
+                // one name per position, else captures are ambiguous
+                return false;
+            }
+            node = node->param;
+        } else {
+            node = node->addLiteral( seg );
+        }
+    }
+
+    if (node->handler == NULL) {
+        m_size++;
+    }
+    node->handler = h;
+    return true;
+}
+
+
+IHandler*
+Router::find( const string& path, Params& params ) const
+{
+    typedef Node::Iter Iter;
+    typedef pair<const string*, Node::SegmentLess::Segment> Capture;
+
+    params.clear();
+
+    // parameters captured on the way down, copied out only once the
+    // walk has settled on a handler
+    vector<Capture> captures;
+
+    // the deepest "/x/*" passed, which takes the path should the walk
+    // dead end further on
+    const Node* tail = NULL;
+    Iter tailPos = path.end();
+    size_t tailCaptures = 0;
+
+    const Node* node = m_root;
+    Iter pos = path.begin();
+    IHandler* h = NULL;
+    while (true) {
+        while (pos != path.end() && *pos == '/') {
+            ++pos;
+        }
+
+        if (pos == path.end()) {
+            if (node->handler) {
+                h = node->handler;
+            } else if (node->tailHandler) {
+                h = node->tailHandler;
+                params["*"] = string();
+            }
+            break;
+        }
+
+        if (node->tailHandler) {
+            tail = node;
+            tailPos = pos;
+            tailCaptures = captures.size();
+        }
+
+        Iter end = std::find( pos, path.end(), '/' );
+
+        // one child per segment, chosen by precedence and never
+        // revisited
+        const Node* next = node->literal( pos, end );
+        if (next == NULL && node->param) {
+            captures.push_back( Capture( &node->paramName,
+                                         Node::SegmentLess::Segment( pos,
+                                                                     end ) ) );
+            next = node->param;
+        }
+        if (next == NULL) {
+            next = node->wild;
+        }
+        if (next == NULL) {
+            break;
+        }
+        node = next;
+        pos = end;
+    }
+
+    if (h == NULL) {
+        if (tail == NULL) {
+            return NULL;
+        }
+        h = tail->tailHandler;
+        captures.resize( tailCaptures );
+        params["*"] = string( tailPos, path.end() );
+    }
+
+    for (size_t i = 0; i < captures.size(); ++i) {
+        params[*captures[i].first] = string( captures[i].second.first,
+                                             captures[i].second.second );
+    }
+    return h;
+}
+
+
+size_t
+Router::size() const
+{
+    return m_size;
+}
+
+
+} // server
+} // http
+} // bp
@@ -25,15 +25,22 @@
 
 #include "HttpServer.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include "BPUtils/BPLog.h"
+#include "BPUtils/bpfile.h"
 #include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
 #include "BPUtils/bptime.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpRouter.h"
 #include "mongoose/mongoose.h"
 
 using namespace std;
@@ -69,10 +76,8 @@ private:
 
     State       m_state;
     mg_context* m_pCtx;
-	std::map<const std::string, IHandler*> m_callbacks;
-	static std::map<const std::string, IHandler*> s_callbacks;
+    Router      m_router;
 };
-std::map<const std::string, IHandler*> Server::Impl::s_callbacks;
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -87,7 +92,8 @@ Server::Impl::Impl() :
       "listening_ports", "0",
       NULL
     };
-    m_pCtx = mg_create(&Server::Impl::handlerCallback, NULL, options);
+    // we're handed back to handlerCallback as the request's user_data
+    m_pCtx = mg_create(&Server::Impl::handlerCallback, this, options);
     if (!m_pCtx) {
         BPLOG_ERROR( "mg_create failed." );
         return;
@@ -137,7 +143,10 @@ Server::Impl::mount( const string& uriRegex, IHandler* h )
         return false;
     }
 
-	m_callbacks[uriRegex] = h;
+    if (!m_router.add( uriRegex, h )) {
+        BPLOG_ERROR_STRM( "Malformed route " << uriRegex );
+        return false;
+    }
     BPLOG_INFO_STRM( h << " mounted for " << uriRegex );
     
     return true;
@@ -152,12 +161,6 @@ Server::Impl::start()
         return false;
     }
     
-	// Enable our instance's URI handlers in static callback.
-	Server::Impl::s_callbacks.clear();
-	for (std::map<const std::string, IHandler*>::const_iterator iter = m_callbacks.begin(); iter != m_callbacks.end(); iter++) {
-		Server::Impl::s_callbacks[iter->first] = iter->second;
-	}
-
     if (!mg_start( m_pCtx )) {
         BPLOG_ERROR( "mg_start failed." );
         return false;
@@ -179,14 +182,305 @@ Server::Impl::stop()
 
     mg_stop( m_pCtx );
 
-	// Disable our instance's URI handlers in static callback.
-	Server::Impl::s_callbacks.clear();
-
     m_state = stopped;
     return true;
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+// Request and response bodies
+//
+
+// bytes written per packet, unless the handler shapes packets otherwise
+static const unsigned int s_packetBytes = 64 * 1024;
+
+
+// The body of the request being handled, read from the connection
+// only as the handler asks for it.
+class ConnectionBody : public IRequestBody
+{
+public:
+    ConnectionBody( struct mg_connection* conn ) :
+        m_conn( conn ), m_length( 0 ), m_read( 0 )
+    {
+        const char* cl = mg_get_header( conn, "Content-Length" );
+        if (cl != NULL) {
+            m_length = strtoull( cl, NULL, 10 );
+        }
+    }
+
+    unsigned long long length() const
+    {
+        return m_length;
+    }
+
+    int read( unsigned char* buf, unsigned int len )
+    {
+        if (m_read >= m_length) {
+            return 0;
+        }
+        if (len > m_length - m_read) {
+            len = (unsigned int) (m_length - m_read);
+        }
+        int n = mg_read( m_conn, buf, len );
+        if (n <= 0) {
+            BPLOG_WARN_STRM( "request body ended after " << m_read <<
+                             " of " << m_length << " bytes." );
+            m_read = m_length;
+            return -1;
+        }
+        m_read += n;
+        return n;
+    }
+
+    // Discard whatever the handler left unread so the connection is
+    // positioned at the next request.
+    void drain()
+    {
+        unsigned char buf[4096];
+        while (read( buf, sizeof(buf) ) > 0) {
+            // empty
+        }
+    }
+
+private:
+    struct mg_connection* m_conn;
+    unsigned long long m_length;
+    unsigned long long m_read;
+};
+
+
+// A file, or a byte range of one, read from disk as it's sent.
+class FileSource : public IBodySource
+{
+public:
+    FileSource() : m_length( 0 ), m_left( 0 ) {}
+
+    bool open( const boost::filesystem::path& path,
+               unsigned long long first, unsigned long long length )
+    {
+        if (!bp::file::openReadableStream( m_stream, path,
+                                           ios::in | ios::binary )) {
+            return false;
+        }
+        m_stream.seekg( (streamoff) first );
+        m_length = m_left = length;
+        return !m_stream.fail();
+    }
+
+    long long length()
+    {
+        return (long long) m_length;
+    }
+
+    int read( unsigned char* buf, unsigned int len )
+    {
+        if (m_left == 0) {
+            return 0;
+        }
+        if (len > m_left) {
+            len = (unsigned int) m_left;
+        }
+        m_stream.read( (char*) buf, len );
+        int n = (int) m_stream.gcount();
+        if (n <= 0) {
+            return -1;
+        }
+        m_left -= n;
+        return n;
+    }
+
+private:
+    ifstream m_stream;
+    unsigned long long m_length;
+    unsigned long long m_left;
+};
+
+
+// Parse a Range header naming a single byte range ("bytes=a-b",
+// "bytes=a-" or "bytes=-n").  Returns false if it's not one we honor,
+// in which case the whole body is sent.  Otherwise satisfiable says
+// whether the range overlaps a body of the given size, and first and
+// last are the inclusive offsets to send.
+static bool
+parseRange( const string& header, unsigned long long size,
+            unsigned long long& first, unsigned long long& last,
+            bool& satisfiable )
+{
+    static const string unit( "bytes=" );
+    if (header.compare( 0, unit.length(), unit )) {
+        return false;
+    }
+    string spec = header.substr( unit.length() );
+    size_t dash = spec.find( '-' );
+    if (dash == string::npos || spec.find( ',' ) != string::npos) {
+        return false;
+    }
+
+    string a = spec.substr( 0, dash );
+    string b = spec.substr( dash + 1 );
+    if (a.find_first_not_of( "0123456789" ) != string::npos ||
+        b.find_first_not_of( "0123456789" ) != string::npos ||
+        (a.empty() && b.empty())) {
+        return false;
+    }
+
+    if (a.empty()) {
+        // suffix range, the last n bytes
+        unsigned long long n = strtoull( b.c_str(), NULL, 10 );
+        satisfiable = (n > 0 && size > 0);
+        if (satisfiable) {
+            first = n < size ? size - n : 0;
+            last = size - 1;
+        }
+        return true;
+    }
+
+    first = strtoull( a.c_str(), NULL, 10 );
+    last = b.empty() ? size - 1 : strtoull( b.c_str(), NULL, 10 );
+    if (!b.empty() && last < first) {
+        return false;
+    }
+    satisfiable = first < size;
+    if (satisfiable && last >= size) {
+        last = size - 1;
+    }
+    return true;
+}
+
+
+// Prepare to stream a file backed response body from disk, applying
+// the request's Range to successful responses.  Returns NULL if the
+// file can't be read.
+static BodySourcePtr
+fileSource( const Request& req, Response& resp )
+{
+    boost::filesystem::path path = resp.body.path();
+    unsigned long long size = bp::file::size( path );
+    unsigned long long first = 0;
+    unsigned long long length = size;
+
+    if (resp.status.code() == Status::OK) {
+        resp.headers.add( "Accept-Ranges", "bytes" );
+
+        string range;
+        unsigned long long last = 0;
+        bool satisfiable = false;
+        if (req.headers.find( "Range", range ) &&
+            parseRange( range, size, first, last, satisfiable )) {
+            stringstream ss;
+            if (satisfiable) {
+                resp.status.setCode( Status::PARTIAL_CONTENT );
+                ss << "bytes " << first << "-" << last << "/" << size;
+                length = last - first + 1;
+            } else {
+                resp.status.setCode( Status::RANGE_NOT_SATISFIABLE );
+                ss << "bytes */" << size;
+                first = length = 0;
+            }
+            resp.headers.add( "Content-Range", ss.str() );
+        }
+    }
+
+    FileSource* fs = new FileSource;
+    BodySourcePtr source( fs );
+    if (!fs->open( path, first, length )) {
+        BPLOG_ERROR_STRM( "unable to read response body from " << path );
+        return BodySourcePtr();
+    }
+    return source;
+}
+
+
+// Whether the client will reuse the connection for another request.
+static bool
+wantsKeepAlive( struct mg_connection* conn,
+                const struct mg_request_info* request_info )
+{
+    const char* connection = mg_get_header( conn, "Connection" );
+    if (connection != NULL) {
+        return !bp::strutil::toLower( connection ).compare( "keep-alive" );
+    }
+    return !strcmp( safeStr( request_info->http_version ).c_str(), "1.1" );
+}
+
+
+// Send a response body a packet at a time, offering the handler the
+// chance to shape each packet.  Bodies are either in memory or read
+// from a source.  Returns false if the body couldn't be sent whole.
+static bool
+sendBody( struct mg_connection* conn, IHandler* hndlr,
+          const Body& body, IBodySource* source, bool chunked )
+{
+    bp::time::Stopwatch sw;
+    sw.start();
+
+    vector<unsigned char> buf;
+    unsigned int packetsSent = 0;
+    unsigned long long bytesSent = 0;
+    size_t memSize = source ? 0 : body.size();
+
+    for (;;) {
+        unsigned int packetBytes = s_packetBytes;
+        double packetDelaySec = 0.0;
+        if (hndlr->shapePacket( packetsSent, (unsigned int) bytesSent,
+                                sw.elapsedSec(), packetBytes,
+                                packetDelaySec )) {
+            if (packetBytes == 0) {
+                packetBytes = s_packetBytes;
+            }
+            if (packetDelaySec > 0) {
+                bp::time::sleepSec( packetDelaySec );
+            }
+        }
+
+        const unsigned char* data = NULL;
+        int n = 0;
+        if (source) {
+            if (buf.size() < packetBytes) {
+                buf.resize( packetBytes );
+            }
+            n = source->read( &buf[0], packetBytes );
+            if (n < 0) {
+                BPLOG_ERROR_STRM( "response body source failed after " <<
+                                  bytesSent << " bytes." );
+                return false;
+            }
+            data = &buf[0];
+        } else {
+            size_t left = memSize - (size_t) bytesSent;
+            n = (int) (left < packetBytes ? left : packetBytes);
+            if (n) {
+                data = body.elementAddr( (int) bytesSent );
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+
+        if (chunked) {
+            mg_printf( conn, "%x\r\n", n );
+        }
+        int nSent = mg_write( conn, data, n );
+        if (nSent != n) {
+            BPLOG_ERROR_STRM( "mg_write sent " << nSent << " of " <<
+                              n << " bytes." );
+            return false;
+        }
+        if (chunked) {
+            mg_printf( conn, "\r\n" );
+        }
+        bytesSent += n;
+        packetsSent++;
+    }
+
+    if (chunked) {
+        mg_printf( conn, "0\r\n\r\n" );
+    }
+    return true;
+}
+
+
 void *
 Server::Impl::handlerCallback( enum mg_event event,
                                struct mg_connection *conn,
@@ -196,17 +490,17 @@ Server::Impl::handlerCallback( enum mg_event event,
         return NULL;
     }
 
-	std::map<const std::string, IHandler*>::const_iterator iter = Server::Impl::s_callbacks.find(request_info->uri);
-    if (iter == Server::Impl::s_callbacks.end()) {
-		iter = Server::Impl::s_callbacks.find("*");
-		if (iter == Server::Impl::s_callbacks.end()) {
-			return NULL;
-		}
-    }
+    Server::Impl* self = (Server::Impl*) request_info->user_data;
 
     /////////////////////////////////////////////
     // Setup request object for our handler.
     Request req;
+
+    IHandler* hndlr = self->m_router.find( safeStr( request_info->uri ),
+                                           req.params );
+    if (hndlr == NULL) {
+        return NULL;
+    }
     
     req.method = safeStr( request_info->request_method );
     
@@ -227,30 +521,50 @@ Server::Impl::handlerCallback( enum mg_event event,
                          safeStr( request_info->http_headers[i].value ) );
     }
 
-    const char *cl;
-    if (strcmp(request_info->request_method, "POST") == 0 &&
-        (cl = mg_get_header(conn, "Content-Length")) != NULL) {
-        int len = atoi(cl);
-        char *buf = (char*)malloc(len);
-        if (buf != NULL) {
-            mg_read(conn, buf, len);
-            //mg_write(conn, buf, len);
-            req.body.assign( (unsigned char*)buf, len );
-            free(buf);
-        }
-    }
+    // The request body is left on the connection for the handler.
+    ConnectionBody reqBody( conn );
 
     /////////////////////////////////
     // Call our mounted handler.
-    IHandler* hndlr = iter->second;
     Response resp;
-    bool bRet = hndlr->processRequest( req, resp );
+    BodySourcePtr source;
+    bool bRet = hndlr->processStreamingRequest( req, reqBody, resp, source );
+    reqBody.drain();
     if (!bRet) {
         BPLOG_ERROR( "handler processRequest failed." );
         BPLOG_ERROR( "Returning 500 Internal Error" );
-        mg_printf( conn, "HTTP/1.0 500 Internal Error\r\n");
+        mg_printf( conn, "HTTP/1.1 500 Internal Error\r\n"
+                   "Content-Length: 0\r\n\r\n" );
+        return conn;
+    }
+
+    // A file backed body is streamed from disk.  A file that's gone
+    // is a 404, one we can't read a 500, rather than an empty 200.
+    if (!source && !resp.body.path().empty()) {
+        if (!bp::file::isRegularFile( resp.body.path() )) {
+            BPLOG_WARN_STRM( "response file " << resp.body.path()
+                             << " not found" );
+            resp.status.setCode( Status::NOT_FOUND );
+            resp.headers = Headers();
+            resp.body = Body();
+        } else {
+            source = fileSource( req, resp );
+            if (!source) {
+                resp.status.setCode( Status::INTERNAL_ERROR );
+                resp.headers = Headers();
+                resp.body = Body();
+            }
+        }
     }
 
+    // Bodies of unknown length are chunked for HTTP/1.1 clients, and
+    // delimited by closing the connection for others.
+    long long length = source ? source->length() : (long long) resp.body.size();
+    bool http11 = !strcmp( safeStr( request_info->http_version ).c_str(), "1.1" );
+    bool chunked = (length < 0 && http11);
+    bool keepAlive = wantsKeepAlive( conn, request_info ) &&
+                     (length >= 0 || chunked);
+
     //////////////////////////
     // Send the response.
     mg_printf( conn, "%s %s\r\n",
@@ -261,23 +575,22 @@ Server::Impl::handlerCallback( enum mg_event event,
 
     // Add headers we always send.
     ss.str(""); // reset
-    ss << "Content-Length: " << resp.body.size() << "\r\n";
+    if (chunked) {
+        ss << "Transfer-Encoding: chunked" << "\r\n";
+    } else if (length >= 0) {
+        ss << "Content-Length: " << length << "\r\n";
+    }
+    ss << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n";
     ss << "Server: BrowserPlus embedded webserver" << "\r\n";
     mg_printf( conn, "%s", ss.str().c_str() );
     
     // Add end-of-headers separator.
     mg_printf( conn, "\r\n" );
 
-    // TODO: support IHandler::shapePacket?
-
     // Send body.
-    int nBodySize = (int) resp.body.size();
-    if (nBodySize) {
-        int nSent = mg_write( conn, resp.body.elementAddr(0), nBodySize );
-        if (nSent != nBodySize) {
-            BPLOG_ERROR_STRM( "mg_write sent " << nSent << " of " <<
-                              nBodySize << " bytes." );
-        }
+    if (!sendBody( conn, hndlr, resp.body, source.get(), chunked )) {
+        BPLOG_ERROR( "Response incomplete." );
+        return conn;
     }
 
     BPLOG_DEBUG( "Response complete." );
@@ -285,6 +598,33 @@ Server::Impl::handlerCallback( enum mg_event event,
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+// IHandler methods
+//
+
+bool
+IHandler::processStreamingRequest( const Request& request,
+                                   IRequestBody& body,
+                                   Response& response,
+                                   BodySourcePtr& /*source*/ )
+{
+    if (body.length() == 0) {
+        return processRequest( request, response );
+    }
+
+    Request req( request );
+    vector<unsigned char> buf( s_packetBytes );
+    int n;
+    while ((n = body.read( &buf[0], (unsigned int) buf.size() )) > 0) {
+        req.body.append( &buf[0], n );
+    }
+    if (n < 0) {
+        return false;
+    }
+    return processRequest( req, response );
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 // Server methods
 //
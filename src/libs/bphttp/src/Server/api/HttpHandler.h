@@ -29,16 +29,61 @@
 #define __HTTP_HANDLER_H__
 
 
+#include "BPUtils/bptr1.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 
 
 namespace bp { namespace http { namespace server {
-  
+
+/**
+ * A request body which is read from the connection as the handler
+ * asks for it, rather than buffered whole before the handler runs.
+ */
+class IRequestBody
+{
+  public:
+    /** the length the client declared for the body, zero if none */
+    virtual unsigned long long length() const = 0;
+
+    /** read up to len bytes of the body into buf.
+     *  \returns bytes read, 0 at the end of the body, -1 on error */
+    virtual int read(unsigned char * buf, unsigned int len) = 0;
+
+    virtual ~IRequestBody() { }
+};
+
+/**
+ * A response body which is produced while it is sent, for bodies
+ * too large or too slow to build in memory.  read() is called on
+ * the server thread handling the request.
+ */
+class IBodySource
+{
+  public:
+    /** the length of the body, or -1 if it's not known in advance,
+     *  in which case it's sent chunked to HTTP/1.1 clients and ended
+     *  by closing the connection for others */
+    virtual long long length() = 0;
+
+    /** fill up to len bytes of buf with the next part of the body.
+     *  \returns bytes written, 0 at the end of the body, -1 on error
+     *            (the response is abandoned) */
+    virtual int read(unsigned char * buf, unsigned int len) = 0;
+
+    virtual ~IBodySource() { }
+};
+
+typedef std::tr1::shared_ptr<IBodySource> BodySourcePtr;
+
 /**
  * the IHandler interface may be implemented by classes wishing
  * to handle incoming HTTP requests.  all response data for the
- * request must be provided synchronously in IHandler::processRequest.
+ * request must be provided synchronously in IHandler::processRequest,
+ * or produced as it's sent by the IBodySource returned from
+ * IHandler::processStreamingRequest.  A response body set with
+ * Body::fromPath() is streamed from disk and byte ranges of it are
+ * served as requested.
  *
  * WARNING: IHandler::processRequest will be invoked on a thread
  *          spawned by the bp::httpserver::Server, so if there's any access
@@ -52,7 +97,7 @@ class IHandler
 {
   public:
     /** process the incoming request, populating the outgoing
-     *  response.  Note async streaming is not supported.
+     *  response.
      *
      *  \returns if false is returned, the server will send a
      *           Internal server error.  For more robust error handlering
@@ -62,6 +107,19 @@ class IHandler
     virtual bool processRequest(const Request & request,
                                 Response & response) = 0;
 
+    /** process an incoming request whose body has not yet been read.
+     *  Handlers accepting large uploads read the body from 'body' as
+     *  they go, handlers producing large or slow responses set
+     *  'source' rather than filling response.body.  The default reads
+     *  the request body into memory and calls processRequest().
+     *
+     *  \returns as processRequest()
+     */
+    virtual bool processStreamingRequest(const Request & request,
+                                         IRequestBody & body,
+                                         Response & response,
+                                         BodySourcePtr & source);
+
     /**
      * offer the handler an oppty to "shape" the response packet.
      * the handler can specify a new packet size and/or an amount of
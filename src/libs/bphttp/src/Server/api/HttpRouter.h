@@ -0,0 +1,86 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * HttpRouter.h  - Maps request paths to the handlers mounted on them.
+ */
+
+#ifndef HTTP_ROUTER_H__
+#define HTTP_ROUTER_H__
+
+#include <map>
+#include <string>
+#include "HttpHandler.h"
+
+
+namespace bp { namespace http { namespace server {
+
+/**
+ * A trie of path segments.  Patterns are '/' separated segments, each
+ * of which is one of:
+ *   literal  - matches itself exactly
+ *   :name    - matches any one segment, captured as params["name"]
+ *   *        - as the last segment, matches the rest of the path
+ *              (including nothing), captured as params["*"].
+ *              Elsewhere, matches any one segment.
+ * The pattern "*" alone matches every path.  Where several patterns
+ * match, literal segments are preferred to parameters, and parameters
+ * to wildcards.  Lookup walks the path once, taking at each segment
+ * the most preferred child that matches and never revisiting that
+ * choice, so it costs time proportional to the path length.  Should
+ * the walk dead end, the path goes to the deepest trailing wildcard it
+ * passed, if any.  Empty segments are ignored, so "/a//b/" is "/a/b".
+ */
+class Router
+{
+public:
+    typedef std::map<std::string, std::string> Params;
+
+    Router();
+    ~Router();
+
+    /** route paths matching pattern to h, replacing any handler
+     *  already mounted on the same pattern.
+     *  \returns false if the pattern is malformed */
+    bool add( const std::string& pattern, IHandler* h );
+
+    /** find the handler for a path, filling params with the segments
+     *  captured by its pattern.
+     *  \returns NULL if no pattern matches */
+    IHandler* find( const std::string& path, Params& params ) const;
+
+    /** the number of patterns mounted */
+    size_t size() const;
+
+private:
+    struct Node;
+    Node* m_root;
+    size_t m_size;
+
+    Router( const Router& );
+    Router& operator=( const Router& );
+};
+
+
+} } } // bp::http::server
+
+#endif
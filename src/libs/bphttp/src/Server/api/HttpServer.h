@@ -51,7 +51,10 @@ public:
 
     /** mount a handler to service incoming requests.  client owns handler
      *  and must ensure that it is not deallocated until after stop()
-     *  is called. */    
+     *  is called.  uriRegex is a Router pattern: literal segments,
+     *  ":name" segments captured into Request::params, and "*" for
+     *  the rest of the path.  Each server routes independently of any
+     *  other in the process. */    
     bool mount( const std::string& uriRegex, IHandler* h );
 
     /** spawn a thread to run the http server.  non-blocking. */
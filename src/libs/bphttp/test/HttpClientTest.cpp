@@ -30,6 +30,7 @@
 
 #include "HttpClientTest.h"
 #include <math.h>
+#include "bphttp/HttpFileSink.h"
 #include "bphttp/HttpQueryString.h"
 #include "bphttp/HttpSyncTransaction.h"
 #include "bphttp/HttpTransaction.h"
@@ -37,6 +38,7 @@
 #include "BPUtils/bpfile.h"
 #include "BPUtils/BPLog.h"
 #include "BPUtils/bprunloop.h"
+#include "BPUtils/bpsha256.h"
 #include "BPUtils/bpstopwatch.h"
 #include "BPUtils/bpurl.h"
 #include "BPUtils/OS.h"
@@ -514,6 +516,85 @@ void HttpClientTest::testBinaryGetAsync()
 }
 
 
+// an async helper who streams the response body to a file rather
+// than collecting it, noting the largest chunk it was handed
+class SinkAsync : public virtual AsyncHttp {
+public:
+    static std::tr1::shared_ptr<SinkAsync> alloc(RequestPtr request,
+                                                 bp::runloop::RunLoop *rl) {
+        std::tr1::shared_ptr<SinkAsync> rval(new SinkAsync(request, rl));
+        return rval;
+    }
+    virtual void onResponseStatus(const Status& status,
+                                  const Headers& headers) {
+        AsyncHttp::onResponseStatus(status, headers);
+        m_sink.restart();
+    }
+    virtual void onResponseBodyBytes(const unsigned char* pBytes,
+                                     unsigned int size) {
+        if (size > m_maxChunk) m_maxChunk = size;
+        m_received += size;
+        m_sink.write(pBytes, size);
+    }
+    FileSink m_sink;
+    unsigned int m_maxChunk;
+    size_t m_received;
+private:
+    SinkAsync(RequestPtr request, bp::runloop::RunLoop *rl)
+    : AsyncHttp(request, rl), m_sink(), m_maxChunk(0), m_received(0) {
+    }
+};
+
+typedef std::tr1::shared_ptr<SinkAsync> SinkAsyncPtr;
+
+void HttpClientTest::testStreamToFileAsync()
+{
+    const int kRespLenKB[] = { 64, 8000 };
+    
+    for (unsigned int i = 0; i < sizeof(kRespLenKB)/sizeof(int); i++) {
+        const size_t kLen = kRespLenKB[i] * 1000;
+        
+        bp::runloop::RunLoop rl;
+        rl.init();
+
+        list<pair<string,string> > lpsFields;
+        lpsFields.push_back(make_pair("respLenKB",toString(kRespLenKB[i])));
+        string sUrl = m_testServer.getShapingUrl() +
+                      bp::url::makeQueryString(lpsFields);
+
+        RequestPtr request(new Request(Method::HTTP_GET, sUrl));
+        SinkAsyncPtr async = SinkAsync::alloc(request, &rl);
+        boost::filesystem::path path =
+            bp::file::getTempPath(bp::file::getTempDirectory(),
+                                  "HttpClientTest");
+        CPPUNIT_ASSERT(async->m_sink.open(path));
+        async->startTransaction();
+        CPPUNIT_ASSERT(async->ok());
+
+        rl.run();
+        CPPUNIT_ASSERT(async->ok());
+        CPPUNIT_ASSERT(async->m_status.code() == Status::OK);
+        CPPUNIT_ASSERT(async->m_sink.close());
+
+        // the whole response came through in chunks which don't grow
+        // with it, and nothing held back any of it
+        CPPUNIT_ASSERT(async->m_maxChunk > 0);
+        CPPUNIT_ASSERT(async->m_maxChunk <= 1000 * 1000);
+        CPPUNIT_ASSERT(async->m_received == kLen);
+
+        // everything handed to the sink arrived on disk, and the
+        // digest computed as it arrived matches
+        CPPUNIT_ASSERT(async->m_sink.size() == async->m_received);
+        CPPUNIT_ASSERT(bp::file::size(path) == kLen);
+        CPPUNIT_ASSERT(async->m_sink.digest() ==
+                       bp::sha256::hash(std::string(kLen, '\0')));
+
+        async->m_sink.discard();
+        CPPUNIT_ASSERT(!bp::file::pathExists(path));
+    }
+}
+
+
 void HttpClientTest::testPost()
 {
     const string ksBody = "A, B, C, it's easy as 1, 2, 3";
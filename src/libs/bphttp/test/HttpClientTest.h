@@ -45,6 +45,7 @@ class HttpClientTest : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST(testNotFound);
     CPPUNIT_TEST(testBinaryGet);
     CPPUNIT_TEST(testBinaryGetAsync);
+    CPPUNIT_TEST(testStreamToFileAsync);
     CPPUNIT_TEST(testRedirect);
     CPPUNIT_TEST(testPost);
     CPPUNIT_TEST(testPostAsync);
@@ -83,6 +84,11 @@ private:
     // Test an async get of binary content.
     void testBinaryGetAsync();
 
+    // Test an async get streamed to a FileSink, verifying the size
+    // and digest and that nothing accumulates in memory regardless
+    // of response size.
+    void testStreamToFileAsync();
+
     // Test we can http POST and get the same body back in response.
     void testPost();
     
@@ -28,11 +28,121 @@
  */
 
 #include "HttpServerTest.h"
+#include <sstream>
 #include "bphttp/HttpServer.h"
+#include "bphttp/HttpSyncTransaction.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bpstrutil.h"
 
+using namespace bp::http;
+using namespace bp::http::client;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(HttpServerTest);
 
+
+// Produces 'length' bytes of a repeating pattern without declaring
+// how many, so they're sent chunked.
+class PatternSource : public bp::http::server::IBodySource
+{
+public:
+    PatternSource(unsigned int length) : m_length(length), m_sent(0) { }
+
+    long long length() { return -1; }
+
+    int read(unsigned char * buf, unsigned int len)
+    {
+        unsigned int i;
+        for (i = 0; i < len && m_sent < m_length; i++, m_sent++) {
+            buf[i] = (unsigned char) (m_sent % 251);
+        }
+        return (int) i;
+    }
+
+private:
+    unsigned int m_length;
+    unsigned int m_sent;
+};
+
+
+class StreamingHandler : public bp::http::server::IHandler
+{
+public:
+    StreamingHandler(const boost::filesystem::path & file)
+        : m_file(file), m_maxRead(0) { }
+
+    bool processRequest(const Request &, Response &)
+    {
+        return false;
+    }
+
+    bool processStreamingRequest(const Request & request,
+                                 bp::http::server::IRequestBody & body,
+                                 Response & response,
+                                 bp::http::server::BodySourcePtr & source)
+    {
+        std::string path = request.url.path();
+        if (!path.compare("/file")) {
+            response.body.fromPath(m_file);
+        } else if (!path.compare("/generated")) {
+            source.reset(new PatternSource(300 * 1024));
+        } else if (!path.compare("/upload")) {
+            // hash the body as it arrives, reporting the largest read
+            bp::sha256::Hasher hasher;
+            unsigned char buf[8192];
+            int n;
+            while ((n = body.read(buf, sizeof(buf))) > 0) {
+                hasher.update(buf, n);
+                if ((unsigned int) n > m_maxRead) m_maxRead = n;
+            }
+            if (n < 0) return false;
+            response.body.assign(hasher.digest());
+        } else {
+            response.status.setCode(Status::NOT_FOUND);
+        }
+        return true;
+    }
+
+    unsigned int maxRead() const { return m_maxRead; }
+
+private:
+    boost::filesystem::path m_file;
+    unsigned int m_maxRead;
+};
+
+
+// Answers every request with a fixed body, and the captured name.
+class NamedHandler : public bp::http::server::IHandler
+{
+public:
+    NamedHandler(const std::string & name) : m_name(name) { }
+
+    bool processRequest(const Request & request, Response & response)
+    {
+        response.body.append(m_name);
+        std::map<std::string, std::string>::const_iterator it =
+            request.params.find("what");
+        if (it != request.params.end()) {
+            response.body.append(":" + it->second);
+        }
+        return true;
+    }
+
+private:
+    std::string m_name;
+};
+
+
+static ResponsePtr
+fetch(RequestPtr req)
+{
+    SyncTransactionPtr tran = SyncTransaction::alloc(req);
+    SyncTransaction::FinalStatus results;
+    ResponsePtr resp = tran->execute(results);
+    CPPUNIT_ASSERT(results.code == SyncTransaction::FinalStatus::eOk);
+    return resp;
+}
+
 void HttpServerTest::startupShutdownTest()
 {
     unsigned short int port = 0;
@@ -86,3 +196,118 @@ void HttpServerTest::bindingTest()
 #endif 
 
 }
+
+void HttpServerTest::streamingTest()
+{
+    // a file larger than a packet, so it goes out in pieces
+    std::string content;
+    for (unsigned int i = 0; i < 200 * 1024; i++) {
+        content.push_back((char) ('a' + (i * 13) % 26));
+    }
+    boost::filesystem::path file =
+        bp::file::getTempPath(bp::file::getTempDirectory(), "HttpServerTest");
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(file, content));
+
+    StreamingHandler handler(file);
+    bp::http::server::Server s;
+    unsigned short int port = 0;
+    CPPUNIT_ASSERT(s.bind(port));
+    CPPUNIT_ASSERT(s.mount("*", &handler));
+    CPPUNIT_ASSERT(s.start());
+
+    std::stringstream base;
+    base << "http://127.0.0.1:" << port;
+
+    // whole file
+    RequestPtr req(new Request(Method::HTTP_GET, base.str() + "/file"));
+    ResponsePtr resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->headers.get("Accept-Ranges") == "bytes");
+    CPPUNIT_ASSERT(resp->body.toString() == content);
+
+    // a range spanning packets
+    req.reset(new Request(Method::HTTP_GET, base.str() + "/file"));
+    req->headers.add("Range", "bytes=60000-139999");
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::PARTIAL_CONTENT);
+    CPPUNIT_ASSERT(resp->body.toString() == content.substr(60000, 80000));
+    std::stringstream cr;
+    cr << "bytes 60000-139999/" << content.size();
+    CPPUNIT_ASSERT(resp->headers.get("Content-Range") == cr.str());
+
+    // suffix range
+    req.reset(new Request(Method::HTTP_GET, base.str() + "/file"));
+    req->headers.add("Range", "bytes=-100");
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::PARTIAL_CONTENT);
+    CPPUNIT_ASSERT(resp->body.toString() ==
+                   content.substr(content.size() - 100));
+
+    // unsatisfiable
+    req.reset(new Request(Method::HTTP_GET, base.str() + "/file"));
+    req->headers.add("Range", "bytes=999999999-");
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::RANGE_NOT_SATISFIABLE);
+    CPPUNIT_ASSERT(resp->body.size() == 0);
+
+    // a body of unknown length is chunked
+    req.reset(new Request(Method::HTTP_GET, base.str() + "/generated"));
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->body.size() == 300 * 1024);
+    for (unsigned int i = 0; i < resp->body.size(); i += 997) {
+        CPPUNIT_ASSERT(*(resp->body.elementAddr(i)) ==
+                       (unsigned char) (i % 251));
+    }
+
+    // an upload is read as it arrives, not handed over whole
+    req.reset(new Request(Method::HTTP_POST, base.str() + "/upload"));
+    req->body.append(content);
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->body.toString() == bp::sha256::hash(content));
+    CPPUNIT_ASSERT(handler.maxRead() <= 8192);
+
+    // a file that's gone is not found, rather than empty
+    CPPUNIT_ASSERT(bp::file::safeRemove(file));
+    req.reset(new Request(Method::HTTP_GET, base.str() + "/file"));
+    resp = fetch(req);
+    CPPUNIT_ASSERT(resp->status.code() == Status::NOT_FOUND);
+    CPPUNIT_ASSERT(resp->body.size() == 0);
+
+    CPPUNIT_ASSERT(s.stop());
+}
+
+void HttpServerTest::twoServersTest()
+{
+    NamedHandler oneAll("one"), oneParam("one-param"), twoAll("two");
+
+    bp::http::server::Server one;
+    unsigned short int onePort = 0;
+    CPPUNIT_ASSERT(one.bind(onePort));
+    CPPUNIT_ASSERT(one.mount("*", &oneAll));
+    CPPUNIT_ASSERT(one.mount("/thing/:what", &oneParam));
+    CPPUNIT_ASSERT(one.start());
+
+    // a second server mounting the same patterns after the first
+    // has started must not take over its routes
+    bp::http::server::Server two;
+    unsigned short int twoPort = 0;
+    CPPUNIT_ASSERT(two.bind(twoPort));
+    CPPUNIT_ASSERT(two.mount("*", &twoAll));
+    CPPUNIT_ASSERT(two.start());
+
+    std::stringstream oneURL, twoURL;
+    oneURL << "http://127.0.0.1:" << onePort;
+    twoURL << "http://127.0.0.1:" << twoPort;
+
+    RequestPtr req(new Request(Method::HTTP_GET, oneURL.str() + "/x"));
+    CPPUNIT_ASSERT(fetch(req)->body.toString() == "one");
+    req.reset(new Request(Method::HTTP_GET, oneURL.str() + "/thing/widget"));
+    CPPUNIT_ASSERT(fetch(req)->body.toString() == "one-param:widget");
+    req.reset(new Request(Method::HTTP_GET, twoURL.str() + "/thing/widget"));
+    CPPUNIT_ASSERT(fetch(req)->body.toString() == "two");
+
+    CPPUNIT_ASSERT(two.stop());
+    CPPUNIT_ASSERT(one.stop());
+}
@@ -39,11 +39,20 @@ class HttpServerTest : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST_SUITE(HttpServerTest);
     CPPUNIT_TEST(startupShutdownTest);
     CPPUNIT_TEST(bindingTest);
+    CPPUNIT_TEST(streamingTest);
+    CPPUNIT_TEST(twoServersTest);
     CPPUNIT_TEST_SUITE_END();
     
 protected:
     void startupShutdownTest();
     void bindingTest();
+
+    // file backed bodies, byte ranges, chunked body sources and
+    // incrementally read request bodies
+    void streamingTest();
+
+    // servers in the same process keep their own routes
+    void twoServersTest();
 };
 
 #endif
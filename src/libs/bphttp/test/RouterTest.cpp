@@ -0,0 +1,93 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * RouterTest.cpp
+ * Tests of the embedded http server's path router.
+ */
+
+#include "RouterTest.h"
+#include "bphttp/HttpRouter.h"
+
+using namespace bp::http;
+using namespace bp::http::server;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RouterTest);
+
+class NullHandler : public IHandler
+{
+public:
+    bool processRequest(const Request &, Response &) { return true; }
+};
+
+
+void RouterTest::matchingTest()
+{
+    NullHandler all, info, service, package, ab, xc, wild;
+    Router r;
+    Router::Params p;
+
+    CPPUNIT_ASSERT(r.add("*", &all));
+    CPPUNIT_ASSERT(r.add("/info", &info));
+    CPPUNIT_ASSERT(r.add("/service/:name/:version", &service));
+    CPPUNIT_ASSERT(r.add("/service/package/*", &package));
+    CPPUNIT_ASSERT(r.add("/a/b", &ab));
+    CPPUNIT_ASSERT(r.add("/:x/c", &xc));
+    CPPUNIT_ASSERT(r.add("/w/*/z", &wild));
+    CPPUNIT_ASSERT_EQUAL((size_t) 7, r.size());
+
+    // a second name for the same position is ambiguous
+    CPPUNIT_ASSERT(!r.add("/service/:other", &all));
+    CPPUNIT_ASSERT(!r.add("/:", &all));
+
+    CPPUNIT_ASSERT(r.find("/", p) == &all);
+    CPPUNIT_ASSERT(r.find("/info", p) == &info);
+    CPPUNIT_ASSERT(r.find("/info/more", p) == &all);
+    CPPUNIT_ASSERT(p["*"] == "info/more");
+
+    CPPUNIT_ASSERT(r.find("/service/Foo/1.0.0", p) == &service);
+    CPPUNIT_ASSERT(p["name"] == "Foo");
+    CPPUNIT_ASSERT(p["version"] == "1.0.0");
+
+    // literals beat parameters
+    CPPUNIT_ASSERT(r.find("/service/package/Foo/1.0.0", p) == &package);
+    CPPUNIT_ASSERT(p["*"] == "Foo/1.0.0");
+    CPPUNIT_ASSERT(p.find("name") == p.end());
+
+    // and a dead end under a literal doesn't back up to a parameter,
+    // it falls to the deepest trailing wildcard passed
+    CPPUNIT_ASSERT(r.find("/a/c", p) == &all);
+    CPPUNIT_ASSERT(p["*"] == "a/c");
+    CPPUNIT_ASSERT(p.find("x") == p.end());
+    CPPUNIT_ASSERT(r.find("/b/c", p) == &xc);
+    CPPUNIT_ASSERT(p["x"] == "b");
+    CPPUNIT_ASSERT(r.find("/service/Foo", p) == &all);
+    CPPUNIT_ASSERT(p["*"] == "service/Foo");
+    CPPUNIT_ASSERT(p.find("name") == p.end());
+
+    CPPUNIT_ASSERT(r.find("//a//b/", p) == &ab);
+    CPPUNIT_ASSERT(r.find("/w/anything/z", p) == &wild);
+    CPPUNIT_ASSERT(r.find("/w/anything/y", p) == &all);
+
+    Router empty;
+    CPPUNIT_ASSERT(empty.find("/info", p) == NULL);
+}
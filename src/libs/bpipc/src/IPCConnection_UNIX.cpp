@@ -23,6 +23,7 @@
 #include "api/IPCConnection.h"
 #include "BPUtils/bperrorutil.h"
 #include "BPUtils/BPLog.h"
+#include "BPUtils/bpprocess.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -333,6 +334,8 @@ Connection::connect(int fd, std::string * error)
 {
     if (fd == 0) return false;
     m_fd = fd;
+    // children we spawn must not hold our end of the conversation
+    (void) bp::process::setCloseOnExec(m_fd);
     // now we've got a connected file descriptor.  we will start up
     // the selecting thread iff setListener has been called.  This
     // is important in the Server case, where bp::ipc::Server accepts
@@ -393,6 +396,8 @@ Connection::startThread(std::string * error)
         BPLOG_ERROR_STRM("Couldn't allocate pipe: " << err);
         return false;
     }
+    (void) bp::process::setCloseOnExec(m_control[0]);
+    (void) bp::process::setCloseOnExec(m_control[1]);
 
     // allocate some context, and spawn a thread
     ipcConnectionThreadContext * ctx = new ipcConnectionThreadContext;
@@ -22,6 +22,7 @@
 
 #include "api/IPCServer.h"
 #include "BPUtils/bperrorutil.h"
+#include "BPUtils/bpprocess.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -202,6 +203,7 @@ Server::start(const std::string & location,
         }
         return false;
     }
+    (void) bp::process::setCloseOnExec(fd);
 
     // bind the socket to the specified path
     struct sockaddr_un unix_addr;
@@ -246,6 +248,8 @@ Server::start(const std::string & location,
         close(fd);
         return false;
     }
+    (void) bp::process::setCloseOnExec(m_control[0]);
+    (void) bp::process::setCloseOnExec(m_control[1]);
 
     // great, and finally, allocate some context, and spawn a thread
     ipcServerThreadContext * ctx = new ipcServerThreadContext;
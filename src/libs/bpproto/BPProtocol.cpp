@@ -331,6 +331,40 @@ BPErrorCode BPDescribe(BPProtoHand hand,
     return BP_EC_OK;
 }
 
+BPErrorCode BPDescribeServices(BPProtoHand hand,
+                               const BPElement * services,
+                               BPDescribeServicesCallback describeCB,
+                               void * cookie)
+{
+    CHECK_HAND_STATE(hand);
+
+    if (describeCB == NULL || services == NULL || services->type != BPTList) {
+        return BP_EC_INVALID_PARAMETER;
+    }
+
+    // build the query
+    bp::ipc::Query q;
+    q.setCommand("DescribeServices");
+
+    {
+        bp::Map m;
+        m.add("services", bp::Object::build(services));
+        q.setPayload(m);
+    }
+    
+    // attempt to send the query
+    if (!hand->channel.sendQuery(q)) return BP_EC_INVALID_STATE;
+
+    // register the transaction
+    Transaction t;
+    t.type = Transaction::DescribeServices;
+    t.cookie = cookie;
+    t.describeServicesCB = describeCB;
+    hand->manager.addTransaction(q.id(), t);
+    
+    return BP_EC_OK;
+}
+
 BPErrorCode
 BPEnumerate(BPProtoHand hand,
             BPGenericCallback enumerateCB,
@@ -51,15 +51,17 @@ const char * SessionCreator::c_createSessionCommand = "CreateSession";
 SessionCreator::SessionCreator(bp::ipc::Channel * channel)
     : m_channel(channel), m_spawnedProcess(false),
       m_sentCreateSession(false),
-      m_elapsedTime(), m_timer(),
+      m_elapsedTime(), m_timer(), m_childWatcher(), m_childExited(false),
       m_curPollS(c_initialPollPeriodS), m_listener(NULL)
 {
     m_timer.setListener(this);
+    m_childWatcher.setListener(this);
 }
 
 SessionCreator::~SessionCreator()
 {
     m_timer.cancel();
+    m_childWatcher.cancel();
 }
 
 void
@@ -73,6 +75,7 @@ SessionCreator::reportError(BPErrorCode e,
 
     // shut everything down
     m_timer.cancel();
+    m_childWatcher.cancel();
     m_elapsedTime.reset();
     m_channel->disconnect();
     m_channel->setListener(NULL);
@@ -210,6 +213,10 @@ SessionCreator::tryConnect()
         } else if (!m_spawnedProcess) {
             BPLOG_INFO_STRM("Cannot connect to BrowserPlus, spawning");
 
+            // watch for the daemon's socket before it can possibly
+            // appear
+            (void) m_childWatcher.watchPath(ipcName);
+
             if (!startupDaemon(m_spawnStatus)) {
                 BPLOG_ERROR_STRM(this << ", Couldn't start daemon: "
                                  << m_spawnStatus.errCode);
@@ -222,6 +229,7 @@ SessionCreator::tryConnect()
             m_elapsedTime.reset();
             m_elapsedTime.start();
             m_spawnedProcess = true;
+            (void) m_childWatcher.watchExit(m_spawnStatus);
 
             double pp = getPollPeriodSec();
             BPLOG_INFO_STRM(this << ", Spawned browserplus, waiting " 
@@ -230,18 +238,12 @@ SessionCreator::tryConnect()
         } else {
             // Check for daemon error exit.  If no exit, wait and try again.
             int errCode = 0;
-            if (bp::process::wait(m_spawnStatus, false, errCode)) {
-                // daemon has exited, exit status of kKillswitch well-known
-                if (errCode == bp::exit::kKillswitch) {
-                    BPLOG_ERROR_STRM("daemon not running, blacklisted");
-                    BPLOG_ERROR_STRM("removing blacklisted platform");
-                    bp::SemanticVersion version;
-                    (void) version.parse(bp::paths::versionString());
-                    bp::platformutil::removePlatform(version, true);
-                    reportError(BP_EC_PLATFORM_BLACKLISTED,
-                                "BrowserPlus platform version blacklisted");
-                    return;
-                }
+            if (!m_childExited &&
+                bp::process::wait(m_spawnStatus, false, errCode))
+            {
+                m_childExited = true;
+                m_childWatcher.cancel();
+                if (daemonExited(errCode)) return;
             }
             double pp = getPollPeriodSec();
             BPLOG_INFO_STRM(this << ", Connection failed, waiting " 
@@ -257,6 +259,8 @@ SessionCreator::tryConnect()
         }
 
 
+        m_childWatcher.cancel();
+
         BPLOG_INFO_STRM(this <<
                         ", IPC connect ok, sending CreateSession message");
 
@@ -310,6 +314,52 @@ SessionCreator::timesUp(bp::time::Timer *)
     }
 }
 
+bool
+SessionCreator::daemonExited(int exitCode)
+{
+    // exit status of kKillswitch well-known
+    if (exitCode == bp::exit::kKillswitch) {
+        BPLOG_ERROR_STRM("daemon not running, blacklisted");
+        BPLOG_ERROR_STRM("removing blacklisted platform");
+        bp::SemanticVersion version;
+        (void) version.parse(bp::paths::versionString());
+        bp::platformutil::removePlatform(version, true);
+        reportError(BP_EC_PLATFORM_BLACKLISTED,
+                    "BrowserPlus platform version blacklisted");
+        return true;
+    }
+    return false;
+}
+
+void
+SessionCreator::childExited(bp::process::ChildWatcher *, int exitCode)
+{
+    m_childExited = true;
+    if (m_sentCreateSession) return;
+    BPLOG_INFO_STRM(this << ", spawned daemon exited with " << exitCode
+                    << " after " << m_elapsedTime.elapsedSec() << "s");
+    if (daemonExited(exitCode)) return;
+
+    // perhaps another daemon won the race to start, try it now
+    m_timer.cancel();
+    tryConnect();
+}
+
+void
+SessionCreator::pathCreated(bp::process::ChildWatcher *)
+{
+    if (m_sentCreateSession) return;
+    BPLOG_INFO_STRM(this << ", daemon socket created after "
+                    << m_elapsedTime.elapsedSec() << "s");
+
+    // the socket exists a moment before the daemon listens on it, so
+    // should this attempt fail start polling again from the shortest
+    // period
+    m_timer.cancel();
+    m_curPollS = c_initialPollPeriodS;
+    tryConnect();
+}
+
 void
 SessionCreator::onMessage(bp::ipc::Channel *,
                           const bp::ipc::Message &)
@@ -35,6 +35,7 @@
 #include <string>
 
 #include "BPProtocolInterface.h"
+#include "BPUtils/bpchildwatcher.h"
 #include "BPUtils/bpprocess.h"
 #include "BPUtils/bpstopwatch.h"
 #include "BPUtils/bptimer.h"
@@ -51,7 +52,8 @@ class ISessionCreatorListener
 };
 
 class SessionCreator : virtual public bp::time::ITimerListener,
-                       virtual public bp::ipc::IChannelListener
+                       virtual public bp::ipc::IChannelListener,
+                       virtual public bp::process::IChildWatcherListener
 {
 public:
     // allocate a session creator given a specific channel.  the lifetime
@@ -101,6 +103,11 @@ private:
     bp::time::Stopwatch m_elapsedTime;
     bp::time::Timer m_timer;
     bp::process::spawnStatus m_spawnStatus;
+
+    // where supported, tells us the moment a daemon we spawned creates
+    // its socket or exits, so we needn't wait out a poll period
+    bp::process::ChildWatcher m_childWatcher;
+    bool m_childExited;
     std::string m_uri;
     std::string m_locale;
     std::string m_userAgent;
@@ -119,6 +126,14 @@ private:
     // invoked when our timer expires, this means either it's time to
     // try to reconnect, or give up if too much time has elapsed
     void timesUp(bp::time::Timer * t);
+
+    // from IChildWatcherListener
+    void childExited(bp::process::ChildWatcher * w, int exitCode);
+    void pathCreated(bp::process::ChildWatcher * w);
+
+    // the daemon we spawned has exited.  returns true if that's fatal,
+    // in which case an error has been reported.
+    bool daemonExited(int exitCode);
     
     /* channel events from IChannelListener */ 
     // we care about if the channel falls down in the middle of the process
@@ -293,6 +293,45 @@ TransactionManager::onResponse(bp::ipc::Channel *,
                           ve.empty() ? NULL : ve.c_str());
         }
     }
+    else if (!response.command().compare("DescribeServices") &&
+             t.type == Transaction::DescribeServices)
+    {
+        bp::service::Description * descs = NULL;
+        const BPServiceDefinition ** defs = NULL;
+        unsigned int numDefs = 0;
+        std::string e, ve;
+
+        if (ec == BP_EC_OK) {
+            if (!payload || payload->type() != BPTList) {
+                ec = BP_EC_PROTOCOL_ERROR;
+            } else {
+                // null entries are services which aren't available
+                std::vector<const bp::Object *> l = *payload;
+                numDefs = l.size();
+                defs = new const BPServiceDefinition*[numDefs];
+                descs = new bp::service::Description[numDefs];
+                for (unsigned int i = 0; i < numDefs; ++i) {
+                    defs[i] = NULL;
+                    if (l[i]->type() == BPTMap &&
+                        descs[i].fromBPObject(l[i]))
+                    {
+                        defs[i] = descs[i].toBPServiceDefinition();
+                    }
+                }
+            }
+        } else if (ec == BP_EC_EXTENDED_ERROR) {
+            extractExtendedError(payload, e, ve);
+        }
+
+        if (t.describeServicesCB) {
+            t.describeServicesCB(ec, t.cookie, defs,
+                                 ec == BP_EC_OK ? numDefs : 0,
+                                 e.empty() ? NULL : e.c_str(),
+                                 ve.empty() ? NULL : ve.c_str());
+        }
+        delete [] defs;
+        delete [] descs;
+    }
     else
     {
         BPLOG_WARN_STRM("Unexpected response received: "
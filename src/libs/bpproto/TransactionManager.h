@@ -32,11 +32,13 @@ class Transaction
   public:
     Transaction()
         : type(Enumerate), cookie(NULL), genericCB(NULL), describeCB(NULL),
-          requireCB(NULL), resultsCB(NULL), invokeCB(NULL), invokeCookie(NULL)
+          describeServicesCB(NULL), requireCB(NULL), resultsCB(NULL),
+          invokeCB(NULL), invokeCookie(NULL)
     {
     }
 
-    enum { Enumerate, Describe, GetState, Require, Invoke } type;
+    enum { Enumerate, Describe, DescribeServices, GetState, Require,
+           Invoke } type;
     
     // common to all transactions
     void * cookie;
@@ -47,6 +49,9 @@ class Transaction
     // secific to Describe
     BPDescribeCallback describeCB;
 
+    // secific to DescribeServices
+    BPDescribeServicesCallback describeServicesCB;
+
     // secific to Require
     BPRequireCallback requireCB;
 
@@ -231,6 +231,41 @@ extern "C" {
                            BPDescribeCallback describeCB,
                            void * cookie);
     
+    /**    
+     * A callback to return the descriptions of several services.
+     * \param ec The status of the request.  if not BP_EC_OK,
+     *           defs will be NULL.
+     * \param cookie the same value passed into BPDescribeServices
+     * \param defs An array of pointers with one entry per requested
+     *             service, in request order.  Entries for services
+     *             which are not available are NULL.
+     * \param numDefs the number of elements in defs
+     * \param error If ec == BP_EC_EXTENDED_ERROR, a string representation
+     *              of the error returned.
+     * \param verboseError If ec == BP_EC_EXTENDED_ERROR, this may be
+     *              NULL or a string containing a human readable description
+     *              of the error encountered.   
+     */
+    typedef void (*BPDescribeServicesCallback)(
+        BPErrorCode ec,
+        void * cookie,
+        const BPServiceDefinition ** defs,
+        unsigned int numDefs,
+        const char * error,
+        const char * verboseError);
+
+    /**
+     * describe several services in a single round trip to the daemon.
+     * Unlike BPRequire, this never installs anything.
+     * \param services - a BPList of BPMaps describing each service.
+     *                   Each map must have key "name", "version" and
+     *                   "minversion" keys are optional.
+     */
+    BPErrorCode BPDescribeServices(BPProtoHand hand,
+                                   const BPElement * services,
+                                   BPDescribeServicesCallback describeCB,
+                                   void * cookie);
+    
     /**    
      * A callback for the invocation of callback parameters.  These are
      * callbacks that are passed into the 
@@ -198,3 +198,18 @@ bool bp::os::Is64Bit()
 #endif
     return (bool) bIs64Bit;
 }
+
+
+unsigned int bp::os::NumProcessors()
+{
+    unsigned int n = 1;
+#ifdef WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    n = (unsigned int) si.dwNumberOfProcessors;
+#else
+    long rv = sysconf(_SC_NPROCESSORS_ONLN);
+    if (rv > 0) n = (unsigned int) rv;
+#endif
+    return (n > 0) ? n : 1;
+}
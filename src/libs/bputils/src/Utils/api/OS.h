@@ -54,6 +54,9 @@ namespace bp
         std::string CurrentUser();
 
         bool Is64Bit();
+
+        // number of online processors, at least 1
+        unsigned int NumProcessors();
     };
 };
 
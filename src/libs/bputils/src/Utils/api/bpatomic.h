@@ -0,0 +1,109 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpatomic.h
+ *
+ *  The handful of atomic operations lock-free structures need, over
+ *  32 bit words and pointers.  Each is a full memory barrier.  They
+ *  work across processes too, on memory both have mapped.
+ */
+
+#ifndef _BPATOMIC_H_
+#define _BPATOMIC_H_
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+namespace bp {
+namespace atomic {
+
+    // a full memory barrier
+    inline void barrier()
+    {
+#ifdef WIN32
+        MemoryBarrier();
+#else
+        __sync_synchronize();
+#endif
+    }
+
+    inline unsigned int load(const volatile unsigned int * p)
+    {
+        unsigned int v = *p;
+        barrier();
+        return v;
+    }
+
+    inline void store(volatile unsigned int * p, unsigned int v)
+    {
+        barrier();
+        *p = v;
+        barrier();
+    }
+
+    // set *p to newValue iff it holds oldValue, true if it did
+    inline bool compareAndSwap(volatile unsigned int * p,
+                               unsigned int oldValue,
+                               unsigned int newValue)
+    {
+#ifdef WIN32
+        return (unsigned int) InterlockedCompareExchange(
+            (volatile LONG *) p, (LONG) newValue, (LONG) oldValue) == oldValue;
+#else
+        return __sync_bool_compare_and_swap(p, oldValue, newValue);
+#endif
+    }
+
+    // returns the new value
+    inline unsigned int increment(volatile unsigned int * p)
+    {
+#ifdef WIN32
+        return (unsigned int) InterlockedIncrement((volatile LONG *) p);
+#else
+        return __sync_add_and_fetch(p, 1);
+#endif
+    }
+
+    inline void * loadPtr(void * const volatile * p)
+    {
+        void * v = *p;
+        barrier();
+        return v;
+    }
+
+    inline bool compareAndSwapPtr(void * volatile * p, void * oldValue,
+                                  void * newValue)
+    {
+#ifdef WIN32
+        return InterlockedCompareExchangePointer(p, newValue, oldValue)
+            == oldValue;
+#else
+        return __sync_bool_compare_and_swap(p, oldValue, newValue);
+#endif
+    }
+
+} // namespace atomic
+} // namespace bp
+
+#endif // _BPATOMIC_H_
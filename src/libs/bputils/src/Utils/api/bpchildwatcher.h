@@ -0,0 +1,79 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpchildwatcher.h
+ *
+ *  an abstraction which calls back into client code, on the thread
+ *  that created it, as soon as a spawned child exits or creates a
+ *  path (such as the socket it will listen on), rather than the
+ *  client having to poll for either.
+ */
+
+#ifndef __BPCHILDWATCHER_H__
+#define __BPCHILDWATCHER_H__
+
+#include "bpprocess.h"
+
+namespace bp {
+namespace process {
+
+class IChildWatcherListener 
+{
+  public:
+    // the watched child has exited and been reaped, exitCode is as
+    // for bp::process::wait()
+    virtual void childExited(class ChildWatcher * w, int exitCode) = 0;
+    // the watched path now exists
+    virtual void pathCreated(class ChildWatcher * w) = 0;
+    virtual ~IChildWatcherListener() { }
+};
+
+class ChildWatcher
+{
+public:
+    ChildWatcher();
+    ~ChildWatcher();
+    // who will receive events
+    void setListener(IChildWatcherListener * listener);
+    // watch for the exit of a child started with spawn().  returns
+    // false where this isn't supported, the client must then poll
+    // with bp::process::wait()
+    bool watchExit(const spawnStatus & status);
+    // watch for path to be created.  Set this up before spawning the
+    // child which will create it.  returns false where unsupported.
+    bool watchPath(const boost::filesystem::path & path);
+    // stop watching for anything
+    void cancel();
+
+  private:
+    void * m_osSpecific;
+
+    // no copy/assignment
+    ChildWatcher(const ChildWatcher &);
+    ChildWatcher & operator=(const ChildWatcher &);
+};
+
+} // namespace process
+} // namespace bp
+
+#endif
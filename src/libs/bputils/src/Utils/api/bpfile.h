@@ -141,6 +141,75 @@ namespace bp {
                             IVisitor& v,
                             bool followLinks);
 
+        // What a tree walk learned about a node, so that visitors
+        // needn't stat it again.
+        //
+        struct WalkEntry {
+            WalkEntry() : isDirectory(false), isLink(false),
+                          isBrokenLink(false) {}
+            // real path of node (the link target if links are
+            // being followed and the link is valid)
+            boost::filesystem::path path;
+            // pseudo-path of node relative to top node, as
+            // passed to IVisitor::visitNode()
+            boost::filesystem::path relativePath;
+            bool isDirectory;
+            // path is itself a link (links aren't being followed,
+            // or the link is broken)
+            bool isLink;
+            bool isBrokenLink;
+        };
+
+        class IBatchVisitor {
+        public:
+            virtual ~IBatchVisitor() {}
+
+            /** Visit a batch of nodes.  Always called on the thread
+             *  which called parallelVisit().
+             *  \returns - eStop to terminate the walk, anything
+             *              else to continue
+             */
+            virtual IVisitor::tResult visitNodes(
+                const std::vector<WalkEntry>& entries) = 0;
+        };
+
+        /** Recursive visit of nodes in a path, reading directories on
+         *  a pool of threads.  Visits the same nodes as recursiveVisit(),
+         *  but in no particular order and delivered in batches.  Each
+         *  directory entry costs at most one stat, and none where the
+         *  filesystem reports the entry type.  A visitor returning eStop
+         *  halts all readers promptly.
+         *  \param p [IN] - directory to visit
+         *  \param v [IN] - visitor to receive batches of nodes
+         *  \param followLinks [IN] - as for recursiveVisit()
+         *  \param maxThreads [IN] - reader threads, 0 to pick based
+         *                           on the number of processors
+         *  \returns - true if all nodes visited, false
+         *             if "v" stopped the visit
+         */
+        bool parallelVisit(const boost::filesystem::path& p,
+                           IBatchVisitor& v,
+                           bool followLinks,
+                           unsigned int maxThreads = 0);
+
+        /** As parallelVisit(), but nodes are delivered in the order
+         *  recursiveVisit() visits them: depth first, with each
+         *  directory's entries in the order the filesystem lists them.
+         *  Use this when a visitor stops after some number of nodes
+         *  and which nodes it sees matters.  Readers still work ahead
+         *  on a pool of threads.
+         *  \param p [IN] - directory to visit
+         *  \param v [IN] - visitor to receive batches of nodes
+         *  \param followLinks [IN] - as for recursiveVisit()
+         *  \param maxThreads [IN] - as for parallelVisit()
+         *  \returns - true if all nodes visited, false
+         *             if "v" stopped the visit
+         */
+        bool parallelVisitInOrder(const boost::filesystem::path& p,
+                                  IBatchVisitor& v,
+                                  bool followLinks,
+                                  unsigned int maxThreads = 0);
+
         /** Construct a path from a file:// url.  The url is expected
          *  to be urlencoded from utf8.
          *  \param url [IN] - url 
@@ -330,6 +399,14 @@ namespace bp {
         bool createLink(const boost::filesystem::path& path,
                         const boost::filesystem::path& target);
 
+        /** Create a hard link.  Both paths must be on the same volume.
+         *   \param     path [IN] - link path, must not exist
+         *   \param     target [IN] - existing file
+         *   \returns   true on success
+         */
+        bool createHardLink(const boost::filesystem::path& path,
+                            const boost::filesystem::path& target);
+
         /** Resolve a link to a valid path.  Understands Unix/NTFS symlinks,
          *  Mac aliases, and Windows shortcuts.  
          *  \param		path [IN] - link path
@@ -358,7 +435,7 @@ namespace bp {
         {
             FileInfo() : mode(0), mtime(0), ctime(0), atime(0), 
                          sizeInBytes(0), deviceId(0),
-                         fileIdHigh(0), fileIdLow(0) {
+                         fileIdHigh(0), fileIdLow(0), linkCount(0) {
             }
             // permissions - these are unix style permissions as
             // would be passed into chmod(3).  On windows we'll
@@ -378,6 +455,8 @@ namespace bp {
             // file identifier 
             boost::uint32_t fileIdHigh;
             boost::uint32_t fileIdLow;
+            // number of hard links to the file
+            boost::uint32_t linkCount;
         };
 
         /** get information about a file or directory on disk
@@ -401,6 +480,11 @@ namespace bp {
         bool isMimeType(const boost::filesystem::path& path,
                         const std::set<std::string>& filter);
 
+        // as above, using what a walk already knows about a node
+        std::vector<std::string> mimeTypes(const WalkEntry& entry);
+        bool isMimeType(const WalkEntry& entry,
+                        const std::set<std::string>& filter);
+
         std::vector<std::string> extensionsFromMimeType(const std::string& mimeType);
     }
 }
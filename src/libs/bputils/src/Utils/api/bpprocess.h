@@ -62,8 +62,19 @@ namespace process {
      */
     long currentPid();
 
+#ifndef WIN32
     /**
-     * Spawn a process
+     * Mark a descriptor to be closed across exec, so that processes
+     * spawned by means other than spawn() don't inherit it.
+     * \return Success or failure
+     */
+    bool setCloseOnExec(int fd);
+#endif
+
+    /**
+     * Spawn a process.  On unix the child inherits only stdin, stdout
+     * and stderr, and failure to exec path fails the spawn rather than
+     * surfacing later as the child's exit code.
      * \param  path Full path to executable file
      * \param  args Command-line arguments
      * \param  status Receives errCode/pid/handle info
@@ -0,0 +1,76 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpsha256.h
+ *
+ *  SHA-256 digests of strings and files, rendered as lowercase hex.
+ *
+ *  Copyright 2010 Yahoo! Inc. All rights reserved.
+ *
+ */
+
+#ifndef _BPSHA256_H_
+#define _BPSHA256_H_
+
+#include <string>
+#include "bpfile.h"
+
+
+namespace bp {
+namespace sha256 {
+
+std::string hash( const std::string& sIn );
+
+// hash the contents of a file, streaming it from disk.  Returns
+// an empty string if the file cannot be read.
+std::string hashFile( const boost::filesystem::path& path );
+
+// incremental hashing, for data which arrives a piece at a time
+class Hasher
+{
+public:
+    Hasher();
+    ~Hasher();
+
+    // start over, discarding everything added so far
+    void reset();
+
+    void update( const void* pData, size_t len );
+
+    // the digest of everything added since construction or reset()
+    std::string digest() const;
+
+private:
+    // an openssl SHA256_CTX, kept out of this header
+    void* m_pCtx;
+
+    // no copy/assign semantics, declared but not defined
+    Hasher( const Hasher& );
+    Hasher& operator=( const Hasher& );
+};
+
+} // sha256
+} // bp
+
+
+#endif
@@ -288,6 +288,11 @@ namespace bp {
         const Object * value(unsigned int i) const;
         
         void append(Object * object);
+
+        /** replace the value at index i, freeing the old value.  the
+         *  list takes ownership of object.
+         *  \returns false (and takes no ownership) if i is out of range */
+        bool replace(unsigned int i, Object * object);
         
         virtual Object * clone() const;
         
@@ -326,6 +331,13 @@ namespace bp {
          * overload that works with STL strings
          */
         void add(const std::string& key, Object* value);
+
+        /** replace the value of an existing key, freeing the old value.
+         *  unlike add() the key keeps its position.  the map takes
+         *  ownership of value.
+         *  \returns false (and takes no ownership) if the key is not
+         *  present */
+        bool replace(const char * key, Object * value);
         
         /**
          * Get a boolean from the map.
@@ -368,6 +380,10 @@ namespace bp {
           public:
             Iterator(const Map& m);
             const char * nextKey();
+            /** the value of the key last returned by nextKey(), found
+             *  without another search of the map.  NULL before the
+             *  first call to nextKey() */
+            const Object * value() const;
           private:
             std::vector<std::string>::const_iterator m_it;
             const Map * m_m;
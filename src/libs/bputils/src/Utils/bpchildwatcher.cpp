@@ -0,0 +1,67 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpchildwatcher
+ *
+ *  the fallback for platforms without an implementation of their own
+ *  (see bpchildwatcher_Linux.cpp), clients fall back to polling.
+ */
+
+#include "api/bpchildwatcher.h"
+
+#ifndef LINUX
+
+using namespace bp::process;
+
+
+ChildWatcher::ChildWatcher() : m_osSpecific(NULL)
+{
+}
+
+ChildWatcher::~ChildWatcher()
+{
+}
+
+void
+ChildWatcher::setListener(IChildWatcherListener *)
+{
+}
+
+bool
+ChildWatcher::watchExit(const spawnStatus &)
+{
+    return false;
+}
+
+bool
+ChildWatcher::watchPath(const boost::filesystem::path &)
+{
+    return false;
+}
+
+void
+ChildWatcher::cancel()
+{
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpchildwatcher_Linux.cpp
+ *
+ *  A thread blocks in poll() on a pidfd for the child and an inotify
+ *  watch on the path's directory, and hops events back to the thread
+ *  which created the watcher, just as the timer does.
+ */
+
+#include "api/bpchildwatcher.h"
+#include "api/bpsync.h"
+#include "api/bpthread.h"
+#include "api/bpthreadhopper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+using namespace bp::process;
+namespace bfs = boost::filesystem;
+
+
+class LinuxChildWatcher : public bp::thread::HoppingClass
+{
+public:
+    LinuxChildWatcher(ChildWatcher * watcherPtr)
+        : m_listener(NULL), m_thread(NULL), m_watcherPtr(watcherPtr),
+          m_status(), m_pidfd(-1), m_inotifyfd(-1), m_name(),
+          m_exited(false), m_created(false)
+    {
+        m_wake[0] = m_wake[1] = -1;
+        memset(&m_status, 0, sizeof(m_status));
+    }
+        
+    ~LinuxChildWatcher()
+    {
+        cancel();
+    }
+    
+    void setListener(IChildWatcherListener * listener)
+    {
+        m_listener = listener;
+    }
+
+    bool watchExit(const spawnStatus & status)
+    {
+        if (status.pid <= 0) return false;
+        int fd = (int) syscall(__NR_pidfd_open, (pid_t) status.pid, 0);
+        if (fd < 0) return false;
+        (void) setCloseOnExec(fd);
+
+        stopThread();
+        if (m_pidfd >= 0) close(m_pidfd);
+        m_pidfd = fd;
+        m_status = status;
+        m_exited = false;
+        return startThread();
+    }
+
+    bool watchPath(const bfs::path & path)
+    {
+        if (path.empty()) return false;
+        int fd = inotify_init();
+        if (fd < 0) return false;
+        (void) setCloseOnExec(fd);
+        bfs::path dir = path.parent_path();
+        if (dir.empty()) dir = ".";
+        if (inotify_add_watch(fd, dir.c_str(), IN_CREATE | IN_MOVED_TO) < 0) {
+            close(fd);
+            return false;
+        }
+
+        stopThread();
+        if (m_inotifyfd >= 0) close(m_inotifyfd);
+        m_inotifyfd = fd;
+        m_name = path.filename().string();
+        m_created = false;
+        return startThread();
+    }
+
+    void cancel()
+    {
+        stopThread();
+        if (m_pidfd >= 0) close(m_pidfd);
+        if (m_inotifyfd >= 0) close(m_inotifyfd);
+        m_pidfd = m_inotifyfd = -1;
+        m_lock.lock();
+        m_exited = m_created = false;
+        m_lock.unlock();
+    }
+
+private:
+    static void * threadfunc(void * context) 
+    {
+        LinuxChildWatcher * self = (LinuxChildWatcher *) context;
+        struct pollfd fds[3];
+        int pidfd = self->m_pidfd;
+        int inotifyfd = self->m_inotifyfd;
+
+        while (pidfd >= 0 || inotifyfd >= 0) {
+            fds[0].fd = self->m_wake[0];
+            fds[1].fd = pidfd;
+            fds[2].fd = inotifyfd;
+            for (int i = 0; i < 3; i++) {
+                fds[i].events = POLLIN;
+                fds[i].revents = 0;
+            }
+            if (poll(fds, 3, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[0].revents) break;
+
+            if (fds[1].revents) {
+                pidfd = -1;
+                self->m_lock.lock();
+                self->m_exited = true;
+                self->m_lock.unlock();
+                self->hop(NULL);
+            }
+            if (fds[2].revents && self->pathCreated(inotifyfd)) {
+                inotifyfd = -1;
+                self->m_lock.lock();
+                self->m_created = true;
+                self->m_lock.unlock();
+                self->hop(NULL);
+            }
+        }
+        return NULL;
+    }
+
+    // drain inotify events, true if one names our path
+    bool pathCreated(int fd)
+    {
+        char buf[4096]
+            __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        ssize_t len = read(fd, buf, sizeof(buf));
+        bool found = false;
+        for (char * p = buf; len > 0 && p < buf + len; ) {
+            struct inotify_event * e = (struct inotify_event *) p;
+            if (e->len && m_name == e->name) found = true;
+            p += sizeof(struct inotify_event) + e->len;
+        }
+        return found;
+    }
+
+    bool startThread()
+    {
+        if (pipe(m_wake) != 0) return false;
+        (void) setCloseOnExec(m_wake[0]);
+        (void) setCloseOnExec(m_wake[1]);
+        m_thread = new bp::thread::Thread;
+        if (!m_thread->run(threadfunc, (void *) this)) {
+            delete m_thread;
+            m_thread = NULL;
+            close(m_wake[0]);
+            close(m_wake[1]);
+            m_wake[0] = m_wake[1] = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void stopThread()
+    {
+        if (m_thread) {
+            char c = 0;
+            while (write(m_wake[1], &c, 1) < 0 && errno == EINTR) { }
+            m_thread->join();
+            delete m_thread;
+            m_thread = NULL;
+            close(m_wake[0]);
+            close(m_wake[1]);
+            m_wake[0] = m_wake[1] = -1;
+        }
+    }
+
+    // stop watching a descriptor which has fired, carrying on with
+    // the other if it's still open
+    void retire(int & fd)
+    {
+        if (fd < 0) return;
+        stopThread();
+        close(fd);
+        fd = -1;
+        if (m_pidfd >= 0 || m_inotifyfd >= 0) (void) startThread();
+    }
+
+    void onHop(void *) 
+    {
+        m_lock.lock();
+        bool exited = m_exited;
+        bool created = m_created;
+        m_exited = m_created = false;
+        m_lock.unlock();
+
+        // the listener may delete us, so at most one callback per hop.
+        // the thread hops once per event so neither is lost.
+        if (created) {
+            if (exited) {
+                m_lock.lock();
+                m_exited = true;
+                m_lock.unlock();
+            }
+            retire(m_inotifyfd);
+            if (m_listener) m_listener->pathCreated(m_watcherPtr);
+        } else if (exited) {
+            retire(m_pidfd);
+            int exitCode = 0;
+            (void) bp::process::wait(m_status, false, exitCode);
+            if (m_listener) m_listener->childExited(m_watcherPtr, exitCode);
+        }
+    }
+    
+    IChildWatcherListener * m_listener;
+    bp::thread::Thread * m_thread;
+    ChildWatcher * m_watcherPtr;
+    spawnStatus m_status;
+    int m_pidfd;
+    int m_inotifyfd;
+    std::string m_name;
+    int m_wake[2];
+    bp::sync::Mutex m_lock;
+    bool m_exited;
+    bool m_created;
+};
+
+
+ChildWatcher::ChildWatcher() 
+{
+    m_osSpecific = new LinuxChildWatcher(this);
+}
+
+ChildWatcher::~ChildWatcher()
+{
+    delete ((LinuxChildWatcher *) m_osSpecific);
+}
+
+void
+ChildWatcher::setListener(IChildWatcherListener * listener)
+{
+    ((LinuxChildWatcher *) m_osSpecific)->setListener(listener);
+}
+
+bool
+ChildWatcher::watchExit(const spawnStatus & status)
+{
+    return ((LinuxChildWatcher *) m_osSpecific)->watchExit(status);
+}
+
+bool
+ChildWatcher::watchPath(const bfs::path & path)
+{
+    return ((LinuxChildWatcher *) m_osSpecific)->watchPath(path);
+}
+
+void
+ChildWatcher::cancel()
+{
+    ((LinuxChildWatcher *) m_osSpecific)->cancel();
+}
@@ -1730,6 +1730,21 @@ isOther(const bfs::path& path)
 }
 
 
+bool
+createHardLink(const bfs::path& path,
+               const bfs::path& target)
+{
+    try {
+        bfs::create_hard_link(target, path);
+    } catch(const bfs::filesystem_error& e) {
+        BPLOG_DEBUG_STRM("createHardLink(" << path << ", "
+                         << target << ") failed: " << e.what());
+        return false;
+    }
+    return true;
+}
+
+
 static void
 copyDir(const bfs::path& from,
         const bfs::path& to)
@@ -1918,28 +1933,12 @@ makeReadOnly(const bfs::path& path)
 }
 
 
-vector<string> 
-mimeTypes(const bfs::path& p)
+// mimetypes of a node which is neither a link nor a directory
+static vector<string>
+extensionMimeTypes(const bfs::path& target)
 {
-    initializeMimeTypes();
     vector<string> rval;
 
-    // deal with links
-    bfs::path target(p);
-    if (isLink(p)) {
-        if (resolveLink(p, target)) {
-            rval.push_back(kLinkMimeType);
-        } else {
-            rval.push_back(kBadLinkMimeType);
-        }
-        return rval;
-    }
-
-    if (isDirectory(target)) {
-        rval.push_back(kFolderMimeType);
-        return rval;
-    }
-
     // get extension, boost includes the .
     set<string> theSet;
     string ext = target.extension().string();
@@ -1969,14 +1968,52 @@ mimeTypes(const bfs::path& p)
 }
 
 
-bool 
-isMimeType(const bfs::path& p,
-           const set<string>& filter)
+vector<string>
+mimeTypes(const WalkEntry& entry)
 {
-    if (filter.empty()) {
-        return true;
+    initializeMimeTypes();
+    vector<string> rval;
+    if (entry.isLink) {
+        rval.push_back(entry.isBrokenLink ? kBadLinkMimeType : kLinkMimeType);
+    } else if (entry.isDirectory) {
+        rval.push_back(kFolderMimeType);
+    } else {
+        rval = extensionMimeTypes(entry.path);
     }
-    vector<string> myTypes = mimeTypes(p);
+    return rval;
+}
+
+
+vector<string> 
+mimeTypes(const bfs::path& p)
+{
+    initializeMimeTypes();
+    vector<string> rval;
+
+    // deal with links
+    bfs::path target(p);
+    if (isLink(p)) {
+        if (resolveLink(p, target)) {
+            rval.push_back(kLinkMimeType);
+        } else {
+            rval.push_back(kBadLinkMimeType);
+        }
+        return rval;
+    }
+
+    if (isDirectory(target)) {
+        rval.push_back(kFolderMimeType);
+        return rval;
+    }
+
+    return extensionMimeTypes(target);
+}
+
+
+static bool
+anyInFilter(const vector<string>& myTypes,
+            const set<string>& filter)
+{
     vector<string>::const_iterator it;
     for (it = myTypes.begin(); it != myTypes.end(); ++it) {
         if (filter.count(*it) > 0) {
@@ -1987,6 +2024,28 @@ isMimeType(const bfs::path& p,
 }
 
 
+bool 
+isMimeType(const bfs::path& p,
+           const set<string>& filter)
+{
+    if (filter.empty()) {
+        return true;
+    }
+    return anyInFilter(mimeTypes(p), filter);
+}
+
+
+bool 
+isMimeType(const WalkEntry& entry,
+           const set<string>& filter)
+{
+    if (filter.empty()) {
+        return true;
+    }
+    return anyInFilter(mimeTypes(entry), filter);
+}
+
+
 vector<string>
 extensionsFromMimeType(const string& mimeType)
 {
@@ -330,6 +330,7 @@ statFile(const bfs::path& p,
     // set device and file ids
     fi.deviceId = s.st_rdev;
     fi.fileIdLow = s.st_ino;
+    fi.linkCount = s.st_nlink;
 
     return true;
 }
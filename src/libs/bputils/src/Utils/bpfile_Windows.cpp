@@ -366,6 +366,7 @@ statFile(const bfs::path& p,
         fi.deviceId = info.dwVolumeSerialNumber;
         fi.fileIdHigh = info.nFileIndexHigh;
         fi.fileIdLow = info.nFileIndexLow;
+        fi.linkCount = info.nNumberOfLinks;
         CloseHandle(h);
     
     } catch (const string& s) {
@@ -0,0 +1,418 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpfilewalk.cpp
+ *
+ *  bp::file::parallelVisit().  Directories are queued and read by a
+ *  pool of reader threads, which hand back batches of entries for the
+ *  calling thread to deliver to the visitor.
+ *
+ *  An ordered walk (parallelVisitInOrder()) has readers fill a listing
+ *  per directory instead, which the calling thread delivers depth
+ *  first.  When it needs a listing no reader has started on, it reads
+ *  that directory itself.
+ */
+
+#include "bpfilewalk.h"
+#include "api/OS.h"
+
+#ifdef BP_PLATFORM_BUILD
+#include "api/BPLog.h"
+#else
+#define BPLOG_WARN_STRM(x)
+#endif
+
+using namespace std;
+namespace bfs = boost::filesystem;
+
+// entries per batch handed to the visitor
+#define WALK_BATCH_SIZE 256
+
+// readers stall once this many batches await the visitor
+#define WALK_MAX_BATCHES 64
+
+// more readers than this just contend for the disk
+#define WALK_MAX_THREADS 8
+
+
+namespace bp { namespace file { namespace walk {
+
+Walker::Walker(IBatchVisitor& v, bool followLinks, bool ordered,
+               unsigned int numThreads)
+    : m_visitor(v), m_followLinks(followLinks), m_ordered(ordered),
+      m_busy(0), m_maxBatches(WALK_MAX_BATCHES), m_stopped(false),
+      m_buffered(0)
+{
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        m_threads.push_back(new bp::thread::Thread);
+    }
+}
+
+
+Walker::~Walker()
+{
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        delete m_threads[i];
+    }
+    map<string, Listing*>::iterator it;
+    for (it = m_listings.begin(); it != m_listings.end(); ++it) {
+        delete it->second;
+    }
+}
+
+
+void*
+Walker::readerThread(void* cookie)
+{
+    ((Walker*) cookie)->readerLoop();
+    return NULL;
+}
+
+
+void
+Walker::readerLoop()
+{
+    vector<WalkEntry> batch;
+    while (true) {
+        DirJob job;
+        {
+            bp::sync::Lock lck(m_lock);
+            while (!m_stopped) {
+                if (m_jobs.empty()) {
+                    // nothing queued and nobody reading means we're done
+                    if (m_busy == 0) break;
+                } else if (!m_ordered
+                           || m_buffered < m_maxBatches * WALK_BATCH_SIZE) {
+                    break;
+                }
+                m_jobsCond.wait(&m_lock);
+            }
+            if (m_stopped || m_jobs.empty()) {
+                break;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            if (job.listing) job.listing->claimed = true;
+            m_busy++;
+        }
+
+        if (job.listing) {
+            readDirectory(*this, job, job.listing->entries);
+            listingRead(job.listing);
+            continue;
+        }
+
+        readDirectory(*this, job, batch);
+        flush(batch);
+
+        bp::sync::Lock lck(m_lock);
+        m_busy--;
+        if (m_jobs.empty() && m_busy == 0) {
+            m_jobsCond.broadcast();
+            m_batchesCond.broadcast();
+        }
+    }
+}
+
+
+void
+Walker::emit(vector<WalkEntry>& batch, const WalkEntry& e)
+{
+    batch.push_back(e);
+    // an ordered walk delivers whole listings
+    if (!m_ordered && batch.size() >= WALK_BATCH_SIZE) {
+        flush(batch);
+    }
+}
+
+
+void
+Walker::flush(vector<WalkEntry>& batch)
+{
+    if (batch.empty()) {
+        return;
+    }
+    bp::sync::Lock lck(m_lock);
+    while (m_maxBatches && m_batches.size() >= m_maxBatches && !m_stopped) {
+        m_spaceCond.wait(&m_lock);
+    }
+    if (!m_stopped) {
+        m_batches.push_back(vector<WalkEntry>());
+        m_batches.back().swap(batch);
+        m_batchesCond.signal();
+    }
+    batch.clear();
+}
+
+
+void
+Walker::addDirectory(const DirJob& job)
+{
+    bp::sync::Lock lck(m_lock);
+    m_jobs.push_back(job);
+    if (m_ordered) {
+        Listing* l = new Listing;
+        l->job = job;
+        m_listings[job.relativePath.string()] = l;
+        m_jobs.back().listing = l;
+    }
+    m_jobsCond.signal();
+}
+
+
+void
+Walker::readListing(Listing* l)
+{
+    {
+        bp::sync::Lock lck(m_lock);
+        while (l->claimed && !l->done) {
+            m_batchesCond.wait(&m_lock);
+        }
+        if (l->done) {
+            return;
+        }
+        // nobody has started on it, take it off the queue
+        l->claimed = true;
+        for (deque<DirJob>::iterator it = m_jobs.begin();
+             it != m_jobs.end(); ++it) {
+            if (it->listing == l) {
+                m_jobs.erase(it);
+                break;
+            }
+        }
+        m_busy++;
+    }
+    readDirectory(*this, l->job, l->entries);
+    listingRead(l);
+}
+
+
+void
+Walker::listingRead(Listing* l)
+{
+    bp::sync::Lock lck(m_lock);
+    l->done = true;
+    m_buffered += l->entries.size();
+    m_busy--;
+    if (m_jobs.empty() && m_busy == 0) {
+        m_jobsCond.broadcast();
+    }
+    m_batchesCond.broadcast();
+}
+
+
+void
+Walker::releaseListing(Listing* l)
+{
+    {
+        bp::sync::Lock lck(m_lock);
+        m_buffered -= l->entries.size();
+        m_listings.erase(l->job.relativePath.string());
+        m_jobsCond.broadcast();
+    }
+    delete l;
+}
+
+
+bool
+Walker::deliver(vector<WalkEntry>& batch)
+{
+    bool rval = batch.empty()
+        || m_visitor.visitNodes(batch) != IVisitor::eStop;
+    batch.clear();
+    return rval;
+}
+
+
+bool
+Walker::deliverInOrder(const WalkEntry& root)
+{
+    vector<WalkEntry> batch(1, root);
+
+    // listings being delivered, each with the index of its next entry
+    vector<pair<Listing*, size_t> > stack;
+    stack.push_back(make_pair(m_listings[root.relativePath.string()],
+                              (size_t) 0));
+
+    bool rval = true;
+    while (rval && !stack.empty()) {
+        Listing* l = stack.back().first;
+        if (!l->done) {
+            // hand over what we have before waiting on more
+            if (!deliver(batch)) {
+                rval = false;
+                break;
+            }
+            readListing(l);
+        }
+        if (stack.back().second == l->entries.size()) {
+            stack.pop_back();
+            releaseListing(l);
+            continue;
+        }
+
+        const WalkEntry& e = l->entries[stack.back().second++];
+        batch.push_back(e);
+        if (e.isDirectory) {
+            Listing* child = NULL;
+            {
+                bp::sync::Lock lck(m_lock);
+                map<string, Listing*>::iterator it =
+                    m_listings.find(e.relativePath.string());
+                if (it != m_listings.end()) child = it->second;
+            }
+            if (child) {
+                stack.push_back(make_pair(child, (size_t) 0));
+            }
+        }
+        if (batch.size() >= WALK_BATCH_SIZE) {
+            rval = deliver(batch);
+        }
+    }
+    if (rval) {
+        rval = deliver(batch);
+    }
+    return rval;
+}
+
+
+bool
+Walker::run(const WalkEntry& root)
+{
+    DirJob job;
+    job.path = root.path;
+    job.relativePath = root.relativePath;
+    if (m_ordered) {
+        addDirectory(job);
+    } else {
+        m_jobs.push_back(job);
+        m_batches.push_back(vector<WalkEntry>(1, root));
+    }
+
+    size_t started = 0;
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        if (m_threads[i]->run(readerThread, this)) {
+            started++;
+        } else {
+            BPLOG_WARN_STRM("unable to start directory reader thread");
+        }
+    }
+    if (started == 0 && !m_ordered) {
+        // read everything here, then deliver it
+        m_maxBatches = 0;
+        readerLoop();
+    }
+
+    // an ordered walk reads here whatever the readers haven't
+    bool rval = true;
+    if (m_ordered) {
+        rval = deliverInOrder(root);
+        bp::sync::Lock lck(m_lock);
+        m_stopped = true;
+        m_jobsCond.broadcast();
+    }
+    while (rval && !m_ordered) {
+        deque<vector<WalkEntry> > ready;
+        {
+            bp::sync::Lock lck(m_lock);
+            while (m_batches.empty() && !(m_jobs.empty() && m_busy == 0)) {
+                m_batchesCond.wait(&m_lock);
+            }
+            if (m_batches.empty()) {
+                break;
+            }
+            ready.swap(m_batches);
+            m_spaceCond.broadcast();
+        }
+        for (size_t i = 0; i < ready.size(); ++i) {
+            if (m_visitor.visitNodes(ready[i]) == IVisitor::eStop) {
+                rval = false;
+                break;
+            }
+        }
+    }
+
+    if (!rval) {
+        bp::sync::Lock lck(m_lock);
+        m_stopped = true;
+        m_jobsCond.broadcast();
+        m_spaceCond.broadcast();
+    }
+    for (size_t i = 0; i < started; ++i) {
+        m_threads[i]->join();
+    }
+    return rval;
+}
+
+}
+
+
+static bool
+doParallelVisit(const bfs::path& p,
+                IBatchVisitor& v,
+                bool followLinks,
+                bool ordered,
+                unsigned int maxThreads)
+{
+    WalkEntry root;
+    if (!walk::describeRoot(p, followLinks, root)) {
+        BPLOG_WARN_STRM("parallelVisit(" << p << "), unable to stat");
+        return true;
+    }
+
+    // like recursiveVisit(), a lone node is simply visited
+    if (!root.isDirectory) {
+        return v.visitNodes(vector<WalkEntry>(1, root)) != IVisitor::eStop;
+    }
+
+    if (maxThreads == 0) {
+        maxThreads = bp::os::NumProcessors();
+        if (maxThreads > WALK_MAX_THREADS) {
+            maxThreads = WALK_MAX_THREADS;
+        }
+    }
+    walk::Walker w(v, followLinks, ordered, maxThreads);
+    return w.run(root);
+}
+
+
+bool
+parallelVisit(const bfs::path& p,
+              IBatchVisitor& v,
+              bool followLinks,
+              unsigned int maxThreads)
+{
+    return doParallelVisit(p, v, followLinks, false, maxThreads);
+}
+
+
+bool
+parallelVisitInOrder(const bfs::path& p,
+                     IBatchVisitor& v,
+                     bool followLinks,
+                     unsigned int maxThreads)
+{
+    return doParallelVisit(p, v, followLinks, true, maxThreads);
+}
+
+}}
@@ -0,0 +1,143 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpfilewalk.h
+ *
+ *  Internals of bp::file::parallelVisit(), shared between the
+ *  platform neutral reader pool and the platform directory readers.
+ */
+
+#ifndef _BPFILEWALK_H_
+#define _BPFILEWALK_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "api/bpfile.h"
+#include "api/bpsync.h"
+#include "api/bpthread.h"
+
+namespace bp { namespace file { namespace walk {
+
+// identity of a directory, for link cycle detection
+struct DirId {
+    DirId() : device(0), fileHigh(0), fileLow(0) {}
+    bool operator==(const DirId& o) const {
+        return device == o.device && fileHigh == o.fileHigh
+            && fileLow == o.fileLow;
+    }
+    boost::uint64_t device;
+    boost::uint64_t fileHigh;
+    boost::uint64_t fileLow;
+};
+
+struct Listing;
+
+// a directory waiting to be read
+struct DirJob {
+    DirJob() : listing(NULL) {}
+    boost::filesystem::path path;
+    boost::filesystem::path relativePath;
+    // directories from the top node down to (but not including)
+    // this one.  only kept when following links.
+    std::vector<DirId> ancestors;
+    // where an ordered walk collects this directory's entries
+    Listing* listing;
+};
+
+// the entries of one directory, read ahead of an ordered walk
+struct Listing {
+    Listing() : claimed(false), done(false) {}
+    DirJob job;
+    std::vector<WalkEntry> entries;
+    // a reader (or the delivering thread) has started on it
+    bool claimed;
+    bool done;
+};
+
+class Walker {
+public:
+    // an ordered walker delivers nodes in recursiveVisit() order
+    Walker(IBatchVisitor& v, bool followLinks, bool ordered,
+           unsigned int numThreads);
+    ~Walker();
+
+    // walk from root on the calling thread, delivering batches to
+    // the visitor as they fill
+    bool run(const WalkEntry& root);
+
+    // called from readDirectory() on reader threads
+    bool followLinks() const { return m_followLinks; }
+    bool stopped() const { return m_stopped; }
+    void emit(std::vector<WalkEntry>& batch, const WalkEntry& e);
+    void addDirectory(const DirJob& job);
+
+private:
+    static void* readerThread(void* cookie);
+    void readerLoop();
+    void flush(std::vector<WalkEntry>& batch);
+    bool deliverInOrder(const WalkEntry& root);
+    void readListing(Listing* l);
+    void listingRead(Listing* l);
+    void releaseListing(Listing* l);
+    bool deliver(std::vector<WalkEntry>& batch);
+
+    IBatchVisitor& m_visitor;
+    bool m_followLinks;
+    bool m_ordered;
+    std::vector<bp::thread::Thread*> m_threads;
+
+    bp::sync::Mutex m_lock;
+    bp::sync::Condition m_jobsCond;
+    bp::sync::Condition m_batchesCond;
+    bp::sync::Condition m_spaceCond;
+    std::deque<DirJob> m_jobs;
+    std::deque<std::vector<WalkEntry> > m_batches;
+    // readers currently reading a directory
+    unsigned int m_busy;
+    // readers wait once this many batches are queued, 0 for no limit
+    size_t m_maxBatches;
+    volatile bool m_stopped;
+    // ordered walks only.  listings not yet delivered, by relative
+    // path, and how many entries the read ones hold.
+    std::map<std::string, Listing*> m_listings;
+    size_t m_buffered;
+
+    // no copy semantics
+    Walker(const Walker&);
+    Walker& operator=(const Walker&);
+};
+
+// platform specific.  describe the top node of a walk.
+bool describeRoot(const boost::filesystem::path& p, bool followLinks,
+                  WalkEntry& oEntry);
+
+// platform specific.  read one directory, passing each child to
+// w.emit() and each child directory to be descended to w.addDirectory()
+void readDirectory(Walker& w, const DirJob& job,
+                   std::vector<WalkEntry>& batch);
+
+}}}
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpfilewalk_UNIX.cpp
+ *
+ *  Directory reading for bp::file::parallelVisit().  Entry types come
+ *  from readdir()'s d_type, so a plain file or directory costs no stat
+ *  at all.  Links, and filesystems which don't report d_type, cost a
+ *  single fstatat() relative to the open directory.
+ */
+
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "bpfilewalk.h"
+
+#ifdef BP_PLATFORM_BUILD
+#include "api/BPLog.h"
+#else
+#define BPLOG_WARN(x)
+#define BPLOG_WARN_STRM(x)
+#endif
+
+using namespace std;
+namespace bfs = boost::filesystem;
+
+namespace bp { namespace file { namespace walk {
+
+static DirId
+idFromStat(const struct stat& s)
+{
+    DirId rval;
+    rval.device = s.st_dev;
+    rval.fileLow = s.st_ino;
+    return rval;
+}
+
+
+static unsigned char
+typeFromMode(mode_t mode)
+{
+    if (S_ISDIR(mode)) return DT_DIR;
+    if (S_ISLNK(mode)) return DT_LNK;
+    if (S_ISREG(mode)) return DT_REG;
+    return DT_UNKNOWN;
+}
+
+
+#ifdef MACOSX
+// resolveLink() changes the working directory while it works
+static bp::sync::Mutex s_resolveLock;
+#endif
+
+
+bool
+describeRoot(const bfs::path& p,
+             bool followLinks,
+             WalkEntry& oEntry)
+{
+    // readers open directories by path, keep them absolute
+    bfs::path abs = p;
+    try {
+        abs = bfs::absolute(p);
+    } catch (const bfs::filesystem_error&) {
+        // use as is
+    }
+
+    struct stat s;
+    if (::lstat(abs.c_str(), &s) != 0) {
+        return false;
+    }
+    oEntry.path = abs;
+    oEntry.relativePath = p.filename();
+    if (S_ISLNK(s.st_mode)) {
+        char buf[PATH_MAX+1];
+        if (::realpath(abs.c_str(), buf) == NULL
+            || ::stat(buf, &s) != 0) {
+            oEntry.isLink = oEntry.isBrokenLink = true;
+            return true;
+        }
+        if (!followLinks) {
+            oEntry.isLink = true;
+            return true;
+        }
+        oEntry.path = buf;
+    }
+    oEntry.isDirectory = S_ISDIR(s.st_mode);
+    return true;
+}
+
+
+void
+readDirectory(Walker& w,
+              const DirJob& job,
+              vector<WalkEntry>& batch)
+{
+    int fd = ::open(job.path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        BPLOG_WARN_STRM("visiting children of " << job.path
+                        << " failed, continuing: unable to open");
+        return;
+    }
+
+    // when chasing links, remember ourselves for cycle detection
+    vector<DirId> ancestors;
+    struct stat s;
+    if (w.followLinks()) {
+        ancestors = job.ancestors;
+        if (::fstat(fd, &s) == 0) {
+            ancestors.push_back(idFromStat(s));
+        }
+    }
+
+    DIR* dir = ::fdopendir(fd);
+    if (dir == NULL) {
+        BPLOG_WARN_STRM("visiting children of " << job.path
+                        << " failed, continuing: unable to read");
+        ::close(fd);
+        return;
+    }
+
+    struct dirent* de;
+    while (!w.stopped() && (de = ::readdir(dir)) != NULL) {
+        const char* name = de->d_name;
+        if (name[0] == '.'
+            && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        WalkEntry e;
+        e.path = job.path / name;
+        e.relativePath = job.relativePath / name;
+
+        unsigned char type = de->d_type;
+        if (type == DT_UNKNOWN) {
+            if (::fstatat(fd, name, &s, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            type = typeFromMode(s.st_mode);
+        }
+
+        if (type == DT_LNK) {
+            // one stat of the target tells us both whether the link
+            // is broken and what it points at
+            char buf[PATH_MAX+1];
+            if (::fstatat(fd, name, &s, 0) != 0
+                || (w.followLinks()
+                    && ::realpath(e.path.c_str(), buf) == NULL)) {
+                e.isLink = e.isBrokenLink = true;
+                w.emit(batch, e);
+                continue;
+            }
+            if (!w.followLinks()) {
+                e.isLink = true;
+                w.emit(batch, e);
+                continue;
+            }
+            e.path = buf;
+            type = typeFromMode(s.st_mode);
+            if (type == DT_DIR
+                && find(ancestors.begin(), ancestors.end(), idFromStat(s))
+                   != ancestors.end()) {
+                BPLOG_WARN_STRM("circular link to " << e.path << " found");
+                continue;
+            }
+        }
+#ifdef MACOSX
+        else if (type == DT_REG && isLink(e.path)) {
+            // aliases appear as regular files
+            bfs::path target;
+            bool resolved;
+            {
+                bp::sync::Lock lck(s_resolveLock);
+                resolved = resolveLink(e.path, target);
+            }
+            if (!resolved || !w.followLinks()) {
+                e.isLink = true;
+                e.isBrokenLink = !resolved;
+                w.emit(batch, e);
+                continue;
+            }
+            if (::stat(target.c_str(), &s) != 0) {
+                continue;
+            }
+            e.path = target;
+            type = typeFromMode(s.st_mode);
+            if (type == DT_DIR
+                && find(ancestors.begin(), ancestors.end(), idFromStat(s))
+                   != ancestors.end()) {
+                BPLOG_WARN_STRM("circular link to " << e.path << " found");
+                continue;
+            }
+        }
+#endif
+
+        e.isDirectory = (type == DT_DIR);
+        w.emit(batch, e);
+        if (e.isDirectory) {
+            DirJob child;
+            child.path = e.path;
+            child.relativePath = e.relativePath;
+            child.ancestors = ancestors;
+            w.addDirectory(child);
+        }
+    }
+
+    // also closes fd
+    ::closedir(dir);
+}
+
+}}}
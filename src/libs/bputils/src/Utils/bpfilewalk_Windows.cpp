@@ -0,0 +1,168 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpfilewalk_Windows.cpp
+ *
+ *  Directory reading for bp::file::parallelVisit().  FindNextFile()
+ *  hands back attributes with each name, so only links (symlinks
+ *  and shortcuts) need further examination.
+ */
+
+#include <windows.h>
+#include <algorithm>
+
+#include "bpfilewalk.h"
+
+#ifdef BP_PLATFORM_BUILD
+#include "api/BPLog.h"
+#else
+#define BPLOG_WARN(x)
+#define BPLOG_WARN_STRM(x)
+#endif
+
+using namespace std;
+namespace bfs = boost::filesystem;
+
+namespace bp { namespace file { namespace walk {
+
+static bool
+dirId(const bfs::path& p, DirId& oId)
+{
+    FileInfo fi;
+    if (!statFile(p, fi)) {
+        return false;
+    }
+    oId.device = fi.deviceId;
+    oId.fileHigh = fi.fileIdHigh;
+    oId.fileLow = fi.fileIdLow;
+    return true;
+}
+
+
+bool
+describeRoot(const bfs::path& p,
+             bool followLinks,
+             WalkEntry& oEntry)
+{
+    bfs::path abs = p;
+    try {
+        abs = bfs::absolute(p);
+    } catch (const bfs::filesystem_error&) {
+        // use as is
+    }
+    if (!pathExists(abs) && !isLink(abs)) {
+        return false;
+    }
+    oEntry.path = abs;
+    oEntry.relativePath = p.filename();
+    if (isLink(abs)) {
+        bfs::path target;
+        if (!resolveLink(abs, target)) {
+            oEntry.isLink = oEntry.isBrokenLink = true;
+            return true;
+        }
+        if (!followLinks) {
+            oEntry.isLink = true;
+            return true;
+        }
+        oEntry.path = target;
+    }
+    oEntry.isDirectory = isDirectory(oEntry.path);
+    return true;
+}
+
+
+void
+readDirectory(Walker& w,
+              const DirJob& job,
+              vector<WalkEntry>& batch)
+{
+    // when chasing links, remember ourselves for cycle detection
+    vector<DirId> ancestors;
+    if (w.followLinks()) {
+        ancestors = job.ancestors;
+        DirId id;
+        if (dirId(job.path, id)) {
+            ancestors.push_back(id);
+        }
+    }
+
+    WIN32_FIND_DATAW fd;
+    bfs::path pattern = job.path / "*";
+    HANDLE h = FindFirstFileW(nativeString(pattern).c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        BPLOG_WARN_STRM("visiting children of " << job.path
+                        << " failed, continuing: unable to read");
+        return;
+    }
+
+    do {
+        const wchar_t* name = fd.cFileName;
+        if (name[0] == L'.'
+            && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0'))) {
+            continue;
+        }
+
+        WalkEntry e;
+        e.path = job.path / name;
+        e.relativePath = job.relativePath / name;
+        bool isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        bool isSym = (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            && fd.dwReserved0 == IO_REPARSE_TAG_SYMLINK;
+
+        // shortcuts have .lnk suffix
+        if (isSym || (!isDir && e.path.extension().string() == ".lnk")) {
+            bfs::path target;
+            bool resolved = resolveLink(e.path, target);
+            if (!resolved || !w.followLinks()) {
+                e.isLink = true;
+                e.isBrokenLink = !resolved;
+                w.emit(batch, e);
+                continue;
+            }
+            e.path = target;
+            isDir = isDirectory(target);
+            DirId id;
+            if (isDir && dirId(target, id)
+                && find(ancestors.begin(), ancestors.end(), id)
+                   != ancestors.end()) {
+                BPLOG_WARN_STRM("circular link to " << e.path << " found");
+                continue;
+            }
+        }
+
+        e.isDirectory = isDir;
+        w.emit(batch, e);
+        if (isDir) {
+            DirJob child;
+            child.path = e.path;
+            child.relativePath = e.relativePath;
+            child.ancestors = ancestors;
+            w.addDirectory(child);
+        }
+    } while (!w.stopped() && FindNextFileW(h, &fd));
+
+    FindClose(h);
+}
+
+}}}
@@ -34,13 +34,27 @@
 #include <sstream> 
 
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <stdlib.h>
 #ifdef LINUX
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #endif
+#ifdef MACOSX
+#include <spawn.h>
+#include <AvailabilityMacros.h>
+extern char ** environ;
+#if defined(MAC_OS_X_VERSION_10_15) \
+    && MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_15
+#define SPAWN_CAN_CHDIR 1
+#endif
+#endif
 
 using std::string;
 using std::vector;
@@ -50,10 +64,10 @@ namespace bfs = boost::filesystem;
 
 // Forward Declarations
 static bool
-forkAndExec(const bfs::path & path,
-            const bfs::path & pwd,
-            char *const argv[],
-            bp::process::spawnStatus* pStat);
+spawnChild(const bfs::path & path,
+           const bfs::path & pwd,
+           char *const argv[],
+           bp::process::spawnStatus* pStat);
 
 
 long
@@ -63,6 +77,15 @@ bp::process::currentPid()
 }
 
 
+bool
+bp::process::setCloseOnExec(int fd)
+{
+    int flags = fcntl(fd, F_GETFD);
+    if (flags == -1) return false;
+    return fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == 0;
+}
+
+
 bool
 bp::process::spawn(const bfs::path& path,
                    const vector<string>& vsArgs,
@@ -91,62 +114,276 @@ bp::process::spawn(const bfs::path& path,
     // argv[argc] = 0.
     vArgs.push_back(0);
 
-    return forkAndExec(path, wd, &vArgs[0], pStatus);
+    return spawnChild(path, wd, &vArgs[0], pStatus);
 }
 
 
-bool
+// Children get stdin, stdout and stderr and nothing else: IPC sockets,
+// log files and whatever other threads have open stay with us.
+// Exec failures are reported to the caller rather than as the exit
+// code of a child that never became the requested program.
+
+static bool
+spawnResult(bp::process::spawnStatus* pStat, pid_t pid, int err)
+{
+    if (pStat)
+    {
+        pStat->errCode = err;
+        pStat->pid = err ? 0 : pid;
+    }
+    // leave errno meaningful for callers that report lastErrorString()
+    if (err) errno = err;
+    return err == 0;
+}
+
+
+#ifdef LINUX
+
+// everything the child needs, set up before cloning so that the child
+// itself never allocates
+struct ChildArgs
+{
+    const char * path;
+    const char * pwd;
+    char *const * argv;
+    long maxfd;
+    sigset_t oldMask;
+    // written by the child when chdir or exec fail, read by the parent
+    // once the child has exec'd or exited
+    volatile int err;
+};
+
+
+// a record as returned by getdents64
+struct KernelDirent64
+{
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+
+// close every descriptor above stderr.  runs in the child, so the list
+// is the child's own, read with raw syscalls rather than opendir(),
+// which allocates.  closing while reading may hide entries from the
+// read, so rescan until a pass closes nothing.
+static void
+closeInheritedFds(long maxfd)
+{
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, 3, ~0U, 0) == 0) return;
+#endif
+    int dfd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY);
+    if (dfd < 0) {
+        for (long fd = 3; fd < maxfd; fd++) close((int) fd);
+        return;
+    }
+    long buf[512];
+    bool closed = true;
+    while (closed) {
+        closed = false;
+        if (lseek(dfd, 0, SEEK_SET) != 0) break;
+        long n;
+        while ((n = syscall(SYS_getdents64, dfd, buf, sizeof(buf))) > 0) {
+            for (long off = 0; off < n; ) {
+                KernelDirent64 * e = (KernelDirent64 *) ((char *) buf + off);
+                off += e->d_reclen;
+                int fd = 0;
+                const char * c = e->d_name;
+                if (*c < '0' || *c > '9') continue;
+                for (; *c >= '0' && *c <= '9'; c++) fd = fd * 10 + (*c - '0');
+                if (fd > 2 && fd != dfd) {
+                    close(fd);
+                    closed = true;
+                }
+            }
+        }
+    }
+    close(dfd);
+}
+
+
+// runs in the child on the parent's memory, with the parent suspended,
+// so only async-signal-safe calls and no writes but ChildArgs::err
+static int
+childMain(void * cookie)
+{
+    ChildArgs * a = (ChildArgs *) cookie;
+
+    // the parent's handlers would run on the parent's memory
+    for (int sig = 1; sig < _NSIG; sig++) {
+        struct sigaction sa;
+        if (sigaction(sig, NULL, &sa) == 0 && sa.sa_handler != SIG_IGN
+            && sa.sa_handler != SIG_DFL)
+        {
+            sa.sa_handler = SIG_DFL;
+            sa.sa_flags = 0;
+            (void) sigaction(sig, &sa, NULL);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &a->oldMask, NULL);
+
+    if (a->pwd && 0 != chdir(a->pwd)) {
+        a->err = errno;
+        _exit(127);
+    }
+
+    closeInheritedFds(a->maxfd);
+
+    execv(a->path, a->argv);
+    a->err = errno ? errno : ENOEXEC;
+    _exit(127);
+    return 0;
+}
+
+
+// clone(CLONE_VM|CLONE_VFORK) shares our address space with the child
+// until it execs, so no page tables are copied however large we've
+// grown, and the child can hand back exec's errno in memory.
+static bool
+spawnChild(const bfs::path & path,
+           const bfs::path & pwd,
+           char *const argv[],
+           bp::process::spawnStatus* pStat)
+{
+    ChildArgs a;
+    a.path = path.c_str();
+    a.pwd = pwd.empty() ? NULL : pwd.c_str();
+    a.argv = argv;
+    a.maxfd = sysconf(_SC_OPEN_MAX);
+    a.err = 0;
+
+    const size_t stackSize = 64 * 1024;
+    void * stack = mmap(NULL, stackSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) return spawnResult(pStat, 0, errno);
+
+    // no signals until the child has reset its handlers
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &a.oldMask);
+
+    pid_t pid = clone(childMain, (char *) stack + stackSize,
+                      CLONE_VM | CLONE_VFORK | SIGCHLD, &a);
+    int cloneErr = errno;
+
+    pthread_sigmask(SIG_SETMASK, &a.oldMask, NULL);
+    munmap(stack, stackSize);
+
+    if (pid == -1) return spawnResult(pStat, 0, cloneErr);
+
+    if (a.err != 0) {
+        // reap the child that failed to become path
+        int status;
+        while (waitpid(pid, &status, 0) == -1 && errno == EINTR) { }
+        return spawnResult(pStat, 0, a.err);
+    }
+    return spawnResult(pStat, pid, 0);
+}
+
+#else
+
+// fork, then report chdir or exec failure over a close-on-exec pipe:
+// the parent reading EOF means the exec succeeded.
+static bool
 forkAndExec(const bfs::path & path,
             const bfs::path & pwd,
             char *const argv[],
             bp::process::spawnStatus* pStat)
 {
+    int status[2];
+    if (0 != pipe(status)) return spawnResult(pStat, 0, errno);
+    (void) bp::process::setCloseOnExec(status[0]);
+    (void) bp::process::setCloseOnExec(status[1]);
+
+    long maxfd = sysconf(_SC_OPEN_MAX);
+
     pid_t pid = fork();
     if (pid == 0)
     {
-        // if a pwd is provided, now is the time to chdir
+        int err = 0;
         if (!pwd.empty() && 0 != chdir(pwd.c_str())) {
-            // TODO: we need a good way to return error!
-            // a convention around return codes??
-            std::cerr << "failed to chdir()" << std::endl;
-            exit(1);
-        }
-
-        // We're the child.  Now execute the desired image.
-        int nRet = execv(path.c_str(), argv);
-        if (nRet == -1)
-        {
-            // TODO: perhaps notify parent of child execve failure.
-            exit(1);
+            err = errno;
+        } else {
+            for (long fd = 3; fd < maxfd; fd++) {
+                if (fd != status[1]) close((int) fd);
+            }
+            execv(path.c_str(), argv);
+            err = errno ? errno : ENOEXEC;
         }
+        (void) write(status[1], &err, sizeof(err));
+        _exit(127);
+    }
 
-        // return is basically irrelevant in this case.
-        return true;
+    int forkErr = errno;
+    close(status[1]);
+    if (pid == -1) {
+        close(status[0]);
+        return spawnResult(pStat, 0, forkErr);
     }
-    else if (pid == -1)
-    {
-        // We're the parent and fork failed.
-        if (pStat)
-        {
-            pStat->errCode = errno;
-            pStat->pid = 0;
-        }
 
-        return false;
+    int err = 0;
+    ssize_t n;
+    while ((n = read(status[0], &err, sizeof(err))) == -1
+           && errno == EINTR) { }
+    close(status[0]);
+
+    if (n == sizeof(err) && err != 0) {
+        int st;
+        while (waitpid(pid, &st, 0) == -1 && errno == EINTR) { }
+        return spawnResult(pStat, 0, err);
     }
-    else
+    return spawnResult(pStat, pid, 0);
+}
+
+
+static bool
+spawnChild(const bfs::path & path,
+           const bfs::path & pwd,
+           char *const argv[],
+           bp::process::spawnStatus* pStat)
+{
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+    // posix_spawn vforks and reports exec failure itself.  It can
+    // chdir only from 10.15 on, before that spawns wanting a pwd fork.
+#ifndef SPAWN_CAN_CHDIR
+    if (pwd.empty())
+#endif
     {
-        // We're the parent and fork succeeded.
-        if (pStat)
-        {
-            pStat->errCode = 0;
-            pStat->pid = pid;
+        posix_spawnattr_t attr;
+        posix_spawn_file_actions_t actions;
+        if (0 == posix_spawnattr_init(&attr)) {
+            (void) posix_spawnattr_setflags(&attr,
+                                            POSIX_SPAWN_CLOEXEC_DEFAULT);
+            (void) posix_spawn_file_actions_init(&actions);
+            for (int fd = 0; fd <= 2; fd++) {
+                (void) posix_spawn_file_actions_addinherit_np(&actions, fd);
+            }
+            int err = 0;
+#ifdef SPAWN_CAN_CHDIR
+            if (!pwd.empty()) {
+                err = posix_spawn_file_actions_addchdir_np(&actions,
+                                                           pwd.c_str());
+            }
+#endif
+            pid_t pid = 0;
+            if (err == 0) {
+                err = posix_spawn(&pid, path.c_str(), &actions, &attr,
+                                  argv, environ);
+            }
+            posix_spawn_file_actions_destroy(&actions);
+            posix_spawnattr_destroy(&attr);
+            return spawnResult(pStat, pid, err);
         }
-
-        return true;
     }
+#endif
+    return forkAndExec(path, pwd, argv, pStat);
 }
 
+#endif
+
 
 bool
 bp::process::wait(const bp::process::spawnStatus& stat,
@@ -0,0 +1,132 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpsha256.cpp
+ *
+ *  Copyright 2010 Yahoo! Inc. All rights reserved.
+ *
+ */
+
+#include "bpsha256.h"
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <openssl/sha.h>
+
+using namespace std;
+
+
+namespace bp {
+namespace sha256 {
+
+
+static string
+toHex( const unsigned char* chBuf )
+{
+    stringstream ss;
+    for( int i=0; i<SHA256_DIGEST_LENGTH; i++)
+    {
+        ss << setw(2) << setfill('0') << hex << (unsigned int)chBuf[i];
+    }
+    return ss.str();
+}
+
+
+string hash( const std::string& sIn )
+{
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+
+    SHA256_Update(&ctx, sIn.c_str(), sIn.length() );
+
+    unsigned char chBuf[SHA256_DIGEST_LENGTH];
+    SHA256_Final( chBuf, &ctx );
+
+    return toHex(chBuf);
+}
+
+
+string hashFile( const boost::filesystem::path& path )
+{
+    ifstream ifs;
+    if (!bp::file::openReadableStream(ifs, path, ios::in | ios::binary)) {
+        return string();
+    }
+
+    Hasher hasher;
+    char buf[64 * 1024];
+    while (ifs.good()) {
+        ifs.read(buf, sizeof(buf));
+        if (ifs.gcount() > 0) {
+            hasher.update(buf, (size_t) ifs.gcount());
+        }
+    }
+    if (ifs.bad()) {
+        return string();
+    }
+
+    return hasher.digest();
+}
+
+
+Hasher::Hasher()
+    : m_pCtx(new SHA256_CTX)
+{
+    reset();
+}
+
+
+Hasher::~Hasher()
+{
+    delete (SHA256_CTX*) m_pCtx;
+}
+
+
+void Hasher::reset()
+{
+    SHA256_Init((SHA256_CTX*) m_pCtx);
+}
+
+
+void Hasher::update( const void* pData, size_t len )
+{
+    if (len > 0) {
+        SHA256_Update((SHA256_CTX*) m_pCtx, pData, len);
+    }
+}
+
+
+string Hasher::digest() const
+{
+    // finish a copy, so more data may still be added
+    SHA256_CTX ctx = *((SHA256_CTX*) m_pCtx);
+    unsigned char chBuf[SHA256_DIGEST_LENGTH];
+    SHA256_Final( chBuf, &ctx );
+
+    return toHex(chBuf);
+}
+
+
+} // sha256
+} // bp
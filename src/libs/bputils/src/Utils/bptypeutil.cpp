@@ -577,6 +577,22 @@ bp::Map::add(const std::string& key, bp::Object* value)
     add(key.c_str(), value);
 }
 
+bool
+bp::Map::replace(const char * key, bp::Object * value)
+{
+    BPASSERT(value != NULL);
+    if (key == NULL) return false;
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        if (!strcmp(key, keys[i].c_str())) {
+            delete values[i];
+            values[i] = value;
+            e.value.mapVal.elements[i].value = (BPElement *) value->elemPtr();
+            return true;
+        }
+    }
+    return false;
+}
+
 bool
 bp::Map::getBool(const std::string& sPath, bool& bValue) const
 {
@@ -658,6 +674,13 @@ bp::Map::Iterator::nextKey()
     return key;
 }
 
+const bp::Object *
+bp::Map::Iterator::value() const
+{
+    if (m_it == m_m->keys.begin()) return NULL;
+    return m_m->values[(m_it - m_m->keys.begin()) - 1];
+}
+
 bp::Map::operator std::map<std::string, const bp::Object *>() const
 {
     std::map<std::string, const bp::Object *> m;
@@ -825,6 +848,17 @@ bp::List::append(bp::Object * object)
         (BPElement *) object->elemPtr();
 }
 
+bool
+bp::List::replace(unsigned int i, bp::Object * object)
+{
+    BPASSERT(object != NULL);
+    if (i >= values.size()) return false;
+    delete values[i];
+    values[i] = object;
+    e.value.listVal.elements[i] = (BPElement *) object->elemPtr();
+    return true;
+}
+
 bp::Object *
 bp::List::clone() const
 {
@@ -293,6 +293,40 @@ BPObjectTest::mapTest()
     delete o;
 }
 
+void
+BPObjectTest::replaceTest()
+{
+    bp::List l;
+    l.append(new bp::Integer(1));
+    l.append(new bp::String("two"));
+    l.append(new bp::Integer(3));
+    CPPUNIT_ASSERT( l.replace(1, new bp::Integer(2)) );
+    CPPUNIT_ASSERT( !l.replace(3, &l) );
+    CPPUNIT_ASSERT( l.size() == 3 );
+
+    // replaced in place, and the C representation follows
+    CPPUNIT_ASSERT( (long long) l[1] == 2 );
+    const BPElement * e = l.elemPtr();
+    CPPUNIT_ASSERT( e->value.listVal.elements[1] == l.value(1)->elemPtr() );
+
+    bp::Map m;
+    m.add("a", new bp::Integer(1));
+    m.add("b", new bp::String("two"));
+    m.add("c", new bp::Integer(3));
+    CPPUNIT_ASSERT( m.replace("b", new bp::Integer(2)) );
+    CPPUNIT_ASSERT( !m.replace("d", &m) );
+    CPPUNIT_ASSERT( m.size() == 3 );
+
+    // key order is preserved, unlike add()
+    bp::Map::Iterator it(m);
+    CPPUNIT_ASSERT_EQUAL( std::string("a"), std::string(it.nextKey()) );
+    CPPUNIT_ASSERT_EQUAL( std::string("b"), std::string(it.nextKey()) );
+    CPPUNIT_ASSERT_EQUAL( std::string("c"), std::string(it.nextKey()) );
+    CPPUNIT_ASSERT( (long long) m["b"] == 2 );
+    e = m.elemPtr();
+    CPPUNIT_ASSERT( e->value.mapVal.elements[1].value == m.value("b")->elemPtr() );
+}
+
 void
 BPObjectTest::exceptionTest()
 {
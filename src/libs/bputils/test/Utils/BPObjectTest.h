@@ -48,6 +48,7 @@ class BPObjectTest : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST(callbackTest);
     CPPUNIT_TEST(listTest);
     CPPUNIT_TEST(mapTest);
+    CPPUNIT_TEST(replaceTest);
     CPPUNIT_TEST(exceptionTest);
     CPPUNIT_TEST(parsingTest);
     CPPUNIT_TEST_SUITE_END();
@@ -62,6 +63,7 @@ protected:
     void callbackTest();
     void listTest();
     void mapTest();
+    void replaceTest();
     void exceptionTest();
     void parsingTest();
 };
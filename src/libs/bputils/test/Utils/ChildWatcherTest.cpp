@@ -0,0 +1,144 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ChildWatcherTest.cpp
+ *
+ * Events must arrive when the child acts, not up to a poll period
+ * later.  Where watching isn't supported there's nothing to test.
+ */
+
+#include "ChildWatcherTest.h"
+#include "BPUtils/bpchildwatcher.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptimer.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChildWatcherTest);
+
+#ifndef WIN32
+
+// nothing polls here, so any event at all arrived as it happened.  the
+// bound is only there so that a lost event fails rather than hangs.
+#define EVENT_TIMEOUT_MSEC 10000
+
+class RunLoopStoppingWatcher : public bp::process::IChildWatcherListener,
+                               public bp::time::ITimerListener
+{
+public:
+    RunLoopStoppingWatcher(bp::runloop::RunLoop * rl)
+        : exitCode(-1), exitSec(0), createdSec(0), m_rl(rl)
+    {
+        m_timer.setListener(this);
+        m_timer.setMsec(EVENT_TIMEOUT_MSEC);
+    }
+    int exitCode;
+    double exitSec;
+    double createdSec;
+    bp::time::Stopwatch sw;
+private:
+    void childExited(bp::process::ChildWatcher *, int code)
+    {
+        exitCode = code;
+        exitSec = sw.elapsedSec();
+        m_rl->stop();
+    }
+    void pathCreated(bp::process::ChildWatcher *)
+    {
+        createdSec = sw.elapsedSec();
+        m_rl->stop();
+    }
+    void timesUp(bp::time::Timer *)
+    {
+        m_rl->stop();
+    }
+    bp::runloop::RunLoop * m_rl;
+    bp::time::Timer m_timer;
+};
+
+static bool
+spawnShell(const std::string & cmd, bp::process::spawnStatus & s)
+{
+    std::vector<std::string> args;
+    args.push_back("-c");
+    args.push_back(cmd);
+    return bp::process::spawn("/bin/sh", args, &s);
+}
+
+void
+ChildWatcherTest::exitTest()
+{
+    bp::runloop::RunLoop rl;
+    rl.init();
+
+    RunLoopStoppingWatcher l(&rl);
+    bp::process::ChildWatcher w;
+    w.setListener(&l);
+
+    bp::process::spawnStatus s;
+    l.sw.start();
+    CPPUNIT_ASSERT( spawnShell("sleep 0.1; exit 5", s) );
+    if (w.watchExit(s)) {
+        rl.run();
+        CPPUNIT_ASSERT( l.exitCode == 5 );
+        // not before the child got around to exiting
+        CPPUNIT_ASSERT( l.exitSec >= 0.1 );
+    } else {
+        int code;
+        (void) bp::process::wait(s, true, code);
+    }
+
+    rl.shutdown();
+}
+
+void
+ChildWatcherTest::pathTest()
+{
+    bp::runloop::RunLoop rl;
+    rl.init();
+
+    boost::filesystem::path path =
+        bp::file::getTempPath(bp::file::getTempDirectory(), "watched");
+
+    RunLoopStoppingWatcher l(&rl);
+    bp::process::ChildWatcher w;
+    w.setListener(&l);
+
+    if (w.watchPath(path)) {
+        bp::process::spawnStatus s;
+        l.sw.start();
+        CPPUNIT_ASSERT( spawnShell("sleep 0.1; touch '" + path.string()
+                                   + "'", s) );
+        rl.run();
+        CPPUNIT_ASSERT( bp::file::pathExists(path) );
+        CPPUNIT_ASSERT( l.createdSec >= 0.1 );
+        int code;
+        (void) bp::process::wait(s, true, code);
+        (void) bp::file::safeRemove(path);
+    }
+
+    rl.shutdown();
+}
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "FileWalkTest.h"
+#include <set>
+#include <sstream>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstrutil.h"
+
+using namespace std;
+using namespace bp::file;
+namespace bfs = boost::filesystem;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FileWalkTest);
+
+namespace {
+    class PathVisitor : virtual public IVisitor {
+    public:
+        virtual tResult visitNode(const bfs::path& /*p*/,
+                                  const bfs::path& relativePath) {
+            m_paths.insert(relativePath.string());
+            return eOk;
+        }
+        set<string> m_paths;
+    };
+
+    class OrderVisitor : virtual public IVisitor {
+    public:
+        virtual tResult visitNode(const bfs::path& /*p*/,
+                                  const bfs::path& relativePath) {
+            m_paths.push_back(relativePath.string());
+            return eOk;
+        }
+        vector<string> m_paths;
+    };
+
+    class OrderBatchVisitor : virtual public IBatchVisitor {
+    public:
+        OrderBatchVisitor(size_t limit) : m_limit(limit) {}
+        virtual IVisitor::tResult visitNodes(const vector<WalkEntry>& e) {
+            for (size_t i = 0; i < e.size(); ++i) {
+                if (m_paths.size() >= m_limit) {
+                    return IVisitor::eStop;
+                }
+                m_paths.push_back(e[i].relativePath.string());
+            }
+            return IVisitor::eOk;
+        }
+        vector<string> m_paths;
+        size_t m_limit;
+    };
+
+    class BatchVisitor : virtual public IBatchVisitor {
+    public:
+        BatchVisitor(size_t limit) : m_limit(limit), m_dirs(0) {}
+        virtual IVisitor::tResult visitNodes(const vector<WalkEntry>& e) {
+            for (size_t i = 0; i < e.size(); ++i) {
+                if (m_paths.size() >= m_limit) {
+                    return IVisitor::eStop;
+                }
+                m_paths.insert(e[i].relativePath.string());
+                if (e[i].isDirectory) m_dirs++;
+            }
+            return IVisitor::eOk;
+        }
+        set<string> m_paths;
+        size_t m_limit;
+        size_t m_dirs;
+    };
+}
+
+
+void 
+FileWalkTest::sameAsRecursiveVisit()
+{
+    // a few levels of directories, each with some files
+    for (int i = 0; i < 4; i++) {
+        stringstream ss;
+        ss << "d" << i << "/e" << i << "/f" << i;
+        bfs::path dir = m_dir / ss.str();
+        CPPUNIT_ASSERT(bfs::create_directories(dir));
+        for (int j = 0; j < 50; j++) {
+            stringstream name;
+            name << "file" << j << ".txt";
+            CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / name.str(), "x"));
+            CPPUNIT_ASSERT(bp::strutil::storeToFile(dir.parent_path()
+                                                    / name.str(), "x"));
+        }
+    }
+
+    PathVisitor pv;
+    CPPUNIT_ASSERT(recursiveVisit(m_dir, pv, true));
+    BatchVisitor bv((size_t) -1);
+    CPPUNIT_ASSERT(parallelVisit(m_dir, bv, true, 3));
+    CPPUNIT_ASSERT_EQUAL(pv.m_paths.size(), bv.m_paths.size());
+    CPPUNIT_ASSERT(pv.m_paths == bv.m_paths);
+    // top plus three levels of four
+    CPPUNIT_ASSERT_EQUAL((size_t) 13, bv.m_dirs);
+}
+
+
+void 
+FileWalkTest::stopAtLimit()
+{
+    for (int j = 0; j < 1000; j++) {
+        stringstream name;
+        name << "file" << j;
+        CPPUNIT_ASSERT(bp::strutil::storeToFile(m_dir / name.str(), "x"));
+    }
+    BatchVisitor bv(10);
+    CPPUNIT_ASSERT(!parallelVisit(m_dir, bv, true));
+    CPPUNIT_ASSERT_EQUAL((size_t) 10, bv.m_paths.size());
+}
+
+
+void 
+FileWalkTest::inOrder()
+{
+    // enough directories that readers work ahead of delivery
+    for (int i = 0; i < 20; i++) {
+        stringstream ss;
+        ss << "d" << i << "/e" << i;
+        bfs::path dir = m_dir / ss.str();
+        CPPUNIT_ASSERT(bfs::create_directories(dir));
+        for (int j = 0; j < 30; j++) {
+            stringstream name;
+            name << "file" << j << ".txt";
+            CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / name.str(), "x"));
+            CPPUNIT_ASSERT(bp::strutil::storeToFile(dir.parent_path()
+                                                    / name.str(), "x"));
+        }
+    }
+
+    OrderVisitor ov;
+    CPPUNIT_ASSERT(recursiveVisit(m_dir, ov, true));
+    OrderBatchVisitor all((size_t) -1);
+    CPPUNIT_ASSERT(parallelVisitInOrder(m_dir, all, true, 3));
+    CPPUNIT_ASSERT(ov.m_paths == all.m_paths);
+
+    // a limited walk sees exactly the first nodes recursiveVisit() does
+    size_t limits[] = { 1, 10, 100, 500 };
+    for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); ++i) {
+        OrderBatchVisitor some(limits[i]);
+        CPPUNIT_ASSERT(!parallelVisitInOrder(m_dir, some, true, 3));
+        vector<string> expected(ov.m_paths.begin(),
+                                ov.m_paths.begin() + limits[i]);
+        CPPUNIT_ASSERT(expected == some.m_paths);
+    }
+}
+
+
+void 
+FileWalkTest::circularLink()
+{
+    bfs::path dir1 = m_dir / "dir1";
+    bfs::path dir2 = m_dir / "dir2";
+    CPPUNIT_ASSERT(bfs::create_directory(dir1));
+    CPPUNIT_ASSERT(bfs::create_directory(dir2));
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir1 / "file1", "I am file 1"));
+    CPPUNIT_ASSERT(bp::file::createLink(dir1 / "link1.lnk", dir2));
+    CPPUNIT_ASSERT(bp::file::createLink(dir2 / "link2.lnk", dir1));
+
+    // dir1, file1, link1 -> dir2, link2 -> dir1 is skipped
+    BatchVisitor bv(100);
+    CPPUNIT_ASSERT(parallelVisit(dir1, bv, true));
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, bv.m_paths.size());
+}
+
+
+void 
+FileWalkTest::setUp()
+{
+    m_dir = getTempPath(getTempDirectory(), "FileWalkTest");
+    CPPUNIT_ASSERT(safeRemove(m_dir));
+    CPPUNIT_ASSERT(bfs::create_directories(m_dir));
+}
+
+
+void 
+FileWalkTest::tearDown()
+{
+    CPPUNIT_ASSERT(safeRemove(m_dir));
+}
@@ -0,0 +1,60 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * FileWalkTest.h
+ * Unit tests for bp::file::parallelVisit()
+ */
+
+#ifndef __FILEWALKTEST_H__
+#define __FILEWALKTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+#include "BPUtils/bpfile.h"
+
+class FileWalkTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(FileWalkTest);
+    CPPUNIT_TEST(sameAsRecursiveVisit);
+    CPPUNIT_TEST(stopAtLimit);
+    CPPUNIT_TEST(inOrder);
+#ifndef WIN32
+    // see FileLinkTest
+    CPPUNIT_TEST(circularLink);
+#endif
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+    
+  protected:
+    void sameAsRecursiveVisit();
+    void stopAtLimit();
+    void inOrder();
+    void circularLink();
+
+  private:
+    boost::filesystem::path m_dir;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "ProcessTest.h"
+#include <sstream>
+#include "BPUtils/bpprocess.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ProcessTest);
+
+void ProcessTest::missingBinary()
+{
+    bp::process::spawnStatus s;
+    CPPUNIT_ASSERT( !bp::process::spawn("/no/such/binary/anywhere",
+                                        std::vector<std::string>(), &s) );
+    CPPUNIT_ASSERT( s.pid == 0 );
+    CPPUNIT_ASSERT( s.errCode != 0 );
+}
+
+#ifndef WIN32
+
+// run a shell command, returning its exit code or -1000 if it can't
+// be spawned
+static int
+runShell(const std::string & cmd,
+         const boost::filesystem::path & wd = boost::filesystem::path())
+{
+    std::vector<std::string> args;
+    args.push_back("-c");
+    args.push_back(cmd);
+    bp::process::spawnStatus s;
+    if (!bp::process::spawn("/bin/sh", args, &s, wd)) return -1000;
+    int code = -1000;
+    CPPUNIT_ASSERT( bp::process::wait(s, true, code) );
+    return code;
+}
+
+void ProcessTest::exitCode()
+{
+    CPPUNIT_ASSERT( runShell("exit 7") == 7 );
+    CPPUNIT_ASSERT( runShell("test \"`pwd`\" = /", "/") == 0 );
+}
+
+void ProcessTest::badWorkingDirectory()
+{
+    // reported by spawn rather than by the child's exit code
+    bp::process::spawnStatus s;
+    CPPUNIT_ASSERT( !bp::process::spawn("/bin/sh",
+                                        std::vector<std::string>(), &s,
+                                        "/no/such/directory/anywhere") );
+    CPPUNIT_ASSERT( s.pid == 0 );
+    CPPUNIT_ASSERT( s.errCode != 0 );
+}
+
+void ProcessTest::descriptorsNotInherited()
+{
+    // opened without close-on-exec, spawn must close it anyway
+    int fd = open("/dev/null", O_RDONLY);
+    CPPUNIT_ASSERT( fd > 2 );
+
+    std::stringstream ss;
+    ss << "test ! -e /dev/fd/" << fd;
+    int code = runShell(ss.str());
+    close(fd);
+    CPPUNIT_ASSERT( code == 0 );
+}
+
+#endif
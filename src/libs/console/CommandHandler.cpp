@@ -40,18 +40,39 @@ CommandHandler::setListener(weak_ptr<IHandlerListener> listener)
     m_listener = listener;
 }
 
+// m_commandId is only set while the handler is being invoked, so
+// synchronous completions name their command and asynchronous ones
+// default to the oldest outstanding command
 void
 CommandHandler::onSuccess()
 {
-    shared_ptr<IHandlerListener> listener = m_listener.lock();
-    if (listener) listener->onSuccess();
+    onSuccess(m_commandId);
 }
 
 void
 CommandHandler::onFailure()
+{
+    onFailure(m_commandId);
+}
+
+unsigned int
+CommandHandler::commandId() const
+{
+    return m_commandId;
+}
+
+void
+CommandHandler::onSuccess(unsigned int commandId)
+{
+    shared_ptr<IHandlerListener> listener = m_listener.lock();
+    if (listener) listener->onSuccess(commandId);
+}
+
+void
+CommandHandler::onFailure(unsigned int commandId)
 {
     shared_ptr<IHandlerListener> listener = m_listener.lock();
-    if (listener) listener->onFailure();
+    if (listener) listener->onFailure(commandId);
 }
 
 
@@ -29,6 +29,7 @@
  */
 
 #include "CommandParser.h"
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <stdexcept>
@@ -126,6 +127,8 @@ public:
     BP_DECLARE_COMMAND_HANDLER(help);
     /** the built-in quit command */
     BP_DECLARE_COMMAND_HANDLER(quit);
+    /** the built-in sync command */
+    BP_DECLARE_COMMAND_HANDLER(sync);
     CommandParser * parser;
 };
 
@@ -141,18 +144,41 @@ struct CommandRegistration
 };
 typedef shared_ptr<CommandRegistration> CommandRegistrationPtr;
 
+struct ParserEvent
+{
+    enum { T_ReadEvent, T_QuitEvent } type;
+    std::string line;
+    std::string command;        
+    std::vector<std::string> toks;
+};
+
 
 CommandParser::CommandParser()
     : m_running(false),
       m_waitingForCommandCompletion(false),
       m_registeredBuiltins(false),
-      m_listener(NULL)
+      m_listener(NULL),
+      m_batch(false),
+      m_batchFromFile(false),
+      m_batchReadError(false),
+      m_maxOutstanding(1),
+      m_nextId(0),
+      m_batchEOF(false),
+      m_batchDone(false),
+      m_pumping(false),
+      m_succeeded(0),
+      m_failed(0),
+      m_totalLatency(0.0)
 {
     editline_init();
 }
 
 CommandParser::~CommandParser()
 {
+    while (!m_pending.empty()) {
+        delete m_pending.front();
+        m_pending.pop_front();
+    }
     editline_shutdown();
 }
 
@@ -222,14 +248,17 @@ getTok(std::string & line, std::string & tok)
     return true;
 }
 
-struct ParserEvent
+/** split a line into command and arguments, false for blank lines */
+static bool
+tokenize(ParserEvent * evt)
 {
-    enum { T_ReadEvent, T_QuitEvent } type;
-    std::string line;
-    std::string command;        
-    std::vector<std::string> toks;
-};
-
+    if (!getTok(evt->line, evt->command)) return false;
+    std::string tok;
+    while (getTok(evt->line, tok)) {
+        evt->toks.push_back(tok);
+    }
+    return true;
+}
 
 void
 CommandParser::setPrompt(const char * prompt)
@@ -261,15 +290,10 @@ CommandParser::parse(void * ptrToCommandParser)
         }
     
         // first peel off the command (skip blank commands)
-        if (!getTok(evt->line, evt->command)) {
+        if (!tokenize(evt)) {
             delete evt;
             continue;
         }
-        
-        std::string tok;
-        while (getTok(evt->line, tok)) {
-            evt->toks.push_back(tok);
-        }
             
         // now bundle this up into an object, post it, and exit
         evt->type = ParserEvent::T_ReadEvent;
@@ -280,8 +304,44 @@ CommandParser::parse(void * ptrToCommandParser)
     return NULL;
 }
 
+/** read commands until EOF, posting each to the main thread without
+ *  waiting for the previous one to complete */
+void *
+CommandParser::batchParse(void * ptrToCommandParser)
+{
+    CommandParserPtr cpp = *(CommandParserPtr *) ptrToCommandParser;
+    delete (CommandParserPtr *) ptrToCommandParser;
+
+    // startBatch() opened any file before we were started
+    std::istream * in = &std::cin;
+    if (cpp->m_batchFromFile) in = &cpp->m_batchFile;
+
+    std::string line;
+    while (cpp->m_running && std::getline(*in, line))
+    {
+        ParserEvent * evt = new ParserEvent;
+        evt->line = bp::strutil::trim(line);
+        if (evt->line.empty() || evt->line[0] == '#' || !tokenize(evt)) {
+            delete evt;
+            continue;
+        }
+        evt->type = ParserEvent::T_ReadEvent;
+        cpp->hop(evt);
+    }
+    if (in->bad()) {
+        std::cerr << "error reading batch input" << std::endl;
+        cpp->m_batchReadError = true;
+    }
+
+    ParserEvent * evt = new ParserEvent;
+    evt->type = ParserEvent::T_QuitEvent;
+    cpp->hop(evt);
+
+    return NULL;
+}
+
 void
-CommandParser::start()
+CommandParser::registerBuiltins()
 {
     if (!m_registeredBuiltins) {
         shared_ptr<CommandParserBuiltins>
@@ -307,11 +367,25 @@ CommandParser::start()
                             0, 0, "Quit the program");
 
         if (!s) throw std::runtime_error("couldn't register quit command");
+
+        // and the batch mode barrier
+        s = registerHandler(std::string("sync"), ptr,
+                            BP_COMMAND_HANDLER(CommandParserBuiltins::sync),
+                            0, 0,
+                            "In batch mode, wait for all outstanding\n"
+                            "commands to complete before continuing\n");
+
+        if (!s) throw std::runtime_error("couldn't register sync command");
         
 
         m_registeredBuiltins = true;
     }
-    
+}
+
+void
+CommandParser::start()
+{
+    registerBuiltins();
 
     m_running = true;
     
@@ -322,6 +396,39 @@ CommandParser::start()
     m_thred.run(parse, (void *) cpp);
 }
 
+bool
+CommandParser::startBatch(const std::string & path,
+                          unsigned int maxOutstanding)
+{
+    // open the file here rather than on the reader thread, so a
+    // missing file fails the caller instead of an empty batch
+    if (!path.empty() && path != "-") {
+        m_batchFile.open(path.c_str());
+        if (!m_batchFile.is_open()) {
+            std::cerr << "couldn't open " << path << std::endl;
+            return false;
+        }
+        m_batchFromFile = true;
+    }
+
+    registerBuiltins();
+
+    m_batch = true;
+    m_maxOutstanding = MY_MAX(maxOutstanding, 1);
+    m_running = true;
+    m_batchSw.start();
+
+    CommandParserPtr * cpp = new CommandParserPtr(shared_from_this());
+    m_thred.run(batchParse, (void *) cpp);
+    return true;
+}
+
+bool
+CommandParser::batchSucceeded() const
+{
+    return m_batch && m_batchDone && !m_batchReadError && m_failed == 0;
+}
+
 void
 CommandParser::stop()
 {
@@ -334,6 +441,53 @@ CommandParser::stop()
     m_handlers.clear();
 }
 
+CommandRegistrationPtr
+CommandParser::lookup(ParserEvent * evt)
+{
+    // allow minimal disambiguous command typing, 'i' for 'info'
+    std::set<std::string> candidates;
+    std::map<std::string,
+             shared_ptr<struct CommandRegistration> >::iterator it;
+    for (it = m_handlers.begin(); it != m_handlers.end(); it++)
+    {
+        if (!it->first.substr(0, evt->command.size()).compare(evt->command))
+        {
+            candidates.insert(it->first);
+        }
+    }
+
+    if (candidates.size() == 0) {
+        std::cout << "no such command: " << evt->command << std::endl;
+        return CommandRegistrationPtr();
+    } else if (candidates.size() > 1) {
+        std::cout << "'" << evt->command << "' is ambiguous, could be: ";
+        std::set<std::string>::iterator i;
+        for (i = candidates.begin(); i != candidates.end(); i++)
+        {
+            if (i != candidates.begin()) std::cout << " or ";
+            std::cout << *i;
+        }
+        std::cout << std::endl;
+        return CommandRegistrationPtr();
+    }
+
+    evt->command = *(candidates.begin());
+
+    // gosh, member function pointers are hairy.
+    CommandRegistrationPtr handler(m_handlers[evt->command]);
+
+    // now let's check the number of arguments
+    if (evt->toks.size() < handler->m_minArgs ||
+        evt->toks.size() > handler->m_maxArgs) {
+        std::cout << "command: " << evt->command
+                  << " accepts between " << handler->m_minArgs
+                  << " and " << handler->m_maxArgs
+                  << " arguments" << std::endl;
+        return CommandRegistrationPtr();
+    }
+    return handler;
+}
+
 void
 CommandParser::onHop(void * context)
 {
@@ -341,63 +495,34 @@ CommandParser::onHop(void * context)
     
     ParserEvent * evt = (ParserEvent *) context;
 
-    if (evt->type == ParserEvent::T_ReadEvent)
+    if (m_batch)
     {
-        // allow minimal disambiguous command typing, 'i' for 'info'
-        std::set<std::string> candidates;
-        std::map<std::string,
-                 shared_ptr<struct CommandRegistration> >::iterator it;
-        for (it = m_handlers.begin(); it != m_handlers.end(); it++)
-        {
-            if (!it->first.substr(0, evt->command.size()).compare(evt->command))
-            {
-                candidates.insert(it->first);
-            }
+        if (evt->type == ParserEvent::T_ReadEvent) {
+            // the parser owns queued events until they're dispatched
+            m_pending.push_back(evt);
+            evt = NULL;
+            pump();
+        } else if (!m_running) {
+            // the built-in quit command
+            finishBatch();
+        } else {
+            m_batchEOF = true;
+            pump();
         }
-
-        // invoke command handler
-        if (candidates.size() == 0) {
-            std::cout << "no such command: " << evt->command << std::endl;
-            // restart the parser thread
-            m_thred.join();
-            start();
-        } else if (candidates.size() > 1) {
-            std::cout << "'" << evt->command << "' is ambiguous, could be: ";
-            std::set<std::string>::iterator i;
-            for (i = candidates.begin(); i != candidates.end(); i++)
-            {
-                if (i != candidates.begin()) std::cout << " or ";
-                std::cout << *i;
-            }
-            std::cout << std::endl;
+    }
+    else if (evt->type == ParserEvent::T_ReadEvent)
+    {
+        CommandRegistrationPtr handler = lookup(evt);
+        if (handler == NULL) {
             // restart the parser thread
             m_thred.join();
             start();
         } else {
-            evt->command = *(candidates.begin());
-
-            // gosh, member function pointers are hairy.
-            CommandRegistrationPtr handler(m_handlers[evt->command]);
-
-            // now let's check the number of arguments
-            if (evt->toks.size() < handler->m_minArgs ||
-                evt->toks.size() > handler->m_maxArgs) {
-                std::cout << "command: " << evt->command
-                          << " accepts between " << handler->m_minArgs
-                          << " and " << handler->m_maxArgs
-                          << " arguments" << std::endl;
-
-                // restart the parser thread
-                m_thred.join();
-                start();
-            } else {
-                // call the handler!  expect a success or failure event
-                CommandHandler * hand =
-                    (CommandHandler *) handler->m_rawptr;
-                CommandHandler::callback cb = handler->m_cb;
-                m_waitingForCommandCompletion = true;
-                (hand->*cb)(evt->command, evt->toks);
-            }
+            // call the handler!  expect a success or failure event
+            CommandHandler * hand = (CommandHandler *) handler->m_rawptr;
+            CommandHandler::callback cb = handler->m_cb;
+            m_waitingForCommandCompletion = true;
+            (hand->*cb)(evt->command, evt->toks);
         }
     }
     else if (evt->type == ParserEvent::T_QuitEvent)
@@ -409,9 +534,106 @@ CommandParser::onHop(void * context)
 }
 
 void
-CommandParser::onSuccess()
+CommandParser::pump()
 {
-    if (m_waitingForCommandCompletion) {
+    // handlers may complete synchronously, re-entering via complete()
+    if (m_pumping) return;
+    m_pumping = true;
+
+    while (m_running && !m_pending.empty()
+           && m_outstanding.size() < m_maxOutstanding)
+    {
+        ParserEvent * evt = m_pending.front();
+        if (!evt->command.compare("sync") && !m_outstanding.empty()) break;
+        m_pending.pop_front();
+
+        BatchCommand bc;
+        bc.m_id = ++m_nextId;
+        bc.m_command = evt->command;
+        CommandRegistrationPtr handler = lookup(evt);
+        if (handler == NULL) {
+            std::cout << "#" << bc.m_id << " " << bc.m_command
+                      << " failed" << std::endl;
+            m_failed++;
+            delete evt;
+            continue;
+        }
+        bc.m_command = evt->command;
+        m_outstanding.push_back(bc);
+        m_outstanding.back().m_sw.start();
+
+        CommandHandler * hand = (CommandHandler *) handler->m_rawptr;
+        CommandHandler::callback cb = handler->m_cb;
+        hand->m_commandId = bc.m_id;
+        (hand->*cb)(evt->command, evt->toks);
+        hand->m_commandId = 0;
+        delete evt;
+    }
+
+    m_pumping = false;
+
+    if (m_running && m_batchEOF && m_pending.empty()
+        && m_outstanding.empty())
+    {
+        finishBatch();
+    }
+}
+
+void
+CommandParser::finishBatch()
+{
+    if (!m_batchDone) {
+        m_batchDone = true;
+        double elapsed = m_batchSw.elapsedSec();
+        unsigned int total = m_succeeded + m_failed;
+        std::cout << total << " commands, " << m_succeeded
+                  << " succeeded, " << m_failed << " failed in "
+                  << elapsed << "s";
+        if (m_succeeded > 0) {
+            std::cout << ", mean latency "
+                      << (m_totalLatency / m_succeeded) * 1000.0 << "ms";
+        }
+        if (elapsed > 0.0) {
+            std::cout << ", " << (total / elapsed) << " commands/s";
+        }
+        std::cout << std::endl;
+
+        stop();
+        if (m_listener) m_listener->onUserQuit();
+    }
+}
+
+void
+CommandParser::complete(unsigned int commandId, bool success)
+{
+    std::list<BatchCommand>::iterator it = m_outstanding.begin();
+    if (commandId != 0) {
+        while (it != m_outstanding.end() && it->m_id != commandId) ++it;
+    }
+    if (it == m_outstanding.end()) return;
+
+    double latency = it->m_sw.elapsedSec();
+    std::cout << "#" << it->m_id << " " << it->m_command << " "
+              << (success ? "ok" : "failed") << " "
+              << (unsigned int) (latency * 1000.0 + 0.5) << "ms"
+              << std::endl;
+    if (success) {
+        m_succeeded++;
+        m_totalLatency += latency;
+    } else {
+        m_failed++;
+    }
+    m_outstanding.erase(it);
+
+    pump();
+}
+
+void
+CommandParser::onSuccess(unsigned int commandId)
+{
+    if (m_batch) {
+        complete(commandId, true);
+    } else if (m_waitingForCommandCompletion) {
         // restart the parser thread
         m_thred.join();
         if (m_running) start();
@@ -420,9 +642,11 @@ CommandParser::onSuccess()
 }
 
 void
-CommandParser::onFailure()
+CommandParser::onFailure(unsigned int commandId)
 {
-    if (m_waitingForCommandCompletion) {
+    if (m_batch) {
+        complete(commandId, false);
+    } else if (m_waitingForCommandCompletion) {
         // restart the parser thread
         m_thred.join();
         if (m_running) start();
@@ -499,6 +723,12 @@ BP_DEFINE_COMMAND_HANDLER(CommandParserBuiltins::help)
     onSuccess();
 }
 
+BP_DEFINE_COMMAND_HANDLER(CommandParserBuiltins::sync)
+{
+    // the barrier itself is implemented by CommandParser::pump()
+    onSuccess();
+}
+
 BP_DEFINE_COMMAND_HANDLER(CommandParserBuiltins::quit)
 {
     /* stop the parser thread don't emit a prompt, don't pass go, etc */
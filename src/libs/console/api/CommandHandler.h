@@ -107,12 +107,24 @@ void \
 class CommandHandler
 {
   public:
+    CommandHandler() : m_commandId(0) { }
+
     // a function that should be invoked upon successful completion of
     // processing a command
     void onSuccess();
     // a function that should be invoked when we fail to process a command
     void onFailure();
 
+    // In batch mode several commands may be outstanding at once.
+    // Called from within the handler, onSuccess() and onFailure()
+    // complete the command being handled.  Called later, they complete
+    // the oldest outstanding command, which is right for handlers that
+    // finish in order.  Handlers that may finish out of order should
+    // save commandId() when invoked and pass it back on completion.
+    unsigned int commandId() const;
+    void onSuccess(unsigned int commandId);
+    void onFailure(unsigned int commandId);
+
     typedef bool (CommandHandler::* callback)(
         const std::string & command,
         const std::vector<std::string> & tokens);
@@ -120,12 +132,13 @@ class CommandHandler
     // it could be moved out of the interface to keep things clean
     
     // an interface that allows the CommandParser to get onSuccess,
-    // onFailure calls
+    // onFailure calls.  a commandId of zero means the oldest
+    // outstanding command
     class IHandlerListener 
     {
       public:
-        virtual void onSuccess() = 0;
-        virtual void onFailure() = 0;
+        virtual void onSuccess(unsigned int commandId) = 0;
+        virtual void onFailure(unsigned int commandId) = 0;
         virtual ~IHandlerListener() { };
     };
 
@@ -133,6 +146,7 @@ class CommandHandler
     
     void setListener(std::tr1::weak_ptr<IHandlerListener> listener);
     std::tr1::weak_ptr<IHandlerListener> m_listener;
+    unsigned int m_commandId;
     
     friend class CommandParser;
 };
@@ -38,7 +38,11 @@
 #define __BP_COMMANDPARSER_H__
 
 
+#include <deque>
+#include <fstream>
+#include <list>
 #include <map>
+#include "BPUtils/bpstopwatch.h"
 #include "BPUtils/bpthread.h"
 #include "BPUtils/bpthreadhopper.h"
 #include "CommandHandler.h"
@@ -120,6 +124,29 @@ public:
      */
     void start(void);
 
+    /**
+     * start the command parser in scripted batch mode.  Commands are
+     * read from the file at 'path' (or stdin if path is empty or "-")
+     * on a background thread, with no prompt or line editing.  Up to
+     * maxOutstanding commands are dispatched before any completes.
+     * Each command is assigned an id, and on completion a line with
+     * its id, name, status and latency is printed.  After the last
+     * command completes a summary is printed and the listener's
+     * onUserQuit() is called.  Blank lines and lines starting with
+     * '#' are skipped, and the built-in 'sync' command waits for all
+     * outstanding commands to complete.
+     *
+     * \returns false, having started nothing, if the file can't be
+     *          opened
+     */
+    bool startBatch(const std::string & path, unsigned int maxOutstanding);
+
+    /**
+     * after a batch has finished, true if its input was read in full
+     * and every command in it succeeded
+     */
+    bool batchSucceeded() const;
+
     /**
      * stop the parser, and unregister all commands (releasing boost
      * shared ptrs).  This is a (briefly) blocking call that waits
@@ -131,9 +158,28 @@ public:
     /** the thread function for the background thread */
     static void * parse(void * ptrToSharedPtrOfCommandParser);
 
+    /** the thread function for the batch mode reader thread */
+    static void * batchParse(void * ptrToSharedPtrOfCommandParser);
+
     /** how we get back events from the parser thread */
     virtual void onHop(void * context);
 
+    /** find the registration for a parsed command, printing an
+     *  error and returning NULL if there is none */
+    std::tr1::shared_ptr<struct CommandRegistration>
+        lookup(struct ParserEvent * evt);
+
+    void registerBuiltins();
+
+    /** batch mode: dispatch queued commands while there is room */
+    void pump();
+
+    /** batch mode: a command has finished */
+    void complete(unsigned int commandId, bool success);
+
+    /** batch mode: print a summary and notify the listener */
+    void finishBatch();
+
     bool registerHandler(const std::string & commandName,
                          void * rawptr, 
                          std::tr1::shared_ptr<CommandHandler> handler,
@@ -143,8 +189,8 @@ public:
 
     // IHandlerListener implementation
     // - how the parser is informed when command handlers complete execution
-    virtual void onSuccess();
-    virtual void onFailure();
+    virtual void onSuccess(unsigned int commandId);
+    virtual void onFailure(unsigned int commandId);
 
     /** a map of registered handlers */
     std::map<std::string, std::tr1::shared_ptr<struct CommandRegistration> >
@@ -167,6 +213,30 @@ public:
      *  via user interaction (^D or quit) */
     ICommandHandlerListener * m_listener;
 
+    /** batch mode state */
+    struct BatchCommand
+    {
+        unsigned int m_id;
+        std::string m_command;
+        bp::time::Stopwatch m_sw;
+    };
+    bool m_batch;
+    std::ifstream m_batchFile;
+    bool m_batchFromFile;
+    // set by the reader thread before its final hop
+    bool m_batchReadError;
+    unsigned int m_maxOutstanding;
+    std::deque<struct ParserEvent *> m_pending;
+    std::list<BatchCommand> m_outstanding;
+    unsigned int m_nextId;
+    bool m_batchEOF;
+    bool m_batchDone;
+    bool m_pumping;
+    unsigned int m_succeeded;
+    unsigned int m_failed;
+    double m_totalLatency;
+    bp::time::Stopwatch m_batchSw;
+
     friend class CommandParserBuiltins;
 };
 
@@ -0,0 +1,190 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "CommandParserTest.h"
+#include <sstream>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptimer.h"
+#include "ConsoleLib/ConsoleLib.h"
+
+using namespace std;
+using namespace std::tr1;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CommandParserTest);
+
+
+// A handler whose commands finish asynchronously, newest first, the
+// way responses from a daemon may come back.  Each completes the
+// command which issued it by id.  'execute' fails, everything else
+// succeeds, so a completion charged to the wrong command shows up.
+// (CommandParser invokes handlers through a CommandHandler pointer,
+// so the handler derives from nothing else and the timer is heard
+// by a member.)
+class AsyncHandler : public CommandHandler
+{
+public:
+    AsyncHandler() : m_responder(this)
+    {
+        m_timer.setListener(&m_responder);
+    }
+
+    BP_DECLARE_COMMAND_HANDLER(execute)
+    {
+        issue(false);
+    }
+
+    BP_DECLARE_COMMAND_HANDLER(describe)
+    {
+        issue(true);
+    }
+
+    BP_DECLARE_COMMAND_HANDLER(require)
+    {
+        issue(true);
+    }
+
+private:
+    class Responder : public bp::time::ITimerListener
+    {
+    public:
+        Responder(AsyncHandler * handler) : m_handler(handler) { }
+    private:
+        void timesUp(bp::time::Timer *)
+        {
+            m_handler->respond();
+        }
+        AsyncHandler * m_handler;
+    };
+
+    void issue(bool success)
+    {
+        m_issued.push_back(make_pair(commandId(), success));
+        m_timer.setMsec(10);
+    }
+
+    void respond()
+    {
+        vector<pair<unsigned int, bool> > issued;
+        issued.swap(m_issued);
+        while (!issued.empty()) {
+            pair<unsigned int, bool> r = issued.back();
+            issued.pop_back();
+            if (r.second) onSuccess(r.first);
+            else onFailure(r.first);
+        }
+    }
+
+    vector<pair<unsigned int, bool> > m_issued;
+    Responder m_responder;
+    bp::time::Timer m_timer;
+};
+
+
+class BatchQuitListener : public ICommandHandlerListener,
+                          public bp::time::ITimerListener
+{
+public:
+    BatchQuitListener(bp::runloop::RunLoop * rl)
+        : m_rl(rl), m_quit(false) { }
+
+    void onUserQuit()
+    {
+        m_quit = true;
+        m_rl->stop();
+    }
+
+    // the batch hung
+    void timesUp(bp::time::Timer *)
+    {
+        m_rl->stop();
+    }
+
+    bp::runloop::RunLoop * m_rl;
+    bool m_quit;
+};
+
+
+void
+CommandParserTest::testBatchOutOfOrder()
+{
+    bp::runloop::RunLoop rl;
+    rl.init();
+
+    boost::filesystem::path batchPath =
+        bp::file::getTempPath(bp::file::getTempDirectory(), "CommandParser");
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(
+                       batchPath,
+                       std::string("execute\n"
+                                   "describe\n"
+                                   "require\n"
+                                   "execute\n"
+                                   "describe\n"
+                                   "require\n")));
+
+    // collect the per-command report lines
+    stringstream out;
+    streambuf * coutBuf = cout.rdbuf(out.rdbuf());
+
+    BatchQuitListener listener(&rl);
+    bp::time::Timer watchdog;
+    watchdog.setListener(&listener);
+    watchdog.setMsec(5000);
+
+    CommandParserPtr parser(new CommandParser);
+    parser->setListener(&listener);
+    shared_ptr<AsyncHandler> handler(new AsyncHandler);
+    parser->registerHandler(std::string("execute"), handler,
+                            BP_COMMAND_HANDLER(AsyncHandler::execute),
+                            0, 0, "fails");
+    parser->registerHandler(std::string("describe"), handler,
+                            BP_COMMAND_HANDLER(AsyncHandler::describe),
+                            0, 0, "succeeds");
+    parser->registerHandler(std::string("require"), handler,
+                            BP_COMMAND_HANDLER(AsyncHandler::require),
+                            0, 0, "succeeds");
+    bool started = parser->startBatch(batchPath.string(), 2);
+    if (started) rl.run();
+
+    cout.rdbuf(coutBuf);
+    (void) bp::file::safeRemove(batchPath);
+
+    CPPUNIT_ASSERT(started);
+    CPPUNIT_ASSERT(listener.m_quit);
+    CPPUNIT_ASSERT(!parser->batchSucceeded());
+
+    // every command completed once, with its own result
+    string report = out.str();
+    const char * expected[] = {
+        "#1 execute failed", "#2 describe ok", "#3 require ok",
+        "#4 execute failed", "#5 describe ok", "#6 require ok"
+    };
+    for (unsigned int i = 0; i < sizeof(expected)/sizeof(expected[0]); i++) {
+        CPPUNIT_ASSERT(report.find(expected[i]) != string::npos);
+    }
+    CPPUNIT_ASSERT(report.find("6 commands, 4 succeeded, 2 failed")
+                   != string::npos);
+
+    rl.shutdown();
+}
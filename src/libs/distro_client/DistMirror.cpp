@@ -0,0 +1,491 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistMirror - A caching mirror of the distribution server web services.
+ */
+
+#include "DistMirror.h"
+#include <string.h>
+#include <sstream>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
+#include "bphttp/HttpFileSink.h"
+#include "bphttp/HttpSyncTransaction.h"
+#include "WSProtocol.h"
+
+namespace bfs = boost::filesystem;
+using namespace bp::http;
+
+/**
+ * A SyncTransaction which streams a 200 response body into a file
+ * rather than memory, other response bodies (errors) are small and
+ * collected as usual.
+ */
+class MirrorTransaction : public client::SyncTransaction
+{
+  public:
+    static std::tr1::shared_ptr<MirrorTransaction>
+    alloc(RequestPtr req, const bfs::path & file)
+    {
+        std::tr1::shared_ptr<MirrorTransaction> t(
+            new MirrorTransaction(req, file));
+        return t;
+    }
+
+    virtual void onResponseStatus(const Status & status,
+                                  const Headers & headers)
+    {
+        client::SyncTransaction::onResponseStatus(status, headers);
+        // a redirect or retry restarts the body
+        if (m_sink.isOpen()) {
+            m_sink.restart();
+        } else if (status.code() == Status::OK && !m_sinkFailed) {
+            m_sinkFailed = !m_sink.open(m_file);
+        }
+    }
+
+    virtual void onResponseBodyBytes(const unsigned char * pBytes,
+                                     unsigned int size)
+    {
+        if (m_pResponse->status.code() != Status::OK) {
+            client::SyncTransaction::onResponseBodyBytes(pBytes, size);
+        } else if (m_sink.isOpen() && !m_sink.write(pBytes, size)) {
+            m_sinkFailed = true;
+        }
+    }
+
+    client::FileSink & sink() { return m_sink; }
+    bool sinkFailed() const { return m_sinkFailed; }
+
+  private:
+    MirrorTransaction(RequestPtr req, const bfs::path & file)
+        : client::SyncTransaction(req), m_file(file), m_sinkFailed(false)
+    {
+    }
+
+    bfs::path m_file;
+    client::FileSink m_sink;
+    bool m_sinkFailed;
+};
+
+
+static std::string
+apiPrefix()
+{
+    std::stringstream ss;
+    ss << "/" << WSProtocol::API_PREFIX << "/" << WSProtocol::WS_VERSION
+       << "/";
+    return ss.str();
+}
+
+
+static bool
+hasPrefix(const std::string & s, const char * prefix)
+{
+    return !s.compare(0, strlen(prefix), prefix);
+}
+
+
+// content named by service name and version (and platform) never
+// changes once published
+static bool
+isImmutable(const std::string & path)
+{
+    return (hasPrefix(path, WSProtocol::SERVICE_DOWNLOAD_PATH) ||
+            hasPrefix(path, WSProtocol::SERVICE_DELTA_PATH) ||
+            hasPrefix(path, WSProtocol::SERVICE_METADATA_PATH) ||
+            hasPrefix(path, WSProtocol::SERVICE_SYNOPSIS_PATH));
+}
+
+
+DistMirror::DistMirror(const std::list<std::string> & upstreams,
+                       const bfs::path & cacheDir)
+    : m_upstreams(upstreams), m_cacheDir(cacheDir), m_listTTL(300.0),
+      m_upstreamFetches(0), m_cacheHits(0)
+{
+    try {
+        bfs::create_directories(m_cacheDir / ".partial");
+    } catch (const bfs::filesystem_error & e) {
+        BPLOG_ERROR_STRM("unable to create mirror cache in " << m_cacheDir
+                         << ": " << e.what());
+    }
+}
+
+
+DistMirror::~DistMirror()
+{
+}
+
+
+void
+DistMirror::setListTTL(double secs)
+{
+    bp::sync::Lock lock(m_lock);
+    m_listTTL = secs;
+}
+
+
+unsigned int
+DistMirror::upstreamFetches()
+{
+    bp::sync::Lock lock(m_lock);
+    return m_upstreamFetches;
+}
+
+
+unsigned int
+DistMirror::cacheHits()
+{
+    bp::sync::Lock lock(m_lock);
+    return m_cacheHits;
+}
+
+
+bool
+DistMirror::processRequest(const Request & request, Response & response)
+{
+    if (request.method.code() != Method::HTTP_GET) {
+        response.status.setCode(Status::METHOD_NOT_ALLOWED);
+        return true;
+    }
+
+    std::string path = request.url.path();
+    std::string query = request.url.query();
+
+    // usage reports aren't under the api prefix and must reach
+    // the real server every time
+    if (path == std::string("/") + WSProtocol::USAGE_PATH) {
+        passThrough(WSProtocol::USAGE_PATH, query, response);
+        return true;
+    }
+
+    std::string prefix = apiPrefix();
+    if (path.compare(0, prefix.length(), prefix) ||
+        path.length() == prefix.length())
+    {
+        response.status.setCode(Status::NOT_FOUND);
+        return true;
+    }
+    path = path.substr(prefix.length());
+
+    std::string key = path;
+    if (!query.empty()) key += "?" + query;
+
+    Entry entry;
+    int status = 0;
+    if (!lookup(key, path, query, entry, status)) {
+        response.status.setCode((Status::Code) status);
+        return true;
+    }
+    serve(entry, response);
+    return true;
+}
+
+
+bool
+DistMirror::isFresh(const Entry & entry) const
+{
+    if (entry.m_immutable) return true;
+    return difftime(time(NULL), entry.m_fetched) < m_listTTL;
+}
+
+
+bool
+DistMirror::lookup(const std::string & key, const std::string & path,
+                   const std::string & query, Entry & entry, int & status)
+{
+    FetchPtr fetch;
+    Entry stale;
+    bool haveStale = false;
+    {
+        bp::sync::Lock lock(m_lock);
+
+        std::map<std::string, Entry>::iterator it = m_entries.find(key);
+        if (it == m_entries.end() && loadEntry(key, entry)) {
+            it = m_entries.insert(std::make_pair(key, entry)).first;
+        }
+        if (it != m_entries.end()) {
+            if (isFresh(it->second)) {
+                m_cacheHits++;
+                entry = it->second;
+                return true;
+            }
+            stale = it->second;
+            haveStale = true;
+        }
+
+        // if someone else is already fetching this, wait for their
+        // result rather than going upstream ourselves
+        std::map<std::string, FetchPtr>::iterator fi = m_inFlight.find(key);
+        if (fi != m_inFlight.end()) {
+            FetchPtr other = fi->second;
+            while (!other->m_done) m_fetchDone.wait(&m_lock);
+            if (other->m_ok) {
+                m_cacheHits++;
+                entry = other->m_entry;
+                return true;
+            }
+            if (haveStale) {
+                m_cacheHits++;
+                entry = stale;
+                return true;
+            }
+            status = other->m_status;
+            return false;
+        }
+
+        fetch.reset(new Fetch);
+        m_inFlight[key] = fetch;
+        m_upstreamFetches++;
+    }
+
+    Entry fetched;
+    int fetchStatus = 0;
+    bool ok = fetchUpstream(key, path, query, fetched, fetchStatus);
+
+    bp::sync::Lock lock(m_lock);
+    fetch->m_ok = ok;
+    fetch->m_status = fetchStatus;
+    fetch->m_entry = fetched;
+    fetch->m_done = true;
+    if (ok) m_entries[key] = fetched;
+    m_inFlight.erase(key);
+    m_fetchDone.broadcast();
+
+    if (ok) {
+        entry = fetched;
+        return true;
+    }
+    if (haveStale) {
+        // upstream trouble, what we had is better than nothing
+        BPLOG_WARN_STRM("serving stale " << key << " after upstream "
+                        << "failure (" << fetchStatus << ")");
+        entry = stale;
+        return true;
+    }
+    status = fetchStatus;
+    return false;
+}
+
+
+bool
+DistMirror::fetchUpstream(const std::string & key, const std::string & path,
+                          const std::string & query, Entry & entry,
+                          int & status)
+{
+    status = Status::BAD_GATEWAY;
+    bfs::path partial =
+        bp::file::getTempPath(m_cacheDir / ".partial", "fetch");
+
+    std::list<std::string>::const_iterator it;
+    for (it = m_upstreams.begin(); it != m_upstreams.end(); ++it) {
+        std::string url = WSProtocol::buildURL(*it, path.c_str());
+        if (!query.empty()) url += "?" + query;
+
+        std::tr1::shared_ptr<MirrorTransaction> t =
+            MirrorTransaction::alloc(WSProtocol::buildRequest(url), partial);
+        client::SyncTransaction::FinalStatus results;
+        ResponsePtr resp = t->execute(results);
+
+        if (results.code != client::SyncTransaction::FinalStatus::eOk ||
+            resp == NULL)
+        {
+            BPLOG_WARN_STRM("fetch of " << url << " failed: "
+                            << results.message);
+            t->sink().discard();
+            continue;
+        }
+        if (resp->status.code() != Status::OK) {
+            t->sink().discard();
+            int code = resp->status.code();
+            BPLOG_INFO_STRM("fetch of " << url << " returned " << code);
+            // the server is up and has answered, a 4xx is authoritative
+            if (code >= 400 && code < 500) {
+                status = code;
+                return false;
+            }
+            continue;
+        }
+        if (t->sinkFailed() || !t->sink().close()) {
+            BPLOG_ERROR_STRM("unable to write " << partial
+                             << " while fetching " << url);
+            t->sink().discard();
+            status = Status::INTERNAL_ERROR;
+            return false;
+        }
+
+        entry.m_file = cachePath(key);
+        entry.m_size = t->sink().size();
+        entry.m_fetched = time(NULL);
+        entry.m_immutable = isImmutable(path);
+        if (!resp->headers.find(Headers::ksContentType,
+                                entry.m_contentType))
+        {
+            entry.m_contentType = "application/octet-stream";
+        }
+
+        // content is renamed over what's cached before its .meta is
+        // written.  The rename replaces the old content atomically, so
+        // a concurrent reader finds one or the other, never neither.
+        bool moved = true;
+        try {
+            bfs::rename(partial, entry.m_file);
+        } catch (const bfs::filesystem_error & e) {
+            BPLOG_WARN_STRM("unable to rename " << partial << " to "
+                            << entry.m_file << ": " << e.what());
+            moved = false;
+        }
+        if (!moved || !saveEntry(key, entry)) {
+            BPLOG_ERROR_STRM("unable to cache " << url << " in "
+                             << entry.m_file);
+            (void) bp::file::safeRemove(partial);
+            status = Status::INTERNAL_ERROR;
+            return false;
+        }
+        BPLOG_INFO_STRM("cached " << key << " from " << *it << " ("
+                        << entry.m_size << " bytes)");
+        return true;
+    }
+    return false;
+}
+
+
+void
+DistMirror::passThrough(const std::string & path, const std::string & query,
+                        Response & response)
+{
+    std::list<std::string>::const_iterator it;
+    for (it = m_upstreams.begin(); it != m_upstreams.end(); ++it) {
+        std::string url = *it + "/" + path;
+        if (!query.empty()) url += "?" + query;
+        client::SyncTransactionPtr t =
+            client::SyncTransaction::alloc(WSProtocol::buildRequest(url));
+        client::SyncTransaction::FinalStatus results;
+        ResponsePtr resp = t->execute(results);
+        if (results.code == client::SyncTransaction::FinalStatus::eOk &&
+            resp != NULL)
+        {
+            response.status = resp->status;
+            response.body = resp->body;
+            std::string ct;
+            if (resp->headers.find(Headers::ksContentType, ct)) {
+                response.headers.add(Headers::ksContentType, ct);
+            }
+            return;
+        }
+    }
+    response.status.setCode(Status::BAD_GATEWAY);
+}
+
+
+void
+DistMirror::serve(const Entry & entry, Response & response)
+{
+    response.headers.add(Headers::ksContentType, entry.m_contentType);
+    if (entry.m_immutable) {
+        // the server streams the file and honors Range requests,
+        // immutable files are never replaced underneath it
+        response.body.fromPath(entry.m_file);
+        return;
+    }
+
+    // listings are small, and may be replaced by a refetch at any time
+    std::string body;
+    if (!bp::strutil::loadFromFile(entry.m_file, body)) {
+        BPLOG_ERROR_STRM("unable to read cached " << entry.m_file);
+        response.status.setCode(Status::INTERNAL_ERROR);
+        return;
+    }
+    response.body.assign(body);
+}
+
+
+bfs::path
+DistMirror::cachePath(const std::string & key) const
+{
+    return m_cacheDir / bp::sha256::hash(key);
+}
+
+
+bool
+DistMirror::loadEntry(const std::string & key, Entry & entry)
+{
+    bfs::path file = cachePath(key);
+    bfs::path meta = file;
+    meta.replace_extension(".meta");
+    if (!bp::file::isRegularFile(meta) || !bp::file::isRegularFile(file)) {
+        return false;
+    }
+
+    std::string json;
+    if (!bp::strutil::loadFromFile(meta, json)) return false;
+    bp::Object * o = bp::Object::fromPlainJsonString(json);
+    if (o == NULL) return false;
+
+    bool ok = false;
+    if (o->has("key", BPTString) && o->has("contentType", BPTString) &&
+        o->has("fetched", BPTInteger) && o->has("immutable", BPTBoolean) &&
+        !key.compare(std::string(*(o->get("key")))))
+    {
+        entry.m_file = file;
+        entry.m_size = bp::file::size(file);
+        entry.m_contentType = std::string(*(o->get("contentType")));
+        entry.m_fetched = (time_t) (long long) *(o->get("fetched"));
+        entry.m_immutable = *(o->get("immutable"));
+        ok = true;
+    }
+    delete o;
+    return ok;
+}
+
+
+bool
+DistMirror::saveEntry(const std::string & key, const Entry & entry)
+{
+    bfs::path meta = entry.m_file;
+    meta.replace_extension(".meta");
+
+    bp::Map m;
+    m.add("key", new bp::String(key));
+    m.add("contentType", new bp::String(entry.m_contentType));
+    m.add("fetched", new bp::Integer((long long) entry.m_fetched));
+    m.add("immutable", new bp::Bool(entry.m_immutable));
+
+    // written aside and renamed into place, as the content is
+    bfs::path partial =
+        bp::file::getTempPath(m_cacheDir / ".partial", "meta");
+    if (!bp::strutil::storeToFile(partial, m.toPlainJsonString())) {
+        return false;
+    }
+    try {
+        bfs::rename(partial, meta);
+    } catch (const bfs::filesystem_error & e) {
+        BPLOG_WARN_STRM("unable to rename " << partial << " to "
+                        << meta << ": " << e.what());
+        (void) bp::file::safeRemove(partial);
+        return false;
+    }
+    return true;
+}
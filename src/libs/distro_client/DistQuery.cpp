@@ -94,7 +94,8 @@ DistQuery::availableServices(const std::string & platform)
 unsigned int
 DistQuery::downloadService(const std::string & name,
                            const std::string & version,
-                           const std::string & platform)
+                           const std::string & platform,
+                           const std::string & deltaBaseVersion)
 {
     if (name.empty() || version.empty() || platform.empty()) {
         return 0;
@@ -108,7 +109,7 @@ DistQuery::downloadService(const std::string & name,
     tc->m_serviceQuery.reset(cq);
     m_transactions.push_back(tc);
 
-    cq->downloadService(name, version, platform);
+    cq->downloadService(name, version, platform, deltaBaseVersion);
 
     return tc->m_tid;
 }
@@ -493,14 +494,27 @@ DistQuery::onDownloadProgress(const ServiceQuery * cq,
 
 void
 DistQuery::onDownloadComplete(const ServiceQuery * cq,
-                              const std::vector<unsigned char> & buf)
+                              const DownloadedPackage & pkg)
 {
     TransactionContextPtr ctx = findTransactionByServiceQuery(cq);
     BPASSERT(ctx != NULL);
     BPASSERT(ctx->m_type == TransactionContext::Download);
     ctx->logTransactionCompletion(true);
     if (m_listener) {
-        m_listener->onDownloadComplete(ctx->m_tid, buf);
+        m_listener->onDownloadComplete(ctx->m_tid, pkg);
+    }
+}
+
+void
+DistQuery::onDeltaDownloadComplete(const ServiceQuery * cq,
+                                   const DownloadedPackage & pkg)
+{
+    TransactionContextPtr ctx = findTransactionByServiceQuery(cq);
+    BPASSERT(ctx != NULL);
+    BPASSERT(ctx->m_type == TransactionContext::Download);
+    ctx->logTransactionCompletion(true);
+    if (m_listener) {
+        m_listener->onDeltaDownloadComplete(ctx->m_tid, pkg);
     }
 }
 
@@ -752,7 +766,13 @@ IDistQueryListener::onDownloadProgress(unsigned int,
     
 void
 IDistQueryListener::onDownloadComplete(unsigned int,
-                                       const std::vector<unsigned char> &)
+                                       const DownloadedPackage &)
+{
+}
+    
+void
+IDistQueryListener::onDeltaDownloadComplete(unsigned int,
+                                            const DownloadedPackage &)
 {
 }
     
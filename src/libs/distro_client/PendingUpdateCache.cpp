@@ -28,12 +28,27 @@
 #include "PendingUpdateCache.h"
 #include <stack>
 #include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
 #include "platform_utils/ProductPaths.h"
 #include "ServiceUnpacker.h"
 
 
-std::list<bp::service::Summary>
-PendingUpdateCache::cached()
+// the last scan of the cache, which every require consults.  The
+// cache is only written through this module, so the scan stays good
+// until save(), purge() or install() changes it.
+static bp::sync::Mutex s_cachedLock;
+static std::list<bp::service::Summary> s_cached;
+static bool s_cachedValid = false;
+
+static void
+invalidate()
+{
+    bp::sync::Lock lck(s_cachedLock);
+    s_cachedValid = false;
+}
+
+static std::list<bp::service::Summary>
+scan()
 {
     std::list<bp::service::Summary> currentServices;
 
@@ -81,15 +96,33 @@ PendingUpdateCache::cached()
     return currentServices;
 }
 
+std::list<bp::service::Summary>
+PendingUpdateCache::cached()
+{
+    bp::sync::Lock lck(s_cachedLock);
+    if (!s_cachedValid) {
+        s_cached = scan();
+        s_cachedValid = true;
+    }
+    return s_cached;
+}
+
 bool
 PendingUpdateCache::save(std::string name, std::string version,
-                         const std::vector<unsigned char> & buf)
+                         const DownloadedPackage & pkg,
+                         const boost::filesystem::path & deltaBaseDir)
 {
     // unpack, aborting everything if this fails.
     boost::filesystem::path dest = bp::paths::getServiceCacheDirectory() / name / version;
-    ServiceUnpacker unpacker(buf);
+    ServiceUnpacker unpacker(pkg.m_path);
+    unpacker.setExpected(pkg.m_size, pkg.m_sha256);
+    if (!deltaBaseDir.empty()) {
+        unpacker.setDeltaBase(deltaBaseDir);
+    }
     std::string errMsg;
-    if (!unpacker.unpackTo(dest, errMsg)) {
+    bool rval = unpacker.unpackTo(dest, errMsg);
+    invalidate();
+    if (!rval) {
         BPLOG_ERROR_STRM("Error unpacking " << name << " service: "
                          << errMsg << ", ABORTING cache update");
         return false;
@@ -98,11 +131,20 @@ PendingUpdateCache::save(std::string name, std::string version,
     return true;
 }
 
+boost::filesystem::path
+PendingUpdateCache::downloadPath()
+{
+    return bp::file::getTempPath(
+        bp::paths::getServiceCacheDirectory() / ".downloads", "download");
+}
+
 bool
 PendingUpdateCache::purge()
 {
-    return bp::file::safeRemove(
+    bool rval = bp::file::safeRemove(
         bp::paths::getServiceCacheDirectory());
+    invalidate();
+    return rval;
 }
 
 bool
@@ -122,6 +164,7 @@ PendingUpdateCache::install(std::string name, std::string version)
                          << " / " << version << " failed : " << errMsg);
     }
     (void) bp::file::safeRemove(source);
+    invalidate();
     return rval;
 }
 
@@ -33,12 +33,22 @@
 //#include "BPUtils/BPUtils.h"
 
 namespace PendingUpdateCache {
-    // enumerate all currently cached services
+    // enumerate all currently cached services.  The cache is scanned
+    // once and rescanned only after save(), purge() or install().
     std::list<bp::service::Summary> cached();
 
-    // unpack and save a downloaded service to the cache
+    // unpack and save a downloaded service package to the cache,
+    // once verified against the size and digest it downloaded with.
+    // If deltaBaseDir is non-empty, pkg is a delta against it.
     bool save(std::string name, std::string version,
-              const std::vector<unsigned char> & buf);
+              const DownloadedPackage & pkg,
+              const boost::filesystem::path & deltaBaseDir
+                  = boost::filesystem::path());
+
+    // a fresh path under the cache to which a package may be
+    // downloaded.  Downloads live in a dot directory, which cached()
+    // skips, and are removed by purge() along with everything else.
+    boost::filesystem::path downloadPath();
 
     // purge all services from the cache
     bool purge();
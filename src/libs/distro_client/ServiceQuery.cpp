@@ -30,6 +30,7 @@
 #include "BPUtils/bpfile.h"
 #include "ServiceQueryUtil.h"
 #include "PendingUpdateCache.h"
+#include "ServiceUnpacker.h"
 #include "platform_utils/bplocalization.h"
 #include "platform_utils/ProductPaths.h"
 #include "WSProtocol.h"
@@ -42,6 +43,7 @@
 
 #define HOPACT_GET_NEXT_L10N ((void *) 0x1)
 #define HOPACT_CANCEL_HTTP ((void *) 0x2)
+#define HOPACT_DELTA_FALLBACK ((void *) 0x3)
 
 using namespace std;
 using namespace std::tr1;
@@ -55,7 +57,8 @@ IServiceQueryListener::~IServiceQueryListener()
 ServiceQuery::ServiceQuery(std::list<std::string> serverURLs,
                            const IServiceFilter * serviceFilter)
     : bp::http::client::Listener(), m_qc(serverURLs, serviceFilter),
-      m_type(None), m_serviceFilter(serviceFilter), m_listener(NULL) 
+      m_type(None), m_deltaFallback(false), m_serviceFilter(serviceFilter),
+      m_listener(NULL) 
 {
     m_qc.setListener(this);
 }
@@ -76,7 +79,24 @@ ServiceQuery::onResponseStatus(const bp::http::Status& status,
                                const bp::http::Headers& headers)
 {
     bp::http::client::Listener::onResponseStatus(status, headers);
-    if (status.code() != bp::http::Status::OK) {
+    // a redirect or retry restarts the body
+    if (m_sink.isOpen()) m_sink.restart();
+    if (!m_deltaBase.empty() && status.code() != bp::http::Status::OK) {
+        // no delta available, after an async break we'll cancel this
+        // transaction and fall back to the full package
+        BPLOG_INFO_STRM(this << ": no delta for " << m_downloading.name
+                        << " from " << m_deltaBase << " (HTTP "
+                        << status.code() << "), using full package");
+        m_deltaFallback = true;
+        hop(HOPACT_DELTA_FALLBACK);
+    } else if (!m_deltaBase.empty()) {
+        // size info from the service list describes the full package
+        std::string len;
+        m_dlSize = 0;
+        if (headers.find(bp::http::Headers::ksContentLength, len)) {
+            m_dlSize = (unsigned int) atoi(len.c_str());
+        }
+    } else if (status.code() != bp::http::Status::OK) {
         BPLOG_WARN_STRM(this << ": HTTP error " << status.code() 
                         << "(" << status.toString() << ")");
 
@@ -93,12 +113,18 @@ void
 ServiceQuery::onResponseBodyBytes(const unsigned char* pBytes, 
                                   unsigned int size)
 {
-    bp::http::client::Listener::onResponseBodyBytes(pBytes, size);
+    // packages go straight to disk, everything else is small
+    // enough to collect in the response body
+    if (!m_sink.isOpen()) {
+        bp::http::client::Listener::onResponseBodyBytes(pBytes, size);
+        return;
+    }
+    m_sink.write(pBytes, size);
     if ((m_type == Download || m_type == DownloadLatestPlatform)
         && m_dlSize > 0)
     {
         unsigned int pct =
-            (unsigned int) (100 * ((double) response()->body.size() /
+            (unsigned int) (100 * ((double) m_sink.size() /
                                    (double) m_dlSize));
         if (m_listener != NULL) {
             if (!m_zeroPctSent) {
@@ -111,8 +137,6 @@ ServiceQuery::onResponseBodyBytes(const unsigned char* pBytes,
             }
         }
     }
-    
-    m_cletBuf.insert(m_cletBuf.end(), pBytes, pBytes+size);
 }
 
 
@@ -126,32 +150,58 @@ ServiceQuery::onClosed()
 
     BPLOG_INFO_STRM(this << ": onClosed");
     bp::http::client::Listener::onClosed();
+    if (m_deltaFallback) return;
     try {
         if (m_type == Download) {
-            // now we've got the buffer of the downloaded service
-            // file.  w00t.
+            // now we've got the downloaded service file.  w00t.
+            DownloadedPackage pkg;
+            if (!downloadComplete(pkg)) {
+                throw std::string("unable to write downloaded service");
+            }
             if (m_listener != NULL) {
-                m_listener->onDownloadComplete(this, m_cletBuf);
+                if (m_deltaBase.empty()) {
+                    m_listener->onDownloadComplete(this, pkg);
+                } else {
+                    m_listener->onDeltaDownloadComplete(this, pkg);
+                }
             }
-            m_cletBuf.clear();
+            m_sink.discard();
         } else if (m_type == UpdateCache) {
-            // now buf is a cached service we must install into cache
+            // now pkg is a cached service we must install into cache
+            DownloadedPackage pkg;
+            if (!downloadComplete(pkg)) {
+                throw std::string("unable to write downloaded service");
+            }
             BPLOG_INFO_STRM(this << ": CacheUpdate: downloaded "
-                            << m_cletBuf.size()
+                            << pkg.m_size
                             << " bytes for "
                             << m_currentUpdate->name
-                            << " v" << m_currentUpdate->version.asString());
+                            << " v" << m_currentUpdate->version.asString()
+                            << (m_deltaBase.empty() ? "" : " (delta)"));
 
+            boost::filesystem::path deltaBaseDir;
+            if (!m_deltaBase.empty()) {
+                deltaBaseDir = bp::paths::getServiceDirectory()
+                    / m_currentUpdate->name / m_deltaBase;
+            }
             if (!PendingUpdateCache::save(m_currentUpdate->name,
-                                                      m_currentUpdate->version.asString(),
-                                                      m_cletBuf)) {
+                                          m_currentUpdate->version.asString(),
+                                          pkg, deltaBaseDir)) {
+                if (!m_deltaBase.empty()) {
+                    // the full package is our fallback
+                    BPLOG_WARN_STRM(this << ": unable to apply delta for "
+                                    << m_currentUpdate->name
+                                    << ", downloading full package");
+                    startDownload(*m_currentUpdate, false);
+                    return;
+                }
                 std::string msg("unable to save " + m_currentUpdate->name
                                 + "/" + m_currentUpdate->version.asString()
                                 + " to pending update cache");
                 transactionFailed(msg);
                 return;
             }
-            m_cletBuf.clear();
+            m_sink.discard();
             
             if ((++m_currentUpdate) == m_updates.end()) {
                 // all done
@@ -203,18 +253,16 @@ ServiceQuery::onClosed()
             }
 
         } else if (m_type == DownloadLatestPlatform) {
-            if (response()->body.size() == 0) {
+            LatestPlatformPkgAndVersion pkgAndVersion;
+            if (!downloadComplete(pkgAndVersion.m_pkg)
+                || pkgAndVersion.m_pkg.m_size == 0)
+            {
                 transactionFailed("downloaded platform has empty body");
             } else if (m_listener) {
-                LatestPlatformPkgAndVersion pkgAndVersion;
-                pkgAndVersion.m_pkg.insert(pkgAndVersion.m_pkg.begin(),
-                                           response()->body.begin(),
-                                           response()->body.end());
                 pkgAndVersion.m_version = m_version;
-                
-                    
                 m_listener->onLatestPlatformDownloaded(this, pkgAndVersion);
             }
+            m_sink.discard();
         } else {
             throw("bad m_type" + m_type);
         }
@@ -228,6 +276,7 @@ ServiceQuery::onClosed()
 void 
 ServiceQuery::onTimeout()
 {
+    if (m_deltaFallback) return;
     std::string msg("transaction timed out");
     BPLOG_WARN_STRM(this << ": " << msg);
     bp::http::client::Listener::onTimeout();
@@ -237,6 +286,7 @@ ServiceQuery::onTimeout()
 void 
 ServiceQuery::onCancel() 
 {
+    if (m_deltaFallback) return;
     std::string msg("transaction canceled");
     BPLOG_WARN_STRM(this << ": " << msg);
     bp::http::client::Listener::onCancel();
@@ -247,6 +297,7 @@ ServiceQuery::onCancel()
 void 
 ServiceQuery::onError(const std::string& msg) 
 {
+    if (m_deltaFallback) return;
     std::string errMsg("transaction error " + msg);
     BPLOG_WARN_STRM(this << ": " << errMsg);
     bp::http::client::Listener::onError(msg);
@@ -276,13 +327,15 @@ ServiceQuery::findService(std::string name, std::string version,
 
 void
 ServiceQuery::downloadService(std::string name, std::string version,
-                              std::string platform)
+                              std::string platform,
+                              std::string deltaBaseVersion)
 {
     m_type = Download;
     m_qc.serviceList(platform);
     m_name = name;
     m_version = version;
     m_platform = platform;
+    m_requestedDeltaBase = deltaBaseVersion;
 }
 
 
@@ -328,6 +381,10 @@ ServiceQuery::onHop(void * hopact)
         getNextLocalization();    
     } else if (hopact == HOPACT_CANCEL_HTTP && m_httpTransaction) {
         m_httpTransaction->cancel();
+    } else if (hopact == HOPACT_DELTA_FALLBACK) {
+        if (m_httpTransaction) m_httpTransaction->cancel();
+        m_deltaFallback = false;
+        startDownload(m_downloading, false);
     }
 }
 
@@ -575,22 +632,53 @@ ServiceQuery::fetchLocalization(const AvailableService & acp)
 
 
 void
-ServiceQuery::startDownload(const AvailableService & acp)
+ServiceQuery::startDownload(const AvailableService & acp,
+                            bool allowDelta)
 {
+    m_downloading = acp;
     m_dlSize = acp.sizeBytes;
     m_lastPct = 0;
     m_zeroPctSent = false;
+    if (!m_sink.open(PendingUpdateCache::downloadPath())) {
+        transactionFailed("unable to create download file for "
+                          + acp.name);
+        return;
+    }
+
+    // updates prefer a delta against the newest installed version,
+    // explicit downloads only when the caller asked for one
+    m_deltaBase.clear();
+    if (allowDelta) {
+        if (m_type == UpdateCache) {
+            boost::filesystem::path base = ServiceUnpacker::deltaBase(
+                acp.name, acp.version.asString());
+            m_deltaBase = base.filename().string();
+        } else if (m_type == Download) {
+            m_deltaBase = m_requestedDeltaBase;
+        }
+    }
     
-    std::string url = WSProtocol::buildURL(acp.serverURL,
-                                            WSProtocol::SERVICE_DOWNLOAD_PATH);
-    url += "/" + acp.name + "/" + acp.version.asString() + "/" + m_platform;
+    std::string url;
+    if (m_deltaBase.empty()) {
+        url = WSProtocol::buildURL(acp.serverURL,
+                                   WSProtocol::SERVICE_DOWNLOAD_PATH);
+        url += "/" + acp.name + "/" + acp.version.asString() + "/" + m_platform;
+    } else {
+        url = WSProtocol::buildURL(acp.serverURL,
+                                   WSProtocol::SERVICE_DELTA_PATH);
+        url += "/" + acp.name + "/" + acp.version.asString() + "/"
+            + m_platform + "/" + m_deltaBase;
+    }
 
     bp::http::RequestPtr req(WSProtocol::buildRequest(url));
     req->headers.add("Accept", "application/octet-stream");
     m_httpTransaction.reset(new bp::http::client::Transaction(req));
     BPLOG_INFO_STRM(this << ": initiate GET to start download of  " 
                     << acp.name << "/" << acp.version.asString()
-                    << "/" << m_platform);
+                    << "/" << m_platform
+                    << (m_deltaBase.empty() ? "" : " (delta from ")
+                    << m_deltaBase
+                    << (m_deltaBase.empty() ? "" : ")"));
     m_httpTransaction->initiate(shared_from_this());
 }
 
@@ -770,9 +858,22 @@ ServiceQuery::onServiceListFailure()
 void
 ServiceQuery::transactionFailed(const std::string& msg)
 {
+    m_sink.discard();
     if (m_listener) m_listener->onTransactionFailed(this, msg);
 }
 
+bool
+ServiceQuery::downloadComplete(DownloadedPackage & pkg)
+{
+    if (!m_sink.close()) return false;
+    pkg.m_path = m_sink.path();
+    pkg.m_size = m_sink.size();
+    pkg.m_sha256 = m_sink.digest();
+    BPLOG_INFO_STRM(this << ": downloaded " << pkg.m_size << " bytes to "
+                    << pkg.m_path << ", sha256 " << pkg.m_sha256);
+    return true;
+}
+
 void
 ServiceQuery::onLatestPlatform(const LatestPlatformServerAndVersion & latest)
 {
@@ -793,6 +894,10 @@ ServiceQuery::onLatestPlatform(const LatestPlatformServerAndVersion & latest)
                                  WSProtocol::LATEST_PLATFORM_UPDATE_PATH);
         url += "/" + m_platform;
 
+        if (!m_sink.open(PendingUpdateCache::downloadPath())) {
+            transactionFailed("unable to create platform download file");
+            return;
+        }
         bp::http::RequestPtr req(WSProtocol::buildRequest(url));
         m_httpTransaction.reset(new bp::http::client::Transaction(req));
         BPLOG_INFO_STRM(this << ": initiate GET of latest platform for "
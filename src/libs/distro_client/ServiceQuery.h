@@ -30,6 +30,7 @@
 
 #include "DistQueryInternal.h"
 #include "DistQueryTypes.h"
+#include "bphttp/HttpFileSink.h"
 #include "platform_utils/ServiceSummary.h"
 #include "QueryCache.h"
 
@@ -65,7 +66,8 @@ class ServiceQuery : public bp::http::client::Listener,
                      std::string minversion, std::string platform);
 
     void downloadService(std::string name, std::string version,
-                         std::string platform);
+                         std::string platform,
+                         std::string deltaBaseVersion = std::string());
 
     void serviceDetails(std::string name, std::string version,
                         std::string platform);
@@ -127,14 +129,24 @@ class ServiceQuery : public bp::http::client::Listener,
 
     void fetchLocalization(const AvailableService & acp);
     void fetchDetails(const AvailableService & acp);
-    void startDownload(const AvailableService & acp);
+    void startDownload(const AvailableService & acp,
+                       bool allowDelta = true);
     void getNextLocalization();
     void parseLocalization(const unsigned char* buf, size_t len);
 
     bp::http::client::TransactionPtr m_httpTransaction;
 
     // used for downloads
-    std::vector<unsigned char> m_cletBuf;
+    AvailableService m_downloading;
+    // base version of the delta being requested, empty for a full package
+    std::string m_deltaBase;
+    // base version the client asked for in downloadService()
+    std::string m_requestedDeltaBase;
+    // server had no delta, a full download is pending
+    bool m_deltaFallback;
+    // package bytes are streamed here rather than buffered in the
+    // response body
+    bp::http::client::FileSink m_sink;
     unsigned int m_dlSize;
     unsigned int m_lastPct;
     bool m_zeroPctSent;
@@ -152,6 +164,10 @@ class ServiceQuery : public bp::http::client::Listener,
     // invoke listener failure callback if listener is defined
     void transactionFailed(const std::string& msg);
 
+    // hand the completed download in m_sink to the listener, the
+    // file is removed on return.  false if nothing was downloaded
+    bool downloadComplete(DownloadedPackage & pkg);
+
     // used for localizations to gaurantee we don't invoke client's callback
     // before function return.
     void onHop(void *);
@@ -35,6 +35,7 @@
 #include "BPUtils/BPLog.h"
 #include "BPUtils/bptime.h"
 #include "BPUtils/bpprocess.h"
+#include "BPUtils/bpsemanticversion.h"
 #include "platform_utils/ProductPaths.h"
 
 using namespace std;
@@ -43,21 +44,22 @@ namespace bfs = boost::filesystem;
 
 ServiceUnpacker::ServiceUnpacker(const bfs::path& pkgFile,
                                  const bfs::path& certFile)
-    : Unpacker(pkgFile, certFile)
+    : Unpacker(pkgFile, certFile), m_deduplicate(false)
 {
 }
 
 
 ServiceUnpacker::ServiceUnpacker(const std::vector<unsigned char>& buf,
                                  const bfs::path& certFile)
-    : Unpacker(buf, certFile)
+    : Unpacker(buf, certFile), m_deduplicate(false)
 {
 }
 
 
 ServiceUnpacker::ServiceUnpacker(const bfs::path& dir,
                                  int)
-    : Unpacker(bfs::path(), bfs::path()), m_dir(dir)
+    : Unpacker(bfs::path(), bfs::path()), m_dir(dir),
+      m_deduplicate(false)
 {
 }
 
@@ -100,6 +102,9 @@ ServiceUnpacker::install(string& errMsg)
         }
         vector<string> args;
         args.push_back("-f");
+        if (m_deduplicate) {
+            args.push_back("-d");
+        }
         args.push_back("-v");
         args.push_back("-t");
         args.push_back("-log");
@@ -143,3 +148,53 @@ ServiceUnpacker::unpackTo(const bfs::path& dir,
 
 
 
+
+
+void
+ServiceUnpacker::setDeltaBase(const bfs::path& baseDir)
+{
+    m_deltaBase = baseDir;
+}
+
+
+void
+ServiceUnpacker::setDeduplicate(bool deduplicate)
+{
+    m_deduplicate = deduplicate;
+}
+
+
+bfs::path
+ServiceUnpacker::deltaBase(const string& name,
+                           const string& version)
+{
+    bp::SemanticVersion want;
+    if (!want.parse(version)) return bfs::path();
+
+    bfs::path serviceDir = bp::paths::getServiceDirectory() / name;
+    if (!isDirectory(serviceDir)) return bfs::path();
+
+    bfs::path best;
+    bp::SemanticVersion bestVersion;
+    try {
+        bfs::directory_iterator end;
+        for (bfs::directory_iterator it(serviceDir); it != end; ++it) {
+            bp::SemanticVersion v;
+            if (!isDirectory(it->path())
+                || !v.parse(it->path().filename().string())
+                || v.compare(want) >= 0)
+            {
+                continue;
+            }
+            if (best.empty() || v.compare(bestVersion) > 0) {
+                best = it->path();
+                bestVersion = v;
+            }
+        }
+    } catch (const bfs::filesystem_error& e) {
+        BPLOG_WARN_STRM("unable to scan " << serviceDir
+                        << ": " << e.what());
+        return bfs::path();
+    }
+    return best;
+}
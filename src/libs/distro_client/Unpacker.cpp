@@ -31,6 +31,7 @@
 #include <sstream>
 #include <vector>
 #include "BPUtils/bpfile.h"
+#include "BPUtils/bpsha256.h"
 #include "ArchiveLib/ArchiveLib.h"
 
 
@@ -40,14 +41,16 @@ namespace bfs = boost::filesystem;
 
 Unpacker::Unpacker(const bfs::path& bpkgFile,
                    const bfs::path& certFile)
-: m_bpkg(bpkgFile), m_certFile(certFile), m_unpackError(false)
+: m_bpkg(bpkgFile), m_certFile(certFile), m_unpackError(false),
+  m_expectedSize(0)
 {
 }
 
 
 Unpacker::Unpacker(const std::vector<unsigned char> & buf,
                    const bfs::path& certFile)
-: m_buf(buf), m_certFile(certFile), m_unpackError(false)
+: m_buf(buf), m_certFile(certFile), m_unpackError(false),
+  m_expectedSize(0)
 {
 }
 
@@ -57,6 +60,14 @@ Unpacker::~Unpacker()
 }
 
 
+void
+Unpacker::setExpected(unsigned long long size, const string& sha256)
+{
+    m_expectedSize = size;
+    m_expectedSha256 = sha256;
+}
+
+
 bool
 Unpacker::unpackTo(const bfs::path& dir,
                    string& errMsg)
@@ -78,15 +89,40 @@ Unpacker::unpackTo(const bfs::path& dir,
             std::string s;
             s.append((const char *) &(m_buf[0]), m_buf.size());
             std::stringstream ss(s, ios_base::in);
-            if (!bp::pkg::unpackToDirectory(ss, dir, ts, errMsg,
-                                            m_certFile))
+            if (!m_deltaBase.empty()) {
+                if (!bp::pkg::applyDelta(ss, m_deltaBase, dir, ts, errMsg,
+                                         m_certFile))
+                {
+                    string s("unable to apply delta package: " + errMsg);
+                    throw runtime_error(s);
+                }
+            } else if (!bp::pkg::unpackToDirectory(ss, dir, ts, errMsg,
+                                                   m_certFile))
             {
                 string s("unable to unpack package: " + errMsg);
                 throw runtime_error(s);
             }
         } else {
-            if (!bp::pkg::unpackToDirectory(m_bpkg, dir, ts, errMsg,
-                                            m_certFile))
+            // the file must still be what was downloaded
+            if (!m_expectedSha256.empty()) {
+                if (bp::file::size(m_bpkg) != m_expectedSize) {
+                    string s("package size doesn't match download");
+                    throw runtime_error(s);
+                }
+                if (bp::sha256::hashFile(m_bpkg) != m_expectedSha256) {
+                    string s("package digest doesn't match download");
+                    throw runtime_error(s);
+                }
+            }
+            if (!m_deltaBase.empty()) {
+                if (!bp::pkg::applyDelta(m_bpkg, m_deltaBase, dir, ts,
+                                         errMsg, m_certFile))
+                {
+                    string s("unable to apply delta package: " + errMsg);
+                    throw runtime_error(s);
+                }
+            } else if (!bp::pkg::unpackToDirectory(m_bpkg, dir, ts, errMsg,
+                                                   m_certFile))
             {
                 string s("unable to unpack package: " + errMsg);
                 throw runtime_error(s);
@@ -31,6 +31,7 @@ const char * WSProtocol::AVAILABLE_SERVICES_PATH = "services";
 const char * WSProtocol::SERVICE_METADATA_PATH = "service/metadata";
 const char * WSProtocol::SERVICE_SYNOPSIS_PATH = "service/synopsis";
 const char * WSProtocol::SERVICE_DOWNLOAD_PATH ="service/package";
+const char * WSProtocol::SERVICE_DELTA_PATH ="service/delta";
 const char * WSProtocol::USAGE_PATH = "usage";
 const char * WSProtocol::LATEST_PLATFORM_VERSION_PATH = "platform/latest/version";
 const char * WSProtocol::LATEST_PLATFORM_UPDATE_PATH = "platform/latest/update";
@@ -41,6 +41,7 @@ namespace WSProtocol
     extern const char * AVAILABLE_SERVICES_PATH;
     extern const char * SERVICE_METADATA_PATH;
     extern const char * SERVICE_DOWNLOAD_PATH;
+    extern const char * SERVICE_DELTA_PATH;
     extern const char * USAGE_PATH;
     extern const char * SERVICE_SYNOPSIS_PATH;
     extern const char * LATEST_PLATFORM_VERSION_PATH;
@@ -0,0 +1,138 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistMirror - A caching mirror of the distribution server web services.
+ *              Mounted on a bp::http::server::Server it answers the same
+ *              /api/v4/... url space, so hosts may name it as their
+ *              primary distribution server.  Content it does not hold
+ *              is fetched from the upstream servers once, no matter how
+ *              many hosts ask for it at the same time, and cached
+ *              content may be fetched a piece at a time with Range
+ *              requests so that interrupted downloads can resume.
+ */
+
+#ifndef __DISTMIRROR_H__
+#define __DISTMIRROR_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <time.h>
+
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bptr1.h"
+#include "bphttp/HttpHandler.h"
+
+class DistMirror : public bp::http::server::IHandler
+{
+  public:
+    /** upstreams are distribution server base urls tried in order,
+     *  cacheDir is where fetched content is kept.  Content already
+     *  in cacheDir from an earlier run is served without refetch. */
+    DistMirror(const std::list<std::string> & upstreams,
+               const boost::filesystem::path & cacheDir);
+    virtual ~DistMirror();
+
+    /** how long listings (available services, permissions, latest
+     *  platform) may be served before they're refetched.  Packages,
+     *  deltas, metadata and synopses never change for a given
+     *  name/version and are kept indefinitely.  Default 300 seconds. */
+    void setListTTL(double secs);
+
+    /** the number of requests sent to an upstream server */
+    unsigned int upstreamFetches();
+
+    /** the number of requests answered from the cache, including
+     *  those which waited on another request's upstream fetch */
+    unsigned int cacheHits();
+
+    // IHandler interface
+    virtual bool processRequest(const bp::http::Request & request,
+                                bp::http::Response & response);
+
+  private:
+    /** a cached upstream response */
+    struct Entry {
+        Entry() : m_size(0), m_fetched(0), m_immutable(false) { }
+        boost::filesystem::path m_file;
+        std::string m_contentType;
+        boost::uintmax_t m_size;
+        time_t m_fetched;
+        bool m_immutable;
+    };
+
+    /** an upstream fetch in progress, other requests for the same
+     *  content wait on it rather than fetching it themselves */
+    struct Fetch {
+        Fetch() : m_done(false), m_ok(false), m_status(0) { }
+        bool m_done;
+        bool m_ok;
+        int m_status;
+        Entry m_entry;
+    };
+    typedef std::tr1::shared_ptr<Fetch> FetchPtr;
+
+    /** find or fetch the content for key, returns false with an
+     *  http status code in status if it cannot be had */
+    bool lookup(const std::string & key, const std::string & path,
+                const std::string & query, Entry & entry, int & status);
+
+    /** fetch from the first upstream that will answer, on success the
+     *  content is written to the cache and described by entry */
+    bool fetchUpstream(const std::string & key, const std::string & path,
+                       const std::string & query, Entry & entry,
+                       int & status);
+
+    /** pass a request through to upstream without caching the result */
+    void passThrough(const std::string & path, const std::string & query,
+                     bp::http::Response & response);
+
+    /** serve an entry, packages from disk so the server may stream
+     *  them and answer Range requests */
+    void serve(const Entry & entry, bp::http::Response & response);
+
+    bool isFresh(const Entry & entry) const;
+
+    boost::filesystem::path cachePath(const std::string & key) const;
+    bool loadEntry(const std::string & key, Entry & entry);
+    bool saveEntry(const std::string & key, const Entry & entry);
+
+    std::list<std::string> m_upstreams;
+    boost::filesystem::path m_cacheDir;
+    double m_listTTL;
+
+    // protects everything below, held only briefly, never across
+    // an upstream fetch
+    bp::sync::Mutex m_lock;
+    bp::sync::Condition m_fetchDone;
+    std::map<std::string, Entry> m_entries;
+    std::map<std::string, FetchPtr> m_inFlight;
+    unsigned int m_upstreamFetches;
+    unsigned int m_cacheHits;
+
+    DistMirror(const DistMirror &);
+    DistMirror & operator=(const DistMirror &);
+};
+
+#endif
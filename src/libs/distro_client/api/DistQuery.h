@@ -66,8 +66,17 @@ class IDistQueryListener
                                 const AvailableService & list);
     virtual void onDownloadProgress(unsigned int tid,
                                     unsigned int pct);
+    // the downloaded package is streamed to disk, pkg.m_path is
+    // removed once this returns
     virtual void onDownloadComplete(unsigned int tid,
-                                    const std::vector<unsigned char> & buf);
+                                    const DownloadedPackage & pkg);
+    // invoked in place of onDownloadComplete() when a delta was
+    // requested from downloadService() and the server supplied one.
+    // pkg holds a delta package against the requested base version
+    // (see bp::pkg::applyDelta()).
+    virtual void onDeltaDownloadComplete(
+        unsigned int tid,
+        const DownloadedPackage & pkg);
     virtual void gotServiceDetails(unsigned int tid,
                                    const bp::service::Description & desc);
     virtual void gotPermissions(unsigned int tid,
@@ -127,11 +136,15 @@ class DistQuery : virtual public IServiceQueryListener
                              const std::string & platform);
 
     /**
-     * Download a service.
+     * Download a service.  If deltaBaseVersion is non-empty, a delta
+     * package against that (installed) version is requested first,
+     * and a full package is downloaded if the server has no such delta.
      */
     unsigned int downloadService(const std::string & name,
                                  const std::string & version,
-                                 const std::string & platform);
+                                 const std::string & platform,
+                                 const std::string & deltaBaseVersion
+                                     = std::string());
 
     /**
      * get a service description from the distribution server.
@@ -326,7 +339,10 @@ class DistQuery : virtual public IServiceQueryListener
     virtual void onDownloadProgress(const ServiceQuery * cq,
                                     unsigned int pct);    
     virtual void onDownloadComplete(const ServiceQuery * cq,
-                                    const std::vector<unsigned char> & buf);    
+                                    const DownloadedPackage & pkg);    
+    virtual void onDeltaDownloadComplete(
+        const ServiceQuery * cq,
+        const DownloadedPackage & pkg);
     virtual void gotServiceDetails(const ServiceQuery * cq,
                                    const bp::service::Description & desc);    
     virtual void onRequirementsSatisfied(const ServiceQuery * cq,
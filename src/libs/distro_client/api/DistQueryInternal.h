@@ -46,7 +46,10 @@ class IServiceQueryListener
     virtual void onDownloadProgress(const ServiceQuery * cq,
                                     unsigned int pct) = 0;    
     virtual void onDownloadComplete(const ServiceQuery * cq,
-                                    const std::vector<unsigned char> & buf) = 0;    
+                                    const DownloadedPackage & pkg) = 0;    
+    virtual void onDeltaDownloadComplete(
+        const ServiceQuery * cq,
+        const DownloadedPackage & pkg) = 0;
     virtual void gotServiceDetails(const ServiceQuery * cq,
                                    const bp::service::Description & desc) = 0;    
     virtual void onRequirementsSatisfied(const ServiceQuery * cq,
@@ -34,6 +34,7 @@
 #include <set>
 #include <string>
 
+#include "BPUtils/bpfile.h"
 #include "BPUtils/bpsemanticversion.h"
 
 /**
@@ -108,6 +109,21 @@ class ServiceSynopsis
  */
 typedef std::list<ServiceSynopsis> ServiceSynopsisList;
 
+/**
+ * a package downloaded to disk, with its size and SHA-256 digest as
+ * computed while it arrived.  The file is removed once the callback
+ * it's passed to returns.
+ */
+class DownloadedPackage
+{
+  public:
+    DownloadedPackage() : m_size(0) { }
+
+    boost::filesystem::path m_path;
+    unsigned long long m_size;
+    std::string m_sha256;
+};
+
 /**
  * A platform version
  */
@@ -115,7 +131,7 @@ class LatestPlatformPkgAndVersion
 {
   public:
     std::string m_version;
-    std::vector<unsigned char> m_pkg;
+    DownloadedPackage m_pkg;
 };
 
 #endif
@@ -70,9 +70,29 @@ class ServiceUnpacker : virtual public Unpacker
     bool unpackTo(const boost::filesystem::path& dir,
                   std::string& errMsg);
 
+    // Treat the package as a delta against an installed version
+    // of the service at baseDir (see bp::pkg::packDelta()).  The
+    // patched tree is verified before unpack() succeeds.
+    void setDeltaBase(const boost::filesystem::path& baseDir);
+
+    // Have install() share the service's file contents with other
+    // installed services (see bp::ObjectStore).  Off by default:
+    // deduplicated files become read-only hard links whose permission
+    // bits are reduced to executable or not, so this is only safe for
+    // services which neither write to their own files nor depend on
+    // their modes.
+    void setDeduplicate(bool deduplicate);
+
+    // The directory of the newest installed version of a service
+    // which is older than version, suitable as a delta base.
+    // Empty if no such version is installed.
+    static boost::filesystem::path deltaBase(const std::string& name,
+                                             const std::string& version);
+
  private:
     boost::filesystem::path m_tmpDir;
     boost::filesystem::path m_dir;
+    bool m_deduplicate;
 };
 
 #endif
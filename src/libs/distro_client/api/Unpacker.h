@@ -38,6 +38,13 @@
 
 class Unpacker
 {
+ public:
+    // Verify a package file is size bytes long and has the given
+    // sha256 digest (as computed while it downloaded, see
+    // DownloadedPackage) before unpacking it.  Unpacking a file
+    // which doesn't match fails.  An empty digest checks nothing.
+    void setExpected(unsigned long long size, const std::string& sha256);
+
  protected:
     /** 
      * Create an instance to unpack a bpkg package
@@ -65,9 +72,14 @@ class Unpacker
 
  protected:
     boost::filesystem::path m_bpkg;
+    // when non-empty, the package is a delta against this directory
+    boost::filesystem::path m_deltaBase;
     std::vector<unsigned char> m_buf;
     boost::filesystem::path m_certFile;
     bool m_unpackError;
+    // empty unless a download is to be verified
+    std::string m_expectedSha256;
+    unsigned long long m_expectedSize;
 };
 
 #endif
@@ -0,0 +1,459 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistMirrorTest.cpp
+ * Tests of the caching distribution mirror against an in-process
+ * upstream fixture.
+ */
+
+#include "DistMirrorTest.h"
+#include <string.h>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bpthread.h"
+#include "BPUtils/bptime.h"
+#include "bphttp/HttpSyncTransaction.h"
+
+using namespace bp::http;
+using namespace bp::http::client;
+namespace bfs = boost::filesystem;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DistMirrorTest);
+
+#define PRIMARY_PATH   "/primary"
+#define SECONDARY_PATH "/secondary"
+#define PACKAGE_PATH   "/api/v4/service/package/TestService/1.0.0/ia32-linux"
+#define SERVICES_PATH  "/api/v4/services"
+#define MISSING_PATH   "/api/v4/service/package/NoSuchService/1.0.0/ia32-linux"
+
+
+//////////////////////////////////////////////////////////////////////
+// UpstreamHandler
+// Plays the part of a distribution server, counting the requests
+// it answers.
+//
+class UpstreamHandler : public bp::http::server::IHandler
+{
+  public:
+    UpstreamHandler() : m_requests(0), m_delaySec(0.0), m_down(false) { }
+    ~UpstreamHandler() { }
+
+    void add(const std::string & path, const std::string & body,
+             const std::string & contentType)
+    {
+        bp::sync::Lock lock(m_lock);
+        m_content[path] = std::make_pair(body, contentType);
+    }
+
+    void setDelay(double secs) { m_delaySec = secs; }
+    void setDown(bool down) { m_down = down; }
+
+    unsigned int requests()
+    {
+        bp::sync::Lock lock(m_lock);
+        return m_requests;
+    }
+
+    bool processRequest(const Request & request, Response & response)
+    {
+        std::pair<std::string, std::string> content;
+        bool found = false;
+        {
+            bp::sync::Lock lock(m_lock);
+            m_requests++;
+            std::map<std::string,
+                std::pair<std::string, std::string> >::iterator it;
+            it = m_content.find(request.url.path());
+            if (it != m_content.end()) {
+                content = it->second;
+                found = true;
+            }
+        }
+        if (m_delaySec > 0) bp::time::sleepSec(m_delaySec);
+
+        if (m_down) {
+            response.status.setCode(Status::SERVICE_UNAVAILABLE);
+        } else if (!found) {
+            response.status.setCode(Status::NOT_FOUND);
+        } else {
+            response.headers.add(Headers::ksContentType, content.second);
+            response.body.assign(content.first);
+        }
+        return true;
+    }
+
+  private:
+    bp::sync::Mutex m_lock;
+    std::map<std::string, std::pair<std::string, std::string> > m_content;
+    unsigned int m_requests;
+    double m_delaySec;
+    bool m_down;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// RouterHandler
+// One server hosts both upstreams and the mirror, requests are
+// routed on their leading path segment.
+//
+class RouterHandler : public bp::http::server::IHandler
+{
+  public:
+    RouterHandler(UpstreamHandler * primary, UpstreamHandler * secondary)
+        : m_primary(primary), m_secondary(secondary), m_mirror(NULL) { }
+    ~RouterHandler() { }
+
+    void setMirror(DistMirror * mirror) { m_mirror = mirror; }
+
+    bool processRequest(const Request & request, Response & response)
+    {
+        std::string path = request.url.path();
+        UpstreamHandler * upstream = NULL;
+        std::string prefix;
+        if (!path.compare(0, strlen(PRIMARY_PATH), PRIMARY_PATH)) {
+            upstream = m_primary;
+            prefix = PRIMARY_PATH;
+        } else if (!path.compare(0, strlen(SECONDARY_PATH),
+                                 SECONDARY_PATH)) {
+            upstream = m_secondary;
+            prefix = SECONDARY_PATH;
+        }
+        if (upstream == NULL) {
+            return m_mirror->processRequest(request, response);
+        }
+        Request r(request);
+        r.url.setPath(path.substr(prefix.length()));
+        return upstream->processRequest(r, response);
+    }
+
+  private:
+    UpstreamHandler * m_primary;
+    UpstreamHandler * m_secondary;
+    DistMirror * m_mirror;
+};
+
+
+static std::string
+makeContent(unsigned int size)
+{
+    std::string s(size, '\0');
+    for (unsigned int i = 0; i < size; i++) {
+        s[i] = (char) ((i * 7 + i / 251) & 0xff);
+    }
+    return s;
+}
+
+
+// a GET which leaves it to the caller to judge the results, so it may
+// be made off the main thread
+static ResponsePtr
+tryGet(const std::string & url, SyncTransaction::FinalStatus & results,
+       const std::string & range = std::string())
+{
+    RequestPtr req(new Request(Method::HTTP_GET, url));
+    if (!range.empty()) req->headers.add("Range", range);
+    SyncTransactionPtr tran = SyncTransaction::alloc(req);
+    return tran->execute(results);
+}
+
+
+static ResponsePtr
+get(const std::string & url, const std::string & range = std::string())
+{
+    SyncTransaction::FinalStatus results;
+    ResponsePtr resp = tryGet(url, results, range);
+    CPPUNIT_ASSERT(results.code == SyncTransaction::FinalStatus::eOk);
+    return resp;
+}
+
+
+// GETs url count times, keeping what came back for the main thread
+// to assert on
+struct GetThread
+{
+    GetThread() : count(1) { }
+    std::string url;
+    unsigned int count;
+    std::vector<SyncTransaction::FinalStatus::Code> codes;
+    std::vector<ResponsePtr> responses;
+    bp::thread::Thread thread;
+};
+
+
+static void *
+getThreadFunc(void * cookie)
+{
+    GetThread * gt = (GetThread *) cookie;
+    for (unsigned int i = 0; i < gt->count; i++) {
+        SyncTransaction::FinalStatus results;
+        ResponsePtr resp = tryGet(gt->url, results);
+        gt->codes.push_back(results.code);
+        gt->responses.push_back(resp);
+    }
+    return NULL;
+}
+
+
+void
+DistMirrorTest::setUp()
+{
+    m_cacheDir = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                       "DistMirrorTest");
+    m_primary = new UpstreamHandler;
+    m_secondary = new UpstreamHandler;
+    m_router = new RouterHandler(m_primary, m_secondary);
+
+    m_port = 0;
+    CPPUNIT_ASSERT(m_server.bind(m_port));
+
+    std::list<std::string> upstreams;
+    upstreams.push_back(mirrorURL(PRIMARY_PATH));
+    upstreams.push_back(mirrorURL(SECONDARY_PATH));
+    m_mirror = new DistMirror(upstreams, m_cacheDir);
+    m_router->setMirror(m_mirror);
+
+    CPPUNIT_ASSERT(m_server.mount("*", m_router));
+    CPPUNIT_ASSERT(m_server.start());
+}
+
+
+void
+DistMirrorTest::tearDown()
+{
+    m_server.stop();
+    delete m_mirror;
+    delete m_router;
+    delete m_secondary;
+    delete m_primary;
+    (void) bp::file::safeRemove(m_cacheDir);
+}
+
+
+std::string
+DistMirrorTest::mirrorURL(const std::string & path)
+{
+    std::stringstream ss;
+    ss << "http://127.0.0.1:" << m_port << path;
+    return ss.str();
+}
+
+
+void
+DistMirrorTest::testCoalescing()
+{
+    std::string pkg = makeContent(256 * 1024);
+    m_primary->add(PACKAGE_PATH, pkg, "application/octet-stream");
+    // hold the fetch open long enough for every client to arrive
+    m_primary->setDelay(1.0);
+
+    const unsigned int numClients = 8;
+    std::vector<GetThread *> threads;
+    for (unsigned int i = 0; i < numClients; i++) {
+        GetThread * gt = new GetThread;
+        gt->url = mirrorURL(PACKAGE_PATH);
+        CPPUNIT_ASSERT(gt->thread.run(getThreadFunc, gt));
+        threads.push_back(gt);
+    }
+    for (unsigned int i = 0; i < numClients; i++) {
+        threads[i]->thread.join();
+    }
+    for (unsigned int i = 0; i < numClients; i++) {
+        GetThread * gt = threads[i];
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, gt->responses.size());
+        CPPUNIT_ASSERT(gt->codes[0] == SyncTransaction::FinalStatus::eOk);
+        CPPUNIT_ASSERT(gt->responses[0] != NULL);
+        CPPUNIT_ASSERT(gt->responses[0]->status.code() == Status::OK);
+        CPPUNIT_ASSERT(gt->responses[0]->body.toString() == pkg);
+        delete gt;
+    }
+
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+    CPPUNIT_ASSERT_EQUAL(1u, m_mirror->upstreamFetches());
+    CPPUNIT_ASSERT_EQUAL(numClients - 1, m_mirror->cacheHits());
+}
+
+
+void
+DistMirrorTest::testRange()
+{
+    std::string pkg = makeContent(100 * 1024);
+    m_primary->add(PACKAGE_PATH, pkg, "application/octet-stream");
+    std::string url = mirrorURL(PACKAGE_PATH);
+
+    ResponsePtr resp = get(url);
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->headers.get("Accept-Ranges") == "bytes");
+    CPPUNIT_ASSERT(resp->body.toString() == pkg);
+
+    // the middle, as a resumed download would ask
+    resp = get(url, "bytes=1000-1999");
+    CPPUNIT_ASSERT(resp->status.code() == Status::PARTIAL_CONTENT);
+    CPPUNIT_ASSERT(resp->body.toString() == pkg.substr(1000, 1000));
+    std::stringstream ss;
+    ss << "bytes 1000-1999/" << pkg.size();
+    CPPUNIT_ASSERT(resp->headers.get("Content-Range") == ss.str());
+
+    // open ended
+    resp = get(url, "bytes=50000-");
+    CPPUNIT_ASSERT(resp->status.code() == Status::PARTIAL_CONTENT);
+    CPPUNIT_ASSERT(resp->body.toString() == pkg.substr(50000));
+
+    // suffix
+    resp = get(url, "bytes=-10");
+    CPPUNIT_ASSERT(resp->status.code() == Status::PARTIAL_CONTENT);
+    CPPUNIT_ASSERT(resp->body.toString() == pkg.substr(pkg.size() - 10));
+
+    // past the end
+    ss.str("");
+    ss << "bytes=" << pkg.size() << "-";
+    resp = get(url, ss.str());
+    CPPUNIT_ASSERT(resp->status.code() == Status::RANGE_NOT_SATISFIABLE);
+
+    // everything after the first came from cache
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+}
+
+
+void
+DistMirrorTest::testListTTL()
+{
+    m_primary->add(SERVICES_PATH, "[]", "application/json");
+    m_primary->add(PACKAGE_PATH, makeContent(1024),
+                   "application/octet-stream");
+
+    // listings are cached within their ttl
+    CPPUNIT_ASSERT(get(mirrorURL(SERVICES_PATH))->status.code()
+                   == Status::OK);
+    CPPUNIT_ASSERT(get(mirrorURL(SERVICES_PATH))->status.code()
+                   == Status::OK);
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+
+    // and refetched after it
+    m_mirror->setListTTL(0);
+    ResponsePtr resp = get(mirrorURL(SERVICES_PATH));
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->body.toString() == "[]");
+    CPPUNIT_ASSERT(resp->headers.get(Headers::ksContentType)
+                   == "application/json");
+    CPPUNIT_ASSERT_EQUAL(2u, m_primary->requests());
+
+    // packages never go stale
+    CPPUNIT_ASSERT(get(mirrorURL(PACKAGE_PATH))->status.code()
+                   == Status::OK);
+    CPPUNIT_ASSERT(get(mirrorURL(PACKAGE_PATH))->status.code()
+                   == Status::OK);
+    CPPUNIT_ASSERT_EQUAL(3u, m_primary->requests());
+}
+
+
+void
+DistMirrorTest::testRefetchWhileServing()
+{
+    std::string listing = "[\"" + std::string(4096, 'x') + "\"]";
+    m_primary->add(SERVICES_PATH, listing, "application/json");
+
+    // every request refetches, replacing the cached listing while
+    // others are reading it
+    m_mirror->setListTTL(0);
+
+    const unsigned int numClients = 4;
+    std::vector<GetThread *> threads;
+    for (unsigned int i = 0; i < numClients; i++) {
+        GetThread * gt = new GetThread;
+        gt->url = mirrorURL(SERVICES_PATH);
+        gt->count = 25;
+        CPPUNIT_ASSERT(gt->thread.run(getThreadFunc, gt));
+        threads.push_back(gt);
+    }
+    for (unsigned int i = 0; i < numClients; i++) {
+        threads[i]->thread.join();
+    }
+    for (unsigned int i = 0; i < numClients; i++) {
+        GetThread * gt = threads[i];
+        CPPUNIT_ASSERT_EQUAL((size_t) gt->count, gt->responses.size());
+        for (unsigned int j = 0; j < gt->count; j++) {
+            CPPUNIT_ASSERT(gt->codes[j]
+                           == SyncTransaction::FinalStatus::eOk);
+            CPPUNIT_ASSERT(gt->responses[j] != NULL);
+            CPPUNIT_ASSERT(gt->responses[j]->status.code() == Status::OK);
+            CPPUNIT_ASSERT(gt->responses[j]->body.toString() == listing);
+        }
+        delete gt;
+    }
+}
+
+
+void
+DistMirrorTest::testFailover()
+{
+    std::string pkg = makeContent(4096);
+    m_secondary->add(PACKAGE_PATH, pkg, "application/octet-stream");
+    m_primary->setDown(true);
+
+    ResponsePtr resp = get(mirrorURL(PACKAGE_PATH));
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->body.toString() == pkg);
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+    CPPUNIT_ASSERT_EQUAL(1u, m_secondary->requests());
+
+    // a live primary's 404 is final
+    m_primary->setDown(false);
+    resp = get(mirrorURL(MISSING_PATH));
+    CPPUNIT_ASSERT(resp->status.code() == Status::NOT_FOUND);
+    CPPUNIT_ASSERT_EQUAL(2u, m_primary->requests());
+    CPPUNIT_ASSERT_EQUAL(1u, m_secondary->requests());
+
+    // with both down, the mirror says so
+    m_primary->setDown(true);
+    m_secondary->setDown(true);
+    resp = get(mirrorURL(SERVICES_PATH));
+    CPPUNIT_ASSERT(resp->status.code() == Status::BAD_GATEWAY);
+}
+
+
+void
+DistMirrorTest::testPersistence()
+{
+    std::string pkg = makeContent(8192);
+    m_primary->add(PACKAGE_PATH, pkg, "application/octet-stream");
+    CPPUNIT_ASSERT(get(mirrorURL(PACKAGE_PATH))->status.code()
+                   == Status::OK);
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+
+    // a restarted mirror finds what the last one fetched
+    std::list<std::string> upstreams;
+    upstreams.push_back(mirrorURL(PRIMARY_PATH));
+    DistMirror * restarted = new DistMirror(upstreams, m_cacheDir);
+    m_router->setMirror(restarted);
+    delete m_mirror;
+    m_mirror = restarted;
+
+    ResponsePtr resp = get(mirrorURL(PACKAGE_PATH));
+    CPPUNIT_ASSERT(resp->status.code() == Status::OK);
+    CPPUNIT_ASSERT(resp->body.toString() == pkg);
+    CPPUNIT_ASSERT_EQUAL(1u, m_primary->requests());
+    CPPUNIT_ASSERT_EQUAL(0u, m_mirror->upstreamFetches());
+    CPPUNIT_ASSERT_EQUAL(1u, m_mirror->cacheHits());
+}
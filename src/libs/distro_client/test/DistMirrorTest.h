@@ -0,0 +1,83 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistMirrorTest.h
+ * Tests of the caching distribution mirror against an in-process
+ * upstream fixture.
+ */
+
+#ifndef __DISTMIRRORTEST_H__
+#define __DISTMIRRORTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+#include "BPUtils/bpfile.h"
+#include "bphttp/HttpServer.h"
+#include "DistributionClient/DistMirror.h"
+
+class DistMirrorTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(DistMirrorTest);
+    CPPUNIT_TEST(testCoalescing);
+    CPPUNIT_TEST(testRange);
+    CPPUNIT_TEST(testListTTL);
+    CPPUNIT_TEST(testRefetchWhileServing);
+    CPPUNIT_TEST(testFailover);
+    CPPUNIT_TEST(testPersistence);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+  protected:
+    // concurrent misses for the same package cause one upstream fetch
+    void testCoalescing();
+
+    // byte ranges of a cached package are served as 206/416
+    void testRange();
+
+    // listings are refetched once stale, packages never are
+    void testListTTL();
+
+    // a listing being refetched is still served whole meanwhile
+    void testRefetchWhileServing();
+
+    // a failing primary falls over to the secondary, a 404 doesn't
+    void testFailover();
+
+    // a new mirror on the same cache directory serves without fetching
+    void testPersistence();
+
+  private:
+    std::string mirrorURL(const std::string & path);
+
+    boost::filesystem::path m_cacheDir;
+    bp::http::server::Server m_server;
+    unsigned short int m_port;
+    class UpstreamHandler * m_primary;
+    class UpstreamHandler * m_secondary;
+    class RouterHandler * m_router;
+    DistMirror * m_mirror;
+};
+
+#endif
@@ -0,0 +1,283 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistQueryTest.cpp
+ * Tests of package downloads through DistQuery against an in-process
+ * distribution server fixture.
+ */
+
+#include "DistQueryTest.h"
+#include <fstream>
+#include <sstream>
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bptimer.h"
+#include "DistributionClient/DistQuery.h"
+#include "DistributionClient/ServiceUnpacker.h"
+
+using namespace bp::http;
+namespace bfs = boost::filesystem;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DistQueryTest);
+
+#define PLATFORM      "ia32-linux"
+#define SERVICES_PATH "/api/v4/services/" PLATFORM
+#define PACKAGE_PATH  "/api/v4/service/package/TestService/1.0.0/" PLATFORM
+
+
+//////////////////////////////////////////////////////////////////////
+// DistServerHandler
+// Plays the part of a distribution server offering one package.
+//
+class DistServerHandler : public bp::http::server::IHandler
+{
+  public:
+    DistServerHandler(const std::string & pkg) : m_pkg(pkg) { }
+
+    bool processRequest(const Request & request, Response & response)
+    {
+        std::string path = request.url.path();
+        if (path == SERVICES_PATH) {
+            std::stringstream ss;
+            ss << "[{\"name\":\"TestService\",\"versionString\":\"1.0.0\","
+               << "\"size\":" << m_pkg.size() << "}]";
+            response.headers.add(Headers::ksContentType, "application/json");
+            response.body.assign(ss.str());
+        } else if (path == PACKAGE_PATH) {
+            response.headers.add(Headers::ksContentType,
+                                 "application/octet-stream");
+            response.body.assign(m_pkg);
+        } else {
+            response.status.setCode(Status::NOT_FOUND);
+        }
+        return true;
+    }
+
+  private:
+    std::string m_pkg;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// DownloadListener
+// Examines the downloaded package while it exists, stopping the
+// runloop once the download ends or time runs out.
+//
+class DownloadListener : public IDistQueryListener,
+                         public bp::time::ITimerListener
+{
+  public:
+    DownloadListener(bp::runloop::RunLoop * rl)
+        : completed(0), failed(0), fileSize(0), lastPct(0),
+          m_rl(rl), m_verify(false) { }
+
+    void verifyWithUnpacker() { m_verify = true; }
+
+    // run the runloop for at most msec
+    void runFor(unsigned int msec)
+    {
+        bp::time::Timer t;
+        t.setListener(this);
+        t.setMsec(msec);
+        m_rl->run();
+        t.cancel();
+    }
+
+    unsigned int completed;
+    unsigned int failed;
+    DownloadedPackage pkg;
+    boost::uintmax_t fileSize;
+    std::string fileDigest;
+    unsigned int lastPct;
+    // unpack errors for the file as downloaded, then altered
+    std::string intactError;
+    std::string resizedError;
+    std::string alteredError;
+
+  private:
+    void timesUp(bp::time::Timer *) { m_rl->stop(); }
+
+    void onTransactionFailed(unsigned int, const std::string &)
+    {
+        failed++;
+        m_rl->stop();
+    }
+
+    void onDownloadProgress(unsigned int, unsigned int pct)
+    {
+        lastPct = pct;
+    }
+
+    void onDownloadComplete(unsigned int, const DownloadedPackage & p)
+    {
+        completed++;
+        pkg = p;
+        fileSize = bp::file::size(p.m_path);
+        fileDigest = bp::sha256::hashFile(p.m_path);
+        if (m_verify) verify(p);
+        m_rl->stop();
+    }
+
+    static std::string unpackError(const DownloadedPackage & p)
+    {
+        ServiceUnpacker unpacker(p.m_path);
+        unpacker.setExpected(p.m_size, p.m_sha256);
+        std::string err;
+        bfs::path dest = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                               "DistQueryTest");
+        CPPUNIT_ASSERT(!unpacker.unpackTo(dest, err));
+        (void) bp::file::safeRemove(dest);
+        return err;
+    }
+
+    void verify(const DownloadedPackage & p)
+    {
+        // the fixture doesn't serve a real package, so even intact it
+        // fails to unpack, but not for want of matching its digest
+        intactError = unpackError(p);
+
+        std::ofstream f;
+        CPPUNIT_ASSERT(bp::file::openWritableStream(
+                           f, p.m_path, std::ios::binary | std::ios::app));
+        f << 'x';
+        f.close();
+        resizedError = unpackError(p);
+
+        CPPUNIT_ASSERT(bp::file::openWritableStream(
+                           f, p.m_path,
+                           std::ios::binary | std::ios::trunc));
+        f << std::string((size_t) p.m_size, 'x');
+        f.close();
+        alteredError = unpackError(p);
+    }
+
+    bp::runloop::RunLoop * m_rl;
+    bool m_verify;
+};
+
+
+static std::string
+makeContent(unsigned int size)
+{
+    std::string s(size, '\0');
+    for (unsigned int i = 0; i < size; i++) {
+        s[i] = (char) ((i * 7 + i / 251) & 0xff);
+    }
+    return s;
+}
+
+
+static std::list<std::string>
+servers(unsigned short int port)
+{
+    std::stringstream ss;
+    ss << "http://127.0.0.1:" << port;
+    std::list<std::string> l;
+    l.push_back(ss.str());
+    return l;
+}
+
+
+void
+DistQueryTest::setUp()
+{
+    m_handler = NULL;
+    m_port = 0;
+    CPPUNIT_ASSERT(m_server.bind(m_port));
+}
+
+
+void
+DistQueryTest::tearDown()
+{
+    m_server.stop();
+    delete m_handler;
+}
+
+
+void
+DistQueryTest::testDownloadStreamsToDisk()
+{
+    std::string content = makeContent(3 * 1024 * 1024);
+    m_handler = new DistServerHandler(content);
+    CPPUNIT_ASSERT(m_server.mount("*", m_handler));
+    CPPUNIT_ASSERT(m_server.start());
+
+    bp::runloop::RunLoop rl;
+    rl.init();
+    DownloadListener l(&rl);
+    {
+        DistQuery q(servers(m_port), NULL);
+        q.setListener(&l);
+        CPPUNIT_ASSERT(q.downloadService("TestService", "1.0.0", PLATFORM));
+        l.runFor(30000);
+    }
+    rl.shutdown();
+
+    CPPUNIT_ASSERT_EQUAL(0u, l.failed);
+    CPPUNIT_ASSERT_EQUAL(1u, l.completed);
+    CPPUNIT_ASSERT_EQUAL(100u, l.lastPct);
+
+    // what the sink counted and hashed as the bytes arrived is what
+    // was served, and what was on disk when the listener saw it
+    CPPUNIT_ASSERT(l.pkg.m_size == content.size());
+    CPPUNIT_ASSERT_EQUAL(bp::sha256::hash(content), l.pkg.m_sha256);
+    CPPUNIT_ASSERT(l.fileSize == content.size());
+    CPPUNIT_ASSERT_EQUAL(l.pkg.m_sha256, l.fileDigest);
+
+    // and it's gone once the listener returned
+    CPPUNIT_ASSERT(!l.pkg.m_path.empty());
+    CPPUNIT_ASSERT(!bp::file::pathExists(l.pkg.m_path));
+}
+
+
+void
+DistQueryTest::testUnpackVerifiesDownload()
+{
+    std::string content = makeContent(64 * 1024);
+    m_handler = new DistServerHandler(content);
+    CPPUNIT_ASSERT(m_server.mount("*", m_handler));
+    CPPUNIT_ASSERT(m_server.start());
+
+    bp::runloop::RunLoop rl;
+    rl.init();
+    DownloadListener l(&rl);
+    l.verifyWithUnpacker();
+    {
+        DistQuery q(servers(m_port), NULL);
+        q.setListener(&l);
+        CPPUNIT_ASSERT(q.downloadService("TestService", "1.0.0", PLATFORM));
+        l.runFor(30000);
+    }
+    rl.shutdown();
+
+    CPPUNIT_ASSERT_EQUAL(1u, l.completed);
+    CPPUNIT_ASSERT(!l.intactError.empty());
+    CPPUNIT_ASSERT(l.intactError.find("match download")
+                   == std::string::npos);
+    CPPUNIT_ASSERT_EQUAL(std::string("package size doesn't match download"),
+                         l.resizedError);
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("package digest doesn't match download"),
+        l.alteredError);
+}
@@ -0,0 +1,60 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * DistQueryTest.h
+ * Tests of package downloads through DistQuery against an in-process
+ * distribution server fixture.
+ */
+
+#ifndef __DISTQUERYTEST_H__
+#define __DISTQUERYTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+#include "bphttp/HttpServer.h"
+
+class DistQueryTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(DistQueryTest);
+    CPPUNIT_TEST(testDownloadStreamsToDisk);
+    CPPUNIT_TEST(testUnpackVerifiesDownload);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+  protected:
+    // a package arrives on disk with the size and digest it was
+    // served with, and is removed once the listener returns
+    void testDownloadStreamsToDisk();
+
+    // a package altered after download is refused by the unpacker
+    void testUnpackVerifiesDownload();
+
+  private:
+    bp::http::server::Server m_server;
+    unsigned short int m_port;
+    class DistServerHandler * m_handler;
+};
+
+#endif
@@ -132,7 +132,7 @@ namespace bp {
 
         void 
         Fetcher::onDownloadComplete(unsigned int tid,
-                                    const vector<unsigned char>& buf) 
+                                    const DownloadedPackage& pkg) 
         {
             shared_ptr<IFetcherListener> l = m_listener.lock();
             if (m_state == eFetchingService) {
@@ -140,7 +140,8 @@ namespace bp {
                     pair<string, string> p = m_neededServices.front();
                     bfs::path destDir = m_destDir / "services" / p.first / p.second;
                     string errMsg;
-                    ServiceUnpacker unpacker(buf, m_keyPath);
+                    ServiceUnpacker unpacker(pkg.m_path, m_keyPath);
+                    unpacker.setExpected(pkg.m_size, pkg.m_sha256);
                     BPLOG_DEBUG_STRM("unpack service to " << destDir);
                     if (!unpacker.unpackTo(destDir, errMsg)) {
                         BP_THROW(errMsg);
@@ -208,8 +209,9 @@ namespace bp {
                     && m_platformVersion.compare(info.m_version)) {
                     BP_THROW("version changed between calls!");
                 }
-                PlatformUnpacker unpacker(info.m_pkg, m_destDir,
+                PlatformUnpacker unpacker(info.m_pkg.m_path, m_destDir,
                                           info.m_version, m_keyPath);
+                unpacker.setExpected(info.m_pkg.m_size, info.m_pkg.m_sha256);
                 string errMsg;
                 bool rval = (unpacker.unpack(errMsg) && unpacker.install(errMsg));
                 if (l) {
@@ -93,7 +93,7 @@ class Fetcher : virtual public IDistQueryListener
     virtual void onDownloadProgress(unsigned int tid,
                                     unsigned int pct);
     virtual void onDownloadComplete(unsigned int tid,
-                                    const std::vector<unsigned char>& buf);
+                                    const DownloadedPackage& pkg);
     virtual void onRequirementsSatisfied(unsigned int tid,
                                          const ServiceList& clist);
     virtual void gotLatestPlatformVersion(unsigned int tid,
@@ -593,7 +593,7 @@ PermissionsManager::queryAutoUpdate() const
 PermissionsManager::PermissionsManager(const string& baseURL)
 : m_checkDays(1.0), m_url(baseURL), m_error(false),
   m_badPermissionsOnDisk(false), m_requireDomainApproval(true),
-  m_domainPermissions(), m_autoUpdatePermissions()
+  m_generation(0), m_domainPermissions(), m_autoUpdatePermissions()
 {
     list<string> distroServer;
     distroServer.push_back(baseURL);
@@ -1095,6 +1095,15 @@ PermissionsManager::load()
     } catch (const bp::error::Exception& e) {
         BPLOG_WARN_STRM("error applying permission migrations: " << e.what());
     }
+
+    m_generation++;
+}
+
+
+unsigned int
+PermissionsManager::generation() const
+{
+    return m_generation;
 }
 
 
@@ -1126,6 +1135,8 @@ PermissionsManager::saveDomainPermissions()
     using namespace bp::paths;
     using namespace bp::strutil;
     
+    m_generation++;
+
     boost::filesystem::path path = getDomainPermissionsPath();
     
     if (m_domainPermissions.empty()) {
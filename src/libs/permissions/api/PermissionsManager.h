@@ -330,6 +330,13 @@ public:
      * Normalize a domain name by trying to resolved ip addresses
      */               
     std::string normalizeDomain(const std::string& domain) const;
+
+    /**
+     * A counter which changes whenever domain permissions are loaded
+     * or modified.  Callers which cache permission decisions compare
+     * it to learn when their cache has gone stale.
+     */
+    unsigned int generation() const;
     
 private:
     // Information needed to migrate autoUpdate permissions when
@@ -399,6 +406,9 @@ private:
     
     // require user approval for unapproved domains?
     bool m_requireDomainApproval;
+
+    // bumped on every load and save of domain permissions
+    unsigned int m_generation;
     
     // map of domain permissions, key is domain, value is map of 
     // permissions and their PermissionInfo
@@ -132,7 +132,10 @@ bp::ProcessLock bp::acquireProcessLock(bool block,
 void bp::releaseProcessLock(bp::ProcessLock hand)
 {
 	if (hand == NULL) return;
+    // bump the semaphore back up to 1 now, so the lock may be taken
+    // again without waiting for process exit.  SEM_UNDO here cancels
+    // the adjustment recorded when the lock was acquired.
+    struct sembuf sb = { 0, 1, SEM_UNDO };
+    (void) semop(hand->lck, &sb, 1);
 	free(hand);
-    // the operating system will bump the semaphore back up to 1 because
-    // of the SEM_UNDO flag
 }
@@ -67,6 +67,9 @@ bp::ProcessLock bp::acquireProcessLock(bool block,
 void bp::releaseProcessLock(bp::ProcessLock hand)
 {
 	if (hand == NULL) return;
+    // closing the handle doesn't give up ownership, waiters would
+    // otherwise block until this thread exits
+    ReleaseMutex(hand->lock);
     CloseHandle(hand->lock);
     hand->lock = NULL;
 	free(hand);
@@ -32,6 +32,7 @@
 
 #include <sstream>
 #include <list>
+#include <stdlib.h>
 
 #include "ProductPaths.h"
 #include "bplocalization.h"
@@ -45,6 +46,20 @@ using namespace bp::file;
 namespace bfs = boost::filesystem;
 
 
+const char* bp::paths::kProductDirectoryEnvVar = "BROWSERPLUS_PRODUCT_DIR";
+
+
+bfs::path
+bp::paths::getProductTopDirectory()
+{
+    const char* dir = getenv(kProductDirectoryEnvVar);
+    if (dir && *dir) {
+        return bfs::path(dir);
+    }
+    return getDefaultProductTopDirectory();
+}
+
+
 // common code to create a top-level product dir
 static bfs::path
 doGetTopDir(const string& s)
@@ -115,6 +130,13 @@ bp::paths::getServiceCacheDirectory()
 }
 
 
+bfs::path
+bp::paths::getServiceObjectStoreDirectory()
+{
+    return doGetTopDir("ServiceObjects");
+}
+
+
 bfs::path
 bp::paths::getServiceInterfaceCachePath()
 {
@@ -246,6 +268,15 @@ bp::paths::getPersistentStatePath(int major,
 }
 
 
+bfs::path
+bp::paths::getRequireHistoryPath(int major,
+                                 int minor,
+                                 int micro)
+{
+    return getPluginWritableDirectory(major, minor, micro) / "requirehistory.kv";
+}
+
+
 bfs::path
 bp::paths::getCertFilePath()
 {
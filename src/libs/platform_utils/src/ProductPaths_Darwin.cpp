@@ -72,7 +72,7 @@ stringRefToUTF8(CFStringRef cfStr)
 
 
 bfs::path
-bp::paths::getProductTopDirectory()
+bp::paths::getDefaultProductTopDirectory()
 {
     // Get application support dir
     FSRef fref;
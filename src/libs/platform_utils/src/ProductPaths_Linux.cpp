@@ -44,7 +44,7 @@ using namespace bp::file;
 namespace bfs = boost::filesystem;
 
 bfs::path
-bp::paths::getProductTopDirectory()
+bp::paths::getDefaultProductTopDirectory()
 {
     bfs::path prodDir = getenv("HOME");
     if (prodDir.empty()) {
@@ -69,7 +69,7 @@ getCSIDL(int csidl)
 
 
 bfs::path
-bp::paths::getProductTopDirectory()
+bp::paths::getDefaultProductTopDirectory()
 {
     bfs::path prodDir = getCSIDL(CSIDL_LOCAL_APPDATA) 
                         / getCompanyName() / getProductName();
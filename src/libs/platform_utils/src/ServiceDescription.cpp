@@ -29,9 +29,10 @@
 #include "ServiceDescription.h"
 #include "BPUtils/bperrorutil.h"
 
+#include <algorithm>
 #include <list>
-#include <set>
 #include <sstream>
+#include <vector>
 #include <string.h>
 
 using namespace bp;
@@ -199,6 +200,206 @@ service::Argument::toBPArgumentDefinition(BPArgumentDefinition * argDef)
     argDef->required = m_required;
 }
 
+/**
+ * A function's arguments compiled for validation.  Names are sorted
+ * so a supplied argument is found with a binary search, the types an
+ * argument accepts are a mask of BPType bits, and required arguments
+ * are counted rather than collected (map keys are unique, so a count
+ * of required hits equal to the number required means none are
+ * missing).  Immutable once built, so Function copies share it.
+ */
+class bp::service::ArgumentValidator
+{
+public:
+    explicit ArgumentValidator(
+        const std::list<service::Argument> & arguments);
+
+    std::string validate(const std::string & function,
+                         bp::Map * arguments) const;
+
+private:
+    struct Entry {
+        std::string name;
+        service::Argument::Type type;
+        unsigned int accepts;
+        bool required;
+        bool operator<(const Entry & o) const { return name < o.name; }
+    };
+
+    const Entry * find(const char * name) const;
+
+    static unsigned int accepts(service::Argument::Type type);
+    static const char * typeName(BPType type);
+
+    std::vector<Entry> m_entries;
+    // required names in declaration order, so a missing argument is
+    // reported as it was before arguments were compiled
+    std::vector<std::string> m_required;
+    unsigned int m_numRequired;
+};
+
+#define TYPEBIT(t) (1u << (unsigned int) (t))
+
+service::ArgumentValidator::ArgumentValidator(
+    const std::list<service::Argument> & arguments)
+    : m_numRequired(0)
+{
+    std::list<service::Argument>::const_iterator it;
+    for (it = arguments.begin(); it != arguments.end(); ++it) {
+        Entry e;
+        e.name = it->name();
+        e.type = it->type();
+        e.accepts = accepts(e.type);
+        e.required = it->required();
+        m_entries.push_back(e);
+        if (e.required) m_required.push_back(e.name);
+    }
+
+    // the first declaration of a name decides its type, as
+    // Function::getArgument() does, while any declaration may make
+    // it required
+    std::stable_sort(m_entries.begin(), m_entries.end());
+    std::vector<Entry> unique;
+    for (unsigned int i = 0; i < m_entries.size(); i++) {
+        if (!unique.empty() && unique.back().name == m_entries[i].name) {
+            unique.back().required |= m_entries[i].required;
+        } else {
+            unique.push_back(m_entries[i]);
+        }
+    }
+    m_entries.swap(unique);
+
+    for (unsigned int i = 0; i < m_entries.size(); i++) {
+        if (m_entries[i].required) m_numRequired++;
+    }
+}
+
+unsigned int
+service::ArgumentValidator::accepts(service::Argument::Type type)
+{
+    switch (type) {
+        case service::Argument::None: return 0;
+        case service::Argument::Null: return TYPEBIT(BPTNull);
+        case service::Argument::Boolean: return TYPEBIT(BPTBoolean);
+        case service::Argument::Integer: return TYPEBIT(BPTInteger);
+        case service::Argument::Double: return TYPEBIT(BPTDouble);
+        case service::Argument::String: return TYPEBIT(BPTString);
+        case service::Argument::Map: return TYPEBIT(BPTMap);
+        case service::Argument::List: return TYPEBIT(BPTList);
+        case service::Argument::CallBack: return TYPEBIT(BPTCallBack);
+        case service::Argument::Path: return TYPEBIT(BPTNativePath);
+        case service::Argument::WritablePath:
+            return TYPEBIT(BPTWritableNativePath);
+        case service::Argument::Any: return ~0u;
+    }
+    return 0;
+}
+
+const char *
+service::ArgumentValidator::typeName(BPType type)
+{
+    switch (type) {
+        case BPTNull: return "null";
+        case BPTBoolean: return "boolean";
+        case BPTInteger: return "integer";
+        case BPTDouble: return "double";
+        case BPTString: return "string";
+        case BPTMap: return "map";
+        case BPTList: return "list";
+        case BPTCallBack: return "callback";
+        case BPTNativePath: return "path";
+        case BPTWritableNativePath: return "writablePath";
+        default: break;
+    }
+    return "unknown";
+}
+
+const service::ArgumentValidator::Entry *
+service::ArgumentValidator::find(const char * name) const
+{
+    unsigned int lo = 0, hi = m_entries.size();
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int c = strcmp(m_entries[mid].name.c_str(), name);
+        if (c == 0) return &m_entries[mid];
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+std::string
+service::ArgumentValidator::validate(const std::string & function,
+                                     bp::Map * arguments) const
+{
+    unsigned int required = 0;
+
+    if (arguments != NULL) {
+        bp::Map::Iterator iter(*arguments);
+        const char * name = NULL;
+        while ((name = iter.nextKey()) != NULL) {
+            const Entry * e = find(name);
+            if (e == NULL) {
+                std::stringstream ss;
+                ss << "argument '" << name << "' not supported by function '"
+                   << function << "'";
+                return ss.str();
+            }
+
+            const bp::Object * value = iter.value();
+            BPType got = value->type();
+            bool ok = ((unsigned int) got < 32
+                       && (e->accepts & TYPEBIT(got)))
+                      || e->type == service::Argument::Any;
+            if (!ok) {
+                // Allow conversion between int and double.  Needed
+                // since Safari often sends integers as doubles.  The
+                // value is swapped in place, name stays valid since
+                // the key is untouched.
+                if (e->type == service::Argument::Integer
+                    && got == BPTDouble)
+                {
+                    const bp::Double * oldVal =
+                        dynamic_cast<const bp::Double *>(value);
+                    double dval = oldVal->value() + 0.5;  // round
+                    arguments->replace(name,
+                                       new bp::Integer((BPInteger) dval));
+                } else if (e->type == service::Argument::Double
+                           && got == BPTInteger)
+                {
+                    const bp::Integer * oldVal =
+                        dynamic_cast<const bp::Integer *>(value);
+                    arguments->replace(
+                        name, new bp::Double((BPDouble) oldVal->value()));
+                } else {
+                    std::stringstream ss;
+                    ss << "argument '" << name
+                       << "' should be of type "
+                       << service::Argument::typeAsString(e->type)
+                       << ", but is of type " << typeName(got);
+                    return ss.str();
+                }
+            }
+
+            if (e->required) required++;
+        }
+    }
+
+    if (required < m_numRequired) {
+        for (unsigned int i = 0; i < m_required.size(); i++) {
+            if (arguments == NULL
+                || arguments->value(m_required[i].c_str()) == NULL)
+            {
+                std::stringstream ss;
+                ss << "call to '" << function << "' requires a '"
+                   << m_required[i] << "' argument";
+                return ss.str();
+            }
+        }
+    }
+    return std::string();
+}
+
 service::Function::Function()
     : m_adefs(NULL)
 {
@@ -208,6 +409,7 @@ service::Function::Function(const service::Function & f)
     : m_name(f.m_name),
       m_docString(f.m_docString),
       m_arguments(f.m_arguments),
+      m_validator(f.m_validator),
       m_adefs(NULL) // generated on demand, don't copy
 {
 }
@@ -218,6 +420,7 @@ service::Function::operator=(const service::Function & f)
     m_name = f.m_name;
     m_docString = f.m_docString;
     m_arguments = f.m_arguments;
+    m_validator = f.m_validator;
     if (m_adefs) free(m_adefs);
     m_adefs = NULL;
     return *this;
@@ -271,6 +474,16 @@ service::Function::setArguments(
     const std::list<service::Argument> & arguments) 
 {
     m_arguments = arguments;
+    compileArguments();
+}
+
+void
+service::Function::compileArguments()
+{
+    m_validator.reset();
+    if (!m_arguments.empty()) {
+        m_validator.reset(new ArgumentValidator(m_arguments));
+    }
 }
 
 std::string
@@ -291,6 +504,7 @@ service::Function::clear()
     m_name.clear();
     m_docString.clear();
     m_arguments.clear();
+    m_validator.reset();
 }
 
 bool 
@@ -311,6 +525,7 @@ service::Function::fromBPFunctionDefinition(const BPFunctionDefinition * def)
             return false;
         }
     }
+    compileArguments();
 
     return true;
 }
@@ -342,15 +557,50 @@ service::Function::toBPFunctionDefinition(BPFunctionDefinition * func)
     
 }
 
+/**
+ * The contents of a Description.  Shared between copies, which only
+ * copy it before making a change of their own.  Functions are indexed
+ * by name, the index holding the first function declared with a name
+ * as the old linear search found.
+ */
+struct service::Description::Rep
+{
+    Rep()
+        : majorVersion(0), minorVersion(0), microVersion(0), builtIn(false)
+    {
+    }
+
+    void addFunction(const Function & f)
+    {
+        index.insert(std::make_pair(f.name(), (unsigned int) functions.size()));
+        functions.push_back(f);
+    }
+
+    std::string name;
+    unsigned int majorVersion;
+    unsigned int minorVersion;
+    unsigned int microVersion;
+    std::string docString;
+    std::vector<Function> functions;
+    std::tr1::unordered_map<std::string, unsigned int> index;
+    // true for built in services, added using the
+    // ServiceRegistry::registerService() call
+    bool builtIn;
+};
+
 service::Description::Description()
-    : m_majorVersion(0),
-      m_minorVersion(0),
-      m_microVersion(0),
-      m_builtIn(false),
+    : m_rep(new Rep),
       m_def(NULL)
 {
 }
 
+service::Description::Rep &
+service::Description::mutableRep()
+{
+    if (!m_rep.unique()) m_rep.reset(new Rep(*m_rep));
+    return *m_rep;
+}
+
 service::Description::~Description()
 {
     freeDef();
@@ -359,83 +609,92 @@ service::Description::~Description()
 bool
 service::Description::isBuiltIn() const
 {
-    return m_builtIn;
+    return m_rep->builtIn;
 }
 
 void
 service::Description::setIsBuiltIn(bool x)
 {
-    m_builtIn = x;
+    if (m_rep->builtIn != x) mutableRep().builtIn = x;
 }
 
 std::string
 service::Description::name() const
 {
-    return m_name;
+    return m_rep->name;
 }
 
 void
 service::Description::setName(const char * name)
 {
-    m_name = name;
+    mutableRep().name = name;
 }
 
 std::string
 service::Description::docString() const
 {
-    return m_docString;
+    return m_rep->docString;
 }
 
 void
 service::Description::setDocString(const char * docString)
 {
-    m_docString = docString;
+    mutableRep().docString = docString;
 }
 
 std::list<service::Function>
 service::Description::functions() const
 {
-    return m_functions;
+    return std::list<Function>(m_rep->functions.begin(),
+                               m_rep->functions.end());
 }
 
 void
 service::Description::setFunctions(
     const std::list<service::Function> & functions)
 {
-    m_functions = functions;
+    Rep & r = mutableRep();
+    r.functions.clear();
+    r.index.clear();
+    std::list<Function>::const_iterator it;
+    for (it = functions.begin(); it != functions.end(); it++) {
+        r.addFunction(*it);
+    }
+}
+
+const service::Function *
+service::Description::function(const char * funcName) const
+{
+    if (funcName == NULL) return NULL;
+    std::tr1::unordered_map<std::string, unsigned int>::const_iterator it;
+    it = m_rep->index.find(funcName);
+    if (it == m_rep->index.end()) return NULL;
+    return &m_rep->functions[it->second];
 }
 
 bool
 service::Description::getFunction(const char * funcName,
                                   service::Function & oFunc) const
 {
-    std::list<Function>::const_iterator it;
-    
-    for (it = m_functions.begin(); it != m_functions.end(); it++)
-    {
-        if (!it->name().compare(funcName)) 
-        {
-            oFunc = *it;
-            return true;
-        }
-    }
-    
-    return false;
+    const Function * f = function(funcName);
+    if (f == NULL) return false;
+    oFunc = *f;
+    return true;
 }
 
 
 bool
 service::Description::hasFunction(const char * funcName) const
 {
-    Function f;
-    return getFunction(funcName, f);
+    return function(funcName) != NULL;
 }
 
 std::string
 service::Description::versionString() const
 {
     std::stringstream ss;
-    ss << m_majorVersion << "." << m_minorVersion << "." << m_microVersion;
+    ss << m_rep->majorVersion << "." << m_rep->minorVersion << "."
+       << m_rep->microVersion;
     return ss.str();
 }
 
@@ -448,37 +707,37 @@ service::Description::nameVersionString() const
 unsigned int
 service::Description::majorVersion() const
 {
-    return m_majorVersion;    
+    return m_rep->majorVersion;
 }
 
 void
 service::Description::setMajorVersion(unsigned int majorVersion)
 {
-    m_majorVersion = majorVersion;    
+    mutableRep().majorVersion = majorVersion;
 }
 
 unsigned int
 service::Description::minorVersion() const
 {
-    return m_minorVersion;
+    return m_rep->minorVersion;
 }
 
 void
 service::Description::setMinorVersion(unsigned int minorVersion)
 {
-    m_minorVersion = minorVersion;    
+    mutableRep().minorVersion = minorVersion;
 }
 
 unsigned int
 service::Description::microVersion() const
 {
-    return m_microVersion;
+    return m_rep->microVersion;
 }
 
 void
 service::Description::setMicroVersion(unsigned int microVersion)
 {
-    m_microVersion = microVersion;
+    mutableRep().microVersion = microVersion;
 }
 
 
@@ -503,14 +762,14 @@ service::Description::toBPObject() const
     verMap->add("micro", new Integer(microVersion()));
     m->add("version", verMap);
 
-    if (!m_docString.empty()) {
-        m->add("documentation", new String(m_docString));
+    if (!m_rep->docString.empty()) {
+        m->add("documentation", new String(m_rep->docString));
     }
         
     List* l = new List;
 
-    std::list<Function>::const_iterator fit;
-    for (fit = m_functions.begin(); fit != m_functions.end(); fit++)
+    std::vector<Function>::const_iterator fit;
+    for (fit = m_rep->functions.begin(); fit != m_rep->functions.end(); fit++)
     {
         Map* funcDesc = new Map;
         funcDesc->add("name", new String(fit->name()));
@@ -627,7 +886,7 @@ service::Description::fromBPObject(const Object* bp)
                 }
             }
             func.setArguments(params);
-            m_functions.push_back(func);
+            mutableRep().addFunction(func);
         }
     }
 
@@ -637,20 +896,17 @@ service::Description::fromBPObject(const Object* bp)
 void 
 service::Description::clear()
 {
-    m_name.clear();
-    m_majorVersion = m_minorVersion = m_microVersion = 0;
-    m_docString.clear();
-    m_functions.clear();
-    m_builtIn = false;
+    // leaves any copies sharing the old contents untouched
+    m_rep.reset(new Rep);
 }
 
 bp::SemanticVersion
 service::Description::version() const
 {
     bp::SemanticVersion v;
-    v.setMajor(m_majorVersion);
-    v.setMinor(m_minorVersion);    
-    v.setMicro(m_microVersion);    
+    v.setMajor(m_rep->majorVersion);
+    v.setMinor(m_rep->minorVersion);    
+    v.setMicro(m_rep->microVersion);    
     return v;
 }
 
@@ -660,17 +916,18 @@ service::Description::fromBPServiceDefinition(const BPServiceDefinition * def)
     clear();
     if (!def) return false;
 
-    if (def->serviceName) m_name.append(def->serviceName);
-    m_majorVersion = def->majorVersion;    
-    m_minorVersion = def->minorVersion;
-    m_microVersion = def->microVersion;
-    if (def->docString) m_docString.append(def->docString);    
+    Rep & r = mutableRep();
+    if (def->serviceName) r.name.append(def->serviceName);
+    r.majorVersion = def->majorVersion;    
+    r.minorVersion = def->minorVersion;
+    r.microVersion = def->microVersion;
+    if (def->docString) r.docString.append(def->docString);    
 
     // now functions
     for (unsigned int i = 0; i < def->numFunctions; i++) {
         Function f;
         if (f.fromBPFunctionDefinition(def->functions + i)) {
-            m_functions.push_back(f);
+            r.addFunction(f);
         } else {
             clear();
             return false;
@@ -681,170 +938,17 @@ service::Description::fromBPServiceDefinition(const BPServiceDefinition * def)
 }
 
 
+// validates a call with no arguments, for functions that declare none
+static const service::ArgumentValidator s_noArguments =
+    service::ArgumentValidator(std::list<service::Argument>());
+
 std::string
 bp::service::validateArguments(const bp::service::Function & desc,
                                bp::Map* arguments)
 {
-    // We do this verification in two, expensive iterations.  suspect
-    // n is sufficiently small that it doesn't matter.  let the profiler
-    // be the judge.
-
-    // a set that we'll build up for more efficient checking of presence
-    // of required arguments
-    std::set<std::string> haveArgs;
-    
-    // a map of arguments which must be modified.  
-    // Needed since Safari will often send integer arguments
-    // as doubles
-    std::map<std::string, bp::Object*> mods;
-    
-    // _first_ verify all arguments that are present are of the
-    // correct type
-    if (arguments != NULL) 
-    {
-        bp::Map::Iterator iter(*arguments);
-        const char* name = NULL;
-        while ((name = iter.nextKey()) != NULL) 
-        {
-            bp::service::Argument adesc;
-
-            // unknown argument
-            if (!desc.getArgument(name, adesc))
-            {
-                std::stringstream ss;
-                ss << "argument '" << name << "' not supported by function '"
-                   << desc.name() << "'";
-                return ss.str();
-            }
-
-            // argument is known, now check type
-            const char * gottype = NULL;
-            if (adesc.type() != bp::service::Argument::Any) {
-                switch (arguments->value(name)->type())
-                {
-                    case BPTBoolean:
-                        if (adesc.type() != bp::service::Argument::Boolean)
-                        {
-                            gottype = "boolean";
-                        }
-                        break;
-                    case BPTDouble:
-                        if (adesc.type() != bp::service::Argument::Double)
-                        {
-                            gottype = "double";
-                        }
-                        break;
-                    case BPTCallBack:
-                        if (adesc.type() != bp::service::Argument::CallBack)
-                        {
-                            gottype = "callback";
-                        }
-                        break;
-                    case BPTInteger:
-                        if (adesc.type() != bp::service::Argument::Integer)
-                        {
-                            gottype = "integer";
-                        }
-                        break;
-                    case BPTList:
-                        if (adesc.type() != bp::service::Argument::List)
-                        {
-                            gottype = "list";
-                        }
-                        break;
-                    case BPTMap:
-                        if (adesc.type() != bp::service::Argument::Map)
-                        {
-                            gottype = "map";
-                        }
-                        break;
-                    case BPTString:
-                        if (adesc.type() != bp::service::Argument::String)
-                        {
-                            gottype = "string";
-                        }
-                        break;
-                    case BPTNativePath:
-                        if (adesc.type() != bp::service::Argument::Path)
-                        {
-                            gottype = "path";
-                        }
-                        break;
-                    case BPTWritableNativePath:
-                        if (adesc.type() != bp::service::Argument::WritablePath)
-                        {
-                            gottype = "writablePath";
-                        }
-                        break;
-                    case BPTNull:
-                        if (adesc.type() != bp::service::Argument::Null)
-                        {
-                            gottype = "null";
-                        }
-                        break;
-                    default:
-                        gottype = "unknown";
-                        break;
-                };
-            }
-            
-            // if gottype is non-null, we have a type mismatch
-            if (gottype != NULL)
-            {
-                // Allow conversion between int and double.  Needed
-                // since Safari often sends integers as doubles
-                std::string expected(bp::service::Argument::typeAsString(adesc.type()));
-                std::string got(gottype);
-                if (!expected.compare("integer") && !got.compare("double")) {
-                    const bp::Double* oldVal = 
-                        dynamic_cast<const bp::Double*>(arguments->value(name));
-                    double dval = oldVal->value() + 0.5;  // round
-                    mods[name] = new bp::Integer((BPInteger)dval);
-                } else if (!expected.compare("double") 
-                           && !got.compare("integer")) {
-                    const bp::Integer* oldVal = 
-                        dynamic_cast<const bp::Integer*>(arguments->value(name));
-                    mods[name] = new bp::Double((BPDouble)oldVal->value());
-                } else {
-                    std::stringstream ss;
-                    ss << "argument '" << name
-                       << "' should be of type "
-                       << bp::service::Argument::typeAsString(adesc.type())
-                       << ", but is of type " << gottype;
-                    return ss.str();
-                }
-            }
-
-            // we're cool.  add this to the set of arguments we have
-            haveArgs.insert(name);
-        }
-
-        // modify args as needed
-        std::map<std::string, bp::Object*>::iterator miter;
-        for (miter = mods.begin(); miter != mods.end(); ++miter) {
-            arguments->add(miter->first.c_str(), miter->second);
-        }
-    }
-        
-    // verify all required arguments are present
-    std::list<bp::service::Argument> args = desc.arguments();
-    std::list<bp::service::Argument>::iterator ait;    
-    for (ait = args.begin(); ait != args.end(); ait++)
-    {
-        if (ait->required())
-        {
-            std::set<std::string>::iterator findArg;
-            findArg = haveArgs.find(ait->name());
-            if (findArg == haveArgs.end())
-            {
-                std::stringstream ss;
-                ss << "call to '" << desc.name() << "' requires a '"
-                   << ait->name() << "' argument";
-                return ss.str();
-            }
-        }
-    }
-    return std::string();
+    const ArgumentValidator & v =
+        desc.m_validator ? *desc.m_validator : s_noArguments;
+    return v.validate(desc.m_name, arguments);
 }
 
 // try to format a doc string, breaking lines at 60 chars
@@ -897,8 +1001,8 @@ bp::service::Description::toHumanReadableString() const
            << std::endl;
     }
 
-    std::list<bp::service::Function> functions = this->functions();
-    std::list<bp::service::Function>::iterator fit;
+    const std::vector<bp::service::Function> & functions = m_rep->functions;
+    std::vector<bp::service::Function>::const_iterator fit;
 
     ss << std::endl;        
     ss << functions.size() << " function(s) supported:" << std::endl;
@@ -957,23 +1061,24 @@ bp::service::Description::toBPServiceDefinition(void)
     m_def = (BPServiceDefinition *) calloc(1, sizeof(BPServiceDefinition));
     assert(m_def != NULL);
 
-    m_def->serviceName = (char *) m_name.c_str();
-    m_def->majorVersion = m_majorVersion;
-    m_def->minorVersion = m_minorVersion;    
-    m_def->microVersion = m_microVersion;    
-    m_def->docString = (char *) m_docString.c_str();
+    // the definition points into the functions, which each keep their
+    // argument definitions, so this instance needs contents of its own
+    Rep & r = mutableRep();
+
+    m_def->serviceName = (char *) r.name.c_str();
+    m_def->majorVersion = r.majorVersion;
+    m_def->minorVersion = r.minorVersion;    
+    m_def->microVersion = r.microVersion;    
+    m_def->docString = (char *) r.docString.c_str();
 
     // functions
-    if (m_functions.size()) {
-        m_def->numFunctions = m_functions.size();
+    if (r.functions.size()) {
+        m_def->numFunctions = r.functions.size();
         m_def->functions = (BPFunctionDefinition *)
-            calloc(m_functions.size(), sizeof(BPFunctionDefinition));    
-
-        std::list<Function>::iterator i;
+            calloc(r.functions.size(), sizeof(BPFunctionDefinition));    
 
-        unsigned int x;
-        for (x = 0, i = m_functions.begin(); i != m_functions.end(); x++, i++) {
-            i->toBPFunctionDefinition(m_def->functions + x);
+        for (unsigned int x = 0; x < r.functions.size(); x++) {
+            r.functions[x].toBPFunctionDefinition(m_def->functions + x);
         }
     }
     
@@ -981,13 +1086,7 @@ bp::service::Description::toBPServiceDefinition(void)
 }
 
 service::Description::Description(const service::Description & d)
-    : m_name(d.m_name), 
-      m_majorVersion(d.m_majorVersion),    
-      m_minorVersion(d.m_minorVersion),    
-      m_microVersion(d.m_microVersion),
-      m_docString(d.m_docString), 
-      m_functions(d.m_functions),
-      m_builtIn(d.m_builtIn),
+    : m_rep(d.m_rep),
       m_def(NULL)  // generated on demand, don't copy
 {
 }
@@ -995,16 +1094,8 @@ service::Description::Description(const service::Description & d)
 service::Description &
 service::Description::operator=(const service::Description & d)
 {
-    m_name = d.m_name;
-    m_majorVersion = d.m_majorVersion;
-    m_minorVersion = d.m_minorVersion;
-    m_microVersion = d.m_microVersion;
-    m_docString= d.m_docString;
-    m_functions = d.m_functions;
-    m_builtIn = d.m_builtIn;
-
-    if (m_def) free(m_def); // m_def is demand generated!
-    m_def = NULL;
+    m_rep = d.m_rep;
+    freeDef(); // m_def is demand generated!
 
     return *this;
 }
@@ -29,11 +29,15 @@
  */
 
 #include "ServiceInterfaceCache.h"
+#include <fstream>
 #include "BPUtils/bpfile.h"
 #include "BPUtils/BPLog.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bpsync.h"
 #include "BPUtils/bptime.h"
 #include "BPUtils/bpstrutil.h"
 #include "BPUtils/bptypeutil.h"
+#include "bpkvlog.h"
 #include "ProductPaths.h"
 
 
@@ -102,14 +106,277 @@ bp::serviceInterfaceCache::set(const std::string & name,
     return ok;
 }
 
+// the content keyed index, opened on first use
+static bp::KVLog * s_index = NULL;
+static boost::filesystem::path s_indexPath;
+static bp::sync::Mutex s_indexLock;
+
+static bp::KVLog *
+openIndex()
+{
+    bp::sync::Lock lck(s_indexLock);
+    if (s_index == NULL) {
+        boost::filesystem::path path = s_indexPath;
+        if (path.empty()) {
+            path = bp::paths::getServiceInterfaceCachePath() / "Index.kv";
+        }
+        bp::KVLog * index = new bp::KVLog;
+        if (!index->open(path)) {
+            BPLOG_WARN_STRM("unable to open service interface index: "
+                            << path);
+            delete index;
+            return NULL;
+        }
+        s_index = index;
+    }
+    return s_index;
+}
+
+// keys are "name/version/hash", entries for a service share a prefix
+static std::string
+keyPrefix(const std::string & name, const std::string & version)
+{
+    return name + "/" + version + "/";
+}
+
+// remove index entries for name/version, save for keep
+static void
+purgeIndex(bp::KVLog * index, const std::string & prefix,
+           const std::string & keep)
+{
+    // only the service's own keys, the whole index is far too
+    // much to copy on every set
+    std::vector<std::string> keys = index->keys(prefix);
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] != keep) (void) index->remove(keys[i]);
+    }
+}
+
 bool
 bp::serviceInterfaceCache::purge(const std::string & name,
                                  const std::string & version)
 {
     if (name.empty() || version.empty()) return false;
 
+    bp::KVLog * index = openIndex();
+    if (index) purgeIndex(index, keyPrefix(name, version), std::string());
+
     boost::filesystem::path path = buildPath(name, version);
 
     return bp::file::safeRemove( path );
 }
 
+
+static bool
+readAt(std::ifstream & f, boost::uint64_t offset, size_t len,
+       std::string & out)
+{
+    out.resize(len);
+    if (len == 0) return true;
+    f.clear();
+    f.seekg((std::streamoff) offset);
+    f.read(&out[0], len);
+    return f.gcount() == (std::streamsize) len;
+}
+
+static boost::uint64_t
+decode(const std::string & b, size_t offset, size_t len, bool bigEndian)
+{
+    boost::uint64_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char) b[bigEndian ? offset + i
+                                            : offset + len - 1 - i];
+        v = (v << 8) | c;
+    }
+    return v;
+}
+
+static std::string
+toHex(const std::string & b)
+{
+    static const char * digits = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < b.size(); i++) {
+        unsigned char c = (unsigned char) b[i];
+        hex.push_back(digits[c >> 4]);
+        hex.push_back(digits[c & 0xf]);
+    }
+    return hex;
+}
+
+// the desc of the first NT_GNU_BUILD_ID note among PT_NOTE segments
+static std::string
+elfBuildId(std::ifstream & f, const std::string & ident)
+{
+    bool is64 = ident[4] == 2;
+    bool bigEndian = ident[5] == 2;
+
+    std::string hdr;
+    if (!readAt(f, 0, is64 ? 64 : 52, hdr)) return std::string();
+    boost::uint64_t phoff = is64 ? decode(hdr, 0x20, 8, bigEndian)
+                                 : decode(hdr, 0x1C, 4, bigEndian);
+    size_t phentsize = (size_t) decode(hdr, is64 ? 0x36 : 0x2A, 2, bigEndian);
+    size_t phnum = (size_t) decode(hdr, is64 ? 0x38 : 0x2C, 2, bigEndian);
+    if (phentsize < (is64 ? 56u : 32u)) return std::string();
+
+    for (size_t i = 0; i < phnum; i++) {
+        std::string ph;
+        if (!readAt(f, phoff + i * phentsize, phentsize, ph)) break;
+        if (decode(ph, 0, 4, bigEndian) != 4) continue;    // PT_NOTE
+        boost::uint64_t off = is64 ? decode(ph, 0x08, 8, bigEndian)
+                                   : decode(ph, 0x04, 4, bigEndian);
+        boost::uint64_t size = is64 ? decode(ph, 0x20, 8, bigEndian)
+                                    : decode(ph, 0x10, 4, bigEndian);
+        std::string notes;
+        if (size > 0x10000 || !readAt(f, off, (size_t) size, notes)) continue;
+
+        size_t pos = 0;
+        while (pos + 12 <= notes.size()) {
+            size_t namesz = (size_t) decode(notes, pos, 4, bigEndian);
+            size_t descsz = (size_t) decode(notes, pos + 4, 4, bigEndian);
+            boost::uint64_t type = decode(notes, pos + 8, 4, bigEndian);
+            size_t name = pos + 12;
+            size_t desc = name + ((namesz + 3) & ~3);
+            if (desc + descsz > notes.size()) break;
+            if (type == 3 && namesz == 4 &&
+                notes.compare(name, 4, std::string("GNU\0", 4)) == 0)
+            {
+                return toHex(notes.substr(desc, descsz));
+            }
+            pos = desc + ((descsz + 3) & ~3);
+        }
+    }
+    return std::string();
+}
+
+// the uuid of a Mach-O image's LC_UUID load command
+static std::string
+machoUuid(std::ifstream & f, boost::uint64_t base)
+{
+    std::string hdr;
+    if (!readAt(f, base, 32, hdr)) return std::string();
+    boost::uint64_t magic = decode(hdr, 0, 4, false);
+    bool bigEndian;
+    bool is64;
+    if (magic == 0xfeedface || magic == 0xfeedfacf) {
+        bigEndian = false;
+        is64 = magic == 0xfeedfacf;
+    } else if (magic == 0xcefaedfe || magic == 0xcffaedfe) {
+        bigEndian = true;
+        is64 = magic == 0xcffaedfe;
+    } else {
+        return std::string();
+    }
+
+    size_t ncmds = (size_t) decode(hdr, 16, 4, bigEndian);
+    boost::uint64_t off = base + (is64 ? 32 : 28);
+    for (size_t i = 0; i < ncmds && i < 1024; i++) {
+        std::string lc;
+        if (!readAt(f, off, 24, lc)) break;
+        boost::uint64_t cmd = decode(lc, 0, 4, bigEndian);
+        boost::uint64_t cmdsize = decode(lc, 4, 4, bigEndian);
+        if (cmd == 0x1b) return toHex(lc.substr(8, 16));    // LC_UUID
+        if (cmdsize < 8) break;
+        off += cmdsize;
+    }
+    return std::string();
+}
+
+std::string
+bp::serviceInterfaceCache::buildId(const boost::filesystem::path & library)
+{
+    std::ifstream f;
+    if (!bp::file::openReadableStream(f, library,
+                                      std::ios::in | std::ios::binary))
+    {
+        return std::string();
+    }
+
+    std::string ident;
+    if (!readAt(f, 0, 16, ident)) return std::string();
+
+    if (ident.compare(0, 4, "\x7f" "ELF") == 0) {
+        return elfBuildId(f, ident);
+    }
+
+    // a fat file, we take the first architecture's uuid
+    if (decode(ident, 0, 4, true) == 0xcafebabe) {
+        std::string arch;
+        if (decode(ident, 4, 4, true) == 0 || !readAt(f, 8, 20, arch)) {
+            return std::string();
+        }
+        return machoUuid(f, decode(arch, 8, 4, true));
+    }
+
+    return machoUuid(f, 0);
+}
+
+std::string
+bp::serviceInterfaceCache::contentKey(const bp::service::Summary & summary)
+{
+    if (summary.name().empty() || summary.version().empty() ||
+        summary.type() == bp::service::Summary::Dependent ||
+        summary.serviceLibraryPath().empty())
+    {
+        return std::string();
+    }
+
+    std::string manifest;
+    if (!bp::strutil::loadFromFile(summary.path() / "manifest.json",
+                                   manifest))
+    {
+        return std::string();
+    }
+
+    // a PE file, or an image linked without a build id, is hashed
+    // whole.  slower, but far cheaper than describing the service.
+    std::string library = buildId(summary.serviceLibraryPath());
+    if (library.empty()) {
+        library = bp::sha256::hashFile(summary.serviceLibraryPath());
+        if (library.empty()) return std::string();
+    }
+
+    return keyPrefix(summary.name(), summary.version())
+        + bp::sha256::hash(manifest + "\n" + library);
+}
+
+bp::Object *
+bp::serviceInterfaceCache::getByKey(const std::string & key)
+{
+    if (key.empty()) return NULL;
+
+    bp::KVLog * index = openIndex();
+    std::string jsonRep;
+    if (index == NULL || !index->get(key, jsonRep)) return NULL;
+    return bp::Object::fromPlainJsonString(jsonRep);
+}
+
+bool
+bp::serviceInterfaceCache::setByKey(const std::string & key,
+                                    const bp::Object * obj)
+{
+    if (key.empty() || obj == NULL) return false;
+
+    bp::KVLog * index = openIndex();
+    if (index == NULL || !index->set(key, obj->toPlainJsonString())) {
+        BPLOG_WARN("Unable to add service interface to index.");
+        return false;
+    }
+
+    // a service's earlier contents won't be back
+    size_t slash = key.rfind('/');
+    if (slash != std::string::npos) {
+        purgeIndex(index, key.substr(0, slash + 1), key);
+    }
+    return true;
+}
+
+void
+bp::serviceInterfaceCache::setIndexPath(const boost::filesystem::path & path)
+{
+    bp::sync::Lock lck(s_indexLock);
+    delete s_index;
+    s_index = NULL;
+    s_indexPath = path;
+}
+
@@ -53,6 +53,8 @@ static const char * s_typeKey = "type";
 static const char * s_usesKey = "uses";
 
 static const char * s_shutdownDelayKey = "shutdownDelaySecs";
+static const char * s_inProcessKey = "inProcess";
+static const char * s_shareableKey = "shareable";
 static const char * s_serviceKey = "service";
 static const char * s_deprecatedServiceKey = "corelet";
 static const char * s_versionKey = "version";
@@ -70,7 +72,8 @@ static const char * s_englishKey = "en";
 static const char * s_permissionsKey = "permissions";
 
 service::Summary::Summary()
-    : m_type(None), m_modDate(), m_shutdownDelaySecs(-1)
+    : m_type(None), m_modDate(), m_shutdownDelaySecs(-1), m_inProcess(false),
+      m_shareable(false)
 {
 }
 
@@ -143,6 +146,18 @@ service::Summary::detectService(const boost::filesystem::path &dirName,
         m_shutdownDelaySecs = (int) (long long) *(o->get(s_shutdownDelayKey));
     }
 
+    // parse the optional request to run inside the daemon
+    if (o->has(s_inProcessKey, BPTBoolean))
+    {
+        m_inProcess = *(o->get(s_inProcessKey));
+    }
+
+    // parse the optional declaration that a shared host will do
+    if (o->has(s_shareableKey, BPTBoolean))
+    {
+        m_shareable = *(o->get(s_shareableKey));
+    }
+
     // all services must be localized to at least english
     std::map<std::string, std::pair<std::string, std::string> > localizations;
 
@@ -429,6 +444,18 @@ service::Summary::shutdownDelaySecs() const
     return m_shutdownDelaySecs;
 }
 
+bool
+service::Summary::inProcess() const
+{
+    return m_inProcess;
+}
+
+bool
+service::Summary::shareable() const
+{
+    return m_shareable;
+}
+
 std::string
 service::Summary::typeAsString() const
 {
@@ -522,6 +549,8 @@ service::Summary::clear()
     m_type = None;
 
     m_shutdownDelaySecs = -1;
+    m_inProcess = false;
+    m_shareable = false;
     m_name.clear();
     m_version.clear();
     m_path.clear();
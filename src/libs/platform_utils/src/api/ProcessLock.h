@@ -54,7 +54,8 @@ typedef struct ProcessLock_t * ProcessLock;
 ProcessLock acquireProcessLock(bool block,
                                const std::string& lockName = "");
 
-/** Clean up some resources, should be done before shutting down */
+/** Release the lock and clean up some resources, should be done before
+ *  shutting down */
 void releaseProcessLock(ProcessLock hand);
 
 };
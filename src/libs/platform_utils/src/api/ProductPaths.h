@@ -52,14 +52,31 @@ namespace bp {
          */
         std::string getProductName();
     
+        /**
+         *   Name of an environment variable which, when set, replaces
+         *   the product base directory for this process and the
+         *   processes it spawns.  Lets tests keep to a directory of
+         *   their own.
+         */
+        extern const char* kProductDirectoryEnvVar;
+
         /**
          *   Get path to "base" directory for all versions.
          *   This is the directory under which versioned platforms
-         *   will be kept.  Throws a fatal exception on failure.
+         *   will be kept.  Honors kProductDirectoryEnvVar.  Throws a
+         *   fatal exception on failure.
          *   \return   path to product base directory
          */
         boost::filesystem::path getProductTopDirectory();
 
+        /**
+         *   Get the platform's per-user product base directory,
+         *   ignoring kProductDirectoryEnvVar.  Throws a fatal
+         *   exception on failure.
+         *   \return   path to product base directory
+         */
+        boost::filesystem::path getDefaultProductTopDirectory();
+
         /**
          *   Get path to product temp directory
          *   \return   path to product temp directory
@@ -136,6 +153,15 @@ namespace bp {
          *   \return   path to service cache directory
          */
         boost::filesystem::path getServiceCacheDirectory();
+
+        /**
+         *   Get path to the content addressed store which holds the
+         *   files of installed services (see bp::ObjectStore).  It is
+         *   on the same volume as the service directory.
+         *   Throws a fatal exception on failure.
+         *   \return   path to service object store directory
+         */
+        boost::filesystem::path getServiceObjectStoreDirectory();
         
         /**
          *   Get path to cached service interface (stored on disk in json
@@ -225,6 +251,15 @@ namespace bp {
         boost::filesystem::path getPersistentStatePath(int major = -1,
                                                        int minor = -1,
                                                        int micro = -1);
+
+        /**
+         *   Get path to the log of service require statements seen by
+         *   this installation, which the service updater keeps current.
+         *   Throws a fatal exception on failure.
+         */
+        boost::filesystem::path getRequireHistoryPath(int major = -1,
+                                                      int minor = -1,
+                                                      int micro = -1);
         
         /**
          *  Get path to domain permissions file.  
@@ -33,6 +33,7 @@
 #include <map>
 
 #include "BPUtils/bpsemanticversion.h"
+#include "BPUtils/bptr1.h"
 #include "BPUtils/bptypeutil.h"
 #include "ServiceAPI/bpdefinition.h" 
 
@@ -41,6 +42,8 @@
 
 namespace bp { namespace service {
 
+class ArgumentValidator;
+
 /**
  * an in memory representation of an argument to a function on a service
  */ 
@@ -144,7 +147,16 @@ private:
     std::string m_docString;    
     std::list<Argument> m_arguments;
 
+    // m_arguments compiled for validateArguments(), rebuilt whenever
+    // they change and shared between copies.  NULL when there are
+    // no arguments.
+    std::tr1::shared_ptr<const ArgumentValidator> m_validator;
+    void compileArguments();
+
     BPArgumentDefinition * m_adefs;
+
+    friend std::string validateArguments(const Function & fdesc,
+                                         bp::Map* arguments);
 };
 
 /**
@@ -194,7 +206,12 @@ public:
 
     bool hasFunction(const char * funcName) const;
 
-    /** get the function description */
+    /** get the function description, or NULL if there is no such
+     *  function.  a hashed lookup that copies nothing.  the pointer
+     *  is valid until this instance is changed or deleted */
+    const Function * function(const char * funcName) const;
+
+    /** get a copy of the function description */
     bool getFunction(const char * funcName, Function & oFunc) const;
 
     /** generate a bp::Object representation of the service description.
@@ -229,15 +246,11 @@ public:
     /** generate a human readable buffer of the interface of the service */
     std::string toHumanReadableString() const;
 private:
-    std::string m_name;
-    unsigned int m_majorVersion;    
-    unsigned int m_minorVersion;    
-    unsigned int m_microVersion;    
-    std::string m_docString;
-    std::list<Function> m_functions;
-    // true for built in services, added using the
-    // ServiceRegistry::registerService() call
-    bool m_builtIn;
+    // everything but m_def, shared between copies so that copying a
+    // description is a reference count bump.  copied on first change.
+    struct Rep;
+    std::tr1::shared_ptr<Rep> m_rep;
+    Rep & mutableRep();
 
     BPServiceDefinition * m_def;
     void freeDef();
@@ -253,13 +266,15 @@ private:
  * this function is used by both the daemon (for services) and the
  * plugin (for pluglets)
  *
+ * validation uses the function's compiled argument table: each
+ * supplied argument costs one binary search and a mask test, and
+ * nothing is allocated unless an argument needs converting or the
+ * call is rejected.
+ *
  * returns non-empty string on failure, containing a verbose error message
  */
 std::string validateArguments(const bp::service::Function & fdesc,
                               bp::Map* arguments);
-
-std::string validateArguments(const bp::service::Function & desc,
-                              bp::Map* arguments);
  
 } }
     
@@ -31,8 +31,10 @@
 #ifndef __SERVICE_INTERFACE_CACHE_H__
 #define __SERVICE_INTERFACE_CACHE_H__
 
+#include "BPUtils/bpfile.h"
 #include "BPUtils/bptime.h"
 #include "BPUtils/bptypeutil.h"
+#include "ServiceSummary.h"
 
 
 namespace bp { namespace serviceInterfaceCache {
@@ -55,10 +57,41 @@ namespace bp { namespace serviceInterfaceCache {
            const std::string & version,
            const bp::Object * obj);
   
-  /** purge the cache entry for a specified service. */
+  /** purge the cache entry for a specified service, along with any
+   *  entries in the content keyed index. */
   bool purge(const std::string & name, 
              const std::string & version);
 
+  /* Entries above are trusted only while newer than a service's
+   * manifest, so services being rewritten unchanged (as over a
+   * platform upgrade) forces them all to be described again.  The
+   * content keyed index below is trusted for as long as a service's
+   * manifest and library are what they were, and lives in a single
+   * bp::KVLog alongside the per service files. */
+
+  /** the build id a linker recorded in a library (ELF NT_GNU_BUILD_ID
+   *  or Mach-O LC_UUID, of the first architecture of a fat file) as
+   *  hex.  empty if the library has none. */
+  std::string buildId(const boost::filesystem::path & library);
+
+  /** a key which changes only when the service does: its name and
+   *  version, and a hash of its manifest and the build id of its
+   *  library (or, lacking one, the library's contents).  empty for
+   *  dependent services, which have no library of their own, and on
+   *  error */
+  std::string contentKey(const bp::service::Summary & summary);
+
+  /** get the interface stored under a content key, NULL if none */
+  bp::Object * getByKey(const std::string & key);
+
+  /** store an interface under a content key, replacing those stored
+   *  for other contents of the same service.  false upon error */
+  bool setByKey(const std::string & key, const bp::Object * obj);
+
+  /** keep the index at path rather than in the cache directory, for
+   *  tests */
+  void setIndexPath(const boost::filesystem::path & path);
+
 } }
 
 #endif
@@ -93,6 +93,18 @@ public:
      *  specified in the manifest.json of a service.  If -1 is returned,
      *  no such option was specified */
     int shutdownDelaySecs() const;
+
+    /** does the manifest.json of the service ask for it to run inside
+     *  BrowserPlusCore rather than in a spawned process?  This is only
+     *  honored for services signed with the platform key. */
+    bool inProcess() const;
+
+    /** does the manifest.json of the service declare that it may
+     *  share a host process with other services?  A crash of any
+     *  service in a shared host ends them all.  The host runs calls
+     *  into a service from its own directory, but threads the
+     *  service starts mustn't rely on the cwd. */
+    bool shareable() const;
     
     /** get the locales for which this service is localized */
     std::list<std::string> localizations() const;
@@ -141,6 +153,8 @@ public:
         m_localizations;
     BPTime m_modDate;
     int m_shutdownDelaySecs;
+    bool m_inProcess;
+    bool m_shareable;
 
     // specific to standalone or provider services
     boost::filesystem::path m_serviceLibraryPath;    
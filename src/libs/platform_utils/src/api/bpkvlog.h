@@ -0,0 +1,122 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpkvlog.h
+ *  An append-only, checksummed log of string key/value pairs which
+ *  may be shared between processes.
+ */
+
+#ifndef __BPKVLOG_H__
+#define __BPKVLOG_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
+#include "ProcessLock.h"
+
+namespace bp {
+    /**
+     * Each write appends a single record to the log.  The log is
+     * rewritten only by compact(), which runs automatically once
+     * overwritten and removed records dominate the file.
+     *
+     * Each write is synced to disk before it returns.  Records carry
+     * a checksum, and a torn or corrupt tail left by a crash is
+     * dropped when the log is next read.  Access is
+     * serialized between processes with a ProcessLock, and changes
+     * made by other processes are picked up before each operation.
+     */
+    class KVLog 
+    {
+      public:
+        KVLog();
+        ~KVLog();
+
+        /**
+         * open the log at path, creating it if needed.  if the log
+         * doesn't exist and legacyPath names a JSON map of strings
+         * (as written by earlier versions of bp::phash), its contents
+         * are imported and legacyPath is removed.
+         *
+         * \returns false if the log could not be created or read
+         */
+        bool open(const boost::filesystem::path & path,
+                  const boost::filesystem::path & legacyPath =
+                      boost::filesystem::path());
+
+        /** \returns true if the key exists */
+        bool get(const std::string & key, std::string & oVal);
+
+        /** set a key, overwriting an existing value.
+         *  \returns true if the record was written */
+        bool set(const std::string & key, const std::string & val);
+
+        /** remove a key.
+         *  \returns true if the key existed and its removal was written */
+        bool remove(const std::string & key);
+
+        /** all live entries */
+        std::map<std::string, std::string> entries();
+
+        /** keys of live entries beginning with prefix, in order.
+         *  cheaper than entries() as no values are copied */
+        std::vector<std::string> keys(const std::string & prefix);
+
+        /** rewrite the log holding only live entries */
+        bool compact();
+
+        /** size in bytes of the log file as last read or written */
+        boost::uintmax_t logSize() const { return m_offset; }
+
+      private:
+        // catch up with other writers.  must hold the lock
+        bool refresh();
+        bool append(unsigned char op, const std::string & key,
+                    const std::string & val);
+        bool rewrite();
+        void maybeCompact();
+        bool importLegacy(const boost::filesystem::path & legacyPath);
+        bool lock();
+        void unlock();
+
+        boost::filesystem::path m_path;
+        std::string m_lockName;
+        std::map<std::string, std::string> m_data;
+        // bytes of the log that have been applied to m_data
+        boost::uintmax_t m_offset;
+        // bytes of overwritten or removed records
+        boost::uintmax_t m_deadBytes;
+        unsigned int m_generation;
+        bool m_open;
+        bp::ProcessLock m_lock;
+        bp::sync::Mutex m_mutex;
+
+        // no copy semantics
+        KVLog(const KVLog &);
+        KVLog & operator=(const KVLog &);
+    };
+}
+
+#endif
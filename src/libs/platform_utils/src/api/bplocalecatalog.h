@@ -0,0 +1,134 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bplocalecatalog.h
+ *  A compiled, memory mapped form of a localized strings file.
+ */
+
+#ifndef __BPLOCALECATALOG_H__
+#define __BPLOCALECATALOG_H__
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bptr1.h"
+
+namespace bp {
+    namespace localization {
+
+        /**
+         * A StringCatalog holds every "key/locale" string from a
+         * strings.json file in a sorted binary table, so lookups are a
+         * binary search over mapped memory rather than a JSON parse.
+         *
+         * The catalog is compiled on first use and written next to the
+         * strings file (strings.json -> strings.catalog).  It records
+         * the size and modification time of the file it was compiled
+         * from and is recompiled when they change.  If the compiled
+         * file can't be written the catalog is served from memory.
+         */
+        class StringCatalog
+        {
+          public:
+            ~StringCatalog();
+
+            /**
+             * attain the catalog for a strings file, compiling it if
+             * needed.  catalogs are cached per process and reloaded
+             * when the strings file changes, which is checked at most
+             * once a second.
+             *
+             * \returns NULL if the strings file can't be read
+             */
+            static std::tr1::shared_ptr<StringCatalog>
+                get(const boost::filesystem::path & stringsPath);
+
+            /**
+             * compile stringsPath into catalogPath.  exposed so that
+             * catalogs may be built ahead of time.
+             */
+            static bool compile(const boost::filesystem::path & stringsPath,
+                                const boost::filesystem::path & catalogPath);
+
+            /** the path of the compiled catalog for a strings file */
+            static boost::filesystem::path
+                catalogPath(const boost::filesystem::path & stringsPath);
+
+            /**
+             * look up key for locale, falling back through
+             * getLocaleCandidates(locale).
+             * \returns true and sets oVal if found
+             */
+            bool lookup(const std::string & key,
+                        const std::string & locale,
+                        std::string & oVal);
+
+            /** all localizations of key, as a map of locale -> string */
+            std::map<std::string, std::string>
+                localizations(const std::string & key) const;
+
+            /** does the catalog still match its strings file? */
+            bool upToDate() const;
+
+          private:
+            StringCatalog();
+
+            // map a compiled catalog, validating it against the source
+            bool attach(const boost::filesystem::path & catalogPath);
+            void detach();
+            bool validate();
+            int findKey(const std::string & key) const;
+            int findLocale(const std::string & locale) const;
+            const std::vector<unsigned int> &
+                fallbackChain(const std::string & locale);
+
+            boost::filesystem::path m_stringsPath;
+            bp::file::FileInfo m_sourceInfo;
+            // when m_sourceInfo was last compared with the strings file
+            std::time_t m_checkedAt;
+
+            // the compiled image, either mapped or in m_image
+            const unsigned char * m_base;
+            size_t m_size;
+            std::string m_image;
+            void * m_mapping;
+
+            unsigned int m_numLocales;
+            unsigned int m_numKeys;
+            unsigned int m_numValues;
+
+            // requested locale -> catalog locale indexes to try
+            std::map<std::string, std::vector<unsigned int> > m_chains;
+            bp::sync::Mutex m_chainsLock;
+
+            // no copy semantics
+            StringCatalog(const StringCatalog &);
+            StringCatalog & operator=(const StringCatalog &);
+        };
+    }
+}
+
+#endif
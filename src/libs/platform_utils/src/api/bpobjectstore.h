@@ -0,0 +1,87 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpobjectstore.h
+ *  A content addressed store of file contents shared by installed
+ *  services.  Each distinct file is kept once as a read-only blob
+ *  named by its sha256 hash, and service directories hold hard links
+ *  to those blobs.  A blob with no links other than its own is
+ *  garbage and is removed by collectGarbage().
+ */
+
+#ifndef __BPOBJECTSTORE_H__
+#define __BPOBJECTSTORE_H__
+
+#include <string>
+#include "BPUtils/bpfile.h"
+
+namespace bp {
+    class ObjectStore 
+    {
+      public:
+        /**
+         * \param dir - store directory, created as needed.  Must be on
+         *              the same volume as the trees which are adopted.
+         */
+        ObjectStore(const boost::filesystem::path & dir);
+        ~ObjectStore();
+
+        /**
+         * Replace each regular file beneath tree with a hard link to
+         * the blob holding its contents, adding blobs as needed.
+         * Files which can't be linked (e.g. the volume doesn't support
+         * hard links) are left in place as plain copies.  Adopted
+         * files become read-only.
+         *
+         * \returns false if tree isn't a directory or couldn't be
+         *          scanned.
+         */
+        bool adopt(const boost::filesystem::path & tree,
+                   std::string & oError);
+
+        /**
+         * Remove blobs which are no longer linked from any tree.
+         * \returns the number of blobs removed
+         */
+        unsigned int collectGarbage();
+
+        /** the path at which a blob with the given contents lives */
+        boost::filesystem::path blobPath(const std::string & hash,
+                                         bool executable) const;
+
+        /** files linked to an existing blob by the last adopt() */
+        unsigned int shared() const { return m_shared; }
+
+        /** blobs added by the last adopt() */
+        unsigned int added() const { return m_added; }
+
+      private:
+        boost::filesystem::path m_dir;
+        unsigned int m_shared;
+        unsigned int m_added;
+
+        bool adoptFile(const boost::filesystem::path & file);
+    };
+}
+
+#endif
@@ -23,6 +23,7 @@
 /*
  *  bpphash.h
  *  Persistent application wide storage of string based key/value pairs
+ *  (backed by a bp::KVLog, safe for concurrent use by multiple processes)
  *  
  *  Created by Lloyd Hilaiel on 10/29/07.
  *  Copyright 2007 Yahoo! Inc. All rights reserved.
@@ -33,8 +33,9 @@
 #define __BPURLCOLLECTION_H__
 
 #include <string>
+#include <vector>
 #include "BPUtils/bpfile.h"
-#include "BPUtils/bptypeutil.h"
+#include "bpkvlog.h"
 
 namespace bp {
     class URLCollection 
@@ -45,7 +46,10 @@ namespace bp {
         
         /**
          * initialize a URLCollection from a disk file.  If the file doesn't
-         * exist, it will be created.
+         * exist, it will be created.  The collection is kept in a
+         * bp::KVLog beside path (with a .kv extension), so adding a url
+         * appends a single record.  A JSON collection written at path by
+         * earlier versions is imported and removed.
          *
          * \param useDomainForHTTP - if true, when http(s) urls are
          *              encountered the domain will be parsed out and used
@@ -53,7 +57,7 @@ namespace bp {
          *              will be treated as opaque strings.
          *
          * \returns false if file could not be created or couldn't be
-         *          parsed.
+         *          parsed, or path holds a malformed JSON collection.
          */ 
         bool init(const boost::filesystem::path & path, bool useDomainForHTTP = true);
 
@@ -76,10 +80,11 @@ namespace bp {
       private:
         boost::filesystem::path m_path;
         bool m_useDomainForHTTP;
-        bp::Map * m_data;
-        bp::List * m_list;
+        bp::KVLog m_log;
+        bool m_open;
 
-        bool writeToDisk();
+        bool loadLegacy(std::vector<std::string> & oUrls,
+                        bool & oUseDomainForHTTP);
         std::string normalizeURL(const std::string & url);
     };
 }
@@ -0,0 +1,584 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpkvlog.cpp
+ *  An append-only, checksummed log of string key/value pairs which
+ *  may be shared between processes.
+ *
+ *  The file is a header followed by records:
+ *    header: "BPKV" | version (1 byte) | generation (u32)
+ *    record: op (1 byte) | key length (u32) | value length (u32) |
+ *            key | value | crc32 of all preceding record bytes (u32)
+ *  integers are big endian.  the generation changes each time the
+ *  log is rewritten, which is how other processes notice compaction.
+ */
+
+#include "api/bpkvlog.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bprandom.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+#define KVLOG_MAGIC "BPKV"
+#define KVLOG_VERSION 1
+#define KVLOG_HEADER_SIZE 9
+#define KVLOG_RECORD_OVERHEAD 13
+#define KVLOG_OP_SET 1
+#define KVLOG_OP_REMOVE 2
+
+// don't bother compacting logs with less than this much garbage
+#define KVLOG_MIN_DEAD_BYTES (64 * 1024)
+
+
+// the crc32 (IEEE 802.3, reflected 0xEDB88320) lookup table, constant
+// so that logs may be opened from any thread
+static const unsigned int s_crcTable[256] = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+static unsigned int
+crc32(const unsigned char * buf, size_t len, unsigned int crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = s_crcTable[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+static void
+putU32(string & s, unsigned int v)
+{
+    s.push_back((char) ((v >> 24) & 0xFF));
+    s.push_back((char) ((v >> 16) & 0xFF));
+    s.push_back((char) ((v >> 8) & 0xFF));
+    s.push_back((char) (v & 0xFF));
+}
+
+
+static unsigned int
+getU32(const unsigned char * p)
+{
+    return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+        ((unsigned int) p[2] << 8) | (unsigned int) p[3];
+}
+
+
+static string
+encodeRecord(unsigned char op, const string & key, const string & val)
+{
+    string rec;
+    rec.reserve(KVLOG_RECORD_OVERHEAD + key.size() + val.size());
+    rec.push_back((char) op);
+    putU32(rec, key.size());
+    putU32(rec, val.size());
+    rec.append(key);
+    rec.append(val);
+    putU32(rec, crc32((const unsigned char *) rec.data(), rec.size()));
+    return rec;
+}
+
+
+static string
+encodeHeader(unsigned int generation)
+{
+    string hdr(KVLOG_MAGIC);
+    hdr.push_back((char) KVLOG_VERSION);
+    putU32(hdr, generation);
+    return hdr;
+}
+
+
+// flush a file (or on UNIX, a directory) to disk.  streams only
+// flush to the OS, which is not enough to survive a power loss.
+static bool
+syncPath(const bfs::path & path)
+{
+#ifdef WIN32
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    bool ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+
+static size_t
+recordSize(const string & key, const string & val)
+{
+    return KVLOG_RECORD_OVERHEAD + key.size() + val.size();
+}
+
+
+bp::KVLog::KVLog()
+    : m_offset(0), m_deadBytes(0), m_generation(0), m_open(false),
+      m_lock(NULL)
+{
+}
+
+
+bp::KVLog::~KVLog()
+{
+    unlock();
+}
+
+
+bool
+bp::KVLog::lock()
+{
+    m_lock = bp::acquireProcessLock(true, m_lockName);
+    if (m_lock == NULL) {
+        BPLOG_WARN_STRM("couldn't lock " << m_path);
+        return false;
+    }
+    return true;
+}
+
+
+void
+bp::KVLog::unlock()
+{
+    if (m_lock != NULL) {
+        bp::releaseProcessLock(m_lock);
+        m_lock = NULL;
+    }
+}
+
+
+bool
+bp::KVLog::open(const bfs::path & path,
+                const bfs::path & legacyPath)
+{
+    bp::sync::Lock lck(m_mutex);
+
+    m_path = path;
+    m_data.clear();
+    m_offset = m_deadBytes = 0;
+    m_generation = 0;
+    m_open = false;
+
+    // compaction replaces the log file, so lock on a separate file
+    // which never changes
+    bfs::path lockPath = path;
+    lockPath.replace_extension(".lock");
+#ifdef WIN32
+    // mutex names may not contain backslashes
+    m_lockName = "Local\\BrowserPlusKV_" + lockPath.string();
+    for (size_t i = 6; i < m_lockName.size(); i++) {
+        if (m_lockName[i] == '\\' || m_lockName[i] == ':') m_lockName[i] = '_';
+    }
+#else
+    m_lockName = lockPath.string();
+    // ftok() requires that the lock file exist
+    if (!bpf::pathExists(lockPath) && !bpf::touch(lockPath)) {
+        BPLOG_WARN_STRM("couldn't create " << lockPath);
+        return false;
+    }
+#endif
+
+    if (!lock()) return false;
+    bool existed = bpf::pathExists(m_path);
+    bool ok = refresh();
+    if (ok && !existed && !legacyPath.empty() && bpf::pathExists(legacyPath)) {
+        ok = importLegacy(legacyPath);
+    }
+    unlock();
+
+    m_open = ok;
+    return ok;
+}
+
+
+bool
+bp::KVLog::importLegacy(const bfs::path & legacyPath)
+{
+    string json;
+    bp::Object * obj = NULL;
+    if (bp::strutil::loadFromFile(legacyPath, json)) {
+        obj = bp::Object::fromPlainJsonString(json);
+    }
+    if (obj != NULL && obj->type() == BPTMap) {
+        const bp::Map * m = (const bp::Map *) obj;
+        bp::Map::Iterator it(*m);
+        const char * key;
+        while ((key = it.nextKey()) != NULL) {
+            const bp::Object * v = m->value(key);
+            if (v != NULL && v->type() == BPTString) {
+                m_data[key] = string(*v);
+            }
+        }
+    }
+    delete obj;
+
+    BPLOG_INFO_STRM("imported " << m_data.size() << " keys from "
+                    << legacyPath);
+    if (!rewrite()) return false;
+    (void) bpf::safeRemove(legacyPath);
+    return true;
+}
+
+
+bool
+bp::KVLog::refresh()
+{
+    ifstream in;
+    if (!bpf::pathExists(m_path)
+        || !bpf::openReadableStream(in, m_path, ios::binary))
+    {
+        // no log yet (or it's been removed).  start a new one
+        m_data.clear();
+        return rewrite();
+    }
+
+    // a new generation means the log was rewritten, start over
+    unsigned char hdr[KVLOG_HEADER_SIZE];
+    in.read((char *) hdr, sizeof(hdr));
+    if (in.gcount() != KVLOG_HEADER_SIZE
+        || memcmp(hdr, KVLOG_MAGIC, 4) != 0
+        || hdr[4] != KVLOG_VERSION)
+    {
+        BPLOG_WARN_STRM(m_path << " has a bad header, starting over");
+        in.close();
+        m_data.clear();
+        return rewrite();
+    }
+    unsigned int generation = getU32(hdr + 5);
+    if (generation != m_generation || m_offset < KVLOG_HEADER_SIZE) {
+        m_data.clear();
+        m_generation = generation;
+        m_offset = KVLOG_HEADER_SIZE;
+        m_deadBytes = 0;
+    }
+
+    // replay records appended since we last looked.  lengths come
+    // from the file, so check them against what's left of it before
+    // trusting them with an allocation.
+    boost::uintmax_t fileSize = bpf::size(m_path);
+    in.seekg((streamoff) m_offset);
+    bool torn = false;
+    vector<unsigned char> buf;
+    while (!torn) {
+        unsigned char fixed[9];
+        in.read((char *) fixed, sizeof(fixed));
+        if (in.gcount() == 0) break;
+        if (in.gcount() != (streamsize) sizeof(fixed)) {
+            torn = true;
+            break;
+        }
+        unsigned int klen = getU32(fixed + 1);
+        unsigned int vlen = getU32(fixed + 5);
+        boost::uintmax_t remaining = 0;
+        if (fileSize > m_offset + sizeof(fixed)) {
+            remaining = fileSize - m_offset - sizeof(fixed);
+        }
+        if ((fixed[0] != KVLOG_OP_SET && fixed[0] != KVLOG_OP_REMOVE)
+            || (boost::uintmax_t) klen + vlen + 4 > remaining)
+        {
+            torn = true;
+            break;
+        }
+        buf.resize((size_t) klen + vlen + 4);
+        if (!buf.empty()) in.read((char *) &buf[0], buf.size());
+        if (in.gcount() != (streamsize) buf.size()) {
+            torn = true;
+            break;
+        }
+        unsigned int crc = crc32(fixed, sizeof(fixed));
+        crc = crc32(&buf[0], klen + vlen, crc);
+        if (crc != getU32(&buf[klen + vlen])) {
+            torn = true;
+            break;
+        }
+
+        string key((const char *) &buf[0], klen);
+        map<string, string>::iterator it = m_data.find(key);
+        if (it != m_data.end()) {
+            m_deadBytes += recordSize(it->first, it->second);
+        }
+        if (fixed[0] == KVLOG_OP_SET) {
+            m_data[key] = string((const char *) &buf[klen], vlen);
+        } else {
+            if (it != m_data.end()) m_data.erase(it);
+            m_deadBytes += recordSize(key, string());
+        }
+        m_offset += sizeof(fixed) + buf.size();
+    }
+    in.close();
+
+    // writers hold the lock, so a bad record can only have been left
+    // by a crash.  drop it and everything after it.
+    if (torn) {
+        BPLOG_WARN_STRM(m_path << " has a corrupt record at offset "
+                        << m_offset << ", recovering");
+        return rewrite();
+    }
+    return true;
+}
+
+
+bool
+bp::KVLog::append(unsigned char op, const string & key, const string & val)
+{
+    string rec = encodeRecord(op, key, val);
+    ofstream out;
+    if (!bpf::openWritableStream(out, m_path, ios::binary | ios::app))
+    {
+        BPLOG_WARN_STRM("couldn't open " << m_path << " for append");
+        return false;
+    }
+    out.write(rec.data(), rec.size());
+    out.close();
+    if (out.fail() || !syncPath(m_path)) {
+        // whatever made it to disk will fail its checksum
+        BPLOG_WARN_STRM("couldn't append to " << m_path);
+        return false;
+    }
+    m_offset += rec.size();
+    return true;
+}
+
+
+void
+bp::KVLog::maybeCompact()
+{
+    if (m_deadBytes > KVLOG_MIN_DEAD_BYTES && m_deadBytes > m_offset / 2) {
+        (void) rewrite();
+    }
+}
+
+
+bool
+bp::KVLog::rewrite()
+{
+    unsigned int generation;
+    do {
+        generation = (unsigned int) bp::random::generate();
+    } while (generation == m_generation);
+
+    string contents = encodeHeader(generation);
+    map<string, string>::const_iterator it;
+    for (it = m_data.begin(); it != m_data.end(); ++it) {
+        contents.append(encodeRecord(KVLOG_OP_SET, it->first, it->second));
+    }
+
+    // write aside and rename into place so readers see either the old
+    // or the new log, never a partial one
+    bfs::path tmpPath = m_path;
+    tmpPath.replace_extension(".tmp");
+    if (!bp::strutil::storeToFile(tmpPath, contents) || !syncPath(tmpPath)) {
+        BPLOG_WARN_STRM("couldn't write " << tmpPath);
+        (void) bpf::safeRemove(tmpPath);
+        return false;
+    }
+    try {
+        bfs::rename(tmpPath, m_path);
+    } catch (const bfs::filesystem_error & e) {
+        BPLOG_WARN_STRM("couldn't rename " << tmpPath << " to "
+                        << m_path << ": " << e.what());
+        (void) bpf::safeRemove(tmpPath);
+        return false;
+    }
+#ifndef WIN32
+    // make the rename itself durable
+    (void) syncPath(m_path.parent_path());
+#endif
+
+    m_generation = generation;
+    m_offset = contents.size();
+    m_deadBytes = 0;
+    return true;
+}
+
+
+bool
+bp::KVLog::get(const string & key, string & oVal)
+{
+    bp::sync::Lock lck(m_mutex);
+    if (!m_open || !lock()) return false;
+    bool found = false;
+    if (refresh()) {
+        map<string, string>::const_iterator it = m_data.find(key);
+        if (it != m_data.end()) {
+            oVal = it->second;
+            found = true;
+        }
+    }
+    unlock();
+    return found;
+}
+
+
+bool
+bp::KVLog::set(const string & key, const string & val)
+{
+    bp::sync::Lock lck(m_mutex);
+    if (!m_open || !lock()) return false;
+    bool ok = refresh();
+    if (ok) {
+        map<string, string>::iterator it = m_data.find(key);
+        if (it != m_data.end() && it->second == val) {
+            // nothing to write
+        } else if (append(KVLOG_OP_SET, key, val)) {
+            if (it != m_data.end()) {
+                m_deadBytes += recordSize(it->first, it->second);
+            }
+            m_data[key] = val;
+            maybeCompact();
+        } else {
+            ok = false;
+        }
+    }
+    unlock();
+    return ok;
+}
+
+
+bool
+bp::KVLog::remove(const string & key)
+{
+    bp::sync::Lock lck(m_mutex);
+    if (!m_open || !lock()) return false;
+    bool ok = false;
+    if (refresh()) {
+        map<string, string>::iterator it = m_data.find(key);
+        if (it != m_data.end() && append(KVLOG_OP_REMOVE, key, string())) {
+            m_deadBytes += recordSize(it->first, it->second)
+                + recordSize(key, string());
+            m_data.erase(it);
+            maybeCompact();
+            ok = true;
+        }
+    }
+    unlock();
+    return ok;
+}
+
+
+map<string, string>
+bp::KVLog::entries()
+{
+    bp::sync::Lock lck(m_mutex);
+    map<string, string> rval;
+    if (!m_open || !lock()) return rval;
+    if (refresh()) rval = m_data;
+    unlock();
+    return rval;
+}
+
+
+vector<string>
+bp::KVLog::keys(const string & prefix)
+{
+    bp::sync::Lock lck(m_mutex);
+    vector<string> rval;
+    if (!m_open || !lock()) return rval;
+    if (refresh()) {
+        map<string, string>::const_iterator it;
+        for (it = m_data.lower_bound(prefix);
+             it != m_data.end()
+                 && it->first.compare(0, prefix.size(), prefix) == 0;
+             ++it)
+        {
+            rval.push_back(it->first);
+        }
+    }
+    unlock();
+    return rval;
+}
+
+
+bool
+bp::KVLog::compact()
+{
+    bp::sync::Lock lck(m_mutex);
+    if (!m_open || !lock()) return false;
+    bool ok = refresh() && rewrite();
+    unlock();
+    return ok;
+}
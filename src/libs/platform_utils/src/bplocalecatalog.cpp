@@ -0,0 +1,542 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bplocalecatalog.cpp
+ *  A compiled, memory mapped form of a localized strings file.
+ *
+ *  The catalog is a header followed by three tables and a string pool:
+ *    header: "BPLC" | version | source mtime (hi, lo) | source size |
+ *            locale count | key count | value count
+ *    locales: offset | length                     (sorted)
+ *    keys:    offset | length | first value | value count  (sorted)
+ *    values:  locale index | offset | length      (sorted by locale)
+ *  all fields are big endian u32s, offsets are from the start of the
+ *  catalog.
+ */
+
+#include "api/bplocalecatalog.h"
+#include <cstring>
+#include <ctime>
+#include <set>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
+#include "api/bplocalization.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::tr1;
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+#define CATALOG_MAGIC "BPLC"
+#define CATALOG_VERSION 1
+#define CATALOG_HEADER_SIZE 32
+#define CATALOG_LOCALE_SIZE 8
+#define CATALOG_KEY_SIZE 16
+#define CATALOG_VALUE_SIZE 12
+
+
+static void
+putU32(string & s, unsigned int v)
+{
+    s.push_back((char) ((v >> 24) & 0xFF));
+    s.push_back((char) ((v >> 16) & 0xFF));
+    s.push_back((char) ((v >> 8) & 0xFF));
+    s.push_back((char) (v & 0xFF));
+}
+
+
+static unsigned int
+getU32(const unsigned char * p)
+{
+    return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+        ((unsigned int) p[2] << 8) | (unsigned int) p[3];
+}
+
+
+// compare a string in the catalog with s, as std::string::compare would
+static int
+compareTo(const unsigned char * base, const unsigned char * entry,
+          const string & s)
+{
+    unsigned int off = getU32(entry);
+    unsigned int len = getU32(entry + 4);
+    size_t n = len < s.size() ? len : s.size();
+    int rv = n ? memcmp(base + off, s.data(), n) : 0;
+    if (rv == 0) {
+        if (len < s.size()) rv = -1;
+        else if (len > s.size()) rv = 1;
+    }
+    return rv;
+}
+
+
+typedef map<string, map<string, string> > tStringTable;
+
+// collect "key/locale" strings from a parsed strings file.  the last
+// path component is the locale, everything before it is the key.
+static void
+flatten(const bp::Map * m, const string & prefix, tStringTable & table)
+{
+    bp::Map::Iterator it(*m);
+    const char * k;
+    while ((k = it.nextKey()) != NULL) {
+        const bp::Object * v = m->value(k);
+        if (v->type() == BPTString) {
+            if (!prefix.empty()) table[prefix][k] = string(*v);
+        } else if (v->type() == BPTMap) {
+            flatten((const bp::Map *) v,
+                    prefix.empty() ? string(k) : prefix + "/" + k,
+                    table);
+        }
+    }
+}
+
+
+static bool
+buildImage(const bfs::path & stringsPath, const bpf::FileInfo & info,
+           string & oImage)
+{
+    string json;
+    if (!bp::strutil::loadFromFile(stringsPath, json)) {
+        BPLOG_WARN_STRM("couldn't read " << stringsPath);
+        return false;
+    }
+    string err;
+    bp::Object * obj = bp::Object::fromPlainJsonString(json, &err);
+    if (obj == NULL || obj->type() != BPTMap) {
+        BPLOG_ERROR_STRM(stringsPath << " is not a json map: " << err);
+        delete obj;
+        return false;
+    }
+    tStringTable table;
+    flatten((const bp::Map *) obj, string(), table);
+    delete obj;
+
+    set<string> localeSet;
+    size_t numValues = 0;
+    tStringTable::const_iterator kit;
+    map<string, string>::const_iterator vit;
+    for (kit = table.begin(); kit != table.end(); ++kit) {
+        for (vit = kit->second.begin(); vit != kit->second.end(); ++vit) {
+            localeSet.insert(vit->first);
+            numValues++;
+        }
+    }
+    vector<string> locales(localeSet.begin(), localeSet.end());
+
+    string header(CATALOG_MAGIC);
+    putU32(header, CATALOG_VERSION);
+    putU32(header, (unsigned int) (((boost::uint64_t) info.mtime) >> 32));
+    putU32(header, (unsigned int) info.mtime);
+    putU32(header, (unsigned int) info.sizeInBytes);
+    putU32(header, locales.size());
+    putU32(header, table.size());
+    putU32(header, numValues);
+
+    // strings follow the tables
+    unsigned int poolStart = CATALOG_HEADER_SIZE
+        + locales.size() * CATALOG_LOCALE_SIZE
+        + table.size() * CATALOG_KEY_SIZE
+        + numValues * CATALOG_VALUE_SIZE;
+    string pool;
+    string localeTable, keyTable, valueTable;
+    map<string, unsigned int> localeIndex;
+    for (unsigned int i = 0; i < locales.size(); i++) {
+        localeIndex[locales[i]] = i;
+        putU32(localeTable, poolStart + pool.size());
+        putU32(localeTable, locales[i].size());
+        pool.append(locales[i]);
+    }
+    unsigned int firstValue = 0;
+    for (kit = table.begin(); kit != table.end(); ++kit) {
+        putU32(keyTable, poolStart + pool.size());
+        putU32(keyTable, kit->first.size());
+        putU32(keyTable, firstValue);
+        putU32(keyTable, kit->second.size());
+        pool.append(kit->first);
+        firstValue += kit->second.size();
+
+        // a locale's index orders the same as its name, so values
+        // end up sorted by locale index
+        for (vit = kit->second.begin(); vit != kit->second.end(); ++vit) {
+            putU32(valueTable, localeIndex[vit->first]);
+            putU32(valueTable, poolStart + pool.size());
+            putU32(valueTable, vit->second.size());
+            pool.append(vit->second);
+        }
+    }
+
+    oImage = header + localeTable + keyTable + valueTable + pool;
+    return true;
+}
+
+
+bp::localization::StringCatalog::StringCatalog()
+    : m_checkedAt(0), m_base(NULL), m_size(0), m_mapping(NULL),
+      m_numLocales(0), m_numKeys(0), m_numValues(0)
+{
+}
+
+
+bp::localization::StringCatalog::~StringCatalog()
+{
+    detach();
+}
+
+
+void
+bp::localization::StringCatalog::detach()
+{
+    if (m_mapping != NULL) {
+#ifdef WIN32
+        UnmapViewOfFile(m_mapping);
+#else
+        munmap(m_mapping, m_size);
+#endif
+        m_mapping = NULL;
+    }
+    m_image.clear();
+    m_base = NULL;
+    m_size = 0;
+    m_numLocales = m_numKeys = m_numValues = 0;
+}
+
+
+bfs::path
+bp::localization::StringCatalog::catalogPath(const bfs::path & stringsPath)
+{
+    bfs::path p = stringsPath;
+    p.replace_extension(".catalog");
+    return p;
+}
+
+
+bool
+bp::localization::StringCatalog::compile(const bfs::path & stringsPath,
+                                         const bfs::path & catalogPath)
+{
+    bpf::FileInfo info;
+    string image;
+    if (!bpf::statFile(stringsPath, info)
+        || !buildImage(stringsPath, info, image))
+    {
+        return false;
+    }
+
+    // write aside and rename into place so that readers never map a
+    // partial catalog.  the temp name is unique so that processes
+    // compiling the same catalog don't write over each other.
+    bfs::path tmpPath;
+    try {
+        tmpPath = bpf::getTempPath(catalogPath.parent_path(),
+                                   catalogPath.filename().string());
+    } catch (const bfs::filesystem_error & e) {
+        BPLOG_INFO_STRM("couldn't name a temp file for " << catalogPath
+                        << ": " << e.what());
+        return false;
+    }
+    if (!bp::strutil::storeToFile(tmpPath, image)) {
+        BPLOG_INFO_STRM("couldn't write " << tmpPath);
+        (void) bpf::safeRemove(tmpPath);
+        return false;
+    }
+    try {
+        bfs::rename(tmpPath, catalogPath);
+    } catch (const bfs::filesystem_error & e) {
+        BPLOG_INFO_STRM("couldn't rename " << tmpPath << " to "
+                        << catalogPath << ": " << e.what());
+        (void) bpf::safeRemove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+
+bool
+bp::localization::StringCatalog::attach(const bfs::path & catalogPath)
+{
+#ifdef WIN32
+    HANDLE f = CreateFileW(bpf::nativeString(catalogPath).c_str(),
+                           GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    DWORD size = GetFileSize(f, NULL);
+    HANDLE m = NULL;
+    if (size != INVALID_FILE_SIZE && size >= CATALOG_HEADER_SIZE) {
+        m = CreateFileMappingW(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(f);
+    if (m == NULL) return false;
+    m_mapping = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(m);
+#else
+    int fd = ::open(catalogPath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat s;
+    off_t size = 0;
+    if (fstat(fd, &s) == 0) size = s.st_size;
+    if (size >= CATALOG_HEADER_SIZE) {
+        m_mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m_mapping == MAP_FAILED) m_mapping = NULL;
+    }
+    ::close(fd);
+#endif
+    if (m_mapping == NULL) return false;
+    m_base = (const unsigned char *) m_mapping;
+    m_size = (size_t) size;
+    return validate();
+}
+
+
+bool
+bp::localization::StringCatalog::validate()
+{
+    if (m_size < CATALOG_HEADER_SIZE
+        || memcmp(m_base, CATALOG_MAGIC, 4) != 0
+        || getU32(m_base + 4) != CATALOG_VERSION)
+    {
+        return false;
+    }
+
+    // a catalog for some other version of the strings file is stale
+    boost::uint64_t mtime = ((boost::uint64_t) getU32(m_base + 8) << 32)
+        | getU32(m_base + 12);
+    if (mtime != (boost::uint64_t) m_sourceInfo.mtime
+        || getU32(m_base + 16) != (unsigned int) m_sourceInfo.sizeInBytes)
+    {
+        return false;
+    }
+
+    m_numLocales = getU32(m_base + 20);
+    m_numKeys = getU32(m_base + 24);
+    m_numValues = getU32(m_base + 28);
+    boost::uint64_t tables = CATALOG_HEADER_SIZE
+        + (boost::uint64_t) m_numLocales * CATALOG_LOCALE_SIZE
+        + (boost::uint64_t) m_numKeys * CATALOG_KEY_SIZE
+        + (boost::uint64_t) m_numValues * CATALOG_VALUE_SIZE;
+    if (tables > m_size) return false;
+
+    // check every reference once here so lookups needn't
+    const unsigned char * p = m_base + CATALOG_HEADER_SIZE;
+    for (unsigned int i = 0; i < m_numLocales; i++, p += CATALOG_LOCALE_SIZE) {
+        if ((boost::uint64_t) getU32(p) + getU32(p + 4) > m_size) return false;
+    }
+    for (unsigned int i = 0; i < m_numKeys; i++, p += CATALOG_KEY_SIZE) {
+        if ((boost::uint64_t) getU32(p) + getU32(p + 4) > m_size
+            || (boost::uint64_t) getU32(p + 8) + getU32(p + 12) > m_numValues)
+        {
+            return false;
+        }
+    }
+    for (unsigned int i = 0; i < m_numValues; i++, p += CATALOG_VALUE_SIZE) {
+        if (getU32(p) >= m_numLocales
+            || (boost::uint64_t) getU32(p + 4) + getU32(p + 8) > m_size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+shared_ptr<bp::localization::StringCatalog>
+bp::localization::StringCatalog::get(const bfs::path & stringsPath)
+{
+    typedef map<bfs::path::string_type, shared_ptr<StringCatalog> > tCache;
+    static bp::sync::Mutex s_lock;
+    static tCache s_catalogs;
+
+    bp::sync::Lock lck(s_lock);
+
+    // the common case: a cached catalog which was checked against its
+    // strings file within the last second.  neither stats nor allocates.
+    time_t now = std::time(NULL);
+    tCache::iterator it = s_catalogs.find(stringsPath.native());
+    if (it != s_catalogs.end() && it->second != NULL) {
+        if (it->second->m_checkedAt == now || it->second->upToDate()) {
+            it->second->m_checkedAt = now;
+            return it->second;
+        }
+    }
+
+    // callers holding the old catalog keep it alive until they're done
+    shared_ptr<StringCatalog> & entry = s_catalogs[stringsPath.native()];
+    entry.reset();
+    shared_ptr<StringCatalog> c(new StringCatalog);
+    c->m_stringsPath = stringsPath;
+    c->m_checkedAt = now;
+    if (!bpf::statFile(stringsPath, c->m_sourceInfo)) {
+        return entry;
+    }
+
+    bfs::path cPath = catalogPath(stringsPath);
+    if (!c->attach(cPath)) {
+        c->detach();
+        if (!compile(stringsPath, cPath) || !c->attach(cPath)) {
+            // a read only install, serve from memory
+            c->detach();
+            if (!buildImage(stringsPath, c->m_sourceInfo, c->m_image)) {
+                return entry;
+            }
+            c->m_base = (const unsigned char *) c->m_image.data();
+            c->m_size = c->m_image.size();
+            if (!c->validate()) {
+                BPLOG_ERROR_STRM("compiled catalog for " << stringsPath
+                                 << " is invalid");
+                return entry;
+            }
+        }
+    }
+    entry = c;
+    return entry;
+}
+
+
+bool
+bp::localization::StringCatalog::upToDate() const
+{
+    bpf::FileInfo info;
+    return bpf::statFile(m_stringsPath, info)
+        && info.mtime == m_sourceInfo.mtime
+        && info.sizeInBytes == m_sourceInfo.sizeInBytes;
+}
+
+
+int
+bp::localization::StringCatalog::findKey(const string & key) const
+{
+    const unsigned char * table = m_base + CATALOG_HEADER_SIZE
+        + m_numLocales * CATALOG_LOCALE_SIZE;
+    int lo = 0, hi = (int) m_numKeys - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = compareTo(m_base, table + mid * CATALOG_KEY_SIZE, key);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+
+int
+bp::localization::StringCatalog::findLocale(const string & locale) const
+{
+    const unsigned char * table = m_base + CATALOG_HEADER_SIZE;
+    int lo = 0, hi = (int) m_numLocales - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = compareTo(m_base, table + mid * CATALOG_LOCALE_SIZE, locale);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+
+const vector<unsigned int> &
+bp::localization::StringCatalog::fallbackChain(const string & locale)
+{
+    bp::sync::Lock lck(m_chainsLock);
+    map<string, vector<unsigned int> >::iterator it = m_chains.find(locale);
+    if (it != m_chains.end()) return it->second;
+
+    // resolve candidates to locales this catalog actually has
+    vector<unsigned int> & chain = m_chains[locale];
+    vector<string> candidates = getLocaleCandidates(locale);
+    for (unsigned int i = 0; i < candidates.size(); i++) {
+        int ix = findLocale(candidates[i]);
+        if (ix >= 0) chain.push_back((unsigned int) ix);
+    }
+    return chain;
+}
+
+
+bool
+bp::localization::StringCatalog::lookup(const string & key,
+                                        const string & locale,
+                                        string & oVal)
+{
+    int k = findKey(key);
+    if (k < 0) return false;
+    const vector<unsigned int> & chain = fallbackChain(locale);
+
+    const unsigned char * ke = m_base + CATALOG_HEADER_SIZE
+        + m_numLocales * CATALOG_LOCALE_SIZE + k * CATALOG_KEY_SIZE;
+    const unsigned char * values = m_base + CATALOG_HEADER_SIZE
+        + m_numLocales * CATALOG_LOCALE_SIZE
+        + m_numKeys * CATALOG_KEY_SIZE
+        + getU32(ke + 8) * CATALOG_VALUE_SIZE;
+    unsigned int numValues = getU32(ke + 12);
+
+    for (unsigned int i = 0; i < chain.size(); i++) {
+        for (unsigned int j = 0; j < numValues; j++) {
+            const unsigned char * v = values + j * CATALOG_VALUE_SIZE;
+            unsigned int l = getU32(v);
+            if (l > chain[i]) break;
+            if (l == chain[i]) {
+                oVal.assign((const char *) m_base + getU32(v + 4),
+                            getU32(v + 8));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+map<string, string>
+bp::localization::StringCatalog::localizations(const string & key) const
+{
+    map<string, string> rval;
+    int k = findKey(key);
+    if (k < 0) return rval;
+
+    const unsigned char * locales = m_base + CATALOG_HEADER_SIZE;
+    const unsigned char * ke = locales
+        + m_numLocales * CATALOG_LOCALE_SIZE + k * CATALOG_KEY_SIZE;
+    const unsigned char * values = locales
+        + m_numLocales * CATALOG_LOCALE_SIZE
+        + m_numKeys * CATALOG_KEY_SIZE
+        + getU32(ke + 8) * CATALOG_VALUE_SIZE;
+    unsigned int numValues = getU32(ke + 12);
+
+    for (unsigned int j = 0; j < numValues; j++) {
+        const unsigned char * v = values + j * CATALOG_VALUE_SIZE;
+        const unsigned char * l = locales + getU32(v) * CATALOG_LOCALE_SIZE;
+        rval[string((const char *) m_base + getU32(l), getU32(l + 4))] =
+            string((const char *) m_base + getU32(v + 4), getU32(v + 8));
+    }
+    return rval;
+}
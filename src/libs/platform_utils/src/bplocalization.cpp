@@ -30,13 +30,14 @@
 
 #include "bplocalization.h"
 #include <stdlib.h>
-#include "bpconfig.h"
+#include "bplocalecatalog.h"
 #include "BPUtils/bpfile.h"
 #include "BPUtils/bpsemanticversion.h"
 #include "ProductPaths.h"
 
 
 using namespace std;
+using std::tr1::shared_ptr;
 
 #ifdef WIN32
 #include <windows.h>
@@ -333,15 +334,10 @@ bp::localization::getLocalizedString(const string& key,
                                      string& outVal,
                                      const boost::filesystem::path& stringsPath)
 {
-    bool found = false;
-    bp::config::ConfigReader reader;
-    if (reader.load(stringsPath)) {
-        vector<string> locales = getLocaleCandidates(locale);
-        for (unsigned int i = 0; i < locales.size() && !found; ++i) {
-            std::string newKey = key + "/" + locales[i];
-            found = reader.getStringValue(newKey, outVal);
-        }
-    }
+    // lookups are served from a compiled catalog rather than parsing
+    // the strings file each time
+    shared_ptr<StringCatalog> catalog = StringCatalog::get(stringsPath);
+    bool found = catalog != NULL && catalog->lookup(key, locale, outVal);
     if (!found) {
         outVal = key;
     }
@@ -354,18 +350,9 @@ bp::localization::getLocalizations(const std::string& key)
     std::map<std::string, std::string> rMap;
 
     boost::filesystem::path path = bp::paths::getLocalizedStringsPath();
-    bp::config::ConfigReader reader;
-    const bp::Map * m;
-    if (reader.load(path) && reader.getJsonMap(key, m))
-    {
-        bp::Map::Iterator i(*m);
-        const char * l;
-        while (NULL != (l = i.nextKey())) {
-            std::string v;
-            if (m->getString(l, v)) {
-                rMap[l] = v;
-            }
-        }
+    shared_ptr<StringCatalog> catalog = StringCatalog::get(path);
+    if (catalog != NULL) {
+        rMap = catalog->localizations(key);
     }
 
     return rMap;
@@ -0,0 +1,203 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ *  bpobjectstore.cpp
+ *  A content addressed store of file contents shared by installed
+ *  services.
+ */
+
+#include "api/bpobjectstore.h"
+#include <vector>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpsha256.h"
+
+using namespace std;
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+// suffix of the temporary link which replaces an adopted file
+#define LINK_TMP_SUFFIX ".bpobj"
+
+
+bp::ObjectStore::ObjectStore(const bfs::path & dir)
+    : m_dir(dir), m_shared(0), m_added(0)
+{
+}
+
+
+bp::ObjectStore::~ObjectStore()
+{
+}
+
+
+bfs::path
+bp::ObjectStore::blobPath(const string & hash,
+                          bool executable) const
+{
+    // fan out on the first byte of the hash to keep directories small.
+    // hard links share permissions, so executables get their own blobs.
+    string name = hash;
+    if (executable) name.append(".x");
+    return m_dir / hash.substr(0, 2) / name;
+}
+
+
+bool
+bp::ObjectStore::adopt(const bfs::path & tree,
+                       string & oError)
+{
+    m_shared = m_added = 0;
+    oError.clear();
+
+    if (!bpf::isDirectory(tree)) {
+        oError = "no such directory: " + tree.string();
+        return false;
+    }
+
+    // gather files first, we'll be replacing them as we go
+    vector<bfs::path> files;
+    try {
+        bfs::create_directories(m_dir);
+        bfs::recursive_directory_iterator end;
+        for (bfs::recursive_directory_iterator it(tree); it != end; ++it) {
+            if (bfs::is_symlink(it->symlink_status())) continue;
+            if (bfs::is_regular_file(it->status())) {
+                files.push_back(it->path());
+            }
+        }
+    } catch (const bfs::filesystem_error& e) {
+        oError = string("unable to scan ") + tree.string() + ": " + e.what();
+        return false;
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!adoptFile(files[i])) {
+            BPLOG_DEBUG_STRM("leaving " << files[i] << " unshared");
+        }
+    }
+
+    BPLOG_INFO_STRM("adopted " << tree << ": " << files.size()
+                    << " files, " << m_shared << " shared, "
+                    << m_added << " new blobs");
+    return true;
+}
+
+
+bool
+bp::ObjectStore::adoptFile(const bfs::path & file)
+{
+    bpf::FileInfo fi;
+    if (!bpf::statFile(file, fi)) return false;
+
+    string hash = bp::sha256::hashFile(file);
+    if (hash.empty()) return false;
+    bfs::path blob = blobPath(hash, (fi.mode & 0111) != 0);
+
+    bool added = false;
+    if (!bpf::isRegularFile(blob)) {
+        // first copy of these contents.  the blob gets an inode of its
+        // own, made read-only before anything links to it, and is then
+        // linked over the file like any later copy would be
+        try {
+            bfs::create_directories(blob.parent_path());
+        } catch (const bfs::filesystem_error& e) {
+            BPLOG_WARN_STRM("unable to create " << blob.parent_path()
+                            << ": " << e.what());
+            return false;
+        }
+        bfs::path tmp = bpf::getTempPath(blob.parent_path(), "bpobj");
+        if (!bpf::safeCopy(file, tmp) || !bpf::makeReadOnly(tmp)) {
+            (void) bpf::safeRemove(tmp);
+            return false;
+        }
+        // linking fails if another adopter got there first, in which
+        // case we use theirs
+        added = bpf::createHardLink(blob, tmp);
+        (void) bpf::safeRemove(tmp);
+        if (!bpf::isRegularFile(blob)) return false;
+    }
+
+    bpf::FileInfo bi;
+    if (!bpf::statFile(blob, bi)) return false;
+    if (bi.fileIdHigh == fi.fileIdHigh && bi.fileIdLow == fi.fileIdLow
+        && bi.deviceId == fi.deviceId)
+    {
+        // already linked
+        return true;
+    }
+    if (bi.sizeInBytes != fi.sizeInBytes) {
+        BPLOG_WARN_STRM("blob " << blob << " size mismatch, ignoring");
+        return false;
+    }
+
+    // link the blob in beside the file, then rename over it so
+    // the file is never missing
+    bfs::path tmp = file.parent_path()
+        / (file.filename().string() + LINK_TMP_SUFFIX);
+    (void) bpf::safeRemove(tmp);
+    if (!bpf::createHardLink(tmp, blob)) return false;
+    try {
+        bfs::rename(tmp, file);
+    } catch (const bfs::filesystem_error& e) {
+        BPLOG_WARN_STRM("unable to replace " << file << ": " << e.what());
+        (void) bpf::safeRemove(tmp);
+        return false;
+    }
+    if (added) m_added++;
+    else m_shared++;
+    return true;
+}
+
+
+unsigned int
+bp::ObjectStore::collectGarbage()
+{
+    if (!bpf::isDirectory(m_dir)) return 0;
+
+    unsigned int removed = 0;
+    try {
+        bfs::directory_iterator end;
+        for (bfs::directory_iterator d(m_dir); d != end; ++d) {
+            if (!bpf::isDirectory(d->path())) continue;
+            vector<bfs::path> garbage;
+            for (bfs::directory_iterator it(d->path()); it != end; ++it) {
+                bpf::FileInfo fi;
+                if (bpf::statFile(it->path(), fi) && fi.linkCount <= 1) {
+                    garbage.push_back(it->path());
+                }
+            }
+            for (size_t i = 0; i < garbage.size(); i++) {
+                if (bpf::safeRemove(garbage[i])) removed++;
+            }
+            if (bfs::is_empty(d->path())) {
+                (void) bpf::safeRemove(d->path());
+            }
+        }
+    } catch (const bfs::filesystem_error& e) {
+        BPLOG_WARN_STRM("unable to scan " << m_dir << ": " << e.what());
+    }
+
+    BPLOG_INFO_STRM("removed " << removed << " unreferenced blobs from "
+                    << m_dir);
+    return removed;
+}
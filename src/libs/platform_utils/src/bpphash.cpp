@@ -30,106 +30,50 @@
 
 #include "bpphash.h"
 
-#include <string>
-#include <iostream>
-
-#include "bpconfig.h"
-#include "BPUtils/bpfile.h"
-#include "BPUtils/bpstrutil.h"
-#include "BPUtils/bptime.h"
-#include "BPUtils/bptypeutil.h"
+#include "bpkvlog.h"
+#include "BPUtils/bpsync.h"
 #include "ProductPaths.h"
 
 
-class PHashConfigReader : public bp::config::ConfigReader 
-{
-public:
-    bool setStringValue(const std::string& sKey,
-                        const std::string& sValue)
-    {
-        if (m_pConfigMap == NULL) {
-            m_pConfigMap = new bp::Map;
-        }
-        m_pConfigMap->add(sKey, new bp::String(sValue));
-        return true;
-    }
-    
-    void removeStringValue(const std::string& sKey)
-    {
-        if (m_pConfigMap) {
-            m_pConfigMap->kill(sKey.c_str());
-        }
-    }
-
-    std::string toString()
-    {
-        std::string s;
-        if (m_pConfigMap) s = m_pConfigMap->toPlainJsonString(true);
-        return s;
-    }
-};
-
-static PHashConfigReader s_cache;
-static boost::filesystem::path s_phashPath;
-static BPTime s_lastRead = 0L;
+// state used to be a JSON map rewritten on every write, it's now an
+// append-only log.  the old file is imported the first time through.
+static bp::KVLog s_log;
+static boost::filesystem::path s_legacyPath;
+static bool s_opened = false;
+static bp::sync::Mutex s_openLock;
 
 static bool
-updateCache()
+openLog()
 {
-    if (s_phashPath.empty()) {
-        s_phashPath = bp::paths::getPersistentStatePath();
-        if (s_phashPath.empty()) return false;
-    }
-
-    BPTime modTime((long)0);
-    try {
-        modTime.set(boost::filesystem::last_write_time(s_phashPath));
-    } catch (const boost::filesystem::filesystem_error&) {
-        // empty
-    }
-
-    // if modTime == 0 it means the file doesn't exist
-    if (modTime.compare(s_lastRead) > 0) {
-        // slurp it up and parse it
-        if (s_cache.load(s_phashPath)) {
-            s_lastRead.set(modTime);
-        } else {
-            return false;
-        }
+    bp::sync::Lock lck(s_openLock);
+    // follow the product directory should it move (as it does between
+    // tests)
+    boost::filesystem::path legacyPath = bp::paths::getPersistentStatePath();
+    if (legacyPath.empty()) return false;
+    if (!s_opened || legacyPath != s_legacyPath) {
+        s_legacyPath = legacyPath;
+        boost::filesystem::path logPath = legacyPath;
+        logPath.replace_extension(".kv");
+        s_opened = s_log.open(logPath, legacyPath);
     }
-    return true;
+    return s_opened;
 }
 
 bool
 bp::phash::get(const std::string & key, std::string & outVal)
 {
-    return (updateCache() && s_cache.getStringValue(key, outVal));
+    return (openLog() && s_log.get(key, outVal));
 }
 
 bool
 bp::phash::set(const std::string & key, const std::string& val)
 {
-    // update cache may fail if the file does not exist yet.
-    updateCache();
-
-    if (!s_cache.setStringValue(key, val)) return false;
-
-    std::string s = s_cache.toString();
-
-    if (!bp::strutil::storeToFile(s_phashPath, s)) {
-        return false;
-    }
-    
-    return true;
+    return (openLog() && s_log.set(key, val));
 }
 
 
 void
 bp::phash::remove(const std::string & key)
 {
-    std::string val;
-    if (get(key, val)) {
-        s_cache.removeStringValue(key);
-        (void) bp::strutil::storeToFile(s_phashPath, s_cache.toString());
-    }
+    if (openLog()) (void) s_log.remove(key);
 }
@@ -33,19 +33,22 @@
 #include <sstream>
 #include "BPUtils/bpfile.h"
 #include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
 #include "BPUtils/bpurl.h"
 
 
+// the collection's keys: one per url, and its comparison mode
+#define URL_KEY_PREFIX "url:"
+#define USE_DOMAIN_KEY "option:UseDomainForHTTP"
+
+
 bp::URLCollection::URLCollection()
-    : m_useDomainForHTTP(false), m_data(NULL), m_list(NULL)
+    : m_useDomainForHTTP(false), m_open(false)
 {
 }
 
 bp::URLCollection::~URLCollection()
 {
-    if (m_data != NULL) delete m_data;
-    m_data = NULL;
-    m_list = NULL;
 }
 
 bool
@@ -53,85 +56,90 @@ bp::URLCollection::init(const boost::filesystem::path & path,
                         bool useDomainForHTTP)
 {
     m_path = path;
+    m_open = false;
 
-    if (boost::filesystem::is_regular_file(m_path)) {
-        // attempt to read
-        std::string s;
-        if (bp::strutil::loadFromFile(m_path, s)) {
-            bp::Object * o = bp::Object::fromPlainJsonString(s);
-            if (o != NULL) {
-                if (o->type() == BPTMap) {
-                    m_data = (bp::Map *) o;
-                } else {
-                    delete o;
-                }
-            }
-            
-            if (m_data) {
-                // validate
-                if (!m_data->has("urls", BPTList) ||
-                    !m_data->has("UseDomainForHTTP", BPTBoolean))
-                {
-                    delete m_data;
-                    m_data = NULL;
-                }
-                else 
-                {
-                    m_useDomainForHTTP =
-                        ((bp::Bool *) m_data->get("UseDomainForHTTP"))->value();
-                    m_list = (bp::List *) m_data->get("urls");
-                }
-            }
-        }
+    boost::filesystem::path logPath = path;
+    logPath.replace_extension(".kv");
+
+    // earlier versions rewrote a JSON document at path on every add,
+    // import it the first time through
+    std::vector<std::string> legacyUrls;
+    bool legacy = false;
+    if (!bp::file::pathExists(logPath)
+        && boost::filesystem::is_regular_file(m_path))
+    {
+        if (!loadLegacy(legacyUrls, useDomainForHTTP)) return false;
+        legacy = true;
+    }
+
+    if (!m_log.open(logPath)) return false;
+
+    std::string useDomain;
+    if (m_log.get(USE_DOMAIN_KEY, useDomain)) {
+        m_useDomainForHTTP = !useDomain.compare("true");
     } else {
-        // attempt to write
-        m_data = new bp::Map;
-        m_list = new bp::List;
-        m_data->add("UseDomainForHTTP", new bp::Bool(useDomainForHTTP));
-        m_data->add("urls", m_list);
-
-        // now attempt to write to disk
-        if (!writeToDisk()) {
-            delete m_data;
-            m_data = NULL;
-            m_list = NULL;
-        }
         m_useDomainForHTTP = useDomainForHTTP;
+        if (!m_log.set(USE_DOMAIN_KEY, useDomainForHTTP ? "true" : "false")) {
+            return false;
+        }
     }
 
-    return m_data != NULL;
+    if (legacy) {
+        for (unsigned int i = 0; i < legacyUrls.size(); i++) {
+            if (!m_log.set(URL_KEY_PREFIX + legacyUrls[i], std::string())) {
+                return false;
+            }
+        }
+        (void) bp::file::safeRemove(m_path);
+    }
+
+    m_open = true;
+    return true;
 }
 
 
 bool
-bp::URLCollection::has(const std::string & inUrl)
+bp::URLCollection::loadLegacy(std::vector<std::string> & oUrls,
+                              bool & oUseDomainForHTTP)
 {
-    if (m_data == NULL || m_list == NULL) return false;
-
-    std::string url = normalizeURL(inUrl);
-    
-    for (unsigned int i = 0; i < m_list->size(); i++) 
-    {
-        bp::String * disObj = (bp::String *) m_list->value(i);
-        if (disObj && !url.compare(disObj->value()))
-            return true;
+    std::string s;
+    if (!bp::strutil::loadFromFile(m_path, s)) return false;
+
+    bp::Object * o = bp::Object::fromPlainJsonString(s);
+    bool ok = (o != NULL && o->type() == BPTMap
+               && o->has("urls", BPTList)
+               && o->has("UseDomainForHTTP", BPTBoolean));
+    if (ok) {
+        oUseDomainForHTTP = ((bp::Bool *) o->get("UseDomainForHTTP"))->value();
+        const bp::List * l = (const bp::List *) o->get("urls");
+        for (unsigned int i = 0; i < l->size(); i++) {
+            const bp::Object * u = l->value(i);
+            if (u != NULL && u->type() == BPTString) {
+                oUrls.push_back(std::string(*u));
+            }
+        }
     }
+    delete o;
+    return ok;
+}
 
-    return false;
+
+bool
+bp::URLCollection::has(const std::string & inUrl)
+{
+    if (!m_open) return false;
+
+    std::string val;
+    return m_log.get(URL_KEY_PREFIX + normalizeURL(inUrl), val);
 }
 
 bool
 bp::URLCollection::add(const std::string & inUrl)
 {
-    if (m_data == NULL || m_list == NULL) return false;    
-
-    if (!has(inUrl)) {
-        std::string url = normalizeURL(inUrl);        
-        m_list->append(new bp::String(url));
-        if (!writeToDisk()) return false;
-    }
+    if (!m_open) return false;    
 
-    return true;
+    // a url already present writes nothing
+    return m_log.set(URL_KEY_PREFIX + normalizeURL(inUrl), std::string());
 }
 
 std::string
@@ -153,12 +161,3 @@ bp::URLCollection::normalizeURL(const std::string & url)
     return url;
 }
 
-
-bool
-bp::URLCollection::writeToDisk()
-{
-    if (m_data == NULL || m_list == NULL) return false;    
-    std::string s = m_data->toPlainJsonString(true);
-    return bp::strutil::storeToFile(m_path, s);
-}
-   
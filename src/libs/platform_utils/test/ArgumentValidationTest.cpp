@@ -0,0 +1,195 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "ArgumentValidationTest.h"
+#include <sstream>
+#include "platform_utils/ServiceDescription.h"
+
+using bp::service::Argument;
+using bp::service::Function;
+using bp::service::validateArguments;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ArgumentValidationTest);
+
+static Argument
+arg(const char * name, Argument::Type type, bool required)
+{
+    Argument a(name, type);
+    a.setRequired(required);
+    return a;
+}
+
+static Function
+function(const char * name, const std::list<Argument> & args)
+{
+    Function f;
+    f.setName(name);
+    f.setArguments(args);
+    return f;
+}
+
+// a function of n arguments cycling through the common types, every
+// other one required, and a call supplying all of them
+static Function
+wideFunction(unsigned int n, bp::Map & call)
+{
+    std::list<Argument> args;
+    for (unsigned int i = 0; i < n; i++) {
+        std::stringstream ss;
+        ss << "arg" << i;
+        switch (i % 4) {
+            case 0:
+                args.push_back(arg(ss.str().c_str(), Argument::String,
+                                   i % 2 == 0));
+                call.add(ss.str(), new bp::String("value"));
+                break;
+            case 1:
+                args.push_back(arg(ss.str().c_str(), Argument::Integer,
+                                   i % 2 == 0));
+                call.add(ss.str(), new bp::Integer(i));
+                break;
+            case 2:
+                args.push_back(arg(ss.str().c_str(), Argument::Boolean,
+                                   i % 2 == 0));
+                call.add(ss.str(), new bp::Bool(true));
+                break;
+            case 3:
+                args.push_back(arg(ss.str().c_str(), Argument::Any,
+                                   i % 2 == 0));
+                call.add(ss.str(), new bp::Double(1.5));
+                break;
+        }
+    }
+    return function("wide", args);
+}
+
+void
+ArgumentValidationTest::acceptsAndConverts()
+{
+    std::list<Argument> args;
+    args.push_back(arg("size", Argument::Integer, true));
+    args.push_back(arg("ratio", Argument::Double, false));
+    args.push_back(arg("what", Argument::Any, false));
+    args.push_back(arg("cb", Argument::CallBack, false));
+    Function f = function("scale", args);
+
+    bp::Map m;
+    m.add("ratio", new bp::Integer(2));
+    m.add("size", new bp::Double(9.6));
+    m.add("what", new bp::Null);
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(f, &m));
+
+    // integers and doubles are converted in place, keeping key order
+    CPPUNIT_ASSERT(m.has("size", BPTInteger));
+    CPPUNIT_ASSERT_EQUAL((long long) 10, (long long) *(m.get("size")));
+    CPPUNIT_ASSERT(m.has("ratio", BPTDouble));
+    bp::Map::Iterator it(m);
+    CPPUNIT_ASSERT(it.value() == NULL);
+    CPPUNIT_ASSERT_EQUAL(std::string("ratio"), std::string(it.nextKey()));
+    CPPUNIT_ASSERT(it.value() == m.value("ratio"));
+    CPPUNIT_ASSERT_EQUAL(std::string("size"), std::string(it.nextKey()));
+
+    // a function without arguments takes none
+    Function none = function("ping", std::list<Argument>());
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(none, NULL));
+    bp::Map empty;
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(none, &empty));
+}
+
+void
+ArgumentValidationTest::rejects()
+{
+    std::list<Argument> args;
+    args.push_back(arg("file", Argument::Path, true));
+    args.push_back(arg("mode", Argument::String, true));
+    args.push_back(arg("count", Argument::Integer, false));
+    Function f = function("open", args);
+
+    bp::Map unknown;
+    unknown.add("file", new bp::Path(boost::filesystem::path("/tmp/x")));
+    unknown.add("bogus", new bp::Integer(1));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("argument 'bogus' not supported by function 'open'"),
+        validateArguments(f, &unknown));
+
+    bp::Map mistyped;
+    mistyped.add("mode", new bp::Bool(false));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("argument 'mode' should be of type string, "
+                    "but is of type boolean"),
+        validateArguments(f, &mistyped));
+
+    // missing arguments are reported in declaration order
+    bp::Map missing;
+    missing.add("count", new bp::Integer(3));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("call to 'open' requires a 'file' argument"),
+        validateArguments(f, &missing));
+    missing.add("file", new bp::Path(boost::filesystem::path("/tmp/x")));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("call to 'open' requires a 'mode' argument"),
+        validateArguments(f, &missing));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("call to 'open' requires a 'file' argument"),
+        validateArguments(f, NULL));
+}
+
+void
+ArgumentValidationTest::copiesShareArguments()
+{
+    std::list<Argument> args;
+    args.push_back(arg("a", Argument::String, true));
+    Function f = function("f", args);
+    Function g(f);
+    Function h;
+    h = f;
+
+    // re-declaring f's arguments leaves its copies as they were
+    std::list<Argument> other;
+    other.push_back(arg("b", Argument::Integer, true));
+    f.setArguments(other);
+
+    bp::Map m;
+    m.add("a", new bp::String("x"));
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(g, &m));
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(h, &m));
+    CPPUNIT_ASSERT(!validateArguments(f, &m).empty());
+
+    f.clear();
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(f, NULL));
+}
+
+void
+ArgumentValidationTest::wideCall()
+{
+    bp::Map call;
+    Function f = wideFunction(100, call);
+    CPPUNIT_ASSERT_EQUAL(std::string(), validateArguments(f, &call));
+
+    // a call which stops short misses arg98, the last required
+    bp::Map partial;
+    (void) wideFunction(98, partial);
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("call to 'wide' requires a 'arg98' argument"),
+        validateArguments(f, &partial));
+}
@@ -0,0 +1,184 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "KVLogTest.h"
+#include <fstream>
+#include "BPUtils/bpfile.h"
+#include "platform_utils/bpkvlog.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(KVLogTest);
+
+void
+KVLogTest::basics()
+{
+    std::string v;
+    {
+        bp::KVLog log;
+        CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+        CPPUNIT_ASSERT(!log.get("a", v));
+        CPPUNIT_ASSERT(log.set("a", "1"));
+        CPPUNIT_ASSERT(log.set("b", "2"));
+        CPPUNIT_ASSERT(log.set("a", "3"));
+        CPPUNIT_ASSERT(log.remove("b"));
+        CPPUNIT_ASSERT(!log.remove("b"));
+        CPPUNIT_ASSERT(log.set("empty", ""));
+    }
+
+    // everything survives a reopen
+    bp::KVLog log;
+    CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+    CPPUNIT_ASSERT(log.get("a", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("3"), v);
+    CPPUNIT_ASSERT(!log.get("b", v));
+    CPPUNIT_ASSERT(log.get("empty", v));
+    CPPUNIT_ASSERT(v.empty());
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, log.entries().size());
+
+    // keys by prefix
+    CPPUNIT_ASSERT(log.set("svc/1/x", "a"));
+    CPPUNIT_ASSERT(log.set("svc/1/y", "b"));
+    CPPUNIT_ASSERT(log.set("svc/10/z", "c"));
+    std::vector<std::string> keys = log.keys("svc/1/");
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, keys.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("svc/1/x"), keys[0]);
+    CPPUNIT_ASSERT_EQUAL(std::string("svc/1/y"), keys[1]);
+    CPPUNIT_ASSERT_EQUAL((size_t) 5, log.keys("").size());
+}
+
+void
+KVLogTest::sharing()
+{
+    // two instances stand in for two processes
+    bp::KVLog a, b;
+    CPPUNIT_ASSERT(a.open(m_path / "test.kv"));
+    CPPUNIT_ASSERT(b.open(m_path / "test.kv"));
+
+    std::string v;
+    CPPUNIT_ASSERT(a.set("k", "from a"));
+    CPPUNIT_ASSERT(b.get("k", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("from a"), v);
+
+    // compaction by one is noticed by the other
+    CPPUNIT_ASSERT(b.set("k", "from b"));
+    CPPUNIT_ASSERT(b.compact());
+    CPPUNIT_ASSERT(a.get("k", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("from b"), v);
+    CPPUNIT_ASSERT(a.set("k2", "after compaction"));
+    CPPUNIT_ASSERT(b.get("k2", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("after compaction"), v);
+}
+
+void
+KVLogTest::tornTail()
+{
+    {
+        bp::KVLog log;
+        CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+        CPPUNIT_ASSERT(log.set("a", "1"));
+        CPPUNIT_ASSERT(log.set("b", "2"));
+    }
+
+    // simulate a crash midway through appending a record
+    {
+        std::ofstream out;
+        CPPUNIT_ASSERT(bpf::openWritableStream(out, m_path / "test.kv",
+                                               std::ios::binary |
+                                               std::ios::app));
+        out.write("\x01\x00\x00\x00\x05par", 8);
+    }
+
+    bp::KVLog log;
+    CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+    std::string v;
+    CPPUNIT_ASSERT(log.get("a", v));
+    CPPUNIT_ASSERT(log.get("b", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("2"), v);
+
+    // and the log is writable afterwards
+    CPPUNIT_ASSERT(log.set("c", "3"));
+    bp::KVLog other;
+    CPPUNIT_ASSERT(other.open(m_path / "test.kv"));
+    CPPUNIT_ASSERT(other.get("c", v));
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, other.entries().size());
+}
+
+void
+KVLogTest::oversizeRecord()
+{
+    {
+        bp::KVLog log;
+        CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+        CPPUNIT_ASSERT(log.set("a", "1"));
+    }
+
+    // a corrupt record whose lengths claim far more than the file holds
+    // must be treated as a torn tail, not allocated
+    {
+        std::ofstream out;
+        CPPUNIT_ASSERT(bpf::openWritableStream(out, m_path / "test.kv",
+                                               std::ios::binary |
+                                               std::ios::app));
+        out.write("\x01\xff\xff\xff\xf0\x7f\xff\xff\xff" "ab", 11);
+    }
+
+    bp::KVLog log;
+    CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+    std::string v;
+    CPPUNIT_ASSERT(log.get("a", v));
+    CPPUNIT_ASSERT_EQUAL(std::string("1"), v);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, log.entries().size());
+    CPPUNIT_ASSERT(log.set("b", "2"));
+}
+
+void
+KVLogTest::compaction()
+{
+    bp::KVLog log;
+    CPPUNIT_ASSERT(log.open(m_path / "test.kv"));
+    std::string big(1000, 'x');
+    for (unsigned int i = 0; i < 1000; i++) {
+        CPPUNIT_ASSERT(log.set("hot", big + (char) ('a' + i % 26)));
+    }
+    // a million bytes were written, garbage must have been collected
+    CPPUNIT_ASSERT(log.logSize() < 200 * 1024);
+    std::string v;
+    CPPUNIT_ASSERT(log.get("hot", v));
+    CPPUNIT_ASSERT_EQUAL(big + (char) ('a' + 999 % 26), v);
+}
+
+void 
+KVLogTest::setUp()
+{
+	m_path = bpf::getTempPath(bpf::getTempDirectory(), "KVLogTest");
+    bfs::create_directories(m_path);
+}
+
+
+void 
+KVLogTest::tearDown()
+{
+    CPPUNIT_ASSERT(bpf::safeRemove(m_path));
+}
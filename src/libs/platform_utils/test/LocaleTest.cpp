@@ -23,6 +23,9 @@
 #include "LocaleTest.h"
 #include <iostream>
 #include <sstream>
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptime.h"
+#include "platform_utils/bplocalecatalog.h"
 #include "platform_utils/bplocalization.h"
 
 
@@ -66,14 +69,57 @@ LocaleTest::parseTest()
 }
 
 
+void
+LocaleTest::catalogTest()
+{
+    namespace bpl = bp::localization;
+    boost::filesystem::path p = m_path / "strings.json";
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(p,
+        "{\"yes\":{\"en\":\"Yes\",\"de\":\"Ja\",\"fr-CA\":\"Oui\"},"
+        "\"dialog\":{\"title\":{\"en\":\"Title\"}}}"));
+
+    // lookups fall back through the locale candidates
+    string v;
+    CPPUNIT_ASSERT(bpl::getLocalizedString("yes", "de-DE", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("Ja"), v);
+    CPPUNIT_ASSERT(bpl::getLocalizedString("yes", "fr_CA.UTF-8", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("Oui"), v);
+    CPPUNIT_ASSERT(bpl::getLocalizedString("yes", "ja-JP", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("Yes"), v);
+    CPPUNIT_ASSERT(bpl::getLocalizedString("dialog/title", "de", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("Title"), v);
+    CPPUNIT_ASSERT(!bpl::getLocalizedString("no", "en", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("no"), v);
+
+    // the compiled catalog sits next to the strings
+    CPPUNIT_ASSERT(bp::file::pathExists(bpl::StringCatalog::catalogPath(p)));
+    std::tr1::shared_ptr<bpl::StringCatalog> c = bpl::StringCatalog::get(p);
+    CPPUNIT_ASSERT(c != NULL);
+    std::map<string, string> all = c->localizations("yes");
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, all.size());
+    CPPUNIT_ASSERT_EQUAL(string("Oui"), all["fr-CA"]);
+
+    // changing the strings invalidates the catalog, which is noticed
+    // once the last check is more than a second old
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(p,
+        "{\"yes\":{\"en\":\"Yep\"}}"));
+    CPPUNIT_ASSERT(!c->upToDate());
+    bp::time::sleepSec(1.1);
+    CPPUNIT_ASSERT(bpl::getLocalizedString("yes", "de", v, p));
+    CPPUNIT_ASSERT_EQUAL(string("Yep"), v);
+}
+
+
 void 
 LocaleTest::setUp()
 {
-    // empty
+    m_path = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                   "LocaleTest");
+    boost::filesystem::create_directories(m_path);
 }
 
 void
 LocaleTest::tearDown()
 {
-    // empty
+    CPPUNIT_ASSERT(bp::file::safeRemove(m_path));
 }
@@ -36,11 +36,13 @@
 
 #include <vector>
 #include <string>
+#include "BPUtils/bpfile.h"
 
 class LocaleTest : public CPPUNIT_NS::TestCase
 {
     CPPUNIT_TEST_SUITE(LocaleTest);
     CPPUNIT_TEST(parseTest);
+    CPPUNIT_TEST(catalogTest);
     CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -49,6 +51,10 @@ class LocaleTest : public CPPUNIT_NS::TestCase
     
   protected:
     void parseTest();
+    void catalogTest();
+
+  private:
+    boost::filesystem::path m_path;
 };
 
 #endif
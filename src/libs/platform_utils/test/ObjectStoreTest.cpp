@@ -0,0 +1,166 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "ObjectStoreTest.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bpstrutil.h"
+#include "platform_utils/bpobjectstore.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ObjectStoreTest);
+
+static void
+makeTree(const bfs::path& dir, const std::string& variant)
+{
+    bfs::create_directories(dir / "sub");
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "common.txt",
+                                            "shared contents"));
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "sub" / "common.dat",
+                                            "more shared contents"));
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "unique.txt",
+                                            "unique to " + variant));
+}
+
+static unsigned int
+linkCount(const bfs::path& p)
+{
+    bpf::FileInfo fi;
+    CPPUNIT_ASSERT(bpf::statFile(p, fi));
+    return fi.linkCount;
+}
+
+void
+ObjectStoreTest::bogusPath()
+{
+    bp::ObjectStore store(m_path / "store");
+    std::string err;
+    CPPUNIT_ASSERT(!store.adopt(m_path / "no" / "such" / "dir", err));
+    CPPUNIT_ASSERT(!err.empty());
+    CPPUNIT_ASSERT(store.collectGarbage() == 0);
+}
+
+void
+ObjectStoreTest::sharing()
+{
+    bp::ObjectStore store(m_path / "store");
+    std::string err, s;
+
+    makeTree(m_path / "1.0.0", "1.0.0");
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.0", err));
+    CPPUNIT_ASSERT_EQUAL(3u, store.added());
+    CPPUNIT_ASSERT_EQUAL(0u, store.shared());
+
+    makeTree(m_path / "1.0.1", "1.0.1");
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.1", err));
+    CPPUNIT_ASSERT_EQUAL(1u, store.added());
+    CPPUNIT_ASSERT_EQUAL(2u, store.shared());
+
+    // adopting again is a no-op
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.1", err));
+    CPPUNIT_ASSERT_EQUAL(0u, store.added());
+    CPPUNIT_ASSERT_EQUAL(0u, store.shared());
+
+    // common files are a single blob linked from both trees
+    CPPUNIT_ASSERT_EQUAL(3u, linkCount(m_path / "1.0.1" / "common.txt"));
+    CPPUNIT_ASSERT_EQUAL(3u, linkCount(m_path / "1.0.0" / "sub"
+                                       / "common.dat"));
+    CPPUNIT_ASSERT_EQUAL(2u, linkCount(m_path / "1.0.1" / "unique.txt"));
+
+    // contents are unchanged
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(m_path / "1.0.1" / "common.txt",
+                                             s));
+    CPPUNIT_ASSERT_EQUAL(std::string("shared contents"), s);
+    CPPUNIT_ASSERT(bp::strutil::loadFromFile(m_path / "1.0.1" / "unique.txt",
+                                             s));
+    CPPUNIT_ASSERT_EQUAL(std::string("unique to 1.0.1"), s);
+}
+
+void
+ObjectStoreTest::garbageCollection()
+{
+    bp::ObjectStore store(m_path / "store");
+    std::string err;
+
+    makeTree(m_path / "1.0.0", "1.0.0");
+    makeTree(m_path / "1.0.1", "1.0.1");
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.0", err));
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.1", err));
+
+    // nothing is garbage while both trees exist
+    CPPUNIT_ASSERT_EQUAL(0u, store.collectGarbage());
+
+    // only the first tree's unique file goes with it
+    CPPUNIT_ASSERT(bpf::safeRemove(m_path / "1.0.0"));
+    CPPUNIT_ASSERT_EQUAL(1u, store.collectGarbage());
+    CPPUNIT_ASSERT_EQUAL(2u, linkCount(m_path / "1.0.1" / "common.txt"));
+
+    CPPUNIT_ASSERT(bpf::safeRemove(m_path / "1.0.1"));
+    CPPUNIT_ASSERT_EQUAL(3u, store.collectGarbage());
+    CPPUNIT_ASSERT(bfs::is_empty(m_path / "store"));
+}
+
+void
+ObjectStoreTest::blobPermissions()
+{
+    bp::ObjectStore store(m_path / "store");
+    std::string err;
+
+    makeTree(m_path / "1.0.0", "1.0.0");
+    CPPUNIT_ASSERT(store.adopt(m_path / "1.0.0", err));
+
+    // blobs are read-only from the moment they exist, and the file
+    // adopted into the store shares the blob's inode
+    bfs::path blob = store.blobPath(
+        bp::sha256::hashFile(m_path / "1.0.0" / "common.txt"), false);
+    bpf::FileInfo bi, fi;
+    CPPUNIT_ASSERT(bpf::statFile(blob, bi));
+    CPPUNIT_ASSERT(bpf::statFile(m_path / "1.0.0" / "common.txt", fi));
+    CPPUNIT_ASSERT_EQUAL(0u, (unsigned int) (bi.mode & 0222));
+    CPPUNIT_ASSERT(bi.fileIdLow == fi.fileIdLow
+                   && bi.fileIdHigh == fi.fileIdHigh);
+
+    // no temporaries are left behind beside the blob
+    unsigned int entries = 0;
+    bfs::directory_iterator end;
+    for (bfs::directory_iterator it(blob.parent_path()); it != end; ++it) {
+        entries++;
+    }
+    CPPUNIT_ASSERT_EQUAL(1u, entries);
+}
+
+void 
+ObjectStoreTest::setUp()
+{
+	m_path = bpf::getTempPath(bpf::getTempDirectory(), "ObjectStoreTest");
+    bfs::create_directories(m_path);
+}
+
+
+void 
+ObjectStoreTest::tearDown()
+{
+    CPPUNIT_ASSERT(bpf::safeRemove(m_path));
+}
@@ -0,0 +1,55 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ObjectStoreTest.h
+ * A test of the bp::ObjectStore component
+ */
+
+#ifndef __OBJECTSTORETEST_H__
+#define __OBJECTSTORETEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+#include "BPUtils/bpfile.h"
+
+class ObjectStoreTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(ObjectStoreTest);
+    CPPUNIT_TEST(bogusPath);
+    CPPUNIT_TEST(sharing);
+    CPPUNIT_TEST(garbageCollection);
+    CPPUNIT_TEST(blobPermissions);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+    
+  protected:
+    void bogusPath();
+    void sharing();
+    void garbageCollection();
+    void blobPermissions();
+	boost::filesystem::path m_path;
+};
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "ServiceDescriptionTest.h"
+#include <sstream>
+#include "platform_utils/ServiceDescription.h"
+
+using bp::service::Argument;
+using bp::service::Description;
+using bp::service::Function;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ServiceDescriptionTest);
+
+// a service with n functions named f0..fn-1, each taking a required
+// string "s" and an optional integer "i"
+static Description
+makeDescription(unsigned int n)
+{
+    std::list<Argument> args;
+    Argument s("s", Argument::String);
+    s.setRequired(true);
+    args.push_back(s);
+    args.push_back(Argument("i", Argument::Integer));
+
+    std::list<Function> funcs;
+    for (unsigned int i = 0; i < n; i++) {
+        std::stringstream ss;
+        ss << "f" << i;
+        Function f;
+        f.setName(ss.str().c_str());
+        f.setDocString("does something");
+        f.setArguments(args);
+        funcs.push_back(f);
+    }
+
+    Description d;
+    d.setName("Wide");
+    d.setMajorVersion(1);
+    d.setMinorVersion(2);
+    d.setMicroVersion(3);
+    d.setDocString("a service with many functions");
+    d.setFunctions(funcs);
+    return d;
+}
+
+void
+ServiceDescriptionTest::lookupTest()
+{
+    Description d = makeDescription(10);
+
+    const Function * f = d.function("f7");
+    CPPUNIT_ASSERT(f != NULL);
+    CPPUNIT_ASSERT_EQUAL(std::string("f7"), f->name());
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, f->arguments().size());
+    CPPUNIT_ASSERT(d.function("f10") == NULL);
+    CPPUNIT_ASSERT(d.function("") == NULL);
+    CPPUNIT_ASSERT(d.function(NULL) == NULL);
+    CPPUNIT_ASSERT(d.hasFunction("f0"));
+    CPPUNIT_ASSERT(!d.hasFunction("nope"));
+
+    Function copy;
+    CPPUNIT_ASSERT(d.getFunction("f3", copy));
+    CPPUNIT_ASSERT_EQUAL(std::string("f3"), copy.name());
+
+    // the first function declared with a name wins, as it always has
+    std::list<Function> funcs = d.functions();
+    Function dup;
+    dup.setName("f3");
+    dup.setDocString("shadowed");
+    funcs.push_back(dup);
+    d.setFunctions(funcs);
+    CPPUNIT_ASSERT_EQUAL(std::string("does something"),
+                         d.function("f3")->docString());
+    CPPUNIT_ASSERT_EQUAL((size_t) 11, d.functions().size());
+
+    // functions keep their declared order
+    funcs = d.functions();
+    CPPUNIT_ASSERT_EQUAL(std::string("f0"), funcs.front().name());
+    CPPUNIT_ASSERT_EQUAL(std::string("shadowed"), funcs.back().docString());
+
+    d.clear();
+    CPPUNIT_ASSERT(d.function("f7") == NULL);
+    CPPUNIT_ASSERT(d.functions().empty());
+    CPPUNIT_ASSERT(d.name().empty());
+}
+
+void
+ServiceDescriptionTest::copyTest()
+{
+    Description a = makeDescription(3);
+    Description b(a);
+    Description c;
+    c = a;
+
+    // copies share functions until one of them changes
+    CPPUNIT_ASSERT(a.function("f1") == b.function("f1"));
+    CPPUNIT_ASSERT(a.function("f1") == c.function("f1"));
+
+    b.setName("Renamed");
+    b.setMajorVersion(7);
+    CPPUNIT_ASSERT_EQUAL(std::string("Wide"), a.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("Renamed"), b.name());
+    CPPUNIT_ASSERT_EQUAL(1u, a.majorVersion());
+    CPPUNIT_ASSERT_EQUAL(7u, b.majorVersion());
+    CPPUNIT_ASSERT(a.function("f1") != b.function("f1"));
+    CPPUNIT_ASSERT(b.function("f1") != NULL);
+
+    c.setFunctions(std::list<Function>());
+    CPPUNIT_ASSERT(!c.hasFunction("f1"));
+    CPPUNIT_ASSERT(a.hasFunction("f1"));
+
+    a.clear();
+    CPPUNIT_ASSERT(!a.hasFunction("f2"));
+    CPPUNIT_ASSERT(b.hasFunction("f2"));
+    CPPUNIT_ASSERT_EQUAL(std::string("1.2.3"),
+                         makeDescription(0).versionString());
+}
+
+void
+ServiceDescriptionTest::roundTripTest()
+{
+    Description d = makeDescription(4);
+    d.setIsBuiltIn(true);
+
+    bp::Object * o = d.toBPObject();
+    Description back;
+    CPPUNIT_ASSERT(back.fromBPObject(o));
+    delete o;
+
+    CPPUNIT_ASSERT_EQUAL(d.nameVersionString(), back.nameVersionString());
+    CPPUNIT_ASSERT_EQUAL(d.docString(), back.docString());
+    CPPUNIT_ASSERT_EQUAL((size_t) 4, back.functions().size());
+    const Function * f = back.function("f2");
+    CPPUNIT_ASSERT(f != NULL);
+    Argument a;
+    CPPUNIT_ASSERT(f->getArgument("s", a));
+    CPPUNIT_ASSERT(a.required());
+    CPPUNIT_ASSERT_EQUAL(Argument::String, a.type());
+
+    // functions found through the index validate as they did by copy
+    bp::Map args;
+    args.add("i", new bp::Integer(2));
+    CPPUNIT_ASSERT_EQUAL(std::string("call to 'f2' requires a 's' argument"),
+                         bp::service::validateArguments(*f, &args));
+    args.add("s", new bp::String("x"));
+    CPPUNIT_ASSERT(bp::service::validateArguments(*f, &args).empty());
+}
+
+void
+ServiceDescriptionTest::definitionTest()
+{
+    Description a = makeDescription(3);
+    Description b(a);
+
+    // each copy's definition stays valid while the other generates
+    // its own
+    const BPServiceDefinition * da = a.toBPServiceDefinition();
+    const BPServiceDefinition * db = b.toBPServiceDefinition();
+    CPPUNIT_ASSERT(da != db);
+    CPPUNIT_ASSERT_EQUAL(std::string("Wide"), std::string(da->serviceName));
+    CPPUNIT_ASSERT_EQUAL(3u, da->numFunctions);
+    CPPUNIT_ASSERT_EQUAL(2u, da->functions[1].numArguments);
+    CPPUNIT_ASSERT_EQUAL(std::string("s"),
+                         std::string(da->functions[1].arguments[0].name));
+    CPPUNIT_ASSERT_EQUAL(std::string("f2"),
+                         std::string(db->functions[2].functionName));
+
+    Description c;
+    CPPUNIT_ASSERT(c.fromBPServiceDefinition(db));
+    CPPUNIT_ASSERT_EQUAL(std::string("Wide 1.2.3"), c.nameVersionString());
+    CPPUNIT_ASSERT(c.function("f2") != NULL);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, c.function("f2")->arguments().size());
+}
@@ -0,0 +1,50 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ServiceDescriptionTest.h
+ * Unit tests for bp::service::Description, its function index and
+ * the storage its copies share
+ */
+
+#ifndef __SERVICEDESCRIPTIONTEST_H__
+#define __SERVICEDESCRIPTIONTEST_H__
+
+#include "TestingFramework/TestingFramework.h"
+
+class ServiceDescriptionTest : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(ServiceDescriptionTest);
+    CPPUNIT_TEST(lookupTest);
+    CPPUNIT_TEST(copyTest);
+    CPPUNIT_TEST(roundTripTest);
+    CPPUNIT_TEST(definitionTest);
+    CPPUNIT_TEST_SUITE_END();
+
+  protected:
+    void lookupTest();
+    void copyTest();
+    void roundTripTest();
+    void definitionTest();
+};
+
+#endif
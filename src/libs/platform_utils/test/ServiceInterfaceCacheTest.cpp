@@ -0,0 +1,239 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+#include "ServiceInterfaceCacheTest.h"
+#include <sstream>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstrutil.h"
+#include "platform_utils/ServiceInterfaceCache.h"
+#include "platform_utils/ServiceSummary.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+namespace sic = bp::serviceInterfaceCache;
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ServiceInterfaceCacheTest);
+
+static void
+put(std::string & b, size_t offset, unsigned long long v, size_t len)
+{
+    if (b.size() < offset + len) b.resize(offset + len, '\0');
+    for (size_t i = 0; i < len; i++, v >>= 8) b[offset + i] = (char) (v & 0xff);
+}
+
+// the smallest little endian ELF64 image readers will find a build
+// id in: a header, one PT_NOTE program header, and the note
+static std::string
+elfWithBuildId(const std::string & id)
+{
+    std::string b("\x7f" "ELF", 4);
+    put(b, 4, 2, 1);        // ELFCLASS64
+    put(b, 5, 1, 1);        // ELFDATA2LSB
+    put(b, 6, 1, 1);
+    put(b, 0x20, 64, 8);    // e_phoff
+    put(b, 0x36, 56, 2);    // e_phentsize
+    put(b, 0x38, 1, 2);     // e_phnum
+    put(b, 64, 4, 4);       // PT_NOTE
+    put(b, 64 + 0x08, 120, 8);
+    put(b, 64 + 0x20, 16 + ((id.size() + 3) & ~3), 8);
+    put(b, 120, 4, 4);
+    put(b, 124, id.size(), 4);
+    put(b, 128, 3, 4);      // NT_GNU_BUILD_ID
+    b.append("GNU\0", 4);
+    b.append(id);
+    b.resize(136 + ((id.size() + 3) & ~3), '\0');
+    return b;
+}
+
+static std::string
+machoWithUuid(const std::string & uuid)
+{
+    std::string b;
+    put(b, 0, 0xfeedfacf, 4);
+    put(b, 16, 1, 4);       // ncmds
+    put(b, 20, 24, 4);      // sizeofcmds
+    put(b, 32, 0x1b, 4);    // LC_UUID
+    put(b, 36, 24, 4);
+    b.append(uuid);
+    return b;
+}
+
+static std::string
+hex(const std::string & b)
+{
+    std::stringstream ss;
+    for (size_t i = 0; i < b.size(); i++) {
+        ss << std::hex << ((unsigned char) b[i] >> 4)
+           << ((unsigned char) b[i] & 0xf);
+    }
+    return ss.str();
+}
+
+// lay out a standalone service, returning its summary
+static bp::service::Summary
+writeService(const bfs::path & dir, const std::string & manifest,
+             const std::string & library)
+{
+    bfs::create_directories(dir);
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "manifest.json", manifest));
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "lib.so", library));
+    bp::service::Summary s;
+    std::string err;
+    CPPUNIT_ASSERT_MESSAGE(err, s.detectService(dir, err));
+    return s;
+}
+
+static std::string
+manifestFor(unsigned int i)
+{
+    std::stringstream ss;
+    ss << "{ \"type\": \"standalone\", \"ServiceLibrary\": \"lib.so\", "
+       << "\"strings\": { \"en\": { \"title\": \"Service " << i << "\", "
+       << "\"summary\": \"a service\" } } }";
+    return ss.str();
+}
+
+void
+ServiceInterfaceCacheTest::buildIds()
+{
+    std::string id("\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67", 20);
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(m_path / "elf", elfWithBuildId(id)));
+    CPPUNIT_ASSERT_EQUAL(hex(id), sic::buildId(m_path / "elf"));
+
+    std::string uuid = id.substr(0, 16);
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(m_path / "macho", machoWithUuid(uuid)));
+    CPPUNIT_ASSERT_EQUAL(hex(uuid), sic::buildId(m_path / "macho"));
+
+    // anything else has none
+    CPPUNIT_ASSERT(bp::strutil::storeToFile(m_path / "text", "not a library"));
+    CPPUNIT_ASSERT(sic::buildId(m_path / "text").empty());
+    CPPUNIT_ASSERT(sic::buildId(m_path / "missing").empty());
+}
+
+void
+ServiceInterfaceCacheTest::contentKeys()
+{
+    bfs::path dir = m_path / "Svc" / "1.0.0";
+    std::string lib = elfWithBuildId("build-one");
+    bp::service::Summary s = writeService(dir, manifestFor(0), lib);
+    std::string key = sic::contentKey(s);
+    CPPUNIT_ASSERT(!key.empty());
+    CPPUNIT_ASSERT_EQUAL((size_t) 0, key.find("Svc/1.0.0/"));
+
+    // rewriting unchanged keeps the key
+    s = writeService(dir, manifestFor(0), lib);
+    CPPUNIT_ASSERT_EQUAL(key, sic::contentKey(s));
+
+    bp::Map desc;
+    desc.add("name", new bp::String("Svc"));
+    CPPUNIT_ASSERT(sic::setByKey(key, &desc));
+    bp::Object * o = sic::getByKey(key);
+    CPPUNIT_ASSERT(o != NULL);
+    delete o;
+
+    // a rebuilt library, or a changed manifest, changes it
+    s = writeService(dir, manifestFor(0), elfWithBuildId("build-two"));
+    std::string rebuilt = sic::contentKey(s);
+    CPPUNIT_ASSERT(rebuilt != key);
+    CPPUNIT_ASSERT(sic::getByKey(rebuilt) == NULL);
+    s = writeService(dir, manifestFor(1), lib);
+    CPPUNIT_ASSERT(sic::contentKey(s) != key);
+
+    // and storing the new contents drops the old
+    CPPUNIT_ASSERT(sic::setByKey(rebuilt, &desc));
+    CPPUNIT_ASSERT(sic::getByKey(key) == NULL);
+
+    // libraries without a build id are keyed on their contents
+    s = writeService(dir, manifestFor(0), "a");
+    std::string a = sic::contentKey(s);
+    s = writeService(dir, manifestFor(0), "b");
+    CPPUNIT_ASSERT(!a.empty() && a != sic::contentKey(s));
+
+    CPPUNIT_ASSERT(sic::purge("Svc", "1.0.0"));
+    CPPUNIT_ASSERT(sic::getByKey(rebuilt) == NULL);
+}
+
+void
+ServiceInterfaceCacheTest::rescanAfterUpgrade()
+{
+    static const unsigned int NUM_SERVICES = 5;
+
+    // describe every service once
+    for (unsigned int i = 0; i < NUM_SERVICES; i++) {
+        std::stringstream name;
+        name << "Svc" << i;
+        bp::service::Summary s = writeService(
+            m_path / name.str() / "1.0.0", manifestFor(i),
+            elfWithBuildId(name.str()));
+        bp::Map desc;
+        desc.add("name", new bp::String(name.str()));
+        CPPUNIT_ASSERT(sic::setByKey(sic::contentKey(s), &desc));
+    }
+
+    // an upgrade rewrites every service unchanged, leaving modification
+    // times which invalidate the per service cache, and a new daemon
+    // reopens the index
+    for (unsigned int i = 0; i < NUM_SERVICES; i++) {
+        std::stringstream name;
+        name << "Svc" << i;
+        bfs::path dir = m_path / name.str() / "1.0.0";
+        CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "manifest.json",
+                                                manifestFor(i)));
+        CPPUNIT_ASSERT(bp::strutil::storeToFile(dir / "lib.so",
+                                                elfWithBuildId(name.str())));
+    }
+    sic::setIndexPath(m_path / "Index.kv");
+
+    // the rescan finds every description without describing anything
+    unsigned int hits = 0;
+    for (unsigned int i = 0; i < NUM_SERVICES; i++) {
+        std::stringstream name;
+        name << "Svc" << i;
+        bp::service::Summary s;
+        std::string err;
+        CPPUNIT_ASSERT(s.detectService(m_path / name.str() / "1.0.0", err));
+        bp::Object * o = sic::getByKey(sic::contentKey(s));
+        if (o) {
+            hits++;
+            CPPUNIT_ASSERT_EQUAL(name.str(), (std::string) *(o->get("name")));
+            delete o;
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(NUM_SERVICES, hits);
+}
+
+void 
+ServiceInterfaceCacheTest::setUp()
+{
+	m_path = bpf::getTempPath(bpf::getTempDirectory(), "ServiceInterfaceCacheTest");
+    bfs::create_directories(m_path);
+    sic::setIndexPath(m_path / "Index.kv");
+}
+
+
+void 
+ServiceInterfaceCacheTest::tearDown()
+{
+    sic::setIndexPath(bfs::path());
+    CPPUNIT_ASSERT(bpf::safeRemove(m_path));
+}
@@ -74,6 +74,9 @@ ServiceSummaryTest::standaloneTest()
     // now check that shutdownDelaySecs is set properly
     CPPUNIT_ASSERT_EQUAL( s.shutdownDelaySecs(), -1 );
 
+    // runs out of process unless it asks otherwise
+    CPPUNIT_ASSERT( !s.inProcess() );
+
     // instantiated from a non name/version dir.  they should be left
     // empty
     CPPUNIT_ASSERT_MESSAGE( s.name().c_str(), s.name().empty() );
@@ -152,6 +155,39 @@ ServiceSummaryTest::shutdownDelayTest()
 }
 
 
+void
+ServiceSummaryTest::inProcessTest()
+{
+    static const char * manifestJson =
+        "{"
+        "    \"type\": \"standalone\","
+        "    \"ServiceLibrary\": \"lib.dll\","
+        "    \"strings\": { "
+        "        \"en\": { "
+        "            \"title\": \"foo\", "
+        "            \"summary\": \"bar\""
+        "        }"
+        "    },"
+        "    \"inProcess\": true"
+        "}";
+
+    std::vector<boost::filesystem::path> filesToTouch;
+    filesToTouch.push_back(boost::filesystem::path("lib.dll"));
+
+    createService(manifestJson, filesToTouch);
+
+    bp::service::Summary s;
+    std::string error;
+    bool detectedService = s.detectService(m_testServiceDir, error);
+    CPPUNIT_ASSERT_MESSAGE( error, detectedService );
+    CPPUNIT_ASSERT( s.inProcess() );
+
+    // and clear() forgets it
+    s.clear();
+    CPPUNIT_ASSERT( !s.inProcess() );
+}
+
+
 void
 ServiceSummaryTest::createService(const char * manifestJson,
                                   std::vector<boost::filesystem::path> filesToTouch)
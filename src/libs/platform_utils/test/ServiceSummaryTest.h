@@ -42,6 +42,7 @@ class ServiceSummaryTest : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST_SUITE(ServiceSummaryTest);
     CPPUNIT_TEST(standaloneTest);
     CPPUNIT_TEST(shutdownDelayTest);
+    CPPUNIT_TEST(inProcessTest);
     CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -51,6 +52,7 @@ class ServiceSummaryTest : public CPPUNIT_NS::TestCase
   protected:
     void standaloneTest();
     void shutdownDelayTest();
+    void inProcessTest();
 
   private:
     // the directory into which a service is written
@@ -89,6 +89,12 @@ URLCollectionTest::malformedJSON()
         CPPUNIT_ASSERT(coll.add("http://www.yahoo.com"));    
         CPPUNIT_ASSERT(coll.has("http://www.yahoo.com"));    
 
+        // the JSON document was imported into the log and removed
+        CPPUNIT_ASSERT(!bpf::pathExists(m_path));
+        bp::URLCollection reopened;
+        CPPUNIT_ASSERT(reopened.init(m_path));
+        CPPUNIT_ASSERT(reopened.has("http://www.yahoo.com"));    
+
         // ensure we can delete test file
         CPPUNIT_ASSERT(bpf::safeRemove(m_path));
     }
@@ -75,17 +75,30 @@ loadFromCache(const std::set<bp::service::Summary> & summaries,
             continue;
         }
 
+        // the content keyed index survives the service being rewritten
+        // unchanged, the per service cache only its being left alone.
+        // hits in the latter are carried over into the former.
+        std::string key = bp::serviceInterfaceCache::contentKey(*i);
         bp::Object * descJson = NULL;
         bp::service::Description d;
-        if (bp::serviceInterfaceCache::isNewerThan(i->name(), i->version(),
-                                                   i->modDate()) &&
-            (descJson = bp::serviceInterfaceCache::get(i->name(),
-                                                       i->version())) &&
+        if ((descJson = bp::serviceInterfaceCache::getByKey(key)) &&
             d.fromBPObject(descJson))
         {
             oDesc[*i] = d;
         } else {
-            noLove.insert(*i);
+            if (descJson) delete descJson;
+            descJson = NULL;
+            if (bp::serviceInterfaceCache::isNewerThan(i->name(), i->version(),
+                                                       i->modDate()) &&
+                (descJson = bp::serviceInterfaceCache::get(i->name(),
+                                                           i->version())) &&
+                d.fromBPObject(descJson))
+            {
+                oDesc[*i] = d;
+                (void) bp::serviceInterfaceCache::setByKey(key, descJson);
+            } else {
+                noLove.insert(*i);
+            }
         }
         if (descJson) delete descJson;
     }
@@ -95,13 +108,16 @@ loadFromCache(const std::set<bp::service::Summary> & summaries,
 
 // store a description to cache
 static void
-storeToCache(const bp::service::Description & description)
+storeToCache(const bp::service::Summary & summary,
+             const bp::service::Description & description)
 {
     bp::Object * o = description.toBPObject();
     if (!bp::serviceInterfaceCache::set(description.name(),
                                         description.versionString(), o)) {
         BPLOG_WARN( "Caching of service description failed!" );
     }
+    std::string key = bp::serviceInterfaceCache::contentKey(summary);
+    if (!key.empty()) (void) bp::serviceInterfaceCache::setByKey(key, o);
     
     if (o) {
         delete o;
@@ -564,7 +580,7 @@ DiskScanner::scanDiskForServices(
             {
                 providerSummaries.insert(*i);
                 // store interface description to cache
-                storeToCache(thisScan[*i]);
+                storeToCache(*i, thisScan[*i]);
             }
         }
 
@@ -611,7 +627,7 @@ DiskScanner::scanDiskForServices(
         {
             if (bogusServices.find(*i) == bogusServices.end())
             {
-                storeToCache(thisScan[*i]);
+                storeToCache(*i, thisScan[*i]);
             }
         }
     }
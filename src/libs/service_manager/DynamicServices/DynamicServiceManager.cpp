@@ -34,8 +34,10 @@
 #include "BPUtils/bpprocess.h"
 #include "DiskScanner.h"
 #include "platform_utils/bpexitcodes.h"
+#include "platform_utils/bplocalization.h"
 #include "platform_utils/ProductPaths.h"
 #include "platform_utils/ServiceInterfaceCache.h"
+#include "platform_utils/bpsign.h"
 
 using namespace std;
 using namespace std::tr1;
@@ -46,8 +48,10 @@ using namespace std::tr1;
  */
 DynamicServiceManager::DynamicServiceManager(const std::string & loglevel,
                                              const boost::filesystem::path & logfile)
-    : m_logLevel(loglevel), m_logFile(logfile), m_instantiateId(10000)
+    : m_logLevel(loglevel), m_logFile(logfile), m_instantiateId(10000),
+      m_inProcessServices(true), m_sharedServiceHost(false)
 {
+    m_state.setManager(this);
 }
 
 DynamicServiceManager::~DynamicServiceManager()
@@ -113,6 +117,53 @@ DynamicServiceManager::haveService(const std::string & name,
     return internalFind(name, version, minversion, s, d);
 }
 
+void
+DynamicServiceManager::resolve(
+    const std::vector<ServiceSpec> & specs,
+    std::vector<bool> & oFound,
+    std::vector<bp::service::Summary> & oSummaries,
+    std::vector<bp::service::Description> & oDescriptions)
+{
+    oFound.assign(specs.size(), false);
+    oSummaries.assign(specs.size(), bp::service::Summary());
+    oDescriptions.assign(specs.size(), bp::service::Description());
+
+    // parse wanted versions once, and index specs by name
+    std::vector<bp::SemanticVersion> version(specs.size());
+    std::vector<bp::SemanticVersion> minversion(specs.size());
+    std::vector<bp::SemanticVersion> bestVer(specs.size());
+    std::multimap<std::string, size_t> byName;
+    for (size_t j = 0; j < specs.size(); j++) {
+        if (version[j].parse(specs[j].m_version)
+            && minversion[j].parse(specs[j].m_minversion))
+        {
+            byName.insert(std::make_pair(specs[j].m_name, j));
+        }
+    }
+    if (byName.empty()) return;
+
+    std::map<bp::service::Summary, bp::service::Description>::iterator i;
+    for (i = m_services.begin(); i != m_services.end(); i++)
+    {
+        std::pair<std::multimap<std::string, size_t>::iterator,
+                  std::multimap<std::string, size_t>::iterator> range =
+            byName.equal_range(i->first.name());
+        std::multimap<std::string, size_t>::iterator k;
+        for (k = range.first; k != range.second; ++k) {
+            size_t j = k->second;
+            if (bp::SemanticVersion::isNewerMatch(
+                    i->second.version(), bestVer[j], version[j],
+                    minversion[j]))
+            {
+                oSummaries[j] = i->first;
+                oDescriptions[j] = i->second;
+                bestVer[j] = i->second.version();
+                oFound[j] = true;
+            }
+        }
+    }
+}
+
 std::vector<bp::service::Summary>
 DynamicServiceManager::availableServiceSummaries()
 {
@@ -245,6 +296,77 @@ DynamicServiceManager::internalFind(const std::string & name,
     return found;
 }
 
+void
+DynamicServiceManager::setInProcessServices(bool enabled)
+{
+    m_inProcessServices = enabled;
+}
+
+void
+DynamicServiceManager::setSharedServiceHost(bool enabled)
+{
+    m_sharedServiceHost = enabled;
+}
+
+void
+DynamicServiceManager::setIsolatedServices(const std::list<std::string> & names)
+{
+    m_isolatedServices = std::set<std::string>(names.begin(), names.end());
+}
+
+void
+DynamicServiceManager::setIdleServiceBudget(unsigned int budget)
+{
+    m_state.setIdleBudget(budget);
+}
+
+// A service may run inside BrowserPlusCore only when it asks to and
+// its library carries a detached signature made with the platform
+// key.  A crash in such a service takes the daemon down with it, so
+// we only extend this to code we've shipped ourselves.
+static bool
+trustedInProcess(const bp::service::Summary & summary)
+{
+    if (!summary.inProcess()) return false;
+
+    // dependent services are interpreted by a provider, which would
+    // then be loaded once per dependent
+    if (summary.type() == bp::service::Summary::Dependent) return false;
+
+    boost::filesystem::path sigPath = summary.path() / "signature.smime";
+    std::string signature;
+    if (!bp::file::pathExists(sigPath)
+        || !bp::strutil::loadFromFile(sigPath, signature))
+    {
+        BPLOG_INFO_STRM(summary.name() << " - " << summary.version()
+                        << " asks to run in process but isn't signed, "
+                        << "spawning");
+        return false;
+    }
+
+    BPTime ts;
+    if (!bp::sign::Signer::get()->verifyFile(
+            signature, summary.serviceLibraryPath(), ts))
+    {
+        BPLOG_WARN_STRM(summary.name() << " - " << summary.version()
+                        << " in process signature doesn't verify, "
+                        << "spawning");
+        return false;
+    }
+    return true;
+}
+
+// A service shares a host when that's enabled, its manifest says it
+// may, and it isn't configured to be isolated.  The host loads only v5
+// services, and as above providers aren't loaded once per dependent.
+bool
+DynamicServiceManager::shareable(const bp::service::Summary & summary)
+{
+    if (!m_sharedServiceHost || !summary.shareable()) return false;
+    if (summary.type() == bp::service::Summary::Dependent) return false;
+    return m_isolatedServices.find(summary.name()) == m_isolatedServices.end();
+}
+
 // given a dependant summary and a set of provider summaries, attain
 // the path to the best match.  returns empty string if there is
 // no viable match
@@ -277,6 +399,110 @@ getBestProvider(const bp::service::Summary & dep,
     return boost::filesystem::path();
 }
 
+shared_ptr<ServiceRunner::Controller>
+DynamicServiceManager::startController(const bp::service::Summary & summary,
+                                       const std::string & locale)
+{
+    shared_ptr<ServiceRunner::Controller> controller;
+    controller.reset(new ServiceRunner::Controller(summary.path()));
+    controller->setListener(this);
+
+    // get a provider for dependent services
+    boost::filesystem::path providerPath;
+    if (summary.type() == bp::service::Summary::Dependent)
+    {
+        providerPath = getBestProvider(summary, m_services);
+        if (providerPath.empty()) {
+            return shared_ptr<ServiceRunner::Controller>();
+        }
+    }
+
+    // get a reasonable title for the spawned process
+    std::string processTitle, ignore;            
+    if (!summary.localization(locale, processTitle, ignore))
+    {
+        processTitle.append("BrowserPlus: Spawned Service");
+    }
+    else
+    {
+        processTitle = (std::string("BrowserPlus: ") + processTitle);
+    }
+
+    std::string err;
+    bool started = false;
+    if (m_inProcessServices && trustedInProcess(summary)) {
+        started = controller->runInProcess(providerPath, err);
+        if (!started) {
+            BPLOG_WARN_STRM("Couldn't load " << summary.name()
+                            << " - " << summary.version()
+                            << " in process, spawning: " << err);
+            controller.reset(new ServiceRunner::Controller(summary.path()));
+            controller->setListener(this);
+            err.clear();
+        }
+    }
+    if (!started && shareable(summary)) {
+        shared_ptr<ServiceRunner::SharedHost> host = m_sharedHost.lock();
+        if (host == NULL || !host->alive()) {
+            host.reset(new ServiceRunner::SharedHost);
+            if (host->run(bp::paths::getRunnerPath(), m_logLevel,
+                          m_logFile, err))
+            {
+                m_sharedHost = host;
+            } else {
+                BPLOG_WARN_STRM("Couldn't start shared service host: "
+                                << err);
+                host.reset();
+                err.clear();
+            }
+        }
+        // should the host fail to load it the controller spawns
+        // the service itself
+        started = host != NULL &&
+            controller->runShared(host, bp::paths::getRunnerPath(),
+                                  providerPath, processTitle,
+                                  m_logLevel, m_logFile, err);
+        if (!started && host != NULL) {
+            BPLOG_WARN_STRM("Couldn't run " << summary.name()
+                            << " - " << summary.version()
+                            << " in shared host, spawning: " << err);
+            err.clear();
+        }
+    }
+    if (!started &&
+        !controller->run(bp::paths::getRunnerPath(),
+                         providerPath, processTitle, 
+                         m_logLevel, m_logFile, err))
+    {
+        BPLOG_WARN_STRM("Couldn't load " << summary.name() << " - "
+                        << summary.version() << ": " << err);
+        return shared_ptr<ServiceRunner::Controller>();
+    }
+    return controller;
+}
+
+void
+DynamicServiceManager::prewarm(const bp::service::Summary & summary)
+{
+    // the service may have been removed or updated since it went idle
+    bp::service::Summary current;
+    bp::service::Description description;
+    if (!internalFind(summary.name(), summary.version(), std::string(),
+                      current, description))
+    {
+        return;
+    }
+    if (m_state.getRunningController(current) != NULL ||
+        m_state.getPendingController(current) != NULL)
+    {
+        return;
+    }
+
+    shared_ptr<ServiceRunner::Controller> controller =
+        startController(current, bp::localization::getUsersLocale());
+    if (controller != NULL) m_state.addPrewarm(controller, current);
+}
+
 unsigned int
 DynamicServiceManager::instantiate(
     const std::string & name,
@@ -294,6 +520,7 @@ DynamicServiceManager::instantiate(
     {
         return 0;
     }
+    m_state.noteUse(summary);
 
     // convert context ptr to strong
     shared_ptr<ServiceExecutionContext> context = contextWeak.lock();
@@ -313,37 +540,8 @@ DynamicServiceManager::instantiate(
 
         if (controller == NULL) {
             // we must start up the controller
-            controller.reset(new ServiceRunner::Controller(summary.path()));
-            controller->setListener(this);
-
-            // get a provider for dependent services
-            boost::filesystem::path providerPath;
-            if (summary.type() == bp::service::Summary::Dependent)
-            {
-                providerPath = getBestProvider(summary, m_services);
-                if (providerPath.empty()) return 0;
-            }
-
-            // get a reasonable title for the spawned process
-            std::string processTitle, ignore;            
-            if (!summary.localization(context->locale(), processTitle, ignore))
-            {
-                processTitle.append("BrowserPlus: Spawned Service");
-            }
-            else
-            {
-                processTitle = (std::string("BrowserPlus: ") + processTitle);
-            }
-        
-            std::string err;
-            if (!controller->run(bp::paths::getRunnerPath(),
-                                 providerPath, processTitle, 
-                                 m_logLevel, m_logFile, err))
-            {
-                BPLOG_WARN_STRM("Couldn't load " << summary.name() << " - "
-                                << summary.version() << ": " << err);
-                return 0;
-            }
+            controller = startController(summary, context->locale());
+            if (controller == NULL) return 0;
         }
 
         // now we must record this allocation request. which will be serviced
@@ -395,6 +593,10 @@ DynamicServiceManager::initialized(ServiceRunner::Controller * c,
         for (i = s.begin(); i != s.end(); i++) {
             startAllocation(controller, *i, desc.version().majorVer());
         }
+    } else if (controller != NULL) {
+        // started ahead of use, it's held until wanted or its time is up
+        BPLOG_INFO_STRM("Prewarmed " << service << " - " << version);
+        m_state.addIdleController(controller, summary);
     } else {
         // yikes, this is possibly internal corruption!
         BPLOG_ERROR_STRM("Initialized service with no "
@@ -40,8 +40,10 @@ using namespace std::tr1;
 
 
 DynamicServiceState::DynamicServiceState()
+    : m_manager(NULL)
 {
     m_delayedShutdownTimer.setListener(this);
+    m_clock.start();
 }
 
 DynamicServiceState::~DynamicServiceState()
@@ -50,6 +52,31 @@ DynamicServiceState::~DynamicServiceState()
     m_delayedShutdownTimer.cancel();
 }
 
+double
+DynamicServiceState::now()
+{
+    return m_clock.elapsedSec();
+}
+
+std::string
+DynamicServiceState::policyKey(const bp::service::Summary & summary)
+{
+    return summary.name() + " " + summary.version();
+}
+
+void
+DynamicServiceState::setManager(DynamicServiceManager * manager)
+{
+    m_manager = manager;
+}
+
+void
+DynamicServiceState::setIdleBudget(unsigned int budget)
+{
+    m_policy.setIdleBudget(budget);
+    rescheduleIdleCheck();
+}
+
 shared_ptr<ServiceRunner::Controller>
 DynamicServiceState::getRunningController(const bp::service::Summary & s)
 {
@@ -88,11 +115,52 @@ DynamicServiceState::addPendingAllocation(
                 std::set<shared_ptr<DynamicServiceInstance> >());
         i = m_pendingAllocations.find(instance->m_summary);        
         BPASSERT(i != m_pendingAllocations.end());
+
+        bp::time::Stopwatch & spawnTimer = m_spawnTimers[instance->m_summary];
+        spawnTimer.reset();
+        spawnTimer.start();
     }
 
     i->second.second.insert(instance);
 }
 
+void
+DynamicServiceState::addPrewarm(
+    shared_ptr<ServiceRunner::Controller> controller,
+    const bp::service::Summary & summary)
+{
+    BPASSERT(m_pendingAllocations.find(summary) ==
+             m_pendingAllocations.end());
+    m_pendingAllocations[summary] =
+        PendControllerServiceSetPair(
+            controller, std::set<shared_ptr<DynamicServiceInstance> >());
+
+    bp::time::Stopwatch & spawnTimer = m_spawnTimers[summary];
+    spawnTimer.reset();
+    spawnTimer.start();
+
+    m_policy.prewarmed(policyKey(summary));
+}
+
+void
+DynamicServiceState::addIdleController(
+    shared_ptr<ServiceRunner::Controller> controller,
+    const bp::service::Summary & summary)
+{
+    BPASSERT(m_controllers.find(summary) == m_controllers.end());
+    ControllerContext ctx;
+    ctx.controller = controller;
+    m_controllers[summary] = ctx;
+    rescheduleIdleCheck();
+}
+
+void
+DynamicServiceState::noteUse(const bp::service::Summary & summary)
+{
+    m_policy.used(policyKey(summary), now());
+    m_dormant.erase(summary);
+}
+
 shared_ptr<DynamicServiceInstance>
 DynamicServiceState::createInstance(
     DynamicServiceManager * manager,
@@ -126,14 +194,10 @@ DynamicServiceState::addRunningAllocation(
         m_controllers[instance->m_summary] = ctx;
         i = m_controllers.find(instance->m_summary);        
         BPASSERT(i != m_controllers.end());
-    } else {
-        // reset the idle timer
-        if (i->second.idleTime.elapsedSec() > 0.0) {
-            BPLOG_INFO_STRM("Resetting idle timer for " << i->first.name()
-                            << " " << i->first.version() << ", new instance "
-                            << "allocated.");
-            i->second.idleTime.reset();
-        }
+    } else if (i->second.instances.size() == 0) {
+        BPLOG_INFO_STRM("Reusing idle " << i->first.name() << " "
+                        << i->first.version() << ", new instance "
+                        << "allocated.");
     }
     
     BPASSERT(i->second.instances.find(instance.get()) == 
@@ -191,6 +255,14 @@ DynamicServiceState::popPendingAllocations(
         oPending = i->second.second;
         m_pendingAllocations.erase(i);
     }
+
+    // the controller is up, which tells us what starting it costs
+    std::map<bp::service::Summary, bp::time::Stopwatch>::iterator t =
+        m_spawnTimers.find(summary);
+    if (t != m_spawnTimers.end()) {
+        m_policy.spawned(policyKey(summary), t->second.elapsedSec());
+        m_spawnTimers.erase(t);
+    }
 }
 
 void
@@ -202,6 +274,7 @@ DynamicServiceState::popPendingAllocations(
          i != m_pendingAllocations.end(); ++i) {
         if (i->second.first.get() == c) {
             oPending = i->second.second;
+            m_spawnTimers.erase(i->first);
             m_pendingAllocations.erase(i);
             return;
         }
@@ -213,29 +286,85 @@ DynamicServiceState::rescheduleIdleCheck()
 {
     m_delayedShutdownTimer.cancel();
 
-    // iterate through all controllers, any controllers with zero instances
-    // will cause us to reset the idle check timer
+    // wake for the soonest of an idle controller's time being up, an
+    // idle controller beginning to count against the budget, or a
+    // stopped service being due for prewarming
+    double t = now();
+    double next = -1.0;
+    unsigned int idle = 0;
     ControllerMap::iterator i;
-    double nextCheck = 0.0;
     for (i = m_controllers.begin(); i != m_controllers.end(); i++)
     {
-        if (i->second.instances.size() == 0) {
-            int delay = i->first.shutdownDelaySecs();
-            if (delay > 0) {
-                if (nextCheck == 0.0 || nextCheck > (double) delay)
-                {
-                    // add 1/10th of a second to ensure we don't wake
-                    // up early
-                    nextCheck = (double) delay + 0.1;
-                }
-            }
+        if (i->second.instances.size() > 0) continue;
+        idle++;
+        double deadline = m_policy.idleDeadline(
+            policyKey(i->first), i->first.shutdownDelaySecs());
+        if (deadline < t) deadline = t;
+        if (next < 0.0 || deadline < next) next = deadline;
+    }
+
+    if (idle > m_policy.idleBudget()) {
+        for (i = m_controllers.begin(); i != m_controllers.end(); i++)
+        {
+            if (i->second.instances.size() > 0) continue;
+            double from = m_policy.budgetTime(
+                policyKey(i->first), i->first.shutdownDelaySecs());
+            if (from > t && from < next) next = from;
         }
     }
 
-    if (nextCheck > 0.0) {
-        BPLOG_INFO_STRM("checking for idle services to shutdown in "
-                        << nextCheck << "s");
-        m_delayedShutdownTimer.setMsec((unsigned int) (nextCheck * 1000));
+    std::set<bp::service::Summary>::iterator d;
+    for (d = m_dormant.begin(); d != m_dormant.end(); d++)
+    {
+        double when = m_policy.prewarmTime(policyKey(*d));
+        if (when < 0.0) continue;
+        if (when < t) when = t;
+        if (next < 0.0 || when < next) next = when;
+    }
+
+    if (next >= 0.0) {
+        // add 1/10th of a second to ensure we don't wake up early
+        double secs = (next - t) + 0.1;
+        BPLOG_INFO_STRM("checking for idle services to shutdown or "
+                        "prewarm in " << secs << "s");
+        m_delayedShutdownTimer.setMsec((unsigned int) (secs * 1000));
+    }
+}
+
+void
+DynamicServiceState::stopIdle(const bp::service::Summary & summary)
+{
+    ControllerMap::iterator i = m_controllers.find(summary);
+    if (i != m_controllers.end()) {
+        m_controllers.erase(i);
+    }
+    if (m_policy.prewarmTime(policyKey(summary)) >= 0.0) {
+        m_dormant.insert(summary);
+    }
+}
+
+void
+DynamicServiceState::enforceIdleBudget()
+{
+    std::map<std::string, int> idle;
+    std::map<std::string, bp::service::Summary> byKey;
+    ControllerMap::iterator i;
+    for (i = m_controllers.begin(); i != m_controllers.end(); i++)
+    {
+        if (i->second.instances.size() > 0) continue;
+        std::string key = policyKey(i->first);
+        idle[key] = i->first.shutdownDelaySecs();
+        byKey[key] = i->first;
+    }
+
+    std::vector<std::string> victims;
+    m_policy.overBudget(idle, now(), victims);
+    for (size_t v = 0; v < victims.size(); v++) {
+        const bp::service::Summary & summary = byKey[victims[v]];
+        BPLOG_INFO_STRM("Shutting down idle " << summary.name() << " "
+                        << summary.version() << " to stay within "
+                        << m_policy.idleBudget() << " idle services");
+        stopIdle(summary);
     }
 }
 
@@ -245,24 +374,46 @@ DynamicServiceState::timesUp(bp::time::Timer *)
     // cancel the timer for good measure
     m_delayedShutdownTimer.cancel();
 
-    // iterate through all controllers, any controllers with zero instances
-    // who have expired time will get purged
-    ControllerMap::iterator i = m_controllers.begin();
-    while (i != m_controllers.end())
+    double t = now();
+
+    // any controllers with zero instances whose time is up get purged
+    std::vector<bp::service::Summary> expired;
+    ControllerMap::iterator i;
+    for (i = m_controllers.begin(); i != m_controllers.end(); i++)
     {
-        int delay = i->first.shutdownDelaySecs();
-        if (i->second.instances.size() == 0 &&
-            i->second.idleTime.elapsedSec() > (double) delay)
-        {
-            BPLOG_INFO_STRM("Shutting down " << i->first.name() << " " 
-                            << i->first.version() << " after being idle for "
-                            << i->second.idleTime.elapsedSec() << " seconds");
-            m_controllers.erase(i);
-            i = m_controllers.begin();
+        if (i->second.instances.size() > 0) continue;
+        double deadline = m_policy.idleDeadline(
+            policyKey(i->first), i->first.shutdownDelaySecs());
+        if (deadline <= t) expired.push_back(i->first);
+    }
+    for (size_t e = 0; e < expired.size(); e++) {
+        BPLOG_INFO_STRM("Shutting down " << expired[e].name() << " "
+                        << expired[e].version() << " after being idle");
+        stopIdle(expired[e]);
+    }
+
+    enforceIdleBudget();
+
+    // start those stopped services which are about to be wanted
+    std::vector<bp::service::Summary> due;
+    std::set<bp::service::Summary>::iterator d = m_dormant.begin();
+    while (d != m_dormant.end())
+    {
+        double when = m_policy.prewarmTime(policyKey(*d));
+        if (when < 0.0) {
+            m_dormant.erase(d++);
+        } else if (when <= t) {
+            due.push_back(*d);
+            m_dormant.erase(d++);
         } else {
-            i++;
+            d++;
         }
     }
+    for (size_t p = 0; p < due.size(); p++) {
+        BPLOG_INFO_STRM("Prewarming " << due[p].name() << " "
+                        << due[p].version());
+        if (m_manager) m_manager->prewarm(due[p]);
+    }
 
     rescheduleIdleCheck();
 }
@@ -296,23 +447,27 @@ DynamicServiceState::removeInstance(DynamicServiceInstance * instance)
         }
 
         // now if there are no more references to this controller, we'll
-        // either delete it, or schedule it for deletion
+        // either delete it, or hold it for as long as its manifest or
+        // the keep alive policy asks
         if (i->second.instances.size() == 0) {
-            int delay = i->first.shutdownDelaySecs();
-            if (delay > 0) {
+            bp::service::Summary summary = i->first;
+            std::string key = policyKey(summary);
+            m_policy.idle(key, now());
+            double hold = m_policy.idleDeadline(
+                key, summary.shutdownDelaySecs()) - now();
+            if (hold > 0.0) {
                 BPLOG_INFO_STRM("Delaying shutdown of service "
-                                << i->first.name() << " "
-                                << i->first.version() << " up to "
-                                << delay << " seconds");
-                i->second.idleTime.reset();
-                i->second.idleTime.start();                
-                rescheduleIdleCheck();
+                                << summary.name() << " "
+                                << summary.version() << " up to "
+                                << hold << " seconds");
+                enforceIdleBudget();
             } else {
                 BPLOG_INFO_STRM("No more instances, shutting down service "
-                                << i->first.name() << " "
-                                << i->first.version());
-                m_controllers.erase(i);
+                                << summary.name() << " "
+                                << summary.version());
+                stopIdle(summary);
             }
+            rescheduleIdleCheck();
         }
     }
 
@@ -384,6 +539,8 @@ DynamicServiceState::stopService(const bp::service::Summary & summary)
     {
         m_controllers.erase(ci);
     }
+    m_dormant.erase(summary);
+    m_spawnTimers.erase(summary);
 
     // controllers in process of allocation
     PendControllerMap::iterator pi = m_pendingAllocations.find(summary);
@@ -0,0 +1,280 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * KeepAlivePolicy
+ *
+ * For each service the gaps between going idle and being wanted again
+ * are kept in a log scaled histogram.  The window in which the next
+ * use is expected runs from the 5th to the 99th percentile gap.  If
+ * that window opens soon after the service goes idle the runner is
+ * simply held until it closes, if it opens much later the runner is
+ * stopped and started again just before it opens.  Windows longer
+ * than kMaxHoldSecs aren't worth holding a runner for.
+ */
+
+#include "KeepAlivePolicy.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// idle gaps seen before we trust the histogram
+#define MIN_SAMPLES 4
+
+// once this many gaps are recorded, all counts are halved so that
+// the histogram follows changes in how a service is used
+#define AGE_SAMPLES 128
+
+// percentiles bounding the window of expected use, and the margins
+// we allow on either side of it
+#define WINDOW_HEAD 0.05
+#define WINDOW_TAIL 0.99
+#define HEAD_MARGIN 0.95
+#define TAIL_MARGIN 1.05
+
+// a runner is only stopped to be prewarmed if it would otherwise
+// sit idle at least this long
+#define PREWARM_MIN_SECS 60.0
+
+// how far ahead of the window a prewarmed runner should be ready
+#define PREWARM_LEAD_SECS 1.0
+
+// most reuse comes soon after a service goes idle, so a runner held
+// on a prediction counts against the budget only once it's been idle
+// this long
+#define BUDGET_GRACE_SECS 30.0
+
+// runners over budget are ranked by the chance they're wanted within
+// this many seconds, weighted by what starting them costs
+#define VALUE_HORIZON_SECS 30.0
+
+const double KeepAlivePolicy::kMaxHoldSecs = 300.0;
+const double KeepAlivePolicy::kBinBase = 1.05;
+
+KeepAlivePolicy::Stats::Stats()
+    : outOfRange(0), samples(0), spawnSecs(0.0), idleSince(-1.0),
+      prewarmed(false)
+{
+    memset(bins, 0, sizeof(bins));
+}
+
+KeepAlivePolicy::KeepAlivePolicy(unsigned int idleBudget)
+    : m_stats(), m_budget(idleBudget)
+{
+}
+
+void
+KeepAlivePolicy::setIdleBudget(unsigned int idleBudget)
+{
+    m_budget = idleBudget;
+}
+
+const KeepAlivePolicy::Stats *
+KeepAlivePolicy::find(const std::string & service) const
+{
+    std::map<std::string, Stats>::const_iterator i = m_stats.find(service);
+    return (i == m_stats.end()) ? NULL : &(i->second);
+}
+
+unsigned int
+KeepAlivePolicy::binFor(double gap)
+{
+    if (gap < kBinBase) return 0;
+    double b = floor(log(gap) / log(kBinBase));
+    return (b >= (double) kBins) ? (unsigned int) kBins : (unsigned int) b;
+}
+
+double
+KeepAlivePolicy::binStart(unsigned int bin)
+{
+    return (bin == 0) ? 0.0 : pow(kBinBase, (double) bin);
+}
+
+double
+KeepAlivePolicy::binEnd(unsigned int bin)
+{
+    return pow(kBinBase, (double) (bin + 1));
+}
+
+unsigned int
+KeepAlivePolicy::percentile(const Stats & s, double p)
+{
+    double target = p * (double) s.samples;
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < kBins; i++) {
+        count += s.bins[i];
+        if (count > 0 && (double) count >= target) return i;
+    }
+    return kBins;
+}
+
+double
+KeepAlivePolicy::likelihood(const Stats & s, double a, double b)
+{
+    // a bin counts wholly on the side of a or b its middle falls
+    unsigned int longer = s.outOfRange, within = 0;
+    for (unsigned int i = 0; i < kBins; i++) {
+        double mid = (binStart(i) + binEnd(i)) / 2.0;
+        if (mid <= a) continue;
+        longer += s.bins[i];
+        if (mid <= b) within += s.bins[i];
+    }
+    return longer ? (double) within / (double) longer : 0.0;
+}
+
+bool
+KeepAlivePolicy::window(const Stats & s, double & start, double & end) const
+{
+    start = end = 0.0;
+    if (m_budget == 0 || s.samples < MIN_SAMPLES) return false;
+
+    unsigned int tail = percentile(s, WINDOW_TAIL);
+    if (tail >= kBins) return false;
+    end = binEnd(tail) * TAIL_MARGIN;
+
+    double head = binStart(percentile(s, WINDOW_HEAD)) * HEAD_MARGIN;
+    double lead = s.spawnSecs + PREWARM_LEAD_SECS;
+    if (head - lead >= PREWARM_MIN_SECS) start = head - lead;
+
+    return (end - start) <= kMaxHoldSecs;
+}
+
+void
+KeepAlivePolicy::used(const std::string & service, double now)
+{
+    Stats & s = m_stats[service];
+    if (s.idleSince < 0.0) return;
+
+    unsigned int bin = binFor(std::max(now - s.idleSince, 0.0));
+    if (bin < kBins) s.bins[bin]++;
+    else s.outOfRange++;
+    s.samples++;
+
+    if (s.samples >= AGE_SAMPLES) {
+        s.samples = 0;
+        for (unsigned int i = 0; i < kBins; i++) {
+            s.bins[i] /= 2;
+            s.samples += s.bins[i];
+        }
+        s.outOfRange /= 2;
+        s.samples += s.outOfRange;
+    }
+
+    s.idleSince = -1.0;
+    s.prewarmed = false;
+}
+
+void
+KeepAlivePolicy::idle(const std::string & service, double now)
+{
+    Stats & s = m_stats[service];
+    s.idleSince = now;
+    s.prewarmed = false;
+}
+
+void
+KeepAlivePolicy::spawned(const std::string & service, double secs)
+{
+    Stats & s = m_stats[service];
+    if (s.spawnSecs == 0.0) s.spawnSecs = secs;
+    else s.spawnSecs += (secs - s.spawnSecs) / 4.0;
+}
+
+void
+KeepAlivePolicy::prewarmed(const std::string & service)
+{
+    m_stats[service].prewarmed = true;
+}
+
+double
+KeepAlivePolicy::idleDeadline(const std::string & service,
+                              int shutdownDelaySecs) const
+{
+    const Stats * s = find(service);
+    if (!s || s->idleSince < 0.0) return -1.0;
+
+    double hold = (shutdownDelaySecs > 0) ? (double) shutdownDelaySecs : 0.0;
+    double start, end;
+    if (window(*s, start, end) && (start == 0.0 || s->prewarmed)) {
+        hold = std::max(hold, end);
+    }
+    return s->idleSince + hold;
+}
+
+double
+KeepAlivePolicy::prewarmTime(const std::string & service) const
+{
+    const Stats * s = find(service);
+    if (!s || s->idleSince < 0.0 || s->prewarmed) return -1.0;
+
+    double start, end;
+    if (!window(*s, start, end) || start == 0.0) return -1.0;
+    return s->idleSince + start;
+}
+
+double
+KeepAlivePolicy::budgetTime(const std::string & service,
+                            int shutdownDelaySecs) const
+{
+    const Stats * s = find(service);
+    if (!s || s->idleSince < 0.0) return -1.0;
+
+    double from = (shutdownDelaySecs > 0) ? (double) shutdownDelaySecs : 0.0;
+    double start, end;
+    if (window(*s, start, end) && start == 0.0) {
+        from = std::max(from, BUDGET_GRACE_SECS);
+    }
+    return s->idleSince + from;
+}
+
+void
+KeepAlivePolicy::overBudget(const std::map<std::string, int> & idleRunners,
+                            double now,
+                            std::vector<std::string> & oVictims) const
+{
+    oVictims.clear();
+
+    // only runners held past their manifest delay and grace period
+    // count against the budget, the manifest is always honored
+    std::vector<std::pair<double, std::string> > held;
+    std::map<std::string, int>::const_iterator i;
+    for (i = idleRunners.begin(); i != idleRunners.end(); ++i) {
+        double from = budgetTime(i->first, i->second);
+        if (from < 0.0 || now <= from) continue;
+        const Stats * s = find(i->first);
+        double idleFor = now - s->idleSince;
+
+        // a prewarmed runner was started early on purpose, it's judged
+        // by its chance of use before its window closes
+        double to = idleFor + VALUE_HORIZON_SECS, start, end;
+        if (s->prewarmed && window(*s, start, end)) to = std::max(to, end);
+        double value = likelihood(*s, idleFor, to)
+            * std::max(s->spawnSecs, 0.1);
+        held.push_back(std::make_pair(value, i->first));
+    }
+
+    if (held.size() <= m_budget) return;
+    std::sort(held.begin(), held.end());
+    for (size_t j = 0; j < held.size() - m_budget; j++) {
+        oVictims.push_back(held[j].second);
+    }
+}
@@ -31,11 +31,14 @@
 #ifndef __DYNAMICSERVICEMANAGER_H__
 #define __DYNAMICSERVICEMANAGER_H__
 
+#include <list>
+#include <set>
 #include "ServiceRunnerLib/ServiceRunnerLib.h"
 #include "ServiceInstance.h"
 #include "ServiceExecutionContext.h"
 #include "DynamicServiceInstance.h"
 #include "DynamicServiceState.h"
+#include "ServiceSpec.h"
 
 
 /**
@@ -55,6 +58,33 @@ class DynamicServiceManager : public ServiceRunner::IControllerListener
      */
     void setPluginDirectory(const boost::filesystem::path & path);
 
+    /**
+     * Whether trusted services which ask to may be run inside this
+     * process rather than spawned.  On by default.
+     */
+    void setInProcessServices(bool enabled);
+
+    /**
+     * Whether v5 services which declare themselves shareable may run
+     * together in a single spawned host process rather than one
+     * process each.  Off by default.
+     */
+    void setSharedServiceHost(bool enabled);
+
+    /**
+     * Names of services which always get a process of their own,
+     * whatever their manifests declare.
+     */
+    void setIsolatedServices(const std::list<std::string> & names);
+
+    /**
+     * How many idle services may be kept running, or started ahead
+     * of use, on the strength of past use beyond what their manifests
+     * ask for.  Zero keeps idle services only as long as their
+     * manifests ask.
+     */
+    void setIdleServiceBudget(unsigned int budget);
+
     /**
      * Clear all plugin directories
      */
@@ -89,6 +119,16 @@ class DynamicServiceManager : public ServiceRunner::IControllerListener
     bool haveService(const std::string & name, const std::string & version,
                      const std::string & minversion);
 
+    /**
+     * Find the best match for each of several specs in a single pass
+     * over installed services.  On return, each output vector has
+     * one entry per spec.
+     */
+    void resolve(const std::vector<ServiceSpec> & specs,
+                 std::vector<bool> & oFound,
+                 std::vector<bp::service::Summary> & oSummaries,
+                 std::vector<bp::service::Description> & oDescriptions);
+
     /*
      * Attain a list of all summaries
      */
@@ -153,6 +193,17 @@ class DynamicServiceManager : public ServiceRunner::IControllerListener
     // client to correlate
     unsigned int m_instantiateId;
 
+    // whether trusted services may run in process
+    bool m_inProcessServices;
+
+    // whether shareable services may run in a shared host, the
+    // services which may not, and the current host.  the host lives
+    // as long as any Controller it hosts.
+    bool m_sharedServiceHost;
+    std::set<std::string> m_isolatedServices;
+    std::tr1::weak_ptr<ServiceRunner::SharedHost> m_sharedHost;
+    bool shareable(const bp::service::Summary & summary);
+
     // search the m_services map and find a service satisfying the
     // require specification
     bool internalFind(const std::string & name,
@@ -165,6 +216,17 @@ class DynamicServiceManager : public ServiceRunner::IControllerListener
     // complex state
     DynamicServiceState m_state;
 
+    // start a controller for the service, in process if it's trusted
+    // to run there.  returns an empty pointer on failure.
+    std::tr1::shared_ptr<ServiceRunner::Controller>
+        startController(const bp::service::Summary & summary,
+                        const std::string & locale);
+
+    // start a stopped service ahead of its predicted use, called by
+    // m_state's idle timer
+    friend class DynamicServiceState;
+    void prewarm(const bp::service::Summary & summary);
+
     // start an allocation, adding to running allocations
     void startAllocation(std::tr1::shared_ptr<ServiceRunner::Controller> c,    
                          std::tr1::shared_ptr<DynamicServiceInstance> instance,   
@@ -38,7 +38,9 @@
 #include "ServiceExecutionContext.h"
 #include "ServiceRegistry.h"
 #include "DynamicServiceInstance.h"
+#include "KeepAlivePolicy.h"
 
+class DynamicServiceManager;
 
 class DynamicServiceState : public bp::time::ITimerListener
 {
@@ -122,16 +124,62 @@ class DynamicServiceState : public bp::time::ITimerListener
     // This call causes an abrupt stopping of services, it will not
     // respect 'shutdownDelaySecs' parameters
     void stopService(const bp::service::Summary & summary);
-    
+
+    // an instance of the service has been requested, whether or not
+    // it's running.  This is what the keep alive policy learns from.
+    void noteUse(const bp::service::Summary & summary);
+
+    // record a controller started ahead of use, with no allocations
+    // waiting on it
+    void addPrewarm(
+        std::tr1::shared_ptr<ServiceRunner::Controller> controller,
+        const bp::service::Summary & summary);
+
+    // a prewarmed controller has initialized, hold it as idle until
+    // it's used or its time is up
+    void addIdleController(
+        std::tr1::shared_ptr<ServiceRunner::Controller> controller,
+        const bp::service::Summary & summary);
+
+    // the number of idle runners which may be held beyond their
+    // manifest delay, see KeepAlivePolicy.  Zero restores plain
+    // manifest driven shutdown.
+    void setIdleBudget(unsigned int budget);
+
+    // the manager which is asked to prewarm services
+    void setManager(DynamicServiceManager * manager);
+
   private:
     // a timer and callback function which will be invoked when the timer
-    // expires.  This timer is used for services with delayed shutdown
-    // parameters specified in their manifest
+    // expires.  This timer is used for idle services held by the keep
+    // alive policy or their manifest, and for prewarming
     void timesUp(bp::time::Timer * t);
     bp::time::Timer m_delayedShutdownTimer;
     // set the idle check to the soonest required time, or not at all
     void rescheduleIdleCheck();
 
+    // decides how long idle services are held and when stopped ones
+    // are prewarmed, driven by seconds on m_clock
+    KeepAlivePolicy m_policy;
+    bp::time::Stopwatch m_clock;
+    double now();
+    static std::string policyKey(const bp::service::Summary & summary);
+
+    // shut down idle services the policy would rather not hold
+    void enforceIdleBudget();
+
+    // shut down an idle service, remembering it if it's to be
+    // prewarmed later
+    void stopIdle(const bp::service::Summary & summary);
+
+    DynamicServiceManager * m_manager;
+
+    // how long starting each pending controller has taken
+    std::map<bp::service::Summary, bp::time::Stopwatch> m_spawnTimers;
+
+    // stopped services awaiting prewarming
+    std::set<bp::service::Summary> m_dormant;
+
     // a map containing half-birthed instances, which are waiting for
     // a controller to be initialized.  We own these instances.
     typedef std::pair<std::tr1::shared_ptr<ServiceRunner::Controller>,
@@ -149,8 +197,6 @@ class DynamicServiceState : public bp::time::ITimerListener
         std::tr1::shared_ptr<ServiceRunner::Controller> controller;
         // a set of all of the active instances
         std::set<DynamicServiceInstance *> instances;
-        // the time since the last instance was destroyed
-        bp::time::Stopwatch idleTime;
     };
 
     typedef std::map<bp::service::Summary, ControllerContext> ControllerMap;
@@ -0,0 +1,137 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * KeepAlivePolicy
+ *
+ * Decides how long an idle service runner is kept before it's shut
+ * down, and when a stopped one should be started again ahead of
+ * need.  For each service it keeps a histogram of how long the
+ * service sat idle before it was wanted again, and what starting it
+ * costs.  A service is held idle long enough to cover nearly all of
+ * its past gaps, or if it's never wanted again quickly but is wanted
+ * regularly, stopped and prewarmed shortly before it's next due.  The
+ * idle runners so kept are limited to a budget, runners least likely
+ * to be wanted soon are shut down first.
+ *
+ * The policy holds no timers and reads no clock, callers pass in the
+ * time (in seconds, from any fixed origin), so that it may be driven
+ * by a simulation as easily as by DynamicServiceState.
+ */
+
+#ifndef __KEEPALIVEPOLICY_H__
+#define __KEEPALIVEPOLICY_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+class KeepAlivePolicy
+{
+  public:
+    // idleBudget is the number of idle runners which may be held
+    // beyond their manifest delay and a short grace period, or
+    // prewarmed.  Zero disables adaptive keep alive and prewarming
+    // altogether.
+    KeepAlivePolicy(unsigned int idleBudget = 4);
+
+    void setIdleBudget(unsigned int idleBudget);
+    unsigned int idleBudget() const { return m_budget; }
+
+    // longest we'll hold an idle runner on a prediction
+    static const double kMaxHoldSecs;
+
+    // an instance of the service was requested
+    void used(const std::string & service, double now);
+
+    // the last instance of a running service went away
+    void idle(const std::string & service, double now);
+
+    // starting a runner for the service took secs
+    void spawned(const std::string & service, double secs);
+
+    // a runner for the service was started ahead of use
+    void prewarmed(const std::string & service);
+
+    // when an idle runner for the service should be shut down.
+    // -1 if the service isn't idle.
+    double idleDeadline(const std::string & service,
+                        int shutdownDelaySecs) const;
+
+    // when a stopped service should be started ahead of use, -1 if
+    // it shouldn't be
+    double prewarmTime(const std::string & service) const;
+
+    // when an idle runner for the service begins to count against
+    // the budget, -1 if the service isn't idle
+    double budgetTime(const std::string & service,
+                      int shutdownDelaySecs) const;
+
+    // given the idle runners (service to manifest shutdown delay),
+    // those which should be shut down now to stay within budget,
+    // least valuable first
+    void overBudget(const std::map<std::string, int> & idleRunners,
+                    double now,
+                    std::vector<std::string> & oVictims) const;
+
+  private:
+    // idle gaps are binned on a log scale, bin i holding gaps up to
+    // kBinBase^(i+1) seconds, which spans a little under five hours
+    enum { kBins = 200 };
+    static const double kBinBase;
+
+    struct Stats {
+        Stats();
+        // histogram of idle gaps, and gaps too long for it
+        unsigned short bins[kBins];
+        unsigned int outOfRange;
+        unsigned int samples;
+        // smoothed time to start a runner
+        double spawnSecs;
+        // when the last instance went away, -1 while in use
+        double idleSince;
+        // started ahead of use since last idle
+        bool prewarmed;
+    };
+
+    std::map<std::string, Stats> m_stats;
+    unsigned int m_budget;
+
+    const Stats * find(const std::string & service) const;
+
+    static unsigned int binFor(double gap);
+    static double binStart(unsigned int bin);
+    static double binEnd(unsigned int bin);
+    // the bin in which the pth fraction of gaps falls, kBins if
+    // beyond the histogram
+    static unsigned int percentile(const Stats & s, double p);
+    // the fraction of gaps between a and b seconds, of those longer
+    // than a
+    static double likelihood(const Stats & s, double a, double b);
+
+    // the window after going idle during which the service should be
+    // running, false if we can't predict one.  start is non-zero if
+    // the service should be stopped and prewarmed.
+    bool window(const Stats & s, double & start, double & end) const;
+};
+
+#endif
@@ -177,6 +177,26 @@ ServiceRegistry::haveService(const std::string & name,
     return m_dynamicManager->haveService(name, version, minversion);
 }
 
+void
+ServiceRegistry::resolve(const std::vector<ServiceSpec> & specs,
+                         std::vector<bool> & oFound,
+                         std::vector<bp::service::Summary> & oSummaries,
+                         std::vector<bp::service::Description> & oDescriptions)
+{
+    m_dynamicManager->resolve(specs, oFound, oSummaries, oDescriptions);
+
+    // built-in services take precedence, as in describe()
+    for (size_t i = 0; i < specs.size(); i++) {
+        DescFactPair reg = getReg(specs[i].m_name, specs[i].m_version,
+                                  specs[i].m_minversion);
+        if (reg.second != NULL) {
+            oFound[i] = true;
+            oSummaries[i] = reg.second->summary();
+            oDescriptions[i] = reg.first;
+        }
+    }
+}
+
 struct CRInstanceContext
 {
     shared_ptr<ServiceInstance> inst;
@@ -310,3 +330,27 @@ ServiceRegistry::setPluginDirectory(const boost::filesystem::path & path)
 {
     m_dynamicManager->setPluginDirectory(path);
 }
+
+void
+ServiceRegistry::setInProcessServices(bool enabled)
+{
+    m_dynamicManager->setInProcessServices(enabled);
+}
+
+void
+ServiceRegistry::setSharedServiceHost(bool enabled)
+{
+    m_dynamicManager->setSharedServiceHost(enabled);
+}
+
+void
+ServiceRegistry::setIsolatedServices(const std::list<std::string> & names)
+{
+    m_dynamicManager->setIsolatedServices(names);
+}
+
+void
+ServiceRegistry::setIdleServiceBudget(unsigned int budget)
+{
+    m_dynamicManager->setIdleServiceBudget(budget);
+}
@@ -35,6 +35,7 @@
 #include "ServiceManager/ServiceExecutionContext.h"
 #include "ServiceManager/ServiceInstance.h"
 #include "ServiceManager/ServiceFactory.h"
+#include "ServiceManager/ServiceSpec.h"
 
 
 class IServiceRegistryListener  
@@ -70,6 +71,27 @@ public:
      */
     void setPluginDirectory(const boost::filesystem::path & path);
 
+    /**
+     * Whether trusted services may run inside this process rather
+     * than being spawned.  On by default.
+     */
+    void setInProcessServices(bool enabled);
+
+    /**
+     * Whether shareable services may run together in one spawned
+     * host process, and those which never may.  See
+     * DynamicServiceManager::setSharedServiceHost.
+     */
+    void setSharedServiceHost(bool enabled);
+    void setIsolatedServices(const std::list<std::string> & names);
+
+    /**
+     * How many idle services may be held running, or started ahead
+     * of use, beyond what their manifests ask for.  See
+     * DynamicServiceManager::setIdleServiceBudget.
+     */
+    void setIdleServiceBudget(unsigned int budget);
+
    /**
      * By default the ServiceManager library is conservative with
      * touching the disk to rescan services.  This means that any
@@ -137,6 +159,17 @@ public:
     bool haveService(const std::string & name,
                      const std::string & version,
                      const std::string & minversion);
+
+    /**
+     * Resolve several services at once, with a single pass over
+     * installed services.  On return, each output vector has one
+     * entry per spec, and oFound[i] tells whether specs[i] is
+     * available.
+     */
+    void resolve(const std::vector<ServiceSpec> & specs,
+                 std::vector<bool> & oFound,
+                 std::vector<bp::service::Summary> & oSummaries,
+                 std::vector<bp::service::Description> & oDescriptions);
     
     /** 
      * asynchronously instantiate an instance of a service.  This will
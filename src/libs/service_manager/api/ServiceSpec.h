@@ -0,0 +1,51 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ServiceSpec.h
+ *
+ * A (name, version, minversion) tuple identifying the service wanted
+ * by a client.  Empty version strings match any version.
+ */
+
+#ifndef __SERVICESPEC_H__
+#define __SERVICESPEC_H__
+
+#include <string>
+
+class ServiceSpec
+{
+  public:
+    ServiceSpec() { }
+    ServiceSpec(const std::string & name,
+                const std::string & version,
+                const std::string & minversion)
+        : m_name(name), m_version(version), m_minversion(minversion)
+    {
+    }
+
+    std::string m_name;
+    std::string m_version;
+    std::string m_minversion;
+};
+
+#endif
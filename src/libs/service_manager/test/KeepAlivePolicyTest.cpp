@@ -0,0 +1,156 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * KeepAlivePolicyTest.cpp
+ * Replays fixed traces of service use against the KeepAlivePolicy,
+ * counting uses which found a runner waiting and those which didn't.
+ * A prewarmed runner takes the service's start time before it can be
+ * used.  The policy needs four gaps before it predicts anything, so
+ * the first five uses of every trace start cold.
+ */
+
+#include "KeepAlivePolicyTest.h"
+#include "ServiceManager/KeepAlivePolicy.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(KeepAlivePolicyTest);
+
+// the trace advances a tenth of a second at a time
+#define TICKS_PER_SEC 10
+
+struct Replay {
+    Replay() : hits(0), misses(0), prewarms(0) { }
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int prewarms;
+};
+
+// count uses of a service used for busySecs every periodSecs,
+// starting a runner for which takes spawnSecs
+static Replay
+replay(KeepAlivePolicy & policy, unsigned int uses, unsigned int periodSecs,
+       unsigned int busySecs, unsigned int spawnSecs,
+       int shutdownDelaySecs)
+{
+    enum { Stopped, Starting, Idle, Busy } state = Stopped;
+    const std::string name("Service");
+    const unsigned int period = periodSecs * TICKS_PER_SEC;
+    const unsigned int busy = busySecs * TICKS_PER_SEC;
+    const unsigned int spawn = spawnSecs * TICKS_PER_SEC;
+    unsigned int busyUntil = 0, readyAt = 0;
+    Replay r;
+
+    // up to the end of the last use
+    unsigned int end = (uses - 1) * period + busy;
+    for (unsigned int tick = 0; tick <= end; tick++) {
+        double now = (double) tick / TICKS_PER_SEC;
+
+        if (state == Starting && tick >= readyAt) state = Idle;
+        if (state == Busy && tick >= busyUntil) {
+            state = Idle;
+            policy.idle(name, now);
+        }
+
+        if (tick % period == 0) {
+            policy.used(name, now);
+            if (state == Idle) {
+                r.hits++;
+            } else {
+                r.misses++;
+                if (state == Stopped) policy.spawned(name, spawnSecs);
+            }
+            state = Busy;
+            busyUntil = tick + busy;
+        }
+
+        if (state == Idle &&
+            policy.idleDeadline(name, shutdownDelaySecs) <= now)
+        {
+            state = Stopped;
+        }
+
+        if (state == Stopped) {
+            double t = policy.prewarmTime(name);
+            if (t >= 0.0 && t <= now) {
+                state = Starting;
+                readyAt = tick + spawn;
+                r.prewarms++;
+                policy.prewarmed(name);
+                policy.spawned(name, spawnSecs);
+            }
+        }
+    }
+    return r;
+}
+
+void
+KeepAlivePolicyTest::fixedDelay()
+{
+    // no budget, the manifest delay alone decides
+    KeepAlivePolicy policy(0);
+    Replay r = replay(policy, 10, 20, 5, 2, 0);
+    CPPUNIT_ASSERT_EQUAL(0u, r.hits);
+    CPPUNIT_ASSERT_EQUAL(10u, r.misses);
+    CPPUNIT_ASSERT_EQUAL(0u, r.prewarms);
+
+    KeepAlivePolicy held(0);
+    r = replay(held, 10, 20, 5, 2, 30);
+    CPPUNIT_ASSERT_EQUAL(9u, r.hits);
+    CPPUNIT_ASSERT_EQUAL(1u, r.misses);
+    CPPUNIT_ASSERT_EQUAL(0u, r.prewarms);
+}
+
+void
+KeepAlivePolicyTest::holdsForShortGaps()
+{
+    // idle 15s between uses, well within reach of holding the runner
+    KeepAlivePolicy policy;
+    Replay r = replay(policy, 10, 20, 5, 2, 0);
+    CPPUNIT_ASSERT_EQUAL(5u, r.hits);
+    CPPUNIT_ASSERT_EQUAL(5u, r.misses);
+    CPPUNIT_ASSERT_EQUAL(0u, r.prewarms);
+}
+
+void
+KeepAlivePolicyTest::prewarmsForLongGaps()
+{
+    // idle nearly ten minutes between uses, the runner is stopped and
+    // started again ahead of each
+    KeepAlivePolicy policy;
+    Replay r = replay(policy, 10, 600, 5, 2, 0);
+    CPPUNIT_ASSERT_EQUAL(5u, r.hits);
+    CPPUNIT_ASSERT_EQUAL(5u, r.misses);
+    CPPUNIT_ASSERT_EQUAL(5u, r.prewarms);
+}
+
+void
+KeepAlivePolicyTest::prewarmLeadCoversSlowStarts()
+{
+    // a runner taking a minute to start is prewarmed early enough to
+    // be ready in time, started only a little ahead of the window it
+    // would still be starting when wanted
+    KeepAlivePolicy policy;
+    Replay r = replay(policy, 10, 600, 5, 60, 0);
+    CPPUNIT_ASSERT_EQUAL(5u, r.hits);
+    CPPUNIT_ASSERT_EQUAL(5u, r.misses);
+    CPPUNIT_ASSERT_EQUAL(5u, r.prewarms);
+}
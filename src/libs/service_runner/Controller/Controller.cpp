@@ -34,8 +34,11 @@
 #include "BPUtils/bpfile.h"
 #include "BPUtils/BPLog.h"
 #include "platform_utils/ProductPaths.h"
+#include "InProcessService.h"
+#include "OutputRing.h"
 #include "Process.h"
 #include "ServiceServer.h"
+#include "SharedHost.h"
 
 
 using namespace ServiceRunner;
@@ -52,9 +55,11 @@ Controller::Controller(const std::string & service,
     m_spawnStatus(),
     m_listener(NULL),
     m_sw(),
+    m_library(0),
     m_chan(),
     m_id(0),
     m_spawnCheckTimer(),
+    m_childWatcher(),
     m_everConnected(false),
     m_processExitCode(0),
     m_chanTermReason(bp::ipc::IConnectionListener::InternalError),
@@ -74,9 +79,11 @@ Controller::Controller(const bfs::path & path) :
     m_spawnStatus(),
     m_listener(NULL),
     m_sw(),
+    m_library(0),
     m_chan(),
     m_id(0),
     m_spawnCheckTimer(),
+    m_childWatcher(),
     m_everConnected(false),
     m_processExitCode(0),
     m_chanTermReason(bp::ipc::IConnectionListener::InternalError),
@@ -87,6 +94,12 @@ Controller::Controller(const bfs::path & path) :
 
 Controller::~Controller()
 {
+    // unloads an in process service before anything it may refer to
+    m_inProcess.reset();
+
+    if (m_host != NULL && m_library != 0) m_host->unload(m_library);
+    m_host.reset();
+
     if (m_pid && m_chan) {
 //        std::cout << "waiting on " << m_pid << std::endl;
         m_chan.reset();
@@ -98,11 +111,15 @@ Controller::~Controller()
     
     m_spawnCheckTimer.setListener(NULL);
     m_spawnCheckTimer.cancel();
+    m_childWatcher.setListener(NULL);
+    m_childWatcher.cancel();
 
     m_serviceConnector.reset();
 
     // Delete any temp dirs that may have been left around by the service.
     std::for_each(m_tempDirs.begin(), m_tempDirs.end(), bp::file::safeRemove);
+
+    if (!m_outputRing.empty()) (void) bpf::safeRemove(m_outputRing);
 }
 
 void
@@ -178,6 +195,12 @@ Controller::run(const bfs::path & pathToHarness,
         args.push_back("-logfile");    
         args.push_back(bpf::nativeUtf8String(bpf::absolutePath(logFile)));
     }
+
+    // the service captures its output in a ring mapped from this
+    // file, which we read back should it die on us
+    m_outputRing = bpf::getTempPath(bpf::getTempDirectory(), "BPOutput");
+    args.push_back("-outputRing");
+    args.push_back(bpf::nativeUtf8String(m_outputRing));
     
     m_sw.reset();
     m_sw.start();    
@@ -192,10 +215,13 @@ Controller::run(const bfs::path & pathToHarness,
                         << m_serviceConnector->ipcName());
         m_pid = m_spawnStatus.pid;
 
-        // now let's set up our poller to poll the status of the spawned
-        // process until we get an ipc connection established
-        m_spawnCheckTimer.setListener(this);
-        m_spawnCheckTimer.setMsec(200);
+        // now let's watch the spawned process until we get an ipc
+        // connection established, polling its status where we can't
+        m_childWatcher.setListener(this);
+        if (!m_childWatcher.watchExit(m_spawnStatus)) {
+            m_spawnCheckTimer.setListener(this);
+            m_spawnCheckTimer.setMsec(200);
+        }
     }
     else
     {
@@ -208,6 +234,142 @@ Controller::run(const bfs::path & pathToHarness,
     return true;
 }
 
+bool
+Controller::runInProcess(const bfs::path & providerPath, std::string & err)
+{
+    if (m_pid != 0 || m_id != 0 || m_inProcess != NULL) {
+        err.append("Controller::runInProcess apparently called twice");
+        return false;
+    }
+
+    if (!bpf::isDirectory(m_path)) {
+        err.append("no such directory: ");
+        err.append(m_path.string());
+        return false;
+    }
+
+    m_sw.reset();
+    m_sw.start();
+
+    m_inProcess.reset(new InProcessService(this));
+    if (!m_inProcess->start(m_path, providerPath, err)) {
+        m_inProcess.reset();
+        return false;
+    }
+    return true;
+}
+
+bool
+Controller::runShared(std::tr1::shared_ptr<SharedHost> host,
+                      const bfs::path & pathToHarness,
+                      const bfs::path & providerPath,
+                      const std::string & serviceTitle,
+                      const std::string & logLevel,
+                      const bfs::path & logFile,
+                      std::string & err)
+{
+    if (m_pid != 0 || m_id != 0 || m_inProcess != NULL || m_host != NULL) {
+        err.append("Controller::runShared apparently called twice");
+        return false;
+    }
+
+    if (!bpf::isDirectory(m_path)) {
+        err.append("no such directory: ");
+        err.append(m_path.string());
+        return false;
+    }
+
+    if (host == NULL || !host->alive()) {
+        err.append("shared host isn't running");
+        return false;
+    }
+
+    m_fallback.harness = pathToHarness;
+    m_fallback.provider = providerPath;
+    m_fallback.title = serviceTitle;
+    m_fallback.logLevel = logLevel;
+    m_fallback.logFile = logFile;
+
+    m_sw.reset();
+    m_sw.start();
+
+    m_host = host;
+    m_host->load(shared_from_this(), m_path, providerPath);
+    return true;
+}
+
+int
+Controller::pid()
+{
+    if (m_host != NULL) return m_host->pid();
+    return m_pid;
+}
+
+void
+Controller::onSharedLoaded(unsigned int library, const std::string & name,
+                           const std::string & version,
+                           unsigned int apiVersion)
+{
+    m_library = library;
+    BPLOG_INFO_STRM("Loaded " << name << " v" << version
+                    << " in shared host (pid " << m_host->pid() << ") in "
+                    << m_sw.elapsedSec() << "s");
+    onLoaded(name, version, apiVersion);
+}
+
+void
+Controller::onSharedLoadFailed(const std::string & err)
+{
+    BPLOG_WARN_STRM("shared host couldn't load " << friendlyServiceName()
+                    << (err.empty() ? "" : ": ") << err
+                    << ", spawning it instead");
+    m_host.reset();
+    m_library = 0;
+
+    std::string runErr;
+    if (!run(m_fallback.harness, m_fallback.provider, m_fallback.title,
+             m_fallback.logLevel, m_fallback.logFile, runErr))
+    {
+        BPLOG_ERROR_STRM("couldn't spawn " << friendlyServiceName()
+                         << ": " << runErr);
+        // this callback may delete us
+        if (m_listener) m_listener->onEnded(this);
+    }
+}
+
+void
+Controller::onSharedHostEnded()
+{
+    BPLOG_ERROR_STRM("shared host of " << friendlyServiceName()
+                     << " went away");
+    m_host.reset();
+    m_library = 0;
+
+    // this callback may delete us
+    if (m_listener) m_listener->onEnded(this);
+}
+
+bool
+Controller::connected()
+{
+    if (m_host != NULL) return m_library != 0;
+    return m_chan != NULL;
+}
+
+bool
+Controller::sendQuery(bp::ipc::Query & q)
+{
+    if (m_host != NULL) return m_library && m_host->sendQuery(m_library, q);
+    return m_chan != NULL && m_chan->sendQuery(q);
+}
+
+bool
+Controller::sendMessage(bp::ipc::Message & m)
+{
+    if (m_host != NULL) return m_library && m_host->sendMessage(m_library, m);
+    return m_chan != NULL && m_chan->sendMessage(m);
+}
+
 void
 Controller::timesUp(bp::time::Timer *)
 {
@@ -215,29 +377,67 @@ Controller::timesUp(bp::time::Timer *)
     // got a connection yet, has the process exited?
     int exitCode = 0;
     if (bp::process::wait(m_spawnStatus, false, exitCode)) {
-        BPLOG_ERROR_STRM("Spawned service process exited with code: "
-                         << exitCode);
-        m_spawnCheckTimer.cancel();
-
-        m_processExitCode = exitCode;
-        
-        // this callback may delete us
-        if (m_listener) {
-            m_listener->onEnded(this);
-        }
+        spawnedProcessExited(exitCode);
     } else {
         // perform another check in 200ms.
         m_spawnCheckTimer.setMsec(200);        
     }
 }
 
+void
+Controller::childExited(bp::process::ChildWatcher *, int exitCode)
+{
+    spawnedProcessExited(exitCode);
+}
+
+void
+Controller::spawnedProcessExited(int exitCode)
+{
+    BPLOG_ERROR_STRM("Spawned service process exited with code: "
+                     << exitCode);
+    m_spawnCheckTimer.cancel();
+    m_childWatcher.cancel();
+    logRecentOutput();
+
+    m_processExitCode = exitCode;
+        
+    // this callback may delete us
+    if (m_listener) {
+        m_listener->onEnded(this);
+    }
+}
+
+void
+Controller::logRecentOutput()
+{
+    if (m_outputRing.empty()) return;
+
+    std::vector<std::string> lines;
+    unsigned int dropped = 0;
+    if (!OutputRing::recent(m_outputRing, 50, lines, dropped) ||
+        lines.empty())
+    {
+        return;
+    }
+
+    BPLOG_ERROR_STRM("last " << lines.size() << " lines of output from "
+                     << friendlyServiceName() << " that never reached the log"
+                     << (dropped ? " (some output was dropped)" : "")
+                     << ":");
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        BPLOG_ERROR_STRM("    " << lines[i]);
+    }
+}
+
 void
 Controller::describe()
 {
-    if (m_chan != NULL) {
+    if (m_inProcess != NULL) {
+        m_inProcess->describe();
+    } else if (connected()) {
         bp::ipc::Query q;
         q.setCommand("getDescription");
-        (void) m_chan->sendQuery(q);
+        (void) sendQuery(q);
     } else {
         // TODO: return a failure code?
     }
@@ -252,7 +452,14 @@ Controller::allocate(const std::string & uri,
                      const std::string & userAgent,
                      unsigned int clientPid)
 {
-    if (m_chan != NULL)
+    if (m_inProcess != NULL)
+    {
+        unsigned int id = m_inProcess->allocate(uri, data_dir, temp_dir,
+                                                locale, userAgent, clientPid);
+        if (id != (unsigned int) -1) m_tempDirs.push_back(temp_dir);
+        return id;
+    }
+    else if (connected())
     {
         bp::Map context;
         context.add("uri", new bp::String(
@@ -271,7 +478,7 @@ Controller::allocate(const std::string & uri,
         bp::ipc::Query q;
         q.setCommand("allocate");
         q.setPayload(context.clone());
-        if (!m_chan->sendQuery(q)) {
+        if (!sendQuery(q)) {
             return (unsigned int) -1;
         }
         m_tempDirs.push_back(temp_dir);
@@ -285,14 +492,16 @@ Controller::allocate(const std::string & uri,
 void
 Controller::destroy(unsigned int id)
 {
-    if (m_chan != NULL) {
+    if (m_inProcess != NULL) {
+        m_inProcess->destroy(id);
+    } else if (connected()) {
         bp::ipc::Message m;
         m.setCommand("destroy");
         m.setPayload(new bp::Integer(id));
 
         // TODO: should this be a sendQuery so we can know when
         // service is unloaded?
-        (void) m_chan->sendMessage(m);
+        (void) sendMessage(m);
     } else {
         // TODO: we do not convey this condition to the client
     }
@@ -303,7 +512,10 @@ Controller::invoke(unsigned int instanceId,
                    const std::string & function,
                    const bp::Object * arguments)
 {
-    if (m_chan != NULL) {
+    if (m_inProcess != NULL) {
+        return m_inProcess->invoke(instanceId, function, arguments);
+    }
+    if (connected()) {
         bp::ipc::Query q;
         q.setCommand("invoke");
         bp::Map * payload = new bp::Map;
@@ -313,7 +525,7 @@ Controller::invoke(unsigned int instanceId,
         }
         payload->add("instance", new bp::Integer(instanceId));
         q.setPayload(payload);
-        if (m_chan->sendQuery(q)) return q.id();
+        if (sendQuery(q)) return q.id();
     }
     return (unsigned int) -1;
 }
@@ -325,14 +537,18 @@ Controller::installHook(const boost::filesystem::path& serviceDir,
 {
     try {
         if (m_apiVersion < 5) throw "not supported";
-        if (m_chan == NULL) throw "No channel";
+        if (m_inProcess != NULL) {
+            m_inProcess->installHook(serviceDir, tempDir);
+            return;
+        }
+        if (!connected()) throw "No channel";
         bp::ipc::Query q;
         q.setCommand("installHook");
         bp::Map* payload = new bp::Map;
         payload->add("serviceDir", new bp::Path(serviceDir));
         payload->add("tempDir", new bp::Path(tempDir));
         q.setPayload(payload);
-        (void) m_chan->sendQuery(q);
+        (void) sendQuery(q);
     } catch (const char* s) {
         BPLOG_ERROR_STRM("installHook cannot be called: " << s);
         if (m_listener) {
@@ -348,14 +564,18 @@ Controller::uninstallHook(const boost::filesystem::path& serviceDir,
 {
     try {
         if (m_apiVersion < 5) throw "not supported";
-        if (m_chan == NULL) throw "No channel";
+        if (m_inProcess != NULL) {
+            m_inProcess->uninstallHook(serviceDir, tempDir);
+            return;
+        }
+        if (!connected()) throw "No channel";
         bp::ipc::Query q;
         q.setCommand("uninstallHook");
         bp::Map* payload = new bp::Map;
         payload->add("serviceDir", new bp::Path(serviceDir));
         payload->add("tempDir", new bp::Path(tempDir));
         q.setPayload(payload);
-        (void) m_chan->sendQuery(q);
+        (void) sendQuery(q);
     } catch (const char* s) {
         BPLOG_ERROR_STRM("uninstallHook cannot be called: " << s);
         if (m_listener) {
@@ -369,7 +589,9 @@ void
 Controller::sendResponse(unsigned int promptId,
                          const bp::Object * arguments)
 {
-    if (m_chan != NULL) {
+    if (m_inProcess != NULL) {
+        m_inProcess->sendResponse(promptId, arguments);
+    } else if (connected()) {
         bp::ipc::Message m;
         m.setCommand("promptResponse");
         bp::Map * payload = new bp::Map;
@@ -378,7 +600,7 @@ Controller::sendResponse(unsigned int promptId,
             payload->add("arguments", arguments->clone());
         }
         m.setPayload(payload);
-        (void) m_chan->sendMessage(m);
+        (void) sendMessage(m);
     }
 }
 
@@ -387,15 +609,10 @@ Controller::onConnected(bp::ipc::Channel * c, const std::string & name,
                         const std::string & version,
                         unsigned int apiVersion)
 {
-    m_everConnected = true;
-    
     // no need to check spawn status anymore
     m_spawnCheckTimer.cancel();
+    m_childWatcher.cancel();
 
-    m_service = name;
-    m_version = version;
-    m_apiVersion = apiVersion;
-    
     BPLOG_INFO_STRM("Received connected IPC channel for "
                     << name << " v" << version << " in "
                     << m_sw.elapsedSec() << "s");    
@@ -406,6 +623,24 @@ Controller::onConnected(bp::ipc::Channel * c, const std::string & name,
     // we now will listen to this channel
     m_chan->setListener(this);
 
+    onLoaded(name, version, apiVersion);
+}
+
+void
+Controller::onLoaded(const std::string & name, const std::string & version,
+                     unsigned int apiVersion)
+{
+    m_everConnected = true;
+
+    m_service = name;
+    m_version = version;
+    m_apiVersion = apiVersion;
+
+    if (m_inProcess != NULL) {
+        BPLOG_INFO_STRM("Loaded " << name << " v" << version
+                        << " in process in " << m_sw.elapsedSec() << "s");
+    }
+
     // now let's call our listener
     if (m_listener) {
         m_listener->initialized(this, m_service, m_version, apiVersion);
@@ -419,6 +654,7 @@ Controller::channelEnded(bp::ipc::Channel * c,
 {
     // no need to poll process spawning status, it exited
     m_spawnCheckTimer.cancel();
+    m_childWatcher.cancel();
 
     // the channel fell down!
     BPLOG_ERROR_STRM("IPC channel ended, " <<
@@ -431,6 +667,10 @@ Controller::channelEnded(bp::ipc::Channel * c,
     // TODO: as mentioned below, should we grab process exit code?
     m_chanTermReason = why;
     m_chanTermErrorString = errorString;
+
+    if (why != bp::ipc::IConnectionListener::DisconnectCalled) {
+        logRecentOutput();
+    }
     
     // TODO: we should wait for the child process and return useful
     // information, like processor used, etc.
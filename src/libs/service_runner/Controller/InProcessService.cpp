@@ -0,0 +1,504 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ * Runs a trusted service inside the controlling process.
+ */
+
+#include "InProcessService.h"
+#include <exception>
+#include "BPUtils/BPLog.h"
+
+
+using namespace ServiceRunner;
+namespace bfs = boost::filesystem;
+
+// work for the worker thread
+struct InProcessService::Job
+{
+    enum { T_Load, T_Allocate, T_Destroy, T_Invoke, T_PromptResponse,
+           T_InstallHook, T_UninstallHook } type;
+
+    // allocation, transaction, instance or prompt id
+    unsigned int id;
+    unsigned int instance;
+
+    // function for invoke, uri for allocate
+    std::string name;
+    bp::Object * args;
+
+    // service and provider, data and temp, or service and temp dirs
+    bfs::path path;
+    bfs::path path2;
+
+    std::string locale;
+    std::string userAgent;
+    unsigned int clientPid;
+
+    Job() : type(T_Load), id(0), instance(0), args(NULL), clientPid(0) { }
+    ~Job() { if (args) delete args; }
+};
+
+// results for the controlling thread
+struct InProcessService::Reply
+{
+    enum { T_Loaded, T_Ended, T_Description, T_Allocated, T_Results,
+           T_Error, T_Callback, T_Prompt, T_InstallHook,
+           T_UninstallHook } type;
+
+    // allocation, transaction or prompt id
+    unsigned int id;
+    unsigned int instance;
+    long long int callbackId;
+    int code;
+    bp::Object * o;
+
+    std::string error;
+    std::string verboseError;
+    // api version and description when loaded
+    unsigned int apiVersion;
+    bp::service::Description desc;
+    bfs::path path;
+
+    Reply() : type(T_Ended), id(0), instance(0), callbackId(0), code(0),
+              o(NULL), apiVersion(0) { }
+    ~Reply() { if (o) delete o; }
+};
+
+
+// a reply on its way to the controlling thread
+struct InProcessHop
+{
+    std::tr1::weak_ptr<InProcessService> target;
+    void * reply;
+};
+
+
+InProcessService::InProcessService(Controller * controller)
+    : m_controller(controller), m_desc(), m_lib(NULL), m_thread(),
+      m_nextId(1), m_failed(false), m_hopper(), m_self()
+{
+    m_hopper.initializeOnCurrentThread();
+}
+
+InProcessService::~InProcessService()
+{
+    // atEnd() will have unloaded the service by the time stop() returns
+    if (m_thread.running()) {
+        m_thread.stop();
+        m_thread.join();
+    }
+}
+
+bool
+InProcessService::start(const bfs::path & path,
+                        const bfs::path & providerPath,
+                        std::string & err)
+{
+    if (m_thread.running()) {
+        err.append("InProcessService::start apparently called twice");
+        return false;
+    }
+    m_self = shared_from_this();
+
+    m_thread.setCallBacks(NULL, NULL, atEnd, this, onEvent, this);
+    if (!m_thread.run()) {
+        err.append("couldn't start service thread");
+        return false;
+    }
+
+    Job * j = new Job;
+    j->type = Job::T_Load;
+    j->path = path;
+    j->path2 = providerPath;
+    if (!post(j)) {
+        err.append("couldn't reach service thread");
+        return false;
+    }
+    return true;
+}
+
+void
+InProcessService::describe()
+{
+    Reply * r = new Reply;
+    r->type = Reply::T_Description;
+    reply(r);
+}
+
+unsigned int
+InProcessService::allocate(const std::string & uri,
+                           const bfs::path & dataDir,
+                           const bfs::path & tempDir,
+                           const std::string & locale,
+                           const std::string & userAgent,
+                           unsigned int clientPid)
+{
+    Job * j = new Job;
+    j->type = Job::T_Allocate;
+    j->id = m_nextId++;
+    j->name = uri.empty() ? std::string("bpclient://unknown") : uri;
+    j->path = dataDir;
+    j->path2 = tempDir;
+    j->locale = locale;
+    j->userAgent = userAgent;
+    j->clientPid = clientPid;
+    unsigned int id = j->id;
+    return post(j) ? id : (unsigned int) -1;
+}
+
+void
+InProcessService::destroy(unsigned int id)
+{
+    Job * j = new Job;
+    j->type = Job::T_Destroy;
+    j->instance = id;
+    (void) post(j);
+}
+
+unsigned int
+InProcessService::invoke(unsigned int instanceId,
+                         const std::string & function,
+                         const bp::Object * arguments)
+{
+    Job * j = new Job;
+    j->type = Job::T_Invoke;
+    j->id = m_nextId++;
+    j->instance = instanceId;
+    j->name = function;
+    if (arguments) j->args = arguments->clone();
+    unsigned int id = j->id;
+    return post(j) ? id : (unsigned int) -1;
+}
+
+void
+InProcessService::installHook(const bfs::path & serviceDir,
+                              const bfs::path & tempDir)
+{
+    Job * j = new Job;
+    j->type = Job::T_InstallHook;
+    j->path = serviceDir;
+    j->path2 = tempDir;
+    if (!post(j)) {
+        Reply * r = new Reply;
+        r->type = Reply::T_InstallHook;
+        r->code = -1;
+        reply(r);
+    }
+}
+
+void
+InProcessService::uninstallHook(const bfs::path & serviceDir,
+                                const bfs::path & tempDir)
+{
+    Job * j = new Job;
+    j->type = Job::T_UninstallHook;
+    j->path = serviceDir;
+    j->path2 = tempDir;
+    if (!post(j)) {
+        Reply * r = new Reply;
+        r->type = Reply::T_UninstallHook;
+        r->code = -1;
+        reply(r);
+    }
+}
+
+void
+InProcessService::sendResponse(unsigned int promptId,
+                               const bp::Object * arguments)
+{
+    Job * j = new Job;
+    j->type = Job::T_PromptResponse;
+    j->id = promptId;
+    if (arguments) j->args = arguments->clone();
+    (void) post(j);
+}
+
+bool
+InProcessService::post(Job * job)
+{
+    if (!m_thread.running()
+        || !m_thread.sendEvent(bp::runloop::Event((void *) job)))
+    {
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+void
+InProcessService::onEvent(void * cookie, bp::runloop::Event e)
+{
+    InProcessService * self = (InProcessService *) cookie;
+    Job * job = (Job *) e.payload();
+    bool failed = self->m_failed;
+    try {
+        self->runJob(job);
+    } catch (const std::exception & ex) {
+        BPLOG_ERROR_STRM("in process service threw: " << ex.what());
+        self->m_failed = true;
+    } catch (...) {
+        BPLOG_ERROR("in process service threw an unknown exception");
+        self->m_failed = true;
+    }
+    delete job;
+    job = NULL;
+
+    // a service which has thrown is in no state to be called again,
+    // it's ended as surely as a crashed service process.  say so once.
+    if (self->m_failed && !failed) {
+        Reply * r = new Reply;
+        r->type = Reply::T_Ended;
+        self->reply(r);
+    }
+}
+
+void
+InProcessService::atEnd(void * cookie)
+{
+    InProcessService * self = (InProcessService *) cookie;
+    if (self->m_lib) {
+        try {
+            delete self->m_lib;
+        } catch (...) {
+            BPLOG_ERROR("in process service threw while unloading");
+        }
+        self->m_lib = NULL;
+    }
+}
+
+void
+InProcessService::runJob(Job * job)
+{
+    if (job->type == Job::T_Load) {
+        BPASSERT(m_lib == NULL);
+        std::string err;
+        m_lib = new ServiceLibrary;
+        if (!m_lib->parseManifest(job->path, err)
+            || !m_lib->load(job->path2, err, 5))
+        {
+            BPLOG_ERROR_STRM("Couldn't load " << job->path
+                             << " in process: " << err);
+            delete m_lib;
+            m_lib = NULL;
+            Reply * r = new Reply;
+            r->type = Reply::T_Ended;
+            reply(r);
+            return;
+        }
+        m_lib->setListener(this);
+
+        Reply * r = new Reply;
+        r->type = Reply::T_Loaded;
+        r->desc = m_lib->description();
+        r->apiVersion = m_lib->apiVersion();
+        reply(r);
+        return;
+    }
+
+    if (m_lib == NULL || m_failed) {
+        BPLOG_WARN("call to an in process service which isn't loaded, "
+                   "dropping");
+        return;
+    }
+
+    switch (job->type) {
+        case Job::T_Allocate: {
+            unsigned int instance = m_lib->allocate(
+                job->name, job->path, job->path2, job->locale,
+                job->userAgent, job->clientPid);
+            if (instance == 0) {
+                BPLOG_ERROR_STRM("allocation " << job->id << " of "
+                                 << m_lib->name() << " fails");
+            } else {
+                Reply * r = new Reply;
+                r->type = Reply::T_Allocated;
+                r->id = job->id;
+                r->instance = instance;
+                reply(r);
+            }
+            break;
+        }
+        case Job::T_Destroy:
+            m_lib->destroy(job->instance);
+            break;
+        case Job::T_Invoke: {
+            std::string err;
+            if (!m_lib->invoke(job->instance, job->id, job->name,
+                               job->args, err)) {
+                BPLOG_ERROR_STRM("Service method invocation fails: " << err);
+            }
+            break;
+        }
+        case Job::T_PromptResponse:
+            m_lib->promptResponse(job->id, job->args);
+            break;
+        case Job::T_InstallHook:
+        case Job::T_UninstallHook: {
+            Reply * r = new Reply;
+            if (job->type == Job::T_InstallHook) {
+                r->type = Reply::T_InstallHook;
+                r->code = m_lib->installHook(job->path, job->path2);
+            } else {
+                r->type = Reply::T_UninstallHook;
+                r->code = m_lib->uninstallHook(job->path, job->path2);
+            }
+            reply(r);
+            break;
+        }
+        case Job::T_Load:
+            break;
+    }
+}
+
+void
+InProcessService::reply(Reply * r)
+{
+    InProcessHop * h = new InProcessHop;
+    h->target = m_self;
+    h->reply = (void *) r;
+    m_hopper.invokeOnThread(deliver, (void *) h);
+}
+
+void
+InProcessService::deliver(void * context)
+{
+    InProcessHop * h = (InProcessHop *) context;
+    Reply * r = (Reply *) h->reply;
+    // holding self keeps us alive through callbacks which release
+    // the controller
+    std::tr1::shared_ptr<InProcessService> self = h->target.lock();
+    delete h;
+    if (self == NULL) {
+        delete r;
+        return;
+    }
+    self->onReply(r);
+}
+
+void
+InProcessService::onResults(unsigned int instance, unsigned int tid,
+                            const bp::Object * o)
+{
+    Reply * r = new Reply;
+    r->type = Reply::T_Results;
+    r->instance = instance;
+    r->id = tid;
+    if (o) r->o = o->clone();
+    reply(r);
+}
+
+void
+InProcessService::onCallback(unsigned int instance, unsigned int tid,
+                             long long int callbackId,
+                             const bp::Object * value)
+{
+    Reply * r = new Reply;
+    r->type = Reply::T_Callback;
+    r->instance = instance;
+    r->id = tid;
+    r->callbackId = callbackId;
+    if (value) r->o = value->clone();
+    reply(r);
+}
+
+void
+InProcessService::onError(unsigned int instance, unsigned int tid,
+                          const std::string & error,
+                          const std::string & verboseError)
+{
+    Reply * r = new Reply;
+    r->type = Reply::T_Error;
+    r->instance = instance;
+    r->id = tid;
+    r->error = error.empty() ? std::string("bp.unknownError") : error;
+    r->verboseError = verboseError;
+    reply(r);
+}
+
+void
+InProcessService::onPrompt(unsigned int instance, unsigned int promptId,
+                           const bfs::path & pathToDialog,
+                           const bp::Object * arguments)
+{
+    Reply * r = new Reply;
+    r->type = Reply::T_Prompt;
+    r->instance = instance;
+    r->id = promptId;
+    r->path = pathToDialog;
+    if (arguments) r->o = arguments->clone();
+    reply(r);
+}
+
+void
+InProcessService::onReply(Reply * r)
+{
+    Controller * c = m_controller;
+    IControllerListener * l = c->m_listener;
+
+    if (r->type == Reply::T_Loaded) {
+        m_desc = r->desc;
+        unsigned int apiVersion = r->apiVersion;
+        delete r;
+        // this callback may delete the controller
+        c->onLoaded(m_desc.name(), m_desc.versionString(), apiVersion);
+        return;
+    }
+
+    // listener callbacks may delete the controller, touch nothing
+    // after them
+    if (l != NULL) {
+        switch (r->type) {
+            case Reply::T_Ended:
+                l->onEnded(c);
+                break;
+            case Reply::T_Description:
+                l->onDescribe(c, m_desc);
+                break;
+            case Reply::T_Allocated:
+                l->onAllocated(c, r->id, r->instance);
+                break;
+            case Reply::T_Results:
+                l->onInvokeResults(c, r->instance, r->id, r->o);
+                break;
+            case Reply::T_Error:
+                l->onInvokeError(c, r->instance, r->id, r->error,
+                                 r->verboseError);
+                break;
+            case Reply::T_Callback:
+                l->onCallback(c, r->instance, r->id, r->callbackId, r->o);
+                break;
+            case Reply::T_Prompt:
+                l->onPrompt(c, r->instance, r->id, r->path, r->o);
+                break;
+            case Reply::T_InstallHook:
+                l->onInstallHook(c, r->code);
+                break;
+            case Reply::T_UninstallHook:
+                l->onUninstallHook(c, r->code);
+                break;
+            case Reply::T_Loaded:
+                break;
+        }
+    }
+    delete r;
+}
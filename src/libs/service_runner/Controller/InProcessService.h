@@ -0,0 +1,135 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ * Runs a trusted service inside the controlling process.  The service
+ * library is loaded on a worker thread of its own, all calls into it
+ * are made there, and its results hop back to the controlling thread
+ * as bp::Objects, with no IPC or JSON in between.  Drives a Controller
+ * in place of a spawned process and its IPC channel.
+ */
+
+#ifndef __INPROCESSSERVICE_H__
+#define __INPROCESSSERVICE_H__
+
+#include <string>
+#include "api/Controller.h"
+#include "BPUtils/bprunloopthread.h"
+#include "BPUtils/bpthreadhopper.h"
+#include "BPUtils/bptr1.h"
+#include "../Process/ServiceLibrary.h"
+
+
+namespace ServiceRunner 
+{
+    class InProcessService
+        : public IServiceLibraryListener,
+          public std::tr1::enable_shared_from_this<InProcessService>
+    {
+      public:
+        // results are delivered to controller's listener on the thread
+        // which constructs us.  must be owned by a shared_ptr, replies
+        // still in flight when it's released are dropped.
+        InProcessService(Controller * controller);
+
+        // stops the worker thread, unloading the service
+        ~InProcessService();
+
+        // spin up the worker thread and load the service found at
+        // path.  Controller::onLoaded() follows when the service is
+        // loaded, or onEnded() when it can't be.
+        bool start(const boost::filesystem::path & path,
+                   const boost::filesystem::path & providerPath,
+                   std::string & err);
+
+        // the Controller interface, each returns at once and does its
+        // work on the worker thread.  ids are as for the IPC queries
+        // a spawned service would receive.
+        void describe();
+        unsigned int allocate(const std::string & uri,
+                              const boost::filesystem::path & dataDir,
+                              const boost::filesystem::path & tempDir,
+                              const std::string & locale,
+                              const std::string & userAgent,
+                              unsigned int clientPid);
+        void destroy(unsigned int id);
+        unsigned int invoke(unsigned int instanceId,
+                            const std::string & function,
+                            const bp::Object * arguments);
+        void installHook(const boost::filesystem::path & serviceDir,
+                         const boost::filesystem::path & tempDir);
+        void uninstallHook(const boost::filesystem::path & serviceDir,
+                           const boost::filesystem::path & tempDir);
+        void sendResponse(unsigned int promptId,
+                          const bp::Object * arguments);
+
+      private:
+        Controller * m_controller;
+
+        // the loaded service's description, kept for describe()
+        bp::service::Description m_desc;
+
+        // owned and used only by the worker thread
+        ServiceLibrary * m_lib;
+        bp::runloop::RunLoopThread m_thread;
+
+        // source of allocation and transaction ids
+        unsigned int m_nextId;
+
+        // set on the worker thread once a call into the service
+        // throws, after which the service is never called again
+        bool m_failed;
+
+        struct Job;
+        bool post(Job * job);
+        static void onEvent(void * cookie, bp::runloop::Event e);
+        static void atEnd(void * cookie);
+        void runJob(Job * job);
+
+        // replies hop to the controlling thread holding only a weak
+        // reference to us, so that none outlive us
+        bp::thread::Hopper m_hopper;
+        std::tr1::weak_ptr<InProcessService> m_self;
+
+        struct Reply;
+        void reply(Reply * r);
+        static void deliver(void * context);
+        void onReply(Reply * r);
+
+        // IServiceLibraryListener, called on the worker thread
+        void onResults(unsigned int instance, unsigned int tid,
+                       const bp::Object * o);
+        void onCallback(unsigned int instance, unsigned int tid,
+                        long long int callbackId, const bp::Object * value);
+        void onError(unsigned int instance, unsigned int tid,
+                     const std::string & error,
+                     const std::string & verboseError);
+        void onPrompt(unsigned int instance, unsigned int promptId,
+                      const boost::filesystem::path & pathToDialog,
+                      const bp::Object * arguments);
+
+        InProcessService(const InProcessService &);
+        InProcessService & operator=(const InProcessService &);
+    };
+};
+
+#endif
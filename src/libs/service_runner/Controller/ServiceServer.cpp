@@ -70,6 +70,12 @@ Connector::setListener(weak_ptr<Controller> controller)
     m_listener = controller;
 }
 
+void
+Connector::setHost(weak_ptr<SharedHost> host)
+{
+    m_host = host;
+}
+
 void
 Connector::gotChannel(bp::ipc::Channel * c)
 {
@@ -163,6 +169,19 @@ Connector::onMessage(bp::ipc::Channel * c,
             }
         }
     }
+    else if (!m.command().compare("hostLoaded"))
+    {
+        // a shared host has no service to name, services are loaded
+        // into it once it's connected
+        shared_ptr<SharedHost> host = m_host.lock();
+        if (host == NULL) {
+            BPLOG_WARN("shared host connected, but no listener exists.  "
+                       "cleaning up host.");
+        } else {
+            host->onConnected(c);
+            c = NULL;
+        }
+    }
     else 
     {
         BPLOG_ERROR_STRM("received unexpected message from service: "
@@ -36,6 +36,7 @@
 #include <string>
 #include <set>
 #include "api/Controller.h"
+#include "api/SharedHost.h"
 #include "bpipc/IPCChannelServer.h"
 
 
@@ -51,9 +52,13 @@ namespace ServiceRunner
         // set the controller that listens to this connector
         void setListener(std::tr1::weak_ptr<Controller> controller);
 
+        // or the shared host, which connects with 'hostLoaded'
+        void setHost(std::tr1::weak_ptr<SharedHost> host);
+
         std::string ipcName() { return m_ipcName; }
       private:
         std::tr1::weak_ptr<Controller> m_listener;
+        std::tr1::weak_ptr<SharedHost> m_host;
         std::tr1::shared_ptr<bp::ipc::ChannelServer> m_server;
 
         //////////
@@ -0,0 +1,408 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+#include "SharedHost.h"
+#include "BPUtils/BPLog.h"
+#include "platform_utils/ProductPaths.h"
+#include "Controller.h"
+#include "OutputRing.h"
+#include "ServiceProtocol.h"
+#include "ServiceServer.h"
+
+
+using namespace ServiceRunner;
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+SharedHost::SharedHost() :
+    m_spawnCheckTimer(),
+    m_childWatcher(),
+    m_pid(0),
+    m_spawnStatus(),
+    m_ended(false)
+{
+}
+
+SharedHost::~SharedHost()
+{
+    m_spawnCheckTimer.setListener(NULL);
+    m_spawnCheckTimer.cancel();
+    m_childWatcher.setListener(NULL);
+    m_childWatcher.cancel();
+
+    // the host exits when its channel goes down
+    if (m_chan) m_chan->setListener(NULL);
+    m_chan.reset();
+    m_connector.reset();
+
+    if (!m_outputRing.empty()) (void) bpf::safeRemove(m_outputRing);
+}
+
+bool
+SharedHost::run(const bfs::path & pathToHarness,
+                const std::string & logLevel,
+                const bfs::path & logFile,
+                std::string & err)
+{
+    if (m_pid != 0) {
+        err.append("SharedHost::run apparently called twice");
+        return false;
+    }
+
+    bfs::path executable = pathToHarness;
+    if (executable.empty()) executable = bp::paths::getRunnerPath();
+
+    if (!bpf::pathExists(executable)) {
+        err.append("no such file: ");
+        err.append(executable.string());
+        return false;
+    }
+
+    m_connector.reset(new ServiceRunner::Connector);
+    m_connector->setHost(shared_from_this());
+
+    std::vector<std::string> args;
+    args.push_back("-runService");
+    args.push_back("-sharedHost");
+    args.push_back("-ipcName");    
+    args.push_back(m_connector->ipcName());
+
+    if (!logLevel.empty())
+    {
+        args.push_back("-log");    
+        args.push_back(logLevel);
+    }
+
+    if (!logFile.empty())
+    {
+        args.push_back("-logfile");    
+        args.push_back(bpf::nativeUtf8String(bpf::absolutePath(logFile)));
+    }
+
+    m_outputRing = bpf::getTempPath(bpf::getTempDirectory(), "BPOutput");
+    args.push_back("-outputRing");
+    args.push_back(bpf::nativeUtf8String(m_outputRing));
+
+    // the host moves into each service's directory as it calls into
+    // it (see LibraryHost), so where it starts doesn't matter
+    if (!bp::process::spawn(executable, args, &m_spawnStatus,
+                            bpf::getTempDirectory(),
+                            "BrowserPlus: Shared Service Host"))
+    {
+        BPLOG_ERROR("Failed to spawn shared service host!");
+        err.append("spawn failed: ");
+        err.append(bp::error::lastErrorString());
+        m_ended = true;
+        return false;
+    }
+
+    m_pid = m_spawnStatus.pid;
+    BPLOG_INFO_STRM("spawned shared service host, pid: " << m_pid
+                    << " - waiting for connection on "
+                    << m_connector->ipcName());
+
+    m_childWatcher.setListener(this);
+    if (!m_childWatcher.watchExit(m_spawnStatus)) {
+        m_spawnCheckTimer.setListener(this);
+        m_spawnCheckTimer.setMsec(200);
+    }
+    return true;
+}
+
+unsigned int
+SharedHost::serviceCount()
+{
+    return m_loading.size() + m_controllers.size();
+}
+
+void
+SharedHost::load(std::tr1::shared_ptr<Controller> c,
+                 const bfs::path & path,
+                 const bfs::path & providerPath)
+{
+    bp::ipc::Query q;
+    q.setCommand("load");
+    bp::Map * payload = new bp::Map;
+    payload->add("path", new bp::String(bpf::absolutePath(path).generic_string()));
+    if (!providerPath.empty()) {
+        payload->add("providerPath", new bp::String(
+                         bpf::absolutePath(providerPath).generic_string()));
+    }
+    q.setPayload(payload);
+
+    m_loading[q.id()] = c;
+    if (m_chan == NULL) {
+        m_pendingLoads.push_back(q);
+    } else if (!m_chan->sendQuery(q)) {
+        m_loading.erase(q.id());
+        c->onSharedLoadFailed("couldn't send load query to shared host");
+    }
+}
+
+void
+SharedHost::unload(unsigned int library)
+{
+    m_controllers.erase(library);
+    if (m_chan == NULL) return;
+
+    bp::ipc::Message m;
+    m.setCommand("unload");
+    bp::Map * payload = new bp::Map;
+    payload->add("library", new bp::Integer(library));
+    m.setPayload(payload);
+    (void) m_chan->sendMessage(m);
+}
+
+bool
+SharedHost::sendQuery(unsigned int library, bp::ipc::Query & q)
+{
+    if (m_chan == NULL) return false;
+    tagPayload(q, library);
+    return m_chan->sendQuery(q);
+}
+
+bool
+SharedHost::sendMessage(unsigned int library, bp::ipc::Message & m)
+{
+    if (m_chan == NULL) return false;
+    tagPayload(m, library);
+    return m_chan->sendMessage(m);
+}
+
+void
+SharedHost::onConnected(bp::ipc::Channel * c)
+{
+    m_spawnCheckTimer.cancel();
+    m_childWatcher.cancel();
+
+    BPLOG_INFO_STRM("shared service host connected, sending "
+                    << m_pendingLoads.size() << " pending loads");
+
+    m_chan.reset(c);
+    m_chan->setListener(this);
+
+    // a controller may go away, and take us with it, as we fail it
+    std::tr1::shared_ptr<SharedHost> self(shared_from_this());
+
+    std::list<bp::ipc::Query> pending;
+    pending.swap(m_pendingLoads);
+    std::list<bp::ipc::Query>::iterator it;
+    for (it = pending.begin(); it != pending.end(); ++it) {
+        if (m_chan->sendQuery(*it)) continue;
+        std::tr1::shared_ptr<Controller> c = m_loading[it->id()].lock();
+        m_loading.erase(it->id());
+        if (c) c->onSharedLoadFailed("couldn't send load query to shared host");
+    }
+}
+
+std::tr1::shared_ptr<Controller>
+SharedHost::controller(unsigned int library)
+{
+    std::map<unsigned int, std::tr1::weak_ptr<Controller> >::iterator it;
+    it = m_controllers.find(library);
+    if (it == m_controllers.end()) return std::tr1::shared_ptr<Controller>();
+    return it->second.lock();
+}
+
+void
+SharedHost::onMessage(bp::ipc::Channel * c, const bp::ipc::Message & m)
+{
+    bp::ipc::Message inner(m);
+    unsigned int library = untagPayload(inner);
+    std::tr1::shared_ptr<Controller> ctl = controller(library);
+    if (ctl == NULL) {
+        BPLOG_WARN_STRM("'" << m.command() << "' from shared host for "
+                        << "unknown library " << library << ", dropping");
+        return;
+    }
+
+    std::tr1::shared_ptr<SharedHost> self(shared_from_this());
+    ctl->onMessage(c, inner);
+}
+
+bool
+SharedHost::onQuery(bp::ipc::Channel *, const bp::ipc::Query & query,
+                    bp::ipc::Response &)
+{
+    BPLOG_ERROR_STRM("unexpected query from shared host: "
+                     << query.command());
+    return false;
+}
+
+void
+SharedHost::onResponse(bp::ipc::Channel * c,
+                       const bp::ipc::Response & response)
+{
+    std::tr1::shared_ptr<SharedHost> self(shared_from_this());
+
+    if (!response.command().compare("load")) {
+        onLoadResponse(response);
+        return;
+    }
+
+    bp::ipc::Response inner(response);
+    unsigned int library = untagPayload(inner);
+    std::tr1::shared_ptr<Controller> ctl = controller(library);
+    if (ctl == NULL) {
+        BPLOG_WARN_STRM("'" << response.command() << "' response from shared "
+                        << "host for unknown library " << library
+                        << ", dropping");
+        return;
+    }
+    ctl->onResponse(c, inner);
+}
+
+void
+SharedHost::onLoadResponse(const bp::ipc::Response & response)
+{
+    std::map<unsigned int, std::tr1::weak_ptr<Controller> >::iterator it;
+    it = m_loading.find(response.responseTo());
+    if (it == m_loading.end()) {
+        BPLOG_ERROR("load response from shared host for unknown query");
+        return;
+    }
+    std::tr1::shared_ptr<Controller> c = it->second.lock();
+    m_loading.erase(it);
+
+    const bp::Object * p = response.payload();
+    if (!p || !p->has("success", BPTBoolean)) {
+        BPLOG_ERROR("malformed load response from shared host");
+        if (c) c->onSharedLoadFailed("malformed load response");
+        return;
+    }
+
+    if (!(bool) *(p->get("success"))) {
+        std::string err;
+        if (p->has("error", BPTString)) err = (std::string) *(p->get("error"));
+        if (c) c->onSharedLoadFailed(err);
+        return;
+    }
+
+    if (!p->has("library", BPTInteger) ||
+        !p->has("service", BPTString) ||
+        !p->has("version", BPTString) ||
+        !p->has("apiVersion", BPTInteger))
+    {
+        BPLOG_ERROR("malformed load response from shared host");
+        if (c) c->onSharedLoadFailed("malformed load response");
+        return;
+    }
+
+    unsigned int library = (unsigned int) (long long) *(p->get("library"));
+
+    // whoever asked gave up while the service loaded
+    if (c == NULL) {
+        unload(library);
+        return;
+    }
+
+    m_controllers[library] = c;
+    c->onSharedLoaded(library, (std::string) *(p->get("service")),
+                      (std::string) *(p->get("version")),
+                      (unsigned int) (long long) *(p->get("apiVersion")));
+}
+
+void
+SharedHost::timesUp(bp::time::Timer *)
+{
+    int exitCode = 0;
+    if (bp::process::wait(m_spawnStatus, false, exitCode)) {
+        BPLOG_ERROR_STRM("Shared service host exited with code: "
+                         << exitCode);
+        ended();
+    } else {
+        m_spawnCheckTimer.setMsec(200);        
+    }
+}
+
+void
+SharedHost::childExited(bp::process::ChildWatcher *, int exitCode)
+{
+    BPLOG_ERROR_STRM("Shared service host exited with code: " << exitCode);
+    ended();
+}
+
+void
+SharedHost::channelEnded(bp::ipc::Channel *,
+                         bp::ipc::IConnectionListener::TerminationReason why,
+                         const char * errorString)
+{
+    BPLOG_ERROR_STRM("shared host IPC channel ended, " <<
+                     bp::ipc::
+                     IConnectionListener::terminationReasonToString(why) <<
+                     ", " << (errorString ? errorString : ""));
+    ended();
+}
+
+void
+SharedHost::ended()
+{
+    if (m_ended) return;
+    m_ended = true;
+
+    m_spawnCheckTimer.cancel();
+    m_childWatcher.cancel();
+    logRecentOutput();
+
+    // listeners may delete controllers, and so us
+    std::tr1::shared_ptr<SharedHost> self(shared_from_this());
+
+    std::map<unsigned int, std::tr1::weak_ptr<Controller> > loading, loaded;
+    loading.swap(m_loading);
+    loaded.swap(m_controllers);
+    m_pendingLoads.clear();
+
+    // a service which was loading when the host died may be what
+    // killed it, it gets a process of its own
+    std::map<unsigned int, std::tr1::weak_ptr<Controller> >::iterator it;
+    for (it = loading.begin(); it != loading.end(); ++it) {
+        std::tr1::shared_ptr<Controller> c = it->second.lock();
+        if (c) c->onSharedLoadFailed("shared host went away");
+    }
+    for (it = loaded.begin(); it != loaded.end(); ++it) {
+        std::tr1::shared_ptr<Controller> c = it->second.lock();
+        if (c) c->onSharedHostEnded();
+    }
+}
+
+void
+SharedHost::logRecentOutput()
+{
+    if (m_outputRing.empty()) return;
+
+    std::vector<std::string> lines;
+    unsigned int dropped = 0;
+    if (!OutputRing::recent(m_outputRing, 50, lines, dropped) ||
+        lines.empty())
+    {
+        return;
+    }
+
+    BPLOG_ERROR_STRM("last " << lines.size() << " lines of output from "
+                     << "shared service host" << " that never reached the log"
+                     << (dropped ? " (some output was dropped)" : "")
+                     << ":");
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        BPLOG_ERROR_STRM("    " << lines[i]);
+    }
+}
@@ -37,6 +37,7 @@
 #include "bpipc/IPCChannel.h"
 #include "bpipc/IPCChannelServer.h"
 #include "bpipc/IPCServer.h"
+#include "BPUtils/bpchildwatcher.h"
 #include "BPUtils/bpfile.h"
 #include "BPUtils/bpprocess.h"
 #include "BPUtils/bpstopwatch.h"
@@ -119,6 +120,7 @@ namespace ServiceRunner
      */
     class Controller : public bp::ipc::IChannelListener,
                        public bp::time::ITimerListener,
+                       public bp::process::IChildWatcherListener,
                        public std::tr1::enable_shared_from_this<Controller>
     {
       public:
@@ -176,6 +178,36 @@ namespace ServiceRunner
                  const boost::filesystem::path & logFile, 
                  std::string & err);
 
+        // load and run the service inside this process, on a worker
+        // thread of its own, rather than spawning it.  Calls into the
+        // service skip IPC entirely.  Only for v5 services which are
+        // trusted not to take the host process down with them; the
+        // caller is responsible for establishing that trust.
+        bool runInProcess(const boost::filesystem::path & pathToProvider,
+                          std::string & err);
+
+        // true when the service was started with runInProcess()
+        bool inProcess() { return m_inProcess != NULL; }
+
+        // run the service in a host process shared with other
+        // services (see SharedHost).  Only v5 services may be hosted.
+        // Should the host be unable to load it, the service is
+        // spawned with run() and the remaining arguments instead.
+        bool runShared(std::tr1::shared_ptr<class SharedHost> host,
+                       const boost::filesystem::path & pathToHarness,
+                       const boost::filesystem::path & pathToProvider,
+                       const std::string & serviceTitle,
+                       const std::string & logLevel,
+                       const boost::filesystem::path & logFile,
+                       std::string & err);
+
+        // true while the service runs in a shared host
+        bool shared() { return m_host != NULL; }
+
+        // pid of the process the service runs in, zero if it's
+        // this one or none has been spawned
+        int pid();
+
         // get a description of the service
         void describe();
 
@@ -248,6 +280,42 @@ namespace ServiceRunner
                          unsigned int apiVersion);
         friend class Connector;
 
+        // common to onConnected() and an in process service being
+        // loaded
+        void onLoaded(const std::string & name,
+                      const std::string & version,
+                      unsigned int apiVersion);
+
+        // set when the service runs in this process, there is then
+        // no channel
+        std::tr1::shared_ptr<class InProcessService> m_inProcess;
+        friend class InProcessService;
+
+        // set when the service runs in a shared host, which knows it
+        // as m_library once loaded.  we hold on to what run() needs
+        // should we have to fall back to a process of our own.
+        std::tr1::shared_ptr<class SharedHost> m_host;
+        unsigned int m_library;
+        struct {
+            boost::filesystem::path harness;
+            boost::filesystem::path provider;
+            std::string title;
+            std::string logLevel;
+            boost::filesystem::path logFile;
+        } m_fallback;
+        friend class SharedHost;
+        void onSharedLoaded(unsigned int library,
+                            const std::string & name,
+                            const std::string & version,
+                            unsigned int apiVersion);
+        void onSharedLoadFailed(const std::string & err);
+        void onSharedHostEnded();
+
+        // send over our channel or, tagged, the shared host's
+        bool connected();
+        bool sendQuery(bp::ipc::Query & q);
+        bool sendMessage(bp::ipc::Message & m);
+
         // container for the channel once onConnected called
         std::tr1::shared_ptr<bp::ipc::Channel> m_chan;
 
@@ -272,6 +340,20 @@ namespace ServiceRunner
         bp::time::Timer m_spawnCheckTimer;
         void timesUp(bp::time::Timer *);
 
+        // where supported we hear of premature exit as it happens and
+        // the timer isn't needed
+        bp::process::ChildWatcher m_childWatcher;
+        void childExited(bp::process::ChildWatcher *, int exitCode);
+        void pathCreated(bp::process::ChildWatcher *) { }
+
+        // common to both ways of noticing the spawned process is gone
+        void spawnedProcessExited(int exitCode);
+
+        // the file the spawned process maps its OutputRing from, and
+        // how we report what it said but never logged should it die
+        boost::filesystem::path m_outputRing;
+        void logRecentOutput();
+
         std::tr1::shared_ptr<class Connector> m_serviceConnector;
 
         // whether controlled service ever connected
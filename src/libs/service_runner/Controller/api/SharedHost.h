@@ -0,0 +1,148 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+/*
+ * A single spawned runner process which hosts several services at
+ * once, each driven by a Controller started with runShared().  Their
+ * traffic is multiplexed over one IPC channel.
+ */
+
+#ifndef __SHAREDHOST_H__
+#define __SHAREDHOST_H__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "bpipc/IPCChannel.h"
+#include "BPUtils/bpchildwatcher.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpprocess.h"
+#include "BPUtils/bptimer.h"
+#include "BPUtils/bptr1.h"
+
+
+namespace ServiceRunner 
+{
+    class Controller;
+
+    /**
+     *  A ServiceRunner::SharedHost trades the isolation of a process
+     *  per service for the memory and startup cost of one.  Only v5
+     *  services are hosted, and a crash of any of them ends all of
+     *  them, so which services share is left to the caller.
+     *
+     *  requirements:
+     *  A SharedHost must be allocated and owned with a boost
+     *  shared pointer, as weak pointers are used internally.  The
+     *  Controllers it hosts keep it alive.
+     */
+    class SharedHost : public bp::ipc::IChannelListener,
+                       public bp::time::ITimerListener,
+                       public bp::process::IChildWatcherListener,
+                       public std::tr1::enable_shared_from_this<SharedHost>
+    {
+      public:
+        SharedHost();
+        ~SharedHost();
+
+        // spawn the host process, arguments are as for Controller::run()
+        bool run(const boost::filesystem::path & pathToHarness,
+                 const std::string & logLevel,
+                 const boost::filesystem::path & logFile,
+                 std::string & err);
+
+        // false once the host process has gone away, it may not then
+        // be used to run further services
+        bool alive() { return !m_ended; }
+
+        // services loaded or loading in the host
+        unsigned int serviceCount();
+
+        int pid() { return m_pid; }
+
+      private:
+        friend class Controller;
+        friend class Connector;
+
+        // ask the host to load the service at path on behalf of c,
+        // which hears back through onSharedLoaded() or
+        // onSharedLoadFailed()
+        void load(std::tr1::shared_ptr<Controller> c,
+                  const boost::filesystem::path & path,
+                  const boost::filesystem::path & providerPath);
+        void unload(unsigned int library);
+
+        // send on behalf of the service loaded as library
+        bool sendQuery(unsigned int library, bp::ipc::Query & q);
+        bool sendMessage(unsigned int library, bp::ipc::Message & m);
+
+        // invoked by the Connector when the host process connects
+        void onConnected(bp::ipc::Channel * c);
+
+        // implemented methods from bp::ipc::IChannelListener
+        void channelEnded(bp::ipc::Channel * c,
+                          bp::ipc::IConnectionListener::TerminationReason why,
+                          const char * errorString);
+        void onMessage(bp::ipc::Channel * c, const bp::ipc::Message & m);
+        bool onQuery(bp::ipc::Channel * c, const bp::ipc::Query & query,
+                     bp::ipc::Response & response);
+        void onResponse(bp::ipc::Channel * c,
+                        const bp::ipc::Response & response);
+
+        // the response to a "load" query
+        void onLoadResponse(const bp::ipc::Response & response);
+
+        // the controller of the service loaded as library, if any
+        std::tr1::shared_ptr<Controller> controller(unsigned int library);
+
+        // premature exit detection, as in Controller
+        bp::time::Timer m_spawnCheckTimer;
+        void timesUp(bp::time::Timer *);
+        bp::process::ChildWatcher m_childWatcher;
+        void childExited(bp::process::ChildWatcher *, int exitCode);
+        void pathCreated(bp::process::ChildWatcher *) { }
+
+        // the host is gone, tell everyone it hosted
+        void ended();
+        void logRecentOutput();
+
+        int m_pid;
+        bp::process::spawnStatus m_spawnStatus;
+        bool m_ended;
+        boost::filesystem::path m_outputRing;
+        std::tr1::shared_ptr<class Connector> m_connector;
+        std::tr1::shared_ptr<bp::ipc::Channel> m_chan;
+
+        // loads asked for before the host connected
+        std::list<bp::ipc::Query> m_pendingLoads;
+
+        // controllers awaiting a load, by query id
+        std::map<unsigned int, std::tr1::weak_ptr<Controller> > m_loading;
+
+        // controllers of loaded services, by library
+        std::map<unsigned int, std::tr1::weak_ptr<Controller> > m_controllers;
+    };
+}
+
+#endif
@@ -0,0 +1,262 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+#include "LibraryHost.h"
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+
+using namespace ServiceRunner;
+namespace bfs = boost::filesystem;
+
+
+// A spawned runner starts in its service's directory, and services
+// come to rely on that to resolve relative paths.  Hosted services
+// share a process and so a cwd, which we point at each one's
+// directory for as long as it's being called into.  Threads a
+// service starts itself see whatever the cwd happens to be.
+namespace {
+class ServiceDirectory
+{
+  public:
+    ServiceDirectory(const bfs::path & dir)
+    {
+        boost::system::error_code ec;
+        m_previous = bfs::current_path(ec);
+        if (ec) {
+            m_previous.clear();
+            return;
+        }
+        bfs::current_path(dir, ec);
+        if (ec) {
+            BPLOG_WARN_STRM("couldn't chdir to " << dir.generic_string()
+                            << ": " << ec.message());
+            m_previous.clear();
+        }
+    }
+
+    ~ServiceDirectory()
+    {
+        boost::system::error_code ec;
+        if (!m_previous.empty()) bfs::current_path(m_previous, ec);
+    }
+
+  private:
+    bfs::path m_previous;
+};
+}
+
+
+LibraryHost::LibraryHost(bp::runloop::RunLoop* rl,
+                         const std::string& ipcName)
+    : m_rl(rl), m_ipcName(ipcName), m_nextLibrary(1)
+{
+    m_chan.setListener(this);
+}
+
+
+LibraryHost::~LibraryHost()
+{
+    std::map<unsigned int, Hosted>::iterator it;
+    for (it = m_libraries.begin(); it != m_libraries.end(); ++it) {
+        ServiceDirectory sd(it->second.dir);
+        delete it->second.proto;
+        delete it->second.lib;
+    }
+}
+
+
+bool
+LibraryHost::connect()
+{
+    if (!m_chan.connect(m_ipcName)) {
+        return false;
+    }
+
+    // there's no single service to name, so we announce the api
+    // version of services we'll load
+    bp::ipc::Message m;
+    m.setCommand("hostLoaded");
+    bp::Map* payload = new bp::Map;
+    payload->add("apiVersion", new bp::Integer(kSharedHostAPIVersion));
+    m.setPayload(payload);
+
+    return m_chan.sendMessage(m);
+}
+
+
+void
+LibraryHost::channelEnded(bp::ipc::Channel*,
+                          bp::ipc::IConnectionListener::TerminationReason why,
+                          const char* errorString)
+{
+    BPLOG_INFO_STRM("shared host connection ended ("
+                    << bp::ipc::IConnectionListener::terminationReasonToString(why)
+                    << ")" << (errorString ? " - " : "")
+                    << (errorString ? errorString : ""));
+    m_rl->stop();
+}
+
+
+LibraryHost::Hosted*
+LibraryHost::untag(bp::ipc::Message& m, unsigned int& library)
+{
+    library = untagPayload(m);
+    std::map<unsigned int, Hosted>::iterator it = m_libraries.find(library);
+    if (it == m_libraries.end()) {
+        BPLOG_WARN_STRM("'" << m.command() << "' received for unknown "
+                        << "library " << library << ", dropping");
+        return NULL;
+    }
+    return &(it->second);
+}
+
+
+void
+LibraryHost::onMessage(bp::ipc::Channel* c, const bp::ipc::Message& m)
+{
+    if (!m.command().compare("unload")) {
+        unload(m);
+        return;
+    }
+
+    bp::ipc::Message inner(m);
+    unsigned int library = 0;
+    Hosted* h = untag(inner, library);
+    if (h == NULL) return;
+
+    ServiceDirectory sd(h->dir);
+    h->proto->onMessage(c, inner);
+}
+
+
+bool
+LibraryHost::onQuery(bp::ipc::Channel* c, const bp::ipc::Query& query,
+                     bp::ipc::Response& response)
+{
+    if (!query.command().compare("load")) {
+        load(query, response);
+        return true;
+    }
+
+    // a copy keeps the query id, which invocations use as their tid
+    bp::ipc::Query inner(query);
+    unsigned int library = 0;
+    Hosted* h = untag(inner, library);
+    if (h == NULL) return false;
+
+    bool rv;
+    {
+        ServiceDirectory sd(h->dir);
+        rv = h->proto->onQuery(c, inner, response);
+    }
+    if (rv) tagPayload(response, library);
+    return rv;
+}
+
+
+void
+LibraryHost::onResponse(bp::ipc::Channel*, const bp::ipc::Response&)
+{
+    BPLOG_ERROR("shared host received unexpected response");
+}
+
+
+void
+LibraryHost::load(const bp::ipc::Query& query, bp::ipc::Response& response)
+{
+    bp::Map* payload = new bp::Map;
+    response.setPayload(payload);
+
+    if (!query.payload() || !query.payload()->has("path", BPTString)) {
+        payload->add("success", new bp::Bool(false));
+        payload->add("error", new bp::String("malformed load query"));
+        return;
+    }
+
+    bfs::path path = bp::file::absolutePath(
+        (std::string) *(query.payload()->get("path")));
+    bfs::path providerPath;
+    if (query.payload()->has("providerPath", BPTString)) {
+        providerPath = (std::string) *(query.payload()->get("providerPath"));
+    }
+
+    bp::time::Stopwatch sw;
+    sw.start();
+
+    std::string err;
+    ServiceLibrary* lib = new ServiceLibrary;
+    bool loaded;
+    {
+        ServiceDirectory sd(path);
+        loaded = lib->parseManifest(path, err)
+            && lib->load(providerPath, err, kSharedHostAPIVersion);
+    }
+    if (!loaded) {
+        BPLOG_ERROR_STRM("shared host couldn't load "
+                         << path.generic_string()
+                         << (err.length() ? ": " + err : "."));
+        delete lib;
+        payload->add("success", new bp::Bool(false));
+        payload->add("error", new bp::String(err));
+        return;
+    }
+
+    unsigned int library = m_nextLibrary++;
+    Hosted h;
+    h.lib = lib;
+    h.proto = new ServiceProtocol(lib, &m_chan, library);
+    h.dir = path;
+    m_libraries[library] = h;
+
+    BPLOG_INFO_STRM("shared host loaded " << lib->name() << " v"
+                    << lib->version() << " as library " << library
+                    << " in " << sw.elapsedSec() << "s");
+
+    payload->add("success", new bp::Bool(true));
+    payload->add("library", new bp::Integer(library));
+    payload->add("service", new bp::String(lib->name()));
+    payload->add("version", new bp::String(lib->version()));
+    payload->add("apiVersion", new bp::Integer(lib->apiVersion()));
+}
+
+
+void
+LibraryHost::unload(const bp::ipc::Message& m)
+{
+    if (!m.payload() || !m.payload()->has("library", BPTInteger)) {
+        BPLOG_WARN("malformed unload message, dropping");
+        return;
+    }
+    unsigned int library =
+        (unsigned int) (long long) *(m.payload()->get("library"));
+    std::map<unsigned int, Hosted>::iterator it = m_libraries.find(library);
+    if (it == m_libraries.end()) return;
+
+    // protocol first, it's the library's listener
+    BPLOG_INFO_STRM("shared host unloading library " << library);
+    ServiceDirectory sd(it->second.dir);
+    delete it->second.proto;
+    delete it->second.lib;
+    m_libraries.erase(it);
+}
@@ -0,0 +1,90 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+/*
+ * The service side of a shared host: a single spawned process which
+ * loads several services and multiplexes their traffic over one
+ * channel to the controller side SharedHost.
+ */
+
+#ifndef __LIBRARYHOST_H__
+#define __LIBRARYHOST_H__
+
+#include <map>
+#include <string>
+#include "ServiceLibrary.h"
+#include "ServiceProtocol.h"
+#include "bpipc/IPCChannel.h"
+#include "BPUtils/bprunloop.h"
+
+
+namespace ServiceRunner 
+{
+    // the only service API version a shared host will load
+    const unsigned int kSharedHostAPIVersion = 5;
+
+    class LibraryHost : public bp::ipc::IChannelListener
+    {
+      public:
+        LibraryHost(bp::runloop::RunLoop * rl, const std::string & ipcName);
+        ~LibraryHost();
+
+        // connect to the controller and announce we're ready to load
+        bool connect();
+
+      private:
+        // implemented methods from bp::ipc::IChannelListener
+        void channelEnded(bp::ipc::Channel * c,
+                          bp::ipc::IConnectionListener::TerminationReason why,
+                          const char * errorString);
+        void onMessage(bp::ipc::Channel * c, const bp::ipc::Message & m);
+        bool onQuery(bp::ipc::Channel * c, const bp::ipc::Query & query,
+                     bp::ipc::Response & response);
+        void onResponse(bp::ipc::Channel * c,
+                        const bp::ipc::Response & response);
+
+        // "load" {path, providerPath} and "unload" {library}
+        void load(const bp::ipc::Query & query, bp::ipc::Response & response);
+        void unload(const bp::ipc::Message & m);
+
+        struct Hosted {
+            ServiceLibrary * lib;
+            ServiceProtocol * proto;
+            // the service's directory, which a spawned runner would
+            // have as its cwd
+            boost::filesystem::path dir;
+        };
+
+        // the library m is tagged for, NULL (with m left alone) if
+        // there's no such library
+        Hosted * untag(bp::ipc::Message & m, unsigned int & library);
+
+        bp::ipc::Channel m_chan;
+        bp::runloop::RunLoop * m_rl;
+        std::string m_ipcName;
+        std::map<unsigned int, Hosted> m_libraries;
+        unsigned int m_nextLibrary;
+    };
+};
+
+#endif
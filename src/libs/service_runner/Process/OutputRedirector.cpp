@@ -33,6 +33,9 @@
 #include <string>
 #include "BPUtils/BPLog.h"
 #include "BPUtils/bpthread.h"
+#include "OutputRing.h"
+
+using ServiceRunner::OutputRing;
 
 static int outPipe[2];
 static int errPipe[2];
@@ -41,6 +44,30 @@ static bool running = false;
 static bp::thread::Thread redirector;
 
 #ifndef WIN32
+// hand a chunk read from a standard handle to the output ring a line
+// at a time, or straight to the log when there's no ring
+static void
+emit(OutputRing::Source source, char * buf, int len)
+{
+    OutputRing * ring = OutputRing::current();
+    if (!ring) {
+        buf[len] = 0;
+        if (source == OutputRing::S_Stderr) {
+            BPLOG_ERROR(buf);
+        } else {
+            BPLOG_INFO(buf);
+        }
+        return;
+    }
+    int start = 0;
+    for (int i = 0; i <= len; i++) {
+        if (i == len || buf[i] == '\n') {
+            if (i > start) ring->write(source, 0, buf + start, i - start);
+            start = i + 1;
+        }
+    }
+}
+
 static void * redirectStdHandles(void *) 
 {
     int maxfd = outPipe[0];
@@ -73,19 +100,13 @@ static void * redirectStdHandles(void *)
         if (FD_ISSET(errPipe[0], &readfds)) {
             char buf[1024];
             int x = read(errPipe[0], (void *) buf, sizeof(buf) - 1);
-            if (x > 0) {
-                buf[x] = 0;
-                BPLOG_ERROR(buf);
-            }
+            if (x > 0) emit(OutputRing::S_Stderr, buf, x);
         }
 
         if (FD_ISSET(outPipe[0], &readfds)) {
             char buf[1024];
             int x = read(outPipe[0], (void *) buf, sizeof(buf) - 1);
-            if (x > 0) {
-                buf[x] = 0;
-                BPLOG_INFO(buf);
-            }
+            if (x > 0) emit(OutputRing::S_Stdout, buf, x);
         }
     }
 
@@ -39,7 +39,8 @@ class OutputRedirector
     // upon invocation, stdout and stderr will be redirected to
     // BrowserPlus's logging infrastructure, and a thread will be
     // spawned who's responsibility it is to dump output from these
-    // file descriptors to BPLOG
+    // file descriptors to BPLOG, or line by line to the current
+    // OutputRing when there is one
 
     // may only be called once per process, and everything will be torn
     // down once the destructor is called.
@@ -0,0 +1,416 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ * A bounded ring of lines of service output, see OutputRing.h
+ *
+ * Writers claim a slot by advancing the head counter with a compare
+ * and swap, format into it, and publish it by storing its sequence
+ * number.  The single drain thread consumes published slots in order
+ * and advances the tail, which frees them for reuse.
+ */
+
+#include "OutputRing.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include "BPUtils/bpatomic.h"
+#include "BPUtils/BPLog.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace ServiceRunner;
+
+// "BPOR"
+#define RING_MAGIC 0x524f5042
+#define RING_SLOTS 256
+#define RING_SLOT_SIZE 1024
+
+// how often the drain thread wakes, and how many lines it will pass
+// to the sink per wakeup.  together these bound the rate at which a
+// chatty service can flood the log, beyond that lines are dropped.
+#define DRAIN_INTERVAL_MS 50
+#define DRAIN_MAX_LINES 256
+
+struct OutputRing::Header 
+{
+    unsigned int magic;
+    unsigned int slotCount;
+    unsigned int slotSize;
+    // count of slots claimed by writers
+    volatile unsigned int head;
+    // count of slots consumed by the drain thread
+    volatile unsigned int tail;
+    // count of lines dropped because the ring was full
+    volatile unsigned int dropped;
+};
+
+struct OutputRing::Slot 
+{
+    // one more than the value of head which claimed this slot, set
+    // once the slot has been written.  zero until first use.
+    volatile unsigned int seq;
+    unsigned short source;
+    unsigned short level;
+    unsigned int len;
+    unsigned int truncated;
+    char text[RING_SLOT_SIZE - 4 * sizeof(unsigned int)];
+};
+
+static OutputRing * s_current = NULL;
+
+size_t
+OutputRing::ringSize()
+{
+    return sizeof(OutputRing::Header) + RING_SLOTS * RING_SLOT_SIZE;
+}
+
+static const char *
+sourceName(unsigned int source)
+{
+    switch (source) {
+        case OutputRing::S_Service: return "log";
+        case OutputRing::S_Stdout: return "stdout";
+        case OutputRing::S_Stderr: return "stderr";
+    }
+    return "?";
+}
+
+OutputRing::OutputRing()
+    : m_header(NULL), m_slots(NULL), m_mapping(NULL), m_mappingSize(0),
+      m_sink(NULL), m_running(false), m_stopping(false),
+      m_droppedReported(0)
+{
+}
+
+OutputRing::~OutputRing()
+{
+    if (s_current == this) setCurrent(NULL);
+    stop();
+    close();
+}
+
+bool
+OutputRing::open(const boost::filesystem::path & path)
+{
+    if (m_header) return false;
+
+    size_t size = ringSize();
+    void * mem = NULL;
+
+    if (!path.empty()) {
+#ifdef WIN32
+        HANDLE f = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+        if (f != INVALID_HANDLE_VALUE) {
+            HANDLE m = CreateFileMappingW(f, NULL, PAGE_READWRITE,
+                                          0, (DWORD) size, NULL);
+            CloseHandle(f);
+            if (m != NULL) {
+                mem = MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, size);
+                CloseHandle(m);
+            }
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            if (ftruncate(fd, (off_t) size) == 0) {
+                mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           fd, 0);
+                if (mem == MAP_FAILED) mem = NULL;
+            }
+            ::close(fd);
+        }
+#endif
+        if (mem == NULL) {
+            BPLOG_WARN_STRM("couldn't map output ring at " << path
+                            << ", keeping it in memory");
+        } else {
+            m_mapping = mem;
+            m_mappingSize = size;
+        }
+    }
+
+    if (mem == NULL) {
+        mem = calloc(1, size);
+        if (mem == NULL) return false;
+    }
+
+    m_header = (Header *) mem;
+    m_slots = (Slot *) ((char *) mem + sizeof(Header));
+    m_header->slotCount = RING_SLOTS;
+    m_header->slotSize = RING_SLOT_SIZE;
+    m_header->head = m_header->tail = m_header->dropped = 0;
+    bp::atomic::barrier();
+    m_header->magic = RING_MAGIC;
+    return true;
+}
+
+void
+OutputRing::close()
+{
+    if (!m_header) return;
+    if (m_mapping) {
+#ifdef WIN32
+        UnmapViewOfFile(m_mapping);
+#else
+        munmap(m_mapping, m_mappingSize);
+#endif
+    } else {
+        free(m_header);
+    }
+    m_header = NULL;
+    m_slots = NULL;
+    m_mapping = NULL;
+    m_mappingSize = 0;
+}
+
+bool
+OutputRing::start(ISink * sink)
+{
+    if (!m_header || m_running || !sink) return false;
+    m_sink = sink;
+    m_stopping = false;
+    if (!m_thread.run(drainThread, (void *) this)) return false;
+    m_running = true;
+    return true;
+}
+
+void
+OutputRing::stop()
+{
+    if (!m_running) return;
+    {
+        bp::sync::Lock lck(m_lock);
+        m_stopping = true;
+        m_cond.signal();
+    }
+    m_thread.join();
+    m_running = false;
+}
+
+void *
+OutputRing::drainThread(void * cookie)
+{
+    OutputRing * self = (OutputRing *) cookie;
+
+    for (;;) {
+        bool stopping;
+        {
+            bp::sync::Lock lck(self->m_lock);
+            if (!self->m_stopping) {
+                self->m_cond.timeWait(&self->m_lock, DRAIN_INTERVAL_MS);
+            }
+            stopping = self->m_stopping;
+        }
+        if (stopping) break;
+        self->drain(DRAIN_MAX_LINES);
+    }
+
+    // writers may still be running, take what is there now
+    while (self->drain(DRAIN_MAX_LINES) > 0) ;
+    return NULL;
+}
+
+unsigned int
+OutputRing::drain(unsigned int maxLines)
+{
+    unsigned int n = 0;
+    unsigned int t = bp::atomic::load(&m_header->tail);
+
+    while (n < maxLines) {
+        Slot * s = m_slots + (t % m_header->slotCount);
+        if (bp::atomic::load(&s->seq) != t + 1) break;
+
+        std::string line(s->text, s->len);
+        if (s->truncated) line.append("...");
+        Source source = (Source) s->source;
+        unsigned int level = s->level;
+
+        m_sink->onLine(source, level, line);
+
+        // the slot may be reused as soon as tail moves past it, and
+        // recent() leaves out lines behind tail as already logged
+        bp::atomic::store(&m_header->tail, ++t);
+        ++n;
+    }
+
+    unsigned int dropped = bp::atomic::load(&m_header->dropped);
+    if (dropped != m_droppedReported) {
+        m_sink->onDropped(dropped - m_droppedReported);
+        m_droppedReported = dropped;
+    }
+    return n;
+}
+
+OutputRing::Slot *
+OutputRing::reserve(unsigned int & seq)
+{
+    if (!m_header) return NULL;
+    for (;;) {
+        // tail first, so that head can't be older than it
+        unsigned int t = bp::atomic::load(&m_header->tail);
+        unsigned int h = bp::atomic::load(&m_header->head);
+        if (h - t >= m_header->slotCount) {
+            bp::atomic::increment(&m_header->dropped);
+            return NULL;
+        }
+        if (bp::atomic::compareAndSwap(&m_header->head, h, h + 1)) {
+            seq = h + 1;
+            return m_slots + (h % m_header->slotCount);
+        }
+    }
+}
+
+void
+OutputRing::commit(Slot * s, unsigned int seq)
+{
+    bp::atomic::store(&s->seq, seq);
+}
+
+bool
+OutputRing::write(Source source, unsigned int level,
+                  const char * text, size_t len)
+{
+    unsigned int seq = 0;
+    Slot * s = reserve(seq);
+    if (!s) return false;
+
+    s->truncated = (len >= sizeof(s->text));
+    if (s->truncated) len = sizeof(s->text) - 1;
+    memcpy(s->text, text, len);
+    s->text[len] = 0;
+    s->len = (unsigned int) len;
+    s->source = (unsigned short) source;
+    s->level = (unsigned short) level;
+
+    commit(s, seq);
+    return true;
+}
+
+bool
+OutputRing::writev(Source source, unsigned int level,
+                   const char * fmt, va_list ap)
+{
+    unsigned int seq = 0;
+    Slot * s = reserve(seq);
+    if (!s) return false;
+
+#ifdef WIN32
+    int n = vsnprintf_s(s->text, sizeof(s->text), _TRUNCATE, fmt, ap);
+    s->truncated = (n < 0);
+    if (n < 0) n = (int) strlen(s->text);
+#else
+    int n = vsnprintf(s->text, sizeof(s->text), fmt, ap);
+    if (n < 0) n = 0;
+    s->truncated = ((size_t) n >= sizeof(s->text));
+    if (s->truncated) n = sizeof(s->text) - 1;
+#endif
+    s->text[n] = 0;
+    s->len = (unsigned int) n;
+    s->source = (unsigned short) source;
+    s->level = (unsigned short) level;
+
+    commit(s, seq);
+    return true;
+}
+
+OutputRing *
+OutputRing::current()
+{
+    return (OutputRing *) bp::atomic::loadPtr((void * const volatile *)
+                                              &s_current);
+}
+
+void
+OutputRing::setCurrent(OutputRing * ring)
+{
+    bp::atomic::barrier();
+    s_current = ring;
+    bp::atomic::barrier();
+}
+
+bool
+OutputRing::recent(const boost::filesystem::path & path,
+                   unsigned int maxLines,
+                   std::vector<std::string> & lines,
+                   unsigned int & dropped)
+{
+    lines.clear();
+    dropped = 0;
+
+    std::ifstream f;
+    if (!bp::file::openReadableStream(f, path, std::ios::binary)) {
+        return false;
+    }
+    std::vector<char> buf(ringSize());
+    f.read(&buf[0], buf.size());
+    if ((size_t) f.gcount() != buf.size()) return false;
+
+    const Header * h = (const Header *) &buf[0];
+    if (h->magic != RING_MAGIC || h->slotCount != RING_SLOTS
+        || h->slotSize != RING_SLOT_SIZE)
+    {
+        return false;
+    }
+    dropped = h->dropped;
+
+    // slots written but not yet drained to the log, keyed by how far
+    // behind head they are.  lines the drain thread already handed to
+    // the log are left out so they aren't logged twice, as is a slot
+    // claimed but not yet written when the writer died, which still
+    // holds its older sequence number.
+    const Slot * slots = (const Slot *) (&buf[0] + sizeof(Header));
+    unsigned int pending = h->head - h->tail;
+    std::vector<std::pair<unsigned int, const Slot *> > found;
+    for (unsigned int i = 0; i < h->slotCount; i++) {
+        const Slot * s = slots + i;
+        unsigned int age = h->head - s->seq;
+        if (s->seq != 0 && age < pending && pending <= h->slotCount &&
+            s->len < sizeof(s->text))
+        {
+            found.push_back(std::make_pair(age, s));
+        }
+    }
+    std::sort(found.begin(), found.end());
+    if (found.size() > maxLines) found.resize(maxLines);
+
+    std::vector<std::pair<unsigned int, const Slot *> >::reverse_iterator it;
+    for (it = found.rbegin(); it != found.rend(); ++it) {
+        const Slot * s = it->second;
+        std::string line("[");
+        line.append(sourceName(s->source));
+        line.append("] ");
+        line.append(s->text, s->len);
+        if (s->truncated) line.append("...");
+        lines.push_back(line);
+    }
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/*
+ * A bounded ring of lines of service output: log entries made through
+ * the service API and whatever the service writes to stdout and
+ * stderr.  Writers format straight into a slot of the ring without
+ * taking a lock or allocating, and a drain thread hands lines on to a
+ * sink (the logging system) at a bounded rate.  When the ring is
+ * full, lines are dropped and counted rather than blocking the
+ * service.
+ *
+ * The ring may be backed by a file mapped into memory, in which case
+ * lines not yet drained survive the process and a controller can dump
+ * them after a crash (see recent()).
+ */
+
+#ifndef __OUTPUTRING_H__
+#define __OUTPUTRING_H__
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bpthread.h"
+
+namespace ServiceRunner 
+{
+    class OutputRing 
+    {
+      public:
+        enum Source {
+            S_Service,   // logged through the service API
+            S_Stdout,
+            S_Stderr
+        };
+
+        class ISink 
+        {
+          public:
+            // called on the drain thread, once per line, in order.
+            // level is the service API log level for S_Service lines.
+            virtual void onLine(Source source, unsigned int level,
+                                const std::string & line) = 0;
+            // called on the drain thread when lines were dropped
+            // since the last report
+            virtual void onDropped(unsigned int count) = 0;
+            virtual ~ISink() { }
+        };
+
+        OutputRing();
+        ~OutputRing();
+
+        // allocate the ring.  With a non-empty path the ring lives in
+        // that file (created or truncated), so recent() can read it
+        // back after we exit.  If the file can't be mapped the ring is
+        // kept in memory.
+        bool open(const boost::filesystem::path & path);
+
+        // start the thread which drains the ring into sink
+        bool start(ISink * sink);
+
+        // drain what remains and stop the drain thread
+        void stop();
+
+        // append a line, callable from any thread.  false if the
+        // line was dropped.  Lines longer than a slot are truncated.
+        bool write(Source source, unsigned int level,
+                   const char * text, size_t len);
+        bool writev(Source source, unsigned int level,
+                    const char * fmt, va_list ap);
+
+        // the ring output of this process is routed to, if any
+        static OutputRing * current();
+        static void setCurrent(OutputRing * ring);
+
+        // read up to maxLines of the most recent lines out of the
+        // ring file at path which the drain thread never got to hand
+        // to the log, oldest first, along with the total count of
+        // lines the writer dropped.  Lines are prefixed with their
+        // source.  false if the file doesn't hold a ring.
+        static bool recent(const boost::filesystem::path & path,
+                           unsigned int maxLines,
+                           std::vector<std::string> & lines,
+                           unsigned int & dropped);
+
+      private:
+        struct Header;
+        struct Slot;
+
+        Header * m_header;
+        Slot * m_slots;
+        void * m_mapping;
+        size_t m_mappingSize;
+
+        ISink * m_sink;
+        bp::thread::Thread m_thread;
+        bp::sync::Mutex m_lock;
+        bp::sync::Condition m_cond;
+        bool m_running;
+        bool m_stopping;
+        unsigned int m_droppedReported;
+
+        Slot * reserve(unsigned int & seq);
+        void commit(Slot * slot, unsigned int seq);
+        // hand up to maxLines to the sink, returns how many were
+        unsigned int drain(unsigned int maxLines);
+        void close();
+        static size_t ringSize();
+
+        static void * drainThread(void * cookie);
+
+        OutputRing(const OutputRing &);
+        OutputRing & operator=(const OutputRing &);
+    };
+}
+
+#endif
@@ -33,7 +33,9 @@
 #include <stdlib.h>
 #include "BPUtils/BPLog.h"
 #include "BPUtils/bpstopwatch.h"
+#include "LibraryHost.h"
 #include "OutputRedirector.h"
+#include "OutputRing.h"
 #include "platform_utils/APTArgParse.h"
 #include "platform_utils/bpconfig.h"
 #include "platform_utils/bpdebug.h"
@@ -80,13 +82,50 @@ setupLogging(std::string levelArg, bfs::path pathArg)
     cfg.configure();
 }
 
+
+// delivers lines captured in the output ring to the log
+class RingSink : public ServiceRunner::OutputRing::ISink
+{
+  public:
+    RingSink(ServiceRunner::ServiceLibrary * lib) : m_lib(lib) { }
+
+    void onLine(ServiceRunner::OutputRing::Source source, unsigned int level,
+                const std::string & line)
+    {
+        switch (source) {
+            case ServiceRunner::OutputRing::S_Service:
+                m_lib->logServiceEvent(level, line);
+                break;
+            case ServiceRunner::OutputRing::S_Stdout:
+                BPLOG_INFO(line);
+                break;
+            case ServiceRunner::OutputRing::S_Stderr:
+                BPLOG_ERROR(line);
+                break;
+        }
+    }
+
+    void onDropped(unsigned int count)
+    {
+        BPLOG_WARN_STRM(count << " lines of service output dropped");
+    }
+
+  private:
+    ServiceRunner::ServiceLibrary * m_lib;
+};
     
 bool
 ServiceRunner::runServiceProcess(int argc, const char ** argv)
 {
     // Offer developers the option to attach a debugger here.
     bp::debug::breakpoint( "runServiceProcess" );
-    
+
+    // declared in this order so that on the way out the redirector
+    // stops feeding the ring, then the ring drains through the sink
+    // into the library, and only then are the sink and library freed
+    ServiceLibrary lib;
+    RingSink sink(&lib);
+    OutputRing ring;
     OutputRedirector redirector;
 
     static APTArgDefinition args[] = {
@@ -116,6 +155,16 @@ ServiceRunner::runServiceProcess(int argc, const char ** argv)
         { "logfile", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
           APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
           "Enable logging to a specified file."
+        },
+        { "outputRing", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+          APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+          "Capture service output in a ring mapped from the specified file, "
+          "so that the controller can report it should we crash."
+        },
+        { "sharedHost", APT::NO_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+          APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+          "Rather than a single service from the cwd, host the services "
+          "the controller asks us to load, sharing one channel."
         }
     };
 
@@ -142,11 +191,22 @@ ServiceRunner::runServiceProcess(int argc, const char ** argv)
         std::string loglevel = argParser.argument("log");
         bfs::path logfile(argParser.argument("logfile"));
         setupLogging(loglevel, logfile);
+    }
 
-        // if we're redirecting to a file we'll intercept stdout && stderr  
-        if (!logfile.empty()) {
-            redirector.redirect();
-        }
+    // service logging and standard output go through a ring which
+    // a thread drains to the log, so a chatty or wedged log
+    // destination can't stall the service
+    bfs::path ringPath(argParser.argument("outputRing"));
+    if (argParser.argumentPresent("outputRing") &&
+        ring.open(ringPath) && ring.start(&sink))
+    {
+        OutputRing::setCurrent(&ring);
+    }
+
+    // if we're redirecting to a file or ring we'll intercept
+    // stdout && stderr
+    if (!argParser.argument("logfile").empty() || OutputRing::current()) {
+        redirector.redirect();
     }
 
     BPLOG_INFO("Service Process running");
@@ -156,8 +216,29 @@ ServiceRunner::runServiceProcess(int argc, const char ** argv)
     bp::runloop::RunLoop rl;
     rl.init();
 
-    // Allocate service and parse manifest
-    ServiceLibrary lib;
+    // a shared host loads services on demand.  lib stays empty, so
+    // service output captured in the ring is logged as is.
+    if (argParser.argumentPresent("sharedHost")) {
+        BPLOG_INFO_STRM("Shared Service Host connecting to ipc: " << ipcName);
+
+        bool connected = false;
+        {
+            LibraryHost host(&rl, ipcName);
+            connected = host.connect();
+            if (connected) {
+                rl.run();
+            } else {
+                BPLOG_WARN("Shared Service Host couldn't connect to "
+                           "controller, exiting");
+            }
+        }
+        rl.shutdown();
+
+        BPLOG_INFO("Shared Service Host exiting");
+        return connected;
+    }
+
+    // parse service manifest
     bool parsed = lib.parseManifest(err);
 
     if (!parsed) {
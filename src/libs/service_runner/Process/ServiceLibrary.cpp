@@ -31,6 +31,7 @@
 #include "ServiceLibrary.h"
 #include <stdarg.h>
 #include <string.h>
+#include <sstream>
 
 #include <ServiceAPI/bptypes.h>
 #include <ServiceAPI/bpdefinition.h>
@@ -63,7 +64,10 @@ ServiceLibrary::~ServiceLibrary()
     // first we'll clear our shared pointer to implementation.
     // this is important so that we destruct the impl (involving calling
     // into the service) before unloading the code.
-    m_impl.reset();
+    {
+        bp::sync::Lock lck(m_implLock);
+        m_impl.reset();
+    }
 
     if (m_handle)
     {
@@ -84,7 +88,13 @@ ServiceLibrary::parseManifest(std::string & err)
     //      to the location where the service api version *really* lives.
     //      (yeah, we could include a version in manifest too, but that would
     //       be a DRY violation)
-    return m_summary.detectService(bpf::absolutePath(bfs::path(".")), err);
+    return parseManifest(bfs::path("."), err);
+}
+
+bool
+ServiceLibrary::parseManifest(const bfs::path & serviceDir, std::string & err)
+{
+    return m_summary.detectService(bpf::absolutePath(serviceDir), err);
 }
 
 std::string
@@ -112,7 +122,8 @@ struct FunctionTableBase
 
 // load the service
 bool
-ServiceLibrary::load(const bfs::path & providerPath, std::string & err)
+ServiceLibrary::load(const bfs::path & providerPath, std::string & err,
+                     unsigned int requiredAPIVersion)
 {
     BPASSERT(m_handle == NULL);
     
@@ -177,14 +188,34 @@ ServiceLibrary::load(const bfs::path & providerPath, std::string & err)
     // service
     BPLOG_INFO_STRM("Attempting to load service with API version " << version);
 
+    if (requiredAPIVersion != 0 && version != requiredAPIVersion)
+    {
+        std::stringstream ss;
+        ss << "service API version " << version << " where "
+           << requiredAPIVersion << " is required";
+        err = ss.str();
+        BPLOG_WARN_STRM("skipping '" << path << "', " << err);
+        dlcloseNP(m_handle);
+        m_handle = NULL;
+        return false;
+    }
+
     bool success = false;
-    
-    if (version == 5) m_impl.reset(new ServiceLibrary_v5);
-    else if (version == 4) m_impl.reset(new ServiceLibrary_v4);
+    std::tr1::shared_ptr<ServiceLibraryImpl> impl;
+
+    if (version == 5) impl.reset(new ServiceLibrary_v5);
+    else if (version == 4) impl.reset(new ServiceLibrary_v4);
+
+    if (impl != NULL) 
+    {
+        success = impl->load(m_summary, provider, funcTable);
+    }
 
-    if (m_impl != NULL) 
+    // only a loaded implementation is handed to logServiceEvent(),
+    // until then service output is logged as is
     {
-        success = m_impl->load(m_summary, provider, funcTable);
+        bp::sync::Lock lck(m_implLock);
+        m_impl = impl;
     }
 
     if (!success) 
@@ -241,6 +272,19 @@ ServiceLibrary::promptResponse(unsigned int promptId,
     m_impl->promptResponse(promptId, arguments);
 }
 
+void
+ServiceLibrary::logServiceEvent(unsigned int level, const std::string & msg)
+{
+    // held across the call, so the implementation can't be unloaded
+    // out from under us
+    bp::sync::Lock lck(m_implLock);
+    if (m_impl) {
+        m_impl->logServiceEvent(level, msg);
+    } else {
+        BPLOG_INFO(msg);
+    }
+}
+
 void
 ServiceLibrary::setListener(IServiceLibraryListener * listener)
 {
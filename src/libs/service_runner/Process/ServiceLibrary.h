@@ -30,6 +30,7 @@
 #ifndef __SERVICELIBRARY_H__
 #define __SERVICELIBRARY_H__
 
+#include "BPUtils/bpsync.h"
 #include "BPUtils/bptr1.h"
 #include "platform_utils/ServiceDescription.h"
 #include "platform_utils/ServiceSummary.h"
@@ -70,12 +71,20 @@ namespace ServiceRunner
         // parse the manifest from the cwd, populating name and version
         bool parseManifest(std::string & oError);
 
+        // parse the manifest from serviceDir, for hosts which can't
+        // chdir into the service (see InProcessService)
+        bool parseManifest(const boost::filesystem::path & serviceDir,
+                           std::string & oError);
+
         // load the service
         // when service type is dependent, providerPath must be supplied,
         // and must be a valid path to a service that satisfies the
         // dependent's requirements.
+        // when requiredAPIVersion is non-zero, services written to any
+        // other version of the service API are refused.
         bool load(const boost::filesystem::path & providerPath,
-                  std::string & oError);
+                  std::string & oError,
+                  unsigned int requiredAPIVersion = 0);
 
         unsigned int apiVersion();
         
@@ -105,8 +114,15 @@ namespace ServiceRunner
         void promptResponse(unsigned int promptId,
                             const bp::Object * arguments);
 
+        // log a line on behalf of the service, as if it had called
+        // its log function.  used to deliver lines from an OutputRing.
+        void logServiceEvent(unsigned int level, const std::string & msg);
+
       private:
         std::tr1::shared_ptr<class ServiceLibraryImpl> m_impl;
+        // guards m_impl against logServiceEvent(), which an OutputRing
+        // calls from its drain thread while we load and unload
+        bp::sync::Mutex m_implLock;
         
         bp::service::Summary m_summary;
 
@@ -74,6 +74,10 @@ namespace ServiceRunner
         virtual void promptResponse(unsigned int promptId,
                                     const bp::Object * arguments) = 0;
 
+        // log a line on behalf of the service, as its log function does
+        virtual void logServiceEvent(unsigned int level,
+                                     const std::string & msg) = 0;
+
     };
 }
 
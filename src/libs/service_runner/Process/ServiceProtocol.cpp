@@ -34,12 +34,53 @@
 
 using namespace ServiceRunner;
 
+void
+ServiceRunner::tagPayload(bp::ipc::Message& m, unsigned int library)
+{
+    bp::Map* wrapped = new bp::Map;
+    wrapped->add("library", new bp::Integer(library));
+    if (m.payload()) wrapped->add("payload", m.payload()->clone());
+    m.setPayload(wrapped);
+}
+
+
+unsigned int
+ServiceRunner::untagPayload(bp::ipc::Message& m)
+{
+    const bp::Object* p = m.payload();
+    if (p == NULL || p->type() != BPTMap || !p->has("library", BPTInteger)) {
+        return 0;
+    }
+    unsigned int library = (unsigned int) (long long) *(p->get("library"));
+
+    // setPayload() clones its argument before freeing the old payload
+    const bp::Object* inner = p->get("payload");
+    if (inner) {
+        m.setPayload(*inner);
+    } else {
+        m.setPayload(bp::Null());
+    }
+    return library;
+}
+
+
 ServiceProtocol::ServiceProtocol(ServiceLibrary* lib,
                                  bp::runloop::RunLoop* rl,
                                  const std::string& ipcName)
-    : m_lib(lib), m_rl(rl), m_ipcName(ipcName)
+    : m_lib(lib), m_chan(new bp::ipc::Channel), m_rl(rl), m_library(0),
+      m_ipcName(ipcName)
+{
+    m_chan->setListener(this);
+    m_lib->setListener(this);
+}
+
+
+ServiceProtocol::ServiceProtocol(ServiceLibrary* lib,
+                                 bp::ipc::Channel* chan,
+                                 unsigned int library)
+    : m_lib(lib), m_chan(chan), m_rl(NULL), m_library(library),
+      m_ipcName()
 {
-    m_chan.setListener(this);
     m_lib->setListener(this);
 }
 
@@ -47,7 +88,7 @@ ServiceProtocol::ServiceProtocol(ServiceLibrary* lib,
 bool
 ServiceProtocol::connect()
 {
-    if (!m_chan.connect(m_ipcName)) {
+    if (!m_chan->connect(m_ipcName)) {
         return false;
     }
 
@@ -67,7 +108,7 @@ ServiceProtocol::connect()
         return false;
     }
     
-    if (!m_chan.sendMessage(m)) return false;
+    if (!m_chan->sendMessage(m)) return false;
 
     return true;
 }
@@ -75,6 +116,23 @@ ServiceProtocol::connect()
 
 ServiceProtocol::~ServiceProtocol()
 {
+    if (m_library == 0) delete m_chan;
+}
+
+
+bool
+ServiceProtocol::send(bp::ipc::Message& m)
+{
+    if (m_library) tagPayload(m, m_library);
+    return m_chan->sendMessage(m);
+}
+
+
+bool
+ServiceProtocol::send(bp::ipc::Response& r)
+{
+    if (m_library) tagPayload(r, m_library);
+    return m_chan->sendResponse(r);
 }
 
 
@@ -85,7 +143,7 @@ ServiceProtocol::channelEnded(
     const char*)
 {
     BPLOG_INFO("connection ended!");
-    m_rl->stop();
+    if (m_rl) m_rl->stop();
 }
 
 
@@ -250,7 +308,7 @@ ServiceProtocol::onResults(unsigned int instance, unsigned int tid,
     m->add("instance", new bp::Integer(instance));
     if (o) m->add("results", o->clone());
     r.setPayload(m);
-    if (!m_chan.sendResponse(r)) {
+    if (!send(r)) {
         BPLOG_WARN_STRM("failed to send result response for tid " << tid);
     }
 
@@ -276,7 +334,7 @@ ServiceProtocol::onError(unsigned int instance,
         m->add("verboseError", new bp::String(verboseError));
     }
     r.setPayload(m);
-    if (!m_chan.sendResponse(r)) {
+    if (!send(r)) {
         BPLOG_WARN_STRM("failed to send error response for tid " << tid);
     }
 }
@@ -295,7 +353,7 @@ ServiceProtocol::onPrompt(unsigned int instance,
     p.add("path", new bp::String(pathToDialog.generic_string()));
     if (arguments) p.add("arguments", arguments->clone());
     m.setPayload(p.clone());
-    m_chan.sendMessage(m);    
+    (void) send(m);
 }
 
 void
@@ -314,6 +372,6 @@ ServiceProtocol::onCallback(unsigned int instance,
         p->add("value", o->clone());
     }
     m.setPayload(p);
-    m_chan.sendMessage(m);
+    (void) send(m);
 }
 
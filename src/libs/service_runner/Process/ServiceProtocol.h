@@ -40,6 +40,15 @@
 
 namespace ServiceRunner 
 {
+    // services sharing a host process (see LibraryHost) share its
+    // channel.  their traffic is told apart by wrapping each payload
+    // in a map along with the id of the library it's for.
+    void tagPayload(bp::ipc::Message & m, unsigned int library);
+
+    // unwrap a tagged payload in place, returning the library it's
+    // for, or zero if m isn't tagged (and is left alone)
+    unsigned int untagPayload(bp::ipc::Message & m);
+
     class ServiceProtocol : public bp::ipc::IChannelListener,
                             public IServiceLibraryListener 
     {
@@ -47,8 +56,17 @@ namespace ServiceRunner
         ServiceProtocol(ServiceLibrary * lib, bp::runloop::RunLoop * rl,
                         const std::string & ipcName);
         bool connect();
+
+        // speak for one of several libraries in a shared host, over
+        // the host's channel, tagging all we send with library
+        ServiceProtocol(ServiceLibrary * lib, bp::ipc::Channel * chan,
+                        unsigned int library);
+
         ~ServiceProtocol();
       private:
+        // the host hands us what arrives for our library, untagged
+        friend class LibraryHost;
+
         // implemented methods from bp::ipc::IChannelListener
         void channelEnded(bp::ipc::Channel * c,
                           bp::ipc::IConnectionListener::TerminationReason why,
@@ -60,9 +78,16 @@ namespace ServiceRunner
                         const bp::ipc::Response & response);
         
         ServiceLibrary * m_lib;
-        bp::ipc::Channel m_chan;
+        bp::ipc::Channel * m_chan;
         bp::runloop::RunLoop * m_rl;
 
+        // zero when the channel is ours alone
+        unsigned int m_library;
+
+        // tag m if we share the channel, then send it
+        bool send(bp::ipc::Message & m);
+        bool send(bp::ipc::Response & r);
+
         // methods from IServiceLibraryListener
         void onResults(unsigned int instance, unsigned int tid,
                        const bp::Object * o);
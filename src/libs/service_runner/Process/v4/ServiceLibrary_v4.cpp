@@ -30,6 +30,7 @@
 
 #include "ServiceLibrary_v4.h"
 #include "BPUtils/bpstrutil.h"
+#include "OutputRing.h"
 #include "V4ObjectConverter.h"
 
 using namespace std;
@@ -115,6 +116,15 @@ ServiceLibrary_v4::logFunction(unsigned int level, const char * fmt, ...)
     va_list ap;
     va_start(ap, fmt);
     
+    // in a service process output is captured in a ring and handed to
+    // logServiceEvent() by its drain thread
+    OutputRing * ring = OutputRing::current();
+    if (ring) {
+        ring->writev(OutputRing::S_Service, level, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
     // how big a string do we need?
     char* buf = NULL;
     unsigned int sz = 0;
@@ -713,8 +723,9 @@ ServiceLibrary_v4::invoke(unsigned int id, unsigned int tid,
 
     // argument validation. does function exist?  are parameters
     // correct?
-    bp::service::Function funcDesc;
-    if (!m_desc.getFunction(function.c_str(), funcDesc))
+    const bp::service::Function * funcDesc =
+        m_desc.function(function.c_str());
+    if (funcDesc == NULL)
     {
         std::stringstream ss;
         ss << "no such function: " << function;
@@ -731,7 +742,7 @@ ServiceLibrary_v4::invoke(unsigned int id, unsigned int tid,
 
     // now we've got the arguments and description, we're in a
     // position where we can validate the args.
-    err = bp::service::validateArguments(funcDesc, (bp::Map *) arguments);
+    err = bp::service::validateArguments(*funcDesc, (bp::Map *) arguments);
     
     if (!err.empty()) {
         postErrorFunction(tid, "bp.invokeError", err.c_str());
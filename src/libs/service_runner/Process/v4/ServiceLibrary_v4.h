@@ -82,6 +82,8 @@ namespace ServiceRunner
         void promptResponse(unsigned int promptId,
                             const bp::Object * arguments);
 
+        void logServiceEvent(unsigned int level, const std::string& msg);
+
       private:
         // current instance id.  we start counting at 1
         unsigned int m_currentId;
@@ -186,7 +188,6 @@ namespace ServiceRunner
                                      PromptContext & ctx);
 
         void setupServiceLogging();
-        void logServiceEvent(unsigned int level, const std::string& msg);
         bp::log::ServiceLogMode m_serviceLogMode;
         bp::log::Logger m_serviceLogger;
         
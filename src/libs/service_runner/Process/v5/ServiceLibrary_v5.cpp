@@ -30,6 +30,8 @@
 
 #include "ServiceLibrary_v5.h"
 #include "BPUtils/bpstrutil.h"
+#include "BPUtils/bpsync.h"
+#include "OutputRing.h"
 
 using namespace std;
 using namespace std::tr1;
@@ -76,35 +78,106 @@ struct InstanceResponse
     ~InstanceResponse() { if (o) delete o; }
 };
 
-static ServiceLibrary_v5 * s_libObjectPtr = NULL;
-    
+// Libraries loaded in this process, by slot.  The C entry points
+// carry no context, so the library in slot N is handed a function
+// table whose entry points find it at s_libraries[N].
+static const unsigned int kMaxLibraries = 16;
+static ServiceLibrary_v5 * s_libraries[kMaxLibraries];
+static BPCFunctionTable s_tables[kMaxLibraries];
+static bool s_tablesFilled = false;
+static bp::sync::Mutex s_librariesLock;
+
+namespace ServiceRunner 
+{
+    template <unsigned int N>
+    struct EntryPoints
+    {
+        static void postResults(unsigned int tid,
+                                const struct BPElement_t * results) {
+            s_libraries[N]->postResults(tid, results);
+        }
+        static void postError(unsigned int tid, const char * error,
+                              const char * verboseError) {
+            s_libraries[N]->postError(tid, error, verboseError);
+        }
+        static void log(unsigned int level, const char * fmt, ...) {
+            va_list ap;
+            va_start(ap, fmt);
+            s_libraries[N]->logv(level, fmt, ap);
+            va_end(ap);
+        }
+        static void invoke(unsigned int tid, long long int callbackHandle,
+                           const struct BPElement_t * results) {
+            s_libraries[N]->invokeCallback(tid, callbackHandle, results);
+        }
+        static unsigned int prompt(unsigned int tid,
+                                   const BPPath pathToHTMLDialog,
+                                   const BPElement * args,
+                                   BPUserResponseCallbackFuncPtr cb,
+                                   void * cookie) {
+            return s_libraries[N]->promptUser(tid, pathToHTMLDialog, args,
+                                              cb, cookie);
+        }
+        static void invokeOnMainThread(BPCMainThreadCallbackPtr cb) {
+            s_libraries[N]->invokeOnMainThread(cb);
+        }
+
+        // fill tables N down to 0
+        static void fill() {
+            BPCFunctionTable & t = s_tables[N];
+            memset((void *) &t, 0, sizeof(t));
+            t.postResults = postResults;
+            t.postError = postError;
+            t.log = log;
+            t.invoke = invoke;
+            t.prompt = prompt;
+            t.invokeOnMainThread = invokeOnMainThread;
+            EntryPoints<N - 1>::fill();
+        }
+    };
+
+    template <>
+    struct EntryPoints<(unsigned int) -1>
+    {
+        static void fill() { }
+    };
+}
+
 void
-ServiceLibrary_v5::postResultsFunction(unsigned int tid,
-                                       const struct BPElement_t * results)
+ServiceLibrary_v5::postResults(unsigned int tid,
+                               const struct BPElement_t * results)
 {
     InstanceResponse * ir = new InstanceResponse;
     ir->type = InstanceResponse::T_Results;
     ir->tid = tid;
     ir->o = (results ? bp::Object::build(results) : NULL);
-    s_libObjectPtr->hop(ir);
+    hop(ir);
 }
 
 void
-ServiceLibrary_v5::postErrorFunction(unsigned int tid,
-                                     const char * error,
-                                     const char * verboseError)
+ServiceLibrary_v5::postError(unsigned int tid,
+                             const char * error,
+                             const char * verboseError)
 {
     InstanceResponse * ir = new InstanceResponse;
     ir->type = InstanceResponse::T_Error;
     ir->tid = tid;
     if (error) ir->error.append(error);
     if (verboseError) ir->verboseError.append(verboseError);    
-    s_libObjectPtr->hop(ir);
+    hop(ir);
 }
 
 void
-ServiceLibrary_v5::logFunction(unsigned int level, const char * fmt, ...)
+ServiceLibrary_v5::logv(unsigned int level, const char * fmt, va_list ap)
 {
+    // in a service process output is captured in a ring and handed to
+    // logServiceEvent() by its drain thread
+    OutputRing * ring = OutputRing::current();
+    if (ring) {
+        ring->writev(OutputRing::S_Service, level, fmt, ap);
+        return;
+    }
+
 // copying va_args.
 #ifndef va_copy
 # ifdef __va_copy
@@ -114,9 +187,6 @@ ServiceLibrary_v5::logFunction(unsigned int level, const char * fmt, ...)
 # endif
 #endif
     
-    va_list ap;
-    va_start(ap, fmt);
-    
     // how big a string do we need?
     char* buf = NULL;
     unsigned int sz = 0;
@@ -157,10 +227,9 @@ ServiceLibrary_v5::logFunction(unsigned int level, const char * fmt, ...)
     // Handle buf=NULL.
     std::string str = bp::strutil::safeStr(buf);
 
-    s_libObjectPtr->logServiceEvent(level, str);
+    logServiceEvent(level, str);
     
     delete[] buf;
-    va_end(ap);
 }
 
 
@@ -207,6 +276,10 @@ ServiceLibrary_v5::setupServiceLogging()
     if (dest == bp::log::kDestFile) {
         bfs::path p(name().empty() ? "service" : name());
         p.replace_extension("log");
+        // a spawned service runs in its own directory, one loaded
+        // in process or in a shared host doesn't, so don't depend
+        // on the cwd
+        if (!m_summary.path().empty()) p = m_summary.path() / p;
         cfg.setPath(p);
     }
 	else if (dest == bp::log::kDestConsole) {
@@ -228,11 +301,9 @@ ServiceLibrary_v5::setupServiceLogging()
 void
 ServiceLibrary_v5::logServiceEvent(unsigned int level, const std::string& msg)
 {
-    static bool s_firstTime = true;
-
-    if (s_firstTime) {
+    if (!m_serviceLoggingSetup) {
         setupServiceLogging();
-        s_firstTime = false;
+        m_serviceLoggingSetup = true;
     }
 
     // Convert the level.
@@ -257,29 +328,29 @@ ServiceLibrary_v5::logServiceEvent(unsigned int level, const std::string& msg)
 
 
 void
-ServiceLibrary_v5::invokeCallbackFunction(unsigned int tid,
-                                          long long int callbackHandle,
-                                          const struct BPElement_t * results)
+ServiceLibrary_v5::invokeCallback(unsigned int tid,
+                                  long long int callbackHandle,
+                                  const struct BPElement_t * results)
 {
     InstanceResponse * ir = new InstanceResponse;
     ir->type = InstanceResponse::T_CallBack;
     ir->tid = tid;
     ir->callbackId = callbackHandle;
     ir->o = (results ? bp::Object::build(results) : NULL);
-    s_libObjectPtr->hop(ir);
+    hop(ir);
 }
 
 void
-ServiceLibrary_v5::invokeOnMainThreadFunction(BPCMainThreadCallbackPtr cb)
+ServiceLibrary_v5::invokeOnMainThread(BPCMainThreadCallbackPtr cb)
 {
     InstanceResponse * ir = new InstanceResponse;
     ir->type = InstanceResponse::T_MainThreadCallback;
     ir->mainThreadCallback = cb;
-    s_libObjectPtr->hop(ir);
+    hop(ir);
 }
 
 unsigned int
-ServiceLibrary_v5::promptUserFunction(
+ServiceLibrary_v5::promptUser(
     unsigned int tid,
     const BPPath pathToHTMLDialog,
     const BPElement * args,
@@ -306,38 +377,39 @@ ServiceLibrary_v5::promptUserFunction(
     ir->responseCookie = cookie;
     ir->promptId = cpid;
 
-    s_libObjectPtr->hop(ir);
+    hop(ir);
 
     return cpid;
 }
 // END call-in points for dynamically loaded services
 
-// the static callback function table
+// the callback function table for our slot
 const void *
-ServiceLibrary_v5::getFunctionTable()
+ServiceLibrary_v5::callbackTable()
 {
-    static BPCFunctionTable * table = NULL;
-    static BPCFunctionTable tableData;
-    if (table != NULL) return table;
-    memset((void *) &tableData, 0, sizeof(tableData));
-    tableData.postResults = postResultsFunction;
-    tableData.postError = postErrorFunction;
-    tableData.log = logFunction;
-    tableData.invoke = invokeCallbackFunction;
-    tableData.prompt = promptUserFunction;
-    tableData.invokeOnMainThread = invokeOnMainThreadFunction;
-
-    table = &tableData;
-    return (void *) table;
+    if (m_slot >= kMaxLibraries) return NULL;
+    return (const void *) (s_tables + m_slot);
 }
 
 ServiceLibrary_v5::ServiceLibrary_v5() :
     m_currentId(1), m_handle(NULL), m_funcTable(NULL),
-    m_desc(), m_serviceAPIVersion(0), m_instances(), m_listener(NULL),
-    m_promptToTransaction(), 
+    m_desc(), m_serviceAPIVersion(0), m_slot(kMaxLibraries), m_instances(),
+    m_listener(NULL), m_promptToTransaction(), 
+    m_serviceLoggingSetup(false),
     m_serviceLogMode( bp::log::kServiceLogCombined ), m_serviceLogger()
 {
-    s_libObjectPtr = this;
+    bp::sync::Lock lock(s_librariesLock);
+    if (!s_tablesFilled) {
+        EntryPoints<kMaxLibraries - 1>::fill();
+        s_tablesFilled = true;
+    }
+    for (unsigned int i = 0; i < kMaxLibraries; i++) {
+        if (s_libraries[i] == NULL) {
+            s_libraries[i] = this;
+            m_slot = i;
+            break;
+        }
+    }
 }
         
 ServiceLibrary_v5::~ServiceLibrary_v5()
@@ -359,7 +431,10 @@ ServiceLibrary_v5::~ServiceLibrary_v5()
     // shutdown the library
     shutdownService(true);
 
-    s_libObjectPtr = NULL;
+    if (m_slot < kMaxLibraries) {
+        bp::sync::Lock lock(s_librariesLock);
+        s_libraries[m_slot] = NULL;
+    }
 }
 
 std::string
@@ -427,7 +502,15 @@ ServiceLibrary_v5::load(const bp::service::Summary &summary,
     
     funcTable = (const BPPFunctionTable *) m_funcTable;
 
-    if (funcTable == NULL || funcTable->initializeFunc == NULL)
+    if (callbackTable() == NULL)
+    {
+        BPLOG_WARN_STRM("can't load " << m_summary.name() << " | "
+                        << m_summary.version() << ", " << kMaxLibraries
+                        << " services already loaded in this process");
+        success = false;
+        callShutdown = false;
+    }
+    else if (funcTable == NULL || funcTable->initializeFunc == NULL)
     {
         BPLOG_WARN_STRM("invalid service, NULL initialize function ("
                         << m_summary.name() << " | " << m_summary.version()<< ")");
@@ -443,7 +526,7 @@ ServiceLibrary_v5::load(const bp::service::Summary &summary,
         const BPServiceDefinition * def = NULL;
 
         def = funcTable->initializeFunc(
-            (const BPCFunctionTable *) getFunctionTable(),
+            (const BPCFunctionTable *) callbackTable(),
             (const BPPath) (bp::file::nativeString(servicePath).c_str()),
             (const BPPath) (dependentPath.empty() ? NULL : bp::file::nativeString(dependentPath).c_str()),
             dependentParams);
@@ -569,28 +652,29 @@ ServiceLibrary_v5::invoke(unsigned int id, unsigned int tid,
 
     // argument validation. does function exist?  are parameters
     // correct?
-    bp::service::Function funcDesc;
-    if (!m_desc.getFunction(function.c_str(), funcDesc))
+    const bp::service::Function * funcDesc =
+        m_desc.function(function.c_str());
+    if (funcDesc == NULL)
     {
         std::stringstream ss;
         ss << "no such function: " << function;
         err = ss.str();
-        postErrorFunction(tid, "bp.noSuchFunction", err.c_str());
+        postError(tid, "bp.noSuchFunction", err.c_str());
         return true;
     }
 
     if (arguments && arguments->type() != BPTMap) {
         err.append("arguments must be a map");
-        postErrorFunction(tid, "bp.invokeError", err.c_str());
+        postError(tid, "bp.invokeError", err.c_str());
         return true;
     }
 
     // now we've got the arguments and description, we're in a
     // position where we can validate the args.
-    err = bp::service::validateArguments(funcDesc, (bp::Map *) arguments);
+    err = bp::service::validateArguments(*funcDesc, (bp::Map *) arguments);
     
     if (!err.empty()) {
-        postErrorFunction(tid, "bp.invokeError", err.c_str());
+        postError(tid, "bp.invokeError", err.c_str());
         return true;
     }
     
@@ -602,7 +686,7 @@ ServiceLibrary_v5::invoke(unsigned int id, unsigned int tid,
         std::stringstream ss;
         ss << "no such instance: " << id;
         err = ss.str();
-        postErrorFunction(tid, "bp.invokeError", err.c_str());
+        postError(tid, "bp.invokeError", err.c_str());
         return true;
     }
     
@@ -688,7 +772,14 @@ ServiceLibrary_v5::onHop(void * context)
     InstanceResponse * ir = (InstanceResponse *) context;
     BPASSERT(ir != NULL);
 
-    // all InstanceResponses have a populated tid, all need an
+    // main thread callbacks belong to no transaction
+    if (ir->type == InstanceResponse::T_MainThreadCallback) {
+        if (ir->mainThreadCallback) ir->mainThreadCallback();
+        delete ir;
+        return;
+    }
+
+    // all other InstanceResponses have a populated tid, all need an
     // instance id to go with it.
     unsigned int instance;
         
@@ -721,10 +812,8 @@ ServiceLibrary_v5::onHop(void * context)
                                        ir->callbackId, ir->o);
                 break;
             }
-            case InstanceResponse::T_MainThreadCallback: {
-                if (ir->mainThreadCallback) ir->mainThreadCallback();
+            case InstanceResponse::T_MainThreadCallback:
                 break;
-            }
             case InstanceResponse::T_Prompt: {
                 if (!transactionKnown(ir->tid)) {
                     BPLOG_ERROR_STRM("can't send prompt from, unknown "
@@ -31,6 +31,7 @@
 #ifndef __SERVICELIBRARY_V5_H__
 #define __SERVICELIBRARY_V5_H__
 
+#include <stdarg.h>
 #include <string>
 #include "../ServiceLibraryImpl.h"
 #include "BPUtils/bpthreadhopper.h"
@@ -80,6 +81,8 @@ namespace ServiceRunner
         void promptResponse(unsigned int promptId,
                             const bp::Object * arguments);
 
+        void logServiceEvent(unsigned int level, const std::string& msg);
+
       private:
         // current instance id.  we start counting at 1
         unsigned int m_currentId;
@@ -98,8 +101,12 @@ namespace ServiceRunner
         // the service api version, populated during load
         unsigned int m_serviceAPIVersion;
 
-        // get the function table that we'll pass to services
-        static const void * getFunctionTable();
+        // several libraries may be loaded in one process (see
+        // InProcessService).  each holds a slot, and is handed the
+        // function table whose entry points call back into that slot.
+        unsigned int m_slot;
+        const void * callbackTable();
+        template <unsigned int N> friend struct EntryPoints;
 
         // shutdown the service and unload the library
         void shutdownService(bool callShutdown);
@@ -126,26 +133,26 @@ namespace ServiceRunner
         // how instance threads call back into the main thread.
         void onHop(void * context);
 
-        // entry points for services
-        static void postResultsFunction(unsigned int tid,
-                                        const struct BPElement_t * results);
+        // entry points for services, reached through callbackTable()
+        void postResults(unsigned int tid,
+                         const struct BPElement_t * results);
 
-        static void postErrorFunction(unsigned int tid,
-                                      const char * error,
-                                      const char * verboseError);
+        void postError(unsigned int tid,
+                       const char * error,
+                       const char * verboseError);
 
-        static void logFunction(unsigned int level, const char * fmt, ...);
+        void logv(unsigned int level, const char * fmt, va_list ap);
         
-        static void invokeCallbackFunction(unsigned int tid,
-                                           long long int callbackHandle,
-                                           const struct BPElement_t * results);
-        static unsigned int promptUserFunction(
+        void invokeCallback(unsigned int tid,
+                            long long int callbackHandle,
+                            const struct BPElement_t * results);
+        unsigned int promptUser(
             unsigned int tid,
             const BPPath utf8PathToHTMLDialog,
             const BPElement * args,
             BPUserResponseCallbackFuncPtr responseCallback,
             void * cookie);
-        static void invokeOnMainThreadFunction(BPCMainThreadCallbackPtr cb);
+        void invokeOnMainThread(BPCMainThreadCallbackPtr cb);
         // end entry points for services
 
 
@@ -183,7 +190,7 @@ namespace ServiceRunner
                                      PromptContext & ctx);
 
         void setupServiceLogging();
-        void logServiceEvent(unsigned int level, const std::string& msg);
+        bool m_serviceLoggingSetup;
         bp::log::ServiceLogMode m_serviceLogMode;
         bp::log::Logger m_serviceLogger;
         
@@ -0,0 +1,155 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * InProcessServiceTest.cpp
+ * Lifecycle tests of services run within the controlling process.
+ * A directory without a manifest stands in for the service, its load
+ * fails on the worker thread which is enough to drive replies back.
+ */
+
+#include "InProcessServiceTest.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bptime.h"
+#include "BPUtils/bptimer.h"
+#include "ServiceRunnerLib/ServiceRunnerLib.h"
+
+namespace bfs = boost::filesystem;
+using std::tr1::shared_ptr;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(InProcessServiceTest);
+
+// counts what a controller reports, stopping the runloop at the end
+// of the service or when time runs out
+class CountingListener : public ServiceRunner::IControllerListener,
+                         public bp::time::ITimerListener
+{
+  public:
+    CountingListener(bp::runloop::RunLoop * rl)
+        : ended(0), other(0), m_rl(rl) { }
+
+    // run the runloop for at most msec
+    void runFor(unsigned int msec)
+    {
+        bp::time::Timer t;
+        t.setListener(this);
+        t.setMsec(msec);
+        m_rl->run();
+        t.cancel();
+    }
+
+    int ended;
+    int other;
+
+  private:
+    void timesUp(bp::time::Timer *) { m_rl->stop(); }
+    void initialized(ServiceRunner::Controller *, const std::string &,
+                     const std::string &, unsigned int) { other++; }
+    void onEnded(ServiceRunner::Controller *) { ended++; m_rl->stop(); }
+    void onDescribe(ServiceRunner::Controller *,
+                    const bp::service::Description &) { other++; }
+    void onAllocated(ServiceRunner::Controller *, unsigned int,
+                     unsigned int) { other++; }
+    void onInvokeResults(ServiceRunner::Controller *, unsigned int,
+                         unsigned int, const bp::Object *) { other++; }
+    void onInvokeError(ServiceRunner::Controller *, unsigned int,
+                       unsigned int, const std::string &,
+                       const std::string &) { other++; }
+    void onCallback(ServiceRunner::Controller *, unsigned int,
+                    unsigned int, long long int,
+                    const bp::Object *) { other++; }
+    void onPrompt(ServiceRunner::Controller *, unsigned int, unsigned int,
+                  const bfs::path &, const bp::Object *) { other++; }
+    void onInstallHook(ServiceRunner::Controller *, int) { other++; }
+    void onUninstallHook(ServiceRunner::Controller *, int) { other++; }
+
+    bp::runloop::RunLoop * m_rl;
+};
+
+void
+InProcessServiceTest::loadFailureEndsOnce()
+{
+    bp::runloop::RunLoop rl;
+    rl.init();
+    CountingListener l(&rl);
+
+    shared_ptr<ServiceRunner::Controller> c(
+        new ServiceRunner::Controller(m_path));
+    c->setListener(&l);
+    std::string err;
+    CPPUNIT_ASSERT(c->runInProcess(bfs::path(), err));
+    CPPUNIT_ASSERT(c->inProcess());
+
+    l.runFor(5000);
+    CPPUNIT_ASSERT_EQUAL(1, l.ended);
+
+    // calls after the end are dropped, and the end isn't reported again
+    bp::Map args;
+    (void) c->invoke(1, "noSuchFunction", &args);
+    c->destroy(1);
+    l.runFor(200);
+    CPPUNIT_ASSERT_EQUAL(1, l.ended);
+    CPPUNIT_ASSERT_EQUAL(0, l.other);
+
+    c.reset();
+    rl.shutdown();
+}
+
+void
+InProcessServiceTest::releaseWithRepliesInFlight()
+{
+    bp::runloop::RunLoop rl;
+    rl.init();
+    CountingListener l(&rl);
+
+    shared_ptr<ServiceRunner::Controller> c(
+        new ServiceRunner::Controller(m_path));
+    c->setListener(&l);
+    std::string err;
+    CPPUNIT_ASSERT(c->runInProcess(bfs::path(), err));
+
+    // let the worker fail the load and hop its reply, then release the
+    // controller before the runloop gets to deliver it
+    bp::time::sleepSec(0.2);
+    c.reset();
+
+    // the reply must be dropped rather than delivered to a dead service
+    l.runFor(200);
+    CPPUNIT_ASSERT_EQUAL(0, l.ended);
+    CPPUNIT_ASSERT_EQUAL(0, l.other);
+
+    rl.shutdown();
+}
+
+void 
+InProcessServiceTest::setUp()
+{
+    m_path = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                   "InProcessServiceTest");
+    bfs::create_directories(m_path);
+}
+
+void 
+InProcessServiceTest::tearDown()
+{
+    CPPUNIT_ASSERT(bp::file::safeRemove(m_path));
+}
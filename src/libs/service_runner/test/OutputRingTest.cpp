@@ -0,0 +1,228 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * OutputRingTest.cpp
+ * Tests of the ring service output is captured in.  The ring holds
+ * 256 lines.
+ */
+
+#include "OutputRingTest.h"
+#include <sstream>
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bptime.h"
+#include "OutputRing.h"
+
+namespace bfs = boost::filesystem;
+using ServiceRunner::OutputRing;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(OutputRingTest);
+
+#define RING_LINES 256
+
+// collects what the drain thread hands on
+class CollectingSink : public OutputRing::ISink
+{
+  public:
+    CollectingSink() : m_dropped(0) { }
+
+    std::vector<std::string> lines()
+    {
+        bp::sync::Lock lck(m_lock);
+        return m_lines;
+    }
+
+    unsigned int dropped()
+    {
+        bp::sync::Lock lck(m_lock);
+        return m_dropped;
+    }
+
+    // wait for count lines to arrive, for at most 10s
+    bool waitFor(size_t count)
+    {
+        for (int i = 0; i < 1000; i++) {
+            if (lines().size() >= count) return true;
+            bp::time::sleepSec(0.01);
+        }
+        return false;
+    }
+
+  private:
+    void onLine(OutputRing::Source, unsigned int, const std::string & line)
+    {
+        bp::sync::Lock lck(m_lock);
+        m_lines.push_back(line);
+    }
+
+    void onDropped(unsigned int count)
+    {
+        bp::sync::Lock lck(m_lock);
+        m_dropped += count;
+    }
+
+    bp::sync::Mutex m_lock;
+    std::vector<std::string> m_lines;
+    unsigned int m_dropped;
+};
+
+static std::string
+lineText(unsigned int i)
+{
+    std::stringstream ss;
+    ss << "line " << i;
+    return ss.str();
+}
+
+static bool
+writeLine(OutputRing & ring, unsigned int i)
+{
+    std::string s = lineText(i);
+    return ring.write(OutputRing::S_Service, 0, s.c_str(), s.length());
+}
+
+void
+OutputRingTest::fullRingDrops()
+{
+    OutputRing ring;
+    CPPUNIT_ASSERT(ring.open(bfs::path()));
+
+    // nothing drains yet, so the ring fills and the rest is dropped
+    unsigned int i;
+    for (i = 0; i < RING_LINES; i++) {
+        CPPUNIT_ASSERT(writeLine(ring, i));
+    }
+    CPPUNIT_ASSERT(!writeLine(ring, i));
+    CPPUNIT_ASSERT(!writeLine(ring, i));
+
+    CollectingSink sink;
+    CPPUNIT_ASSERT(ring.start(&sink));
+    ring.stop();
+
+    std::vector<std::string> lines = sink.lines();
+    CPPUNIT_ASSERT_EQUAL((size_t) RING_LINES, lines.size());
+    for (i = 0; i < RING_LINES; i++) {
+        CPPUNIT_ASSERT_EQUAL(lineText(i), lines[i]);
+    }
+    CPPUNIT_ASSERT_EQUAL(2u, sink.dropped());
+}
+
+void
+OutputRingTest::wraparound()
+{
+    OutputRing ring;
+    CPPUNIT_ASSERT(ring.open(bfs::path()));
+    CollectingSink sink;
+    CPPUNIT_ASSERT(ring.start(&sink));
+
+    // several laps of the ring, a batch at a time so none is dropped
+    unsigned int written = 0;
+    while (written < 4 * RING_LINES + 10) {
+        for (unsigned int j = 0; j < RING_LINES / 2; j++) {
+            CPPUNIT_ASSERT(writeLine(ring, written++));
+        }
+        CPPUNIT_ASSERT(sink.waitFor(written));
+    }
+    ring.stop();
+
+    std::vector<std::string> lines = sink.lines();
+    CPPUNIT_ASSERT_EQUAL((size_t) written, lines.size());
+    for (unsigned int i = 0; i < written; i++) {
+        CPPUNIT_ASSERT_EQUAL(lineText(i), lines[i]);
+    }
+    CPPUNIT_ASSERT_EQUAL(0u, sink.dropped());
+}
+
+void
+OutputRingTest::stopDrains()
+{
+    CollectingSink sink;
+    {
+        OutputRing ring;
+        CPPUNIT_ASSERT(ring.open(bfs::path()));
+        CPPUNIT_ASSERT(ring.start(&sink));
+        for (unsigned int i = 0; i < RING_LINES; i++) {
+            CPPUNIT_ASSERT(writeLine(ring, i));
+        }
+        // the ring goes away with lines still in it, which must all
+        // reach the sink before it does
+    }
+
+    std::vector<std::string> lines = sink.lines();
+    CPPUNIT_ASSERT_EQUAL((size_t) RING_LINES, lines.size());
+    for (unsigned int i = 0; i < RING_LINES; i++) {
+        CPPUNIT_ASSERT_EQUAL(lineText(i), lines[i]);
+    }
+}
+
+void
+OutputRingTest::recentSkipsLogged()
+{
+    OutputRing ring;
+    CPPUNIT_ASSERT(ring.open(m_path));
+    CollectingSink sink;
+    CPPUNIT_ASSERT(ring.start(&sink));
+
+    // drain more than a lap, so the slots have been reused
+    unsigned int i;
+    for (i = 0; i < RING_LINES + 10; i++) {
+        CPPUNIT_ASSERT(writeLine(ring, i));
+        if (i % 100 == 99) CPPUNIT_ASSERT(sink.waitFor(i + 1));
+    }
+    ring.stop();
+    CPPUNIT_ASSERT_EQUAL((size_t) i, sink.lines().size());
+
+    std::vector<std::string> lines;
+    unsigned int dropped = 1;
+    CPPUNIT_ASSERT(OutputRing::recent(m_path, 50, lines, dropped));
+    CPPUNIT_ASSERT(lines.empty());
+    CPPUNIT_ASSERT_EQUAL(0u, dropped);
+
+    // with the drain stopped, later lines are what a controller dumps
+    unsigned int first = i;
+    for (; i < first + 5; i++) {
+        CPPUNIT_ASSERT(writeLine(ring, i));
+    }
+    CPPUNIT_ASSERT(OutputRing::recent(m_path, 50, lines, dropped));
+    CPPUNIT_ASSERT_EQUAL((size_t) 5, lines.size());
+    for (unsigned int j = 0; j < 5; j++) {
+        CPPUNIT_ASSERT_EQUAL("[log] " + lineText(first + j), lines[j]);
+    }
+
+    // and no more than asked for, the most recent
+    CPPUNIT_ASSERT(OutputRing::recent(m_path, 2, lines, dropped));
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, lines.size());
+    CPPUNIT_ASSERT_EQUAL("[log] " + lineText(first + 3), lines[0]);
+}
+
+void 
+OutputRingTest::setUp()
+{
+    m_path = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                   "OutputRingTest");
+}
+
+void 
+OutputRingTest::tearDown()
+{
+    (void) bp::file::safeRemove(m_path);
+}
@@ -0,0 +1,108 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * ServiceProtocolTest.cpp
+ * Tests of the tagging which tells apart the traffic of services
+ * sharing a host.
+ */
+
+#include "ServiceProtocolTest.h"
+#include "ServiceProtocol.h"
+
+using ServiceRunner::tagPayload;
+using ServiceRunner::untagPayload;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ServiceProtocolTest);
+
+void
+ServiceProtocolTest::tagRoundTrip()
+{
+    bp::Map m;
+    m.add("function", new bp::String("Echo"));
+    m.add("args", new bp::Integer(42));
+
+    bp::ipc::Query q;
+    q.setCommand("invoke");
+    q.setPayload(m);
+    unsigned int id = q.id();
+
+    tagPayload(q, 7);
+    CPPUNIT_ASSERT(q.payload() != NULL);
+    CPPUNIT_ASSERT(q.payload()->has("library", BPTInteger));
+    CPPUNIT_ASSERT(q.payload()->has("payload", BPTMap));
+
+    CPPUNIT_ASSERT_EQUAL(7u, untagPayload(q));
+    CPPUNIT_ASSERT(q.payload() != NULL);
+    CPPUNIT_ASSERT_EQUAL(m.toJsonString(), q.payload()->toJsonString());
+
+    // only the payload is wrapped
+    CPPUNIT_ASSERT_EQUAL(std::string("invoke"), q.command());
+    CPPUNIT_ASSERT_EQUAL(id, q.id());
+}
+
+void
+ServiceProtocolTest::tagWithoutPayload()
+{
+    bp::ipc::Message m;
+    m.setCommand("shutdown");
+
+    tagPayload(m, 3);
+    CPPUNIT_ASSERT(m.payload() != NULL);
+    CPPUNIT_ASSERT(!m.payload()->has("payload"));
+
+    // there was nothing to unwrap, which comes back as null
+    CPPUNIT_ASSERT_EQUAL(3u, untagPayload(m));
+    CPPUNIT_ASSERT(m.payload() != NULL);
+    CPPUNIT_ASSERT_EQUAL(BPTNull, m.payload()->type());
+}
+
+void
+ServiceProtocolTest::untagMalformed()
+{
+    // no payload at all
+    bp::ipc::Message m;
+    CPPUNIT_ASSERT_EQUAL(0u, untagPayload(m));
+    CPPUNIT_ASSERT(m.payload() == NULL);
+
+    // a payload which isn't a map
+    m.setPayload(bp::String("library"));
+    CPPUNIT_ASSERT_EQUAL(0u, untagPayload(m));
+    CPPUNIT_ASSERT_EQUAL(BPTString, m.payload()->type());
+
+    // a map without a library
+    bp::Map noLibrary;
+    noLibrary.add("payload", new bp::Integer(1));
+    m.setPayload(noLibrary);
+    CPPUNIT_ASSERT_EQUAL(0u, untagPayload(m));
+    CPPUNIT_ASSERT_EQUAL(noLibrary.toJsonString(),
+                         m.payload()->toJsonString());
+
+    // a library which isn't a number
+    bp::Map badLibrary;
+    badLibrary.add("library", new bp::String("7"));
+    badLibrary.add("payload", new bp::Integer(1));
+    m.setPayload(badLibrary);
+    CPPUNIT_ASSERT_EQUAL(0u, untagPayload(m));
+    CPPUNIT_ASSERT_EQUAL(badLibrary.toJsonString(),
+                         m.payload()->toJsonString());
+}
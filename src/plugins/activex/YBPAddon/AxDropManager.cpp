@@ -65,7 +65,8 @@ AxDropManager::~AxDropManager()
 bool AxDropManager::addTarget( const std::string& sElement,
                                const std::set<std::string>& mimeTypes,
                                bool includeGestureInfo,
-                               unsigned int limit )
+                               unsigned int limit,
+                               bool streamed )
 {
     // Find an available drop channel.
     tDropChannelVecIt itChan =
@@ -79,7 +80,7 @@ bool AxDropManager::addTarget( const std::string& sElement,
     
     // Connect to the specified dom element over this channel.
     if (!itChan->connect( sElement, mimeTypes, 
-                          includeGestureInfo, limit ))
+                          includeGestureInfo, limit, streamed ))
     {
         BPLOG_ERROR( "itChan->connect failed!" );
         return false;
@@ -117,7 +117,8 @@ public:
     virtual bool addTarget( const std::string& sElement,
                             const std::set<std::string>& mimeTypes,
                             bool includeGestureInfo,
-                            unsigned int limit );
+                            unsigned int limit,
+                            bool streamed );
     virtual bool addTarget( const std::string& sElement,
                             const std::string& sVersion );
     virtual bool removeTarget( const std::string& sElement );
@@ -91,7 +91,8 @@ std::string DropChannel::sourceId()
 bool DropChannel::connect( const std::string& sElementId,
                            const std::set<std::string>& mimeTypes,
                            bool includeGestureInfo,
-                           unsigned int limit)
+                           unsigned int limit,
+                           bool streamed)
 {
     if (!isAvailable())
     {
@@ -121,6 +122,7 @@ bool DropChannel::connect( const std::string& sElementId,
     m_mimetypes = mimeTypes;
     m_includeGestureInfo = includeGestureInfo;
     m_limit = limit;
+    m_streamed = streamed;
     m_version = "1.0.0";
     
     return true;
@@ -180,6 +182,7 @@ bool DropChannel::disconnect()
     m_mimetypes.clear();
     m_includeGestureInfo = false;
     m_limit = 0;
+    m_streamed = false;
     
     return true;
 }
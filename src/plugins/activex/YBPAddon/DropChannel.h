@@ -53,7 +53,8 @@ public:
     bool connect( const std::string& sSourceId,
                   const std::set<std::string>& mimeTypes,
                   bool includeGestureInfo,
-                  unsigned int limit );
+                  unsigned int limit,
+                  bool streamed );
     bool connect( const std::string& sSourceId,
                   const std::string& sVersion );
     bool disconnect();
@@ -46,7 +46,8 @@ DropTargetBase::DropTargetBase()
       m_state(DropTargetBase::Idle),
       m_dropState(DropTargetBase::Unknown),
       m_enabled(true),
-      m_limit(1000)
+      m_limit(1000),
+      m_streamed(false)
 {
 }
   
@@ -54,7 +55,8 @@ DropTargetBase::DropTargetBase()
 DropTargetBase::DropTargetBase(const string& name,
                                const set<string>& mimeTypes,
                                bool includeGestureInfo,
-                               unsigned int limit)
+                               unsigned int limit,
+                               bool streamed)
     : m_name(name),
       m_mimetypes(mimeTypes), 
       m_includeGestureInfo(includeGestureInfo),
@@ -64,6 +66,7 @@ DropTargetBase::DropTargetBase(const string& name,
       m_dropState(DropTargetBase::Unknown),
       m_enabled(true),
       m_limit(limit),
+      m_streamed(streamed),
       m_version("1.0.0")
 {
 }
@@ -80,6 +83,7 @@ DropTargetBase::DropTargetBase(const string& name,
       m_dropState(DropTargetBase::Unknown),
       m_enabled(true),
       m_limit(0),
+      m_streamed(false),
       m_version(version)
 {
 }
@@ -95,6 +99,7 @@ DropTargetBase::DropTargetBase(const DropTargetBase& dtb)
       m_dropState(Unknown),
       m_enabled(dtb.m_enabled),
       m_limit(dtb.m_limit),
+      m_streamed(dtb.m_streamed),
       m_version(dtb.m_version)
 {
 }
@@ -208,7 +213,8 @@ DropTargetBase::dropItems()
 
     if (m_version.find("1.") == 0) {
         // version 1 api resolves links here, applies 
-        // mimetype and limits, etc
+        // mimetype and limits, etc.  streamed targets leave
+        // the walk to the listener.
         vector<bfs::path>::iterator it = m_dragItems.begin();
         while (it != m_dragItems.end()) {
             bfs::path path(*it);
@@ -222,6 +228,13 @@ DropTargetBase::dropItems()
             }
             ++it;
         }
+        if (m_streamed) {
+            bp::List* l = new bp::List;
+            for (it = m_dragItems.begin(); it != m_dragItems.end(); ++it) {
+                l->append(new bp::Path(*it));
+            }
+            return l;
+        }
         unsigned int flags = bp::pluginutil::kRecurse;
         if (m_includeGestureInfo) flags |= bp::pluginutil::kIncludeGestureInfo;
         rval = bp::pluginutil::applyFilters(m_dragItems, m_mimetypes,
@@ -239,6 +252,13 @@ DropTargetBase::dropItems()
 }
 
 
+bool
+DropTargetBase::isStreamed()
+{
+    return m_streamed;
+}
+
+
 std::string
 DropTargetBase::name()
 {
@@ -249,7 +269,7 @@ DropTargetBase::name()
 bool 
 DropTargetBase::directoryContainsMimeType(const bfs::path& path)
 {    
-    class MyVisitor : public bp::file::IVisitor {
+    class MyVisitor : public bp::file::IBatchVisitor {
     public:
         MyVisitor(const set<string>& mimeTypes,
                   unsigned int limit)
@@ -257,30 +277,29 @@ DropTargetBase::directoryContainsMimeType(const bfs::path& path)
               m_numChecked(0), m_found(false) {
         }
         virtual ~MyVisitor() {}
-        virtual tResult visitNode(const bfs::path& p,
-                                  const bfs::path&) {
-            if (m_numChecked >= m_limit) {
-                return eStop;
-            }
-            m_numChecked++;
-            bfs::path resolved = p;
-            if (bpf::isLink(p)) {
-                if (!bpf::resolveLink(p, resolved)) {
-                    return eOk;
+        virtual bpf::IVisitor::tResult visitNodes(
+            const vector<bpf::WalkEntry>& entries) {
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (m_numChecked >= m_limit) {
+                    return bpf::IVisitor::eStop;
                 }
-            }
-            if (bpf::isDirectory(resolved)) {
-                if (m_mimeTypes.count(bpf::kFolderMimeType)) {
-                    m_found = true;
-                    return eStop;
+                m_numChecked++;
+                const bpf::WalkEntry& e = entries[i];
+                if (e.isLink) {
+                    // links are followed, so this one is broken
+                    continue;
                 }
-            } else if (bpf::isRegularFile(resolved)) {
-                if (bpf::isMimeType(resolved, m_mimeTypes)) {
+                if (e.isDirectory) {
+                    if (m_mimeTypes.count(bpf::kFolderMimeType)) {
+                        m_found = true;
+                        return bpf::IVisitor::eStop;
+                    }
+                } else if (bpf::isMimeType(e, m_mimeTypes)) {
                     m_found = true;
-                    return eStop;
+                    return bpf::IVisitor::eStop;
                 }
             }
-            return eOk;
+            return bpf::IVisitor::eOk;
         }
         set<string> m_mimeTypes;
         size_t m_limit;
@@ -288,8 +307,9 @@ DropTargetBase::directoryContainsMimeType(const bfs::path& path)
         bool m_found;
     };
     
+    // in order, so that the limit checks the same entries every time
     MyVisitor v(m_mimetypes, m_limit);
-    (void) recursiveVisit(path, v, true);
+    (void) parallelVisitInOrder(path, v, true);
     return v.m_found;
 }
 
@@ -53,7 +53,8 @@ class DropTargetBase
     DropTargetBase(const std::string& name,
                    const std::set<std::string>& mimeTypes,
                    bool includeGestureInfo,
-                   unsigned int limit);
+                   unsigned int limit,
+                   bool streamed);
     DropTargetBase(const std::string& name,
                    const std::string& version);
     DropTargetBase(const DropTargetBase& dtc);
@@ -69,6 +70,7 @@ class DropTargetBase
     
     virtual bool canAcceptDrop();
     virtual bp::Object* dropItems(); // caller assumes ownership of return value
+    virtual bool isStreamed();
 
   protected:
     virtual bool directoryContainsMimeType(const boost::filesystem::path& path);
@@ -87,6 +89,7 @@ class DropTargetBase
     DropState m_dropState;
     bool m_enabled;
     unsigned int m_limit;
+    bool m_streamed;
     std::string m_version;
 };
 
@@ -47,7 +47,9 @@ public:
                          bool hover) = 0;
     
     // Items is either a list or a map.  See documentation of
-    // AddDropTarget() in DnDPluglet.cpp for description.
+    // AddDropTarget() in DnDPluglet.cpp for description.  For
+    // targets added with 'streamed', items is the list of dropped
+    // paths with links resolved, filtering is left to the listener.
     //
     virtual void onDrop(const std::string& id,
                         const bp::Object* items) = 0;
@@ -46,7 +46,8 @@ public:
     virtual bool addTarget(const std::string& sElement,
                            const std::set<std::string>& mimeTypes,
                            bool includeGestureInfo,
-                           unsigned int limit) = 0;
+                           unsigned int limit,
+                           bool streamed) = 0;
     virtual bool addTarget(const std::string& sElement,
                            const std::string& sVersion) = 0;
     virtual bool removeTarget(const std::string& sElement) = 0;
@@ -83,6 +83,9 @@ BPSession::~BPSession()
     BPASSERT(m_plugletRegistry != NULL);
     delete m_plugletRegistry;
     m_plugletRegistry = NULL;
+
+    // handles this session gave out are no longer reachable from the page
+    BPHandleMapper::releaseSession(this);
 }
 
 
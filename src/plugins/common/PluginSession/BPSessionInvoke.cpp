@@ -28,6 +28,7 @@
 #include "BPUtils/BPLog.h"
 #include "BPUtils/bperrorutil.h"
 #include "PluginCommonLib/bppluginutil.h"
+#include "PluginCommonLib/BPHandleMapper.h"
 #include "PluginCommonLib/CommonErrors.h"
 
 
@@ -62,15 +63,10 @@ BPSession::executeMethodRelayResultsCB(void * cookie)
     plugin::Variant* arg = plugin.allocVariant();
     plugin::Variant* result = plugin.allocVariant();
 
-    // translate results
-    {
-        bp::Object * safeObj = NULL;
-        if (ctx->results &&
-            bp::pluginutil::toBrowserSafeRep(ctx->results, safeObj))
-        {
-            delete ctx->results;
-            ctx->results = safeObj;
-        }
+    // translate results, handles created here belong to this session
+    if (ctx->results) {
+        BPHandleMapper::SessionScope scope(session);
+        ctx->results = bp::pluginutil::makeBrowserSafe(ctx->results);
     }
 
     if (ctx->ec != BP_EC_OK) {
@@ -234,7 +230,7 @@ BPSession::executeMethod(const std::string &service,
     addTransaction(ctx->transaction);
 
     bp::service::Description serviceDesc;
-    bp::service::Function funcDesc;
+    const bp::service::Function * funcDesc = NULL;
     std::string vErr;
 
     // ensure service is loaded
@@ -247,7 +243,7 @@ BPSession::executeMethod(const std::string &service,
         ctx->verboseError.append(ss.str());
     }
     // ensure the method exists on the service
-    else if (!serviceDesc.getFunction(method.c_str(), funcDesc))
+    else if ((funcDesc = serviceDesc.function(method.c_str())) == NULL)
     {
         std::stringstream ss;
         ss << service << " doesn't have a '" << method << "' method";
@@ -258,7 +254,7 @@ BPSession::executeMethod(const std::string &service,
         ctx->verboseError.append(ss.str());
     }
     // validate arguments
-    else if (!(vErr = bp::service::validateArguments(funcDesc, args)).empty())
+    else if (!(vErr = bp::service::validateArguments(*funcDesc, args)).empty())
     {
         BPLOG_INFO_STRM("invalid parameters in invoke: " << vErr);        
         ctx->ec = BP_EC_EXTENDED_ERROR;
@@ -328,15 +324,11 @@ BPSession::executeMethodInvokeCallbackRelayCB(void * cookie)
     plugin::Variant* result = plugin.allocVariant();
     plugin::Variant* arg = plugin.allocVariant();
 
-    {
-        bp::Object * jsonObj = NULL;
-    
-        // now we can translate results
-        if (cic->m_args && bp::pluginutil::toBrowserSafeRep(cic->m_args, jsonObj)) {
-            (void) plugin.evaluateJSON(jsonObj, arg);
-        }
-        
-        if (jsonObj) delete jsonObj;
+    // now we can translate results
+    if (cic->m_args) {
+        BPHandleMapper::SessionScope scope(cic->bp);
+        cic->m_args = bp::pluginutil::makeBrowserSafe(cic->m_args);
+        (void) plugin.evaluateJSON(cic->m_args, arg);
     }
 
     // now let's find the transaction
@@ -360,6 +352,7 @@ BPSession::executeMethodInvokeCallbackRelayCB(void * cookie)
 
     plugin.freeVariant(result);
     plugin.freeVariant(arg);
+    delete cic->m_args;
     delete cic;
 }
 
@@ -30,6 +30,9 @@
 
 #define DEFAULT_DROP_LIMIT 1000
 
+// chunks of a streamed drop in flight to the page at once
+#define STREAM_WINDOW 4
+
 #define _MAKESTRING(x) #x
 #define MAKESTRING(x) _MAKESTRING(x)
 
@@ -47,6 +50,9 @@ DnDPluglet::DnDPluglet(BPPlugin* plugin,
 
 DnDPluglet::~DnDPluglet()
 {
+    while (!m_streams.empty()) {
+        removeStream(m_streams.begin()->first);
+    }
 }
 
 
@@ -78,7 +84,8 @@ DnDPluglet::execute(unsigned int tid,
     if (!strcmp("AddDropTarget", function) ||
         !strcmp("RemoveDropTarget", function) ||
         !strcmp("AttachCallbacks", function) ||
-        !strcmp("EnableDropTarget", function)) {
+        !strcmp("EnableDropTarget", function) ||
+        !strcmp("CancelDrop", function)) {
         if (!arguments || !arguments->has("id", BPTString)) {
             BPLOG_WARN_STRM("execute " << function << " called will NULL arguments");
             failureCB(callbackArgument, tid, pluginerrors::InvalidParameters, NULL);
@@ -113,7 +120,22 @@ DnDPluglet::execute(unsigned int tid,
                     if (arguments->has("limit", BPTInteger)) {
                         limit = (unsigned int) (((bp::Integer*) arguments->get("limit"))->value());
                     }
-                    rv = m_dropMgr && m_dropMgr->addTarget(id, mimetypes, gestureInfo, limit);
+                    unsigned int chunkSize = 0;
+                    if (arguments->has("chunkSize", BPTInteger)) {
+                        BPInteger cs = ((bp::Integer*) arguments->get("chunkSize"))->value();
+                        if (cs > 0) chunkSize = (unsigned int) cs;
+                    }
+                    bool streamed = chunkSize > 0;
+                    rv = m_dropMgr && m_dropMgr->addTarget(id, mimetypes, gestureInfo,
+                                                           limit, streamed);
+                    if (rv && streamed) {
+                        DropFilter& f = m_filters[id];
+                        f.mimeTypes = mimetypes;
+                        f.flags = bp::pluginutil::kRecurse;
+                        if (gestureInfo) f.flags |= bp::pluginutil::kIncludeGestureInfo;
+                        f.limit = limit;
+                        f.chunkSize = chunkSize;
+                    }
                 } else {
                     rv = m_dropMgr && m_dropMgr->addTarget(id, m_desc.versionString());
                 }
@@ -130,6 +152,8 @@ DnDPluglet::execute(unsigned int tid,
                           "This id is not registered as a drop target");
             } else {
                 m_targets.erase(it);
+                m_filters.erase(id);
+                (void) removeStream(id);
                 bp::Bool rv(m_dropMgr && m_dropMgr->removeTarget(id));
                 successCB(callbackArgument, tid, &rv);
             }
@@ -180,6 +204,16 @@ DnDPluglet::execute(unsigned int tid,
                 bp::Bool rv(m_dropMgr->enableTarget(id, enable));
                 successCB(callbackArgument, tid, &rv);
             }
+        } else if (!strcmp("CancelDrop", function)) {
+            tStreamMap::iterator it = m_streams.find(id);
+            bool cancelled = false;
+            if (it != m_streams.end() && !it->second->done()) {
+                // the drop callback still hears of it, with 'cancelled' set
+                it->second->cancel();
+                cancelled = true;
+            }
+            bp::Bool rv(cancelled);
+            successCB(callbackArgument, tid, &rv);
         }
             
     } else if (!strcmp("ListTargets", function)) {
@@ -241,6 +275,87 @@ DnDPluglet::onDrop(const std::string& id,
         return;
     }
 
+    tFilterMap::const_iterator fit = m_filters.find(id);
+    if (fit == m_filters.end()) {
+        deliverDrop(id, items);
+        return;
+    }
+
+    // a streamed target, items are what was dropped.  walk them in
+    // the background and hand the page results as they're found.
+    const bp::List* l = dynamic_cast<const bp::List*>(items);
+    std::vector<boost::filesystem::path> selection;
+    for (unsigned int i = 0; l && i < l->size(); ++i) {
+        const bp::Path* p = dynamic_cast<const bp::Path*>(l->value(i));
+        if (p) selection.push_back(boost::filesystem::path(p->value()));
+    }
+
+    // a new drop supersedes one still in progress
+    (void) removeStream(id);
+
+    const DropFilter& f = fit->second;
+    bp::pluginutil::FilterStream* stream =
+        new bp::pluginutil::FilterStream(this, selection, f.mimeTypes,
+                                         f.flags, f.limit, f.chunkSize,
+                                         STREAM_WINDOW);
+    if (stream->start()) {
+        m_streams[id] = stream;
+        return;
+    }
+
+    // no thread, deliver the whole lot in one go
+    delete stream;
+    bp::Object* obj = bp::pluginutil::applyFilters(selection, f.mimeTypes,
+                                                   f.flags, f.limit);
+    bp::Map* chunk = NULL;
+    if (obj->type() == BPTMap) {
+        chunk = (bp::Map*) obj;
+    } else {
+        chunk = new bp::Map;
+        chunk->add("files", obj);
+    }
+    chunk->add("done", new bp::Bool(true));
+    deliverDrop(id, chunk);
+    delete chunk;
+}
+
+
+void
+DnDPluglet::onFilterChunk(bp::pluginutil::FilterStream* stream,
+                          const bp::Map& chunk)
+{
+    tStreamMap::iterator it;
+    for (it = m_streams.begin(); it != m_streams.end(); ++it) {
+        if (it->second == stream) break;
+    }
+    if (it == m_streams.end()) {
+        BPLOG_WARN("chunk received from unknown drop stream");
+        return;
+    }
+    std::string id = it->first;
+    if (stream->done()) {
+        m_streams.erase(it);
+        delete stream;
+    }
+    deliverDrop(id, &chunk);
+}
+
+
+bool
+DnDPluglet::removeStream(const std::string& id)
+{
+    tStreamMap::iterator it = m_streams.find(id);
+    if (it == m_streams.end()) return false;
+    delete it->second;
+    m_streams.erase(it);
+    return true;
+}
+
+
+void
+DnDPluglet::deliverDrop(const std::string& id,
+                        const bp::Object* items)
+{
     tTargetMap::iterator it;
     for (it = m_targets.begin(); it != m_targets.end(); it++) {
         if (!id.compare(it->first)) {
@@ -71,6 +71,21 @@ BPArgumentDefinition s_addArguments[] = {
 		"Default is " MAKESTRING(DEFAULT_DROP_LIMIT),
         BPTInteger,
         false
+    },
+    {
+        (BPString) "chunkSize",
+        (BPString) "If set, dropped folders are scanned in the background and "
+        "the 'drop' callback is invoked repeatedly with up to this many items "
+        "at a time as they are found, rather than once when the scan "
+        "completes.  Each invocation is passed a map containing 'files' "
+        "(as described for 'includeGestureInfo') and 'done', which is true "
+        "on the final invocation.  When 'includeGestureInfo' is true each "
+        "invocation also contains 'actualSelection', listing the selected "
+        "items reached since the previous invocation.  If the drop "
+        "was cancelled with CancelDrop(), the final invocation contains "
+        "'cancelled'.",
+        BPTInteger,
+        false
     }
 };
 
@@ -103,9 +118,8 @@ BPArgumentDefinition s_attachArguments[] = {
         (BPString) "drop",
         (BPString) "A function that will be invoked when the user drops files on "
         "your drop target.  Arguments to the callback vary depending on "
-        "whether 'includeGestureInfo' was set true for the target. "
-        "See the documentation for the 'includeGestureInfo' argument "
-        "to 'AddDropTarget()'",
+        "whether 'includeGestureInfo' or 'chunkSize' were set for the target. "
+        "See the documentation for those arguments to 'AddDropTarget()'",
         BPTCallBack,
         false
     }
@@ -156,6 +170,13 @@ BPFunctionDefinition s_dndFunctions[] = {
         sizeof(s_enableArguments)/sizeof(s_enableArguments[0]),
         s_enableArguments
     },
+    {
+        (BPString) "CancelDrop",
+        (BPString) "Stop scanning a drop on a target added with 'chunkSize'.  "
+        "Returns true if a drop was in progress.",
+        sizeof(s_idArgument)/sizeof(s_idArgument[0]),
+        s_idArgument
+    },
     {
         (BPString) "ListTargets",
         (BPString) "Returns a list of the ids of the currently registered drop targets.",
@@ -50,6 +50,10 @@ FileBrowsePluglet::FileBrowsePluglet(BPPlugin * plugin,
 
 FileBrowsePluglet::~FileBrowsePluglet()
 {
+    tStreamMap::iterator it;
+    for (it = m_streams.begin(); it != m_streams.end(); ++it) {
+        delete it->first;
+    }
 }
 
 
@@ -57,7 +61,7 @@ void
 FileBrowsePluglet::execute(unsigned int tid,
                            const char* function,
                            const bp::Object* arguments,
-                           bool /* syncInvocation */, 
+                           bool syncInvocation,
                            plugletExecutionSuccessCB successCB,
                            plugletExecutionFailureCB failureCB,
                            plugletInvokeCallbackCB   callbackCB,
@@ -81,6 +85,20 @@ FileBrowsePluglet::execute(unsigned int tid,
             return;
         }
         if (m_desc.majorVersion() == 1) {
+            if (!strcmp(function, "CancelBrowse")) {
+                // browses hear of it through their final chunk
+                bool cancelled = false;
+                tStreamMap::iterator it;
+                for (it = m_streams.begin(); it != m_streams.end(); ++it) {
+                    if (!it->first->done()) {
+                        it->first->cancel();
+                        cancelled = true;
+                    }
+                }
+                bp::Bool rv(cancelled);
+                successCB(callbackArgument, tid, &rv);
+                return;
+            }
             if (strcmp(function, "OpenBrowseDialog")) {
                 std::string s("unknown FileBrowse function " 
                               + std::string(function) + " called");
@@ -88,7 +106,18 @@ FileBrowsePluglet::execute(unsigned int tid,
                           pluginerrors::InvalidParameters, s.c_str());
                 return;
             }
-            v1Browse(tid, arguments, successCB, failureCB, callbackArgument);
+            // a streamed browse returns long after the callbacks
+            // start, the browser would lock up waiting
+            if (syncInvocation && arguments &&
+                arguments->has("chunk", BPTCallBack)) {
+                failureCB(callbackArgument, tid,
+                          "FileBrowse.invalidInvocation",
+                          "OpenBrowseDialog with 'chunk' may not be "
+                          "called synchronously");
+                return;
+            }
+            v1Browse(tid, arguments, successCB, failureCB, callbackCB,
+                     callbackArgument);
         } else if (m_desc.majorVersion() == 2) {
             if (strcmp(function, "OpenBrowseDialog")) {
                 std::string s("unknown FileBrowse function " 
@@ -138,3 +167,64 @@ FileBrowsePluglet::dialogTitle(const string& key)
 }
 
 
+void
+FileBrowsePluglet::v1Results(unsigned int tid,
+                             const bp::Object* arguments,
+                             const vector<boost::filesystem::path>& selection,
+                             const set<string>& mimetypes,
+                             unsigned int flags,
+                             unsigned int limit,
+                             plugletExecutionSuccessCB successCB,
+                             plugletInvokeCallbackCB callbackCB,
+                             void* callbackArgument)
+{
+    unsigned int chunkSize = 0;
+    if (arguments->has("chunkSize", BPTInteger)) {
+        BPInteger cs = ((bp::Integer*) arguments->get("chunkSize"))->value();
+        if (cs > 0) chunkSize = (unsigned int) cs;
+    }
+    if (chunkSize > 0 && arguments->has("chunk", BPTCallBack)) {
+        bp::pluginutil::FilterStream* stream =
+            new bp::pluginutil::FilterStream(this, selection, mimetypes,
+                                             flags, limit, chunkSize);
+        if (stream->start()) {
+            BrowseStream bs;
+            bs.tid = tid;
+            bs.chunkCB = ((bp::CallBack*) arguments->get("chunk"))->value();
+            bs.successCB = successCB;
+            bs.callbackCB = callbackCB;
+            bs.callbackArgument = callbackArgument;
+            m_streams[stream] = bs;
+            return;
+        }
+        // no thread, fall back to doing it all here
+        delete stream;
+    }
+
+    bp::Object* obj = bp::pluginutil::applyFilters(selection, mimetypes,
+                                                   flags, limit);
+    successCB(callbackArgument, tid, obj);
+    delete obj;
+}
+
+
+void
+FileBrowsePluglet::onFilterChunk(bp::pluginutil::FilterStream* stream,
+                                 const bp::Map& chunk)
+{
+    tStreamMap::iterator it = m_streams.find(stream);
+    if (it == m_streams.end()) {
+        BPLOG_WARN("chunk received from unknown browse stream");
+        return;
+    }
+    BrowseStream bs = it->second;
+    if (stream->done()) {
+        m_streams.erase(it);
+        delete stream;
+        bs.successCB(bs.callbackArgument, bs.tid, &chunk);
+    } else {
+        bs.callbackCB(bs.callbackArgument, bs.tid, bs.chunkCB, &chunk);
+    }
+}
+
+
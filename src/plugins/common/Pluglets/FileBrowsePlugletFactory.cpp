@@ -62,6 +62,27 @@ BPArgumentDefinition s_browseArguments[] = {
         "Default is 1000",
         BPTInteger,
         false
+    },
+    {
+        (BPString) "chunkSize",
+        (BPString) "Used with 'chunk'.  The maximum number of items passed "
+        "to each invocation of 'chunk'.",
+        BPTInteger,
+        false
+    },
+    {
+        (BPString) "chunk",
+        (BPString) "If set along with 'chunkSize', selected folders are "
+        "scanned in the background and this function is invoked with items "
+        "as they are found.  Each invocation is passed a map containing "
+        "'files' (as described for 'includeGestureInfo') and 'done'.  When "
+        "'includeGestureInfo' is true each invocation also contains "
+        "'actualSelection', listing the selected items reached since the "
+        "previous invocation.  The final chunk is the return value of "
+        "OpenBrowseDialog rather than being passed to this function, and "
+        "contains 'cancelled' if CancelBrowse() was called.",
+        BPTCallBack,
+        false
     }
 };
 
@@ -74,6 +95,13 @@ BPFunctionDefinition s_browseFunctions[] = {
         "Windows 7, multiple files or a single folder may be selected.",
         sizeof(s_browseArguments)/sizeof(s_browseArguments[0]),
         s_browseArguments
+    },
+    {
+        (BPString) "CancelBrowse",
+        (BPString) "Stop scanning the results of an OpenBrowseDialog() which "
+        "was passed a 'chunk' callback.  Returns true if a scan was in "
+        "progress.",
+        0, NULL
     }
 };
 
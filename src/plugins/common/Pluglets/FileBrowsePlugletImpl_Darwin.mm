@@ -248,6 +248,7 @@ FileBrowsePluglet::v1Browse(unsigned int tid,
                             const bp::Object* arguments,
                             plugletExecutionSuccessCB successCB,
                             plugletExecutionFailureCB failureCB,
+                            plugletInvokeCallbackCB callbackCB,
                             void* callbackArgument)
 {
     // Dig out args
@@ -318,15 +319,13 @@ FileBrowsePluglet::v1Browse(unsigned int tid,
         return;
     }
 
-    bp::Object* obj = NULL;
     unsigned int flags = 0;
     if (recurse) flags |= bp::pluginutil::kRecurse;
     if (includeGestureInfo) flags |= bp::pluginutil::kIncludeGestureInfo;
-    obj = bp::pluginutil::applyFilters(selection, mimetypes, flags, limit);
         
     // return results
-    successCB(callbackArgument, tid, obj);
-    delete obj;
+    v1Results(tid, arguments, selection, mimetypes, flags, limit,
+              successCB, callbackCB, callbackArgument);
 }
 
 
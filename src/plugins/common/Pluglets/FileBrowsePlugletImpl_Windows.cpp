@@ -75,6 +75,7 @@ void FileBrowsePluglet::v1Browse(unsigned int tid,
                                  const bp::Object* arguments,
                                  plugletExecutionSuccessCB successCB,
                                  plugletExecutionFailureCB failureCB,
+                                 plugletInvokeCallbackCB callbackCB,
                                  void* callbackArgument)
 {
     bool recurse = true;
@@ -173,10 +174,8 @@ void FileBrowsePluglet::v1Browse(unsigned int tid,
     unsigned int flags = 0;
     if (recurse) flags |= bp::pluginutil::kRecurse;
     if (includeGestureInfo) flags |= bp::pluginutil::kIncludeGestureInfo;
-    bp::Object* pObj = bp::pluginutil::applyFilters(vPaths, mimetypes,
-                                                    flags, limit);
-    successCB(callbackArgument, tid, pObj);
-    delete pObj;
+    v1Results(tid, arguments, vPaths, mimetypes, flags, limit,
+              successCB, callbackCB, callbackArgument);
 }
 
           
@@ -30,9 +30,11 @@
 #include "IDropListener.h"
 #include "IDropManager.h"
 #include "PluginCommonLib/Pluglet.h"
+#include "PluginCommonLib/bppluginutil.h"
 
 class DnDPluglet : public virtual Pluglet,
-                   public virtual IDropListener
+                   public virtual IDropListener,
+                   public virtual bp::pluginutil::IFilterStreamListener
 {
   public:
     DnDPluglet(BPPlugin* plugin,
@@ -74,15 +76,40 @@ class DnDPluglet : public virtual Pluglet,
         void* callbackArg;
     };
 
+    // how a streamed target filters its drops
+    struct DropFilter
+    {
+        std::set<std::string> mimeTypes;
+        unsigned int flags;
+        unsigned int limit;
+        unsigned int chunkSize;
+    };
+
     // IDropListener methods
     virtual void onHover(const std::string& id,
                          bool hover);
     virtual void onDrop(const std::string& id,
                         const bp::Object* items);
 
+    // IFilterStreamListener methods
+    virtual void onFilterChunk(bp::pluginutil::FilterStream* stream,
+                               const bp::Map& chunk);
+
+    // deliver to a target's drop callback
+    void deliverDrop(const std::string& id,
+                     const bp::Object* items);
+
+    // stop and forget any drop being streamed to a target.
+    // returns true if there was one.
+    bool removeStream(const std::string& id);
+
     IDropManager* m_dropMgr;
     typedef std::map<std::string, DnDCallbackInfo> tTargetMap; 
     tTargetMap m_targets;        
+    typedef std::map<std::string, DropFilter> tFilterMap;
+    tFilterMap m_filters;
+    typedef std::map<std::string, bp::pluginutil::FilterStream*> tStreamMap;
+    tStreamMap m_streams;
 };
 
 #endif
@@ -29,9 +29,12 @@
 
 #include "PluginCommonLib/Pluglet.h"
 #include "PluginCommonLib/BPPlugin.h"
+#include "PluginCommonLib/bppluginutil.h"
 #include <list>
+#include <map>
 
-class FileBrowsePluglet : public Pluglet
+class FileBrowsePluglet : public Pluglet,
+                          public bp::pluginutil::IFilterStreamListener
 {
 public:
     /** localization keys */
@@ -66,7 +69,21 @@ protected:
                   const bp::Object* arguments,
                   plugletExecutionSuccessCB successCB,
                   plugletExecutionFailureCB failureCB,
+                  plugletInvokeCallbackCB callbackCB,
                   void* callbackArgument);
+
+    // filter a version 1 selection and return it, either all at once
+    // or, if 'chunkSize' and 'chunk' were supplied, streamed to the
+    // 'chunk' callback with the final chunk as the return value.
+    void v1Results(unsigned int tid,
+                   const bp::Object* arguments,
+                   const std::vector<boost::filesystem::path>& selection,
+                   const std::set<std::string>& mimetypes,
+                   unsigned int flags,
+                   unsigned int limit,
+                   plugletExecutionSuccessCB successCB,
+                   plugletInvokeCallbackCB callbackCB,
+                   void* callbackArgument);
     void browse(unsigned int tid,
                 plugletExecutionSuccessCB successCB,
                 plugletExecutionFailureCB failureCB,
@@ -76,6 +93,22 @@ protected:
               plugletExecutionSuccessCB successCB,
               plugletExecutionFailureCB failureCB,
               void* callbackArgument);
+
+    // IFilterStreamListener methods
+    virtual void onFilterChunk(bp::pluginutil::FilterStream* stream,
+                               const bp::Map& chunk);
+
+    // a version 1 browse whose results are being streamed
+    struct BrowseStream
+    {
+        unsigned int tid;
+        BPCallBack chunkCB;
+        plugletExecutionSuccessCB successCB;
+        plugletInvokeCallbackCB callbackCB;
+        void* callbackArgument;
+    };
+    typedef std::map<bp::pluginutil::FilterStream*, BrowseStream> tStreamMap;
+    tStreamMap m_streams;
 };
 
 #endif
@@ -27,34 +27,77 @@
 * (c) 2007, Yahoo! Inc, all rights reserved.
 */
 
+#include <algorithm>
 #include <iostream>
 #include "BPHandleMapper.h"
 #include "BPUtils/bpfile.h"
 #include "BPUtils/bprandom.h"
+#include "BPUtils/bptr1.h"
 #include "BPUtils/BPLog.h"
 
 using namespace std;
+using namespace std::tr1;
 namespace bpf = bp::file;
 namespace bfs = boost::filesystem;
 
-map<bfs::path, BPHandle> s_pathMap;
-map<BPHandle, bfs::path> s_handleMap;
-map<bfs::path, BPHandle> s_writablePathMap;
-map<BPHandle, bfs::path> s_writableHandleMap;
+namespace {
+    struct Entry
+    {
+        Entry(const BPHandle& h, const bfs::path& p, bool perm)
+            : handle(h), path(p), permanent(perm), sessions() {
+        }
+        BPHandle handle;
+        bfs::path path;
+        // created outside any session, never released
+        bool permanent;
+        // sessions holding this handle
+        vector<const void*> sessions;
+    };
+
+    typedef unordered_map<int, Entry> tHandleTable;
+    typedef unordered_map<bfs::path::string_type, int> tPathIndex;
+    typedef unordered_map<const void*, vector<int> > tSessionIndex;
+}
+
+// handles by id, and indexes to them by path and by session
+static tHandleTable s_handles;
+static tPathIndex s_pathIndex;
+static tPathIndex s_writablePathIndex;
+static tSessionIndex s_sessions;
+
+// session of the innermost SessionScope
+static const void* s_session = NULL;
+
+// note that the current session holds a handle
+static void
+own(Entry& e, int id)
+{
+    if (s_session == NULL || e.permanent) return;
+    for (size_t i = 0; i < e.sessions.size(); ++i) {
+        if (e.sessions[i] == s_session) return;
+    }
+    e.sessions.push_back(s_session);
+    s_sessions[s_session].push_back(id);
+}
 
 static BPHandle 
 pathToHandleImpl(const bfs::path& path, bool writable)
 {
     string safeName = path.filename().string();
     vector<string> mimeTypes = bpf::mimeTypes(path);
+    int id = 0;
+    do {
+        id = bp::random::generate();
+    } while (s_handles.find(id) != s_handles.end());
     BPHandle h((writable ? "writablePath" : "path"),
-               bp::random::generate(), safeName, bpf::size(path), mimeTypes, writable);
+               id, safeName, bpf::size(path), mimeTypes, writable);
+    Entry& e = s_handles.insert(
+        make_pair(id, Entry(h, path, s_session == NULL))).first->second;
+    own(e, id);
     if (writable) {
-        s_writablePathMap.insert(make_pair(path, h));
-        s_writableHandleMap.insert(make_pair(h, path));
+        s_writablePathIndex[bpf::nativeString(path)] = id;
     } else {
-        s_pathMap.insert(make_pair(path, h));
-        s_handleMap.insert(make_pair(h, path));
+        s_pathIndex[bpf::nativeString(path)] = id;
     }
 
     return h;
@@ -66,11 +109,14 @@ pathToHandleImpl(const bfs::path& path, bool writable)
 BPHandle 
 BPHandleMapper::pathToWritableHandle(const bfs::path& path)
 {
-    map<bfs::path, BPHandle>::iterator it = s_writablePathMap.find(path);
-    if (it != s_writablePathMap.end()) {
+    tPathIndex::iterator it =
+        s_writablePathIndex.find(bpf::nativeString(path));
+    if (it != s_writablePathIndex.end()) {
         // allegedly found handle, update size and return.
-        it->second.m_size = bpf::size(path);
-        return it->second;
+        Entry& e = s_handles.find(it->second)->second;
+        e.handle.m_size = bpf::size(path);
+        own(e, it->second);
+        return e.handle;
     }
 
     return pathToHandleImpl(path, true);
@@ -80,159 +126,113 @@ BPHandleMapper::pathToWritableHandle(const bfs::path& path)
 BPHandle 
 BPHandleMapper::pathToHandle(const bfs::path& path)
 {
-    map<bfs::path, BPHandle>::iterator it = s_pathMap.find(path);
-    if (it != s_pathMap.end()) {
+    tPathIndex::iterator it = s_pathIndex.find(bpf::nativeString(path));
+    if (it != s_pathIndex.end()) {
         // allegedly found handle, update size and return.
-        it->second.m_size = bpf::size(path);
-        return it->second;
+        Entry& e = s_handles.find(it->second)->second;
+        e.handle.m_size = bpf::size(path);
+        own(e, it->second);
+        return e.handle;
     }
 
     return pathToHandleImpl(path, false);
 }
 
 
-bfs::path
-BPHandleMapper::handleValue(const BPHandle& handle)
+static bfs::path
+lookup(const BPHandle& handle, bool writable)
 {
     bfs::path rval;
-    map<BPHandle, bfs::path>::iterator it = s_handleMap.find(handle);
-    if (it != s_handleMap.end()) {
-        if (it->first.type().compare(handle.type()) == 0
-            && it->first.name().compare(handle.name()) == 0) {
-            rval = it->second;
+    tHandleTable::const_iterator it = s_handles.find(handle.id());
+    if (it != s_handles.end()) {
+        const BPHandle& h = it->second.handle;
+        if (h.writable() == writable
+            && h.type().compare(handle.type()) == 0
+            && h.name().compare(handle.name()) == 0) {
+            rval = it->second.path;
         }
     } 
     return rval;
 }
 
+bfs::path
+BPHandleMapper::handleValue(const BPHandle& handle)
+{
+    return lookup(handle, false);
+}
+
 bfs::path
 BPHandleMapper::writableHandleValue(const BPHandle& handle)
 {
-    bfs::path rval;
-    map<BPHandle, bfs::path>::iterator it = s_writableHandleMap.find(handle);
-    if (it != s_writableHandleMap.end()) {
-        if (it->first.type().compare(handle.type()) == 0
-            && it->first.name().compare(handle.name()) == 0) {
-            rval = it->second;
-        }
-    } 
-    return rval;
+    return lookup(handle, true);
 }
 
 
-bp::Object* 
-BPHandleMapper::insertHandles(const bp::Object* bpObj)
+bp::Object*
+BPHandleMapper::insertReplacement(bp::Object* obj)
 {
     using namespace bp;
-    
-    Object* rval = NULL;
-    switch(bpObj->type()) {
-        case BPTNull:
-            rval = new Null();
-            break;
-        case BPTBoolean:
-            rval = new Bool(dynamic_cast<const Bool*>(bpObj)->value());
-            break;
-        case BPTString:
-            rval = new String(dynamic_cast<const String*>(bpObj)->value());
-            break;
-        case BPTInteger:
-            rval = new Integer(dynamic_cast<const Integer*>(bpObj)->value());
-            break;
+
+    switch(obj->type()) {
         case BPTCallBack:
-            rval = new Integer(dynamic_cast<const CallBack*>(bpObj)->value());
-            break;
-        case BPTDouble:
-            rval = new Double(dynamic_cast<const Double*>(bpObj)->value());
-            break;
+            return new Integer(dynamic_cast<const CallBack*>(obj)->value());
         case BPTNativePath:
         case BPTWritableNativePath:
         {
             // Path must become a map containing id/name keys
-            const Path* pObj = dynamic_cast<const Path*>(bpObj);
+            const Path* pObj = dynamic_cast<const Path*>(obj);
             bfs::path path = *pObj;
-            BPHandle handle = (bpObj->type() == BPTNativePath ?
-                               pathToHandle(path) :
-                               pathToWritableHandle(path));
-            Map* m = new Map;
-            m->add(BROWSERPLUS_HANDLETYPE_KEY, new String(handle.type()));
-            m->add(BROWSERPLUS_HANDLEID_KEY, new Integer(handle.id()));
-            // TODO: eventually kill this guy once everyone is platform 2.0.7
-            //      or greater
-            m->add(DEPRECATED_BROWSERPLUS_HANDLENAME_KEY, new String(handle.name()));
-            m->add(BROWSERPLUS_HANDLENAME_KEY, new String(handle.name()));
-            m->add(BROWSERPLUS_HANDLESIZE_KEY, new Integer(handle.size()));
-            vector<string> mt = handle.mimeTypes();
-            vector<string>::const_iterator it;
-            List* l = new List;
-            for (it = mt.begin(); it != mt.end(); ++it) {
-                l->append(new String(it->c_str()));
-            }
-            m->add(BROWSERPLUS_HANDLEMIMETYPE_KEY, l);
-            rval = m;
-            break;
+            BPHandle handle = (obj->type() == BPTNativePath ?
+                               pathToHandle(path) : pathToWritableHandle(path));
+            return handle.toBPMap();
         }
         case BPTList:
         {
-            const List* me = dynamic_cast<const List*>(bpObj);
-            List* l = new List;
-            for (unsigned int i = 0; i < me->size(); i++) {
-                l->append(insertHandles(me->value(i)));
+            List* l = dynamic_cast<List*>(obj);
+            for (unsigned int i = 0; i < l->size(); i++) {
+                Object* r = insertReplacement(const_cast<Object*>(l->value(i)));
+                if (r) l->replace(i, r);
             }
-            rval = l;
             break;
         }
         case BPTMap:
         {
-            const Map* me = dynamic_cast<const Map*>(bpObj);
-            Map* m = new Map;
-            Map::Iterator iter(*me);
+            Map* m = dynamic_cast<Map*>(obj);
+            Map::Iterator iter(*m);
             const char* key = NULL;
             while ((key = iter.nextKey()) != NULL) {
-                const Object* obj = me->value(key);
-                Object* newObj = insertHandles(obj);
-                m->add(key, newObj);
+                Object* r = insertReplacement(const_cast<Object*>(m->value(key)));
+                if (r) m->replace(key, r);
             }
-            rval = m;
             break;
         }
-        case BPTAny:
-            // invalid
+        default:
             break;
     }
-    return rval;
+    return NULL;
 }
 
 
+// a handle which doesn't resolve becomes a bp::Null
 bp::Object*
-BPHandleMapper::expandHandles(const bp::Object* bpObj)
+BPHandleMapper::expandReplacement(bp::Object* obj)
 {
     using namespace bp;
-    
-    Object* rval = NULL;
-    switch(bpObj->type()) {
-        case BPTNull:
-        case BPTBoolean:
-        case BPTString:
-        case BPTInteger:
-        case BPTDouble:
-        case BPTCallBack:
-            rval = bpObj->clone();
-            break;
+
+    switch(obj->type()) {
         case BPTList:
         {
-            const List* me = dynamic_cast<const List*>(bpObj);
-            List* l = new List;
-            for (unsigned int i = 0; i < me->size(); i++) {
-                l->append(expandHandles(me->value(i)));
+            List* l = dynamic_cast<List*>(obj);
+            for (unsigned int i = 0; i < l->size(); i++) {
+                Object* r = expandReplacement(const_cast<Object*>(l->value(i)));
+                if (r) l->replace(i, r);
             }
-            rval = l;
             break;
         }
         case BPTMap:
         {
             // Handles are a map with 3 special keys.  Expand them.
-            const Map* me = dynamic_cast<const Map*>(bpObj);
+            Map* me = dynamic_cast<Map*>(obj);
             const String* typeObj = 
                 dynamic_cast<const String*>(me->value(BROWSERPLUS_HANDLETYPE_KEY));
             const Integer* idObj = 
@@ -259,29 +259,179 @@ BPHandleMapper::expandHandles(const bp::Object* bpObj)
                            mt, writable);
                 if (writable) {
                     bfs::path val = writableHandleValue(h);
-                    if (!val.empty()) rval = new WritablePath(val);
+                    if (!val.empty()) return new WritablePath(val);
                 } else {
                     bfs::path val = handleValue(h);
-                    if (!val.empty()) rval = new Path(val);                        
-                }
-            } else {
-                // just a vanilla map, recurse into it
-                Map* m = new Map;
-                Map::Iterator iter(*me);
-                const char* key = NULL;
-                while ((key = iter.nextKey()) != NULL) {
-                    const Object* obj = me->value(key);
-                    Object* newObj = expandHandles(obj);
-                    m->add(key, newObj);
+                    if (!val.empty()) return new Path(val);
                 }
-                rval = m;
+                return new Null;
+            }
+
+            // just a vanilla map, recurse into it
+            Map::Iterator iter(*me);
+            const char* key = NULL;
+            while ((key = iter.nextKey()) != NULL) {
+                Object* r = expandReplacement(const_cast<Object*>(me->value(key)));
+                if (r) me->replace(key, r);
             }
             break;
         }
+        default:
+            break;
+    }
+    return NULL;
+}
+
+
+bp::Object* 
+BPHandleMapper::insertHandles(const bp::Object* bpObj)
+{
+    return insertHandlesInPlace(bpObj->clone());
+}
+
+
+void
+BPHandleMapper::appendJson(const bp::Object* obj, std::string& out)
+{
+    using namespace bp;
+
+    switch(obj->type()) {
+        case BPTCallBack:
+            out.append(Integer(dynamic_cast<const CallBack*>(obj)->value())
+                       .toPlainJsonString());
+            break;
         case BPTNativePath:
         case BPTWritableNativePath:
-        case BPTAny:
+        {
+            const Path* pObj = dynamic_cast<const Path*>(obj);
+            bfs::path path = *pObj;
+            BPHandle handle = (obj->type() == BPTNativePath ?
+                               pathToHandle(path) : pathToWritableHandle(path));
+            Object* m = handle.toBPMap();
+            out.append(m->toPlainJsonString());
+            delete m;
+            break;
+        }
+        case BPTList:
+        {
+            const List* l = dynamic_cast<const List*>(obj);
+            out.push_back('[');
+            for (unsigned int i = 0; i < l->size(); i++) {
+                if (i > 0) out.push_back(',');
+                appendJson(l->value(i), out);
+            }
+            out.push_back(']');
+            break;
+        }
+        case BPTMap:
+        {
+            const Map* m = dynamic_cast<const Map*>(obj);
+            Map::Iterator iter(*m);
+            const char* key = NULL;
+            bool first = true;
+            out.push_back('{');
+            while ((key = iter.nextKey()) != NULL) {
+                if (!first) out.push_back(',');
+                first = false;
+                out.append(String(key).toPlainJsonString());
+                out.push_back(':');
+                appendJson(iter.value(), out);
+            }
+            out.push_back('}');
+            break;
+        }
+        default:
+            out.append(obj->toPlainJsonString());
             break;
     }
+}
+
+
+std::string
+BPHandleMapper::insertHandlesToJson(const bp::Object* bpObj)
+{
+    std::string rval;
+    if (bpObj == NULL) rval = "null";
+    else appendJson(bpObj, rval);
     return rval;
 }
+
+
+bp::Object*
+BPHandleMapper::expandHandles(const bp::Object* bpObj)
+{
+    return expandHandlesInPlace(bpObj->clone());
+}
+
+
+bp::Object* 
+BPHandleMapper::insertHandlesInPlace(bp::Object* bpObj)
+{
+    bp::Object* r = insertReplacement(bpObj);
+    if (r == NULL) return bpObj;
+    delete bpObj;
+    return r;
+}
+
+
+bp::Object*
+BPHandleMapper::expandHandlesInPlace(bp::Object* bpObj)
+{
+    bp::Object* r = expandReplacement(bpObj);
+    if (r == NULL) return bpObj;
+    delete bpObj;
+    if (r->type() == BPTNull) {
+        // an unresolvable handle
+        delete r;
+        r = NULL;
+    }
+    return r;
+}
+
+
+BPHandleMapper::SessionScope::SessionScope(const void* session)
+    : m_prev(s_session)
+{
+    s_session = session;
+}
+
+
+BPHandleMapper::SessionScope::~SessionScope()
+{
+    s_session = m_prev;
+}
+
+
+void
+BPHandleMapper::releaseSession(const void* session)
+{
+    tSessionIndex::iterator sit = s_sessions.find(session);
+    if (sit == s_sessions.end()) return;
+
+    vector<int>& ids = sit->second;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        tHandleTable::iterator it = s_handles.find(ids[i]);
+        if (it == s_handles.end()) continue;
+        Entry& e = it->second;
+        vector<const void*>::iterator vit =
+            std::find(e.sessions.begin(), e.sessions.end(), session);
+        if (vit != e.sessions.end()) e.sessions.erase(vit);
+        if (!e.sessions.empty()) continue;
+
+        // last holder gone
+        tPathIndex& index = e.handle.writable() ? s_writablePathIndex
+            : s_pathIndex;
+        index.erase(bpf::nativeString(e.path));
+        s_handles.erase(it);
+    }
+    BPLOG_DEBUG_STRM("released " << ids.size() << " handles for session "
+                     << session << ", " << s_handles.size() << " remain");
+    s_sessions.erase(sit);
+}
+
+
+size_t
+BPHandleMapper::size()
+{
+    return s_handles.size();
+}
@@ -55,9 +55,47 @@ public:
     static bp::Object* insertHandles(const bp::Object* bpObj);
     static bp::Object* expandHandles(const bp::Object* bpObj);
 
+    // As above, but translate bpObj in place, replacing only the paths
+    // or handles within it and leaving the rest of the tree alone.
+    // Takes ownership of bpObj and returns the translated object,
+    // which is bpObj itself unless bpObj is itself a path or handle.
+    static bp::Object* insertHandlesInPlace(bp::Object* bpObj);
+    static bp::Object* expandHandlesInPlace(bp::Object* bpObj);
+
+    // Serialize bpObj to plain JSON with handles inserted, reading
+    // bpObj where it lies rather than translating a copy of it.
+    static std::string insertHandlesToJson(const bp::Object* bpObj);
+
+    // Handles live as long as the sessions which handed them to a
+    // page.  While a SessionScope is alive, handles created or
+    // inserted belong (in part) to its session.  Handles created
+    // outside any scope live for the life of the plugin.
+    class SessionScope
+    {
+      public:
+        SessionScope(const void* session);
+        ~SessionScope();
+      private:
+        const void* m_prev;
+        SessionScope(const SessionScope&);
+        SessionScope& operator=(const SessionScope&);
+    };
+
+    // forget the handles which belong only to session
+    static void releaseSession(const void* session);
+
+    // number of live handles
+    static size_t size();
+
 private:
     static BPHandle pathToWritableHandle(const boost::filesystem::path& path);
 
+    // the object which should replace obj when translating it, or NULL
+    // if obj stays (having had its contents translated in place)
+    static bp::Object* insertReplacement(bp::Object* obj);
+    static bp::Object* expandReplacement(bp::Object* obj);
+    static void appendJson(const bp::Object* obj, std::string& out);
+
     BPHandleMapper() {};
     ~BPHandleMapper() {};
 };
@@ -36,6 +36,10 @@
 
 #include "BPProtocol/BPProtocol.h"
 #include "BPUtils/bpfile.h"
+#include "BPUtils/bpsync.h"
+#include "BPUtils/bpthread.h"
+#include "BPUtils/bpthreadhopper.h"
+#include "BPUtils/bptr1.h"
 #include "BPUtils/bptypeutil.h"
 
 
@@ -53,6 +57,11 @@ namespace pluginutil {
 
     // traverse a return value from BPCore.  perform handle obfuscation
     bool toBrowserSafeRep( const bp::Object* input, bp::Object*& output );
+
+    // as above, but translates input in place rather than copying it.
+    // takes ownership of input (which may be NULL), caller assumes
+    // ownership of the returned value.
+    bp::Object* makeBrowserSafe( bp::Object* input );
     
     
     // flags for applyFilters, OR them together as needed
@@ -60,12 +69,85 @@ namespace pluginutil {
     static const unsigned int kIncludeGestureInfo = 0x02;
     
     // apply filtering and recursion to a selection, returning the 
-    // approprate bp::Object.  Caller assumes ownership.
+    // approprate bp::Object.  Caller assumes ownership.  At most
+    // 'limit' files are returned, the first found walking the
+    // selection depth first.
     bp::Object* applyFilters(const std::vector<boost::filesystem::path>& selection,
                              const std::set<std::string>& mimeTypes,
                              unsigned int flags,
                              unsigned int limit);    
 
+    class FilterStream;
+
+    // receives the results of a FilterStream.  always called on the
+    // thread which created the stream.
+    class IFilterStreamListener
+    {
+      public:
+        virtual ~IFilterStreamListener() {}
+
+        // a chunk of results.  chunk is a map containing 'files' (a list
+        // of the items applyFilters() would have returned) and 'done'.
+        // for kIncludeGestureInfo streams, each chunk also carries
+        // 'actualSelection', the selected items the walk reached since
+        // the previous chunk.  Together they list the same items
+        // applyFilters() would have returned.  The final chunk has 'done' set, may
+        // contain no files, and has 'cancelled' set if the stream was
+        // cancelled.  The listener may delete the stream from here.
+        virtual void onFilterChunk(FilterStream* stream,
+                                   const bp::Map& chunk) = 0;
+    };
+
+    // applyFilters() for large selections.  The walk runs on a
+    // background thread and results are handed to the listener in
+    // chunks of up to 'chunkSize' items as they're found.  At most
+    // 'maxOutstanding' chunks are in flight to the listener at once,
+    // beyond that the walk waits for the creating thread to catch up.
+    class FilterStream
+    {
+      public:
+        FilterStream(IFilterStreamListener* listener,
+                     const std::vector<boost::filesystem::path>& selection,
+                     const std::set<std::string>& mimeTypes,
+                     unsigned int flags,
+                     unsigned int limit,
+                     unsigned int chunkSize,
+                     unsigned int maxOutstanding = 4);
+
+        // cancels the walk and waits for it to end, the listener
+        // hears nothing more once destruction begins.
+        ~FilterStream();
+
+        // start walking, false if the walk thread couldn't be started
+        bool start();
+
+        // stop the walk.  the final chunk is still delivered.
+        void cancel();
+
+        // has the final chunk been delivered?
+        bool done() const;
+
+      private:
+        struct State;
+        static void * walkThreadFunc(void * ctx);
+        static void relayFunc(void * ctx);
+        bool post(bp::Map* chunk, bool final);
+
+        // state shared with chunks in flight, which may outlive us
+        std::tr1::shared_ptr<State> m_state;
+        std::vector<boost::filesystem::path> m_selection;
+        std::vector<int> m_parentIDs;
+        std::set<std::string> m_mimeTypes;
+        unsigned int m_flags;
+        unsigned int m_limit;
+        unsigned int m_chunkSize;
+        bp::thread::Thread m_thread;
+        bool m_running;
+
+        FilterStream(const FilterStream&);
+        FilterStream& operator=(const FilterStream&);
+    };
+
 
     // get the build type string from BrowserPlus.config
     std::string getBuildType();
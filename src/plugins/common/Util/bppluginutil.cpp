@@ -119,6 +119,126 @@ bp::pluginutil::toBrowserSafeRep( const bp::Object* input,
     return true;
 }
 
+bp::Object*
+bp::pluginutil::makeBrowserSafe( bp::Object* input )
+{
+    if (input == NULL) return new bp::Null;
+    return BPHandleMapper::insertHandlesInPlace(input);
+}
+
+
+namespace {
+
+    // where walkSelection() puts the items it finds
+    class ISelectionSink
+    {
+      public:
+        virtual ~ISelectionSink() {}
+        // the walk has reached selected item 'index'
+        virtual void beginItem(unsigned int /*index*/) {}
+        // return false to stop the walk
+        virtual bool addFile(bp::Object* item) = 0;
+    };
+
+    class FilterVisitor : virtual public bp::file::IBatchVisitor {
+    public:
+        FilterVisitor(const set<string>& mimetypes,
+                      int parentID,
+                      size_t limit,
+                      ISelectionSink& sink)
+        : m_mimetypes(mimetypes), m_parentID(parentID),
+          m_limit(limit), m_num(0), m_stopped(false), m_sink(sink) {
+        }
+        virtual ~FilterVisitor() {
+        }
+        bp::file::IVisitor::tResult visitNodes(
+            const vector<bp::file::WalkEntry>& entries) {
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (m_stopped || m_num >= m_limit) {
+                    return bp::file::IVisitor::eStop;
+                }
+                // the walk already knows what each node is, no need
+                // to stat it again
+                if (bp::file::isMimeType(entries[i], m_mimetypes)) {
+                    add(entries[i].path);
+                }
+            }
+            return m_stopped ? bp::file::IVisitor::eStop
+                : bp::file::IVisitor::eOk;
+        }
+        void add(const boost::filesystem::path& p) {
+            bp::Object* item = NULL;
+            if (m_parentID) {
+                bp::Map* itemMap = new bp::Map;
+                itemMap->add("handle", new bp::Path(p));
+                itemMap->add("parent", new bp::Integer(m_parentID));
+                item = itemMap;
+            } else {
+                item = new bp::Path(p);
+            }
+            if (!m_sink.addFile(item)) m_stopped = true;
+            m_num++;
+        }
+        const set<string>& m_mimetypes;
+        int m_parentID;
+        size_t m_limit;
+        size_t m_num;
+        bool m_stopped;
+        ISelectionSink& m_sink;
+    };
+}
+
+
+// with kIncludeGestureInfo, handle ids of the selected items, which
+// become the 'parent' of the files found beneath them.  The handle
+// mapper isn't thread safe, call this on the plugin thread.
+static vector<int>
+selectionParents(const vector<boost::filesystem::path>& selection,
+                 unsigned int flags)
+{
+    vector<int> parents;
+    if (flags & bp::pluginutil::kIncludeGestureInfo) {
+        for (unsigned int i = 0; i < selection.size(); ++i) {
+            BPHandle h = BPHandleMapper::pathToHandle(selection[i]);
+            parents.push_back(h.id());
+        }
+    }
+    return parents;
+}
+
+
+// visit selected items (and maybe their kids), handing matches to
+// sink.  matches arrive in depth first order, so a limit keeps the
+// first ones found.  returns the number of selected items visited.
+static unsigned int
+walkSelection(const vector<boost::filesystem::path>& selection,
+              const vector<int>& parentIDs,
+              const set<string>& mimetypes,
+              unsigned int flags,
+              unsigned int limit,
+              ISelectionSink& sink)
+{
+    unsigned int num = 0;
+    unsigned int i = 0;
+    for (i = 0; (num < limit) && (i < selection.size()); ++i) {
+        const boost::filesystem::path& item = selection[i];
+        int parentID = (i < parentIDs.size()) ? parentIDs[i] : 0;
+        sink.beginItem(i);
+        FilterVisitor v(mimetypes, parentID, limit - num, sink);
+        if (flags & bp::pluginutil::kRecurse) {
+            (void) parallelVisitInOrder(item, v, true);
+        } else if (bp::file::isMimeType(item, mimetypes)) {
+            v.add(item);
+        }
+        num += v.m_num;
+        if (v.m_stopped) {
+            ++i;
+            break;
+        }
+    }
+    return i;
+}
+
 
 bp::Object* 
 bp::pluginutil::applyFilters(const vector<boost::filesystem::path>& selection,
@@ -126,43 +246,16 @@ bp::pluginutil::applyFilters(const vector<boost::filesystem::path>& selection,
                              unsigned int flags,
                              unsigned int limit)
 {
-    class MyVisitor : virtual public bp::file::IVisitor {
+    class ListSink : public ISelectionSink {
     public:
-        MyVisitor(const set<string>& mimetypes,
-                  int parentID,
-                  size_t limit,
-                  bp::List* list)
-        : m_mimetypes(mimetypes), m_parentID( parentID),
-          m_limit(limit), m_num(0), m_list(list) {
-        }
-        virtual ~MyVisitor() {
-        }
-        bp::file::IVisitor::tResult visitNode(const boost::filesystem::path& p,
-                                              const boost::filesystem::path&) {
-            if (m_num >= m_limit) {
-                return eStop;
-            }
-            if (bp::file::isMimeType(p, m_mimetypes)) {
-                if (m_parentID) {
-                    bp::Map* itemMap = new bp::Map;
-                    itemMap->add("handle", new bp::Path(p));
-                    itemMap->add("parent", new bp::Integer(m_parentID));
-                    m_list->append(itemMap);
-                } else {
-                    m_list->append(new bp::Path(p));
-                }
-                m_num++;
-            }
-            return eOk;
+        ListSink(bp::List* list) : m_list(list) {}
+        virtual bool addFile(bp::Object* item) {
+            m_list->append(item);
+            return true;
         }
-        set<string> m_mimetypes;
-        int m_parentID;
-        size_t m_limit;
-        size_t m_num;
         bp::List* m_list;
     };
 
-    unsigned int num = 0;
     bp::List* l = NULL;
     bp::Map* m = NULL;
     bp::List* selList = NULL;
@@ -176,32 +269,225 @@ bp::pluginutil::applyFilters(const vector<boost::filesystem::path>& selection,
     } else {
         l = new bp::List;
     }
-    
-    for (unsigned int i = 0; (num < limit) && (i < selection.size()); ++i) {
-        boost::filesystem::path item = selection[i];
-        int parentID = 0;
-        if (flags & kIncludeGestureInfo) {
-            bp::Path* itemPath = new bp::Path(item);
-            BPHandle h = BPHandleMapper::pathToHandle(*itemPath);
-            parentID = h.id();
-            selList->append(itemPath);
-        }
-        
-        // visit selected item (and maybe it's kids)
-        MyVisitor v(mimetypes, parentID, limit - num,
-                    parentID ? fileList : l);
-        if (flags & kRecurse) {
-            (void) recursiveVisit(item, v, true);
-        } else {
-            v.visitNode(item, item);
-        }
-        num += v.m_num;
+
+    vector<int> parentIDs = selectionParents(selection, flags);
+    ListSink sink(fileList ? fileList : l);
+    unsigned int visited = walkSelection(selection, parentIDs, mimetypes,
+                                         flags, limit, sink);
+    for (unsigned int i = 0; selList && i < visited; ++i) {
+        selList->append(new bp::Path(selection[i]));
     }
     
     return (flags & kIncludeGestureInfo) ? dynamic_cast<bp::Object*>(m)
         : dynamic_cast<bp::Object*>(l);
 }
 
+
+struct bp::pluginutil::FilterStream::State
+{
+    State(IFilterStreamListener* l, FilterStream* s, unsigned int maxOut)
+        : hopper(), lock(), cond(), outstanding(0),
+          maxOutstanding(maxOut ? maxOut : 1), cancelled(false),
+          done(false), listener(l), stream(s) {
+        hopper.initializeOnCurrentThread();
+    }
+
+    bp::thread::Hopper hopper;
+
+    // protect outstanding, cond is signaled as chunks are delivered
+    bp::sync::Mutex lock;
+    bp::sync::Condition cond;
+    unsigned int outstanding;
+    unsigned int maxOutstanding;
+    volatile bool cancelled;
+
+    // only touched on the creating thread
+    bool done;
+    IFilterStreamListener* listener;
+    FilterStream* stream;
+
+    // a chunk on its way to the creating thread
+    struct Delivery
+    {
+        shared_ptr<State> state;
+        bp::Map* chunk;
+    };
+};
+
+
+bp::pluginutil::FilterStream::FilterStream(
+    IFilterStreamListener* listener,
+    const vector<boost::filesystem::path>& selection,
+    const set<string>& mimeTypes,
+    unsigned int flags,
+    unsigned int limit,
+    unsigned int chunkSize,
+    unsigned int maxOutstanding)
+    : m_state(new State(listener, this, maxOutstanding)),
+      m_selection(selection),
+      m_parentIDs(selectionParents(selection, flags)),
+      m_mimeTypes(mimeTypes), m_flags(flags), m_limit(limit),
+      m_chunkSize(chunkSize ? chunkSize : 1),
+      m_thread(), m_running(false)
+{
+}
+
+
+bp::pluginutil::FilterStream::~FilterStream()
+{
+    m_state->listener = NULL;
+    cancel();
+    if (m_running) m_thread.join();
+}
+
+
+bool
+bp::pluginutil::FilterStream::start()
+{
+    if (m_running) return false;
+    m_running = m_thread.run(walkThreadFunc, (void *) this);
+    if (!m_running) {
+        BPLOG_ERROR("couldn't start filter stream thread");
+    }
+    return m_running;
+}
+
+
+void
+bp::pluginutil::FilterStream::cancel()
+{
+    bp::sync::Lock lck(m_state->lock);
+    m_state->cancelled = true;
+    m_state->cond.broadcast();
+}
+
+
+bool
+bp::pluginutil::FilterStream::done() const
+{
+    return m_state->done;
+}
+
+
+bool
+bp::pluginutil::FilterStream::post(bp::Map* chunk,
+                                   bool final)
+{
+    State* st = m_state.get();
+    {
+        bp::sync::Lock lck(st->lock);
+        // don't get too far ahead of the listener
+        while (st->outstanding >= st->maxOutstanding && !st->cancelled) {
+            st->cond.wait(&st->lock);
+        }
+        if (st->cancelled && !final) {
+            delete chunk;
+            return false;
+        }
+        st->outstanding++;
+    }
+
+    State::Delivery* d = new State::Delivery;
+    d->state = m_state;
+    d->chunk = chunk;
+    st->hopper.invokeOnThread(relayFunc, (void *) d);
+    return !st->cancelled;
+}
+
+
+void *
+bp::pluginutil::FilterStream::walkThreadFunc(void * ctx)
+{
+    FilterStream* self = (FilterStream*) ctx;
+
+    class ChunkSink : public ISelectionSink {
+    public:
+        ChunkSink(FilterStream* stream)
+            : m_stream(stream), m_chunk(NULL), m_files(NULL),
+              m_visited(0), m_reported(0) {
+        }
+        virtual ~ChunkSink() {
+            delete m_chunk;
+        }
+        virtual void beginItem(unsigned int index) {
+            m_visited = index + 1;
+        }
+        virtual bool addFile(bp::Object* item) {
+            if (!m_chunk) start();
+            m_files->append(item);
+            if (m_files->size() < m_stream->m_chunkSize) {
+                return !m_stream->m_state->cancelled;
+            }
+            return flush(false);
+        }
+        bool flush(bool final) {
+            if (!m_chunk) start();
+            // the selected items reached since the last chunk, so
+            // that together the chunks report what applyFilters()
+            // would have
+            if (m_stream->m_flags & bp::pluginutil::kIncludeGestureInfo) {
+                bp::List* selList = new bp::List;
+                for (; m_reported < m_visited; ++m_reported) {
+                    selList->append(
+                        new bp::Path(m_stream->m_selection[m_reported]));
+                }
+                m_chunk->add("actualSelection", selList);
+            }
+            m_chunk->add("done", new bp::Bool(final));
+            if (final && m_stream->m_state->cancelled) {
+                m_chunk->add("cancelled", new bp::Bool(true));
+            }
+            bp::Map* chunk = m_chunk;
+            m_chunk = NULL;
+            m_files = NULL;
+            return m_stream->post(chunk, final);
+        }
+    private:
+        void start() {
+            m_chunk = new bp::Map;
+            m_files = new bp::List;
+            m_chunk->add("files", m_files);
+        }
+        FilterStream* m_stream;
+        bp::Map* m_chunk;
+        bp::List* m_files;
+        unsigned int m_visited;
+        unsigned int m_reported;
+    };
+
+    ChunkSink sink(self);
+    (void) walkSelection(self->m_selection, self->m_parentIDs,
+                         self->m_mimeTypes, self->m_flags,
+                         self->m_limit, sink);
+    (void) sink.flush(true);
+    return NULL;
+}
+
+
+void
+bp::pluginutil::FilterStream::relayFunc(void * ctx)
+{
+    State::Delivery* d = (State::Delivery*) ctx;
+    // hold the state until we're through, the listener may delete
+    // the stream
+    shared_ptr<State> st = d->state;
+    bp::Map* chunk = d->chunk;
+    delete d;
+
+    {
+        bp::sync::Lock lck(st->lock);
+        st->outstanding--;
+        st->cond.signal();
+    }
+
+    if (chunk->has("done", BPTBoolean) && (bool) *(chunk->get("done"))) {
+        st->done = true;
+    }
+    if (st->listener) st->listener->onFilterChunk(st->stream, *chunk);
+    delete chunk;
+}
+
+
 std::string
 bp::pluginutil::getBuildType()
 {
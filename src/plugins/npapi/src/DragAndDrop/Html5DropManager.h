@@ -49,7 +49,8 @@ public:
     virtual bool addTarget(const std::string& name,
                            const std::set<std::string>& mimeTypes,
                            bool includeGestureInfo,
-                           unsigned int limit);
+                           unsigned int limit,
+                           bool streamed);
     virtual bool addTarget(const std::string& name,
                            const std::string& version);
     virtual bool removeTarget(const std::string& name);
@@ -93,6 +94,7 @@ protected:
                           const std::set<std::string>& mimeTypes,
                           bool includeGestureInfo,
                           unsigned int limit,
+                          bool streamed,
                           Html5DropManager * theMan);
 
         DropTargetContext(NPP m_npp,
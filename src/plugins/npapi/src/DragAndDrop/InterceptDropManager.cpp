@@ -119,8 +119,9 @@ InterceptDropManager::DropTargetContext::DropTargetContext()
 InterceptDropManager::DropTargetContext::DropTargetContext(const string& name,
                                                            const set<string>& mimetypes,
                                                            bool includeGestureInfo,
-                                                           unsigned int limit)
-    : DropTargetBase(name, mimetypes, includeGestureInfo, limit), 
+                                                           unsigned int limit,
+                                                           bool streamed)
+    : DropTargetBase(name, mimetypes, includeGestureInfo, limit, streamed), 
       m_top(0), m_bottom(0), m_left(0), m_right(0)
 {
 }
@@ -177,10 +178,12 @@ bool
 InterceptDropManager::addTarget(const string& name,
                                 const set<string>& mimeTypes,
                                 bool includeGestureInfo,
-                                unsigned int limit)
+                                unsigned int limit,
+                                bool streamed)
 {
     if (m_targets.find(name) != m_targets.end()) return false;
-    DropTargetContext dtc(name, mimeTypes, includeGestureInfo, limit);
+    DropTargetContext dtc(name, mimeTypes, includeGestureInfo, limit,
+                          streamed);
     m_targets[name] = dtc;
     return true;
 }
@@ -55,7 +55,8 @@ public:
     virtual bool addTarget(const std::string& name,
                            const std::set<std::string>& mimeTypes,
                            bool includeGestureInfo,
-                           unsigned int limit);
+                           unsigned int limit,
+                           bool streamed);
     virtual bool addTarget(const std::string& name,
                            const std::string& version);
     virtual bool removeTarget(const std::string& name);
@@ -112,7 +113,8 @@ protected:
         DropTargetContext(const std::string& name,
                           const std::set<std::string>& mimeTypes,
                           bool includeGestureInfo,
-                          unsigned int limit);
+                          unsigned int limit,
+                          bool streamed);
         DropTargetContext(const std::string& name,
                           const std::string& version);
         DropTargetContext(const DropTargetContext& dtc);
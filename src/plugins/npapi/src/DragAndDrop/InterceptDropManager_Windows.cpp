@@ -75,7 +75,8 @@ private:
     virtual bool addTarget(const std::string& name,
                            const std::set<std::string>& mimeTypes,
                            bool includeGestureInfo,
-                           unsigned int limit);
+                           unsigned int limit,
+                           bool streamed);
     virtual bool addTarget(const std::string& name,
                            const std::string& version);
     virtual bool removeTarget(const std::string& name);
@@ -302,12 +303,14 @@ bool
 WindowsDropManager::addTarget(const std::string& name,
                               const std::set<std::string>& mimeTypes,
                               bool includeGestureInfo,
-                              unsigned int limit)
+                              unsigned int limit,
+                              bool streamed)
 {
     BPLOG_INFO_STRM("addTarget(" << name << "), " 
                     << m_targets.size() << " existing targets");
     bool rval = InterceptDropManager::addTarget(name, mimeTypes,
-                                                includeGestureInfo, limit);
+                                                includeGestureInfo, limit,
+                                                streamed);
     if (rval) {
         rval = createOverlay(name);
     } else {
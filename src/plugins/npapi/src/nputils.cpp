@@ -389,11 +389,9 @@ npu::isFunction(NPP npp, const NPVariant * var)
 }
 
 bool
-npu::objectToJSON(const bp::Object * input, bp::Object * &output)
+npu::objectToJSON(const bp::Object * input, std::string & output)
 {
-    // so first we gotta build up json
-    if (input) output = BPHandleMapper::insertHandles(input);
-    else output = new bp::Null;
+    output = BPHandleMapper::insertHandlesToJson(input);
     return true;
 }
 
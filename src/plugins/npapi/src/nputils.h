@@ -97,8 +97,9 @@ bool isFunction(NPP npp, const NPVariant * var);
 bool variantToObject(NPP npp, const NPVariant * input,
                      BPTransaction * transaction, bp::Object * &output);
 
-// traverse a return value from BPCore.  perform handle obfuscation
-bool objectToJSON(const bp::Object * input, bp::Object * &output);
+// serialize a return value from BPCore to JSON, performing handle
+// obfuscation.  input is only read, never copied.
+bool objectToJSON(const bp::Object * input, std::string & output);
 
 // evaluate some javascript containing a function declaraion, return
 // a NPObject which may be later  called using npu::callFunction
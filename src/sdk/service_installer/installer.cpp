@@ -31,6 +31,7 @@
 #include "platform_utils/ARGVConverter.h"
 #include "platform_utils/ProductPaths.h"
 #include "platform_utils/ServicesUpdatedFile.h"
+#include "platform_utils/bpobjectstore.h"
 #include "ServiceRunnerLib/ServiceRunnerLib.h"
 #include "platform_utils/bpdebug.h"
 
@@ -75,6 +76,12 @@ static APTArgDefinition g_args[] = {
     { "f", APT::NO_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
       APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
       "[f]orce overwriting of existing service."
+    },
+    { "d", APT::NO_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+      APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+      "[d]eduplicate: keep file contents in the shared service object "
+      "store and hard link them into the installed service.  The "
+      "installed files become read-only."
     }
 };
 
@@ -363,6 +370,13 @@ doUninstall(shared_ptr<APTArgParse> argParser,
         if (argParser->argumentPresent("t")) {
             BPOUT(timeStamp() << "remove " << absPath << " returns " << rv);
         }
+
+        // drop any stored contents which were only used by this service
+        bp::ObjectStore store(bp::paths::getServiceObjectStoreDirectory());
+        unsigned int n = store.collectGarbage();
+        if (argParser->argumentPresent("t")) {
+            BPOUT(timeStamp() << "removed " << n << " unused objects");
+        }
     } else {
         BPOUT("would remove " << absPath);
     }
@@ -402,6 +416,7 @@ doInstall(shared_ptr<APTArgParse> argParser,
             if (!dryRun) {
                 int rv = doUninstall(argParser, destination, summary, apiVersion);
                 BPOUT("uninstall of existing service returns " << rv);
+                overwrote = true;
             } else {
                 BPOUT("would uninstall existing " << destination);
             }
@@ -470,6 +485,33 @@ doInstall(shared_ptr<APTArgParse> argParser,
         }
     }
 
+    // share file contents with other installed services
+    if (argParser->argumentPresent("d")) {
+        if (!dryRun) {
+            bp::ObjectStore store(bp::paths::getServiceObjectStoreDirectory());
+            string err;
+            if (!store.adopt(destination, err)) {
+                // the service is intact, it just isn't sharing
+                BPOUT("unable to deduplicate " << destination << ": " << err);
+            } else if (argParser->argumentPresent("t")) {
+                BPOUT(timeStamp() << "deduplicated, " << store.shared()
+                      << " files shared, " << store.added() << " added");
+            }
+        } else {
+            BPOUT("would deduplicate " << destination);
+        }
+    }
+
+    // blobs only the overwritten install used are garbage now that
+    // the new one has taken what it shares
+    if (overwrote) {
+        bp::ObjectStore store(bp::paths::getServiceObjectStoreDirectory());
+        unsigned int n = store.collectGarbage();
+        if (argParser->argumentPresent("t")) {
+            BPOUT(timeStamp() << "removed " << n << " unused objects");
+        }
+    }
+
     // let's update the moddate on the manifest.json to cause
     // BrowserPlus to update this service.  This is only necessary
     // if we overwrote the on-disk service
@@ -86,6 +86,12 @@ static APTArgDefinition g_args[] = {
       "specify the platform for which this service is written.  Choices are "
       " \"ind\" for platform independent services, \"win32\" for 32-bit "
       " windows services, or \"osx\" for intel architecture 32-bit services "
+    },
+    { "deltaFrom", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+      APT::NOT_INTEGER, APT::MAY_RECUR,
+      "path to a previously published version of the service.  A delta "
+      "package which updates that version to this one is published "
+      "alongside the full package"
     }
 };
 
@@ -528,6 +534,40 @@ int main(int argc, const char ** argv)
             cerr << "error packaging service contents to " << pkgPath << endl;
             exit(1);
         }
+
+        // optionally package deltas from prior versions to
+        // <output directory>/delta_<base version>.bpkg
+        if (argParser->argumentPresent("deltaFrom")) {
+            vector<string> bases = argParser->argumentValues("deltaFrom");
+            for (unsigned int i = 0; i < bases.size(); i++) {
+                boost::filesystem::path basePath =
+                    bp::file::absolutePath(boost::filesystem::path(bases[i]));
+                bp::service::Summary baseSummary;
+                if (!baseSummary.detectService(basePath, error)) {
+                    cerr << "invalid delta base: " << error << endl;
+                    exit(1);
+                }
+                if (baseSummary.name() != serviceName) {
+                    cerr << "delta base " << basePath << " is not a "
+                         << "version of " << serviceName << endl;
+                    exit(1);
+                }
+                boost::filesystem::path deltaPath = targetPath /
+                    ("delta_" + baseSummary.version() + ".bpkg");
+                if (!bp::pkg::packDelta(privateKey, publicKey, password,
+                                        basePath, baseSummary.version(),
+                                        servicePath, deltaPath)) {
+                    cerr << "error packaging delta from "
+                         << baseSummary.version() << " to "
+                         << deltaPath << endl;
+                    exit(1);
+                }
+                if (argParser->argumentPresent("t")) {
+                    cout << timeStamp(sw) << "packaged delta from "
+                         << baseSummary.version() << ".\n";
+                }
+            }
+        }
     
         // now package results
         boost::filesystem::path finalPkgPath = bp::file::getTempPath(targetPath, TMPDIR_PREFIX); 
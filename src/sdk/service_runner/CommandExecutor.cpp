@@ -224,11 +224,24 @@ BP_DEFINE_COMMAND_HANDLER(CommandExecutor::invoke)
     
     unsigned int instance = m_controlMan->currentInstance();    
 
-    (void) m_controller->invoke(instance, tokens[0], argMap);
+    unsigned int tid = m_controller->invoke(instance, tokens[0], argMap);
+    m_invoking[tid] = commandId();
 
     if (argMap) delete argMap;
 }
 
+unsigned int
+CommandExecutor::invokeCompleted(unsigned int tid)
+{
+    unsigned int commandId = 0;
+    std::map<unsigned int, unsigned int>::iterator it = m_invoking.find(tid);
+    if (it != m_invoking.end()) {
+        commandId = it->second;
+        m_invoking.erase(it);
+    }
+    return commandId;
+}
+
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::show)
 {
     std::set<unsigned int> s = m_controlMan->instances();
@@ -23,6 +23,7 @@
 #ifndef __COMMANDEXECUTOR_H__
 #define __COMMANDEXECUTOR_H__
 
+#include <map>
 #include "ServiceRunnerLib/ServiceRunnerLib.h"
 #include "ConsoleLib/ConsoleLib.h"
 
@@ -56,6 +57,10 @@ class CommandExecutor : public CommandHandler
     bp::service::Description m_desc;
     // A class that wraps the controller and outputs to console.
     std::tr1::shared_ptr<ControllerManager> m_controlMan;
+    // command ids of outstanding invocations by transaction id, for
+    // batch mode where several may be outstanding
+    std::map<unsigned int, unsigned int> m_invoking;
+    unsigned int invokeCompleted(unsigned int tid);
     friend class ControllerManager;
 };
 
@@ -59,26 +59,26 @@ ControllerManager::onAllocated(ServiceRunner::Controller *,
 void
 ControllerManager::onInvokeResults(ServiceRunner::Controller *,
                                    unsigned int,
-                                   unsigned int,
+                                   unsigned int tid,
                                    const bp::Object * results)
 {
     if (results) {
         output::puts(output::T_RESULTS, results);
     }
-    m_callback->onSuccess();        
+    m_callback->onSuccess(m_callback->invokeCompleted(tid));
 }
 
 void
 ControllerManager::onInvokeError(ServiceRunner::Controller *,
                                  unsigned int,
-                                 unsigned int,
+                                 unsigned int tid,
                                  const std::string & error,
                                  const std::string & verboseError)
 {
     std::stringstream ss;
     ss << "error: (" << error << ") " << verboseError;
     output::puts(output::T_ERROR, ss.str());
-    m_callback->onFailure();
+    m_callback->onFailure(m_callback->invokeCompleted(tid));
 }
 
 void
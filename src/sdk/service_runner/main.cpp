@@ -90,7 +90,7 @@ private:
             std::cout << ".";
         }
     }
-    virtual void onDownloadComplete(unsigned int tid, const std::vector<unsigned char> & buf) {
+    virtual void onDownloadComplete(unsigned int tid, const DownloadedPackage & pkg) {
         if (output::getSlaveMode()) {
             // NO-OP
         }
@@ -98,7 +98,8 @@ private:
             std::cout << std::endl;
         }
         pair<string, string> p = m_neededServices.front();
-        ServiceUnpacker unpacker(buf, m_certFile);
+        ServiceUnpacker unpacker(pkg.m_path, m_certFile);
+        unpacker.setExpected(pkg.m_size, pkg.m_sha256);
         string errMsg;
         std::stringstream ss;
         ss << "Installing service: " << p.first << " v" << p.second;
@@ -215,6 +216,16 @@ static APTArgDefinition g_args[] = {
       "the breakpoint occurs before your service is loaded so that "
       "all of the service code may be debugged and verified."
     },
+    { "batch", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+      APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+      "Run commands from a file ('-' for stdin) rather than interactively, "
+      "printing the latency of each command.  Useful for load testing a "
+      "service."
+    },
+    { "outstanding", APT::TAKES_ARG, "1", APT::NOT_REQUIRED,
+      APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+      "With -batch, the number of commands that may be outstanding at once."
+    },
 };
       
 static void 
@@ -253,9 +264,15 @@ class RunManager :  public ICommandHandlerListener,
 public:
     RunManager(CommandParserPtr parser,
                shared_ptr<CommandExecutor> executor)
-        : m_parser(parser), m_executor(executor)
+        : m_parser(parser), m_executor(executor), m_maxOutstanding(1)
     {
     }
+    // run commands from a file rather than interactively
+    void setBatch(const std::string & path, unsigned int maxOutstanding)
+    {
+        m_batchPath = path;
+        m_maxOutstanding = maxOutstanding;
+    }
 private:   
     void onUserQuit() {
         output::puts(output::T_INFO, "shutting down...");
@@ -279,13 +296,21 @@ private:
     }
     CommandParserPtr m_parser;
     shared_ptr<CommandExecutor> m_executor;
+    std::string m_batchPath;
+    unsigned int m_maxOutstanding;
 
     void onDescribe(ServiceRunner::Controller *,
                     const bp::service::Description & desc) {
         // take over listening responsibilities of the controller
         m_executor->start(desc);
         // start parsing from the command line
-        m_parser->start();
+        if (m_batchPath.empty()) {
+            m_parser->start();
+        } else if (!m_parser->startBatch(m_batchPath, m_maxOutstanding)) {
+            // the parser reports the file it couldn't open, main()
+            // sees the failure through batchSucceeded()
+            s_rl.stop();
+        }
     }
 
     // unused overrides (because we pass off the controller to
@@ -419,6 +444,8 @@ main(int argc, const char ** argv)
     }
 
     setupLogging(argParser);
+
+    int rv = 0;
     
     // scope here so that all objects are cleaned up by end of main
     {
@@ -557,6 +584,10 @@ main(int argc, const char ** argv)
         // quit events from the command parser and starts the parser,
         // and stops the application
         RunManager ql(parser, chp);
+        if (argParser.argumentPresent("batch")) {
+            ql.setBatch(argParser.argument("batch"),
+                        argParser.argumentAsInteger("outstanding"));
+        }
         controller->setListener(&ql);
 
         // set up the quit listener to listen to the command parser
@@ -629,9 +660,13 @@ main(int argc, const char ** argv)
 
         s_rl.run();
         parser->stop();    
+
+        if (argParser.argumentPresent("batch") && !parser->batchSucceeded()) {
+            rv = 1;
+        }
     }
 
     s_rl.shutdown();
 
-    return 0;
+    return rv;
 }
@@ -48,14 +48,33 @@ CommandExecutor::~CommandExecutor()
     BPFree(m_hand);
 }
 
+void *
+CommandExecutor::newRequest()
+{
+    Request * r = new Request;
+    r->m_executor = this;
+    r->m_commandId = commandId();
+    return (void *) r;
+}
+
+void
+CommandExecutor::completeRequest(void * cookie, bool success)
+{
+    Request * r = (Request *) cookie;
+    CommandExecutor * ce = r->m_executor;
+    unsigned int id = r->m_commandId;
+    delete r;
+    if (success) ce->onSuccess(id);
+    else ce->onFailure(id);
+}
+
 void
 CommandExecutor::connectCB(BPErrorCode ec, void * cookie,
                            const char * error, const char * verboseError)
 {
-    CommandExecutor * ce = (CommandExecutor *) cookie;
     std::cout << "connect returns async: ";
     printProtoError(ec);
-    ce->onSuccess();
+    completeRequest(cookie, true);
 }
 
 void
@@ -75,12 +94,14 @@ BP_DEFINE_COMMAND_HANDLER(CommandExecutor::connect)
     uri.append("/");
     uri.append(BPCLIENT_APPNAME);
     
+    void * cookie = newRequest();
     BPErrorCode ec = BPConnect(m_hand, uri.c_str(), "en",
                                "BrowserPlus command line client",
                                connectCB,
-                               (void *) this);
+                               cookie);
     std::cout << "connect returns sync: ";
     printProtoError(ec);
+    if (ec != BP_EC_OK) completeRequest(cookie, false);
 }
 
 static void
@@ -111,7 +132,14 @@ CommandExecutor::resultsCB(void * ptr, unsigned int tid,
 
     if (ptr) {
         CommandExecutor * ce = (CommandExecutor *) ptr;
-        ce->onSuccess();
+        unsigned int commandId = 0;
+        std::map<unsigned int, unsigned int>::iterator it =
+            ce->m_executing.find(tid);
+        if (it != ce->m_executing.end()) {
+            commandId = it->second;
+            ce->m_executing.erase(it);
+        }
+        ce->onSuccess(commandId);
     }
 }
 
@@ -155,6 +183,7 @@ BP_DEFINE_COMMAND_HANDLER(CommandExecutor::execute)
               << BPErrorCodeToString(ec) << " (" << ec << ")" << std::endl;
 
     if (ec != BP_EC_OK) onFailure();
+    else m_executing[tid] = commandId();
 }
 
 void
@@ -164,8 +193,6 @@ CommandExecutor::descriptionCB(BPErrorCode ec,
                                const char * error,
                                const char * verboseError)
 {
-    CommandExecutor * cmdexec = (CommandExecutor *) cookie;
-
     // let's output the definition
     if (ec != BP_EC_OK)
     {
@@ -183,19 +210,20 @@ CommandExecutor::descriptionCB(BPErrorCode ec,
         std::cout << d.toHumanReadableString();
     }
 
-    cmdexec->onSuccess();
+    completeRequest(cookie, true);
 }
 
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::describe)
 {
+    void * cookie = newRequest();
     BPErrorCode ec = BPDescribe(m_hand,
                                 tokens[0].c_str(),
                                 tokens[1].c_str(),
                                 NULL,
                                 descriptionCB,
-                                (void *) this);
+                                cookie);
 
-    if (ec != BP_EC_OK) onFailure();
+    if (ec != BP_EC_OK) completeRequest(cookie, false);
 }
 
 void
@@ -206,8 +234,6 @@ CommandExecutor::requireCB(BPErrorCode ec,
                            const char * error,
                            const char * verboseError)
 {
-    CommandExecutor * cmdexec = (CommandExecutor *) cookie;
-
     // let's output the definition
     if (ec != BP_EC_OK)
     {
@@ -236,7 +262,7 @@ CommandExecutor::requireCB(BPErrorCode ec,
         }
     }
 
-    cmdexec->onSuccess();
+    completeRequest(cookie, true);
 }
 
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::require)
@@ -254,16 +280,17 @@ BP_DEFINE_COMMAND_HANDLER(CommandExecutor::require)
     bp::Map m;
     m.add("services", obj);
     
+    void * cookie = newRequest();
     BPErrorCode ec = BPRequire(
         m_hand,
         m.elemPtr(), 
         requireCB,
-        (void *) this,
+        cookie,
         NULL, NULL, NULL);
 
     if (ec != BP_EC_OK) {
         printProtoError(ec);
-        onFailure();
+        completeRequest(cookie, false);
     }
 }
 
@@ -286,8 +313,6 @@ CommandExecutor::installedCB(BPErrorCode ec,
                              void * cookie,
                              const BPElement * services)
 {
-    CommandExecutor * cmdexec = (CommandExecutor *) cookie;
-
     // print out the list of services.
     if (ec != BP_EC_OK) {
         printProtoError(ec);
@@ -312,21 +337,20 @@ CommandExecutor::installedCB(BPErrorCode ec,
                   << std::endl;
     }
 
-    cmdexec->onSuccess();
+    completeRequest(cookie, true);
 }
 
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::enumerate)
 {
-    BPErrorCode ec = BPEnumerate(m_hand, installedCB, (void *) this);
-    if (ec != BP_EC_OK) onFailure();        
+    void * cookie = newRequest();
+    BPErrorCode ec = BPEnumerate(m_hand, installedCB, cookie);
+    if (ec != BP_EC_OK) completeRequest(cookie, false);
 }
 
 void
 CommandExecutor::stateCB(BPErrorCode ec, void * cookie,
                             const BPElement * response)
 {
-    CommandExecutor * cmdexec = (CommandExecutor *) cookie;
-
     // print out the list of services.
     if (ec != BP_EC_OK) {
         printProtoError(ec);
@@ -339,14 +363,15 @@ CommandExecutor::stateCB(BPErrorCode ec, void * cookie,
                   << std::endl;
     }
 
-    cmdexec->onSuccess();
+    completeRequest(cookie, true);
 }
 
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::getState)
 {
+    void * cookie = newRequest();
     BPErrorCode ec = BPGetState(m_hand, tokens[0].c_str(),
-                                stateCB, (void *) this);
-    if (ec != BP_EC_OK) onFailure();        
+                                stateCB, cookie);
+    if (ec != BP_EC_OK) completeRequest(cookie, false);
 }
 
 BP_DEFINE_COMMAND_HANDLER(CommandExecutor::setState)
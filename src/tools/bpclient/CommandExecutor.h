@@ -23,6 +23,7 @@
 #ifndef __COMMANDEXECUTOR_H__
 #define __COMMANDEXECUTOR_H__
 
+#include <map>
 #include "ConsoleLib/ConsoleLib.h"
 #include "BPProtocol/BPProtocol.h"
 
@@ -49,6 +50,25 @@ public:
 private:    
     BPProtoHand m_hand;
 
+    // command ids of outstanding executions by transaction id, since
+    // results for different services may arrive out of order
+    std::map<unsigned int, unsigned int> m_executing;
+
+    // the cookie passed with other asynchronous requests, naming the
+    // command which issued them, since in batch mode their responses
+    // may also arrive out of order
+    struct Request
+    {
+        CommandExecutor * m_executor;
+        unsigned int m_commandId;
+    };
+
+    // a cookie for a request issued by the command being handled
+    void * newRequest();
+
+    // complete the command which issued a request and free its cookie
+    static void completeRequest(void * cookie, bool success);
+
     static void stateCB(BPErrorCode ec, void * cookie,
                            const BPElement * value);
 
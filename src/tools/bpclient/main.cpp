@@ -72,6 +72,15 @@ processCommandLine(APTArgParse& argParser, int argc, const char ** argv)
         { "l", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
         APT::NOT_INTEGER, APT::MAY_RECUR,
         "enable console logging, argument is level (info, debug, etc.)" 
+        },
+        { "b", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "run commands from a file ('-' for stdin) rather than "
+        "interactively, printing per-command latency."
+        },
+        { "n", APT::TAKES_ARG, "1", APT::NOT_REQUIRED,
+        APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+        "with -b, the number of commands that may be outstanding at once."
         }
     };
     
@@ -101,6 +110,8 @@ main(int argc, const char ** argv)
 
     setupLogging(argParser);
 
+    int rv = 0;
+
     // scope here so that all objects are cleaned up by end of main
     {
         // init protocol library
@@ -177,8 +188,17 @@ main(int argc, const char ** argv)
             "get some state, try 'setstate help' to see available state "
             "strings\n");
 
-        parser->start();
-        s_rl.run();
+        if (argParser.argumentPresent("b")) {
+            if (parser->startBatch(argParser.argument("b"),
+                                   argParser.argumentAsInteger("n")))
+            {
+                s_rl.run();
+            }
+            if (!parser->batchSucceeded()) rv = 1;
+        } else {
+            parser->start();
+            s_rl.run();
+        }
         parser->stop();    
     }
 
@@ -187,5 +207,5 @@ main(int argc, const char ** argv)
 
     s_rl.shutdown();
 
-    return 0;
+    return rv;
 }
@@ -0,0 +1,131 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpdescbench - measure looking up functions in, and copying, the
+ *               description of a service with many functions.
+ *
+ * usage: bpdescbench [functions] [iterations]
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BPUtils/bpstopwatch.h"
+#include "platform_utils/ServiceDescription.h"
+
+using bp::service::Argument;
+using bp::service::Description;
+using bp::service::Function;
+
+
+// a service with n functions named f0..fn-1, each taking a required
+// string "s" and an optional integer "i"
+static Description
+makeDescription(unsigned int n)
+{
+    std::list<Argument> args;
+    Argument s("s", Argument::String);
+    s.setRequired(true);
+    args.push_back(s);
+    args.push_back(Argument("i", Argument::Integer));
+
+    std::list<Function> funcs;
+    for (unsigned int i = 0; i < n; i++) {
+        std::stringstream ss;
+        ss << "f" << i;
+        Function f;
+        f.setName(ss.str().c_str());
+        f.setDocString("does something");
+        f.setArguments(args);
+        funcs.push_back(f);
+    }
+
+    Description d;
+    d.setName("Wide");
+    d.setMajorVersion(1);
+    d.setMinorVersion(2);
+    d.setMicroVersion(3);
+    d.setDocString("a service with many functions");
+    d.setFunctions(funcs);
+    return d;
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc > 3) {
+        std::cout << "usage: " << argv[0] << " [functions] [iterations]"
+                  << std::endl;
+        return 1;
+    }
+    unsigned int functions = 500;
+    unsigned int iterations = 100;
+    if (argc > 1) functions = (unsigned int) atoi(argv[1]);
+    if (argc > 2) iterations = (unsigned int) atoi(argv[2]);
+    if (functions == 0) functions = 1;
+    if (iterations == 0) iterations = 1;
+
+    Description d = makeDescription(functions);
+    std::vector<std::string> names;
+    for (unsigned int i = 0; i < functions; i++) {
+        std::stringstream ss;
+        ss << "f" << i;
+        names.push_back(ss.str());
+    }
+
+    bp::time::Stopwatch sw;
+    sw.start();
+    unsigned int found = 0;
+    for (unsigned int n = 0; n < iterations; n++) {
+        for (unsigned int i = 0; i < functions; i++) {
+            if (d.function(names[i].c_str())) found++;
+        }
+    }
+    double lookupSecs = sw.elapsedSec();
+    if (found != functions * iterations) {
+        std::cerr << "lookups failed" << std::endl;
+        return 1;
+    }
+
+    // copies are cheap, so do many more of them
+    unsigned int copies = iterations * 10000;
+    sw.reset();
+    sw.start();
+    unsigned int total = 0;
+    for (unsigned int n = 0; n < copies; n++) {
+        Description copy(d);
+        total += copy.majorVersion();
+    }
+    double copySecs = sw.elapsedSec();
+
+    std::cout << functions << " functions: "
+              << (lookupSecs * 1000000.0 / (functions * iterations))
+              << "us per lookup, "
+              << (copySecs * 1000000000.0 / copies)
+              << "ns per copy" << std::endl;
+    return total == copies ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * BPDistMirror - A caching mirror of the distribution server.  Point
+ *                hosts at it as their primary distribution server and
+ *                it fetches from the real servers on their behalf, once.
+ */
+#include <iostream>
+#include <list>
+#include <vector>
+#include "BPUtils/BPLog.h"
+#include "BPUtils/bpfile.h"
+#include "bphttp/HttpServer.h"
+#include "DistributionClient/DistMirror.h"
+#include "platform_utils/APTArgParse.h"
+
+#ifdef WIN32
+#include <Windows.h>
+#define sleep Sleep
+#endif
+
+static void 
+setupLogging(const APTArgParse& argParser)
+{
+    bp::log::removeAllAppenders();
+    if (argParser.argumentPresent("l")) {
+        bp::log::Level level = bp::log::levelFromString(argParser.argument("l"));
+        bp::log::setLogLevel(level);
+        bp::log::setupLogToConsole(level);
+    }
+}
+
+
+// Parses the command-line using an APTArgParse object.
+// Returns true on success
+static bool
+processCommandLine(APTArgParse& argParser, int argc, const char ** argv)
+{
+    APTArgDefinition args[] =
+    {
+        { "l", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "enable console logging, argument is level (info, debug, etc.)"
+        },
+        { "u", APT::TAKES_ARG, APT::NO_DEFAULT, APT::REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_RECUR,
+        "an upstream distribution server url, may be repeated.  "
+        "upstreams are tried in the order given."
+        },
+        { "c", APT::TAKES_ARG, APT::NO_DEFAULT, APT::REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "the directory in which to cache fetched content."
+        },
+        { "p", APT::TAKES_ARG, "0", APT::REQUIRED,
+        APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+        "the port to listen on, zero for an ephemeral port."
+        },
+        { "t", APT::TAKES_ARG, "300", APT::REQUIRED,
+        APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+        "seconds that service, permission and platform listings are "
+        "served before they're refetched."
+        }
+    };
+    
+    // parse command line arguments
+    bool rval = true;
+    int x = argParser.parse(sizeof(args)/sizeof(args[0]), args, argc, argv);
+    if (x < 0 || x != argc)
+    {
+        std::cerr << argParser.error() << std::endl;
+        rval = false;
+    }
+    
+    return rval;
+}
+
+
+int
+main(int argc, const char ** argv)
+{
+    APTArgParse argParser("BrowserPlus distribution mirror");
+    if (!processCommandLine(argParser, argc, argv))
+    {
+        // Exit on invalid cmd line.
+        return 1;
+    }
+
+    setupLogging(argParser);
+
+    std::vector<std::string> uv = argParser.argumentValues("u");
+    std::list<std::string> upstreams(uv.begin(), uv.end());
+    DistMirror mirror(upstreams,
+                      bp::file::absolutePath(argParser.argument("c")));
+    mirror.setListTTL(argParser.argumentAsInteger("t"));
+
+    bp::http::server::Server s;
+    unsigned short int port =
+        (unsigned short int) argParser.argumentAsInteger("p");
+    if (!s.bind(port)) {
+        std::cerr << "error binding port " << port << std::endl;
+        exit(1);
+    }
+    std::cout << "mirroring on localhost:" << port << std::endl;
+    
+    s.mount("*", &mirror);
+    s.start();
+    
+    sleep((unsigned int) -1);
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpdropbench - time to first item and peak memory for a large folder
+ *               drop, delivered whole by applyFilters() or in chunks
+ *               by a FilterStream.  Run each mode in its own process,
+ *               peak memory and the handle mapper are per process.
+ *
+ * usage: bpdropbench <scratch dir> <whole|stream>
+ *                    [depth fanout files chunkSize]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+#include "PluginCommonLib/BPHandleMapper.h"
+#include "PluginCommonLib/bppluginutil.h"
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+namespace bpu = bp::pluginutil;
+
+
+static const char * s_extensions[] = { ".jpg", ".txt", ".png", ".html" };
+
+
+// depth levels of fanout directories, each holding files files
+static size_t
+buildTree(const bfs::path & dir, unsigned int depth,
+          unsigned int fanout, unsigned int files)
+{
+    size_t nodes = 0;
+    bfs::create_directories(dir);
+    for (unsigned int i = 0; i < files; i++) {
+        char buf[32];
+        sprintf(buf, "file%u%s", i, s_extensions[i % 4]);
+        if (!bp::strutil::storeToFile(dir / buf, "")) {
+            std::cerr << "couldn't write " << dir / buf << std::endl;
+            exit(1);
+        }
+        nodes++;
+    }
+    if (depth > 0) {
+        for (unsigned int i = 0; i < fanout; i++) {
+            char buf[32];
+            sprintf(buf, "dir%u", i);
+            nodes += buildTree(dir / buf, depth - 1, fanout, files);
+        }
+    }
+    return nodes;
+}
+
+
+// high water mark of resident memory in KB, 0 where unknown
+static size_t
+peakKB()
+{
+#ifdef WIN32
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef MACOSX
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+
+static size_t
+filesIn(const bp::Object * o)
+{
+    if (o->type() == BPTMap) o = o->get("files");
+    return o && o->type() == BPTList ? ((const bp::List *) o)->size() : 0;
+}
+
+
+// collects a stream's chunks on the main runloop, handling each as
+// the plugin would on its way to the page
+class StreamBench : public bpu::IFilterStreamListener
+{
+  public:
+    StreamBench(bp::runloop::RunLoop & rl, bp::time::Stopwatch & sw)
+        : m_rl(rl), m_sw(sw), m_firstItem(0.0), m_items(0), m_chunks(0) {}
+
+    virtual void onFilterChunk(bpu::FilterStream * stream,
+                               const bp::Map & chunk) {
+        size_t n = filesIn(&chunk);
+        if (n > 0 && m_items == 0) m_firstItem = m_sw.elapsedSec();
+        m_items += n;
+        m_chunks++;
+        bp::Object * safe = BPHandleMapper::insertHandles(&chunk);
+        delete safe;
+        if (stream->done()) m_rl.stop();
+    }
+
+    bp::runloop::RunLoop & m_rl;
+    bp::time::Stopwatch & m_sw;
+    double m_firstItem;
+    size_t m_items;
+    size_t m_chunks;
+};
+
+
+int
+main(int argc, char ** argv)
+{
+    std::string mode(argc > 2 ? argv[2] : "");
+    if ((argc != 3 && argc != 7) || (mode != "whole" && mode != "stream")) {
+        std::cout << "usage: " << argv[0]
+                  << " <scratch dir> <whole|stream>"
+                  << " [depth fanout files chunkSize]" << std::endl;
+        return 1;
+    }
+    // 1111 directories of 90 files, just short of 100k files
+    unsigned int depth = 3, fanout = 10, files = 90, chunkSize = 500;
+    if (argc == 7) {
+        depth = atoi(argv[3]);
+        fanout = atoi(argv[4]);
+        files = atoi(argv[5]);
+        chunkSize = atoi(argv[6]);
+    }
+
+    bfs::path dir = bpf::getTempPath(bfs::path(argv[1]), "bpdropbench");
+    size_t nodes = 0;
+    try {
+        nodes = buildTree(dir, depth, fanout, files);
+    } catch (const bfs::filesystem_error & e) {
+        std::cerr << "couldn't create " << dir << ": " << e.what()
+                  << std::endl;
+        return 1;
+    }
+    std::cout << "dropping " << nodes << " files" << std::endl;
+
+    std::vector<bfs::path> selection;
+    selection.push_back(dir);
+    std::set<std::string> types;
+    unsigned int limit = (unsigned int) nodes + 1;
+    size_t baseKB = peakKB();
+    bp::time::Stopwatch sw;
+    double firstItem = 0.0;
+    size_t items = 0;
+
+    if (mode == "stream") {
+        bp::runloop::RunLoop rl;
+        rl.init();
+        StreamBench sb(rl, sw);
+        {
+            bpu::FilterStream stream(&sb, selection, types, bpu::kRecurse,
+                                     limit, chunkSize);
+            sw.start();
+            if (!stream.start()) {
+                std::cerr << "couldn't start stream" << std::endl;
+                return 1;
+            }
+            rl.run();
+            sw.stop();
+        }
+        rl.shutdown();
+        firstItem = sb.m_firstItem;
+        items = sb.m_items;
+        std::cout << "streamed in " << sb.m_chunks << " chunks of up to "
+                  << chunkSize << std::endl;
+    } else {
+        sw.start();
+        bp::Object * all = bpu::applyFilters(selection, types,
+                                             bpu::kRecurse, limit);
+        bp::Object * safe = BPHandleMapper::insertHandles(all);
+        sw.stop();
+        firstItem = sw.elapsedSec();
+        items = filesIn(all);
+        delete safe;
+        delete all;
+    }
+
+    size_t kb = peakKB();
+    std::cout << std::fixed << std::setprecision(3)
+              << "first item  " << std::setw(8) << firstItem << "s" << std::endl
+              << "all items   " << std::setw(8) << sw.elapsedSec() << "s  ("
+              << items << ")" << std::endl;
+    if (kb) {
+        std::cout << "peak memory +" << (kb - baseKB) << "KB" << std::endl;
+    }
+
+    (void) bpf::safeRemove(dir);
+    return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bphandlebench - cost of handing a page many file handles: inserting
+ *                 handles into a service result, expanding them again
+ *                 on the way back in, and releasing them with the
+ *                 session.  "copy" translates by deep copy as
+ *                 insertHandles() does, "inplace" by
+ *                 insertHandlesInPlace().  Run each mode in its own
+ *                 process, peak memory and the handle mapper are per
+ *                 process.
+ *
+ * usage: bphandlebench <scratch dir> <copy|inplace> [count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+#include "PluginCommonLib/BPHandleMapper.h"
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+
+// high water mark of resident memory in KB, 0 where unknown
+static size_t
+peakKB()
+{
+#ifdef WIN32
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef MACOSX
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+
+// a service result listing count files
+static bp::List *
+buildResult(const std::vector<bfs::path> & paths)
+{
+    bp::List * l = new bp::List;
+    for (size_t i = 0; i < paths.size(); i++) {
+        bp::Map * m = new bp::Map;
+        m->add("file", new bp::Path(paths[i]));
+        m->add("index", new bp::Integer(i));
+        l->append(m);
+    }
+    return l;
+}
+
+
+static bp::Object *
+insert(bp::Object * o, bool inPlace)
+{
+    if (inPlace) return BPHandleMapper::insertHandlesInPlace(o);
+    bp::Object * rval = BPHandleMapper::insertHandles(o);
+    delete o;
+    return rval;
+}
+
+
+static bp::Object *
+expand(bp::Object * o, bool inPlace)
+{
+    if (inPlace) return BPHandleMapper::expandHandlesInPlace(o);
+    bp::Object * rval = BPHandleMapper::expandHandles(o);
+    delete o;
+    return rval;
+}
+
+
+static void
+report(const char * what, bp::time::Stopwatch & sw, size_t count)
+{
+    double s = sw.elapsedSec();
+    std::cout << std::fixed << std::setprecision(3)
+              << what << std::setw(8) << s << "s  ("
+              << std::setprecision(2) << (s * 1e6 / count)
+              << "us/handle)" << std::endl;
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    std::string mode(argc > 2 ? argv[2] : "");
+    if ((argc != 3 && argc != 4) || (mode != "copy" && mode != "inplace")) {
+        std::cout << "usage: " << argv[0]
+                  << " <scratch dir> <copy|inplace> [count]" << std::endl;
+        return 1;
+    }
+    bool inPlace = (mode == "inplace");
+    unsigned int count = argc == 4 ? atoi(argv[3]) : 100000;
+    if (count == 0) count = 1;
+
+    // 1000 files to a directory
+    bfs::path dir = bpf::getTempPath(bfs::path(argv[1]), "bphandlebench");
+    std::vector<bfs::path> paths;
+    try {
+        for (unsigned int i = 0; i < count; i++) {
+            char buf[32];
+            sprintf(buf, "dir%u", i / 1000);
+            bfs::path sub = dir / buf;
+            if (i % 1000 == 0) bfs::create_directories(sub);
+            sprintf(buf, "file%u.txt", i);
+            if (!bp::strutil::storeToFile(sub / buf, "")) {
+                std::cerr << "couldn't write " << sub / buf << std::endl;
+                return 1;
+            }
+            paths.push_back(sub / buf);
+        }
+    } catch (const bfs::filesystem_error & e) {
+        std::cerr << "couldn't create " << dir << ": " << e.what()
+                  << std::endl;
+        return 1;
+    }
+    std::cout << "handing out " << count << " handles" << std::endl;
+
+    size_t baseKB = peakKB();
+    int session = 0;
+    bp::time::Stopwatch sw;
+
+    {
+        BPHandleMapper::SessionScope scope(&session);
+
+        // first sight of each path creates its handle
+        bp::Object * o = buildResult(paths);
+        sw.start();
+        o = insert(o, inPlace);
+        sw.stop();
+        report("insert new  ", sw, count);
+
+        // later results find the handles already made
+        delete o;
+        o = buildResult(paths);
+        sw.reset();
+        sw.start();
+        o = insert(o, inPlace);
+        sw.stop();
+        report("insert again", sw, count);
+
+        // and the page hands them back as arguments
+        sw.reset();
+        sw.start();
+        o = expand(o, inPlace);
+        sw.stop();
+        report("expand      ", sw, count);
+
+        size_t expanded = 0;
+        if (o && o->type() == BPTList) {
+            const bp::List * l = (const bp::List *) o;
+            for (unsigned int i = 0; i < l->size(); i++) {
+                if (l->value(i)->has("file", BPTNativePath)) expanded++;
+            }
+        }
+        if (expanded != count) {
+            std::cerr << "expanded " << expanded << " of " << count
+                      << " handles" << std::endl;
+        }
+        delete o;
+    }
+
+    size_t live = BPHandleMapper::size();
+    sw.reset();
+    sw.start();
+    BPHandleMapper::releaseSession(&session);
+    sw.stop();
+    report("release     ", sw, count);
+    std::cout << "live handles " << live << " -> "
+              << BPHandleMapper::size() << std::endl;
+
+    size_t kb = peakKB();
+    if (kb) {
+        std::cout << "peak memory +" << (kb - baseKB) << "KB" << std::endl;
+    }
+
+    (void) bpf::safeRemove(dir);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bphttpbench - measure the embedded web server's throughput serving
+ *               a large body from memory and from disk, and reading a
+ *               large upload as it arrives.
+ *
+ * usage: bphttpbench [megabytes] [repetitions]
+ */
+
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bphttp/HttpServer.h"
+#include "bphttp/HttpSyncTransaction.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprandom.h"
+#include "BPUtils/bpsha256.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+
+namespace bfs = boost::filesystem;
+using namespace bp::http;
+
+
+// serves the content from memory, or from disk at /file, and hashes
+// uploads as they arrive without buffering them
+class ThroughputHandler : public server::IHandler
+{
+  public:
+    ThroughputHandler(const std::string * content, const bfs::path & file)
+        : m_content(content), m_file(file)
+    {
+    }
+
+  private:
+    bool processRequest(const Request &, Response &)
+    {
+        return false;
+    }
+
+    bool processStreamingRequest(const Request & request,
+                                 server::IRequestBody & body,
+                                 Response & response,
+                                 server::BodySourcePtr &)
+    {
+        if (request.method.code() == Method::HTTP_POST) {
+            bp::sha256::Hasher hasher;
+            std::vector<unsigned char> buf(64 * 1024);
+            int n;
+            while ((n = body.read(&buf[0], buf.size())) > 0) {
+                hasher.update(&buf[0], n);
+            }
+            if (n < 0) return false;
+            response.body.append(hasher.digest());
+        } else if (!request.url.path().compare("/file")) {
+            response.body.fromPath(m_file);
+        } else {
+            response.body.append(*m_content);
+        }
+        return true;
+    }
+
+    const std::string * m_content;
+    bfs::path m_file;
+};
+
+
+// run req reps times, returning the seconds taken or a negative
+// number if any response is wrong
+static double
+timeTransactions(RequestPtr req, const std::string & expect,
+                 unsigned int reps)
+{
+    bp::time::Stopwatch sw;
+    sw.start();
+    for (unsigned int i = 0; i < reps; i++) {
+        client::SyncTransactionPtr tran =
+            client::SyncTransaction::alloc(req);
+        client::SyncTransaction::FinalStatus results;
+        ResponsePtr resp = tran->execute(results);
+        if (results.code != client::SyncTransaction::FinalStatus::eOk ||
+            resp == NULL || resp->status.code() != Status::OK ||
+            resp->body.toString() != expect)
+        {
+            return -1.0;
+        }
+    }
+    return sw.elapsedSec();
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc > 3) {
+        std::cout << "usage: " << argv[0] << " [megabytes] [repetitions]"
+                  << std::endl;
+        return 1;
+    }
+    unsigned int megabytes = 16;
+    unsigned int reps = 4;
+    if (argc > 1) megabytes = (unsigned int) atoi(argv[1]);
+    if (argc > 2) reps = (unsigned int) atoi(argv[2]);
+    if (megabytes == 0) megabytes = 1;
+    if (reps == 0) reps = 1;
+
+    std::string content;
+    while (content.length() < megabytes * 1024 * 1024) {
+        content.push_back((char) ((bp::random::generate() % 26) + 'a'));
+    }
+    bfs::path file = bp::file::getTempPath(bp::file::getTempDirectory(),
+                                           "bphttpbench");
+    if (!bp::strutil::storeToFile(file, content)) {
+        std::cerr << "couldn't write " << file << std::endl;
+        return 1;
+    }
+
+    server::Server s;
+    ThroughputHandler handler(&content, file);
+    unsigned short port = 0;
+    if (!s.bind(port) || !s.mount("*", &handler) || !s.start()) {
+        std::cerr << "couldn't start server" << std::endl;
+        (void) bp::file::safeRemove(file);
+        return 1;
+    }
+    std::stringstream base;
+    base << "http://127.0.0.1:" << port;
+
+    std::cout << reps << " x " << megabytes << "MB" << std::endl
+              << "body     seconds     MB/s" << std::endl;
+
+    const char * names[] = { "memory", "file", "upload" };
+    int rv = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+        RequestPtr req;
+        std::string expect = content;
+        if (i == 2) {
+            req.reset(new Request(Method::HTTP_POST, base.str() + "/upload"));
+            req->body.append(content);
+            expect = bp::sha256::hash(content);
+        } else {
+            req.reset(new Request(Method::HTTP_GET,
+                                  base.str() + "/" + names[i]));
+        }
+        double secs = timeTransactions(req, expect, reps);
+        if (secs < 0) {
+            std::cerr << names[i] << " transfer failed" << std::endl;
+            rv = 1;
+            break;
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << std::setw(6) << names[i]
+                  << std::setw(10) << secs
+                  << std::setw(9)
+                  << (double) megabytes * reps / (secs > 0 ? secs : 1e-6)
+                  << std::endl;
+    }
+
+    (void) s.stop();
+    (void) bp::file::safeRemove(file);
+    return rv;
+}
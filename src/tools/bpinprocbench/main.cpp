@@ -0,0 +1,224 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpinprocbench - invoke round trip latency of a service, spawned and
+ *                 talked to over IPC as usual ("spawned"), or loaded
+ *                 into this process with Controller::runInProcess()
+ *                 ("inprocess").  Invokes are issued one at a time,
+ *                 each after the last one's results arrive.  The
+ *                 service must be v5 to run in process, and this tool
+ *                 doesn't check its signature as the daemon would.
+ *
+ * usage: bpinprocbench <service dir> <spawned|inprocess> <function>
+ *                      [json arguments] [count]
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+#include "ServiceRunnerLib/ServiceRunnerLib.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+static bp::runloop::RunLoop s_rl;
+
+
+// allocates an instance then invokes it count times, recording the
+// time taken by each
+class Bench : public ServiceRunner::IControllerListener
+{
+  public:
+    Bench(const std::string & function, const bp::Object * args,
+          unsigned int count)
+        : m_function(function), m_args(args), m_count(count),
+          m_instance(0), m_tid(0), m_failed(false), m_sw(), m_samples()
+    {
+    }
+
+    bool failed() { return m_failed; }
+    std::vector<double> & samples() { return m_samples; }
+    double loadSec() { return m_loadSec; }
+
+    void start() { m_sw.reset(); m_sw.start(); }
+
+  private:
+    std::string m_function;
+    const bp::Object * m_args;
+    unsigned int m_count;
+    unsigned int m_instance;
+    unsigned int m_tid;
+    bool m_failed;
+    bp::time::Stopwatch m_sw;
+    std::vector<double> m_samples;
+    double m_loadSec;
+
+    void fail(const std::string & why)
+    {
+        std::cerr << why << std::endl;
+        m_failed = true;
+        s_rl.stop();
+    }
+
+    void next(ServiceRunner::Controller * c)
+    {
+        if (m_samples.size() >= m_count) {
+            s_rl.stop();
+            return;
+        }
+        m_sw.reset();
+        m_sw.start();
+        m_tid = c->invoke(m_instance, m_function, m_args);
+        if (m_tid == (unsigned int) -1) fail("invoke failed");
+    }
+
+    void initialized(ServiceRunner::Controller * c, const std::string &,
+                     const std::string &, unsigned int)
+    {
+        m_loadSec = m_sw.elapsedSec();
+        bfs::path tmp = bpf::getTempPath(bpf::getTempDirectory(),
+                                         "bpinprocbench");
+        if (c->allocate("bpclient://bpinprocbench", tmp, tmp, "en",
+                        "bpinprocbench", 0) == (unsigned int) -1)
+        {
+            fail("allocate failed");
+        }
+    }
+    void onEnded(ServiceRunner::Controller *)
+    {
+        fail("service ended");
+    }
+    void onDescribe(ServiceRunner::Controller *,
+                    const bp::service::Description &) { }
+    void onAllocated(ServiceRunner::Controller * c, unsigned int,
+                     unsigned int instance)
+    {
+        m_instance = instance;
+        next(c);
+    }
+    void onInvokeResults(ServiceRunner::Controller * c, unsigned int,
+                         unsigned int tid, const bp::Object *)
+    {
+        if (tid != m_tid) return;
+        m_samples.push_back(m_sw.elapsedSec());
+        next(c);
+    }
+    void onInvokeError(ServiceRunner::Controller *, unsigned int,
+                       unsigned int, const std::string & error,
+                       const std::string & verboseError)
+    {
+        fail(std::string("invoke error: ") + error + " " + verboseError);
+    }
+    void onCallback(ServiceRunner::Controller *, unsigned int,
+                    unsigned int, long long int, const bp::Object *) { }
+    void onPrompt(ServiceRunner::Controller *, unsigned int, unsigned int,
+                  const bfs::path &, const bp::Object *) { }
+    void onInstallHook(ServiceRunner::Controller *, int) { }
+    void onUninstallHook(ServiceRunner::Controller *, int) { }
+};
+
+
+static void
+report(std::vector<double> & samples, double loadSec)
+{
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) total += samples[i];
+    size_t n = samples.size();
+    std::cout << std::fixed << std::setprecision(2)
+              << "load    " << std::setw(10) << loadSec * 1e3 << "ms" << std::endl
+              << "invokes " << std::setw(10) << n << std::endl
+              << "mean    " << std::setw(10) << total * 1e6 / n << "us" << std::endl
+              << "median  " << std::setw(10) << samples[n / 2] * 1e6 << "us" << std::endl
+              << "p99     " << std::setw(10) << samples[(n * 99) / 100] * 1e6 << "us" << std::endl
+              << "max     " << std::setw(10) << samples[n - 1] * 1e6 << "us" << std::endl;
+}
+
+
+int
+main(int argc, const char ** argv)
+{
+    // this binary is also the harness for the spawned service
+    if (argc > 1 && !std::string("-runService").compare(argv[1])) {
+        return ServiceRunner::runServiceProcess(argc, argv) ? 0 : 1;
+    }
+
+    std::string mode(argc > 2 ? argv[2] : "");
+    if (argc < 4 || argc > 6 || (mode != "spawned" && mode != "inprocess")) {
+        std::cout << "usage: " << argv[0] << " <service dir> "
+                  << "<spawned|inprocess> <function> [json arguments] [count]"
+                  << std::endl;
+        return 1;
+    }
+
+    bp::Object * args = NULL;
+    if (argc > 4) {
+        args = bp::Object::fromPlainJsonString(argv[4]);
+        if (args == NULL) {
+            std::cerr << "couldn't parse arguments: " << argv[4] << std::endl;
+            return 1;
+        }
+    }
+    unsigned int count = argc > 5 ? atoi(argv[5]) : 10000;
+    if (count == 0) count = 1;
+
+    s_rl.init();
+
+    int rv = 0;
+    {
+        Bench bench(argv[3], args, count);
+        std::tr1::shared_ptr<ServiceRunner::Controller> controller(
+            new ServiceRunner::Controller(bfs::path(argv[1])));
+        controller->setListener(&bench);
+
+        std::string err;
+        bench.start();
+        bool ok;
+        if (mode == "inprocess") {
+            ok = controller->runInProcess(bfs::path(), err);
+        } else {
+            ok = controller->run(
+                bpf::absoluteProgramPath(bfs::path(argv[0])), bfs::path(),
+                "bpinprocbench", "", bfs::path(), err);
+        }
+        if (!ok) {
+            std::cerr << "couldn't start service: " << err << std::endl;
+            rv = 1;
+        } else {
+            s_rl.run();
+            if (bench.failed() || bench.samples().empty()) rv = 1;
+            else report(bench.samples(), bench.loadSec());
+        }
+        controller.reset();
+    }
+
+    delete args;
+    s_rl.shutdown();
+    return rv;
+}
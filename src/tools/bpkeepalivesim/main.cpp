@@ -0,0 +1,341 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpkeepalivesim - replays a synthetic day of service use against the
+ *                  KeepAlivePolicy which decides when idle service
+ *                  runners are shut down and when stopped ones are
+ *                  prewarmed.  Fixed manifest shutdown delays (the
+ *                  old behavior) are compared with the adaptive policy
+ *                  by cold starts and by the average number of idle
+ *                  runners held, which is what keeping services alive
+ *                  costs in memory.  Exits non-zero if the adaptive
+ *                  policy starts services cold more often than fixed
+ *                  delays holding as many idle runners would.
+ *
+ * usage: bpkeepalivesim [hours] [seed]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "ServiceManager/KeepAlivePolicy.h"
+
+// simulation step, seconds
+#define STEP 0.1
+
+// a small deterministic generator, so runs are repeatable everywhere
+class Random
+{
+  public:
+    Random(unsigned int seed) : m_state(seed ? seed : 1) { }
+    // uniform in [0, 1)
+    double uniform() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return (m_state & 0xffffff) / (double) 0x1000000;
+    }
+    double between(double lo, double hi) {
+        return lo + (hi - lo) * uniform();
+    }
+    double exponential(double mean) {
+        return -mean * log(1.0 - uniform());
+    }
+  private:
+    unsigned int m_state;
+};
+
+struct Use {
+    double at;
+    double secs;
+};
+
+struct Service {
+    std::string name;
+    double spawnSecs;
+    std::vector<Use> uses;
+};
+
+// the kinds of use we see: pages which use a service in bursts, a
+// poller on a fixed period, a steady trickle, and the occasional use
+static void
+buildWorkload(double horizon, unsigned int seed,
+              std::vector<Service> & services)
+{
+    Random r(seed);
+    services.clear();
+
+    for (unsigned int n = 0; n < 3; n++) {
+        Service s;
+        char name[32];
+        sprintf(name, "Bursty%u", n);
+        s.name = name;
+        s.spawnSecs = r.between(0.5, 2.5);
+        for (double t = r.between(0, 120); t < horizon; ) {
+            unsigned int burst = 2 + (unsigned int) (r.uniform() * 6);
+            for (unsigned int i = 0; i < burst && t < horizon; i++) {
+                Use u = { t, r.between(1, 6) };
+                s.uses.push_back(u);
+                t += u.secs + r.between(5, 25);
+            }
+            t += r.between(60, 200);
+        }
+        services.push_back(s);
+    }
+
+    for (unsigned int n = 0; n < 2; n++) {
+        Service s;
+        char name[32];
+        sprintf(name, "Periodic%u", n);
+        s.name = name;
+        s.spawnSecs = r.between(1.0, 3.0);
+        double period = (n == 0) ? 600.0 : 1200.0;
+        for (double t = r.between(0, period); t < horizon;
+             t += period + r.between(-15, 15))
+        {
+            Use u = { t, r.between(2, 5) };
+            s.uses.push_back(u);
+        }
+        services.push_back(s);
+    }
+
+    {
+        Service s;
+        s.name = "Steady";
+        s.spawnSecs = r.between(0.5, 1.5);
+        for (double t = r.exponential(40); t < horizon;
+             t += r.exponential(40))
+        {
+            Use u = { t, r.between(1, 4) };
+            s.uses.push_back(u);
+        }
+        services.push_back(s);
+    }
+
+    {
+        Service s;
+        s.name = "Rare";
+        s.spawnSecs = r.between(0.5, 1.5);
+        for (double t = r.exponential(3000); t < horizon;
+             t += r.exponential(3000))
+        {
+            Use u = { t, r.between(1, 4) };
+            s.uses.push_back(u);
+        }
+        services.push_back(s);
+    }
+}
+
+struct Result {
+    std::string label;
+    unsigned int coldStarts;
+    unsigned int prewarms;
+    double startWait;
+    double idleRunners;
+};
+
+static Result
+simulate(const std::vector<Service> & services, double horizon,
+         int shutdownDelaySecs, unsigned int budget)
+{
+    enum { Stopped, Idle, Busy };
+    KeepAlivePolicy policy(budget);
+    size_t count = services.size();
+    std::vector<int> state(count, Stopped);
+    std::vector<size_t> next(count, 0);
+    std::vector<std::vector<double> > ends(count);
+
+    Result r;
+    r.coldStarts = r.prewarms = 0;
+    r.startWait = r.idleRunners = 0.0;
+
+    for (double now = 0.0; now < horizon; now += STEP) {
+        for (size_t i = 0; i < count; i++) {
+            const Service & s = services[i];
+
+            // instances going away
+            std::vector<double> & e = ends[i];
+            for (size_t j = 0; j < e.size(); ) {
+                if (e[j] <= now) e.erase(e.begin() + j);
+                else j++;
+            }
+            if (state[i] == Busy && e.empty()) {
+                state[i] = Idle;
+                policy.idle(s.name, now);
+            }
+
+            // instances being requested
+            while (next[i] < s.uses.size() && s.uses[next[i]].at <= now) {
+                const Use & u = s.uses[next[i]++];
+                policy.used(s.name, now);
+                if (state[i] == Stopped) {
+                    r.coldStarts++;
+                    r.startWait += s.spawnSecs;
+                    policy.spawned(s.name, s.spawnSecs);
+                }
+                state[i] = Busy;
+                e.push_back(now + u.secs);
+            }
+
+            // idle runners whose time is up
+            if (state[i] == Idle &&
+                policy.idleDeadline(s.name, shutdownDelaySecs) <= now)
+            {
+                state[i] = Stopped;
+            }
+        }
+
+        // hold no more idle runners than the budget allows
+        std::map<std::string, int> idle;
+        for (size_t i = 0; i < count; i++) {
+            if (state[i] == Idle) idle[services[i].name] = shutdownDelaySecs;
+        }
+        std::vector<std::string> victims;
+        policy.overBudget(idle, now, victims);
+        for (size_t i = 0; i < count; i++) {
+            if (std::find(victims.begin(), victims.end(), services[i].name)
+                != victims.end())
+            {
+                state[i] = Stopped;
+            }
+        }
+
+        // start what's predicted to be wanted shortly
+        for (size_t i = 0; i < count; i++) {
+            if (state[i] != Stopped) continue;
+            double t = policy.prewarmTime(services[i].name);
+            if (t >= 0.0 && t <= now) {
+                state[i] = Idle;
+                r.prewarms++;
+                policy.prewarmed(services[i].name);
+                policy.spawned(services[i].name, services[i].spawnSecs);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (state[i] == Idle) r.idleRunners += STEP;
+        }
+    }
+
+    r.idleRunners /= horizon;
+    return r;
+}
+
+int
+main(int argc, const char ** argv)
+{
+    double hours = (argc > 1) ? atof(argv[1]) : 8.0;
+    unsigned int seed = (argc > 2) ? (unsigned int) atoi(argv[2]) : 42;
+    if (hours <= 0.0) {
+        fprintf(stderr, "usage: %s [hours] [seed]\n", argv[0]);
+        return 1;
+    }
+    double horizon = hours * 3600.0;
+
+    std::vector<Service> services;
+    buildWorkload(horizon, seed, services);
+    unsigned int uses = 0;
+    for (size_t i = 0; i < services.size(); i++) {
+        uses += services[i].uses.size();
+    }
+    printf("%u services, %u uses over %.1f hours\n\n",
+           (unsigned int) services.size(), uses, hours);
+
+    std::vector<Result> fixed;
+    const int delays[] = { 0, 5, 15, 30, 60, 120, 300 };
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        Result r = simulate(services, horizon, delays[i], 0);
+        char label[64];
+        sprintf(label, "fixed %ds", delays[i]);
+        r.label = label;
+        fixed.push_back(r);
+    }
+
+    std::vector<Result> adaptive;
+    const unsigned int budgets[] = { 1, 2, 4 };
+    for (size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++) {
+        Result r = simulate(services, horizon, 0, budgets[i]);
+        char label[64];
+        sprintf(label, "adaptive, budget %u", budgets[i]);
+        r.label = label;
+        adaptive.push_back(r);
+    }
+
+    printf("%-22s %11s %9s %12s %12s\n", "policy", "cold starts",
+           "prewarms", "start wait", "idle runners");
+    std::vector<Result> all(fixed);
+    all.insert(all.end(), adaptive.begin(), adaptive.end());
+    for (size_t i = 0; i < all.size(); i++) {
+        printf("%-22s %11u %9u %11.1fs %12.2f\n", all[i].label.c_str(),
+               all[i].coldStarts, all[i].prewarms, all[i].startWait,
+               all[i].idleRunners);
+    }
+
+    // each adaptive budget is judged against the fixed delays at the
+    // same memory cost, interpolating cold starts between the two
+    // fixed delays whose idle runners bracket its own
+    bool ok = true;
+    printf("\n");
+    for (size_t i = 0; i < adaptive.size(); i++) {
+        const Result & a = adaptive[i];
+        const Result * lo = NULL;
+        const Result * hi = NULL;
+        for (size_t j = 0; j < fixed.size(); j++) {
+            const Result & f = fixed[j];
+            if (f.idleRunners <= a.idleRunners &&
+                (!lo || f.idleRunners > lo->idleRunners))
+            {
+                lo = &f;
+            }
+            if (f.idleRunners >= a.idleRunners &&
+                (!hi || f.idleRunners < hi->idleRunners))
+            {
+                hi = &f;
+            }
+        }
+        if (!lo || !hi) {
+            printf("%s: outside the range of fixed delays\n",
+                   a.label.c_str());
+            continue;
+        }
+        double expected = hi->coldStarts;
+        if (hi->idleRunners > lo->idleRunners) {
+            double t = (a.idleRunners - lo->idleRunners) /
+                (hi->idleRunners - lo->idleRunners);
+            expected = lo->coldStarts +
+                t * ((double) hi->coldStarts - (double) lo->coldStarts);
+        }
+        bool better = a.coldStarts <= expected;
+        printf("%s: %u cold starts vs %.0f between %s and %s at %.2f "
+               "idle runners - %s\n", a.label.c_str(), a.coldStarts,
+               expected, lo->label.c_str(), hi->label.c_str(),
+               a.idleRunners, better ? "ok" : "FAIL");
+        if (!better) ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -58,6 +58,12 @@ static APTArgDefinition s_packArgs[] =
         "path where the .bpkg file should be placed (by convention, this"
         " should have a .bpkg extension.  This is a .tar.lz (lzip) file).  If"
         " not provided, output file will be named 'content.bpkg')"
+    },
+    {
+        "blocks", APT::NO_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "compress large packages as independent blocks on all processors."
+        "  Clients without BLOCKS support can't unpack such packages."
     }
 };
 
@@ -118,6 +124,7 @@ main(int argc, const char ** argv)
         if (outPath.empty()) outPath = "contents.bpkg";
         bfs::path publicKey(packArgParser.argument("publicKey"));
         bfs::path privateKey(packArgParser.argument("privateKey"));
+        bp::pkg::setBlockCompression(packArgParser.argumentPresent("blocks"));
 
         if (bpf::isRegularFile(packArgParser.argument("in")))
         {
@@ -0,0 +1,139 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpkvbench - compare write latency of bp::KVLog against rewriting a
+ *             whole JSON map on every write, as bp::phash used to.
+ *
+ * usage: bpkvbench <scratch dir> [keys ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
+#include "platform_utils/bpkvlog.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+
+static std::string
+keyName(unsigned int i)
+{
+    char buf[32];
+    sprintf(buf, "key.%u", i);
+    return buf;
+}
+
+
+// the old bp::phash write path, a whole file rewrite per set
+static double
+benchJsonRewrite(const bfs::path & path, unsigned int keys)
+{
+    bp::Map m;
+    bp::time::Stopwatch sw;
+    sw.start();
+    for (unsigned int i = 0; i < keys; i++) {
+        m.add(keyName(i), new bp::String("some value"));
+        if (!bp::strutil::storeToFile(path, m.toPlainJsonString(true))) {
+            std::cerr << "couldn't write " << path << std::endl;
+            exit(1);
+        }
+    }
+    sw.stop();
+    return sw.elapsedSec();
+}
+
+
+static double
+benchKVLog(const bfs::path & path, unsigned int keys)
+{
+    bp::KVLog log;
+    if (!log.open(path)) {
+        std::cerr << "couldn't open " << path << std::endl;
+        exit(1);
+    }
+    bp::time::Stopwatch sw;
+    sw.start();
+    for (unsigned int i = 0; i < keys; i++) {
+        if (!log.set(keyName(i), "some value")) {
+            std::cerr << "couldn't write " << path << std::endl;
+            exit(1);
+        }
+    }
+    sw.stop();
+    return sw.elapsedSec();
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <scratch dir> [keys ...]"
+                  << std::endl;
+        return 1;
+    }
+
+    bfs::path dir = bpf::getTempPath(bfs::path(argv[1]), "bpkvbench");
+    try {
+        bfs::create_directories(dir);
+    } catch (const bfs::filesystem_error & e) {
+        std::cerr << "couldn't create " << dir << ": " << e.what()
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned int> counts;
+    for (int i = 2; i < argc; i++) counts.push_back(atoi(argv[i]));
+    if (counts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(10000);
+    }
+
+    std::cout << "   keys  json rewrite(us/write)  kvlog(us/write)"
+              << std::endl;
+    for (size_t i = 0; i < counts.size(); i++) {
+        unsigned int keys = counts[i];
+        if (keys == 0) continue;
+        double json = benchJsonRewrite(dir / "state.json", keys);
+        double kv = benchKVLog(dir / "state.kv", keys);
+        (void) bpf::safeRemove(dir / "state.json");
+        (void) bpf::safeRemove(dir / "state.kv");
+        (void) bpf::safeRemove(dir / "state.lock");
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(7) << keys
+                  << std::setw(24) << json * 1000000.0 / keys
+                  << std::setw(17) << kv * 1000000.0 / keys
+                  << std::endl;
+    }
+
+    (void) bpf::safeRemove(dir);
+    return 0;
+}
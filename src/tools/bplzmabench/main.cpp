@@ -0,0 +1,124 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bplzmabench - measure how BLOCKS format lzma compression and
+ *               decompression scale with the number of threads.
+ *
+ * usage: bplzmabench <file> [max threads]
+ */
+
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "ArchiveLib/ArchiveLib.h"
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/OS.h"
+
+namespace bfs = boost::filesystem;
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc != 2 && argc != 3) {
+        std::cout << "usage: " << argv[0] << " <file> [max threads]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string orig;
+    if (!bp::strutil::loadFromFile(bfs::path(argv[1]), orig)) {
+        std::cerr << "couldn't read file: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    unsigned int maxThreads = bp::os::NumProcessors();
+    if (argc == 3) maxThreads = (unsigned int) atoi(argv[2]);
+    if (maxThreads == 0) maxThreads = 1;
+
+    std::cout << orig.size() << " bytes, "
+              << bp::os::NumProcessors() << " processors" << std::endl
+              << "threads  compress(s)  speedup  decompress(s)  speedup"
+              << "  ratio" << std::endl;
+
+    double baseC = 0.0, baseD = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        std::string compressed;
+        bp::time::Stopwatch sw;
+
+        {
+            bp::lzma::Compress c;
+            std::istringstream in(orig);
+            std::ostringstream out(std::ios_base::binary | std::ios_base::out);
+            c.setInputStream(in);
+            c.setOutputStream(out);
+            c.setThreads(threads);
+            sw.start();
+            if (!c.run(bp::lzma::BLOCKS)) {
+                std::cerr << "compression failed" << std::endl;
+                return 1;
+            }
+            sw.stop();
+            compressed = out.str();
+        }
+        double cSec = sw.elapsedSec();
+
+        {
+            bp::lzma::Decompress d;
+            std::istringstream in(compressed);
+            std::ostringstream out(std::ios_base::binary | std::ios_base::out);
+            d.setInputStream(in);
+            d.setOutputStream(out);
+            d.setThreads(threads);
+            sw.reset();
+            sw.start();
+            if (!d.run(bp::lzma::BLOCKS) || out.str() != orig) {
+                std::cerr << "decompression failed" << std::endl;
+                return 1;
+            }
+            sw.stop();
+        }
+        double dSec = sw.elapsedSec();
+
+        if (threads == 1) {
+            baseC = cSec;
+            baseD = dSec;
+        }
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << std::setw(7) << threads
+                  << std::setw(13) << cSec
+                  << std::setw(9) << (cSec > 0 ? baseC / cSec : 0.0)
+                  << std::setw(15) << dSec
+                  << std::setw(9) << (dSec > 0 ? baseD / dSec : 0.0)
+                  << std::setw(7)
+                  << (double) compressed.size() / (double) orig.size()
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+/**
+ * invokethroughput.cpp - measures how many invocations of a service
+ *                        function the daemon completes when each of
+ *                        several sessions keeps many of them
+ *                        outstanding at once.
+ */
+
+#include "invokethroughput.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "BPProtocol/BPProtocol.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+
+struct Session;
+
+struct Invocation
+{
+    Session * m_session;
+    bp::time::Stopwatch m_sw;
+};
+
+struct Session
+{
+    BPProtoHand m_hand;
+    std::vector<Invocation *> m_invocations;
+    unsigned int m_outstanding;
+};
+
+static bp::runloop::RunLoop s_itRl;
+static std::vector<Session *> s_sessions;
+static std::vector<double> s_latencies;
+static std::string s_service;
+static std::string s_version;
+static std::string s_function;
+static bp::Object * s_arguments = NULL;
+static unsigned int s_depth = 0;
+static double s_durationSec = 0.0;
+static bp::time::Stopwatch s_totalSw;
+static unsigned int s_failures = 0;
+
+static bool
+finished()
+{
+    return s_totalSw.elapsedSec() >= s_durationSec;
+}
+
+static void
+maybeStop()
+{
+    for (size_t i = 0; i < s_sessions.size(); i++) {
+        if (s_sessions[i]->m_outstanding) return;
+    }
+    s_itRl.stop();
+}
+
+static void invokeNext(Invocation * inv);
+
+static void
+resultsCallback(void * cookie, unsigned int, BPErrorCode ec,
+                const BPElement *)
+{
+    Invocation * inv = (Invocation *) cookie;
+    inv->m_sw.stop();
+    inv->m_session->m_outstanding--;
+    if (ec != BP_EC_OK) {
+        s_failures++;
+    } else {
+        s_latencies.push_back(inv->m_sw.elapsedSec());
+    }
+    if (finished()) {
+        maybeStop();
+    } else {
+        invokeNext(inv);
+    }
+}
+
+static void
+invokeNext(Invocation * inv)
+{
+    inv->m_sw.reset();
+    inv->m_sw.start();
+    inv->m_session->m_outstanding++;
+    BPErrorCode ec = BPExecute(inv->m_session->m_hand,
+                               s_service.c_str(), s_version.c_str(),
+                               s_function.c_str(),
+                               s_arguments ? s_arguments->elemPtr() : NULL,
+                               resultsCallback, inv, NULL, NULL, NULL);
+    if (ec != BP_EC_OK) {
+        inv->m_session->m_outstanding--;
+        s_failures++;
+        s_itRl.stop();
+    }
+}
+
+static void
+requireCallback(BPErrorCode ec, void * cookie,
+                const BPServiceDefinition ** defs, unsigned int numDefs,
+                const char * error, const char *)
+{
+    Session * s = (Session *) cookie;
+    if (ec != BP_EC_OK || numDefs != 1) {
+        std::cerr << "require of " << s_service << " failed: "
+                  << (error ? error : BPErrorCodeToString(ec))
+                  << std::endl;
+        s_failures++;
+        s_itRl.stop();
+        return;
+    }
+
+    // invoke the version we were handed, the first session to
+    // hear back decides it for everyone
+    if (s_version.empty()) {
+        std::stringstream ss;
+        ss << defs[0]->majorVersion << "." << defs[0]->minorVersion
+           << "." << defs[0]->microVersion;
+        s_version = ss.str();
+    }
+
+    // fill the pipeline, all of these are in flight on the one
+    // session at once
+    for (unsigned int i = 0; i < s_depth; i++) {
+        Invocation * inv = new Invocation;
+        inv->m_session = s;
+        s->m_invocations.push_back(inv);
+        invokeNext(inv);
+    }
+}
+
+static void
+connectCallback(BPErrorCode ec, void * cookie, const char *, const char *)
+{
+    Session * s = (Session *) cookie;
+    if (ec != BP_EC_OK) {
+        s_failures++;
+        s_itRl.stop();
+        return;
+    }
+
+    bp::Map * service = new bp::Map;
+    service->add("name", new bp::String(s_service));
+    bp::List * services = new bp::List;
+    services->append(service);
+    bp::Map args;
+    args.add("services", services);
+    if (BPRequire(s->m_hand, args.elemPtr(), requireCallback, s,
+                  NULL, NULL, NULL) != BP_EC_OK)
+    {
+        s_failures++;
+        s_itRl.stop();
+    }
+}
+
+// stand in for the user, approving whatever we're asked
+static void
+promptCallback(void * cookie, const char *, const BPElement *,
+               unsigned int tid)
+{
+    bp::String s("AlwaysAllow");
+    BPDeliverUserResponse((BPProtoHand) cookie, tid, s.elemPtr());
+}
+
+static double
+percentile(const std::vector<double> & sorted, double pct)
+{
+    if (sorted.empty()) return 0.0;
+    size_t i = (size_t) (pct / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+void
+runInvokeThroughputTest(const std::string & service,
+                        const std::string & function,
+                        const std::string & arguments,
+                        unsigned int numSessions,
+                        unsigned int depth,
+                        unsigned int duration)
+{
+    s_itRl.init();
+    s_service = service;
+    s_function = function;
+    s_depth = depth ? depth : 1;
+    s_durationSec = duration;
+    if (!arguments.empty()) {
+        s_arguments = bp::Object::fromPlainJsonString(arguments);
+        if (s_arguments == NULL) {
+            std::cerr << "invalid arguments: " << arguments << std::endl;
+            return;
+        }
+    }
+    s_totalSw.start();
+
+    bool ok = true;
+    for (unsigned int i = 0; i < numSessions; i++) {
+        Session * s = new Session;
+        s->m_outstanding = 0;
+        s->m_hand = BPAlloc();
+        BPSetUserPromptCallback(s->m_hand, promptCallback, s->m_hand);
+        s_sessions.push_back(s);
+        BPErrorCode ec = BPConnect(
+            s->m_hand, "bpclient://9F802D4B-1F23-42A4-9490-8FC8EE2BCCDD",
+            "en", "BrowserPlus invoke throughput tester",
+            connectCallback, s);
+        if (ec != BP_EC_OK) {
+            std::cerr << "BPConnect failed: " << BPErrorCodeToString(ec)
+                      << std::endl;
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok) s_itRl.run();
+    s_totalSw.stop();
+
+    for (size_t i = 0; i < s_sessions.size(); i++) {
+        BPFree(s_sessions[i]->m_hand);
+        for (size_t j = 0; j < s_sessions[i]->m_invocations.size(); j++) {
+            delete s_sessions[i]->m_invocations[j];
+        }
+        delete s_sessions[i];
+    }
+    s_sessions.clear();
+    delete s_arguments;
+    s_arguments = NULL;
+    if (!ok) return;
+
+    std::sort(s_latencies.begin(), s_latencies.end());
+    double elapsed = s_totalSw.elapsedSec();
+
+    std::cout << "Invoked " << s_service << "." << s_function << " "
+              << s_latencies.size() << " times on " << numSessions
+              << " sessions, " << s_depth << " outstanding per session, "
+              << s_failures << " failures." << std::endl;
+    if (!s_latencies.empty() && elapsed > 0.0) {
+        std::cout << "  rate:   "
+                  << s_latencies.size() / elapsed << "/s" << std::endl
+                  << "  median: "
+                  << percentile(s_latencies, 50) * 1000.0 << "ms" << std::endl
+                  << "  p95:    "
+                  << percentile(s_latencies, 95) * 1000.0 << "ms" << std::endl
+                  << "  max:    "
+                  << s_latencies.back() * 1000.0 << "ms" << std::endl;
+    }
+}
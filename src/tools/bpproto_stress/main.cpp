@@ -31,6 +31,9 @@
 #include "BPUtils/BPLog.h"
 #include "platform_utils/APTArgParse.h"
 #include "platform_utils/bpconfig.h"
+#include "invokethroughput.h"
+#include "pageinit.h"
+#include "requirelatency.h"
 #include "stresstest.h"
 
 static void 
@@ -66,6 +69,37 @@ processCommandLine(APTArgParse& argParser, int argc, const char ** argv)
         { "d", APT::TAKES_ARG, "10", APT::REQUIRED,
         APT::IS_INTEGER, APT::MAY_NOT_RECUR,
         "the duration of the test in seconds."
+        },
+        { "p", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+        "instead of the stress test, compare page init latency of "
+        "describing up to this many services one at a time and in "
+        "a single batch."
+        },
+        { "r", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "instead of the stress test, measure the latency of requiring "
+        "this installed service on -s sessions at once for -d seconds."
+        },
+        { "i", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "with -r, measure while another session requires this "
+        "uninstalled service, until its install completes."
+        },
+        { "x", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "instead of the stress test, measure the throughput of invoking "
+        "this service function (service.function) on -s sessions for "
+        "-d seconds."
+        },
+        { "n", APT::TAKES_ARG, "16", APT::REQUIRED,
+        APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+        "with -x, the number of invocations each session keeps "
+        "outstanding."
+        },
+        { "a", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+        APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+        "with -x, the arguments to pass, as json."
         }
     };
     
@@ -101,7 +135,32 @@ main(int argc, const char ** argv)
     BPInitialize();
 
     // ready to go!  now run the test
-    runTest(simulConns, duration);
+    if (argParser.argumentPresent("p")) {
+        runPageInitTest(argParser.argumentAsInteger("p"));
+    } else if (argParser.argumentPresent("r")) {
+        std::string install;
+        if (argParser.argumentPresent("i")) install = argParser.argument("i");
+        runRequireLatencyTest(argParser.argument("r"), install,
+                              simulConns, duration);
+    } else if (argParser.argumentPresent("x")) {
+        std::string target = argParser.argument("x");
+        std::string::size_type dot = target.rfind('.');
+        if (dot == std::string::npos || dot == 0 ||
+            dot + 1 == target.size())
+        {
+            std::cerr << "-x wants service.function" << std::endl;
+            BPShutdown();
+            return 1;
+        }
+        std::string args;
+        if (argParser.argumentPresent("a")) args = argParser.argument("a");
+        runInvokeThroughputTest(target.substr(0, dot),
+                                target.substr(dot + 1), args, simulConns,
+                                argParser.argumentAsInteger("n"),
+                                duration);
+    } else {
+        runTest(simulConns, duration);
+    }
 
     // stop protocol library
     BPShutdown();
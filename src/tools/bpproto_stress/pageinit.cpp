@@ -0,0 +1,190 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * pageinit.cpp - measures the latency of describing the services a
+ *                page uses at startup, first with one Describe round
+ *                trip per service and then with a single
+ *                DescribeServices round trip.
+ */
+
+#include "pageinit.h"
+#include <iostream>
+#include <vector>
+#include "BPProtocol/BPProtocol.h"
+#include "BPUtils/bperrorutil.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+
+
+static bp::runloop::RunLoop s_plRl;
+static BPProtoHand s_hand = NULL;
+static unsigned int s_maxServices = 0;
+static std::vector<std::string> s_names;
+static size_t s_next = 0;
+static unsigned int s_failures = 0;
+static bp::time::Stopwatch s_sw;
+static double s_serialSec = 0.0;
+static double s_batchSec = 0.0;
+
+static void describeNext();
+
+static void
+batchCallback(BPErrorCode ec, void *, const BPServiceDefinition ** defs,
+              unsigned int numDefs, const char *, const char *)
+{
+    s_sw.stop();
+    s_batchSec = s_sw.elapsedSec();
+    if (ec != BP_EC_OK) {
+        s_failures++;
+    } else {
+        for (unsigned int i = 0; i < numDefs; i++) {
+            if (defs[i] == NULL) s_failures++;
+        }
+    }
+    s_plRl.stop();
+}
+
+static void
+describeBatch()
+{
+    bp::List services;
+    for (size_t i = 0; i < s_names.size(); i++) {
+        bp::Map * m = new bp::Map;
+        m->add("name", new bp::String(s_names[i]));
+        services.append(m);
+    }
+
+    s_sw.reset();
+    s_sw.start();
+    if (BPDescribeServices(s_hand, services.elemPtr(), batchCallback,
+                           NULL) != BP_EC_OK)
+    {
+        s_failures++;
+        s_plRl.stop();
+    }
+}
+
+static void
+describeCallback(BPErrorCode ec, void *, const BPServiceDefinition *,
+                 const char *, const char *)
+{
+    if (ec != BP_EC_OK) s_failures++;
+    describeNext();
+}
+
+// one round trip per service, each issued when the last completes,
+// which is how a page which describes services one by one behaves
+static void
+describeNext()
+{
+    if (s_next == s_names.size()) {
+        s_sw.stop();
+        s_serialSec = s_sw.elapsedSec();
+        describeBatch();
+        return;
+    }
+    const std::string & name = s_names[s_next++];
+    if (BPDescribe(s_hand, name.c_str(), NULL, NULL, describeCallback,
+                   NULL) != BP_EC_OK)
+    {
+        s_failures++;
+        s_plRl.stop();
+    }
+}
+
+static void
+enumerateCallback(BPErrorCode ec, void *, const BPElement * services)
+{
+    if (ec != BP_EC_OK || services == NULL) {
+        s_failures++;
+        s_plRl.stop();
+        return;
+    }
+
+    bp::Object * obj = bp::Object::build(services);
+    if (obj && obj->type() == BPTList) {
+        const bp::List * l = (const bp::List *) obj;
+        for (unsigned int i = 0;
+             i < l->size() && s_names.size() < s_maxServices; i++)
+        {
+            const bp::Object * s = l->value(i);
+            if (s->has("name", BPTString)) {
+                s_names.push_back(std::string(*(s->get("name"))));
+            }
+        }
+    }
+    delete obj;
+
+    if (s_names.empty()) {
+        std::cerr << "no services installed, nothing to describe"
+                  << std::endl;
+        s_plRl.stop();
+        return;
+    }
+
+    s_sw.reset();
+    s_sw.start();
+    describeNext();
+}
+
+static void
+connectCallback(BPErrorCode ec, void *, const char *, const char *)
+{
+    if (ec != BP_EC_OK ||
+        BPEnumerate(s_hand, enumerateCallback, NULL) != BP_EC_OK)
+    {
+        s_failures++;
+        s_plRl.stop();
+    }
+}
+
+void
+runPageInitTest(unsigned int numServices)
+{
+    s_plRl.init();
+    s_maxServices = numServices;
+
+    s_hand = BPAlloc();
+    BPErrorCode ec = BPConnect(
+        s_hand, "bpclient://9F802D4B-1F23-42A4-9490-8FC8EE2BCCDD",
+        "en", "BrowserPlus page init latency tester",
+        connectCallback, NULL);
+    if (ec != BP_EC_OK) {
+        std::cerr << "BPConnect failed: " << BPErrorCodeToString(ec)
+                  << std::endl;
+        BPFree(s_hand);
+        return;
+    }
+
+    s_plRl.run();
+    BPFree(s_hand);
+    s_hand = NULL;
+
+    std::cout << "Described " << s_names.size() << " services, "
+              << s_failures << " failures." << std::endl
+              << "  sequential Describe: " << s_serialSec * 1000.0
+              << "ms" << std::endl
+              << "  DescribeServices:    " << s_batchSec * 1000.0
+              << "ms" << std::endl;
+}
@@ -0,0 +1,261 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * requirelatency.cpp - measures the latency of requiring an installed
+ *                      service on several sessions at once, optionally
+ *                      while another session's require installs a
+ *                      service which isn't.
+ */
+
+#include "requirelatency.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "BPProtocol/BPProtocol.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+
+struct Session
+{
+    BPProtoHand m_hand;
+    bp::time::Stopwatch m_sw;
+    bool m_busy;
+};
+
+static bp::runloop::RunLoop s_rlRl;
+static std::vector<Session *> s_sessions;
+static std::vector<double> s_latencies;
+static std::string s_require;
+static std::string s_install;
+static BPProtoHand s_installHand = NULL;
+static bool s_installing = false;
+static bp::time::Stopwatch s_installSw;
+static double s_durationSec = 0.0;
+static bp::time::Stopwatch s_totalSw;
+static unsigned int s_failures = 0;
+
+// with an install, run until it's done, otherwise for the duration
+static bool
+finished()
+{
+    if (!s_install.empty()) return !s_installing;
+    return s_totalSw.elapsedSec() >= s_durationSec;
+}
+
+static void
+maybeStop()
+{
+    if (!finished()) return;
+    for (size_t i = 0; i < s_sessions.size(); i++) {
+        if (s_sessions[i]->m_busy) return;
+    }
+    s_rlRl.stop();
+}
+
+static bool
+require(BPProtoHand hand, const std::string & name,
+        BPRequireCallback cb, void * cookie)
+{
+    bp::Map * service = new bp::Map;
+    service->add("name", new bp::String(name));
+    bp::List * services = new bp::List;
+    services->append(service);
+    bp::Map args;
+    args.add("services", services);
+    return BPRequire(hand, args.elemPtr(), cb, cookie,
+                     NULL, NULL, NULL) == BP_EC_OK;
+}
+
+static void requireNext(Session * s);
+
+static void
+requireCallback(BPErrorCode ec, void * cookie, const BPServiceDefinition **,
+                unsigned int, const char *, const char *)
+{
+    Session * s = (Session *) cookie;
+    s->m_sw.stop();
+    s->m_busy = false;
+    if (ec != BP_EC_OK) {
+        s_failures++;
+    } else {
+        s_latencies.push_back(s->m_sw.elapsedSec());
+    }
+    if (finished()) {
+        maybeStop();
+    } else {
+        requireNext(s);
+    }
+}
+
+static void
+requireNext(Session * s)
+{
+    s->m_sw.reset();
+    s->m_sw.start();
+    s->m_busy = true;
+    if (!require(s->m_hand, s_require, requireCallback, s)) {
+        s->m_busy = false;
+        s_failures++;
+        s_rlRl.stop();
+    }
+}
+
+static void
+connectCallback(BPErrorCode ec, void * cookie, const char *, const char *)
+{
+    if (ec != BP_EC_OK) {
+        s_failures++;
+        s_rlRl.stop();
+        return;
+    }
+    requireNext((Session *) cookie);
+}
+
+static void
+installCallback(BPErrorCode ec, void *, const BPServiceDefinition **,
+                unsigned int, const char * error, const char *)
+{
+    s_installSw.stop();
+    s_installing = false;
+    if (ec != BP_EC_OK) {
+        std::cerr << "require of " << s_install << " failed: "
+                  << (error ? error : BPErrorCodeToString(ec))
+                  << std::endl;
+        s_failures++;
+    }
+    maybeStop();
+}
+
+static void
+installConnectCallback(BPErrorCode ec, void *, const char *, const char *)
+{
+    s_installSw.start();
+    if (ec != BP_EC_OK ||
+        !require(s_installHand, s_install, installCallback, NULL))
+    {
+        s_installing = false;
+        s_failures++;
+        s_rlRl.stop();
+    }
+}
+
+// stand in for the user, approving whatever we're asked
+static void
+promptCallback(void * cookie, const char *, const BPElement *,
+               unsigned int tid)
+{
+    bp::String s("AlwaysAllow");
+    BPDeliverUserResponse((BPProtoHand) cookie, tid, s.elemPtr());
+}
+
+static BPProtoHand
+openSession(BPConnectCallback cb, void * cookie)
+{
+    BPProtoHand hand = BPAlloc();
+    BPSetUserPromptCallback(hand, promptCallback, hand);
+    BPErrorCode ec = BPConnect(
+        hand, "bpclient://9F802D4B-1F23-42A4-9490-8FC8EE2BCCDD",
+        "en", "BrowserPlus require latency tester", cb, cookie);
+    if (ec != BP_EC_OK) {
+        std::cerr << "BPConnect failed: " << BPErrorCodeToString(ec)
+                  << std::endl;
+        BPFree(hand);
+        return NULL;
+    }
+    return hand;
+}
+
+static double
+percentile(const std::vector<double> & sorted, double pct)
+{
+    if (sorted.empty()) return 0.0;
+    size_t i = (size_t) (pct / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+void
+runRequireLatencyTest(const std::string & require,
+                      const std::string & install,
+                      unsigned int numSessions,
+                      unsigned int duration)
+{
+    s_rlRl.init();
+    s_require = require;
+    s_install = install;
+    s_durationSec = duration;
+    s_totalSw.start();
+
+    bool ok = true;
+    if (!s_install.empty()) {
+        s_installing = true;
+        s_installHand = openSession(installConnectCallback, NULL);
+        ok = (s_installHand != NULL);
+    }
+    for (unsigned int i = 0; ok && i < numSessions; i++) {
+        Session * s = new Session;
+        s->m_busy = false;
+        s->m_hand = openSession(connectCallback, s);
+        if (s->m_hand == NULL) {
+            delete s;
+            ok = false;
+            break;
+        }
+        s_sessions.push_back(s);
+    }
+
+    if (ok) s_rlRl.run();
+
+    for (size_t i = 0; i < s_sessions.size(); i++) {
+        BPFree(s_sessions[i]->m_hand);
+        delete s_sessions[i];
+    }
+    s_sessions.clear();
+    if (s_installHand) BPFree(s_installHand);
+    s_installHand = NULL;
+    if (!ok) return;
+
+    std::sort(s_latencies.begin(), s_latencies.end());
+    double total = 0.0;
+    for (size_t i = 0; i < s_latencies.size(); i++) {
+        total += s_latencies[i];
+    }
+
+    std::cout << "Required " << s_require << " " << s_latencies.size()
+              << " times on " << numSessions << " sessions, "
+              << s_failures << " failures." << std::endl;
+    if (!s_install.empty()) {
+        std::cout << "  while installing " << s_install << " ("
+                  << s_installSw.elapsedSec() << "s)" << std::endl;
+    }
+    if (!s_latencies.empty()) {
+        std::cout << "  mean:   "
+                  << total / s_latencies.size() * 1000.0 << "ms" << std::endl
+                  << "  median: "
+                  << percentile(s_latencies, 50) * 1000.0 << "ms" << std::endl
+                  << "  p95:    "
+                  << percentile(s_latencies, 95) * 1000.0 << "ms" << std::endl
+                  << "  max:    "
+                  << s_latencies.back() * 1000.0 << "ms" << std::endl;
+    }
+}
@@ -0,0 +1,168 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bprescanbench - measure how long the daemon's first scan after an
+ *                 upgrade takes to find cached service descriptions.
+ *                 An upgrade rewrites every service unchanged, so
+ *                 only the content keyed index can still find them.
+ *
+ * usage: bprescanbench [services]
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+#include "BPUtils/bptypeutil.h"
+#include "platform_utils/ServiceInterfaceCache.h"
+#include "platform_utils/ServiceSummary.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+namespace sic = bp::serviceInterfaceCache;
+
+
+static void
+put(std::string & b, size_t offset, unsigned long long v, size_t len)
+{
+    if (b.size() < offset + len) b.resize(offset + len, '\0');
+    for (size_t i = 0; i < len; i++, v >>= 8) b[offset + i] = (char) (v & 0xff);
+}
+
+
+// the smallest little endian ELF64 image with a build id, enough to
+// stand in for a service library
+static std::string
+elfWithBuildId(const std::string & id)
+{
+    std::string b("\x7f" "ELF", 4);
+    put(b, 4, 2, 1);        // ELFCLASS64
+    put(b, 5, 1, 1);        // ELFDATA2LSB
+    put(b, 6, 1, 1);
+    put(b, 0x20, 64, 8);    // e_phoff
+    put(b, 0x36, 56, 2);    // e_phentsize
+    put(b, 0x38, 1, 2);     // e_phnum
+    put(b, 64, 4, 4);       // PT_NOTE
+    put(b, 64 + 0x08, 120, 8);
+    put(b, 64 + 0x20, 16 + ((id.size() + 3) & ~3), 8);
+    put(b, 120, 4, 4);
+    put(b, 124, id.size(), 4);
+    put(b, 128, 3, 4);      // NT_GNU_BUILD_ID
+    b.append("GNU\0", 4);
+    b.append(id);
+    b.resize(136 + ((id.size() + 3) & ~3), '\0');
+    return b;
+}
+
+
+static std::string
+serviceName(unsigned int i)
+{
+    std::stringstream ss;
+    ss << "Svc" << i;
+    return ss.str();
+}
+
+
+// write out a standalone service, as an install or an upgrade would
+static bool
+writeService(const bfs::path & dir, unsigned int i)
+{
+    std::stringstream manifest;
+    manifest << "{ \"type\": \"standalone\", \"ServiceLibrary\": \"lib.so\", "
+             << "\"strings\": { \"en\": { \"title\": \"Service " << i
+             << "\", \"summary\": \"a service\" } } }";
+    bfs::create_directories(dir);
+    return bp::strutil::storeToFile(dir / "manifest.json", manifest.str())
+        && bp::strutil::storeToFile(dir / "lib.so",
+                                    elfWithBuildId(serviceName(i)));
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc > 2) {
+        std::cout << "usage: " << argv[0] << " [services]" << std::endl;
+        return 1;
+    }
+    unsigned int services = 200;
+    if (argc > 1) services = (unsigned int) atoi(argv[1]);
+    if (services == 0) services = 1;
+
+    bfs::path dir = bpf::getTempPath(bpf::getTempDirectory(),
+                                     "bprescanbench");
+    bfs::create_directories(dir);
+    sic::setIndexPath(dir / "Index.kv");
+
+    // describe every service once
+    int rv = 0;
+    for (unsigned int i = 0; i < services && rv == 0; i++) {
+        bfs::path sdir = dir / serviceName(i) / "1.0.0";
+        bp::service::Summary s;
+        std::string err;
+        if (!writeService(sdir, i) || !s.detectService(sdir, err)) {
+            std::cerr << "couldn't write " << sdir << ": " << err
+                      << std::endl;
+            rv = 1;
+            break;
+        }
+        bp::Map desc;
+        desc.add("name", new bp::String(serviceName(i)));
+        (void) sic::setByKey(sic::contentKey(s), &desc);
+    }
+
+    // the upgrade, and a new daemon reopening the index
+    for (unsigned int i = 0; i < services && rv == 0; i++) {
+        if (!writeService(dir / serviceName(i) / "1.0.0", i)) rv = 1;
+    }
+    sic::setIndexPath(dir / "Index.kv");
+
+    if (rv == 0) {
+        bp::time::Stopwatch sw;
+        sw.start();
+        unsigned int hits = 0;
+        for (unsigned int i = 0; i < services; i++) {
+            bp::service::Summary s;
+            std::string err;
+            if (!s.detectService(dir / serviceName(i) / "1.0.0", err)) {
+                continue;
+            }
+            bp::Object * o = sic::getByKey(sic::contentKey(s));
+            if (o) hits++;
+            delete o;
+        }
+        double secs = sw.elapsedSec();
+
+        std::cout << services << " services rescanned after upgrade in "
+                  << secs << "s, " << hits << " cached" << std::endl;
+        if (hits != services) rv = 1;
+    }
+
+    sic::setIndexPath(bfs::path());
+    (void) bpf::safeRemove(dir);
+    return rv;
+}
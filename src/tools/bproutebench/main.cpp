@@ -0,0 +1,111 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bproutebench - measure the embedded web server's path router
+ *                looking up paths among many mounted routes.
+ *
+ * usage: bproutebench [routes] [lookups]
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bphttp/HttpRouter.h"
+#include "BPUtils/bpstopwatch.h"
+
+using namespace bp::http;
+using namespace bp::http::server;
+
+
+class NullHandler : public IHandler
+{
+  public:
+    bool processRequest(const Request &, Response &) { return true; }
+};
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc > 3) {
+        std::cout << "usage: " << argv[0] << " [routes] [lookups]"
+                  << std::endl;
+        return 1;
+    }
+    unsigned int numRoutes = 500;
+    unsigned int numLookups = 200000;
+    if (argc > 1) numRoutes = (unsigned int) atoi(argv[1]);
+    if (argc > 2) numLookups = (unsigned int) atoi(argv[2]);
+    if (numRoutes == 0) numRoutes = 1;
+    if (numLookups == 0) numLookups = 1;
+
+    NullHandler h;
+    Router r;
+    std::vector<std::string> paths;
+
+    // a realistic mix: static pages, per-service apis with parameters,
+    // and subtrees
+    for (unsigned int i = 0; i < numRoutes; i++) {
+        std::stringstream pattern, path;
+        switch (i % 3) {
+            case 0:
+                pattern << "/static/page" << i << ".html";
+                path << "/static/page" << i << ".html";
+                break;
+            case 1:
+                pattern << "/api/v4/service" << i << "/:version/:platform";
+                path << "/api/v4/service" << i << "/1.0." << i << "/ia32-linux";
+                break;
+            default:
+                pattern << "/files/dir" << i << "/*";
+                path << "/files/dir" << i << "/some/deeper/file.txt";
+                break;
+        }
+        if (!r.add(pattern.str(), &h)) {
+            std::cerr << "couldn't add " << pattern.str() << std::endl;
+            return 1;
+        }
+        paths.push_back(path.str());
+    }
+    (void) r.add("*", &h);
+
+    Router::Params p;
+    bp::time::Stopwatch sw;
+    sw.start();
+    for (unsigned int i = 0; i < numLookups; i++) {
+        if (r.find(paths[i % paths.size()], p) != &h) {
+            std::cerr << "no route for " << paths[i % paths.size()]
+                      << std::endl;
+            return 1;
+        }
+    }
+    double secs = sw.elapsedSec();
+
+    std::cout << r.size() << " routes: " << numLookups
+              << " lookups in " << secs << "s ("
+              << (secs > 0 ? (double) numLookups / secs : 0.0)
+              << " per second)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,312 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+
+/**
+ * bpsharedhostbench - the cost of running several services each in a
+ *                     process of its own ("spawned"), against loading
+ *                     them all into one shared host ("shared") with
+ *                     Controller::runShared().  Reports the time until
+ *                     every service is loaded, the round trip latency
+ *                     of invokes issued one at a time round robin across
+ *                     the services, and the resident memory of the
+ *                     runner processes once they're done.  Services
+ *                     must be v5 to share a host.
+ *
+ * usage: bpsharedhostbench <spawned|shared> <count>
+ *                          <service dir> <function> [...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bprunloop.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+#include "ServiceRunnerLib/ServiceRunnerLib.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+static bp::runloop::RunLoop s_rl;
+
+
+// loads every service, allocates an instance of each, then invokes
+// them round robin count times, recording the time taken by each
+class Bench : public ServiceRunner::IControllerListener
+{
+  public:
+    Bench(unsigned int count)
+        : m_count(count), m_loaded(0), m_allocated(0), m_next(0),
+          m_tid(0), m_failed(false), m_sw(), m_loadSec(0), m_samples()
+    {
+    }
+
+    void add(std::tr1::shared_ptr<ServiceRunner::Controller> c,
+             const std::string & function)
+    {
+        Service s;
+        s.controller = c;
+        s.function = function;
+        s.instance = 0;
+        m_index[c.get()] = m_services.size();
+        m_services.push_back(s);
+        c->setListener(this);
+    }
+
+    bool failed() { return m_failed; }
+    std::vector<double> & samples() { return m_samples; }
+    double loadSec() { return m_loadSec; }
+
+    // the distinct processes the services ended up in
+    std::set<int> pids()
+    {
+        std::set<int> pids;
+        for (size_t i = 0; i < m_services.size(); i++) {
+            pids.insert(m_services[i].controller->pid());
+        }
+        return pids;
+    }
+
+    void start() { m_sw.reset(); m_sw.start(); }
+
+    void stop()
+    {
+        for (size_t i = 0; i < m_services.size(); i++) {
+            m_services[i].controller.reset();
+        }
+    }
+
+  private:
+    struct Service {
+        std::tr1::shared_ptr<ServiceRunner::Controller> controller;
+        std::string function;
+        unsigned int instance;
+    };
+    std::vector<Service> m_services;
+    std::map<ServiceRunner::Controller *, size_t> m_index;
+    unsigned int m_count;
+    unsigned int m_loaded;
+    unsigned int m_allocated;
+    unsigned int m_next;
+    unsigned int m_tid;
+    bool m_failed;
+    bp::time::Stopwatch m_sw;
+    double m_loadSec;
+    std::vector<double> m_samples;
+
+    void fail(const std::string & why)
+    {
+        std::cerr << why << std::endl;
+        m_failed = true;
+        s_rl.stop();
+    }
+
+    void next()
+    {
+        if (m_samples.size() >= m_count) {
+            s_rl.stop();
+            return;
+        }
+        Service & s = m_services[m_next++ % m_services.size()];
+        m_sw.reset();
+        m_sw.start();
+        m_tid = s.controller->invoke(s.instance, s.function, NULL);
+        if (m_tid == (unsigned int) -1) fail("invoke failed");
+    }
+
+    void initialized(ServiceRunner::Controller *, const std::string &,
+                     const std::string &, unsigned int)
+    {
+        if (++m_loaded < m_services.size()) return;
+        m_loadSec = m_sw.elapsedSec();
+
+        bfs::path tmp = bpf::getTempPath(bpf::getTempDirectory(),
+                                         "bpsharedhostbench");
+        for (size_t i = 0; i < m_services.size(); i++) {
+            if (m_services[i].controller->allocate(
+                    "bpclient://bpsharedhostbench", tmp, tmp, "en",
+                    "bpsharedhostbench", 0) == (unsigned int) -1)
+            {
+                fail("allocate failed");
+                return;
+            }
+        }
+    }
+    void onEnded(ServiceRunner::Controller *)
+    {
+        fail("service ended");
+    }
+    void onDescribe(ServiceRunner::Controller *,
+                    const bp::service::Description &) { }
+    void onAllocated(ServiceRunner::Controller * c, unsigned int,
+                     unsigned int instance)
+    {
+        m_services[m_index[c]].instance = instance;
+        if (++m_allocated == m_services.size()) next();
+    }
+    void onInvokeResults(ServiceRunner::Controller *, unsigned int,
+                         unsigned int tid, const bp::Object *)
+    {
+        if (tid != m_tid) return;
+        m_samples.push_back(m_sw.elapsedSec());
+        next();
+    }
+    void onInvokeError(ServiceRunner::Controller *, unsigned int,
+                       unsigned int, const std::string & error,
+                       const std::string & verboseError)
+    {
+        fail(std::string("invoke error: ") + error + " " + verboseError);
+    }
+    void onCallback(ServiceRunner::Controller *, unsigned int,
+                    unsigned int, long long int, const bp::Object *) { }
+    void onPrompt(ServiceRunner::Controller *, unsigned int, unsigned int,
+                  const bfs::path &, const bp::Object *) { }
+    void onInstallHook(ServiceRunner::Controller *, int) { }
+    void onUninstallHook(ServiceRunner::Controller *, int) { }
+};
+
+
+// resident set size of a process in KB, zero where we can't tell
+static unsigned long
+residentKB(int pid)
+{
+#ifdef WIN32
+    (void) pid;
+    return 0;
+#else
+    std::stringstream cmd;
+    cmd << "ps -o rss= -p " << pid;
+    FILE * f = popen(cmd.str().c_str(), "r");
+    if (f == NULL) return 0;
+    unsigned long kb = 0;
+    if (fscanf(f, "%lu", &kb) != 1) kb = 0;
+    pclose(f);
+    return kb;
+#endif
+}
+
+
+static void
+report(std::vector<double> & samples, double loadSec,
+       const std::set<int> & pids)
+{
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) total += samples[i];
+    size_t n = samples.size();
+
+    unsigned long rss = 0;
+    std::set<int>::const_iterator it;
+    for (it = pids.begin(); it != pids.end(); ++it) rss += residentKB(*it);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "load    " << std::setw(10) << loadSec * 1e3 << "ms" << std::endl
+              << "invokes " << std::setw(10) << n << std::endl
+              << "mean    " << std::setw(10) << total * 1e6 / n << "us" << std::endl
+              << "median  " << std::setw(10) << samples[n / 2] * 1e6 << "us" << std::endl
+              << "p99     " << std::setw(10) << samples[(n * 99) / 100] * 1e6 << "us" << std::endl
+              << "max     " << std::setw(10) << samples[n - 1] * 1e6 << "us" << std::endl
+              << "procs   " << std::setw(10) << pids.size() << std::endl
+              << "rss     " << std::setw(10) << rss << "KB" << std::endl;
+}
+
+
+int
+main(int argc, const char ** argv)
+{
+    // this binary is also the harness for the spawned services and host
+    if (argc > 1 && !std::string("-runService").compare(argv[1])) {
+        return ServiceRunner::runServiceProcess(argc, argv) ? 0 : 1;
+    }
+
+    std::string mode(argc > 1 ? argv[1] : "");
+    if (argc < 5 || (argc - 3) % 2 != 0 ||
+        (mode != "spawned" && mode != "shared"))
+    {
+        std::cout << "usage: " << argv[0] << " <spawned|shared> <count> "
+                  << "<service dir> <function> [...]" << std::endl;
+        return 1;
+    }
+    unsigned int count = atoi(argv[2]);
+    if (count == 0) count = 1;
+
+    s_rl.init();
+
+    bfs::path harness = bpf::absoluteProgramPath(bfs::path(argv[0]));
+
+    int rv = 0;
+    {
+        Bench bench(count);
+        std::tr1::shared_ptr<ServiceRunner::SharedHost> host;
+        std::string err;
+
+        bench.start();
+        if (mode == "shared") {
+            host.reset(new ServiceRunner::SharedHost);
+            if (!host->run(harness, "", bfs::path(), err)) {
+                std::cerr << "couldn't start shared host: " << err << std::endl;
+                rv = 1;
+            }
+        }
+
+        for (int i = 3; rv == 0 && i < argc; i += 2) {
+            std::tr1::shared_ptr<ServiceRunner::Controller> controller(
+                new ServiceRunner::Controller(bfs::path(argv[i])));
+            bench.add(controller, argv[i + 1]);
+
+            bool ok;
+            if (host != NULL) {
+                ok = controller->runShared(host, harness, bfs::path(),
+                                           "bpsharedhostbench", "",
+                                           bfs::path(), err);
+            } else {
+                ok = controller->run(harness, bfs::path(),
+                                     "bpsharedhostbench", "",
+                                     bfs::path(), err);
+            }
+            if (!ok) {
+                std::cerr << "couldn't start " << argv[i] << ": "
+                          << err << std::endl;
+                rv = 1;
+            }
+        }
+
+        if (rv == 0) {
+            s_rl.run();
+            if (bench.failed() || bench.samples().empty()) rv = 1;
+            else report(bench.samples(), bench.loadSec(), bench.pids());
+        }
+        bench.stop();
+        host.reset();
+    }
+
+    s_rl.shutdown();
+    return rv;
+}
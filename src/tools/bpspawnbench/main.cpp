@@ -0,0 +1,140 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpspawnbench - cost of spawning a child as our heap grows.  At each
+ *                step the process dirties more memory, then spawns
+ *                and reaps /bin/true count times.  "spawn" goes through
+ *                bp::process::spawn(), "fork" through the plain
+ *                fork()/execv() spawn() used to do, whose cost grows
+ *                with the page tables it copies.
+ *
+ * usage: bpspawnbench <spawn|fork> [max MB] [count]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "BPUtils/bpprocess.h"
+#include "BPUtils/bpstopwatch.h"
+
+#ifdef WIN32
+int
+main(int, char **)
+{
+    std::cout << "bpspawnbench compares unix spawning strategies"
+              << std::endl;
+    return 1;
+}
+#else
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+static const char * s_true = "/bin/true";
+
+
+static bool
+forkSpawn()
+{
+    char * argv[] = { (char *) s_true, NULL };
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(s_true, argv);
+        _exit(1);
+    }
+    if (pid == -1) return false;
+    int status;
+    return waitpid(pid, &status, 0) == pid;
+}
+
+
+static bool
+bpSpawn()
+{
+    bp::process::spawnStatus s;
+    if (!bp::process::spawn(s_true, std::vector<std::string>(), &s)) {
+        return false;
+    }
+    int code;
+    return bp::process::wait(s, true, code);
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    std::string mode(argc > 1 ? argv[1] : "");
+    if (argc < 2 || argc > 4 || (mode != "spawn" && mode != "fork")) {
+        std::cout << "usage: " << argv[0] << " <spawn|fork> [max MB] [count]"
+                  << std::endl;
+        return 1;
+    }
+    bool viaFork = (mode == "fork");
+    unsigned int maxMB = argc > 2 ? atoi(argv[2]) : 1024;
+    unsigned int count = argc > 3 ? atoi(argv[3]) : 200;
+    if (count == 0) count = 1;
+
+    std::vector<char *> heap;
+    unsigned int heapMB = 0;
+    const unsigned int chunkMB = 16;
+
+    std::cout << std::setw(8) << "heap MB" << std::setw(14) << "us/spawn"
+              << std::endl;
+    for (unsigned int target = 0; target <= maxMB;
+         target = target ? target * 2 : 64)
+    {
+        // dirty every page so each is really mapped
+        while (heapMB < target) {
+            char * p = (char *) malloc(chunkMB << 20);
+            if (p == NULL) {
+                std::cerr << "out of memory at " << heapMB << "MB"
+                          << std::endl;
+                return 1;
+            }
+            memset(p, 1, chunkMB << 20);
+            heap.push_back(p);
+            heapMB += chunkMB;
+        }
+
+        bp::time::Stopwatch sw;
+        sw.start();
+        for (unsigned int i = 0; i < count; i++) {
+            if (!(viaFork ? forkSpawn() : bpSpawn())) {
+                std::cerr << "spawn failed" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(8) << heapMB << std::setw(14)
+                  << sw.elapsedSec() * 1e6 / count << std::endl;
+    }
+
+    for (size_t i = 0; i < heap.size(); i++) free(heap[i]);
+    return 0;
+}
+
+#endif
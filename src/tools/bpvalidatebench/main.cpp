@@ -0,0 +1,107 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpvalidatebench - measure the cost of validating the arguments of
+ *                   a call against its function's description, for
+ *                   functions of a few to many arguments.
+ *
+ * usage: bpvalidatebench [iterations]
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bptypeutil.h"
+#include "platform_utils/ServiceDescription.h"
+
+using bp::service::Argument;
+using bp::service::Function;
+
+
+// a function of n arguments cycling through the common types, every
+// other one required, and a call supplying all of them
+static Function
+wideFunction(unsigned int n, bp::Map & call)
+{
+    static const Argument::Type types[] = {
+        Argument::String, Argument::Integer, Argument::Boolean, Argument::Any
+    };
+
+    std::list<Argument> args;
+    for (unsigned int i = 0; i < n; i++) {
+        std::stringstream ss;
+        ss << "arg" << i;
+        Argument a(ss.str().c_str(), types[i % 4]);
+        a.setRequired(i % 2 == 0);
+        args.push_back(a);
+        switch (i % 4) {
+            case 0: call.add(ss.str(), new bp::String("value")); break;
+            case 1: call.add(ss.str(), new bp::Integer(i)); break;
+            case 2: call.add(ss.str(), new bp::Bool(true)); break;
+            case 3: call.add(ss.str(), new bp::Double(1.5)); break;
+        }
+    }
+
+    Function f;
+    f.setName("wide");
+    f.setArguments(args);
+    return f;
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc > 2) {
+        std::cout << "usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+    unsigned int iterations = 20000;
+    if (argc > 1) iterations = (unsigned int) atoi(argv[1]);
+    if (iterations == 0) iterations = 1;
+
+    static const unsigned int sizes[] = { 5, 20, 100 };
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        bp::Map call;
+        Function f = wideFunction(sizes[s], call);
+
+        bp::time::Stopwatch sw;
+        sw.start();
+        for (unsigned int i = 0; i < iterations; i++) {
+            std::string err = bp::service::validateArguments(f, &call);
+            if (!err.empty()) {
+                std::cerr << "validation failed: " << err << std::endl;
+                return 1;
+            }
+        }
+        double secs = sw.elapsedSec();
+
+        std::cout << sizes[s] << " arguments: "
+                  << (secs * 1000000.0 / iterations) << "us per call"
+                  << std::endl;
+    }
+    return 0;
+}
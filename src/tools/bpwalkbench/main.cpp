@@ -0,0 +1,168 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (c) 2010 Yahoo! Inc.
+ * All rights reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK *****
+ */
+
+/**
+ * bpwalkbench - compare recursiveVisit() with parallelVisit() over a
+ *               synthetic deep tree, filtering by mimetype as a drop
+ *               or file browse does.
+ *
+ * usage: bpwalkbench <scratch dir> [depth fanout files]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <vector>
+#include "BPUtils/bpfile.h"
+#include "BPUtils/bpstopwatch.h"
+#include "BPUtils/bpstrutil.h"
+
+namespace bpf = bp::file;
+namespace bfs = boost::filesystem;
+
+
+static const char * s_extensions[] = { ".jpg", ".txt", ".png", ".html" };
+
+
+// depth levels of fanout directories, each holding files files
+static size_t
+buildTree(const bfs::path & dir, unsigned int depth,
+          unsigned int fanout, unsigned int files)
+{
+    size_t nodes = 1;
+    bfs::create_directories(dir);
+    for (unsigned int i = 0; i < files; i++) {
+        char buf[32];
+        sprintf(buf, "file%u%s", i, s_extensions[i % 4]);
+        if (!bp::strutil::storeToFile(dir / buf, "")) {
+            std::cerr << "couldn't write " << dir / buf << std::endl;
+            exit(1);
+        }
+        nodes++;
+    }
+    if (depth > 0) {
+        for (unsigned int i = 0; i < fanout; i++) {
+            char buf[32];
+            sprintf(buf, "dir%u", i);
+            nodes += buildTree(dir / buf, depth - 1, fanout, files);
+        }
+    }
+    return nodes;
+}
+
+
+class SerialVisitor : virtual public bpf::IVisitor
+{
+  public:
+    SerialVisitor(const std::set<std::string> & types)
+        : m_types(types), m_visited(0), m_matched(0) {}
+    virtual tResult visitNode(const bfs::path & p, const bfs::path &) {
+        m_visited++;
+        if (bpf::isMimeType(p, m_types)) m_matched++;
+        return eOk;
+    }
+    std::set<std::string> m_types;
+    size_t m_visited;
+    size_t m_matched;
+};
+
+
+class BatchVisitor : virtual public bpf::IBatchVisitor
+{
+  public:
+    BatchVisitor(const std::set<std::string> & types)
+        : m_types(types), m_visited(0), m_matched(0) {}
+    virtual bpf::IVisitor::tResult visitNodes(
+        const std::vector<bpf::WalkEntry> & entries) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            m_visited++;
+            if (bpf::isMimeType(entries[i], m_types)) m_matched++;
+        }
+        return bpf::IVisitor::eOk;
+    }
+    std::set<std::string> m_types;
+    size_t m_visited;
+    size_t m_matched;
+};
+
+
+int
+main(int argc, char ** argv)
+{
+    if (argc != 2 && argc != 5) {
+        std::cout << "usage: " << argv[0]
+                  << " <scratch dir> [depth fanout files]" << std::endl;
+        return 1;
+    }
+    unsigned int depth = 4, fanout = 6, files = 60;
+    if (argc == 5) {
+        depth = atoi(argv[2]);
+        fanout = atoi(argv[3]);
+        files = atoi(argv[4]);
+    }
+
+    bfs::path dir = bpf::getTempPath(bfs::path(argv[1]), "bpwalkbench");
+    size_t nodes = 0;
+    try {
+        nodes = buildTree(dir, depth, fanout, files);
+    } catch (const bfs::filesystem_error & e) {
+        std::cerr << "couldn't create " << dir << ": " << e.what()
+                  << std::endl;
+        return 1;
+    }
+    std::cout << "walking " << nodes << " nodes" << std::endl;
+
+    std::set<std::string> types;
+    types.insert("image/jpeg");
+    types.insert("image/png");
+
+    bp::time::Stopwatch sw;
+    sw.start();
+    SerialVisitor sv(types);
+    (void) bpf::recursiveVisit(dir, sv, true);
+    sw.stop();
+    std::cout << std::fixed << std::setprecision(3)
+              << "recursiveVisit        " << std::setw(8) << sw.elapsedSec()
+              << "s  (" << sv.m_matched << " matched)" << std::endl;
+
+    unsigned int threads[] = { 1, 2, 4, 8 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        BatchVisitor bv(types);
+        sw.reset();
+        sw.start();
+        (void) bpf::parallelVisit(dir, bv, true, threads[i]);
+        sw.stop();
+        std::cout << "parallelVisit x" << threads[i]
+                  << "      " << std::setw(8) << sw.elapsedSec()
+                  << "s  (" << bv.m_matched << " matched)";
+        if (bv.m_visited != sv.m_visited) {
+            std::cout << "  MISMATCH: visited " << bv.m_visited
+                      << " vs " << sv.m_visited;
+        }
+        std::cout << std::endl;
+    }
+
+    (void) bpf::safeRemove(dir);
+    return 0;
+}
@@ -32,7 +32,6 @@
 #include "bphttp/HttpServer.h"
 #include "BPUtils/bpfile.h"
 #include "BPUtils/bptime.h"
-#include "BPUtils/bpstrutil.h"
 
 #ifdef WIN32
 #include <Windows.h>
@@ -61,10 +60,8 @@ public:
         if (isRegularFile(path)) {
             std::string mt = *(mimeTypes(path).begin());
             response.headers.add(Headers::ksContentType,mt.c_str());
-            std::string sBody;
-            if (bp::strutil::loadFromFile(path, sBody)) {
-                response.body.assign(sBody);
-            }
+            // streamed from disk by the server, with range support
+            response.body.fromPath(path);
         } else if (boost::filesystem::is_directory(path)) {
             response.body.append("<html><head><title>");
             response.body.append("Contents of " + path.generic_string());
@@ -64,7 +64,7 @@ public:
     virtual void onDownloadProgress(unsigned int tid,
                                     unsigned int pct);
     virtual void onDownloadComplete(unsigned int tid,
-                                    const std::vector<unsigned char> & buf);
+                                    const DownloadedPackage & pkg);
     virtual void gotServiceDetails(unsigned int tid,
                                    const bp::service::Description & desc);
     virtual void gotPermissions(unsigned int tid,
@@ -506,7 +506,7 @@ CommandExecutorRunner::onDownloadProgress(unsigned int tid,
 
 void
 CommandExecutorRunner::onDownloadComplete(unsigned int tid,
-                                       const std::vector<unsigned char> & buf)
+                                       const DownloadedPackage & pkg)
 {
 }
 
@@ -674,7 +674,8 @@ CommandExecutorRunner::onLatestPlatformDownloaded(
 {
     std::cout << "Downloaded latest platform ("
               << pkgAndVersion.m_version
-              << ") " << pkgAndVersion.m_pkg.size() << " bytes."
+              << ") " << pkgAndVersion.m_pkg.m_size << " bytes, sha256 "
+              << pkgAndVersion.m_pkg.m_sha256 << "."
               << std::endl;
     onSuccess();        
 }
@@ -44,6 +44,15 @@ static APTArgDefinition g_args[] = {
       APT::NOT_INTEGER, APT::MAY_RECUR,
       "Specify secondary distribution servers.  May be repeated any number of"
       "times."
+    },
+    { "b", APT::TAKES_ARG, APT::NO_DEFAULT, APT::NOT_REQUIRED,
+      APT::NOT_INTEGER, APT::MAY_NOT_RECUR,
+      "run commands from a file ('-' for stdin) rather than "
+      "interactively, printing per-command latency."
+    },
+    { "n", APT::TAKES_ARG, "1", APT::NOT_REQUIRED,
+      APT::IS_INTEGER, APT::MAY_NOT_RECUR,
+      "with -b, the number of commands that may be outstanding at once."
     }
 };
 
@@ -90,6 +99,8 @@ main(int argc, const char ** argv)
     }
 
     setupLogging(argParser);
+
+    int rv = 0;
     
     // scope here so that all objects are cleaned up by end of main
     {
@@ -241,12 +252,21 @@ main(int argc, const char ** argv)
             0, 0,
             "Download the latest platform from the distribution server.");
 
-        parser->start();
-        s_rl.run();
+        if (argParser.argumentPresent("b")) {
+            if (parser->startBatch(argParser.argument("b"),
+                                   argParser.argumentAsInteger("n")))
+            {
+                s_rl.run();
+            }
+            if (!parser->batchSucceeded()) rv = 1;
+        } else {
+            parser->start();
+            s_rl.run();
+        }
         parser->stop();    
     }
 
     s_rl.shutdown();
 
-    return 0;
+    return rv;
 }